@@ -27,54 +27,46 @@ uint32_t DeepChannelsIndex::search(
 {
 	results.clear();
 
-	std::unique_ptr<Xapian::Database> dbPtr(
-	            DeepSearch::openReadOnlyDatabase(dbPath()) );
-	if(!dbPtr) return 0;
-
-	Xapian::Database& db(*dbPtr);
-
-	// Set up a QueryParser with a stemmer and suitable prefixes.
-	Xapian::QueryParser queryparser;
-	//queryparser.set_stemmer(Xapian::Stem("en"));
-	queryparser.set_stemming_strategy(queryparser.STEM_SOME);
-	// Start of prefix configuration.
-	//queryparser.add_prefix("title", "S");
-	//queryparser.add_prefix("description", "XD");
-	// End of prefix configuration.
-
-	// And parse the query.
-	Xapian::Query query = queryparser.parse_query(queryStr);
-
-	// Use an Enquire object on the database to run the query.
-	Xapian::Enquire enquire(db);
-	enquire.set_query(query);
-
-	Xapian::MSet mset = enquire.get_mset(
-	            0, maxResults ? maxResults : db.get_doccount() );
-
-	for ( Xapian::MSetIterator m = mset.begin(); m != mset.end(); ++m )
+	db()->read([&](Xapian::Database& db)
 	{
-		const Xapian::Document& doc = m.get_document();
-		DeepChannelsSearchResult s;
-		s.mUrl = doc.get_value(URL_VALUENO);
+		results.clear();
+
+		// Set up a QueryParser with a stemmer and suitable prefixes.
+		Xapian::QueryParser queryparser;
+		//queryparser.set_stemmer(Xapian::Stem("en"));
+		queryparser.set_stemming_strategy(queryparser.STEM_SOME);
+		// Start of prefix configuration.
+		//queryparser.add_prefix("title", "S");
+		//queryparser.add_prefix("description", "XD");
+		// End of prefix configuration.
+
+		// And parse the query.
+		Xapian::Query query = queryparser.parse_query(queryStr);
+
+		// Use an Enquire object on the database to run the query.
+		Xapian::Enquire enquire(db);
+		enquire.set_query(query);
+
+		Xapian::MSet mset = enquire.get_mset(
+		            0, maxResults ? maxResults : db.get_doccount() );
+
+		for ( Xapian::MSetIterator m = mset.begin(); m != mset.end(); ++m )
+		{
+			const Xapian::Document& doc = m.get_document();
+			DeepChannelsSearchResult s;
+			s.mUrl = doc.get_value(URL_VALUENO);
 #if XAPIAN_AT_LEAST(1,3,5)
-		s.mSnippet = mset.snippet(doc.get_data());
+			s.mSnippet = mset.snippet(doc.get_data());
 #endif // XAPIAN_AT_LEAST(1,3,5)
-		results.push_back(s);
-	}
+			results.push_back(s);
+		}
+	});
 
 	return static_cast<uint32_t>(results.size());
 }
 
 void DeepChannelsIndex::indexChannelGroup(const RsGxsChannelGroup& chan)
 {
-	std::unique_ptr<Xapian::WritableDatabase> dbPtr(
-	            DeepSearch::openWritableDatabase(
-	                dbPath(), Xapian::DB_CREATE_OR_OPEN ) );
-	if(!dbPtr) return;
-
-	Xapian::WritableDatabase& db(*dbPtr);
-
 	// Set up a TermGenerator that we'll use in indexing.
 	Xapian::TermGenerator termgenerator;
 	//termgenerator.set_stemmer(Xapian::Stem("en"));
@@ -118,7 +110,8 @@ void DeepChannelsIndex::indexChannelGroup(const RsGxsChannelGroup& chan)
 	// database only once no matter how many times we run the
 	// indexer. "Q" prefix is a Xapian convention for unique id term.
 	doc.add_boolean_term(idTerm);
-	db.replace_document(idTerm, doc);
+	db()->push([idTerm, doc](Xapian::WritableDatabase& db)
+	{ db.replace_document(idTerm, doc); });
 }
 
 void DeepChannelsIndex::removeChannelFromIndex(RsGxsGroupId grpId)
@@ -128,25 +121,12 @@ void DeepChannelsIndex::removeChannelFromIndex(RsGxsGroupId grpId)
 	        .setScheme("retroshare").setPath("/channel")
 	        .setQueryKV("id", grpId.toStdString());
 	std::string idTerm("Q" + chanUrl.toString());
-
-	std::unique_ptr<Xapian::WritableDatabase> dbPtr(
-	            DeepSearch::openWritableDatabase(
-	                dbPath(), Xapian::DB_CREATE_OR_OPEN ) );
-	if(!dbPtr) return;
-
-	Xapian::WritableDatabase& db(*dbPtr);
-	db.delete_document(idTerm);
+	db()->push([idTerm](Xapian::WritableDatabase& db)
+	{ db.delete_document(idTerm); });
 }
 
 void DeepChannelsIndex::indexChannelPost(const RsGxsChannelPost& post)
 {
-	std::unique_ptr<Xapian::WritableDatabase> dbPtr(
-	            DeepSearch::openWritableDatabase(
-	                dbPath(), Xapian::DB_CREATE_OR_OPEN ) );
-	if(!dbPtr) return;
-
-	Xapian::WritableDatabase& db(*dbPtr);
-
 	// Set up a TermGenerator that we'll use in indexing.
 	Xapian::TermGenerator termgenerator;
 	//termgenerator.set_stemmer(Xapian::Stem("en"));
@@ -207,7 +187,8 @@ void DeepChannelsIndex::indexChannelPost(const RsGxsChannelPost& post)
 	else doc.set_data(post.mMeta.mMsgName);
 
 	doc.add_boolean_term(idTerm);
-	db.replace_document(idTerm, doc);
+	db()->push([idTerm, doc](Xapian::WritableDatabase& db)
+	{ db.replace_document(idTerm, doc); });
 }
 
 void DeepChannelsIndex::removeChannelPostFromIndex(
@@ -219,12 +200,6 @@ void DeepChannelsIndex::removeChannelPostFromIndex(
 	        .setQueryKV("msgid", msgId.toStdString());
 	// "Q" prefix is a Xapian convention for unique id term.
 	std::string idTerm("Q" + postUrl.toString());
-
-	std::unique_ptr<Xapian::WritableDatabase> dbPtr(
-	            DeepSearch::openWritableDatabase(
-	                dbPath(), Xapian::DB_CREATE_OR_OPEN ) );
-	if(!dbPtr) return;
-
-	Xapian::WritableDatabase& db(*dbPtr);
-	db.delete_document(idTerm);
+	db()->push([idTerm](Xapian::WritableDatabase& db)
+	{ db.delete_document(idTerm); });
 }
@@ -26,6 +26,7 @@
 #include "retroshare/rsgxschannels.h"
 #include "retroshare/rsinit.h"
 #include "util/rsurl.h"
+#include "deep_search/commonutils.hpp"
 
 struct DeepChannelsSearchResult
 {
@@ -74,4 +75,7 @@ private:
 		        RsAccounts::AccountDirectory() + "/deep_channels_xapian_db";
 		return dbDir;
 	}
+
+	static std::shared_ptr<DeepSearch::SharedXapianDb> db()
+	{ return DeepSearch::SharedXapianDb::forPath(dbPath()); }
 };
@@ -20,10 +20,12 @@
 
 #include <algorithm>
 #include <thread>
+#include <map>
+#include <vector>
+#include <iterator>
 
 #include "deep_search/commonutils.hpp"
 #include "util/stacktrace.h"
-#include "util/rsthreads.h"
 #include "util/rsdebuglevel0.h"
 
 #ifndef XAPIAN_AT_LEAST
@@ -85,87 +87,367 @@ std::string timetToXapianDate(const rstime_t& time)
 	return date;
 }
 
-StubbornWriteOpQueue::~StubbornWriteOpQueue()
+/*static*/ constexpr uint32_t SharedXapianDb::BATCH_MAX_OPS;
+/*static*/ constexpr uint32_t SharedXapianDb::BATCH_MAX_DELAY_MS;
+/*static*/ constexpr rstime_t SharedXapianDb::OPEN_RETRY_TIMEOUT;
+/*static*/ constexpr size_t SharedXapianDb::MAX_KNOWN_INDEXED;
+/*static*/ constexpr size_t SharedXapianDb::MAX_IDLE_READERS;
+/*static*/ constexpr uint32_t SharedXapianDb::WRITER_POLL_MS;
+/*static*/ constexpr uint32_t SharedXapianDb::FLUSH_POLL_MS;
+
+/*static*/ std::shared_ptr<SharedXapianDb> SharedXapianDb::forPath(
+        const std::string& dbPath )
 {
-	auto fErr = flush(0);
-	if(fErr)
+	/* Instances are never released before process exit, as the whole point is
+	 * to keep the database handles open between index objects lifetimes */
+	static RsMutex registryMtx("DeepSearch::SharedXapianDb registry");
+	static std::map<std::string, std::shared_ptr<SharedXapianDb>> registry;
+
+	RS_STACK_MUTEX(registryMtx);
+	auto& dbPtr = registry[dbPath];
+	if(!dbPtr)
 	{
-		RS_FATAL( "Flush failed on destruction ", mOpStore.size(),
-		          " operations irreparably lost ", fErr );
-		print_stacktrace();
+		dbPtr.reset(new SharedXapianDb(dbPath));
+		dbPtr->start("xapian writer");
 	}
+	return dbPtr;
 }
 
-void StubbornWriteOpQueue::push(write_op op)
+SharedXapianDb::SharedXapianDb(const std::string& dbPath) :
+    mDbPath(dbPath), mQueueMtx("DeepSearch::SharedXapianDb::mQueueMtx"),
+    mPushedSeq(0), mCommittedSeq(0), mLostSeq(0), mFlushedSeq(0),
+    mFlushRequested(false), mGeneration(0),
+    mReadersMtx("DeepSearch::SharedXapianDb::mReadersMtx"),
+    mKnownMtx("DeepSearch::SharedXapianDb::mKnownMtx") {}
+
+SharedXapianDb::~SharedXapianDb() { fullstop(); }
+
+void SharedXapianDb::push(write_op op)
 {
 	RS_DBG4("");
 
+	RS_STACK_MUTEX(mQueueMtx);
+	mOps.push_back(QueuedOp{std::move(op), std::string()});
+	++mPushedSeq;
+}
+
+bool SharedXapianDb::pushIndexed(const std::string& idTerm, write_op op)
+{
+	RS_DBG4(idTerm);
+
+	/* Checked and queued atomically, a removal forgets idTerm before queuing
+	 * its own operation so it is always applied after this one */
+	RS_STACK_MUTEX(mKnownMtx);
+	if(mBeingIndexed.find(idTerm) == mBeingIndexed.end()) return false;
+
+	RS_STACK_MUTEX(mQueueMtx);
+	mOps.push_back(QueuedOp{std::move(op), idTerm});
+	++mPushedSeq;
+	return true;
+}
+
+std::error_condition SharedXapianDb::flush(std::chrono::milliseconds timeout)
+{
+	uint64_t target;
+	uint64_t from;
+
+	/* Operations settled before the call are reported too, unless a previous
+	 * flush already did */
+	auto settled = [&]() -> std::error_condition
 	{
-		std::unique_lock<std::mutex> lock(mQueueMutex);
-		mOpStore.push(op);
+		mFlushedSeq = std::max(mFlushedSeq, target);
+		if(mLostSeq > from) return std::errc::io_error;
+		return std::error_condition();
+	};
+
+	{
+		RS_STACK_MUTEX(mQueueMtx);
+		target = mPushedSeq;
+		from = mFlushedSeq;
+		if(mCommittedSeq >= target) return settled();
+		mFlushRequested = true;
 	}
 
-	flush();
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+	for(;;)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(FLUSH_POLL_MS));
+
+		RS_STACK_MUTEX(mQueueMtx);
+		if(mCommittedSeq >= target) return settled();
+		if(std::chrono::steady_clock::now() >= deadline)
+			return std::errc::timed_out;
+	}
 }
 
-std::error_condition StubbornWriteOpQueue::flush(
-        rstime_t acceptDelay, rstime_t callTS )
+std::error_condition SharedXapianDb::read(
+        const std::function<void(Xapian::Database&)>& op )
 {
-	RS_DBG4("");
+	Reader reader;
 
 	{
-		// Return without attempt to open the database if the queue is empty
-		std::unique_lock<std::mutex> lock(mQueueMutex);
-		if(mOpStore.empty()) return std::error_condition();
+		RS_STACK_MUTEX(mReadersMtx);
+		if(!mIdleReaders.empty())
+		{
+			reader = std::move(mIdleReaders.back());
+			mIdleReaders.pop_back();
+		}
 	}
 
-	std::unique_ptr<Xapian::WritableDatabase> dbPtr;
-	try
+	/* A commit happening while op is running may invalidate the revision we are
+	 * reading, in that case start over with a fresh handle once */
+	for(int attempt = 0; attempt < 2; ++attempt)
 	{
-		dbPtr = std::make_unique<Xapian::WritableDatabase>(
-		            mDbPath, Xapian::DB_CREATE_OR_OPEN );
+		try
+		{
+			const uint64_t generation = mGeneration.load();
+			if(!reader.mDb)
+			{
+				reader.mDb = openReadOnlyDatabase(mDbPath);
+				if(!reader.mDb) return std::errc::bad_file_descriptor;
+			}
+			else if(reader.mGeneration != generation) reader.mDb->reopen();
+			reader.mGeneration = generation;
+
+			op(*reader.mDb);
+
+			RS_STACK_MUTEX(mReadersMtx);
+			if(mIdleReaders.size() < MAX_IDLE_READERS)
+				mIdleReaders.push_back(std::move(reader));
+			return std::error_condition();
+		}
+		catch(Xapian::DatabaseModifiedError&)
+		{
+			RS_DBG2("Database ", mDbPath, " modified while reading, retrying");
+			reader.mDb.reset();
+		}
+		catch(Xapian::Error& e)
+		{
+			RS_ERR("Failed reading ", mDbPath, ": ", e.get_description());
+			return std::errc::io_error;
+		}
+	}
+
+	return std::errc::resource_unavailable_try_again;
+}
+
+bool SharedXapianDb::isKnownIndexed(const std::string& idTerm)
+{
+	RS_STACK_MUTEX(mKnownMtx);
+	return mKnownIndexed.find(idTerm) != mKnownIndexed.end() ||
+	        mBeingIndexed.find(idTerm) != mBeingIndexed.end();
+}
+
+bool SharedXapianDb::beginIndexing(const std::string& idTerm)
+{
+	RS_STACK_MUTEX(mKnownMtx);
+	if(mKnownIndexed.find(idTerm) != mKnownIndexed.end()) return false;
+	return mBeingIndexed.insert(idTerm).second;
+}
+
+void SharedXapianDb::setKnownIndexed(const std::string& idTerm, bool indexed)
+{
+	RS_STACK_MUTEX(mKnownMtx);
+	mBeingIndexed.erase(idTerm);
+	if(!indexed)
+	{
+		mKnownIndexed.erase(idTerm);
+		return;
 	}
-	catch(Xapian::DatabaseLockError)
+
+	/* The filter is just a shortcut, forgetting everything costs only a few
+	 * database lookups later */
+	if(mKnownIndexed.size() >= MAX_KNOWN_INDEXED) mKnownIndexed.clear();
+	mKnownIndexed.insert(idTerm);
+}
+
+void SharedXapianDb::settleIndexed(
+        const std::vector<std::string>& idTerms, bool committed )
+{
+	RS_STACK_MUTEX(mKnownMtx);
+	for(auto& idTerm : idTerms)
+	{
+		/* Not being indexed anymore means it has been removed meanwhile, the
+		 * removal is queued after this operation so don't mark it */
+		if(!mBeingIndexed.erase(idTerm) || !committed) continue;
+
+		if(mKnownIndexed.size() >= MAX_KNOWN_INDEXED) mKnownIndexed.clear();
+		mKnownIndexed.insert(idTerm);
+	}
+}
+
+void SharedXapianDb::clearKnownIndexed()
+{
+	RS_STACK_MUTEX(mKnownMtx);
+	mKnownIndexed.clear();
+}
+
+void SharedXapianDb::run()
+{
+	using clock = std::chrono::steady_clock;
+	const std::chrono::milliseconds maxDelay(BATCH_MAX_DELAY_MS);
+
+	std::unique_ptr<Xapian::WritableDatabase> db;
+	uint32_t uncommitted = 0;
+	std::vector<std::string> uncommittedTerms;
+	clock::time_point firstUncommitted;
+	bool openFailing = false;
+	clock::time_point openFailingSince;
+	clock::time_point lastOpenAttempt;
+
+	for(;;)
 	{
-		if(acceptDelay)
+		const bool stop = shouldStop();
+		std::deque<QueuedOp> ops;
+		uint64_t lastSeq = 0;
+		bool flushRequested = false;
+		bool hasWork;
 		{
-			rstime_t tNow = time(nullptr);
-			rstime_t maxRemaining = tNow - (callTS + acceptDelay);
-			if(maxRemaining > 0)
+			RS_STACK_MUTEX(mQueueMtx);
+			const auto tNow = clock::now();
+
+			/* While the database cannot be opened retry once per second,
+			 * unless asked to stop or flush */
+			hasWork = stop || mFlushRequested ||
+			        ( uncommitted && tNow - firstUncommitted >= maxDelay ) ||
+			        ( !mOps.empty() && ( !openFailing ||
+			          tNow - lastOpenAttempt >= std::chrono::seconds(1) ) );
+
+			if(hasWork)
 			{
-				std::chrono::milliseconds interval(
-				            std::max(rstime_t(50), maxRemaining*1000/5) );
-				RS_DBG3( "Cannot acquire database write lock, retrying in:",
-				         interval.count(), "ms" );
-				RsThread::async([this, acceptDelay, callTS, interval]()
+				ops.swap(mOps);
+				lastSeq = mPushedSeq;
+				flushRequested = mFlushRequested;
+				mFlushRequested = false;
+			}
+		}
+
+		if(!hasWork)
+		{
+			std::this_thread::sleep_for(
+			            std::chrono::milliseconds(WRITER_POLL_MS) );
+			continue;
+		}
+
+		if(!ops.empty() && !db)
+		{
+			lastOpenAttempt = clock::now();
+			try
+			{
+				db = std::make_unique<Xapian::WritableDatabase>(
+				            mDbPath, Xapian::DB_CREATE_OR_OPEN );
+				openFailing = false;
+			}
+			catch(Xapian::DatabaseLockError&)
+			{
+				RS_DBG2("Cannot acquire ", mDbPath, " write lock, retrying");
+			}
+			catch(...)
+			{
+				RS_ERR("Xapian DB ", mDbPath, " is apparently corrupted");
+				print_stacktrace();
+			}
+
+			if(!db)
+			{
+				const auto tNow = clock::now();
+				if(!openFailing) openFailingSince = tNow;
+				openFailing = true;
+
+				if( stop || tNow - openFailingSince >
+				        std::chrono::seconds(OPEN_RETRY_TIMEOUT) )
 				{
-					std::this_thread::sleep_for(interval);
-					flush(acceptDelay, callTS);
-				});
-				return std::error_condition();
+					RS_ERR( std::errc::timed_out, " opening ", mDbPath, " ",
+					        ops.size(), " operations irreparably lost" );
+					openFailing = false;
+
+					/* Lost additions can be indexed again later, lost
+					 * removals may leave documents we thought were gone */
+					std::vector<std::string> lostTerms;
+					for(auto& op : ops)
+						if(!op.mIndexedTerm.empty())
+							lostTerms.push_back(op.mIndexedTerm);
+					settleIndexed(lostTerms, false);
+					clearKnownIndexed();
+
+					RS_STACK_MUTEX(mQueueMtx);
+					mCommittedSeq = lastSeq;
+					mLostSeq = lastSeq;
+					if(stop) break;
+					continue;
+				}
+
+				// Put operations back in front of the queue preserving order
+				RS_STACK_MUTEX(mQueueMtx);
+				mOps.insert( mOps.begin(),
+				             std::make_move_iterator(ops.begin()),
+				             std::make_move_iterator(ops.end()) );
+				continue;
 			}
-			else
+		}
+
+		if(!ops.empty() && !uncommitted) firstUncommitted = clock::now();
+		std::vector<std::string> failedTerms;
+		for(auto& op : ops)
+		{
+			try
 			{
-				RS_ERR(std::errc::timed_out, acceptDelay, callTS, tNow);
-				return std::errc::timed_out;
+				op.mOp(*db);
+				if(!op.mIndexedTerm.empty())
+					uncommittedTerms.push_back(op.mIndexedTerm);
+			}
+			catch(Xapian::Error& e)
+			{
+				RS_ERR( "Write operation on ", mDbPath, " failed: ",
+				        e.get_description() );
+				if(!op.mIndexedTerm.empty())
+					failedTerms.push_back(op.mIndexedTerm);
 			}
 		}
-		else return std::errc::resource_unavailable_try_again;
-	}
-	catch(...)
-	{
-		RS_ERR("Xapian DB ", mDbPath, " is apparently corrupted");
-		print_stacktrace();
-		return std::errc::io_error;
-	}
+		uncommitted += static_cast<uint32_t>(ops.size());
+		if(!failedTerms.empty()) settleIndexed(failedTerms, false);
 
-	std::unique_lock<std::mutex> lock(mQueueMutex);
-	while(!mOpStore.empty())
-	{
-		auto op = mOpStore.front(); mOpStore.pop();
-		op(*dbPtr);
+		if( uncommitted && ( stop || flushRequested ||
+		                     uncommitted >= BATCH_MAX_OPS ||
+		                     clock::now() - firstUncommitted >= maxDelay ) )
+		{
+			RS_DBG3("Committing ", uncommitted, " operations to ", mDbPath);
+			bool committed = true;
+			try { db->commit(); }
+			catch(Xapian::Error& e)
+			{
+				RS_ERR("Commit on ", mDbPath, " failed: ", e.get_description());
+				committed = false;
+			}
+			uncommitted = 0;
+			++mGeneration;
+
+			settleIndexed(uncommittedTerms, committed);
+			uncommittedTerms.clear();
+
+			/* The batch is gone for good, removals included, and the handle
+			 * may be in an inconsistent state */
+			if(!committed)
+			{
+				clearKnownIndexed();
+				db.reset();
+
+				RS_STACK_MUTEX(mQueueMtx);
+				mLostSeq = lastSeq;
+			}
+		}
+
+		if(!uncommitted)
+		{
+			RS_STACK_MUTEX(mQueueMtx);
+			mCommittedSeq = lastSeq;
+		}
+
+		if(stop) break;
 	}
-	return std::error_condition();
+
+	// Closing the handle releases the lock so other processes can write
+	db.reset();
 }
 
 std::string simpleTextHtmlExtract(const std::string& rsHtmlDoc)
@@ -22,10 +22,15 @@
 #include <xapian.h>
 #include <memory>
 #include <functional>
-#include <queue>
-#include <mutex>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <unordered_set>
+#include <system_error>
 
 #include "util/rstime.h"
+#include "util/rsthreads.h"
 
 #ifndef XAPIAN_AT_LEAST
 #define XAPIAN_AT_LEAST(A,B,C) (XAPIAN_MAJOR_VERSION > (A) || \
@@ -45,25 +50,140 @@ std::string timetToXapianDate(const rstime_t& time);
 
 std::string simpleTextHtmlExtract(const std::string& rsHtmlDoc);
 
-struct StubbornWriteOpQueue
+/**
+ * Persistent state of a Xapian database shared by every index object pointing
+ * to the same path. A dedicated thread owns the Xapian::WritableDatabase for
+ * the whole process lifetime, applies queued write operations and commits them
+ * in batches. Each concurrent reader gets its own read-only handle from a small
+ * pool, handles are reopened only after the writer committed something. An
+ * in-memory filter keeps track of documents already known to be indexed so
+ * callers can skip them without touching the database.
+ */
+class SharedXapianDb : public RsThread
 {
-	explicit StubbornWriteOpQueue(const std::string& dbPath):
-	    mDbPath(dbPath) {}
+public:
+	/// Get the instance for the given path, creating it on first use
+	static std::shared_ptr<SharedXapianDb> forPath(const std::string& dbPath);
 
-	~StubbornWriteOpQueue();
+	~SharedXapianDb() override;
 
+	/// Queue a write operation, it is applied asynchronously by the writer
 	void push(write_op op);
 
+	/**
+	 * @brief Queue a write operation storing the document with given idTerm
+	 * Once the operation is committed idTerm is marked as known indexed, if it
+	 * fails or is lost idTerm is forgotten so it can be indexed again later.
+	 * @return false if idTerm is not being indexed anymore, because it has
+	 *	been removed meanwhile, in that case op is not queued
+	 */
+	bool pushIndexed(const std::string& idTerm, write_op op);
+
+	/**
+	 * @brief Ask the writer to commit everything pushed so far
+	 * @param[in] timeout how long to wait for the commit to happen
+	 * @return timed_out if the operations have not been committed in time,
+	 *	io_error if some of the operations pushed since the previous flush have
+	 *	been lost, because the database could not be opened or committed
+	 */
 	std::error_condition flush(
-	        rstime_t acceptDelay = 20, rstime_t callTS = time(nullptr) );
+	        std::chrono::milliseconds timeout = std::chrono::seconds(20) );
+
+	/**
+	 * @brief Run a read operation on a read-only handle of its own, so reads
+	 *	from different threads run concurrently
+	 * @return bad_file_descriptor if the database cannot be opened, which is
+	 *	expected if nothing has been indexed yet, io_error if the operation
+	 *	threw
+	 */
+	std::error_condition read(
+	        const std::function<void(Xapian::Database&)>& op );
+
+	/**
+	 * @return true if idTerm has been committed or found up to date since
+	 *	startup, or is being indexed
+	 */
+	bool isKnownIndexed(const std::string& idTerm);
+
+	/**
+	 * @brief Claim idTerm for indexing
+	 * @return false if idTerm is already known indexed or being indexed,
+	 *	otherwise it is considered being indexed until pushIndexed() commits it
+	 *	or setKnownIndexed() is called for it
+	 */
+	bool beginIndexing(const std::string& idTerm);
+
+	/// Mark idTerm as up to date in the database, or forget about it
+	void setKnownIndexed(const std::string& idTerm, bool indexed = true);
+
+	/// Commit after this many operations...
+	static constexpr uint32_t BATCH_MAX_OPS = 1000;
+
+	/// ... or after the oldest uncommitted operation waited this long
+	static constexpr uint32_t BATCH_MAX_DELAY_MS = 2000;
+
+	/** Seconds to keep retrying to open the writable database (e.g. locked by
+	 * another process) before dropping the queued operations */
+	static constexpr rstime_t OPEN_RETRY_TIMEOUT = 20;
+
+	/// Bound memory used by the already indexed filter
+	static constexpr size_t MAX_KNOWN_INDEXED = 500000;
+
+	/// Read-only handles kept open for the next readers
+	static constexpr size_t MAX_IDLE_READERS = 4;
+
+	/// How often the writer checks for queued operations when idle
+	static constexpr uint32_t WRITER_POLL_MS = 20;
+
+	/// How often flush() checks if the writer committed
+	static constexpr uint32_t FLUSH_POLL_MS = 5;
+
+protected:
+	/// Writer thread body, @see RsThread
+	void run() override;
 
 private:
-	std::queue<write_op> mOpStore;
-	rstime_t mLastFlush;
+	explicit SharedXapianDb(const std::string& dbPath);
+
+	struct QueuedOp
+	{
+		write_op mOp;
+		std::string mIndexedTerm; /// Set for operations from pushIndexed()
+	};
+
+	struct Reader
+	{
+		Reader() : mGeneration(0) {}
+
+		std::unique_ptr<Xapian::Database> mDb;
+		uint64_t mGeneration;
+	};
 
-	std::mutex mQueueMutex;
+	/// Mark or forget the idTerms of given operations, once they are settled
+	void settleIndexed(const std::vector<std::string>& idTerms, bool committed);
+
+	/// Forget all known indexed documents, as some operations have been lost
+	void clearKnownIndexed();
 
 	const std::string mDbPath;
+
+	RsMutex mQueueMtx;
+	std::deque<QueuedOp> mOps;
+	uint64_t mPushedSeq;
+	uint64_t mCommittedSeq;
+	uint64_t mLostSeq;    /// Sequence number of the last lost operation
+	uint64_t mFlushedSeq; /// Operations up to this one have been reported by flush()
+	bool mFlushRequested;
+
+	/// Incremented by the writer at each commit, readers reopen when changed
+	std::atomic<uint64_t> mGeneration;
+
+	RsMutex mReadersMtx;
+	std::vector<Reader> mIdleReaders;
+
+	RsMutex mKnownMtx;
+	std::unordered_set<std::string> mKnownIndexed;
+	std::unordered_set<std::string> mBeingIndexed;
 };
 
 }
@@ -20,6 +20,9 @@
 
 
 #include <utility>
+#include <algorithm>
+#include <deque>
+#include <memory>
 
 #include "deep_search/filesindex.hpp"
 #include "deep_search/commonutils.hpp"
@@ -30,35 +33,186 @@
 /*static*/ std::multimap<int, DeepFilesIndex::IndexerFunType>
 DeepFilesIndex::indexersRegister = {};
 
+/*static*/ constexpr uint32_t DeepFilesIndex::MAX_EXTRACTION_WORKERS;
+/*static*/ constexpr size_t DeepFilesIndex::MAX_PENDING_EXTRACTIONS;
+
+/**
+ * Files are offered for indexing by the hashing thread as soon as their hash is
+ * known, extracting tags there would add the indexers cost to the already long
+ * hashing time, so extraction is handed over to these workers. The file has
+ * just been read for hashing so its content is most likely still in the page
+ * cache when the indexers open it.
+ */
+struct DeepFilesIndex::ExtractionPool
+{
+	struct Job
+	{
+		std::shared_ptr<DeepSearch::SharedXapianDb> mDb;
+		std::string mPath;
+		std::string mName;
+		RsFileHash mHash;
+	};
+
+	static ExtractionPool& instance()
+	{
+		static ExtractionPool pool;
+		return pool;
+	}
+
+	/// @return false if the queue is full, the caller should run the job itself
+	bool submit(Job&& job)
+	{
+		RS_STACK_MUTEX(mJobsMtx);
+		if(mJobs.size() >= MAX_PENDING_EXTRACTIONS) return false;
+		mJobs.push_back(std::move(job));
+
+		/* Spawn workers lazily, only when the running ones are all busy */
+		if( mWorkers.size() < mMaxWorkers &&
+		        mJobs.size() > mWorkers.size() - mBusyWorkers )
+		{
+			mWorkers.emplace_back(new Worker(*this));
+			mWorkers.back()->start("deep files index");
+		}
+		return true;
+	}
+
+	/**
+	 * Drop the jobs still waiting for given file, a job already picked by a
+	 * worker is discarded by SharedXapianDb::pushIndexed() instead
+	 * @return number of jobs dropped
+	 */
+	size_t cancel( const std::shared_ptr<DeepSearch::SharedXapianDb>& db,
+	               const RsFileHash& hash )
+	{
+		RS_STACK_MUTEX(mJobsMtx);
+		const size_t before = mJobs.size();
+		mJobs.erase( std::remove_if( mJobs.begin(), mJobs.end(),
+		                             [&](const Job& job)
+		{ return job.mHash == hash && job.mDb == db; } ), mJobs.end() );
+		return before - mJobs.size();
+	}
+
+	~ExtractionPool()
+	{
+		for(auto& worker : mWorkers) worker->askForStop();
+		for(auto& worker : mWorkers) worker->fullstop();
+	}
+
+private:
+	class Worker: public RsQueueThread
+	{
+	public:
+		explicit Worker(ExtractionPool& pool) :
+		    RsQueueThread(1, 50, 2.0), mPool(pool) {}
+
+	protected:
+		bool workQueued() override
+		{
+			RsStackMutex stack(mPool.mJobsMtx);
+			return !mPool.mJobs.empty();
+		}
+
+		bool doWork() override { return mPool.runNextJob(); }
+
+	private:
+		ExtractionPool& mPool;
+	};
+
+	ExtractionPool() : mJobsMtx("DeepFilesIndex::ExtractionPool"),
+	    mMaxWorkers(1), mBusyWorkers(0)
+	{
+		mMaxWorkers = std::max( 1u, std::min( MAX_EXTRACTION_WORKERS,
+		                        RsThread::hardwareConcurrency() / 2 ) );
+	}
+
+	bool runNextJob()
+	{
+		Job job;
+		{
+			RS_STACK_MUTEX(mJobsMtx);
+			if(mJobs.empty()) return false;
+
+			job = std::move(mJobs.front());
+			mJobs.pop_front();
+			++mBusyWorkers;
+		}
+
+		extractAndIndex(job.mDb, job.mPath, job.mName, job.mHash);
+
+		RS_STACK_MUTEX(mJobsMtx);
+		--mBusyWorkers;
+		return true;
+	}
+
+	RsMutex mJobsMtx;
+	std::deque<Job> mJobs;
+	std::vector<std::unique_ptr<Worker> > mWorkers;
+	uint32_t mMaxWorkers;
+	uint32_t mBusyWorkers;
+};
+
 std::error_condition DeepFilesIndex::indexFile(
         const std::string& path, const std::string& name,
         const RsFileHash& hash )
+{
+	const std::string idTerm("Q" + hash.toStdString());
+
+	/* Files are rehashed, and so offered for indexing, way more often than
+	 * they change, avoid even looking into the database for those we already
+	 * indexed, checked or queued since startup. Claiming it now also avoids
+	 * queuing twice the same content shared under different paths. */
+	if(!mDb->beginIndexing(idTerm))
+	{
+		RS_DBG3("skipping already indexed file: ", hash, " ", name);
+		return std::error_condition();
+	}
+
+	if(!ExtractionPool::instance().submit({mDb, path, name, hash}))
+	{
+		RS_DBG2("Extraction queue full, indexing on caller thread: ", path);
+		extractAndIndex(mDb, path, name, hash);
+	}
+
+	return std::error_condition();
+}
+
+/*static*/ void DeepFilesIndex::extractAndIndex(
+        const std::shared_ptr<DeepSearch::SharedXapianDb>& db,
+        const std::string& path, const std::string& name,
+        const RsFileHash& hash )
 {
 	const std::string hashString = hash.toStdString();
 	const std::string idTerm("Q" + hashString);
 
-	auto db = DeepSearch::openReadOnlyDatabase(mDbPath);
-	if(db)
+	/* The file may have been removed while waiting for extraction */
+	if(!db->isKnownIndexed(idTerm))
 	{
-		Xapian::Document oldDoc;
-		Xapian::PostingIterator pIt = db->postlist_begin(idTerm);
-		if( pIt != db->postlist_end(idTerm) )
-		{
-			oldDoc = db->get_document(*pIt);
-			if( oldDoc.get_value(INDEXER_VERSION_VALUENO) ==
-			        RS_HUMAN_READABLE_VERSION &&
-			    std::stoull(oldDoc.get_value(INDEXERS_COUNT_VALUENO)) ==
-			        indexersRegister.size() )
-			{
-				/* Looks like this file has already been indexed by this
-				 * RetroShare exact version, so we can skip it. If the version
-				 * was different it made sense to reindex it as better indexers
-				 * might be available since last time it was indexed */
-				RS_DBG3("skipping laready indexed file: ", hash, " ", name);
-				return std::error_condition();
-			}
-		}
-		db.reset(); // Release DB read lock ASAP
+		RS_DBG2("file removed before being indexed: ", hash, " ", name);
+		return;
+	}
+
+	bool upToDate = false;
+	db->read([&](Xapian::Database& rDb)
+	{
+		Xapian::PostingIterator pIt = rDb.postlist_begin(idTerm);
+		if(pIt == rDb.postlist_end(idTerm)) return;
+
+		Xapian::Document oldDoc = rDb.get_document(*pIt);
+		upToDate = oldDoc.get_value(INDEXER_VERSION_VALUENO) ==
+		        RS_HUMAN_READABLE_VERSION &&
+		        std::stoull(oldDoc.get_value(INDEXERS_COUNT_VALUENO)) ==
+		        indexersRegister.size();
+	});
+
+	if(upToDate)
+	{
+		/* Looks like this file has already been indexed by this RetroShare
+		 * exact version, so we can skip it. If the version was different it
+		 * made sense to reindex it as better indexers might be available since
+		 * last time it was indexed */
+		RS_DBG3("skipping already indexed file: ", hash, " ", name);
+		db->setKnownIndexed(idTerm);
+		return;
 	}
 
 	Xapian::Document doc;
@@ -81,18 +235,20 @@ std::error_condition DeepFilesIndex::indexFile(
 	            INDEXERS_COUNT_VALUENO,
 	            std::to_string(indexersRegister.size()) );
 
-	mWriteQueue.push([idTerm, doc](Xapian::WritableDatabase& db)
-	{ db.replace_document(idTerm, doc); });
-
-	return std::error_condition();
+	if(!db->pushIndexed( idTerm, [idTerm, doc](Xapian::WritableDatabase& wDb)
+	{ wDb.replace_document(idTerm, doc); } ))
+		RS_DBG2("file removed while being indexed: ", hash, " ", name);
 }
 
 std::error_condition DeepFilesIndex::removeFileFromIndex(const RsFileHash& hash)
 {
 	RS_DBG3(hash);
 
-	mWriteQueue.push([hash](Xapian::WritableDatabase& db)
-	{ db.delete_document("Q" + hash.toStdString()); });
+	const std::string idTerm("Q" + hash.toStdString());
+	ExtractionPool::instance().cancel(mDb, hash);
+	mDb->setKnownIndexed(idTerm, false);
+	mDb->push([idTerm](Xapian::WritableDatabase& db)
+	{ db.delete_document(idTerm); });
 
 	return std::error_condition();
 }
@@ -113,44 +269,41 @@ std::error_condition DeepFilesIndex::search(
         const std::string& queryStr,
         std::vector<DeepFilesSearchResult>& results, uint32_t maxResults )
 {
-	results.clear();
-
-	auto dbPtr = DeepSearch::openReadOnlyDatabase(mDbPath);
-	if(!dbPtr) return std::errc::bad_file_descriptor;
-	Xapian::Database& db(*dbPtr);
+	return mDb->read([&](Xapian::Database& db)
+	{
+		results.clear();
 
-	// Set up a QueryParser with a stemmer and suitable prefixes.
-	Xapian::QueryParser queryparser;
-	//queryparser.set_stemmer(Xapian::Stem("en"));
-	queryparser.set_stemming_strategy(queryparser.STEM_SOME);
-	// Start of prefix configuration.
-	//queryparser.add_prefix("title", "S");
-	//queryparser.add_prefix("description", "XD");
-	// End of prefix configuration.
+		// Set up a QueryParser with a stemmer and suitable prefixes.
+		Xapian::QueryParser queryparser;
+		//queryparser.set_stemmer(Xapian::Stem("en"));
+		queryparser.set_stemming_strategy(queryparser.STEM_SOME);
+		// Start of prefix configuration.
+		//queryparser.add_prefix("title", "S");
+		//queryparser.add_prefix("description", "XD");
+		// End of prefix configuration.
 
-	// And parse the query.
-	Xapian::Query query = queryparser.parse_query(queryStr);
+		// And parse the query.
+		Xapian::Query query = queryparser.parse_query(queryStr);
 
-	// Use an Enquire object on the database to run the query.
-	Xapian::Enquire enquire(db);
-	enquire.set_query(query);
+		// Use an Enquire object on the database to run the query.
+		Xapian::Enquire enquire(db);
+		enquire.set_query(query);
 
-	Xapian::MSet mset = enquire.get_mset(
-	            0, maxResults ? maxResults : db.get_doccount() );
+		Xapian::MSet mset = enquire.get_mset(
+		            0, maxResults ? maxResults : db.get_doccount() );
 
-	for ( Xapian::MSetIterator m = mset.begin(); m != mset.end(); ++m )
-	{
-		const Xapian::Document& doc = m.get_document();
-		DeepFilesSearchResult s;
-		s.mFileHash = RsFileHash(doc.get_value(FILE_HASH_VALUENO));
-		s.mWeight = m.get_weight();
+		for ( Xapian::MSetIterator m = mset.begin(); m != mset.end(); ++m )
+		{
+			const Xapian::Document& doc = m.get_document();
+			DeepFilesSearchResult s;
+			s.mFileHash = RsFileHash(doc.get_value(FILE_HASH_VALUENO));
+			s.mWeight = m.get_weight();
 #if XAPIAN_AT_LEAST(1,3,5)
-		s.mSnippet = mset.snippet(doc.get_data());
+			s.mSnippet = mset.snippet(doc.get_data());
 #endif // XAPIAN_AT_LEAST(1,3,5)
-		results.push_back(s);
-	}
-
-	return std::error_condition();
+			results.push_back(s);
+		}
+	});
 }
 
 
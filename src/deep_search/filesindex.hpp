@@ -42,7 +42,7 @@ class DeepFilesIndex
 {
 public:
 	explicit DeepFilesIndex(const std::string& dbPath):
-	    mDbPath(dbPath), mWriteQueue(dbPath) {}
+	    mDbPath(dbPath), mDb(DeepSearch::SharedXapianDb::forPath(dbPath)) {}
 
 	/**
 	 * @brief Search indexed files
@@ -55,15 +55,17 @@ public:
 	                 uint32_t maxResults = 100 );
 
 	/**
-	 * @return false if file could not be indexed because of error or
-	 *	unsupported type, true otherwise.
+	 * @brief Queue file for indexing, tags extraction and database update are
+	 *	done asynchronously by a pool of worker threads
+	 * @return error if the file could not be queued, success otherwise.
 	 */
 	std::error_condition indexFile(
 	        const std::string& path, const std::string& name,
 	        const RsFileHash& hash );
 
 	/**
-	 * @brief Remove file entry from database
+	 * @brief Remove file entry from database, a pending tags extraction for
+	 *	the file is cancelled
 	 * @return false on error, true otherwise.
 	 */
 	std::error_condition removeFileFromIndex(const RsFileHash& hash);
@@ -77,7 +79,22 @@ public:
 	static bool registerIndexer(
 	        int order, const IndexerFunType& indexerFun );
 
+	/// Maximum number of threads extracting tags concurrently
+	static constexpr uint32_t MAX_EXTRACTION_WORKERS = 4;
+
+	/** Maximum number of files waiting for extraction, when exceeded files are
+	 * indexed on the caller thread so the queue cannot grow unbounded */
+	static constexpr size_t MAX_PENDING_EXTRACTIONS = 4096;
+
 private:
+	/// Run the indexers on a file and push the resulting document
+	static void extractAndIndex(
+	        const std::shared_ptr<DeepSearch::SharedXapianDb>& db,
+	        const std::string& path, const std::string& name,
+	        const RsFileHash& hash );
+
+	struct ExtractionPool;
+
 	enum : Xapian::valueno
 	{
 		/// Used to store RsFileHash of indexed documents
@@ -97,7 +114,7 @@ private:
 
 	const std::string mDbPath;
 
-	DeepSearch::StubbornWriteOpQueue mWriteQueue;
+	std::shared_ptr<DeepSearch::SharedXapianDb> mDb;
 
 	/** Storage for indexers function by order */
 	static std::multimap<int, IndexerFunType> indexersRegister;
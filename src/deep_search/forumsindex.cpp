@@ -28,47 +28,42 @@ std::error_condition DeepForumsIndex::search(
         const std::string& queryStr,
         std::vector<DeepForumsSearchResult>& results, uint32_t maxResults )
 {
-	results.clear();
-
-	std::unique_ptr<Xapian::Database> dbPtr(
-	            DeepSearch::openReadOnlyDatabase(mDbPath) );
-	if(!dbPtr) return std::errc::bad_file_descriptor;
-
-	Xapian::Database& db(*dbPtr);
-
-	// Set up a QueryParser with a stemmer and suitable prefixes.
-	Xapian::QueryParser queryparser;
-	//queryparser.set_stemmer(Xapian::Stem("en"));
-	queryparser.set_stemming_strategy(queryparser.STEM_SOME);
-	// Start of prefix configuration.
-	//queryparser.add_prefix("title", "S");
-	//queryparser.add_prefix("description", "XD");
-	// End of prefix configuration.
-
-	// And parse the query.
-	using XQP = Xapian::QueryParser;
-	Xapian::Query query = queryparser.parse_query(
-	            queryStr, XQP::FLAG_WILDCARD | XQP::FLAG_DEFAULT );
-
-	// Use an Enquire object on the database to run the query.
-	Xapian::Enquire enquire(db);
-	enquire.set_query(query);
-
-	Xapian::MSet mset = enquire.get_mset(
-	            0, maxResults ? maxResults : db.get_doccount() );
-
-	for( Xapian::MSetIterator m = mset.begin(); m != mset.end(); ++m )
+	return mDb->read([&](Xapian::Database& db)
 	{
-		const Xapian::Document& doc = m.get_document();
-		DeepForumsSearchResult s;
-		s.mUrl = doc.get_value(URL_VALUENO);
+		results.clear();
+
+		// Set up a QueryParser with a stemmer and suitable prefixes.
+		Xapian::QueryParser queryparser;
+		//queryparser.set_stemmer(Xapian::Stem("en"));
+		queryparser.set_stemming_strategy(queryparser.STEM_SOME);
+		// Start of prefix configuration.
+		//queryparser.add_prefix("title", "S");
+		//queryparser.add_prefix("description", "XD");
+		// End of prefix configuration.
+
+		// And parse the query.
+		using XQP = Xapian::QueryParser;
+		Xapian::Query query = queryparser.parse_query(
+		            queryStr, XQP::FLAG_WILDCARD | XQP::FLAG_DEFAULT );
+
+		// Use an Enquire object on the database to run the query.
+		Xapian::Enquire enquire(db);
+		enquire.set_query(query);
+
+		Xapian::MSet mset = enquire.get_mset(
+		            0, maxResults ? maxResults : db.get_doccount() );
+
+		for( Xapian::MSetIterator m = mset.begin(); m != mset.end(); ++m )
+		{
+			const Xapian::Document& doc = m.get_document();
+			DeepForumsSearchResult s;
+			s.mUrl = doc.get_value(URL_VALUENO);
 #if XAPIAN_AT_LEAST(1,3,5)
-		s.mSnippet = mset.snippet(doc.get_data());
+			s.mSnippet = mset.snippet(doc.get_data());
 #endif // XAPIAN_AT_LEAST(1,3,5)
-		results.push_back(s);
-	}
-
-	return std::error_condition();
+			results.push_back(s);
+		}
+	});
 }
 
 /*static*/ std::string DeepForumsIndex::forumIndexId(const RsGxsGroupId& grpId)
@@ -124,7 +119,7 @@ std::error_condition DeepForumsIndex::indexForumGroup(
 	const std::string idTerm("Q" + rsLink);
 	doc.add_boolean_term(idTerm);
 
-	mWriteQueue.push([idTerm, doc](Xapian::WritableDatabase& db)
+	mDb->push([idTerm, doc](Xapian::WritableDatabase& db)
 	{ db.replace_document(idTerm, doc); } );
 
 	return std::error_condition();
@@ -133,7 +128,7 @@ std::error_condition DeepForumsIndex::indexForumGroup(
 std::error_condition DeepForumsIndex::removeForumFromIndex(
         const RsGxsGroupId& grpId )
 {
-	mWriteQueue.push([grpId](Xapian::WritableDatabase& db)
+	mDb->push([grpId](Xapian::WritableDatabase& db)
 	{ db.delete_document("Q" + forumIndexId(grpId)); });
 
 	return std::error_condition();
@@ -188,7 +183,7 @@ std::error_condition DeepForumsIndex::indexForumPost(const RsGxsForumMsg& post)
 	const std::string idTerm("Q" + rsLink);
 	doc.add_boolean_term(idTerm);
 
-	mWriteQueue.push( [idTerm, doc](Xapian::WritableDatabase& db)
+	mDb->push( [idTerm, doc](Xapian::WritableDatabase& db)
 	{ db.replace_document(idTerm, doc); } );
 
 
@@ -200,7 +195,7 @@ std::error_condition DeepForumsIndex::removeForumPostFromIndex(
 {
 	// "Q" prefix is a Xapian convention for unique id term.
 	std::string idTerm("Q" + postIndexId(grpId, msgId));
-	mWriteQueue.push( [idTerm](Xapian::WritableDatabase& db)
+	mDb->push( [idTerm](Xapian::WritableDatabase& db)
 	{ db.delete_document(idTerm); } );
 
 	return std::error_condition();
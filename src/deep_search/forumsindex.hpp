@@ -38,7 +38,7 @@ struct DeepForumsSearchResult
 struct DeepForumsIndex
 {
 	explicit DeepForumsIndex(const std::string& dbPath) :
-	    mDbPath(dbPath), mWriteQueue(dbPath) {}
+	    mDbPath(dbPath), mDb(DeepSearch::SharedXapianDb::forPath(dbPath)) {}
 
 	/**
 	 * @brief Search indexed GXS groups and messages
@@ -77,5 +77,5 @@ private:
 
 	const std::string mDbPath;
 
-	DeepSearch::StubbornWriteOpQueue mWriteQueue;
+	std::shared_ptr<DeepSearch::SharedXapianDb> mDb;
 };
@@ -30,6 +30,7 @@
 #include "retroshare/rsexpr.h"
 #include "dir_hierarchy.h"
 #include "filelist_io.h"
+#include "file_list_image.h"
 #include "file_sharing_defaults.h"
 #include "util/cxx17retrocompat.h"
 
@@ -67,10 +68,11 @@ InternalFileHierarchyStorage::InternalFileHierarchyStorage() : mRoot(0)
     de->dir_hash=RsFileHash() ; // null hash is root by convention.
 
     mNodes.push_back(de) ;
-    mDirHashes[de->dir_hash] = 0 ;
+    mDirHashes.set(de->dir_hash,0) ;
 
     mTotalSize = 0 ;
     mTotalFiles = 0 ;
+    mLoadedLegacyFormat = false ;
 }
 
 bool InternalFileHierarchyStorage::getDirHashFromIndex(
@@ -86,13 +88,9 @@ bool InternalFileHierarchyStorage::getDirHashFromIndex(
 
 bool InternalFileHierarchyStorage::getIndexFromDirHash(const RsFileHash& hash,DirectoryStorage::EntryIndex& index)
 {
-    std::map<RsFileHash,DirectoryStorage::EntryIndex>::iterator it = mDirHashes.find(hash) ;
-
-    if(it == mDirHashes.end())
+    if(!mDirHashes.find(hash,index))
         return false;
 
-    index = it->second;
-
 	/* make sure the hash actually points to some existing directory. If not,
 	 * remove it. This is an opportunistic update of dir hashes: when we need
 	 * them, we check them. */
@@ -100,7 +98,7 @@ bool InternalFileHierarchyStorage::getIndexFromDirHash(const RsFileHash& hash,Di
 	        static_cast<DirEntry*>(mNodes[index])->dir_hash != hash )
 	{
 		RS_INFO("removing non existing dir hash: ", hash, " from dir hash list");
-		mDirHashes.erase(it);
+		mDirHashes.erase(hash);
 		return false;
 	}
     return true;
@@ -109,19 +107,16 @@ bool InternalFileHierarchyStorage::getIndexFromDirHash(const RsFileHash& hash,Di
 bool InternalFileHierarchyStorage::getIndexFromFileHash(
         const RsFileHash& hash, DirectoryStorage::EntryIndex& index )
 {
-	auto it = std::as_const(mFileHashes).find(hash);
-	if(it == mFileHashes.end()) return false;
-
-	index = it->second;
+	if(!mFileHashes.find(hash,index)) return false;
 
 	/* make sure the hash actually points to some existing file. If not, remove
 	 * it. This is an opportunistic update of file hashes: when we need them,
 	 * we check them. */
-	if( !checkIndex(it->second, FileStorageNode::TYPE_FILE) ||
+	if( !checkIndex(index, FileStorageNode::TYPE_FILE) ||
 	        static_cast<FileEntry*>(mNodes[index])->file_hash != hash )
 	{
 		RS_INFO("removing non existing file hash: ", hash, " from file hash list");
-		mFileHashes.erase(it);
+		mFileHashes.erase(hash);
 		return false;
 	}
 
@@ -210,7 +205,7 @@ bool InternalFileHierarchyStorage::updateSubDirectoryList(
 		de->dir_parent_path = RsDirUtil::makePath(d.dir_parent_path, d.dir_name) ;
         de->dir_hash = createDirHash(de->dir_name,d.dir_hash,random_hash_seed) ;
 
-        mDirHashes[de->dir_hash] = mNodes.size() ;
+        mDirHashes.set(de->dir_hash,mNodes.size()) ;
 
         d.subdirs.push_back(mNodes.size()) ;
         mNodes.push_back(de) ;
@@ -378,7 +373,7 @@ bool InternalFileHierarchyStorage::updateHash(
 #endif
 
     RsFileHash& old_hash (static_cast<FileEntry*>(mNodes[file_index])->file_hash) ;
-    mFileHashes[hash] = file_index ;
+    mFileHashes.set(hash,file_index) ;
 
     old_hash = hash ;
 
@@ -408,7 +403,7 @@ bool InternalFileHierarchyStorage::updateFile(const DirectoryStorage::EntryIndex
     fe.file_name = fname;
 
     if(!hash.isNull())
-        mFileHashes[hash] = file_index ;
+        mFileHashes.set(hash,file_index) ;
 
     return true;
 }
@@ -522,7 +517,7 @@ bool InternalFileHierarchyStorage::updateDirEntry(
 			de->dir_parent_path = RsDirUtil::makePath(d.dir_parent_path, dir_name) ;
             de->dir_hash        = subdirs_hash[i];
 
-            mDirHashes[subdirs_hash[i]] = dir_index ;
+            mDirHashes.set(subdirs_hash[i],dir_index) ;
 
 #ifdef DEBUG_DIRECTORY_STORAGE
             std::cerr << " created, at new index " << dir_index << std::endl;
@@ -530,7 +525,7 @@ bool InternalFileHierarchyStorage::updateDirEntry(
         }
 
         d.subdirs.push_back(dir_index) ;
-        mDirHashes[subdirs_hash[i]] = dir_index ;
+        mDirHashes.set(subdirs_hash[i],dir_index) ;
     }
     // remove subdirs that do not exist anymore
 
@@ -585,7 +580,7 @@ bool InternalFileHierarchyStorage::updateDirEntry(
             file_index = allocateNewIndex() ;
 
             mNodes[file_index] = new FileEntry(f.file_name,f.file_size,f.file_modtime,f.file_hash) ;
-            mFileHashes[f.file_hash] = file_index ;
+            mFileHashes.set(f.file_hash,file_index) ;
             mTotalSize += f.file_size ;
             mTotalFiles++;
 
@@ -612,6 +607,11 @@ bool InternalFileHierarchyStorage::updateDirEntry(
         deleteFileNode(it->second) ;
     }
 
+    // remote directories are updated in one go, so the child lists do not need spare capacity.
+
+    d.subdirs.shrink_to_fit() ;
+    d.subfiles.shrink_to_fit() ;
+
     // now update row and parent index for all subnodes
 
     uint32_t n=0;
@@ -805,14 +805,16 @@ int InternalFileHierarchyStorage::searchBoolExp(
         RsRegularExpression::Expression* exp,
         std::list<DirectoryStorage::EntryIndex>& results ) const
 {
-	for(auto& it: std::as_const(mFileHashes))
-		if(mNodes[it.second])
+	mFileHashes.forEach([&](const RsFileHash&, DirectoryStorage::EntryIndex e)
+	{
+		if(mNodes[e])
 			if(exp->eval(
 			            DirectoryStorageExprFileEntry(
-			                *static_cast<const FileEntry*>(mNodes[it.second]),
-			                *static_cast<const DirEntry*>(mNodes[mNodes[it.second]->parent_index])
+			                *static_cast<const FileEntry*>(mNodes[e]),
+			                *static_cast<const DirEntry*>(mNodes[mNodes[e]->parent_index])
 			                                      ) ))
-			results.push_back(it.second);
+			results.push_back(e);
+	});
 
     return 0;
 }
@@ -824,13 +826,13 @@ int InternalFileHierarchyStorage::searchTerms(
 	/* most entries are likely to be files, so we could do a linear search over
 	 * the entries tab. Instead we go through the table of hashes.*/
 
-	for(auto& it : std::as_const(mFileHashes))
+	mFileHashes.forEach([&](const RsFileHash&, DirectoryStorage::EntryIndex e)
 	{
 		// node may be null for some hash waiting to be deleted
-		if(mNodes[it.second])
+		if(mNodes[e])
 		{
 			rs_view_ptr<FileEntry> tFileEntry =
-			        static_cast<FileEntry*>(mNodes[it.second]);
+			        static_cast<FileEntry*>(mNodes[e]);
 
 			/* Most file will just have file name stored, but single file shared
 			 * without a shared dir will contain full path instead of just the
@@ -851,12 +853,12 @@ int InternalFileHierarchyStorage::searchTerms(
 				            termIt.begin(), termIt.end(),
 				            RsRegularExpression::CompareCharIC() ))
 				{
-					results.push_back(it.second);
+					results.push_back(e);
 					break;
 				}
 			}
 		}
-	}
+	});
 	return 0;
 }
 
@@ -974,12 +976,10 @@ void InternalFileHierarchyStorage::print() const
     recursPrint(0,DirectoryStorage::EntryIndex(0));
 
     std::cerr << "Known dir hashes: " << std::endl;
-    for(std::map<RsFileHash,DirectoryStorage::EntryIndex>::const_iterator  it(mDirHashes.begin());it!=mDirHashes.end();++it)
-        std::cerr << "  " << it->first << " at index " << it->second << std::endl;
+    mDirHashes.forEach([](const RsFileHash& hash,DirectoryStorage::EntryIndex e) { std::cerr << "  " << hash << " at index " << e << std::endl; });
 
     std::cerr << "Known file hashes: " << std::endl;
-    for(std::map<RsFileHash,DirectoryStorage::EntryIndex>::const_iterator  it(mFileHashes.begin());it!=mFileHashes.end();++it)
-        std::cerr << "  " << it->first << " at index " << it->second << std::endl;
+    mFileHashes.forEach([](const RsFileHash& hash,DirectoryStorage::EntryIndex e) { std::cerr << "  " << hash << " at index " << e << std::endl; });
 }
 void InternalFileHierarchyStorage::recursPrint(int depth,DirectoryStorage::EntryIndex node) const
 {
@@ -1041,112 +1041,185 @@ bool InternalFileHierarchyStorage::save(const std::string& fname)
 {
     unsigned char *buffer = NULL ;
     uint32_t buffer_size = 0 ;
-    uint32_t buffer_offset = 0 ;
 
-    unsigned char *tmp_section_data = (unsigned char*)rs_malloc(FL_BASE_TMP_SECTION_SIZE) ;
+    if(!save(buffer,buffer_size))
+        return false ;
+
+    bool res = FileListIO::saveEncryptedDataToFile(fname,buffer,buffer_size) ;
 
-    if(!tmp_section_data)
-        return false;
+    free(buffer) ;
+    return res ;
+}
 
-    uint32_t tmp_section_size = FL_BASE_TMP_SECTION_SIZE ;
+bool InternalFileHierarchyStorage::save(unsigned char *& buffer,uint32_t& buffer_size) const
+{
+    FileListImageWriter writer ;
 
-    try
+    for(uint32_t i=0;i<mNodes.size();++i)
+        if(mNodes[i] != NULL && mNodes[i]->type() == FileStorageNode::TYPE_FILE)
+        {
+            const FileEntry& fe(*static_cast<const FileEntry*>(mNodes[i])) ;
+
+            writer.addFile(i,fe.parent_index,fe.row,fe.file_name,fe.file_size,fe.file_hash,fe.file_modtime) ;
+        }
+        else if(mNodes[i] != NULL && mNodes[i]->type() == FileStorageNode::TYPE_DIR)
+        {
+            const DirEntry& de(*static_cast<const DirEntry*>(mNodes[i])) ;
+
+            writer.addDir(i,de.parent_index,de.row,de.dir_name,de.dir_parent_path,de.dir_hash,
+                          de.dir_modtime,de.dir_update_time,de.dir_most_recent_time,de.subdirs,de.subfiles) ;
+        }
+
+    if(!writer.finish(mNodes.size(),buffer,buffer_size))
     {
-        // Write some header
+        std::cerr << "Error while writing file hierarchy image." << std::endl;
+        return false ;
+    }
+    return true ;
+}
 
-        if(!FileListIO::writeField(buffer,buffer_size,buffer_offset,FILE_LIST_IO_TAG_LOCAL_DIRECTORY_VERSION,(uint32_t) FILE_LIST_IO_LOCAL_DIRECTORY_STORAGE_VERSION_0001)) throw std::runtime_error("Write error") ;
-        if(!FileListIO::writeField(buffer,buffer_size,buffer_offset,FILE_LIST_IO_TAG_RAW_NUMBER,(uint32_t) mNodes.size())) throw std::runtime_error("Write error") ;
+bool InternalFileHierarchyStorage::load(const std::string& fname)
+{
+    unsigned char *buffer = NULL ;
+    uint32_t buffer_size = 0 ;
 
-        // Write all file/dir entries
+    if(!FileListIO::loadEncryptedDataFromFile(fname,buffer,buffer_size) )
+        return false ;
 
-        for(uint32_t i=0;i<mNodes.size();++i)
-            if(mNodes[i] != NULL && mNodes[i]->type() == FileStorageNode::TYPE_FILE)
-            {
-                const FileEntry& fe(*static_cast<const FileEntry*>(mNodes[i])) ;
+    bool res = load(buffer,buffer_size) ;
 
-                uint32_t file_section_offset = 0 ;
+    if(!res)
+        std::cerr << "(EE) Cannot read file hierarchy " << fname << std::endl;
 
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,file_section_offset,FILE_LIST_IO_TAG_PARENT_INDEX  ,(uint32_t)fe.parent_index)) throw std::runtime_error("Write error") ;
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,file_section_offset,FILE_LIST_IO_TAG_ROW           ,(uint32_t)fe.row         )) throw std::runtime_error("Write error") ;
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,file_section_offset,FILE_LIST_IO_TAG_ENTRY_INDEX   ,(uint32_t)i              )) throw std::runtime_error("Write error") ;
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,file_section_offset,FILE_LIST_IO_TAG_FILE_NAME     ,fe.file_name             )) throw std::runtime_error("Write error") ;
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,file_section_offset,FILE_LIST_IO_TAG_FILE_SIZE     ,fe.file_size             )) throw std::runtime_error("Write error") ;
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,file_section_offset,FILE_LIST_IO_TAG_FILE_SHA1_HASH,fe.file_hash             )) throw std::runtime_error("Write error") ;
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,file_section_offset,FILE_LIST_IO_TAG_MODIF_TS      ,(uint32_t)fe.file_modtime)) throw std::runtime_error("Write error") ;
+    free(buffer) ;
+    return res ;
+}
 
-                if(!FileListIO::writeField(buffer,buffer_size,buffer_offset,FILE_LIST_IO_TAG_LOCAL_FILE_ENTRY,tmp_section_data,file_section_offset)) throw std::runtime_error("Write error") ;
-            }
-            else if(mNodes[i] != NULL && mNodes[i]->type() == FileStorageNode::TYPE_DIR)
-            {
-                const DirEntry& de(*static_cast<const DirEntry*>(mNodes[i])) ;
+bool InternalFileHierarchyStorage::load(const unsigned char *buffer,uint32_t buffer_size)
+{
+    mFreeNodes.clear();
+    mTotalFiles = 0;
+    mTotalSize = 0;
 
-                uint32_t dir_section_offset = 0 ;
+    bool res ;
 
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_PARENT_INDEX   ,(uint32_t)de.parent_index      )) throw std::runtime_error("Write error") ;
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_ROW            ,(uint32_t)de.row               )) throw std::runtime_error("Write error") ;
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_ENTRY_INDEX    ,(uint32_t)i                    )) throw std::runtime_error("Write error") ;
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_FILE_NAME      ,de.dir_name                    )) throw std::runtime_error("Write error") ;
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_DIR_HASH       ,de.dir_hash                    )) throw std::runtime_error("Write error") ;
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_FILE_SIZE      ,de.dir_parent_path             )) throw std::runtime_error("Write error") ;
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_MODIF_TS       ,(uint32_t)de.dir_modtime       )) throw std::runtime_error("Write error") ;
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_UPDATE_TS      ,(uint32_t)de.dir_update_time   )) throw std::runtime_error("Write error") ;
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_RECURS_MODIF_TS,(uint32_t)de.dir_most_recent_time  )) throw std::runtime_error("Write error") ;
+    if(FileListImage::isImage(buffer,buffer_size))
+    {
+        res = loadImage(buffer,buffer_size) ;
+        mLoadedLegacyFormat = false ;
+    }
+    else
+    {
+        res = loadLegacy(buffer,buffer_size) ;
+        mLoadedLegacyFormat = res ;
+    }
 
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_RAW_NUMBER,(uint32_t)de.subdirs.size())) throw std::runtime_error("Write error") ;
+    if(!res)
+        return false ;
 
-                for(uint32_t j=0;j<de.subdirs.size();++j)
-                    if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_RAW_NUMBER,(uint32_t)de.subdirs[j])) throw std::runtime_error("Write error") ;
+    std::string err_str ;
 
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_RAW_NUMBER,(uint32_t)de.subfiles.size())) throw std::runtime_error("Write error") ;
+    if(!check(err_str))
+        std::cerr << "(EE) Error while loading file hierarchy: " << err_str << std::endl;
 
-                for(uint32_t j=0;j<de.subfiles.size();++j)
-                    if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_RAW_NUMBER,(uint32_t)de.subfiles[j])) throw std::runtime_error("Write error") ;
+    recursUpdateCumulatedSize(mRoot);
 
-                if(!FileListIO::writeField(buffer,buffer_size,buffer_offset,FILE_LIST_IO_TAG_LOCAL_DIR_ENTRY,tmp_section_data,dir_section_offset)) throw std::runtime_error("Write error") ;
-            }
+    return true ;
+}
+
+bool InternalFileHierarchyStorage::loadImage(const unsigned char *buffer,uint32_t buffer_size)
+{
+    FileListImage image ;
 
-        bool res = FileListIO::saveEncryptedDataToFile(fname,buffer,buffer_offset) ;
+    if(!image.load(buffer,buffer_size))
+        return false ;
 
-        free(buffer) ;
-        free(tmp_section_data) ;
+    for(uint32_t i=0;i<mNodes.size();++i)
+        if(mNodes[i])
+            delete mNodes[i] ;
 
-        return res ;
-    }
-    catch(std::exception& e)
+    mNodes.clear();
+    mNodes.resize(image.nbNodes(),NULL) ;
+    mFileHashes.clear();
+    mDirHashes.clear();
+
+    std::vector<std::pair<RsFileHash,DirectoryStorage::EntryIndex> > file_hashes ;
+    std::vector<std::pair<RsFileHash,DirectoryStorage::EntryIndex> > dir_hashes ;
+
+    for(uint32_t i=0;i<image.nbNodes();++i)
     {
-        std::cerr << "Error while writing: " << e.what() << std::endl;
+        const FileListImage::NodeRecord& rec(*image.node(i)) ;
+        std::string name ;
+
+        if(rec.type == FileListImage::NODE_EMPTY)
+            continue ;
 
-        if(buffer != NULL)
-            free(buffer) ;
+        if(!image.getName(rec,name))
+            return false ;
 
-        if(tmp_section_data != NULL)
-			free(tmp_section_data) ;
+        if(rec.type == FileListImage::NODE_FILE)
+        {
+            FileEntry *fe = new FileEntry(name,rec.file_size,rec.modtime,FileListImage::hash(rec));
 
-        return false;
+            fe->parent_index = rec.parent_index ;
+            fe->row = rec.row ;
+
+            mNodes[i] = fe ;
+            file_hashes.push_back(std::make_pair(fe->file_hash,i)) ;
+
+            mTotalFiles++ ;
+            mTotalSize += rec.file_size ;
+        }
+        else if(rec.type == FileListImage::NODE_DIR)
+        {
+            const uint32_t *subdirs, *subfiles ;
+
+            if(!image.getChildren(rec,subdirs,subfiles))
+                return false ;
+
+            DirEntry *de = new DirEntry(name) ;
+
+            if(!image.getParentPath(rec,de->dir_parent_path))
+            {
+                delete de ;
+                return false ;
+            }
+            de->dir_hash         = FileListImage::hash(rec) ;
+            de->dir_modtime      = rec.modtime ;
+            de->dir_update_time  = rec.update_time ;
+            de->dir_most_recent_time = rec.most_recent_time ;
+
+            de->parent_index = rec.parent_index ;
+            de->row = rec.row ;
+
+            de->subdirs.assign(subdirs,subdirs + rec.nb_subdirs) ;
+            de->subfiles.assign(subfiles,subfiles + rec.nb_subfiles) ;
+
+            mNodes[i] = de ;
+            dir_hashes.push_back(std::make_pair(de->dir_hash,i)) ;
+        }
+        else
+            return false ;
     }
+
+    mFileHashes.assign(file_hashes) ;
+    mDirHashes.assign(dir_hashes) ;
+
+    return true ;
 }
 
-bool InternalFileHierarchyStorage::load(const std::string& fname)
+bool InternalFileHierarchyStorage::loadLegacy(const unsigned char *buffer,uint32_t buffer_size)
 {
-    unsigned char *buffer = NULL ;
-    uint32_t buffer_size = 0 ;
     uint32_t buffer_offset = 0 ;
 
-    mFreeNodes.clear();
-    mTotalFiles = 0;
-    mTotalSize = 0;
-
     try
     {
-        if(!FileListIO::loadEncryptedDataFromFile(fname,buffer,buffer_size) )
-            throw read_error("Cannot decrypt") ;
-
         // Read some header
 
         uint32_t version, n_nodes ;
 
         if(!FileListIO::readField(buffer,buffer_size,buffer_offset,FILE_LIST_IO_TAG_LOCAL_DIRECTORY_VERSION,version)) throw read_error(buffer,buffer_size,buffer_offset,FILE_LIST_IO_TAG_LOCAL_DIRECTORY_VERSION) ;
-        if(version != (uint32_t) FILE_LIST_IO_LOCAL_DIRECTORY_STORAGE_VERSION_0001) throw std::runtime_error("Wrong version number") ;
+        if(version != (uint32_t) FILE_LIST_IO_LOCAL_DIRECTORY_STORAGE_VERSION_0001) throw read_error("Wrong version number") ;
 
         if(!FileListIO::readField(buffer,buffer_size,buffer_offset,FILE_LIST_IO_TAG_RAW_NUMBER,n_nodes)) throw read_error(buffer,buffer_size,buffer_offset,FILE_LIST_IO_TAG_RAW_NUMBER) ;
 
@@ -1195,7 +1268,7 @@ bool InternalFileHierarchyStorage::load(const std::string& fname)
                 fe->row = row ;
 
                 mNodes[node_index] = fe ;
-                mFileHashes[fe->file_hash] = node_index ;
+                mFileHashes.set(fe->file_hash,node_index) ;
 
                 mTotalFiles++ ;
                 mTotalSize += file_size ;
@@ -1241,6 +1314,8 @@ bool InternalFileHierarchyStorage::load(const std::string& fname)
 
                 if(!FileListIO::readField(node_section_data,node_section_size,node_section_offset,FILE_LIST_IO_TAG_RAW_NUMBER,n_subdirs)) throw read_error(node_section_data,node_section_size,node_section_offset,FILE_LIST_IO_TAG_RAW_NUMBER) ;
 
+                de->subdirs.reserve(n_subdirs) ;
+
                 for(uint32_t j=0;j<n_subdirs;++j)
                 {
                     uint32_t di = 0 ;
@@ -1250,6 +1325,8 @@ bool InternalFileHierarchyStorage::load(const std::string& fname)
 
                 if(!FileListIO::readField(node_section_data,node_section_size,node_section_offset,FILE_LIST_IO_TAG_RAW_NUMBER,n_subfiles)) throw read_error(node_section_data,node_section_size,node_section_offset,FILE_LIST_IO_TAG_RAW_NUMBER) ;
 
+                de->subfiles.reserve(n_subfiles) ;
+
                 for(uint32_t j=0;j<n_subfiles;++j)
                 {
                     uint32_t fi = 0 ;
@@ -1257,22 +1334,13 @@ bool InternalFileHierarchyStorage::load(const std::string& fname)
                     de->subfiles.push_back(fi) ;
                 }
                 mNodes[node_index] = de ;
-                mDirHashes[de->dir_hash] = node_index ;
+                mDirHashes.set(de->dir_hash,node_index) ;
             }
             else
                 throw read_error(buffer,buffer_size,buffer_offset,FILE_LIST_IO_TAG_LOCAL_FILE_ENTRY) ;
 
             free(node_section_data) ;
         }
-        free(buffer) ;
-
-        std::string err_str ;
-
-        if(!check(err_str))
-            std::cerr << "(EE) Error while loading file hierarchy " << fname << std::endl;
-
-        recursUpdateCumulatedSize(mRoot);
-
         return true ;
     }
     catch(read_error& e)
@@ -1280,9 +1348,6 @@ bool InternalFileHierarchyStorage::load(const std::string& fname)
 #ifdef DEBUG_DIRECTORY_STORAGE
         std::cerr << "Error while reading: " << e.what() << std::endl;
 #endif
-
-        if(buffer != NULL)
-            free(buffer) ;
         return false;
     }
 }
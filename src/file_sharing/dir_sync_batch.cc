@@ -0,0 +1,248 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: dir_sync_batch.cc                           *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <algorithm>
+#include <string.h>
+#include <zlib.h>
+
+#include "file_sharing/filelist_io.h"
+#include "file_sharing/dir_sync_batch.h"
+#include "util/rsdebug.h"
+#include "util/rsmemory.h"
+
+// Compressed batches start with the size of the uncompressed data. The
+// receiver does not trust it: the output of inflate is checked against it
+// while decompressing.
+
+static const uint32_t DIR_SYNC_BATCH_HEADER_SIZE = 4 ;
+
+// Output buffer of the receiver is grown by this amount, so that a small batch
+// lying about its size does not cost the full allocation.
+static const uint32_t DIR_SYNC_BATCH_INFLATE_CHUNK = 64*1024 ;
+
+DirSyncBatchWriter::DirSyncBatchWriter(uint32_t max_size, uint32_t max_batch_size)
+    : mBuffer(NULL), mBufferSize(0), mOffset(0), mMaxSize(max_size), mMaxBatchSize(max_batch_size), mNbRecords(0)
+{
+}
+
+DirSyncBatchWriter::~DirSyncBatchWriter()
+{
+    free(mBuffer) ;
+}
+
+bool DirSyncBatchWriter::addUpToDate(const RsFileHash& dir_hash)
+{
+    uint32_t old_offset = mOffset ;
+
+    if(  !FileListIO::writeField(mBuffer,mBufferSize,mOffset,FILE_LIST_IO_TAG_DIR_HASH  ,dir_hash)
+      || !FileListIO::writeField(mBuffer,mBufferSize,mOffset,FILE_LIST_IO_TAG_RAW_NUMBER,(uint32_t)DirSyncBatchReader::RECORD_UP_TO_DATE)
+      || mOffset > mMaxBatchSize)
+    {
+        mOffset = old_offset ;
+        return false ;
+    }
+
+    ++mNbRecords ;
+    return true ;
+}
+
+bool DirSyncBatchWriter::addContent(const RsFileHash& dir_hash, const RsTlvBinaryData& dir_data)
+{
+    uint32_t old_offset = mOffset ;
+
+    if(  !FileListIO::writeField(mBuffer,mBufferSize,mOffset,FILE_LIST_IO_TAG_DIR_HASH   ,dir_hash)
+      || !FileListIO::writeField(mBuffer,mBufferSize,mOffset,FILE_LIST_IO_TAG_RAW_NUMBER ,(uint32_t)DirSyncBatchReader::RECORD_CONTENT)
+      || !FileListIO::writeField(mBuffer,mBufferSize,mOffset,FILE_LIST_IO_TAG_RAW_NUMBER ,(uint32_t)dir_data.bin_len)
+      || dir_data.bin_len > mMaxBatchSize || mOffset > mMaxBatchSize - dir_data.bin_len)
+    {
+        mOffset = old_offset ;
+        return false ;
+    }
+
+    // the directory data is appended as is, right after its size.
+
+    if(mOffset + dir_data.bin_len > mBufferSize)
+    {
+        uint32_t new_size = std::max(2*mBufferSize,mOffset + dir_data.bin_len) ;
+        unsigned char *new_buffer = (unsigned char*)realloc(mBuffer,new_size) ;
+
+        if(!new_buffer)
+        {
+            mOffset = old_offset ;
+            return false ;
+        }
+
+        mBuffer = new_buffer ;
+        mBufferSize = new_size ;
+    }
+    memcpy(mBuffer + mOffset,dir_data.bin_data,dir_data.bin_len) ;
+    mOffset += dir_data.bin_len ;
+
+    ++mNbRecords ;
+    return true ;
+}
+
+bool DirSyncBatchWriter::finish(RsTlvBinaryData& data)
+{
+    uLongf compressed_size = compressBound(mOffset) ;
+    unsigned char *out = (unsigned char*)rs_malloc(DIR_SYNC_BATCH_HEADER_SIZE + compressed_size) ;
+
+    if(!out)
+        return false ;
+
+    out[0] = (mOffset >> 24) & 0xff ;
+    out[1] = (mOffset >> 16) & 0xff ;
+    out[2] = (mOffset >>  8) & 0xff ;
+    out[3] = (mOffset      ) & 0xff ;
+
+    if(Z_OK != compress2(out + DIR_SYNC_BATCH_HEADER_SIZE,&compressed_size,mBuffer,mOffset,Z_DEFAULT_COMPRESSION))
+    {
+        RsErr() << __PRETTY_FUNCTION__ << " cannot compress batch of " << mOffset << " bytes" << std::endl;
+        free(out) ;
+        return false ;
+    }
+
+    data.TlvClear() ;
+    data.bin_data = out ;
+    data.bin_len  = DIR_SYNC_BATCH_HEADER_SIZE + compressed_size ;
+
+    return true ;
+}
+
+DirSyncBatchReader::DirSyncBatchReader()
+    : mBuffer(NULL), mSize(0), mOffset(0)
+{
+}
+
+DirSyncBatchReader::~DirSyncBatchReader()
+{
+    free(mBuffer) ;
+}
+
+bool DirSyncBatchReader::load(const RsTlvBinaryData& data, uint32_t max_size)
+{
+    free(mBuffer) ;
+    mBuffer = NULL ;
+    mSize = mOffset = 0 ;
+
+    if(data.bin_len < DIR_SYNC_BATCH_HEADER_SIZE)
+        return false ;
+
+    const unsigned char *in = (const unsigned char*)data.bin_data ;
+    uint32_t size = (uint32_t(in[0]) << 24) | (uint32_t(in[1]) << 16) | (uint32_t(in[2]) << 8) | uint32_t(in[3]) ;
+
+    if(size > max_size)
+    {
+        RsWarn() << __PRETTY_FUNCTION__ << " batch announces " << size << " bytes of data. Max allowed is " << max_size << ". Dropping." << std::endl;
+        return false ;
+    }
+
+    z_stream strm ;
+    memset(&strm,0,sizeof(strm)) ;
+
+    if(Z_OK != inflateInit(&strm))
+        return false ;
+
+    strm.next_in  = const_cast<unsigned char*>(in) + DIR_SYNC_BATCH_HEADER_SIZE ;
+    strm.avail_in = data.bin_len - DIR_SYNC_BATCH_HEADER_SIZE ;
+
+    // The output buffer is grown chunk by chunk and never goes above the announced size. Data
+    // that inflates to more than that is rejected as soon as the buffer is full.
+
+    uint32_t buffer_size = std::min(size,DIR_SYNC_BATCH_INFLATE_CHUNK) ;
+    unsigned char *buffer = (unsigned char*)rs_malloc(std::max(buffer_size,1u)) ;
+    int res = buffer ? Z_OK : Z_MEM_ERROR ;
+
+    while(res == Z_OK)
+    {
+        if(strm.total_out == buffer_size && buffer_size < size)
+        {
+            uint32_t new_size = std::min(size,buffer_size + DIR_SYNC_BATCH_INFLATE_CHUNK) ;
+            unsigned char *new_buffer = (unsigned char*)realloc(buffer,new_size) ;
+
+            if(!new_buffer)
+            {
+                res = Z_MEM_ERROR ;
+                break ;
+            }
+            buffer = new_buffer ;
+            buffer_size = new_size ;
+        }
+        strm.next_out  = buffer + strm.total_out ;
+        strm.avail_out = buffer_size - strm.total_out ;
+
+        // Z_BUF_ERROR means that no progress is possible: either the input is truncated, or the
+        // output needs more room than the announced size.
+
+        res = inflate(&strm,Z_NO_FLUSH) ;
+    }
+    uint32_t total_out = strm.total_out ;
+    inflateEnd(&strm) ;
+
+    if(res != Z_STREAM_END || total_out != size)
+    {
+        RsWarn() << __PRETTY_FUNCTION__ << " cannot uncompress batch, or batch does not match its announced size of " << size << " bytes. Data is corrupted." << std::endl;
+        free(buffer) ;
+        return false ;
+    }
+
+    mBuffer = buffer ;
+    mSize = size ;
+
+    return true ;
+}
+
+bool DirSyncBatchReader::next(Record& record)
+{
+    if(atEnd())
+        return false ;
+
+    if(!FileListIO::readField(mBuffer,mSize,mOffset,FILE_LIST_IO_TAG_DIR_HASH  ,record.dir_hash)) return false ;
+    if(!FileListIO::readField(mBuffer,mSize,mOffset,FILE_LIST_IO_TAG_RAW_NUMBER,record.type    )) return false ;
+
+    record.dir_data.TlvClear() ;
+
+    switch(record.type)
+    {
+    case RECORD_UP_TO_DATE: return true ;
+    case RECORD_CONTENT:
+    {
+        uint32_t dir_size = 0 ;
+
+        if(!FileListIO::readField(mBuffer,mSize,mOffset,FILE_LIST_IO_TAG_RAW_NUMBER,dir_size)) return false ;
+
+        if(dir_size > mSize - mOffset)
+        {
+            RsWarn() << __PRETTY_FUNCTION__ << " directory data exceeds batch size. Data is corrupted." << std::endl;
+            mOffset = mSize ;
+            return false ;
+        }
+        record.dir_data.setBinData(mBuffer + mOffset,dir_size) ;
+        mOffset += dir_size ;
+        return true ;
+    }
+    default:
+        RsWarn() << __PRETTY_FUNCTION__ << " unknown record type " << record.type << " in batch. Dropping the rest." << std::endl;
+        mOffset = mSize ;
+        return false ;
+    }
+}
@@ -0,0 +1,96 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: dir_sync_batch.h                            *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+#pragma once
+
+// Batches of directory entries exchanged when synchronising a whole sub-tree
+// of a friend's file list in a single request. A batch is a sequence of
+// records in depth-first order, so that a directory is always created by the
+// record of its parent before its own content is received. The encoded batch
+// is compressed with zlib.
+//
+#include <vector>
+
+#include "retroshare/rsids.h"
+#include "retroshare/rstypes.h"
+#include "serialiser/rstlvbinary.h"
+
+class DirSyncBatchWriter
+{
+public:
+    /*!
+     * \param max_size        size of uncompressed data above which the batch is considered full.
+     * \param max_batch_size  size of uncompressed data the batch never exceeds. Records that
+     *                        would go above are refused, and the batch is left unchanged.
+     */
+    DirSyncBatchWriter(uint32_t max_size, uint32_t max_batch_size) ;
+    ~DirSyncBatchWriter() ;
+
+    /// The directory is known to the requester with the same recursive modification time.
+    bool addUpToDate(const RsFileHash& dir_hash) ;
+
+    /// Full content of the directory, as serialised by LocalDirectoryStorage::serialiseDirEntry()
+    bool addContent(const RsFileHash& dir_hash, const RsTlvBinaryData& dir_data) ;
+
+    bool full() const { return mOffset >= mMaxSize ; }
+    bool empty() const { return mNbRecords == 0 ; }
+    uint32_t nbRecords() const { return mNbRecords ; }
+
+    /// Compresses the batch into the supplied binary data.
+    bool finish(RsTlvBinaryData& data) ;
+
+private:
+    unsigned char *mBuffer ;
+    uint32_t mBufferSize ;
+    uint32_t mOffset ;
+    uint32_t mMaxSize ;
+    uint32_t mMaxBatchSize ;
+    uint32_t mNbRecords ;
+};
+
+class DirSyncBatchReader
+{
+public:
+    enum RecordType { RECORD_UP_TO_DATE = 0x01, RECORD_CONTENT = 0x02 } ;
+
+    struct Record
+    {
+        RsFileHash dir_hash ;
+        uint32_t type ;
+        RsTlvBinaryData dir_data ;		// only for RECORD_CONTENT
+    };
+
+    DirSyncBatchReader() ;
+    ~DirSyncBatchReader() ;
+
+    /// Uncompresses the batch. Inflating stops as soon as the data goes above the announced size or max_size.
+    bool load(const RsTlvBinaryData& data, uint32_t max_size) ;
+
+    /// Reads the next record. Returns false at the end of the batch, or if the data is corrupted.
+    bool next(Record& record) ;
+
+    bool atEnd() const { return mOffset >= mSize ; }
+
+private:
+    unsigned char *mBuffer ;
+    uint32_t mSize ;
+    uint32_t mOffset ;
+};
@@ -0,0 +1,254 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: directory_scanner.cc                        *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "util/folderiterator.h"
+#include "util/largefile_retrocompat.hpp"
+#include "util/rsstring.h"
+#include "directory_scanner.h"
+
+#ifdef WINDOWS_SYS
+#include "util/rswin.h"
+#endif
+
+static const uint32_t MAX_READY_DIR_LISTINGS = 1024 ;	// listings read in advance, waiting for the directory updater
+
+static const uint32_t SCAN_THREAD_MIN_SLEEP   =    1 ;	// ms
+static const uint32_t SCAN_THREAD_MAX_SLEEP   =   20 ;	// ms
+static const double   SCAN_THREAD_RELAX       =  1.0 ;	// secs of idleness to reach the max sleep
+static const uint32_t GET_POLL_INTERVAL       = 1000 ;	// us, waiting for a directory being read by a thread
+
+struct DirectoryScanner::Job
+{
+    enum State { QUEUED, RUNNING, DONE, COLLECTED } ;
+
+    Request request ;
+    State state ;
+    DirListing listing ;
+};
+
+DirectoryScanner::ScanThread::ScanThread(DirectoryScanner& scanner)
+    : RsQueueThread(SCAN_THREAD_MIN_SLEEP,SCAN_THREAD_MAX_SLEEP,SCAN_THREAD_RELAX), mScanner(scanner)
+{
+}
+
+bool DirectoryScanner::ScanThread::workQueued()
+{
+    RsStackMutex stack(mScanner.mScanMtx) ;
+    return !mScanner.mQueue.empty() ;
+}
+
+bool DirectoryScanner::ScanThread::doWork()
+{
+    return !shouldStop() && mScanner.scanNextJob() ;
+}
+
+DirectoryScanner::DirectoryScanner(uint32_t nb_threads, uint32_t max_per_device, bool follow_symlinks)
+    : mScanMtx("DirectoryScanner"), mNbReady(0), mMaxPerDevice(std::max(1u,max_per_device)), mFollowSymLinks(follow_symlinks)
+{
+    for(uint32_t i=0;i<nb_threads;++i)
+    {
+        mThreads.emplace_back(new ScanThread(*this)) ;
+        mThreads.back()->start("dir scanner") ;
+    }
+}
+
+DirectoryScanner::~DirectoryScanner()
+{
+    // ask all threads first, so that they stop together
+
+    for(auto& t:mThreads)
+        t->askForStop() ;
+
+    for(auto& t:mThreads)
+        t->fullstop() ;
+}
+
+void DirectoryScanner::submit(const std::vector<Request>& requests, std::vector<JobHandle>& jobs)
+{
+    jobs.clear() ;
+
+    for(auto& r:requests)
+    {
+        JobHandle job = std::make_shared<Job>() ;
+        job->request = r ;
+        job->state = Job::QUEUED ;
+        jobs.push_back(job) ;
+    }
+
+    if(mThreads.empty())
+        return ;
+
+    RS_STACK_MUTEX(mScanMtx) ;
+
+    for(auto it(jobs.rbegin());it!=jobs.rend();++it)
+        mQueue.push_front(*it) ;
+}
+
+DirectoryScanner::JobHandle DirectoryScanner::locked_pickJob()
+{
+    for(auto it(mQueue.begin());it!=mQueue.end();)
+    {
+        JobHandle job = *it ;
+
+        if(job->state != Job::QUEUED)		// already taken over by get()
+            it = mQueue.erase(it) ;
+        else if(mReadsPerDevice[job->request.device] >= mMaxPerDevice)
+            ++it ;
+        else
+        {
+            mQueue.erase(it) ;
+            return job ;
+        }
+    }
+    return JobHandle() ;
+}
+
+bool DirectoryScanner::scanNextJob()
+{
+    JobHandle job ;
+    uint64_t device ;
+
+    {
+        RS_STACK_MUTEX(mScanMtx) ;
+
+        if(mNbReady >= MAX_READY_DIR_LISTINGS || !(job = locked_pickJob()))
+            return false ;
+
+        device = job->request.device ;
+        job->state = Job::RUNNING ;
+        ++mReadsPerDevice[device] ;
+    }
+
+    DirListing listing ;
+    scan(job->request,mFollowSymLinks,listing) ;
+
+    RS_STACK_MUTEX(mScanMtx) ;
+
+    job->listing.entries.swap(listing.entries) ;
+    job->listing.dir_modtime = listing.dir_modtime ;
+    job->listing.device = listing.device ;
+    job->listing.listed = listing.listed ;
+    job->state = Job::DONE ;
+    ++mNbReady ;
+
+    if(--mReadsPerDevice[device] == 0)
+        mReadsPerDevice.erase(device) ;
+
+    return true ;
+}
+
+void DirectoryScanner::get(const JobHandle& job, DirListing& listing)
+{
+    bool read_here = false ;
+
+    {
+        RS_STACK_MUTEX(mScanMtx) ;
+
+        if(job->state == Job::QUEUED)
+        {
+            job->state = Job::COLLECTED ;
+            read_here = true ;
+        }
+    }
+
+    if(read_here)
+    {
+        // nobody is reading it yet: faster to do it here than to wait for a thread
+
+        scan(job->request,mFollowSymLinks,listing) ;
+        return ;
+    }
+
+    // being read by a thread, which is usually about to finish
+
+    for(;;)
+    {
+        {
+            RS_STACK_MUTEX(mScanMtx) ;
+
+            if(job->state == Job::DONE)
+            {
+                listing = std::move(job->listing) ;
+                job->state = Job::COLLECTED ;
+                --mNbReady ;
+                return ;
+            }
+        }
+        rstime::rs_usleep(GET_POLL_INTERVAL) ;
+    }
+}
+
+static bool statDirectory(const std::string& path, struct stat64& buf)
+{
+#ifdef WINDOWS_SYS
+    std::wstring wfullname;
+    librs::util::ConvertUtf8ToUtf16(path, wfullname);
+    return 0 == _wstati64(wfullname.c_str(), &buf) ;
+#else
+    return 0 == stat64(path.c_str(), &buf) ;
+#endif
+}
+
+uint64_t DirectoryScanner::device(const std::string& path)
+{
+    struct stat64 buf ;
+
+    return statDirectory(path, buf) ? buf.st_dev : 0 ;
+}
+
+void DirectoryScanner::scan(const Request& request, bool follow_symlinks, DirListing& listing)
+{
+    listing = DirListing() ;
+
+    // a stat is enough to know whether the directory content changed
+
+    struct stat64 buf ;
+
+    if(statDirectory(request.path, buf))
+    {
+        listing.dir_modtime = buf.st_mtime ;
+        listing.device = buf.st_dev ;
+    }
+
+    if(!request.force && listing.dir_modtime <= request.local_mod_time)
+        return ;
+
+    // disallow files from the future.
+    librs::util::FolderIterator dirIt(request.path, follow_symlinks, false);
+
+    listing.dir_modtime = dirIt.dir_modtime() ;
+    listing.listed = true ;
+
+    for( ; dirIt.isValid(); dirIt.next() )
+    {
+        DirListing::Entry e ;
+        e.name = dirIt.file_name() ;
+        e.type = dirIt.file_type() ;
+        e.modtime = dirIt.file_modtime() ;
+        e.size = dirIt.file_size() ;
+
+        listing.entries.push_back(e) ;
+    }
+}
@@ -0,0 +1,126 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: directory_scanner.h                         *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+#pragma once
+
+// Reads the content of local directories on a pool of threads. On network file
+// systems and large arrays, the sweep of shared directories is bound by the
+// latency of each directory read and stat, so independent sub-trees are read
+// concurrently. The results are handed back to the directory updater, which
+// merges them into LocalDirectoryStorage in its usual depth-first order, so the
+// outcome of a sweep does not depend on the order in which reads complete.
+//
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "util/rsthreads.h"
+#include "util/rstime.h"
+
+struct DirListing
+{
+    struct Entry
+    {
+        std::string name ;
+        uint8_t type ;		// librs::util::FolderIterator::TYPE_*
+        rstime_t modtime ;
+        uint64_t size ;
+    };
+
+    DirListing() : dir_modtime(0), device(0), listed(false) {}
+
+    rstime_t dir_modtime ;
+    uint64_t device ;		// device the directory belongs to
+    bool listed ;			// false if the directory did not change, in which case its content is not read
+    std::vector<Entry> entries ;
+};
+
+class DirectoryScanner
+{
+public:
+    /*!
+     * \param nb_threads       number of reading threads. With 0, directories are read by the thread that requests them.
+     * \param max_per_device   maximum number of directories read at the same time on a single device, so that
+     *                         a slow mount point cannot take all threads and a local disk is not overloaded.
+     */
+    DirectoryScanner(uint32_t nb_threads, uint32_t max_per_device, bool follow_symlinks) ;
+    ~DirectoryScanner() ;
+
+    struct Request
+    {
+        std::string path ;
+        rstime_t local_mod_time ;	// content is only read if the directory is more recent, or if force is set
+        bool force ;
+        uint64_t device ;			// expected device, usually the one of the parent directory
+    };
+
+    struct Job ;
+    typedef std::shared_ptr<Job> JobHandle ;
+
+    /*!
+     * \brief submit
+     * 			Queues directories to read. They are read before any directory queued previously, in the given order. Submitting
+     * 			the sub-directories of each directory when it is handled therefore reads the hierarchy in depth-first order.
+     * 			Each job must then be passed to get().
+     */
+    void submit(const std::vector<Request>& requests, std::vector<JobHandle>& jobs) ;
+
+    /*!
+     * \brief get
+     * 			Gets the content of a submitted directory. If no thread started reading it yet, it is read by the calling thread.
+     */
+    void get(const JobHandle& job, DirListing& listing) ;
+
+    /// Reads a directory in the calling thread.
+    static void scan(const Request& request, bool follow_symlinks, DirListing& listing) ;
+
+    /// \return the device holding path, or 0 if it cannot be stat'ed.
+    static uint64_t device(const std::string& path) ;
+
+private:
+    class ScanThread: public RsQueueThread
+    {
+    public:
+        explicit ScanThread(DirectoryScanner& scanner) ;
+
+    protected:
+        bool workQueued() override ;
+        bool doWork() override ;
+
+    private:
+        DirectoryScanner& mScanner ;
+    };
+
+    bool scanNextJob() ;		// returns false if no job can be started now
+    JobHandle locked_pickJob() ;
+
+    RsMutex mScanMtx ;
+
+    std::deque<JobHandle> mQueue ;
+    std::map<uint64_t,uint32_t> mReadsPerDevice ;
+    uint32_t mNbReady ;		// listings read but not collected yet. Bounded to limit memory usage.
+
+    uint32_t mMaxPerDevice ;
+    bool mFollowSymLinks ;
+    std::vector<std::unique_ptr<ScanThread> > mThreads ;
+};
@@ -179,8 +179,13 @@ void DirectoryStorage::getStatistics(SharedDirStats& stats)
 bool DirectoryStorage::load(const std::string& local_file_name)
 {
     RS_STACK_MUTEX(mDirStorageMtx) ;
-    mChanged = false ;
-    return mFileHierarchy->load(local_file_name);
+
+    bool res = mFileHierarchy->load(local_file_name);
+
+    // Lists in the old format are re-written by the next call to checkSave(), from the file list thread.
+
+    mChanged = res && mFileHierarchy->loadedLegacyFormat() ;
+    return res ;
 }
 void DirectoryStorage::save(const std::string& local_file_name)
 {
@@ -46,6 +46,7 @@ LocalDirectoryUpdater::LocalDirectoryUpdater(HashStorage *hc,LocalDirectoryStora
     /* Can be left to false, but setting it to true will force to re-hash any file that has been left unhashed in the last session.*/
     , mNeedsFullRecheck(true)
     , mIsChecking(false), mForceUpdate(false), mIgnoreFlags (0),  mMaxShareDepth(0)
+    , mDirScanner(nullptr)
 {
 }
 
@@ -67,7 +68,13 @@ void LocalDirectoryUpdater::threadTick()
 
     if (mIsEnabled || mForceUpdate)
     {
-        if(now > mDelayBetweenDirectoryUpdates + mLastSweepTime)
+        // When changes in shared directories are notified, full sweeps are only a rare safety net.
+        uint32_t sweep_delay = mDelayBetweenDirectoryUpdates ;
+
+        if(mDirWatcher.isActive() && !mForceUpdate && !mNeedsFullRecheck)
+            sweep_delay = std::max(sweep_delay, DELAY_BETWEEN_WATCHED_DIRECTORY_UPDATES) ;
+
+        if(now > sweep_delay + mLastSweepTime)
         {
             bool some_files_not_ready = false ;
 
@@ -92,6 +99,8 @@ void LocalDirectoryUpdater::threadTick()
             else
                 std::cerr << "(WW) sweepSharedDirectories() failed. Will do it again in a short time." << std::endl;
         }
+        else if(mIsEnabled)
+            processChangedDirectories(now) ;
 
         if(now > DELAY_BETWEEN_LOCAL_DIRECTORIES_TS_UPDATE + mLastTSUpdateTime)
         {
@@ -137,6 +146,12 @@ bool LocalDirectoryUpdater::sweepSharedDirectories(bool& some_files_not_ready)
 
 	RsServer::notify()->notifyListPreChange(NOTIFY_LIST_DIRLIST_LOCAL, 0);
 
+	/* the sweep covers all pending changes. Watches are (re-)registered while
+	 * crawling, and the ones of directories that are not shared anymore are
+	 * dropped at the end. */
+	mChangedDirs.clear();
+	mDirWatcher.beginRefresh();
+
 	/* recursive update algorithm works that way:
 	 * - the external loop starts on the shared directory list and goes through
 	 *   sub-directories
@@ -207,22 +222,41 @@ bool LocalDirectoryUpdater::sweepSharedDirectories(bool& some_files_not_ready)
 	mSharedDirectories->updateSubDirectoryList(
 	            mSharedDirectories->root(), sub_dir_list, mHashSalt );
 
+	/* directories are read ahead by a pool of threads, while the results are
+	 * merged here in depth-first order. */
+	DirectoryScanner scanner( DIRECTORY_SCANNER_THREADS,
+	                          DIRECTORY_SCANNER_MAX_READS_PER_DEVICE,
+	                          mFollowSymLinks );
+	mDirScanner = &scanner;
+
+	std::vector<DirectoryScanner::JobHandle> jobs;
+	queueSubDirectories("", mSharedDirectories->root(), 1, 0, jobs);
+
 	// now for each of them, go recursively and match both files and dirs
 	std::set<std::string> existing_dirs;
+	uint32_t i = 0;
 	for( DirectoryStorage::DirIterator stored_dir_it(
 	         mSharedDirectories, mSharedDirectories->root() );
-	     stored_dir_it; ++stored_dir_it )
+	     stored_dir_it; ++stored_dir_it, ++i )
 	{
 		RS_DBG4("recursing into \"", stored_dir_it.name());
 
 		existing_dirs.insert(RsDirUtil::removeSymLinks(stored_dir_it.name()));
 		recursUpdateSharedDir(
 		            stored_dir_it.name(), *stored_dir_it,
-		            existing_dirs, 1, some_files_not_ready );
+		            existing_dirs, 1, some_files_not_ready, jobs[i] );
 		/* here we need to use the list that was stored, instead of the shared
 		 * dir list, because the two are not necessarily in the same order. */
 	}
 
+	mDirScanner = nullptr;
+
+	mExistingDirectories = existing_dirs;
+	mDirWatcher.endRefresh();
+
+	if(mDirWatcher.isActive())
+		RS_INFO("watching ", mDirWatcher.nbWatches(), " shared directories for changes");
+
 	RsServer::notify()->notifyListChange(NOTIFY_LIST_DIRLIST_LOCAL, 0);
 	mIsChecking = false;
 
@@ -232,7 +266,7 @@ bool LocalDirectoryUpdater::sweepSharedDirectories(bool& some_files_not_ready)
 void LocalDirectoryUpdater::recursUpdateSharedDir(
         const std::string& cumulated_path, DirectoryStorage::EntryIndex indx,
         std::set<std::string>& existing_directories, uint32_t current_depth,
-        bool& some_files_not_ready )
+        bool& some_files_not_ready, const DirectoryScanner::JobHandle& job )
 {
 	RS_DBG4("parsing directory \"", cumulated_path, "\" index: ", indx);
 
@@ -240,8 +274,12 @@ void LocalDirectoryUpdater::recursUpdateSharedDir(
 	 * make sure list of subfiles is the same
 	 * request all hashes to the hashcache */
 
-	// disallow symbolic links and files from the future.
-	librs::util::FolderIterator dirIt(cumulated_path, mFollowSymLinks, false);
+	DirListing listing;
+
+	/* the directory was queued for reading when its parent was handled. The
+	 * job must be collected in any case. */
+	if(job)
+		mDirScanner->get(job, listing);
 
 	rstime_t dir_local_mod_time;
 	if(!mSharedDirectories->getDirectoryLocalModTime(indx,dir_local_mod_time))
@@ -251,113 +289,293 @@ void LocalDirectoryUpdater::recursUpdateSharedDir(
 		return;
 	}
 
-	rstime_t now = time(nullptr);
 	/* the > is because we may have changed the virtual name, and therefore the
 	 * TS wont match. We only want to detect when the directory has changed on
 	 * the disk */
-	if(mNeedsFullRecheck || dirIt.dir_modtime() > dir_local_mod_time)
+	if(!job)
 	{
-		// collect subdirs and subfiles
-		std::map<std::string, DirectoryStorage::FileTS> subfiles;
-		std::set<std::string> subdirs;
+		watchDirectory(cumulated_path, indx, current_depth);
+
+		DirectoryScanner::Request r;
+		r.path = cumulated_path;
+		r.local_mod_time = dir_local_mod_time;
+		r.force = mNeedsFullRecheck;
+		r.device = 0;
+
+		DirectoryScanner::scan(r, mFollowSymLinks, listing);
+	}
+
+	if(listing.listed)
+		updateDirectoryContent( listing, cumulated_path, indx,
+		                        existing_directories, current_depth,
+		                        some_files_not_ready );
+
+	// read the sub-dirs in advance, then go through them and recursively update
+	std::vector<DirectoryScanner::JobHandle> jobs;
+	queueSubDirectories( cumulated_path, indx, current_depth+1,
+	                     listing.device, jobs );
+
+	uint32_t i = 0;
+	for( DirectoryStorage::DirIterator stored_dir_it(mSharedDirectories, indx);
+	     stored_dir_it; ++stored_dir_it, ++i )
+		recursUpdateSharedDir( cumulated_path + "/" + stored_dir_it.name(),
+		                       *stored_dir_it, existing_directories,
+		                       current_depth+1, some_files_not_ready,
+		                       i < jobs.size() ? jobs[i] : DirectoryScanner::JobHandle() );
+}
+
+void LocalDirectoryUpdater::queueSubDirectories(
+        const std::string& cumulated_path, DirectoryStorage::EntryIndex indx,
+        uint32_t depth, uint64_t device,
+        std::vector<DirectoryScanner::JobHandle>& jobs )
+{
+	jobs.clear();
+
+	if(!mDirScanner)
+		return;
 
-		for( ; dirIt.isValid(); dirIt.next() )
-			if(filterFile(dirIt.file_name()))
+	std::vector<DirectoryScanner::Request> requests;
+
+	for( DirectoryStorage::DirIterator stored_dir_it(mSharedDirectories, indx);
+	     stored_dir_it; ++stored_dir_it )
+	{
+		DirectoryScanner::Request r;
+		r.path = cumulated_path.empty() ? stored_dir_it.name()
+		                                : cumulated_path + "/" + stored_dir_it.name();
+		r.local_mod_time = 0;
+		r.force = mNeedsFullRecheck;
+		/* each share may be on its own device: roots have no parent to
+		 * take it from. */
+		r.device = cumulated_path.empty() ? DirectoryScanner::device(r.path)
+		                                  : device;
+		mSharedDirectories->getDirectoryLocalModTime(*stored_dir_it, r.local_mod_time);
+
+		/* watch the directory before it is read, so that no change can be
+		 * missed in between. */
+		watchDirectory(r.path, *stored_dir_it, depth);
+
+		requests.push_back(r);
+	}
+
+	mDirScanner->submit(requests, jobs);
+}
+
+void LocalDirectoryUpdater::watchDirectory(
+        const std::string& path, DirectoryStorage::EntryIndex indx,
+        uint32_t depth )
+{
+	if(!mDirWatcher.isActive())
+		return;
+
+	RsFileHash dir_hash;
+	if(mSharedDirectories->getDirHashFromIndex(indx, dir_hash))
+		mDirWatcher.addWatch(path, dir_hash, depth);
+}
+
+void LocalDirectoryUpdater::updateDirectoryContent(
+        const DirListing& listing, const std::string& cumulated_path,
+        DirectoryStorage::EntryIndex indx,
+        std::set<std::string>& existing_directories, uint32_t current_depth,
+        bool& some_files_not_ready )
+{
+	rstime_t now = time(nullptr);
+
+	// collect subdirs and subfiles
+	std::map<std::string, DirectoryStorage::FileTS> subfiles;
+	std::set<std::string> subdirs;
+
+	for(const DirListing::Entry& entry: listing.entries)
+		if(filterFile(entry.name))
+		{
+			const auto fType = entry.type;
+			switch(fType)
 			{
-				const auto fType = dirIt.file_type();
-				switch(fType)
+			case librs::util::FolderIterator::TYPE_FILE:
+				if(now >= entry.modtime + MIN_TIME_AFTER_LAST_MODIFICATION)
 				{
-				case librs::util::FolderIterator::TYPE_FILE:
-					if(now >= dirIt.file_modtime() + MIN_TIME_AFTER_LAST_MODIFICATION)
-					{
-						subfiles[dirIt.file_name()].modtime = dirIt.file_modtime();
-						subfiles[dirIt.file_name()].size = dirIt.file_size();
-						RS_DBG4("adding sub-file \"", dirIt.file_name(), "\"");
-					}
-					else
-					{
-						some_files_not_ready = true;
-						RS_INFO( "file: \"", dirIt.file_fullpath(), "\" is "
-						         "probably being written to. Keep it for later");
-					}
-					break;
-				case librs::util::FolderIterator::TYPE_DIR:
+					subfiles[entry.name].modtime = entry.modtime;
+					subfiles[entry.name].size = entry.size;
+					RS_DBG4("adding sub-file \"", entry.name, "\"");
+				}
+				else
 				{
-					bool dir_is_accepted = true;
-					/* 64 is here as a safe limit, to make infinite loops
-					 * impossible.
-					 * TODO: Make it a visible constexpr in the header */
-					if( (mMaxShareDepth > 0u && current_depth > mMaxShareDepth)
-					        || (mMaxShareDepth == 0 && current_depth >= 64) )
-						dir_is_accepted = false;
+					some_files_not_ready = true;
+					RS_INFO( "file: \"", cumulated_path, "/", entry.name, "\" is "
+					         "probably being written to. Keep it for later");
+				}
+				break;
+			case librs::util::FolderIterator::TYPE_DIR:
+			{
+				bool dir_is_accepted = true;
+				/* 64 is here as a safe limit, to make infinite loops
+				 * impossible.
+				 * TODO: Make it a visible constexpr in the header */
+				if( (mMaxShareDepth > 0u && current_depth > mMaxShareDepth)
+				        || (mMaxShareDepth == 0 && current_depth >= 64) )
+					dir_is_accepted = false;
+
+				if(dir_is_accepted && mFollowSymLinks && mIgnoreDuplicates)
+				{
+					std::string real_path = RsDirUtil::removeSymLinks(
+					            cumulated_path + "/" + entry.name );
 
-					if(dir_is_accepted && mFollowSymLinks && mIgnoreDuplicates)
+					if( existing_directories.end() !=
+					        existing_directories.find(real_path) )
 					{
-						std::string real_path = RsDirUtil::removeSymLinks(
-						            cumulated_path + "/" + dirIt.file_name() );
-
-						if( existing_directories.end() !=
-						        existing_directories.find(real_path) )
-						{
-							RS_WARN( "Directory: \"", cumulated_path,
-							         "\" has real path: \"", real_path,
-							         "\" which already belongs to another "
-							         "shared directory. Ignoring" );
-							dir_is_accepted = false;
-						}
-						else existing_directories.insert(real_path);
+						RS_WARN( "Directory: \"", cumulated_path,
+						         "\" has real path: \"", real_path,
+						         "\" which already belongs to another "
+						         "shared directory. Ignoring" );
+						dir_is_accepted = false;
 					}
+					else existing_directories.insert(real_path);
+				}
 
-					if(dir_is_accepted) subdirs.insert(dirIt.file_name());
+				if(dir_is_accepted) subdirs.insert(entry.name);
 
-					RS_DBG4("adding sub-dir \"", dirIt.file_name(), "\"");
+				RS_DBG4("adding sub-dir \"", entry.name, "\"");
 
-					break;
-				}
-				default:
-					RS_ERR( "Got Dir entry of unknown type:", fType,
-					        "with path \"", cumulated_path, "/",
-					        dirIt.file_name(), "\"" );
-					print_stacktrace();
-					break;
-				}
+				break;
+			}
+			default:
+				RS_ERR( "Got Dir entry of unknown type:", fType,
+				        "with path \"", cumulated_path, "/",
+				        entry.name, "\"" );
+				print_stacktrace();
+				break;
 			}
+		}
+
+	/* update folder modificatoin time, which is the only way to detect
+	 * e.g. removed or renamed files. */
+	mSharedDirectories->setDirectoryLocalModTime(indx,listing.dir_modtime);
+
+	// update file and dir lists for current directory.
+	mSharedDirectories->updateSubDirectoryList(indx,subdirs,mHashSalt);
+
+	std::map<std::string, DirectoryStorage::FileTS> new_files;
+	mSharedDirectories->updateSubFilesList(indx, subfiles, new_files);
 
-		/* update folder modificatoin time, which is the only way to detect
-		 * e.g. removed or renamed files. */
-		mSharedDirectories->setDirectoryLocalModTime(indx,dirIt.dir_modtime());
+	// now go through list of subfiles and request the hash to hashcache
+	for( DirectoryStorage::FileIterator dit(mSharedDirectories,indx);
+	     dit; ++dit )
+	{
+		/* ask about the hash. If not present, ask HashCache.
+		 * If not present, or different, the callback will update it. */
+		RsFileHash hash;
+
+		/* mSharedDirectories does two things: store H(F), and
+		 * compute H(H(F)), which is used in FT.
+		 * The later is always needed. */
+
+		if( mHashCache->requestHash(
+		            cumulated_path + "/" + dit.name(),
+		            dit.size(), dit.modtime(), hash, this, *dit ) )
+			mSharedDirectories->updateHash(*dit, hash, hash != dit.hash());
+	}
+}
 
-		// update file and dir lists for current directory.
-		mSharedDirectories->updateSubDirectoryList(indx,subdirs,mHashSalt);
+void LocalDirectoryUpdater::processChangedDirectories(rstime_t now)
+{
+	if(!mDirWatcher.isActive())
+		return;
 
-		std::map<std::string, DirectoryStorage::FileTS> new_files;
-		mSharedDirectories->updateSubFilesList(indx, subfiles, new_files);
+	if(!mDirWatcher.collectChanges(mChangedDirs))
+	{
+		RS_WARN("Some shared directory change notifications were lost. "
+		        "Scheduling a full sweep.");
+		mLastSweepTime = 0;
+		return;
+	}
+
+	/* Only handle directories that have not changed for a little while, so
+	 * that a burst of changes (e.g. a copy of many files) causes a single
+	 * update. */
+	std::map<std::string, DirectoryWatcher::ChangedDir> ready_dirs;
 
-		// now go through list of subfiles and request the hash to hashcache
-		for( DirectoryStorage::FileIterator dit(mSharedDirectories,indx);
-		     dit; ++dit )
+	for(auto it(mChangedDirs.begin()); it != mChangedDirs.end(); )
+		if(now >= it->second.last_event_TS + MIN_TIME_AFTER_LAST_MODIFICATION)
 		{
-			/* ask about the hash. If not present, ask HashCache.
-			 * If not present, or different, the callback will update it. */
-			RsFileHash hash;
+			ready_dirs.insert(*it);
+			it = mChangedDirs.erase(it);
+		}
+		else ++it;
 
-			/* mSharedDirectories does two things: store H(F), and
-			 * compute H(H(F)), which is used in FT.
-			 * The later is always needed. */
+	if(ready_dirs.empty())
+		return;
 
-			if( mHashCache->requestHash(
-			            cumulated_path + "/" + dit.name(),
-			            dit.size(), dit.modtime(), hash, this, *dit ) )
-				mSharedDirectories->updateHash(*dit, hash, hash != dit.hash());
+	RS_DBG4("updating ", ready_dirs.size(), " changed shared directories");
+
+	mIsChecking = true;
+	RsServer::notify()->notifyListPreChange(NOTIFY_LIST_DIRLIST_LOCAL, 0);
+
+	for(auto& it: std::as_const(ready_dirs))
+	{
+		bool some_files_not_ready = false;
+		updateChangedDirectory(it.first, it.second, some_files_not_ready);
+
+		// files still being written: look again later
+		if(some_files_not_ready)
+		{
+			DirectoryWatcher::ChangedDir& c(mChangedDirs[it.first]);
+			c = it.second;
+			c.last_event_TS = now;
 		}
 	}
 
-	// go through the list of sub-dirs and recursively update
+	mSharedDirectories->notifyTSChanged();
+
+	RsServer::notify()->notifyListChange(NOTIFY_LIST_DIRLIST_LOCAL, 0);
+	mIsChecking = false;
+}
+
+void LocalDirectoryUpdater::updateChangedDirectory(
+        const std::string& path, const DirectoryWatcher::ChangedDir& dir,
+        bool& some_files_not_ready )
+{
+	/* the directory may have been removed since, in which case its parent is
+	 * also notified and takes care of it. */
+	DirectoryStorage::EntryIndex indx;
+	if( !mSharedDirectories->getIndexFromDirHash(dir.dir_hash, indx)
+	        || !RsDirUtil::checkDirectory(path) )
+		return;
+
+	/* the real paths of the current sub-directories must not be taken for
+	 * duplicates when listing the directory again. */
+	std::set<std::string> existing_dirs(mExistingDirectories);
+
+	if(mFollowSymLinks && mIgnoreDuplicates)
+		for( DirectoryStorage::DirIterator stored_dir_it(mSharedDirectories, indx);
+		     stored_dir_it; ++stored_dir_it )
+			existing_dirs.erase(
+			            RsDirUtil::removeSymLinks(path + "/" + stored_dir_it.name()) );
+
+	DirectoryScanner::Request r;
+	r.path = path;
+	r.local_mod_time = 0;
+	r.force = true;
+	r.device = 0;
+
+	DirListing listing;
+	DirectoryScanner::scan(r, mFollowSymLinks, listing);
+
+	updateDirectoryContent( listing, path, indx, existing_dirs, dir.depth,
+	                        some_files_not_ready );
+
+	/* new sub-directories have never been listed: crawl them entirely, which
+	 * also starts watching them. */
 	for( DirectoryStorage::DirIterator stored_dir_it(mSharedDirectories, indx);
 	     stored_dir_it; ++stored_dir_it )
-		recursUpdateSharedDir( cumulated_path + "/" + stored_dir_it.name(),
-		                       *stored_dir_it, existing_directories,
-		                       current_depth+1, some_files_not_ready );
+	{
+		rstime_t local_mod_time;
+		if( mSharedDirectories->getDirectoryLocalModTime(
+		            *stored_dir_it, local_mod_time ) && local_mod_time == 0 )
+			recursUpdateSharedDir( path + "/" + stored_dir_it.name(),
+			                       *stored_dir_it, existing_dirs, dir.depth+1,
+			                       some_files_not_ready );
+	}
+
+	mExistingDirectories.insert(existing_dirs.begin(), existing_dirs.end());
 }
 
 bool LocalDirectoryUpdater::filterFile(const std::string& fname) const
@@ -27,6 +27,8 @@
 //
 #include "file_sharing/hash_cache.h"
 #include "file_sharing/directory_storage.h"
+#include "file_sharing/directory_watcher.h"
+#include "file_sharing/directory_scanner.h"
 #include "util/rstime.h"
 
 class LocalDirectoryUpdater: public HashStorageClient, public RsTickingThread
@@ -67,15 +69,26 @@ protected:
     virtual void hash_callback(uint32_t client_param, const std::string& name, const RsFileHash& hash, uint64_t size);
     virtual bool hash_confirm(uint32_t client_param) ;
 
-    void recursUpdateSharedDir(const std::string& cumulated_path, DirectoryStorage::EntryIndex indx, std::set<std::string>& existing_directories, uint32_t current_depth,bool& files_not_ready);
+    void recursUpdateSharedDir(const std::string& cumulated_path, DirectoryStorage::EntryIndex indx, std::set<std::string>& existing_directories, uint32_t current_depth,bool& files_not_ready, const DirectoryScanner::JobHandle& job = DirectoryScanner::JobHandle());
+    void updateDirectoryContent(const DirListing& listing, const std::string& cumulated_path, DirectoryStorage::EntryIndex indx, std::set<std::string>& existing_directories, uint32_t current_depth, bool& some_files_not_ready);
+    void queueSubDirectories(const std::string& cumulated_path, DirectoryStorage::EntryIndex indx, uint32_t depth, uint64_t device, std::vector<DirectoryScanner::JobHandle>& jobs);
+    void watchDirectory(const std::string& path, DirectoryStorage::EntryIndex indx, uint32_t depth);
     bool sweepSharedDirectories(bool &some_files_not_ready);
 
+    // Re-lists the directories notified as changed by mDirWatcher, once they have been left untouched for a little while.
+    void processChangedDirectories(rstime_t now);
+    void updateChangedDirectory(const std::string& path, const DirectoryWatcher::ChangedDir& dir, bool& some_files_not_ready);
+
 private:
 	bool filterFile(const std::string& fname) const ;	// reponds true if the file passes the ignore lists test.
 
     HashStorage *mHashCache ;
     LocalDirectoryStorage *mSharedDirectories ;
 
+    DirectoryWatcher mDirWatcher ;
+    std::map<std::string,DirectoryWatcher::ChangedDir> mChangedDirs ;
+    std::set<std::string> mExistingDirectories ;	// real paths of shared directories, used to skip duplicates between two full sweeps
+
     RsFileHash mHashSalt ;
 
     rstime_t mLastSweepTime;
@@ -94,5 +107,7 @@ private:
 
 	std::list<std::string> mIgnoredPrefixes ;
 	std::list<std::string> mIgnoredSuffixes ;
+
+	DirectoryScanner *mDirScanner ;	// only set during full sweeps
 };
 
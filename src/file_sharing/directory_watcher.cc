@@ -0,0 +1,181 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: directory_watcher.cc                        *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#endif
+
+#include "util/rsdebug.h"
+#include "directory_watcher.h"
+
+#ifdef __linux__
+// Directory content changes. Files being written are reported when closed, so that they are not picked up half written.
+static const uint32_t DIR_WATCH_EVENT_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ATTRIB | IN_ONLYDIR ;
+#endif
+
+DirectoryWatcher::DirectoryWatcher() : mFd(-1), mRefreshRound(0)
+{
+    init() ;
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+    shutdown() ;
+}
+
+void DirectoryWatcher::init()
+{
+#ifdef __linux__
+    mFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC) ;
+
+    if(mFd < 0)
+        RS_WARN("Cannot initialise inotify: ", strerror(errno), ". Shared directories will only be checked by periodic sweeps.") ;
+#endif
+}
+
+void DirectoryWatcher::shutdown()
+{
+#ifdef __linux__
+    if(mFd >= 0)
+        close(mFd) ;	// also removes all watches
+#endif
+    mFd = -1 ;
+    mWatches.clear() ;
+}
+
+void DirectoryWatcher::beginRefresh()
+{
+    if(mFd < 0)
+        init() ;
+
+    ++mRefreshRound ;
+}
+
+void DirectoryWatcher::endRefresh()
+{
+#ifdef __linux__
+    for(auto it(mWatches.begin());it!=mWatches.end();)
+        if(it->second.refresh_round != mRefreshRound)
+        {
+            inotify_rm_watch(mFd,it->first) ;
+            it = mWatches.erase(it) ;
+        }
+        else
+            ++it ;
+#endif
+}
+
+bool DirectoryWatcher::addWatch(const std::string& path, const RsFileHash& dir_hash, uint32_t depth)
+{
+#ifdef __linux__
+    if(mFd < 0)
+        return false ;
+
+    // the same watch descriptor is returned if the directory is already watched
+    int wd = inotify_add_watch(mFd,path.c_str(),DIR_WATCH_EVENT_MASK) ;
+
+    if(wd < 0)
+    {
+        if(errno == ENOSPC)
+        {
+            RS_WARN("Reached the maximum number of inotify watches (", mWatches.size(), "). Raise fs.inotify.max_user_watches "
+                    "to be notified of changes in all shared directories. Falling back to periodic sweeps.") ;
+            shutdown() ;
+        }
+        else
+            RS_WARN("Cannot watch directory \"", path, "\": ", strerror(errno)) ;
+
+        return false ;
+    }
+
+    WatchedDir& w(mWatches[wd]) ;
+
+    w.path = path ;
+    w.dir_hash = dir_hash ;
+    w.depth = depth ;
+    w.refresh_round = mRefreshRound ;
+
+    return true ;
+#else
+    (void)path ;
+    (void)dir_hash ;
+    (void)depth ;
+    return false ;
+#endif
+}
+
+bool DirectoryWatcher::collectChanges(std::map<std::string,ChangedDir>& changed_dirs)
+{
+#ifdef __linux__
+    if(mFd < 0)
+        return true ;
+
+    bool nothing_lost = true ;
+    rstime_t now = time(NULL) ;
+
+    alignas(struct inotify_event) char buf[16384] ;
+
+    for(;;)
+    {
+        ssize_t len = read(mFd,buf,sizeof(buf)) ;
+
+        if(len <= 0)
+            break ;	// EAGAIN: no more events
+
+        for(char *p = buf; p < buf + len; p += sizeof(struct inotify_event) + reinterpret_cast<struct inotify_event*>(p)->len)
+        {
+            const struct inotify_event *ev = reinterpret_cast<struct inotify_event*>(p) ;
+
+            if(ev->mask & IN_Q_OVERFLOW)
+            {
+                nothing_lost = false ;
+                continue ;
+            }
+
+            auto it = mWatches.find(ev->wd) ;
+
+            if(it == mWatches.end())
+                continue ;
+
+            if(ev->mask & IN_IGNORED)	// directory removed or unmounted. Its parent is notified as well.
+            {
+                mWatches.erase(it) ;
+                continue ;
+            }
+
+            ChangedDir& c(changed_dirs[it->second.path]) ;
+
+            c.dir_hash = it->second.dir_hash ;
+            c.depth = it->second.depth ;
+            c.last_event_TS = now ;
+        }
+    }
+
+    return nothing_lost ;
+#else
+    (void)changed_dirs ;
+    return true ;
+#endif
+}
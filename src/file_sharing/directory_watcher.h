@@ -0,0 +1,98 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: directory_watcher.h                         *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+#pragma once
+
+// Change notification for the local shared directories. On Linux this is
+// backed by inotify: each shared directory is watched, and the directory
+// updater re-lists only the directories that were reported as modified,
+// instead of sweeping the whole shared hierarchy every few minutes.
+// On other platforms the watcher is never active, and only periodic sweeps
+// are done.
+//
+#include <map>
+#include <string>
+
+#include "retroshare/rstypes.h"
+#include "util/rstime.h"
+
+class DirectoryWatcher
+{
+public:
+    DirectoryWatcher() ;
+    ~DirectoryWatcher() ;
+
+    struct ChangedDir
+    {
+        RsFileHash dir_hash ;       // hash of the directory in LocalDirectoryStorage, which is stable even if its index changes
+        uint32_t depth ;
+        rstime_t last_event_TS ;    // time of the most recent change notification
+    };
+
+    /*!
+     * \brief isActive
+     * 			true when changes are being notified. When false, the directory updater must rely on full sweeps.
+     */
+    bool isActive() const { return mFd >= 0 ; }
+
+    /*!
+     * \brief beginRefresh/endRefresh
+     * 			Surround a full sweep of the shared directories. Watches that were not re-added in between (e.g. for
+     * 			directories that are not shared anymore) are removed by endRefresh(). beginRefresh() also tries to
+     * 			re-activate a watcher that was disabled because of the system limit on the number of watches.
+     */
+    void beginRefresh() ;
+    void endRefresh() ;
+
+    /*!
+     * \brief addWatch
+     * 			Watches a directory, or refreshes the watch if it already exists.
+     * \return false if the watch cannot be added. If the limit of watches of the system is reached, the watcher
+     * 			deactivates itself so that the directory updater falls back to full sweeps.
+     */
+    bool addWatch(const std::string& path, const RsFileHash& dir_hash, uint32_t depth) ;
+
+    /*!
+     * \brief collectChanges
+     * 			Reads pending notifications, without blocking, and adds the modified directories to changed_dirs
+     * 			(indexed by full path).
+     * \return false if notifications have been lost, in which case a full sweep is needed.
+     */
+    bool collectChanges(std::map<std::string,ChangedDir>& changed_dirs) ;
+
+    uint32_t nbWatches() const { return mWatches.size() ; }
+
+private:
+    struct WatchedDir
+    {
+        std::string path ;
+        RsFileHash dir_hash ;
+        uint32_t depth ;
+        uint32_t refresh_round ;
+    };
+
+    void init() ;
+    void shutdown() ;
+
+    int mFd ;
+    uint32_t mRefreshRound ;
+    std::map<int,WatchedDir> mWatches ;	// watch descriptor => directory
+};
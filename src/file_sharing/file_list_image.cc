@@ -0,0 +1,358 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: file_list_image.cc                          *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <string.h>
+#include <zlib.h>
+
+#include "file_sharing/filelist_io.h"
+#include "file_sharing/file_list_image.h"
+#include "util/rsdebug.h"
+#include "util/rsmemory.h"
+
+static_assert(sizeof(FileListImage::NodeRecord) == 80, "NodeRecord must have a fixed layout") ;
+
+// Sizes above this are considered as corrupted data, rather than trying to allocate them.
+
+static const uint32_t FILE_LIST_IMAGE_MAX_SECTION_SIZE = 0x40000000 ;	// 1 GB
+static const uint32_t FILE_LIST_IMAGE_MAX_SECTIONS     = 16 ;
+
+// Images are encrypted with AuthSSL::encrypt(), which takes int sizes. Keep the worst case compressed
+// size well below INT_MAX, so that the encryption envelope (key, IV, padding) still fits.
+
+static const uint64_t FILE_LIST_IMAGE_MAX_SIZE         = 0x7f000000 ;
+
+bool FileListImage::isImage(const unsigned char *data,uint32_t size)
+{
+    if(data == NULL || size < sizeof(Header))
+        return false ;
+
+    uint32_t magic ;
+    memcpy(&magic,data,sizeof(magic)) ;
+
+    return magic == FILE_LIST_IMAGE_MAGIC ;
+}
+
+static bool inflateSection(const unsigned char *in,uint32_t in_size,void *out,uint32_t out_size)
+{
+    if(out_size == 0)
+        return true ;
+
+    uLongf uncompressed_size = out_size ;
+
+    return Z_OK == uncompress((unsigned char*)out,&uncompressed_size,in,in_size) && uncompressed_size == out_size ;
+}
+
+bool FileListImage::load(const unsigned char *data,uint32_t size)
+{
+    mNbNodes = 0 ;
+    mNodes.clear() ;
+    mStrings.clear() ;
+    mChildren.clear() ;
+
+    if(!isImage(data,size))
+        return false ;
+
+    Header header ;
+    memcpy(&header,data,sizeof(header)) ;
+
+    if(header.version != FILE_LIST_IO_LOCAL_DIRECTORY_STORAGE_VERSION_0002)
+    {
+        RsWarn() << __PRETTY_FUNCTION__ << " unknown file list image version " << header.version << std::endl;
+        return false ;
+    }
+
+    if(header.nb_sections > FILE_LIST_IMAGE_MAX_SECTIONS || sizeof(Header) + header.nb_sections*sizeof(SectionEntry) > size
+            || uint64_t(header.nb_nodes)*sizeof(NodeRecord) > FILE_LIST_IMAGE_MAX_SECTION_SIZE)
+    {
+        RsWarn() << __PRETTY_FUNCTION__ << " corrupted file list image header." << std::endl;
+        return false ;
+    }
+
+    bool has_nodes = false ;
+
+    for(uint32_t i=0;i<header.nb_sections;++i)
+    {
+        SectionEntry section ;
+        memcpy(&section,data + sizeof(Header) + i*sizeof(SectionEntry),sizeof(section)) ;
+
+        if(uint64_t(section.offset) + section.compressed_size > size || section.size > FILE_LIST_IMAGE_MAX_SECTION_SIZE)
+        {
+            RsWarn() << __PRETTY_FUNCTION__ << " section " << i << " is out of bounds." << std::endl;
+            return false ;
+        }
+
+        const unsigned char *in = data + section.offset ;
+        bool ok ;
+
+        switch(section.type)
+        {
+        case SECTION_NODES:
+            if(section.size != header.nb_nodes*sizeof(NodeRecord))
+                return false ;
+
+            mNodes.resize(header.nb_nodes) ;
+            ok = inflateSection(in,section.compressed_size,mNodes.data(),section.size) ;
+            has_nodes = true ;
+            break ;
+
+        case SECTION_STRINGS:
+            mStrings.resize(section.size) ;
+            ok = inflateSection(in,section.compressed_size,mStrings.data(),section.size) ;
+            break ;
+
+        case SECTION_CHILDREN:
+            if(section.size % sizeof(uint32_t))
+                return false ;
+
+            mChildren.resize(section.size / sizeof(uint32_t)) ;
+            ok = inflateSection(in,section.compressed_size,mChildren.data(),section.size) ;
+            break ;
+
+        default:
+            ok = true ;		// sections added by later versions are skipped.
+            break ;
+        }
+
+        if(!ok)
+        {
+            RsWarn() << __PRETTY_FUNCTION__ << " cannot uncompress section " << i << ". Data is corrupted." << std::endl;
+            return false ;
+        }
+    }
+
+    if(!has_nodes)
+        return false ;
+
+    mNbNodes = header.nb_nodes ;
+
+    if(!checkIndexes())
+    {
+        RsWarn() << __PRETTY_FUNCTION__ << " file list image references entries out of range. Data is corrupted." << std::endl;
+        mNbNodes = 0 ;
+        return false ;
+    }
+    return true ;
+}
+
+bool FileListImage::checkIndexes() const
+{
+    for(uint32_t i=0;i<mNbNodes;++i)
+    {
+        const NodeRecord& rec(mNodes[i]) ;
+
+        if(rec.type == NODE_EMPTY)
+            continue ;
+
+        if(rec.type != NODE_FILE && rec.type != NODE_DIR)
+            return false ;
+
+        if(rec.parent_index >= mNbNodes)
+            return false ;
+
+        if(rec.type == NODE_FILE)
+            continue ;
+
+        const uint32_t *subdirs, *subfiles ;
+
+        if(!getChildren(rec,subdirs,subfiles))
+            return false ;
+
+        for(uint32_t j=0;j<rec.nb_subdirs + rec.nb_subfiles;++j)
+            if(subdirs[j] >= mNbNodes)
+                return false ;
+    }
+    return true ;
+}
+
+const FileListImage::NodeRecord *FileListImage::node(uint32_t index) const
+{
+    if(index >= mNbNodes)
+        return NULL ;
+
+    return &mNodes[index] ;
+}
+
+bool FileListImage::getString(uint32_t offset,uint32_t size,std::string& s) const
+{
+    if(uint64_t(offset) + size > mStrings.size())
+        return false ;
+
+    s.assign(mStrings.data() + offset,size) ;
+    return true ;
+}
+
+bool FileListImage::getName(const NodeRecord& rec,std::string& name) const
+{
+    return getString(rec.name_offset,rec.name_size,name) ;
+}
+
+bool FileListImage::getParentPath(const NodeRecord& rec,std::string& path) const
+{
+    return getString(rec.path_offset,rec.path_size,path) ;
+}
+
+bool FileListImage::getChildren(const NodeRecord& rec,const uint32_t *& subdirs,const uint32_t *& subfiles) const
+{
+    if(uint64_t(rec.children_offset) + rec.nb_subdirs + rec.nb_subfiles > mChildren.size())
+        return false ;
+
+    subdirs  = mChildren.data() + rec.children_offset ;
+    subfiles = subdirs + rec.nb_subdirs ;
+
+    return true ;
+}
+
+/******************************************************************************************************************/
+/*                                                     Writer                                                     */
+/******************************************************************************************************************/
+
+FileListImage::NodeRecord& FileListImageWriter::record(uint32_t index)
+{
+    if(index >= mNodes.size())
+        mNodes.resize(index+1,FileListImage::NodeRecord()) ;
+
+    return mNodes[index] ;
+}
+
+uint32_t FileListImageWriter::addString(const std::string& s)
+{
+    uint32_t offset = mStrings.size() ;
+    mStrings.append(s) ;
+
+    return offset ;
+}
+
+void FileListImageWriter::addFile(uint32_t index,uint32_t parent_index,uint32_t row,const std::string& name,uint64_t size,const RsFileHash& hash,uint32_t modtime)
+{
+    FileListImage::NodeRecord& rec(record(index)) ;
+
+    rec.type         = FileListImage::NODE_FILE ;
+    rec.parent_index = parent_index ;
+    rec.row          = row ;
+    rec.name_offset  = addString(name) ;
+    rec.name_size    = name.size() ;
+    rec.modtime      = modtime ;
+    rec.file_size    = size ;
+
+    memcpy(rec.hash,hash.toByteArray(),sizeof(rec.hash)) ;
+}
+
+void FileListImageWriter::addDir(uint32_t index,uint32_t parent_index,uint32_t row,const std::string& name,const std::string& parent_path,const RsFileHash& hash,
+                                 uint32_t modtime,uint32_t update_time,uint32_t most_recent_time,
+                                 const std::vector<uint32_t>& subdirs,const std::vector<uint32_t>& subfiles)
+{
+    FileListImage::NodeRecord& rec(record(index)) ;
+
+    rec.type             = FileListImage::NODE_DIR ;
+    rec.parent_index     = parent_index ;
+    rec.row              = row ;
+    rec.name_offset      = addString(name) ;
+    rec.name_size        = name.size() ;
+    rec.path_offset      = addString(parent_path) ;
+    rec.path_size        = parent_path.size() ;
+    rec.modtime          = modtime ;
+    rec.update_time      = update_time ;
+    rec.most_recent_time = most_recent_time ;
+    rec.children_offset  = mChildren.size() ;
+    rec.nb_subdirs       = subdirs.size() ;
+    rec.nb_subfiles      = subfiles.size() ;
+
+    memcpy(rec.hash,hash.toByteArray(),sizeof(rec.hash)) ;
+
+    mChildren.insert(mChildren.end(),subdirs.begin(),subdirs.end()) ;
+    mChildren.insert(mChildren.end(),subfiles.begin(),subfiles.end()) ;
+}
+
+bool FileListImageWriter::finish(uint32_t nb_nodes,unsigned char *& data,uint32_t& size)
+{
+    data = NULL ;
+    size = 0 ;
+
+    if(nb_nodes < mNodes.size())
+        return false ;
+
+    mNodes.resize(nb_nodes,FileListImage::NodeRecord()) ;
+
+    const uint32_t nb_sections = 3 ;
+    const uint32_t types[nb_sections] = { FileListImage::SECTION_NODES, FileListImage::SECTION_STRINGS, FileListImage::SECTION_CHILDREN } ;
+    const unsigned char *raw[nb_sections] = { (const unsigned char*)mNodes.data(), (const unsigned char*)mStrings.data(), (const unsigned char*)mChildren.data() } ;
+    const uint64_t raw_size[nb_sections] = { uint64_t(mNodes.size())*sizeof(FileListImage::NodeRecord), mStrings.size(), uint64_t(mChildren.size())*sizeof(uint32_t) } ;
+
+    uint64_t total_size = sizeof(FileListImage::Header) + nb_sections*sizeof(FileListImage::SectionEntry) ;
+
+    for(uint32_t i=0;i<nb_sections;++i)
+    {
+        if(raw_size[i] > FILE_LIST_IMAGE_MAX_SECTION_SIZE)
+        {
+            RsErr() << __PRETTY_FUNCTION__ << " file list section " << types[i] << " is too large: " << raw_size[i] << " bytes." << std::endl;
+            return false ;
+        }
+        total_size += compressBound(raw_size[i]) ;
+    }
+
+    if(total_size > FILE_LIST_IMAGE_MAX_SIZE)
+    {
+        RsErr() << __PRETTY_FUNCTION__ << " file list image is too large: up to " << total_size << " bytes." << std::endl;
+        return false ;
+    }
+
+    unsigned char *out = (unsigned char*)rs_malloc(total_size) ;
+
+    if(!out)
+        return false ;
+
+    FileListImage::Header header ;
+    header.magic       = FILE_LIST_IMAGE_MAGIC ;
+    header.version     = FILE_LIST_IO_LOCAL_DIRECTORY_STORAGE_VERSION_0002 ;
+    header.nb_nodes    = nb_nodes ;
+    header.nb_sections = nb_sections ;
+
+    memcpy(out,&header,sizeof(header)) ;
+
+    uint32_t offset = sizeof(FileListImage::Header) + nb_sections*sizeof(FileListImage::SectionEntry) ;
+
+    for(uint32_t i=0;i<nb_sections;++i)
+    {
+        uLongf compressed_size = total_size - offset ;
+
+        if(Z_OK != compress2(out + offset,&compressed_size,raw[i],raw_size[i],Z_DEFAULT_COMPRESSION))
+        {
+            RsErr() << __PRETTY_FUNCTION__ << " cannot compress file list section " << types[i] << std::endl;
+            free(out) ;
+            return false ;
+        }
+
+        FileListImage::SectionEntry section ;
+        section.type            = types[i] ;
+        section.offset          = offset ;
+        section.compressed_size = compressed_size ;
+        section.size            = raw_size[i] ;
+
+        memcpy(out + sizeof(FileListImage::Header) + i*sizeof(FileListImage::SectionEntry),&section,sizeof(section)) ;
+        offset += compressed_size ;
+    }
+
+    data = out ;
+    size = offset ;
+
+    return true ;
+}
@@ -0,0 +1,137 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: file_list_image.h                           *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+#pragma once
+
+// Version 2 of the file hierarchy storage format. Once decrypted, a file list
+// is made of a fixed header, a section table, and zlib-compressed sections:
+//
+//   NODES    : one fixed-size NodeRecord per entry index
+//   STRINGS  : file/dir names and parent paths, not zero-terminated
+//   CHILDREN : indices of sub-directories and sub-files, referenced by dir records
+//
+// After a section is inflated, node records are read in place. There is no
+// per-field parsing like in the TLV format of FileListIO. Parent and child indexes
+// are range-checked once, when the image is loaded.
+// InternalFileHierarchyStorage still copies every record into its own FileEntry and
+// DirEntry nodes at load time: the image speeds up decoding, not memory usage.
+// As with FileListIO, the encoding depends on the host byte order, so it should *not* be
+// used to exchange data between computers.
+//
+#include <string>
+#include <vector>
+
+#include "retroshare/rstypes.h"
+
+static const uint32_t FILE_LIST_IMAGE_MAGIC = 0x4c465352 ;	// "RSFL"
+
+class FileListImage
+{
+public:
+    enum NodeType { NODE_EMPTY = 0x00, NODE_FILE = 0x01, NODE_DIR = 0x02 } ;
+    enum SectionType { SECTION_NODES = 0x01, SECTION_STRINGS = 0x02, SECTION_CHILDREN = 0x03 } ;
+
+    struct Header
+    {
+        uint32_t magic ;
+        uint32_t version ;
+        uint32_t nb_nodes ;
+        uint32_t nb_sections ;
+    };
+
+    struct SectionEntry
+    {
+        uint32_t type ;
+        uint32_t offset ;			// from the start of the image
+        uint32_t compressed_size ;
+        uint32_t size ;
+    };
+
+    struct NodeRecord
+    {
+        uint8_t  type ;
+        uint8_t  reserved[3] ;
+        uint32_t parent_index ;
+        uint32_t row ;
+        uint32_t name_offset ;		// in STRINGS
+        uint32_t name_size ;
+        uint32_t modtime ;
+        uint64_t file_size ;		// files only
+        uint8_t  hash[20] ;			// file hash or dir hash
+        uint32_t update_time ;		// dirs only
+        uint32_t most_recent_time ;	// dirs only
+        uint32_t path_offset ;		// dirs only, in STRINGS
+        uint32_t path_size ;
+        uint32_t children_offset ;	// dirs only, in CHILDREN. Sub-dirs come first, then sub-files.
+        uint32_t nb_subdirs ;
+        uint32_t nb_subfiles ;
+    };
+
+    FileListImage() : mNbNodes(0) {}
+
+    /// Returns true when the data starts with the header of a file list image.
+    static bool isImage(const unsigned char *data,uint32_t size) ;
+
+    /// Checks the header, inflates all sections and checks that all indexes are in range.
+    bool load(const unsigned char *data,uint32_t size) ;
+
+    uint32_t nbNodes() const { return mNbNodes ; }
+
+    /// Returns the record of the given entry index, or NULL if the index is out of range.
+    const NodeRecord *node(uint32_t index) const ;
+
+    bool getName(const NodeRecord& rec,std::string& name) const ;
+    bool getParentPath(const NodeRecord& rec,std::string& path) const ;
+    bool getChildren(const NodeRecord& rec,const uint32_t *& subdirs,const uint32_t *& subfiles) const ;
+
+    static RsFileHash hash(const NodeRecord& rec) { return RsFileHash::fromBufferUnsafe(rec.hash) ; }
+
+private:
+    bool getString(uint32_t offset,uint32_t size,std::string& s) const ;
+    bool checkIndexes() const ;
+
+    uint32_t mNbNodes ;
+    std::vector<NodeRecord> mNodes ;
+    std::vector<char> mStrings ;
+    std::vector<uint32_t> mChildren ;
+};
+
+class FileListImageWriter
+{
+public:
+    FileListImageWriter() {}
+
+    void addFile(uint32_t index,uint32_t parent_index,uint32_t row,const std::string& name,uint64_t size,const RsFileHash& hash,uint32_t modtime) ;
+    void addDir(uint32_t index,uint32_t parent_index,uint32_t row,const std::string& name,const std::string& parent_path,const RsFileHash& hash,
+                uint32_t modtime,uint32_t update_time,uint32_t most_recent_time,
+                const std::vector<uint32_t>& subdirs,const std::vector<uint32_t>& subfiles) ;
+
+    /// Compresses all sections. The image is allocated with malloc() and must be freed by the caller.
+    bool finish(uint32_t nb_nodes,unsigned char *& data,uint32_t& size) ;
+
+private:
+    FileListImage::NodeRecord& record(uint32_t index) ;
+    uint32_t addString(const std::string& s) ;
+
+    std::vector<FileListImage::NodeRecord> mNodes ;
+    std::string mStrings ;
+    std::vector<uint32_t> mChildren ;
+};
@@ -22,6 +22,7 @@
 #pragma once
 
 static const uint32_t DELAY_BETWEEN_DIRECTORY_UPDATES           =  600 ; // 10 minutes
+static const uint32_t DELAY_BETWEEN_WATCHED_DIRECTORY_UPDATES   = 6*3600 ; // 6 hours. Full sweeps are only a safety net when directory changes are notified.
 static const uint32_t DELAY_BETWEEN_REMOTE_DIRECTORY_SYNC_REQ   =  120 ; // 2 minutes
 static const uint32_t DELAY_BETWEEN_LOCAL_DIRECTORIES_TS_UPDATE =   20 ; // 20 sec. But we only update for real if something has changed.
 static const uint32_t DELAY_BETWEEN_REMOTE_DIRECTORIES_SWEEP    =   60 ; // 60 sec.
@@ -49,8 +50,14 @@ static const std::string LOCAL_SHARED_DIRS_FILE_NAME = "local_dir_hierarchy.bin"
 static const uint32_t MIN_INTERVAL_BETWEEN_HASH_CACHE_SAVE         = 20 ;    // never save hash cache more often than every 20 secs.
 static const uint32_t MIN_INTERVAL_BETWEEN_REMOTE_DIRECTORY_SAVE   = 23 ;    // never save remote directories more often than this
 static const uint32_t MIN_TIME_AFTER_LAST_MODIFICATION             = 10 ;    // never hash a file that is just being modified, otherwise we end up with a corrupted hash
+static const uint32_t DIRECTORY_SCANNER_THREADS                    = 8 ;     // threads reading shared directories in advance during full sweeps
+static const uint32_t DIRECTORY_SCANNER_MAX_READS_PER_DEVICE       = 4 ;     // concurrent directory reads on a single device (mount point)
 
 static const uint32_t MAX_DIR_SYNC_RESPONSE_DATA_SIZE              = 20000 ; // Maximum RsItem data size in bytes for serialised directory transmission
+static const uint32_t MAX_SUBTREE_SYNC_BATCH_SIZE                  = 512*1024 ; // uncompressed size above which no more directories are added to a sub-tree sync batch
+static const uint32_t MAX_SUBTREE_SYNC_BATCH_RECV_SIZE             = 2*MAX_SUBTREE_SYNC_BATCH_SIZE ; // max uncompressed size of a batch. Directories that do not fit are sent in a batch of their own, or as plain directory content.
+static const uint32_t MAX_SUBTREE_SYNC_KNOWN_DIRS                  = 4096 ;  // directories for which the last known TS is sent in a sub-tree sync request
+static const uint32_t MAX_PENDING_SUBTREE_SYNC_REQUESTS            = 4 ;     // sub-tree sync requests pipelined to each friend
 static const uint32_t DEFAULT_HASH_STORAGE_DURATION_DAYS           = 30 ;    // remember deleted/inaccessible files for 30 days
 
 static const uint32_t NB_FRIEND_INDEX_BITS_32BITS                    = 10 ;			// Do not change this!
@@ -27,7 +27,7 @@
 #include "serialiser/rsbaseserial.h"
 #include "filelist_io.h"
 
-FileListIO::read_error::read_error(unsigned char *sec,uint32_t size,uint32_t offset,uint8_t expected_tag)
+FileListIO::read_error::read_error(const unsigned char *sec,uint32_t size,uint32_t offset,uint8_t expected_tag)
 {
 	std::ostringstream s ;
 	s << "At offset " << offset << "/" << size << ": expected section tag " << std::hex << (int)expected_tag << std::dec << " but got " << RsUtil::BinToHex(&sec[offset],std::min((int)size-(int)offset, 15)) << "..." << std::endl;
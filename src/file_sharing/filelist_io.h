@@ -31,6 +31,7 @@
 // WARNING: the encoding is system-dependent, so this should *not* be used to exchange data between computers.
 
 static const uint32_t FILE_LIST_IO_LOCAL_DIRECTORY_STORAGE_VERSION_0001 =  0x00000001 ;
+static const uint32_t FILE_LIST_IO_LOCAL_DIRECTORY_STORAGE_VERSION_0002 =  0x00000002 ;	// see file_list_image.h
 static const uint32_t FILE_LIST_IO_LOCAL_DIRECTORY_TREE_VERSION_0001    =  0x00010001 ;
 
 static const uint8_t FILE_LIST_IO_TAG_UNKNOWN                   =  0x00 ;
@@ -93,7 +94,7 @@ public:
 	class read_error
 	{
 	public:
-		read_error(unsigned char *sec,uint32_t size,uint32_t offset,uint8_t expected_tag);
+		read_error(const unsigned char *sec,uint32_t size,uint32_t offset,uint8_t expected_tag);
 		read_error(const std::string& s) : err_string(s) {}
 
 		const std::string& what() const { return err_string ; }
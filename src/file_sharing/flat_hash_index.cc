@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: flat_hash_index.cc                          *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <algorithm>
+
+#include "file_sharing/flat_hash_index.h"
+
+// The delta is merged when it exceeds this fraction of the sorted entries, which keeps the amortized cost of an update constant.
+
+static const size_t FLAT_HASH_INDEX_MIN_DELTA_SIZE = 256 ;
+static const size_t FLAT_HASH_INDEX_DELTA_RATIO    = 8 ;
+
+const FlatHashIndex::Entry *FlatHashIndex::findSorted(const RsFileHash& hash) const
+{
+    std::vector<Entry>::const_iterator it = std::lower_bound(mSorted.begin(),mSorted.end(),hash,compareHash) ;
+
+    if(it == mSorted.end() || it->hash != hash)
+        return NULL ;
+
+    return &*it ;
+}
+
+bool FlatHashIndex::find(const RsFileHash& hash,EntryIndex& index) const
+{
+    std::map<RsFileHash,EntryIndex>::const_iterator it = mDelta.find(hash) ;
+
+    if(it != mDelta.end())
+    {
+        if(it->second == DirectoryStorage::NO_INDEX)
+            return false ;
+
+        index = it->second ;
+        return true ;
+    }
+
+    const Entry *e = findSorted(hash) ;
+
+    if(!e)
+        return false ;
+
+    index = e->index ;
+    return true ;
+}
+
+void FlatHashIndex::set(const RsFileHash& hash,EntryIndex index)
+{
+    EntryIndex old_index ;
+
+    if(!find(hash,old_index))
+        ++mSize ;
+
+    mDelta[hash] = index ;
+
+    if(mDelta.size() > std::max(FLAT_HASH_INDEX_MIN_DELTA_SIZE,mSorted.size() / FLAT_HASH_INDEX_DELTA_RATIO))
+        mergeDelta() ;
+}
+
+void FlatHashIndex::erase(const RsFileHash& hash)
+{
+    EntryIndex old_index ;
+
+    if(!find(hash,old_index))
+        return ;
+
+    --mSize ;
+
+    if(findSorted(hash))
+        mDelta[hash] = DirectoryStorage::NO_INDEX ;
+    else
+        mDelta.erase(hash) ;
+}
+
+void FlatHashIndex::clear()
+{
+    mSorted.clear() ;
+    mDelta.clear() ;
+    mSize = 0 ;
+}
+
+void FlatHashIndex::assign(std::vector<std::pair<RsFileHash,EntryIndex> >& entries)
+{
+    std::stable_sort(entries.begin(),entries.end(),[](const std::pair<RsFileHash,EntryIndex>& a,const std::pair<RsFileHash,EntryIndex>& b) { return a.first < b.first ; }) ;
+
+    mSorted.clear() ;
+    mSorted.reserve(entries.size()) ;
+    mDelta.clear() ;
+
+    for(uint32_t i=0;i<entries.size();++i)
+        if(i+1 == entries.size() || entries[i+1].first != entries[i].first)
+            mSorted.push_back(Entry{entries[i].first,entries[i].second}) ;
+
+    mSize = mSorted.size() ;
+}
+
+void FlatHashIndex::mergeDelta()
+{
+    std::vector<Entry> merged ;
+    merged.reserve(mSize) ;
+
+    forEach([&merged](const RsFileHash& hash,EntryIndex index) { merged.push_back(Entry{hash,index}) ; }) ;
+
+    mSorted.swap(merged) ;
+    mDelta.clear() ;
+}
@@ -0,0 +1,92 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: flat_hash_index.h                           *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "retroshare/rstypes.h"
+#include "file_sharing/directory_storage.h"
+
+// Maps file and directory hashes to entry indexes. The bulk of the entries is
+// kept in a vector sorted by hash, which costs 24 bytes per entry instead of
+// the ~80 bytes of a std::map node. Recent changes are kept in a small map and
+// merged into the sorted vector once it grows too large, so that updates stay
+// cheap while the hierarchy is being synced or hashed.
+//
+class FlatHashIndex
+{
+public:
+    typedef DirectoryStorage::EntryIndex EntryIndex ;
+
+    FlatHashIndex() : mSize(0) {}
+
+    bool find(const RsFileHash& hash,EntryIndex& index) const ;
+    void set(const RsFileHash& hash,EntryIndex index) ;
+    void erase(const RsFileHash& hash) ;
+    void clear() ;
+
+    /// Replaces the whole content, which is much faster than calling set() for each entry.
+    /// When a hash appears more than once, the last entry wins, as with set().
+    void assign(std::vector<std::pair<RsFileHash,EntryIndex> >& entries) ;
+
+    size_t size() const { return mSize ; }
+
+    /// Calls f(hash,index) for each entry, in increasing hash order.
+    template<class F> void forEach(F f) const
+    {
+        std::vector<Entry>::const_iterator sit = mSorted.begin() ;
+        std::map<RsFileHash,EntryIndex>::const_iterator dit = mDelta.begin() ;
+
+        while(sit != mSorted.end() || dit != mDelta.end())
+            if(dit == mDelta.end() || (sit != mSorted.end() && sit->hash < dit->first))
+            {
+                f(sit->hash,sit->index) ;
+                ++sit ;
+            }
+            else
+            {
+                if(sit != mSorted.end() && sit->hash == dit->first)	// the delta overrides the sorted entry
+                    ++sit ;
+
+                if(dit->second != DirectoryStorage::NO_INDEX)
+                    f(dit->first,dit->second) ;
+                ++dit ;
+            }
+    }
+
+private:
+    struct Entry
+    {
+        RsFileHash hash ;
+        EntryIndex index ;
+    };
+
+    static bool compareHash(const Entry& e,const RsFileHash& h) { return e.hash < h ; }
+
+    const Entry *findSorted(const RsFileHash& hash) const ;
+    void mergeDelta() ;
+
+    std::vector<Entry> mSorted ;
+    std::map<RsFileHash,EntryIndex> mDelta ;	// recent changes. NO_INDEX marks a removed entry.
+    size_t mSize ;
+};
@@ -28,6 +28,7 @@
 #include "file_sharing/directory_updater.h"
 #include "file_sharing/rsfilelistitems.h"
 #include "file_sharing/file_sharing_defaults.h"
+#include "file_sharing/dir_sync_batch.h"
 
 #include "retroshare/rsids.h"
 #include "retroshare/rspeers.h"
@@ -154,7 +155,10 @@ p3FileDatabase::~p3FileDatabase()
 
 const std::string FILE_DB_APP_NAME = "file_database";
 const uint16_t FILE_DB_APP_MAJOR_VERSION	= 	1;
-const uint16_t FILE_DB_APP_MINOR_VERSION  = 	0;
+const uint16_t FILE_DB_APP_MINOR_VERSION  = 	1;
+
+// first minor version that answers RsFileListsSubtreeSyncRequestItem
+const uint16_t FILE_DB_SUBTREE_SYNC_MINOR_VERSION  = 	1;
 const uint16_t FILE_DB_MIN_MAJOR_VERSION  = 	1;
 const uint16_t FILE_DB_MIN_MINOR_VERSION	=	0;
 
@@ -235,7 +239,7 @@ int p3FileDatabase::tick()
                   mRemoteDirectories[i]->print();
 #endif
 
-                  locked_recursSweepRemoteDirectory(mRemoteDirectories[i],mRemoteDirectories[i]->root(),0) ;
+                  locked_sweepRemoteDirectory(mRemoteDirectories[i]) ;
                   mRemoteDirectories[i]->lastSweepTime() = now ;
                }
 
@@ -1607,6 +1611,7 @@ void p3FileDatabase::tickRecv()
       switch(item->PacketSubType())
       {
       case RS_PKT_SUBTYPE_FILELISTS_SYNC_REQ_ITEM:       handleDirSyncRequest( dynamic_cast<RsFileListsSyncRequestItem*>(item) ) ;     break ;
+      case RS_PKT_SUBTYPE_FILELISTS_SUBTREE_SYNC_REQ_ITEM: handleDirSubtreeSyncRequest( dynamic_cast<RsFileListsSubtreeSyncRequestItem*>(item) ) ; break ;
       case RS_PKT_SUBTYPE_FILELISTS_BANNED_HASHES_ITEM : handleBannedFilesInfo( dynamic_cast<RsFileListsBannedHashesItem*>(item) ) ;   break ;
       case RS_PKT_SUBTYPE_FILELISTS_SYNC_RSP_ITEM:
 	  {
@@ -1716,6 +1721,155 @@ void p3FileDatabase::handleDirSyncRequest(RsFileListsSyncRequestItem *item)
 	splitAndSendItem(ritem);
 }
 
+void p3FileDatabase::handleDirSubtreeSyncRequest(RsFileListsSubtreeSyncRequestItem *item)
+{
+	RsFileListsSyncResponseItem* ritem = new RsFileListsSyncResponseItem;
+
+	ritem->PeerId(item->PeerId());
+	ritem->request_id = item->request_id;
+	ritem->entry_hash = item->entry_hash;
+
+	{
+		RS_STACK_MUTEX(mFLSMtx);
+
+		RS_DBG( "Received sub-tree sync request from peer ", item->PeerId(),
+		        ". hash=", item->entry_hash, ", request id: ", item->request_id,
+		        ", known dirs: ", item->known_dirs.size() );
+
+		EntryIndex entry_index = DirectoryStorage::NO_INDEX;
+		if(!mLocalSharedDirs->getIndexFromDirHash(item->entry_hash,entry_index))
+		{
+			RS_DBG("Cannot find entry index for hash ", item->entry_hash,
+			       " cannot respond to sync request." );
+			delete ritem;
+			return;
+		}
+
+		auto isBrowsable = [&](EntryIndex e)
+		{
+			std::list<RsNodeGroupId> node_groups;
+			FileStorageFlags node_flags;
+
+			return mLocalSharedDirs->getFileSharingPermissions(
+			            e, node_flags, node_groups ) &&
+			        (rsPeers->computePeerPermissionFlags(
+			             item->PeerId(), node_flags, node_groups ) &
+			         RS_FILE_HINTS_BROWSABLE);
+		};
+
+		if( mLocalSharedDirs->getEntryType(entry_index) != DIR_TYPE_DIR ||
+		        (entry_index != 0 && !isBrowsable(entry_index)) )
+		{
+			/* same answer as for a single directory, which the requester
+			 * handles the same way in both cases. */
+			ritem->flags = RsFileListsItem::FLAGS_SYNC_RESPONSE |
+			        RsFileListsItem::FLAGS_ENTRY_WAS_REMOVED;
+		}
+		else
+		{
+			/* Walk the sub-tree depth first, so that parent directories are
+			 * always received before their sub-directories. Unchanged
+			 * sub-trees are only acknowledged. What does not fit in the batch
+			 * is left for further requests. */
+			DirSyncBatchWriter batch( MAX_SUBTREE_SYNC_BATCH_SIZE,
+			                          MAX_SUBTREE_SYNC_BATCH_RECV_SIZE );
+			std::vector<EntryIndex> stack(1,entry_index);
+			bool send_dir_content = false;
+
+			while(!stack.empty() && !batch.full())
+			{
+				EntryIndex e = stack.back();
+				stack.pop_back();
+
+				RsFileHash dir_hash;
+				rstime_t local_recurs_max_time;
+
+				if( !mLocalSharedDirs->getDirHashFromIndex(e,dir_hash) ||
+				        !mLocalSharedDirs->getDirectoryRecursModTime(
+				            e, local_recurs_max_time ) )
+					continue;
+
+				auto it = item->known_dirs.find(dir_hash);
+
+				if( it != item->known_dirs.end() &&
+				        it->second == (uint32_t)local_recurs_max_time )
+				{
+					batch.addUpToDate(dir_hash);
+					continue;
+				}
+
+				RsTlvBinaryData dir_data;
+
+				if(!mLocalSharedDirs->serialiseDirEntry(
+				            e, dir_data, item->PeerId() ))
+				{
+					RS_ERR("Cannot serialise directory index: ", e);
+					break;
+				}
+
+				if(!batch.addContent(dir_hash, dir_data))
+				{
+					/* A directory that does not fit is left for a later
+					 * request, of which it will be the root. A root that does
+					 * not fit alone is sent as plain directory content, which
+					 * the requester accepts in response to any sync request.
+					 */
+					if(batch.empty())
+					{
+						ritem->directory_content_data.setBinData(
+						            dir_data.bin_data, dir_data.bin_len );
+						send_dir_content = true;
+					}
+					else
+						stack.push_back(e);
+					break;
+				}
+
+				// sub-dirs of the root are filtered like in serialiseDirEntry()
+				std::vector<EntryIndex> subdirs;
+				for( DirectoryStorage::DirIterator sit(mLocalSharedDirs,e);
+				     sit; ++sit )
+					if(e != 0 || isBrowsable(*sit))
+						subdirs.push_back(*sit);
+
+				stack.insert(stack.end(), subdirs.rbegin(), subdirs.rend());
+			}
+
+			rstime_t local_recurs_max_time = 0;
+			mLocalSharedDirs->getDirectoryRecursModTime(
+			            entry_index, local_recurs_max_time );
+
+			ritem->last_known_recurs_modf_TS = local_recurs_max_time;
+
+			if(send_dir_content)
+			{
+				RS_DBG( "Directory ", entry_index, " does not fit in a batch. "
+				        "Sending its content to peer ", item->PeerId() );
+
+				ritem->flags = RsFileListsItem::FLAGS_SYNC_RESPONSE |
+				        RsFileListsItem::FLAGS_SYNC_DIR_CONTENT;
+			}
+			else
+			{
+				ritem->flags = RsFileListsItem::FLAGS_SYNC_RESPONSE |
+				        RsFileListsItem::FLAGS_SYNC_SUBTREE;
+
+				RS_DBG( "Sending ", batch.nbRecords(), " directories to peer ",
+				        item->PeerId(), ", ", stack.size(), " left for later." );
+
+				if(!batch.finish(ritem->directory_content_data))
+				{
+					RS_ERR("Cannot compress sub-tree sync batch.");
+					delete ritem;
+					return;
+				}
+			}
+		}
+	}
+
+	splitAndSendItem(ritem);
+}
+
 void p3FileDatabase::splitAndSendItem(RsFileListsSyncResponseItem *ritem)
 {
     ritem->checksum = RsDirUtil::sha1sum((uint8_t*)ritem->directory_content_data.bin_data,ritem->directory_content_data.bin_len);
@@ -1868,6 +2022,7 @@ void p3FileDatabase::handleDirSyncResponse(RsFileListsSyncResponseItem*& sitem)
     // find the correct friend entry
 
     uint32_t fi = 0 ;
+    bool subtree_probe = false ;
 
     {
         RS_STACK_MUTEX(mFLSMtx) ;
@@ -1888,9 +2043,24 @@ void p3FileDatabase::handleDirSyncResponse(RsFileListsSyncResponseItem*& sitem)
 #ifdef DEBUG_P3FILELISTS
         P3FILELISTS_DEBUG() << "  entry index is " << entry_index << " " ;
 #endif
+        auto it = mPendingSyncRequests.find(item->request_id) ;
+        subtree_probe = it != mPendingSyncRequests.end() && it->second.subtree_probe ;
     }
 
-    if(item->flags & RsFileListsItem::FLAGS_ENTRY_WAS_REMOVED)
+    if(item->flags & RsFileListsItem::FLAGS_SYNC_SUBTREE)
+    {
+        RS_STACK_MUTEX(mFLSMtx) ;
+
+        if(mLastDataRecvTS + 1 < now) // avoid notifying the GUI too often as it kills performance.
+		{
+			RsServer::notify()->notifyListPreChange(NOTIFY_LIST_DIRLIST_FRIENDS, 0);
+			mLastDataRecvTS = now;
+		}
+
+        if(!locked_updateFromSubtreeBatch(mRemoteDirectories[fi],item->directory_content_data,now))
+            P3FILELISTS_ERROR() << "(EE) Cannot process sub-tree sync batch from peer " << item->PeerId() << std::endl;
+    }
+    else if(item->flags & RsFileListsItem::FLAGS_ENTRY_WAS_REMOVED)
     {
         RS_STACK_MUTEX(mFLSMtx) ;
 #ifdef DEBUG_P3FILELISTS
@@ -1909,6 +2079,14 @@ void p3FileDatabase::handleDirSyncResponse(RsFileListsSyncResponseItem*& sitem)
 
         mRemoteDirectories[fi]->setDirectoryUpdateTime(entry_index,now) ;
     }
+    else if(subtree_probe && (item->flags & RsFileListsItem::FLAGS_SYNC_DIR_CONTENT))
+    {
+        // The directory changed. Its content is not used: it comes again in the sub-tree batch requested below, and
+        // updating it now would make the known TS match, so that the friend would skip the whole sub-tree.
+#ifdef DEBUG_P3FILELISTS
+        P3FILELISTS_DEBUG() << "  Directory changed. Asking for its sub-tree." << std::endl;
+#endif
+    }
     else if(item->flags & RsFileListsItem::FLAGS_SYNC_DIR_CONTENT)
     {
 #ifdef DEBUG_P3FILELISTS
@@ -1949,15 +2127,94 @@ void p3FileDatabase::handleDirSyncResponse(RsFileListsSyncResponseItem*& sitem)
             return ;
         }
         mPendingSyncRequests.erase(it) ;
+
+        // keep the pipeline full: the parts of the tree that did not fit in the batch are requested right away.
+
+        if(item->flags & RsFileListsItem::FLAGS_SYNC_SUBTREE)
+            locked_sweepRemoteDirectory(mRemoteDirectories[fi]) ;
+        else if(subtree_probe && (item->flags & RsFileListsItem::FLAGS_SYNC_DIR_CONTENT))
+            locked_generateAndSendSubtreeSyncRequest(mRemoteDirectories[fi],entry_index) ;
     }
 
 
 }
 
-void p3FileDatabase::locked_recursSweepRemoteDirectory(RemoteDirectoryStorage *rds,DirectoryStorage::EntryIndex e,int depth)
+bool p3FileDatabase::locked_updateFromSubtreeBatch(RemoteDirectoryStorage *rds,const RsTlvBinaryData& batch_data,rstime_t now)
+{
+    DirSyncBatchReader batch ;
+
+    if(!batch.load(batch_data,MAX_SUBTREE_SYNC_BATCH_RECV_SIZE))
+        return false ;
+
+    DirSyncBatchReader::Record record ;
+    uint32_t nb_updated = 0 ;
+
+    // Records come in depth-first order, so each directory has been created by the record of its parent.
+
+    while(batch.next(record))
+    {
+        EntryIndex e = DirectoryStorage::NO_INDEX ;
+
+        if(!rds->getIndexFromDirHash(record.dir_hash,e))
+        {
+            RS_WARN("Cannot find index of directory ", record.dir_hash, " from peer ", rds->peerId(), ". Skipping.");
+            continue ;
+        }
+
+        if(record.type == DirSyncBatchReader::RECORD_UP_TO_DATE)
+            rds->setDirectoryUpdateTime(e,now) ;
+        else if(!rds->deserialiseUpdateDirEntry(e,record.dir_data))
+            return false ;
+
+        ++nb_updated ;
+    }
+
+#ifdef DEBUG_P3FILELISTS
+    P3FILELISTS_DEBUG() << "  updated " << nb_updated << " directories from sub-tree batch." << std::endl;
+#endif
+
+    return batch.atEnd() ;
+}
+
+bool p3FileDatabase::locked_peerSupportsSubtreeSync(const RsPeerId& pid)
+{
+    RsPeerServiceInfo info ;
+
+    if(!mServCtrl->getServicesProvided(pid,info))
+        return false ;
+
+    std::map<uint32_t,RsServiceInfo>::const_iterator it = info.mServiceList.find(getServiceInfo().mServiceType) ;
+
+    return it != info.mServiceList.end() && ( it->second.mVersionMajor > FILE_DB_APP_MAJOR_VERSION ||
+                                              it->second.mVersionMinor >= FILE_DB_SUBTREE_SYNC_MINOR_VERSION ) ;
+}
+
+uint32_t p3FileDatabase::locked_countPendingSubtreeSyncRequests(const RsPeerId& pid) const
+{
+    uint32_t n = 0 ;
+
+    for(auto& it:mPendingSyncRequests)
+        if(it.second.peer_id == pid && ((it.second.flags & RsFileListsItem::FLAGS_SYNC_SUBTREE) || it.second.subtree_probe))
+            ++n ;
+
+    return n ;
+}
+
+void p3FileDatabase::locked_sweepRemoteDirectory(RemoteDirectoryStorage *rds)
+{
+    bool subtree_sync = locked_peerSupportsSubtreeSync(rds->peerId()) ;
+    uint32_t nb_pending_subtrees = locked_countPendingSubtreeSyncRequests(rds->peerId()) ;
+
+    locked_recursSweepRemoteDirectory(rds,rds->root(),0,subtree_sync,nb_pending_subtrees) ;
+}
+
+void p3FileDatabase::locked_recursSweepRemoteDirectory(RemoteDirectoryStorage *rds,DirectoryStorage::EntryIndex e,int depth,bool subtree_sync,uint32_t& nb_pending_subtrees)
 {
    rstime_t now = time(NULL) ;
 
+   if(subtree_sync && nb_pending_subtrees >= MAX_PENDING_SUBTREE_SYNC_REQUESTS)
+       return ;
+
    //std::string indent(2*depth,' ') ;
 
    // if not up to date, request update, and return (content is not certified, so no need to recurs yet).
@@ -1980,15 +2237,31 @@ void p3FileDatabase::locked_recursSweepRemoteDirectory(RemoteDirectoryStorage *r
    // compare TS
 
    if((e == 0 && now > local_update_TS + DELAY_BETWEEN_REMOTE_DIRECTORY_SYNC_REQ) || local_update_TS == 0)	// we need to compare local times only. We cannot compare local (now) with remote time.
+   {
+       // The batch covers the whole sub-tree, including when a request is already pending, so there is no need to go below.
+       // A root that was already received is only checked by its TS. The TS of the known directories below, which may
+       // be thousands, are sent only if the friend reports a change.
+
+       if(subtree_sync)
+       {
+           bool sent = local_update_TS == 0 ? locked_generateAndSendSubtreeSyncRequest(rds,e)
+                                            : locked_generateAndSendSyncRequest(rds,e,true) ;
+           if(sent)
+               ++nb_pending_subtrees ;
+
+           return ;
+       }
+
        if(locked_generateAndSendSyncRequest(rds,e))
        {
 #ifdef DEBUG_P3FILELISTS
            P3FILELISTS_DEBUG() << "  Asking for sync of directory " << e << " to peer " << rds->peerId() << " because it's " << (now - local_update_TS) << " secs old since last check." << std::endl;
 #endif
        }
+   }
 
    for(DirectoryStorage::DirIterator it(rds,e);it;++it)
-       locked_recursSweepRemoteDirectory(rds,*it,depth+1);
+       locked_recursSweepRemoteDirectory(rds,*it,depth+1,subtree_sync,nb_pending_subtrees);
 }
 
 p3FileDatabase::DirSyncRequestId p3FileDatabase::makeDirSyncReqId(const RsPeerId& peer_id,const RsFileHash& hash)
@@ -2016,7 +2289,7 @@ p3FileDatabase::DirSyncRequestId p3FileDatabase::makeDirSyncReqId(const RsPeerId
     return r ;
 }
 
-bool p3FileDatabase::locked_generateAndSendSyncRequest(RemoteDirectoryStorage *rds,const DirectoryStorage::EntryIndex& e)
+bool p3FileDatabase::locked_generateAndSendSyncRequest(RemoteDirectoryStorage *rds,const DirectoryStorage::EntryIndex& e,bool subtree_probe)
 {
     RsFileHash entry_hash ;
     rstime_t now = time(NULL) ;
@@ -2061,6 +2334,7 @@ bool p3FileDatabase::locked_generateAndSendSyncRequest(RemoteDirectoryStorage *r
     data.request_TS = now ;
     data.peer_id = item->PeerId();
     data.flags = item->flags;
+    data.subtree_probe = subtree_probe ;
 
 #ifdef DEBUG_P3FILELISTS
     P3FILELISTS_DEBUG() << "  Pushing req " << std::hex << sync_req_id << std::dec <<  " in pending list with peer id " << data.peer_id << std::endl;
@@ -2073,6 +2347,68 @@ bool p3FileDatabase::locked_generateAndSendSyncRequest(RemoteDirectoryStorage *r
     return true;
 }
 
+bool p3FileDatabase::locked_generateAndSendSubtreeSyncRequest(RemoteDirectoryStorage *rds,const DirectoryStorage::EntryIndex& e)
+{
+    RsFileHash entry_hash ;
+
+    if(!rds->getDirHashFromIndex(e,entry_hash) )
+    {
+        P3FILELISTS_ERROR() << "  (EE) cannot find hash for entry index " << e << ". This is very unexpected." << std::endl;
+        return false;
+    }
+
+    DirSyncRequestId sync_req_id = makeDirSyncReqId(rds->peerId(),entry_hash) ;
+
+    if(mPendingSyncRequests.find(sync_req_id) != mPendingSyncRequests.end())
+        return false ;
+
+    RsFileListsSubtreeSyncRequestItem *item = new RsFileListsSubtreeSyncRequestItem ;
+
+    item->entry_hash = entry_hash ;
+    item->flags = RsFileListsItem::FLAGS_SYNC_REQUEST | RsFileListsItem::FLAGS_SYNC_SUBTREE ;
+    item->request_id = sync_req_id ;
+    item->PeerId(rds->peerId()) ;
+
+    // Collect the TS of the directories we already know in the sub-tree, closest to the top first, so that the friend
+    // can skip unchanged sub-trees. Directories that were never received have no TS, and no sub-directories either.
+
+    std::deque<DirectoryStorage::EntryIndex> to_visit(1,e) ;
+
+    while(!to_visit.empty() && item->known_dirs.size() < MAX_SUBTREE_SYNC_KNOWN_DIRS)
+    {
+        DirectoryStorage::EntryIndex d = to_visit.front() ;
+        to_visit.pop_front() ;
+
+        RsFileHash dir_hash ;
+        rstime_t recurs_modf_TS = 0 ;
+
+        if(!rds->getDirHashFromIndex(d,dir_hash) || !rds->getDirectoryRecursModTime(d,recurs_modf_TS) || recurs_modf_TS == 0)
+            continue ;
+
+        item->known_dirs[dir_hash] = (uint32_t)recurs_modf_TS ;
+
+        for(DirectoryStorage::DirIterator it(rds,d);it;++it)
+            to_visit.push_back(*it) ;
+    }
+
+    DirSyncRequestData data ;
+
+    data.request_TS = time(NULL) ;
+    data.peer_id = item->PeerId();
+    data.flags = item->flags;
+    data.subtree_probe = false ;
+
+#ifdef DEBUG_P3FILELISTS
+    P3FILELISTS_DEBUG() << "  Pushing sub-tree req " << std::hex << sync_req_id << std::dec <<  " with " << item->known_dirs.size() << " known dirs in pending list with peer id " << data.peer_id << std::endl;
+#endif
+
+    mPendingSyncRequests[sync_req_id] = data ;
+
+    sendItem(item) ;	// at end! Because item is destroyed by the process.
+
+    return true;
+}
+
 
 //=========================================================================================================================//
 //                                          Unwanted content filtering system                                              //
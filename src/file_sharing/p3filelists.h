@@ -77,6 +77,7 @@ class RemoteDirectoryStorage ;
 class LocalDirectoryStorage ;
 
 class RsFileListsSyncRequestItem ;
+class RsFileListsSubtreeSyncRequestItem ;
 class RsFileListsSyncResponseItem ;
 class RsFileListsBannedHashesItem ;
 
@@ -223,9 +224,21 @@ class p3FileDatabase: public p3Service, public p3Config, public ftSearch //, pub
          * \brief generateAndSendSyncRequest
          * \param rds	Remote directory storage for the request
          * \param e		Entry index to update
+         * \param subtree_probe	only check the TS of the directory. If it changed, a sub-tree sync request follows the answer.
          * \return 		true if the request is correctly sent.
          */
-        bool locked_generateAndSendSyncRequest(RemoteDirectoryStorage *rds,const DirectoryStorage::EntryIndex& e);
+        bool locked_generateAndSendSyncRequest(RemoteDirectoryStorage *rds,const DirectoryStorage::EntryIndex& e,bool subtree_probe = false);
+
+        /*!
+         * \brief generateAndSendSubtreeSyncRequest
+         * 			Same as above, for friends that can send a whole sub-tree in a single batch. The request contains the last known
+         * 			TS of directories in the sub-tree, so that unchanged directories are not sent again. Periodic checks of a
+         * 			known root are done with a subtree_probe request first, so that this list is only sent when something changed.
+         */
+        bool locked_generateAndSendSubtreeSyncRequest(RemoteDirectoryStorage *rds,const DirectoryStorage::EntryIndex& e);
+        bool locked_updateFromSubtreeBatch(RemoteDirectoryStorage *rds,const RsTlvBinaryData& batch_data,rstime_t now);
+        bool locked_peerSupportsSubtreeSync(const RsPeerId& pid);
+        uint32_t locked_countPendingSubtreeSyncRequests(const RsPeerId& pid) const;
 
 		// File sync request queues. The fast one is used for online browsing when friends are connected.
 		// The slow one is used for background update of file lists.
@@ -251,6 +264,7 @@ class p3FileDatabase: public p3Service, public p3Config, public ftSearch //, pub
         uint32_t locked_getFriendIndex(const RsPeerId& pid);
 
         void handleDirSyncRequest (RsFileListsSyncRequestItem *) ;
+        void handleDirSubtreeSyncRequest (RsFileListsSubtreeSyncRequestItem *) ;
         void handleDirSyncResponse (RsFileListsSyncResponseItem *&) ;
 
         std::map<RsPeerId,uint32_t> mFriendIndexMap ;
@@ -263,13 +277,15 @@ class p3FileDatabase: public p3Service, public p3Config, public ftSearch //, pub
             RsPeerId peer_id ;
             rstime_t request_TS ;
             uint32_t flags ;
+            bool subtree_probe ;
         };
 
         rstime_t mLastRemoteDirSweepTS ; // TS for friend list update
         std::map<DirSyncRequestId,DirSyncRequestData> mPendingSyncRequests ; // pending requests, waiting for an answer
         std::map<DirSyncRequestId,RsFileListsSyncResponseItem *> mPartialResponseItems;
 
-        void locked_recursSweepRemoteDirectory(RemoteDirectoryStorage *rds, DirectoryStorage::EntryIndex e, int depth);
+        void locked_sweepRemoteDirectory(RemoteDirectoryStorage *rds);
+        void locked_recursSweepRemoteDirectory(RemoteDirectoryStorage *rds, DirectoryStorage::EntryIndex e, int depth, bool subtree_sync, uint32_t& nb_pending_subtrees);
 
         // We use a shared file cache as well, to avoid re-hashing files with known modification TS and equal name.
 		//
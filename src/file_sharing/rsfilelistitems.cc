@@ -32,6 +32,13 @@ void RsFileListsSyncRequestItem::serial_process(RsGenericSerializer::SerializeJo
     RsTypeSerializer::serial_process<uint32_t>(j,ctx,last_known_recurs_modf_TS,"last_known_recurs_modf_TS") ;
     RsTypeSerializer::serial_process<uint64_t>(j,ctx,request_id,"request_id") ;
 }
+void RsFileListsSubtreeSyncRequestItem::serial_process(RsGenericSerializer::SerializeJob j,RsGenericSerializer::SerializeContext& ctx)
+{
+    RsTypeSerializer::serial_process          (j,ctx,entry_hash,"entry_hash") ;
+    RsTypeSerializer::serial_process<uint32_t>(j,ctx,flags     ,"flags") ;
+    RsTypeSerializer::serial_process<uint64_t>(j,ctx,request_id,"request_id") ;
+    RsTypeSerializer::serial_process          (j,ctx,known_dirs,"known_dirs") ;
+}
 void RsFileListsSyncResponseItem::serial_process(RsGenericSerializer::SerializeJob j,RsGenericSerializer::SerializeContext& ctx)
 {
     RsTypeSerializer::serial_process           (j,ctx,entry_hash,               "entry_hash") ;
@@ -62,6 +69,7 @@ RsItem *RsFileListsSerialiser::create_item(uint16_t service,uint8_t type) const
     case RS_PKT_SUBTYPE_FILELISTS_SYNC_RSP_ITEM:             return new RsFileListsSyncResponseItem();
     case RS_PKT_SUBTYPE_FILELISTS_BANNED_HASHES_ITEM:        return new RsFileListsBannedHashesItem();
     case RS_PKT_SUBTYPE_FILELISTS_BANNED_HASHES_CONFIG_ITEM: return new RsFileListsBannedHashesConfigItem();
+    case RS_PKT_SUBTYPE_FILELISTS_SUBTREE_SYNC_REQ_ITEM:     return new RsFileListsSubtreeSyncRequestItem();
     default:
         return NULL ;
     }
@@ -40,6 +40,7 @@ const uint8_t RS_PKT_SUBTYPE_FILELISTS_SYNC_RSP_ITEM             = 0x02;
 const uint8_t RS_PKT_SUBTYPE_FILELISTS_CONFIG_ITEM               = 0x03;
 const uint8_t RS_PKT_SUBTYPE_FILELISTS_BANNED_HASHES_ITEM        = 0x04;
 const uint8_t RS_PKT_SUBTYPE_FILELISTS_BANNED_HASHES_CONFIG_ITEM = 0x05;
+const uint8_t RS_PKT_SUBTYPE_FILELISTS_SUBTREE_SYNC_REQ_ITEM     = 0x06;
 
 /*!
  * Base class for filelist sync items
@@ -64,6 +65,7 @@ public:
     static const uint32_t FLAGS_ENTRY_WAS_REMOVED = 0x0010 ;
     static const uint32_t FLAGS_SYNC_PARTIAL      = 0x0020 ;
     static const uint32_t FLAGS_SYNC_PARTIAL_END  = 0x0040 ;
+    static const uint32_t FLAGS_SYNC_SUBTREE      = 0x0080 ;
 };
 
 /*!
@@ -85,6 +87,27 @@ public:
     uint64_t   request_id;                // use to determine if changes that have occured since last hash
 };
 
+/*!
+ * Requests the synchronization of a whole sub-tree. The response is a RsFileListsSyncResponseItem with FLAGS_SYNC_SUBTREE, containing
+ * a compressed batch of directory entries (see DirSyncBatchWriter). Directories whose recursive modification time is given in known_dirs
+ * and did not change are only acknowledged, without their content and without the content of their sub-directories.
+ */
+class RsFileListsSubtreeSyncRequestItem : public RsFileListsItem
+{
+public:
+
+    RsFileListsSubtreeSyncRequestItem() : RsFileListsItem(RS_PKT_SUBTYPE_FILELISTS_SUBTREE_SYNC_REQ_ITEM), flags(0), request_id(0) {}
+
+    virtual void clear(){ known_dirs.clear(); }
+
+	virtual void serial_process(RsGenericSerializer::SerializeJob j,RsGenericSerializer::SerializeContext& ctx);
+
+    RsFileHash entry_hash ;                     // hash of the top directory of the sub-tree to sync
+    uint32_t   flags;
+    uint64_t   request_id;
+    std::map<RsFileHash,uint32_t> known_dirs ;  // last known recursive modification time of directories in the sub-tree
+};
+
 class RsFileListsSyncResponseItem : public RsFileListsItem
 {
 public:
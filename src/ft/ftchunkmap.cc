@@ -37,6 +37,42 @@ static const uint32_t SOURCE_CHUNK_MAP_UPDATE_PERIOD	=   60 ; //! TTL for chunkm
 static const uint32_t INACTIVE_CHUNK_TIME_LAPSE 		= 3600 ; //! TTL for an inactive chunk
 static const uint32_t FT_CHUNKMAP_MAX_CHUNK_JUMP		=   50 ; //! Maximum chunk jump in progressive DL mode
 static const uint32_t FT_CHUNKMAP_MAX_SLICE_REASK_DELAY =   10 ; //! Maximum time to re-ask a slice to another peer at end of transfer
+static const uint32_t FT_CHUNKMAP_MAX_SLICE_DUPLICATES  =    4 ; //! Maximum number of peers a slice is asked to in endgame mode
+static const uint32_t FT_CHUNKMAP_MAX_ENDGAME_BYTES     = 2*1024*1024 ; //! Maximum amount of duplicate slice requests in flight for a file in endgame mode
+
+static uint32_t countBits(uint32_t w)
+{
+	uint32_t n = 0 ;
+
+	for(;w;w &= w-1)
+		++n ;
+
+	return n ;
+}
+
+// Returns the index of the n-th set bit in the bit set, or nb_bits if there are not enough bits set.
+
+static uint32_t nthSetBit(const std::vector<uint32_t>& bits,uint32_t n,uint32_t nb_bits)
+{
+	for(uint32_t k=0;k<bits.size();++k)
+	{
+		uint32_t c = countBits(bits[k]) ;
+
+		if(n >= c)
+		{
+			n -= c ;
+			continue ;
+		}
+		for(uint32_t b=0;b<32;++b)
+			if(bits[k] & (1u << b))
+			{
+				if(n == 0)
+					return 32*k + b ;
+				--n ;
+			}
+	}
+	return nb_bits ;
+}
 
 std::ostream& operator<<(std::ostream& o,const ftChunk& c)
 {
@@ -73,9 +109,16 @@ ChunkMap::ChunkMap(uint64_t s,bool availability)
 		++n ;
 
 	_map.resize(n,FileChunksInfo::CHUNK_OUTSTANDING) ;
+	_outstanding_chunks.resize(CompressedChunkMap::getCompressedSize(n),0) ;
+	_partial_sources_count.resize(n,0) ;
+
+	for(uint32_t i=0;i<n;++i)
+		_outstanding_chunks[i >> 5] |= (1u << (i & 31)) ;
+
 	_strategy = FileChunksInfo::CHUNK_STRATEGY_PROGRESSIVE ;
 	_total_downloaded = 0 ;
 	_file_is_complete = false ;
+	_slice_reask_delay = FT_CHUNKMAP_MAX_SLICE_REASK_DELAY ;
 #ifdef DEBUG_FTCHUNK
 	std::cerr << "*** ChunkMap::ChunkMap: starting new chunkmap:" << std::endl ; 
 	std::cerr << "   File size: " << s << std::endl ;
@@ -108,12 +151,12 @@ void ChunkMap::setAvailabilityMap(const CompressedChunkMap& map)
 	for(uint32_t i=0;i<_map.size();++i)
 		if(map[i] > 0)
 		{
-			_map[i] = FileChunksInfo::CHUNK_DONE ;
+			setChunkState(i,FileChunksInfo::CHUNK_DONE) ;
 			_total_downloaded += sizeOfChunk(i) ;
 		}
 		else
 		{
-			_map[i] = FileChunksInfo::CHUNK_OUTSTANDING ;
+			setChunkState(i,FileChunksInfo::CHUNK_OUTSTANDING) ;
 			_file_is_complete = false ;
 		}
 }
@@ -162,12 +205,12 @@ void ChunkMap::dataReceived(const ftChunk::OffsetInFile& cid)
 		std::cerr << "*** ChunkMap::dataReceived: Chunk is complete. Removing it." << std::endl ;
 #endif
 
-		_map[n] = FileChunksInfo::CHUNK_CHECKING ;
+		setChunkState(n,FileChunksInfo::CHUNK_CHECKING) ;
 
 		if(n > 0 || _file_size > CHUNKMAP_FIXED_CHUNK_SIZE)	// dont' put <1MB files into checking mode. This is useless.
 			_chunks_checking_queue.push_back(n) ;
 		else
-			_map[n] = FileChunksInfo::CHUNK_DONE ;
+			setChunkState(n,FileChunksInfo::CHUNK_DONE) ;
 
 		_slices_to_download.erase(itc) ;
 
@@ -234,7 +277,7 @@ void ChunkMap::setChunkCheckingResult(uint32_t chunk_number,bool check_succeeded
 	
 	if(check_succeeded)
 	{
-		_map[chunk_number] = FileChunksInfo::CHUNK_DONE ;
+		setChunkState(chunk_number,FileChunksInfo::CHUNK_DONE) ;
 
 		// We also check whether the file is complete or not.
 
@@ -250,7 +293,7 @@ void ChunkMap::setChunkCheckingResult(uint32_t chunk_number,bool check_succeeded
 	else
 	{
 		_total_downloaded -= sizeOfChunk(chunk_number) ;	// restore completion.
-		_map[chunk_number] = FileChunksInfo::CHUNK_OUTSTANDING ;
+		setChunkState(chunk_number,FileChunksInfo::CHUNK_OUTSTANDING) ;
 	}
 }
 
@@ -258,32 +301,60 @@ bool ChunkMap::reAskPendingChunk( const RsPeerId& peer_id,
                                   uint32_t /*size_hint*/,
                                   uint64_t& offset, uint32_t& size)
 {
-	// make sure that we're at the end of the file. No need to be too greedy in the middle of it.
+	// Endgame mode: only re-ask slices to a peer that has no outstanding chunk left to offer. There's no need to be
+	// too greedy before that.
+	//
+	// There is no way to cancel a slice request, so every duplicate is eventually sent by the peer, and all copies
+	// but the first are dropped by dataReceived(). The waste is bounded by the number of peers a slice is asked
+	// to, and by FT_CHUNKMAP_MAX_ENDGAME_BYTES of duplicate requests in flight for the whole file.
 
-	for(uint32_t i=0;i<_map.size();++i)
-		if(_map[i] == FileChunksInfo::CHUNK_OUTSTANDING)
-			return false ;
+	SourceChunksInfo *sci = getSourceChunksInfo(peer_id) ;
+	std::vector<uint32_t> available ;
+
+	if(getAvailableChunks(*sci,available) > 0)
+		return false ;
 
 	rstime_t now = time(NULL);
+	ChunkDownloadInfo::SliceRequestInfo *best = NULL ;
+	uint64_t duplicate_bytes = 0 ;
 
 	for(std::map<uint32_t,ChunkDownloadInfo>::iterator it(_slices_to_download.begin());it!=_slices_to_download.end();++it)
+	{
+		bool peer_has_chunk = sci->is_full || sci->cmap[it->first] ;
+
 		for(std::map<ftChunk::OffsetInFile,ChunkDownloadInfo::SliceRequestInfo >::iterator it2(it->second._slices.begin());it2!=it->second._slices.end();++it2)
-			if(it2->second.request_time + FT_CHUNKMAP_MAX_SLICE_REASK_DELAY < now && it2->second.peers.end()==it2->second.peers.find(peer_id))
+		{
+			ChunkDownloadInfo::SliceRequestInfo& r(it2->second) ;
+
+			if(r.peers.size() > 1)
+				duplicate_bytes += (r.peers.size() - 1) * (uint64_t)r.size ;
+
+			if(!peer_has_chunk || r.request_time + _slice_reask_delay > now || r.peers.size() >= FT_CHUNKMAP_MAX_SLICE_DUPLICATES || r.peers.end()!=r.peers.find(peer_id))
+				continue ;
+
+			// Prefer slices asked to the fewest peers, then the oldest ones.
+
+			if(best == NULL || r.peers.size() < best->peers.size() || (r.peers.size() == best->peers.size() && r.request_time < best->request_time))
 			{
-				offset = it2->first;
-				size   = it2->second.size ;
+				best = &r ;
+				offset = it2->first ;
+			}
+		}
+	}
+
+	if(best == NULL || duplicate_bytes + best->size > FT_CHUNKMAP_MAX_ENDGAME_BYTES)
+		return false ;
+
+	size = best->size ;
 
 #ifdef DEBUG_FTCHUNK
-				std::cerr << "*** ChunkMap::reAskPendingChunk: re-asking slice (" << offset << ", " << size << ") to peer " << peer_id << std::endl;
+	std::cerr << "*** ChunkMap::reAskPendingChunk: re-asking slice (" << offset << ", " << size << ") to peer " << peer_id << std::endl;
 #endif
 
-				it2->second.request_time = now ;
-				it2->second.peers.insert(peer_id) ;
-
-				return true ;
-			}
+	best->request_time = now ;
+	best->peers.insert(peer_id) ;
 
-	return false ;
+	return true ;
 }
 
 // Warning: a chunk may be empty, but still being downloaded, so asking new slices from it
@@ -361,7 +432,7 @@ bool ChunkMap::getDataChunk(const RsPeerId& peer_id,uint32_t size_hint,ftChunk&
 				//
 				uint32_t soc = sizeOfChunk(c) ;
 				_active_chunks_feed[peer_id] = Chunk( c*(uint64_t)_chunk_size, soc ) ;
-				_map[c] = FileChunksInfo::CHUNK_ACTIVE ;
+				setChunkState(c,FileChunksInfo::CHUNK_ACTIVE) ;
 				_slices_to_download[c]._remains = soc ;			// init the list of slices to download
 				it = _active_chunks_feed.find(peer_id) ;
 #ifdef DEBUG_FTCHUNK
@@ -415,7 +486,7 @@ void ChunkMap::removeInactiveChunks(std::vector<ftChunk::OffsetInFile>& to_remov
 			for(std::map<ftChunk::OffsetInFile,ChunkDownloadInfo::SliceRequestInfo>::const_iterator it2(it->second._slices.begin());it2!=it->second._slices.end();++it2)
 				to_remove.push_back(it2->first) ;
 
-			_map[it->first] = FileChunksInfo::CHUNK_OUTSTANDING ;	// reset the chunk
+			setChunkState(it->first,FileChunksInfo::CHUNK_OUTSTANDING) ;	// reset the chunk
 
 			_total_downloaded -= (sizeOfChunk(it->first) - it->second._remains) ;	// restore completion.
 
@@ -448,6 +519,11 @@ bool ChunkMap::isChunkOutstanding(uint64_t offset, uint32_t chunk_size) const
     return hasChunkState(offset, chunk_size, FileChunksInfo::CHUNK_OUTSTANDING);
 }
 
+bool ChunkMap::isChunkReceived(uint32_t chunk_number) const
+{
+	return chunk_number < _map.size() && (_map[chunk_number] == FileChunksInfo::CHUNK_DONE || _map[chunk_number] == FileChunksInfo::CHUNK_CHECKING) ;
+}
+
 bool ChunkMap::hasChunkState(uint64_t offset, uint32_t chunk_size, FileChunksInfo::ChunkState state) const
 {
 	uint32_t chunk_number_start = offset/(uint64_t)_chunk_size ;
@@ -486,6 +562,13 @@ void ChunkMap::setPeerAvailabilityMap(const RsPeerId& peer_id,const CompressedCh
 		return ;
 	}
 
+	// Remove the previous map from the availability counts.
+	//
+	std::map<RsPeerId,SourceChunksInfo>::const_iterator it(_peers_chunks_availability.find(peer_id)) ;
+
+	if(it != _peers_chunks_availability.end() && !it->second.is_full)
+		updatePartialSourcesCount(it->second.cmap,-1) ;
+
 	// sets the map.
 	//
 	SourceChunksInfo& mi(_peers_chunks_availability[peer_id]) ;
@@ -502,11 +585,35 @@ void ChunkMap::setPeerAvailabilityMap(const RsPeerId& peer_id,const CompressedCh
 			break ;
 		}
 
+	// Full sources have all chunks, so they do not change which chunks are the rarest.
+	//
+	if(!mi.is_full)
+		updatePartialSourcesCount(mi.cmap,1) ;
+
 #ifdef DEBUG_FTCHUNK
 	std::cerr << "ChunkMap::setPeerAvailabilityMap: Setting chunk availability info for peer " << peer_id << std::endl ;
 #endif
 }
 
+void ChunkMap::updatePartialSourcesCount(const CompressedChunkMap& cmap,int delta)
+{
+	for(uint32_t k=0;k<cmap._map.size() && k<_outstanding_chunks.size();++k)
+		if(cmap._map[k] != 0)
+			for(uint32_t b=0;b<32 && 32*k+b<_partial_sources_count.size();++b)
+				if(cmap._map[k] & (1u << b))
+					_partial_sources_count[32*k+b] += delta ;
+}
+
+void ChunkMap::setChunkState(uint32_t chunk_number,FileChunksInfo::ChunkState state)
+{
+	_map[chunk_number] = state ;
+
+	if(state == FileChunksInfo::CHUNK_OUTSTANDING)
+		_outstanding_chunks[chunk_number >> 5] |=  (1u << (chunk_number & 31)) ;
+	else
+		_outstanding_chunks[chunk_number >> 5] &= ~(1u << (chunk_number & 31)) ;
+}
+
 uint32_t ChunkMap::sizeOfChunk(uint32_t cid) const
 {
 	if(cid == _map.size()-1)
@@ -583,21 +690,13 @@ uint32_t ChunkMap::getAvailableChunk(const RsPeerId& peer_id,bool& map_is_too_ol
 	else
 		map_is_too_old = false ;// the map is not too old
 
-	uint32_t available_chunks = 0 ;
-	uint32_t available_chunks_before_max_dist = 0 ;
-
-	for(unsigned int i=0;i<_map.size();++i)
-		if(_map[i] == FileChunksInfo::CHUNK_OUTSTANDING)
-		{
-			if(peer_chunks->is_full || peer_chunks->cmap[i])
-				++available_chunks ;
-		}
-		else
-			available_chunks_before_max_dist = available_chunks ;
+	std::vector<uint32_t> available ;
+	uint32_t available_chunks = getAvailableChunks(*peer_chunks,available) ;
 
 	if(available_chunks > 0)
 	{
 		uint32_t chosen_chunk_number ;
+		uint32_t available_chunks_before_max_dist = 0 ;
 
 		switch(_strategy)
 		{
@@ -605,26 +704,36 @@ uint32_t ChunkMap::getAvailableChunk(const RsPeerId& peer_id,bool& map_is_too_ol
 																		    break ;
 			case FileChunksInfo::CHUNK_STRATEGY_RANDOM:      chosen_chunk_number = rand() % available_chunks ;
 																		    break ;
-			case FileChunksInfo::CHUNK_STRATEGY_PROGRESSIVE: chosen_chunk_number = rand() % std::min(available_chunks, available_chunks_before_max_dist+FT_CHUNKMAP_MAX_CHUNK_JUMP) ;
+			case FileChunksInfo::CHUNK_STRATEGY_PROGRESSIVE:
+			{
+				// count the available chunks before the last chunk that is not outstanding.
+
+				uint32_t last = _map.size() ;
+
+				while(last > 0 && _map[last-1] == FileChunksInfo::CHUNK_OUTSTANDING)
+					--last ;
+
+				if(last > 0)
+					--last ;
+
+				for(uint32_t k=0;k<(last >> 5);++k)
+					available_chunks_before_max_dist += countBits(available[k]) ;
+
+				if(last & 31)
+					available_chunks_before_max_dist += countBits(available[last >> 5] & ((1u << (last & 31)) - 1)) ;
+
+				chosen_chunk_number = rand() % std::min(available_chunks, available_chunks_before_max_dist+FT_CHUNKMAP_MAX_CHUNK_JUMP) ;
+			}
 																		    break ;
+			case FileChunksInfo::CHUNK_STRATEGY_RAREST_FIRST:
+																			 return getRarestChunk(available) ;
 			default:
 																			 chosen_chunk_number = 0 ;
 		}
-		uint32_t j=0 ;
-
-		for(uint32_t i=0;i<_map.size();++i)
-			if(_map[i] == FileChunksInfo::CHUNK_OUTSTANDING && (peer_chunks->is_full || peer_chunks->cmap[i]))
-			{
-				if(j == chosen_chunk_number)
-				{
 #ifdef DEBUG_FTCHUNK
-					std::cerr << "ChunkMap::getAvailableChunk: returning chunk " << i << " for peer " << peer_id << std::endl;
+		std::cerr << "ChunkMap::getAvailableChunk: returning chunk " << nthSetBit(available,chosen_chunk_number,_map.size()) << " for peer " << peer_id << std::endl;
 #endif
-					return i ;
-				}
-				else
-					++j ;
-			}
+		return nthSetBit(available,chosen_chunk_number,_map.size()) ;
 	}
 
 #ifdef DEBUG_FTCHUNK
@@ -633,6 +742,56 @@ uint32_t ChunkMap::getAvailableChunk(const RsPeerId& peer_id,bool& map_is_too_ol
 	return _map.size() ;
 }
 
+uint32_t ChunkMap::getAvailableChunks(const SourceChunksInfo& peer_chunks,std::vector<uint32_t>& available) const
+{
+	uint32_t n = 0 ;
+	available.resize(_outstanding_chunks.size()) ;
+
+	for(uint32_t k=0;k<_outstanding_chunks.size();++k)
+	{
+		available[k] = _outstanding_chunks[k] ;
+
+		if(!peer_chunks.is_full)
+			available[k] &= (k < peer_chunks.cmap._map.size())?peer_chunks.cmap._map[k]:0 ;
+
+		n += countBits(available[k]) ;
+	}
+	return n ;
+}
+
+uint32_t ChunkMap::getRarestChunk(const std::vector<uint32_t>& available) const
+{
+	uint32_t min_count = ~0u ;
+	uint32_t nb_rarest = 0 ;
+
+	for(uint32_t k=0;k<available.size();++k)
+		for(uint32_t b=0;b<32 && available[k];++b)
+			if(available[k] & (1u << b))
+			{
+				uint32_t c = _partial_sources_count[32*k+b] ;
+
+				if(c < min_count)
+				{
+					min_count = c ;
+					nb_rarest = 1 ;
+				}
+				else if(c == min_count)
+					++nb_rarest ;
+			}
+
+	if(nb_rarest == 0)
+		return _map.size() ;
+
+	uint32_t chosen = rand() % nb_rarest ;
+
+	for(uint32_t k=0;k<available.size();++k)
+		for(uint32_t b=0;b<32 && available[k];++b)
+			if((available[k] & (1u << b)) && _partial_sources_count[32*k+b] == min_count && chosen-- == 0)
+				return 32*k+b ;
+
+	return _map.size() ;
+}
+
 void ChunkMap::getChunksInfo(FileChunksInfo& info) const 
 {
 	info.file_size = _file_size ;
@@ -658,6 +817,9 @@ void ChunkMap::removeFileSource(const RsPeerId& peer_id)
 	if(it == _peers_chunks_availability.end())
 		return ;
 
+	if(!it->second.is_full)
+		updatePartialSourcesCount(it->second.cmap,-1) ;
+
 	_peers_chunks_availability.erase(it) ;
 }
 
@@ -674,7 +836,7 @@ void ChunkMap::forceCheck()
 {
 	for(uint32_t i=0;i<_map.size();++i)
 	{
-		_map[i] = FileChunksInfo::CHUNK_CHECKING ;
+		setChunkState(i,FileChunksInfo::CHUNK_CHECKING) ;
 		_chunks_checking_queue.push_back(i) ;
 	}
 
@@ -149,11 +149,16 @@ class ChunkMap
 
       virtual bool getDataChunk(const RsPeerId& peer_id,uint32_t size_hint,ftChunk& chunk,bool& source_chunk_map_needed) ; 
 
-		/// Returns an already pending slice that was being downloaded but hasn't arrived yet. This is mostly used at the end of the file
-		/// in order to re-ask pendign slices to active peers while slow peers take a lot of time to send their remaining slices.
+		/// Returns an already pending slice that was being downloaded but hasn't arrived yet. This is the endgame mode: once
+		/// a peer has no outstanding chunk left to offer, pending slices it has are re-asked to it, so that slow peers do not hold
+		/// back the completion of the file. Slices asked to the fewest peers, then the oldest ones, are re-asked first.
+		/// Slice requests cannot be cancelled, so the amount of duplicate requests in flight for the file is bounded.
 		///
 		bool reAskPendingChunk(const RsPeerId& peer_id,uint32_t size_hint,uint64_t& offset,uint32_t& size);
 
+		/// Time in seconds a slice must have been pending before it is re-asked to another peer.
+		void setSliceReAskDelay(uint32_t delay) { _slice_reask_delay = delay ; }
+
 		/// Notify received a slice of data. This needs to
 		///   - carve in the map of chunks what is received, what is not.
 		///   - tell which chunks are finished. For this, each interval must know what chunk number it has been attributed
@@ -165,6 +170,7 @@ class ChunkMap
       /// Decides how chunks are selected. 
       ///    STREAMING: the 1st chunk is always returned
       ///       RANDOM: a uniformly random chunk is selected among available chunks for the current source.
+      /// RAREST_FIRST: a random chunk is selected among the available chunks that the fewest sources have.
       ///              
 
 		void setStrategy(FileChunksInfo::ChunkStrategy s) { _strategy = s ; }
@@ -195,6 +201,9 @@ class ChunkMap
 
         bool isChunkOutstanding(uint64_t offset, uint32_t chunk_size) const ;
 
+		/// Returns true if all the data of this chunk has been written, whether it is verified or not.
+		bool isChunkReceived(uint32_t chunk_number) const ;
+
 		/// Remove active chunks that have not received any data for the last 60 seconds, and return
 		/// the list of slice numbers that should be canceled.
 		void removeInactiveChunks(std::vector<ftChunk::OffsetInFile>& to_remove) ;
@@ -241,9 +250,21 @@ class ChunkMap
 		//
 		uint32_t getAvailableChunk(const RsPeerId& peer_id,bool& chunk_map_too_old) ;
 
+		/// Returns the available chunk that the fewest sources have. Ties are broken randomly.
+		uint32_t getRarestChunk(const std::vector<uint32_t>& available) const ;
+
 	private:
         bool hasChunkState(uint64_t offset, uint32_t chunk_size, FileChunksInfo::ChunkState state) const;
 
+		/// Changes the state of a chunk, keeping _outstanding_chunks up to date.
+		void setChunkState(uint32_t chunk_number,FileChunksInfo::ChunkState state) ;
+
+		/// Adds (delta=1) or removes (delta=-1) the chunks of a partial source from _partial_sources_count.
+		void updatePartialSourcesCount(const CompressedChunkMap& cmap,int delta) ;
+
+		/// Fills the bit set of outstanding chunks that the given source has, and returns how many there are.
+		uint32_t getAvailableChunks(const SourceChunksInfo& peer_chunks,std::vector<uint32_t>& available) const ;
+
 		uint64_t												_file_size ;						//! total size of the file in bytes.
 		uint32_t												_chunk_size ;						//! Size of chunks. Common to all chunks.
 		FileChunksInfo::ChunkStrategy 				_strategy ;							//! how do we allocate new chunks
@@ -255,6 +276,9 @@ class ChunkMap
 		bool													_file_is_complete ;           //! set to true when the file is complete.
 		bool													_assume_availability ;			//! true if all sources always have the complete file.
 		std::vector<uint32_t>							_chunks_checking_queue ;		//! Queue of downloaded chunks to be checked.
+		std::vector<uint32_t>							_outstanding_chunks ;			//! one bit per chunk in CHUNK_OUTSTANDING state, with the layout of CompressedChunkMap
+		std::vector<uint16_t>							_partial_sources_count ;		//! number of sources with an incomplete map that have each chunk
+		uint32_t												_slice_reask_delay ;				//! delay before a pending slice is re-asked in endgame mode
 };
 
 
@@ -1161,11 +1161,16 @@ bool ftController::FileRequest(
 	/* add in new item for download */
 	std::string savepath;
 	std::string destination;
+	uint32_t storage_flags = 0;
 
 	{ 
 		RsStackMutex stack(ctrlMutex); /******* LOCKED ********/
 
         savepath = mPartialsPath + "/" + hash.toStdString();
+
+		std::map<std::string,uint32_t>::const_iterator pit = mPartialsStoragePolicies.find(RsDirUtil::convertPathToUnix(mPartialsPath));
+		if(pit != mPartialsStoragePolicies.end())
+			storage_flags = pit->second;
 		destination = dest + "/" + fname;
 
 		/* if no destpath - send to download directory */
@@ -1181,6 +1186,7 @@ bool ftController::FileRequest(
     bool assume_availability = false;
 
 	ftFileCreator *fc = new ftFileCreator(savepath, size, hash,assume_availability);
+	fc->setStoragePolicy(storage_flags) ;
 	ftTransferModule *tm = new ftTransferModule(fc, mDataplex,this);
 
 #ifdef CONTROL_DEBUG
@@ -1550,6 +1556,29 @@ std::string ftController::getPartialsDirectory()
 	return mPartialsPath;
 }
 
+void ftController::setPartialsStoragePolicy(const std::string& path, uint32_t flags)
+{
+	RsStackMutex stack(ctrlMutex); /******* LOCKED ********/
+
+	flags &= RS_FILE_PARTIALS_STORAGE_PREALLOCATE | RS_FILE_PARTIALS_STORAGE_DIRECT_IO;
+
+	if(flags)
+		mPartialsStoragePolicies[RsDirUtil::convertPathToUnix(path)] = flags;
+	else
+		mPartialsStoragePolicies.erase(RsDirUtil::convertPathToUnix(path));
+
+	IndicateConfigChanged(RsConfigMgr::CheckPriority::SAVE_OFTEN);
+}
+
+uint32_t ftController::partialsStoragePolicy(const std::string& path)
+{
+	RsStackMutex stack(ctrlMutex); /******* LOCKED ********/
+
+	std::map<std::string,uint32_t>::const_iterator it = mPartialsStoragePolicies.find(RsDirUtil::convertPathToUnix(path));
+
+	return (it == mPartialsStoragePolicies.end()) ? 0 : it->second;
+}
+
 bool  ftController::FileServerCancel(const RsFileHash& hash)
 {
     RsStackMutex stack(ctrlMutex); /******* LOCKED ********/
@@ -1640,6 +1669,9 @@ bool 	ftController::FileDetails(const RsFileHash &hash, FileInfo &info)
 	double totalRate = 0;
 	uint32_t tfRate = 0;
 	uint32_t state = 0;
+	uint32_t rtt = 0;
+	uint64_t outstanding = 0;
+	uint64_t window = 0;
 
 	bool isDownloading = false;
 	bool isSuspended = false;
@@ -1648,7 +1680,7 @@ bool 	ftController::FileDetails(const RsFileHash &hash, FileInfo &info)
 
 	for(pit = peerIds.begin(); pit != peerIds.end(); ++pit)
 	{
-		if (it->second->mTransfer->getPeerState(*pit, state, tfRate))
+		if (it->second->mTransfer->getPeerState(*pit, state, tfRate, rtt, outstanding, window))
 		{
 			TransferInfo ti;
 			switch(state)
@@ -1674,6 +1706,9 @@ bool 	ftController::FileDetails(const RsFileHash &hash, FileInfo &info)
 			}
 
 			ti.tfRate = tfRate / 1024.0;
+			ti.rtt = rtt;
+			ti.outstanding = outstanding;
+			ti.requestWindow = window;
 			ti.peerId = *pit;
 			info.peers.push_back(ti);
 			totalRate += tfRate / 1024.0;
@@ -1842,6 +1877,7 @@ const std::string default_chunk_strategy_ss("DEFAULT_CHUNK_STRATEGY");
 const std::string free_space_limit_ss("FREE_SPACE_LIMIT");
 const std::string default_encryption_policy_ss("DEFAULT_ENCRYPTION_POLICY");
 const std::string file_perm_direct_dl_ss("FILE_PERM_DIRECT_DL");
+const std::string partials_storage_ss("PART_STORAGE:");	// followed by the partials directory
 
 
 	/* p3Config Interface */
@@ -1881,6 +1917,8 @@ bool ftController::saveList(bool &cleanup, std::list<RsItem *>& saveData)
 																	  	break ;
 		case FileChunksInfo::CHUNK_STRATEGY_RANDOM:		configMap[default_chunk_strategy_ss] =  "RANDOM" ;
 																		break ;
+		case FileChunksInfo::CHUNK_STRATEGY_RAREST_FIRST:configMap[default_chunk_strategy_ss] =  "RAREST_FIRST" ;
+																		break ;
 
 		default:
 		case FileChunksInfo::CHUNK_STRATEGY_PROGRESSIVE:configMap[default_chunk_strategy_ss] =  "PROGRESSIVE" ;
@@ -1904,6 +1942,16 @@ bool ftController::saveList(bool &cleanup, std::list<RsItem *>& saveData)
 	rs_sprintf(s, "%lu", RsDiscSpace::freeSpaceLimit());
 	configMap[free_space_limit_ss] = s ;
 
+	{
+		RsStackMutex stack(ctrlMutex); /******* LOCKED ********/
+
+		for(std::map<std::string,uint32_t>::const_iterator pit(mPartialsStoragePolicies.begin());pit!=mPartialsStoragePolicies.end();++pit)
+		{
+			rs_sprintf(s, "%u", pit->second);
+			configMap[partials_storage_ss + pit->first] = s ;
+		}
+	}
+
 	RsConfigKeyValueSet *rskv = new RsConfigKeyValueSet();
 
 	/* Convert to TLV */
@@ -2174,6 +2222,11 @@ bool  ftController::loadConfigMap(std::map<std::string, std::string> &configMap)
 			setDefaultChunkStrategy(FileChunksInfo::CHUNK_STRATEGY_PROGRESSIVE) ;
 			std::cerr << "Note: loading default value for chunk strategy: progressive" << std::endl;
 		}
+		else if(mit->second == "RAREST_FIRST")
+		{
+			setDefaultChunkStrategy(FileChunksInfo::CHUNK_STRATEGY_RAREST_FIRST) ;
+			std::cerr << "Note: loading default value for chunk strategy: rarest first" << std::endl;
+		}
 		else
 			std::cerr << "**** ERROR ***: Unknown value for default chunk strategy in keymap." << std::endl ;
 	}
@@ -2216,6 +2269,16 @@ bool  ftController::loadConfigMap(std::map<std::string, std::string> &configMap)
 		}
 	}
 
+	for(mit = configMap.lower_bound(partials_storage_ss); mit != configMap.end() && mit->first.compare(0, partials_storage_ss.length(), partials_storage_ss) == 0; ++mit)
+	{
+		uint32_t flags ;
+		if (sscanf(mit->second.c_str(), "%u", &flags) == 1)
+		{
+			RsStackMutex stack(ctrlMutex); /******* LOCKED ********/
+			mPartialsStoragePolicies[RsDirUtil::convertPathToUnix(mit->first.substr(partials_storage_ss.length()))] = flags ;
+		}
+	}
+
 	return true;
 }
 
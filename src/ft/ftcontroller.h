@@ -179,6 +179,8 @@ public:
 		bool setPartialsDirectory(std::string path);
 		std::string getDownloadDirectory();
 		std::string getPartialsDirectory();
+		void setPartialsStoragePolicy(const std::string& path, uint32_t flags);
+		uint32_t partialsStoragePolicy(const std::string& path);
         bool 	FileDetails(const RsFileHash &hash, FileInfo &info);
 
 		/***************************************************************/
@@ -253,6 +255,7 @@ public:
 		std::string mConfigPath;
 		std::string mDownloadPath;
 		std::string mPartialsPath;
+		std::map<std::string,uint32_t> mPartialsStoragePolicies;	// RS_FILE_PARTIALS_STORAGE_* flags, per partials directory
 
 		/**** SPEED QUEUES ****/
 
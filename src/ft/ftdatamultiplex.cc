@@ -37,6 +37,9 @@
 #include "util/rstime.h"
 #include "util/largefile_retrocompat.hpp"
 
+#include <functional>
+#include <memory>
+
 
 /* For Thread Behaviour */
 const uint32_t DMULTIPLEX_MIN	= 10; /* 10 msec sleep */
@@ -45,10 +48,25 @@ const double   DMULTIPLEX_RELAX = 0.5; /* relax factor to calculate sleep time i
 
 static const uint32_t MAX_CHECKING_CHUNK_WAIT_DELAY   = 120 ; //! TTL for an inactive chunk
 const uint32_t MAX_SIMULTANEOUS_CRC_REQUESTS = 500 ;
+const uint32_t MAX_CHUNK_CHECK_WORKERS       = 4 ;	// chunk checking is mostly disk bound. No need for more.
+const uint32_t CHUNK_CHECK_WAIT_INTERVAL     = 1000 ;	// us, polling other workers once our own share is done
 
 /******
  * #define MPLEX_DEBUG 1
  *****/
+
+// Runs a share of the chunk checks of ftDataMultiplex::dispatchReceivedChunkCheckSum()
+class ftChunkCheckThread: public RsThread
+{
+public:
+	explicit ftChunkCheckThread(const std::function<void()>& work) : mWork(work) {}
+
+protected:
+	void run() override { mWork() ; }
+
+private:
+	std::function<void()> mWork ;
+};
  
 ftClient::ftClient(ftTransferModule *module, ftFileCreator *creator)
 	:mModule(module), mCreator(creator)
@@ -492,6 +510,14 @@ bool ftDataMultiplex::dispatchReceivedChunkCheckSum()
 
     uint32_t MAX_CHECKSUM_CHECK_PER_FILE = 500 ;
 
+	struct ChunkCheck
+	{
+		ftFileCreator *client ;
+		uint32_t chunk_number ;
+		Sha1CheckSum sum ;
+	};
+	std::vector<ChunkCheck> to_check ;
+
     for(std::map<RsFileHash,Sha1CacheEntry>::iterator it(_cached_sha1maps.begin());it!=_cached_sha1maps.end();)
 	{
         std::map<RsFileHash, ftClient>::iterator itc = mClients.find(it->first);
@@ -526,12 +552,42 @@ bool ftDataMultiplex::dispatchReceivedChunkCheckSum()
 #ifdef MPLEX_DEBUG
 				std::cerr << "ftDataMultiplex::dispatchReceivedChunkCheckSum(): checking chunk " << chunk_number << " with hash " << it->second._map[chunk_number].toStdString() << std::endl;
 #endif
-				client->verifyChunk(chunk_number,it->second._map[chunk_number]) ;
+				to_check.push_back(ChunkCheck{client,(uint32_t)chunk_number,it->second._map[chunk_number]}) ;
 			}
 			it->second._received.pop_back() ;
 		}
 		++it ;
 	}
+
+	// Chunks are verified in parallel. The mutex is kept, so that no client can be deleted meanwhile.
+
+	uint32_t nb_workers = RsThread::hardwareConcurrency() ;
+	nb_workers = std::min(nb_workers, MAX_CHUNK_CHECK_WORKERS) ;
+	nb_workers = std::min(nb_workers, (uint32_t)to_check.size()) ;
+
+	auto work = [&](uint32_t first)
+	{
+		for(uint32_t i=first; i<to_check.size(); i+=nb_workers)
+			to_check[i].client->verifyChunk(to_check[i].chunk_number,to_check[i].sum) ;
+	};
+
+	std::vector<std::unique_ptr<ftChunkCheckThread> > workers ;
+
+	for(uint32_t w=1; w<nb_workers; ++w)
+	{
+		workers.emplace_back(new ftChunkCheckThread(std::bind(work, w))) ;
+		workers.back()->start("chunk check") ;
+	}
+
+	if(!to_check.empty())
+		work(0) ;
+
+	// the other shares are about as long as ours, so they are done or nearly done
+
+	for(auto& w: workers)
+		while(w->isRunning())
+			rstime::rs_usleep(CHUNK_CHECK_WAIT_INTERVAL) ;
+
 	return true ;
 }
 
@@ -20,10 +20,17 @@
  *                                                                             *
  *******************************************************************************/
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdio>
+#include <cstring>
 #include <sys/stat.h>
 
+#ifdef __linux__
+#	include <fcntl.h>
+#	include <unistd.h>
+#endif
+
 #include "ftfilecreator.h"
 #include "util/rstime.h"
 #include "util/rsdiscspace.h"
@@ -42,6 +49,72 @@
 #define CHUNK_MAX_AGE           120
 #define MAX_FTCHUNKS_PER_PEER    20
 
+#ifdef __linux__
+// O_DIRECT needs offsets, sizes and memory aligned on the disk block size.
+static const uint32_t DIRECT_IO_ALIGNMENT         = 4096 ;
+static const uint32_t DIRECT_IO_BUFFER_SIZE       = 256*1024 ;
+static const uint32_t DIRECT_IO_MAX_SPARE_BUFFERS = 8 ;
+static const uint32_t DIRECT_IO_MAX_RUNS          = 4 ;	// runs of packets being gathered at the same time, per file
+static const uint32_t DIRECT_IO_MAX_RUN_AGE       = 5 ;	// seconds after which a run that does not grow anymore is written
+
+// Received data comes in packets of a few KB, which are not aligned in memory. Contiguous packets are gathered
+// into aligned buffers, and each buffer is written at once with O_DIRECT. Buffers are kept for reuse.
+//
+static RsMutex direct_io_buffers_mtx("ftFileCreator direct I/O buffers") ;
+static std::vector<void*> direct_io_spare_buffers ;
+
+static void *getDirectIOBuffer()
+{
+	{
+		RS_STACK_MUTEX(direct_io_buffers_mtx) ;
+
+		if(!direct_io_spare_buffers.empty())
+		{
+			void *buf = direct_io_spare_buffers.back() ;
+			direct_io_spare_buffers.pop_back() ;
+			return buf ;
+		}
+	}
+	void *buf = NULL ;
+
+	if(posix_memalign(&buf, DIRECT_IO_ALIGNMENT, DIRECT_IO_BUFFER_SIZE) != 0)
+		return NULL ;
+
+	return buf ;
+}
+
+static void releaseDirectIOBuffer(void *buf)
+{
+	RS_STACK_MUTEX(direct_io_buffers_mtx) ;
+
+	if(direct_io_spare_buffers.size() < DIRECT_IO_MAX_SPARE_BUFFERS)
+		direct_io_spare_buffers.push_back(buf) ;
+	else
+		free(buf) ;
+}
+
+static bool writeDirect(int fd, const unsigned char *buffer, uint32_t size, uint64_t offset)
+{
+	uint32_t done = 0 ;
+
+	while(done < size)
+	{
+		ssize_t n = pwrite(fd, buffer + done, size - done, offset + done) ;
+
+		if(n < 0 && errno == EINTR)
+			continue ;
+
+		if(n <= 0 || n % DIRECT_IO_ALIGNMENT != 0)
+		{
+			std::cerr << "ftFileCreator: direct write failed at offset " << offset + done << ", errno=" << errno << ". Trying a normal write." << std::endl;
+			return false ;
+		}
+		done += n ;
+	}
+	return true ;
+}
+#endif
+
 /***********************************************************
 *
 *	ftFileCreator methods
@@ -49,7 +122,8 @@
 ***********************************************************/
 
 ftFileCreator::ftFileCreator(const std::string& path, uint64_t size, const RsFileHash& hash,bool assume_availability)
-	: ftFileProvider(path,size,hash), chunkMap(size,assume_availability)
+	: ftFileProvider(path,size,hash), chunkMap(size,assume_availability),
+	  _storage_flags(0), _direct_fd(-1)
 {
 	/* 
          * FIXME any inits to do?
@@ -69,6 +143,8 @@ ftFileCreator::ftFileCreator(const std::string& path, uint64_t size, const RsFil
 	rstime_t now = time(NULL) ;
 	_creation_time = now ;
 
+	locked_resetHash() ;
+
 	struct stat64 buf;
 
 	// Initialise last recv time stamp to last modification time for the partial file.
@@ -161,6 +237,21 @@ void ftFileCreator::closeFile()
 {
 	RsStackMutex stack(ftcMutex); /********** STACK LOCKED MTX ******/
 
+#ifdef __linux__
+	// Whatever is still being gathered is written now, so that it is not received again.
+
+	if(fd != NULL && !_direct_runs.empty())
+		fflush(fd) ;
+
+	while(!_direct_runs.empty())
+	{
+		DirectIORun& run(_direct_runs.front()) ;
+
+		locked_commitDirectIORun(run, _direct_fd >= 0 && writeDirect(_direct_fd, run.buffer, run.size - run.size % DIRECT_IO_ALIGNMENT, run.offset)) ;
+		_direct_runs.pop_front() ;
+	}
+#endif
+
 	if(fd != NULL)
 	{
 #ifdef FILE_DEBUG
@@ -170,6 +261,20 @@ void ftFileCreator::closeFile()
 	}
 
 	fd = NULL ;
+
+#ifdef __linux__
+	if(_direct_fd >= 0)
+		close(_direct_fd) ;
+
+	_direct_fd = -1 ;
+#endif
+}
+
+void ftFileCreator::setStoragePolicy(uint32_t flags)
+{
+	RsStackMutex stack(ftcMutex); /********** STACK LOCKED MTX ******/
+
+	_storage_flags = flags ;
 }
 
 uint64_t ftFileCreator::getRecvd()
@@ -195,6 +300,9 @@ bool ftFileCreator::addFileData(uint64_t offset, uint32_t chunk_size, void *data
 		return false ;
 
 	bool complete = false ;
+	bool data_ok = true ;
+	std::vector<DirectIORun> to_write ;
+	int direct_fd = -1 ;
 	{
 		RsStackMutex stack(ftcMutex); /********** STACK LOCKED MTX ******/
 
@@ -212,36 +320,61 @@ bool ftFileCreator::addFileData(uint64_t offset, uint32_t chunk_size, void *data
 
 		}
 
-		/* 
-		 * go to the offset of the file 
-		 */
-		if (0 != fseeko64(this->fd, offset, SEEK_SET))
-		{
-			std::cerr << "ftFileCreator::addFileData() Bad fseek at offset " << offset << ", fd=" << (void*)(this->fd) << ", size=" << mSize << ", errno=" << errno << std::endl;
-			return 0;
-		}
+		bool gathered = locked_gatherDirectData(offset, chunk_size, data, to_write) ;
 
-		if (1 != fwrite(data, chunk_size, 1, this->fd))
-		{
-			std::cerr << "ftFileCreator::addFileData() Bad fwrite." << std::endl;
-			std::cerr << "ERRNO: " << errno << std::endl;
+#ifdef __linux__
+		// The runs to write are notified once on disk, including the runs flushed out when the packet itself
+		// goes through the buffered path. A copy of the file descriptor is used, since the file may be closed
+		// in the meantime.
 
-			return 0;
-		}
+		if(!to_write.empty())
+			direct_fd = dup(_direct_fd) ;
+#endif
+
+		// On failure, the runs flushed out above must still be written, so don't return yet.
 
+		if(!gathered && !locked_writeData(offset, chunk_size, data))
+			data_ok = false ;
+		else if(!gathered)
+		{
 #ifdef FILE_DEBUG
-		std::cerr << "ftFileCreator::addFileData() added Data...";
-		std::cerr << std::endl;
-		std::cerr << " pos: " << offset;
-		std::cerr << std::endl;
+			std::cerr << "ftFileCreator::addFileData() added Data...";
+			std::cerr << std::endl;
+			std::cerr << " pos: " << offset;
+			std::cerr << std::endl;
 #endif
-		/* 
-		 * Notify ftFileChunker about chunks received 
-		 */
-		locked_notifyReceived(offset,chunk_size);
+			/*
+			 * Notify ftFileChunker about chunks received
+			 */
+			locked_notifyReceived(offset,chunk_size);
+			locked_updateHash(offset,chunk_size,data);
+		}
+
+		complete = chunkMap.isComplete();
+	}
+
+#ifdef __linux__
+	// Direct writes are synchronous, so they are done without holding ftcMutex.
+
+	if(!to_write.empty())
+	{
+		std::vector<bool> written(to_write.size(), false) ;
+
+		for(uint32_t i=0;i<to_write.size();++i)
+			written[i] = direct_fd >= 0 && writeDirect(direct_fd, to_write[i].buffer, to_write[i].size - to_write[i].size % DIRECT_IO_ALIGNMENT, to_write[i].offset) ;
+
+		if(direct_fd >= 0)
+			close(direct_fd) ;
+
+		RsStackMutex stack(ftcMutex); /********** STACK LOCKED MTX ******/
+
+		for(uint32_t i=0;i<to_write.size();++i)
+			locked_commitDirectIORun(to_write[i], written[i]) ;
 
 		complete = chunkMap.isComplete();
 	}
+#endif
+
 	if(complete)
 	{
 #ifdef FILE_DEBUG
@@ -254,7 +387,199 @@ bool ftFileCreator::addFileData(uint64_t offset, uint32_t chunk_size, void *data
 	 * FIXME HANDLE COMPLETION HERE - Any better way?
 	 */
 
-	return 1;
+	return data_ok;
+}
+
+bool ftFileCreator::locked_gatherDirectData(uint64_t offset, uint32_t chunk_size, const void *data, std::vector<DirectIORun>& to_write)
+{
+#ifdef __linux__
+	// Block aligned data is gathered for direct writes when asked for. Packets that are not aligned, such as the end
+	// of the file, go through the normal buffered path, unless they end a run.
+
+	if(_direct_fd < 0 || chunk_size == 0 || chunk_size > DIRECT_IO_BUFFER_SIZE)
+		return false ;
+
+	rstime_t now = time(NULL) ;
+
+	// Runs that stopped growing, for instance because the source went away, are written anyway.
+
+	for(std::list<DirectIORun>::iterator it(_direct_runs.begin());it!=_direct_runs.end();)
+		if(it->last_update + DIRECT_IO_MAX_RUN_AGE < now)
+		{
+			to_write.push_back(*it) ;
+			it = _direct_runs.erase(it) ;
+		}
+		else
+			++it ;
+
+	std::list<DirectIORun>::iterator it ;
+
+	for(it=_direct_runs.begin();it!=_direct_runs.end();++it)
+		if(it->offset + it->size == offset)
+			break ;
+
+	if(it != _direct_runs.end() && it->size + chunk_size > DIRECT_IO_BUFFER_SIZE)
+	{
+		to_write.push_back(*it) ;
+		_direct_runs.erase(it) ;
+		it = _direct_runs.end() ;
+	}
+
+	if(it == _direct_runs.end() && (offset % DIRECT_IO_ALIGNMENT != 0 || chunk_size % DIRECT_IO_ALIGNMENT != 0))
+	{
+		if(!to_write.empty())
+			fflush(fd) ;
+
+		return false ;
+	}
+
+	if(it == _direct_runs.end())
+	{
+		DirectIORun run ;
+		run.buffer = (unsigned char*)getDirectIOBuffer() ;
+
+		if(run.buffer == NULL)
+			return false ;
+
+		run.offset = offset ;
+		run.size = 0 ;
+
+		if(_direct_runs.size() >= DIRECT_IO_MAX_RUNS)	// the least recently updated run is at the front
+		{
+			to_write.push_back(_direct_runs.front()) ;
+			_direct_runs.pop_front() ;
+		}
+		it = _direct_runs.insert(_direct_runs.end(), run) ;
+	}
+	else
+		_direct_runs.splice(_direct_runs.end(), _direct_runs, it) ;
+
+	memcpy(it->buffer + it->size, data, chunk_size) ;
+	it->size += chunk_size ;
+	it->packets.push_back(chunk_size) ;
+	it->last_update = now ;
+
+	// A run is written as soon as the slice it belongs to is complete, or when it cannot grow anymore.
+
+	bool run_is_over = (chunk_size % DIRECT_IO_ALIGNMENT != 0) ;
+
+	for(std::map<uint64_t,ftChunk>::const_iterator cit(mChunks.begin());!run_is_over && cit!=mChunks.end();++cit)
+		if(cit->second.offset + cit->second.size == offset + chunk_size)
+			run_is_over = true ;
+
+	if(run_is_over)
+	{
+		to_write.push_back(*it) ;
+		_direct_runs.erase(it) ;
+	}
+
+	if(!to_write.empty())
+		fflush(fd) ;	// what stdio still buffers must not land on the file after the direct writes.
+
+	return true ;
+#else
+	return false ;
+#endif
+}
+
+void ftFileCreator::locked_commitDirectIORun(DirectIORun& run, bool written)
+{
+#ifdef __linux__
+	// Only the block aligned part of the run was written directly.
+
+	uint32_t direct_size = run.size - run.size % DIRECT_IO_ALIGNMENT ;
+
+	if(written && direct_size < run.size)
+		written = fd != NULL && locked_writeData(run.offset + direct_size, run.size - direct_size, run.buffer + direct_size) ;
+
+	if(!written && fd != NULL)
+		written = locked_writeData(run.offset, run.size, run.buffer) ;
+
+	// Packets are notified one by one, as they were received, so that slices are matched the same way.
+
+	if(written)
+		for(uint32_t i=0,offset=0;i<run.packets.size();offset += run.packets[i++])
+		{
+			locked_notifyReceived(run.offset + offset, run.packets[i]) ;
+			locked_updateHash(run.offset + offset, run.packets[i], run.buffer + offset) ;
+		}
+
+	releaseDirectIOBuffer(run.buffer) ;
+	run.buffer = NULL ;
+#endif
+}
+
+bool ftFileCreator::locked_writeData(uint64_t offset, uint32_t chunk_size, const void *data)
+{
+	/* 
+	 * go to the offset of the file 
+	 */
+	if (0 != fseeko64(this->fd, offset, SEEK_SET))
+	{
+		std::cerr << "ftFileCreator::addFileData() Bad fseek at offset " << offset << ", fd=" << (void*)(this->fd) << ", size=" << mSize << ", errno=" << errno << std::endl;
+		return false;
+	}
+
+	if (1 != fwrite(data, chunk_size, 1, this->fd))
+	{
+		std::cerr << "ftFileCreator::addFileData() Bad fwrite." << std::endl;
+		std::cerr << "ERRNO: " << errno << std::endl;
+
+		return false;
+	}
+	return true;
+}
+
+void ftFileCreator::locked_preallocate()
+{
+#ifdef __linux__
+	// Reserving the whole file at once keeps it in few extents, although chunks are written in random order.
+	// fallocate() fails rather than writing zeros where the file system doesn't support it, which is what we want.
+
+	if(fallocate(fileno(fd), FALLOC_FL_KEEP_SIZE, 0, mSize) != 0)
+		std::cerr << "ftFileCreator: cannot preallocate " << mSize << " bytes for " << file_name << ", errno=" << errno << std::endl;
+#endif
+}
+
+void ftFileCreator::locked_resetHash()
+{
+	SHA1_Init(&_sha_ctx) ;
+	_hashed_offset = 0 ;
+}
+
+void ftFileCreator::locked_updateHash(uint64_t offset, uint32_t chunk_size, const void *data)
+{
+	// In order data is hashed straight from memory.
+
+	if(offset <= _hashed_offset && offset + chunk_size > _hashed_offset)
+	{
+		uint32_t skip = _hashed_offset - offset ;
+
+		SHA1_Update(&_sha_ctx, (const unsigned char *)data + skip, chunk_size - skip) ;
+		_hashed_offset = offset + chunk_size ;
+	}
+
+	// Then, if what follows is already on disk (received out of order, or before a restart), read it
+	// back. This is limited to one chunk at a time, so as not to keep the mutex for too long.
+
+	static const uint64_t chunk_size_max = ChunkMap::CHUNKMAP_FIXED_CHUNK_SIZE ;
+
+	if(_hashed_offset >= mSize || !chunkMap.isChunkReceived(_hashed_offset / chunk_size_max))
+		return ;
+
+	uint64_t chunk_end = std::min(mSize, (_hashed_offset / chunk_size_max + 1) * chunk_size_max) ;
+	uint32_t len = chunk_end - _hashed_offset ;
+
+	_hash_buffer.resize(chunk_size_max) ;
+
+	if(fseeko64(fd, _hashed_offset, SEEK_SET) != 0 || fread(_hash_buffer.data(), 1, len, fd) != len)
+	{
+		std::cerr << "ftFileCreator::locked_updateHash(): cannot read back data at offset " << _hashed_offset << " in " << file_name << std::endl;
+		return ;
+	}
+
+	SHA1_Update(&_sha_ctx, _hash_buffer.data(), len) ;
+	_hashed_offset = chunk_end ;
 }
 
 void ftFileCreator::removeInactiveChunks()
@@ -360,6 +685,19 @@ int ftFileCreator::locked_initializeFileAttrs()
 	std::cerr << "OPENNED FILE " << (void*)fd << " (" << file_name << "), for r/w." << std::endl ;
 #endif
 
+	if(_storage_flags & RS_FILE_PARTIALS_STORAGE_PREALLOCATE)
+		locked_preallocate() ;
+
+#ifdef __linux__
+	if((_storage_flags & RS_FILE_PARTIALS_STORAGE_DIRECT_IO) && _direct_fd < 0)
+	{
+		_direct_fd = open(file_name.c_str(), O_WRONLY | O_DIRECT) ;
+
+		if(_direct_fd < 0)
+			std::cerr << "ftFileCreator: cannot use direct I/O for " << file_name << ", errno=" << errno << std::endl;
+	}
+#endif
+
 	return 1;
 }
 ftFileCreator::~ftFileCreator()
@@ -370,6 +708,15 @@ ftFileCreator::~ftFileCreator()
 
 	// Note: The file is actually closed in the parent, that is always a ftFileProvider.
 	//
+#ifdef __linux__
+	if(_direct_fd >= 0)
+		close(_direct_fd) ;
+
+	// data still being gathered was never notified, and is simply received again.
+
+	for(std::list<DirectIORun>::iterator it(_direct_runs.begin());it!=_direct_runs.end();++it)
+		releaseDirectIOBuffer(it->buffer) ;
+#endif
 	/*
 	 * FIXME Any cleanups specific to filecreator?
 	 */
@@ -497,7 +844,8 @@ void ftFileCreator::setChunkStrategy(FileChunksInfo::ChunkStrategy s)
 	RsStackMutex stack(ftcMutex); /********** STACK LOCKED MTX ******/
 
 	// Let's check, for safety.
-	if(s != FileChunksInfo::CHUNK_STRATEGY_STREAMING && s != FileChunksInfo::CHUNK_STRATEGY_RANDOM && s != FileChunksInfo::CHUNK_STRATEGY_PROGRESSIVE)
+	if(s != FileChunksInfo::CHUNK_STRATEGY_STREAMING && s != FileChunksInfo::CHUNK_STRATEGY_RANDOM && s != FileChunksInfo::CHUNK_STRATEGY_PROGRESSIVE
+	        && s != FileChunksInfo::CHUNK_STRATEGY_RAREST_FIRST)
 	{
 		std::cerr << "ftFileCreator::ERROR: invalid chunk strategy " << s << "!" << " setting default value " << FileChunksInfo::CHUNK_STRATEGY_STREAMING << std::endl ;
 		s = FileChunksInfo::CHUNK_STRATEGY_PROGRESSIVE ;
@@ -700,8 +1048,63 @@ bool ftFileCreator::hashReceivedData(RsFileHash& hash)
 		return false ;
 	}
 
-	uint64_t tmpsize ;
-	return RsDirUtil::getFileHash(file_name,hash,tmpsize) ;
+	SHA_CTX sha_ctx ;
+	uint64_t offset ;
+
+	{
+		RsStackMutex stack(ftcMutex); /********** STACK LOCKED MTX ******/
+
+		sha_ctx = _sha_ctx ;
+		offset = _hashed_offset ;
+
+		if(fd != NULL)
+			fflush(fd) ;
+	}
+
+#ifdef FILE_DEBUG
+	std::cerr << "file creator: " << offset << " bytes already hashed, reading " << mSize - offset << " bytes from disk." << std::endl;
+#endif
+
+	// Hash whatever could not be hashed while receiving the data.
+
+	if(offset < mSize)
+	{
+		FILE *f = RsDirUtil::rs_fopen(file_name.c_str(), "rb") ;
+
+		if(f == NULL)
+			return false ;
+
+		static const uint32_t HASH_BUFFER_SIZE = 10*1024*1024 ;
+		std::vector<unsigned char> buf(HASH_BUFFER_SIZE) ;
+		size_t len ;
+
+		if(fseeko64(f, offset, SEEK_SET) != 0)
+		{
+			fclose(f) ;
+			return false ;
+		}
+
+		while((len = fread(buf.data(), 1, HASH_BUFFER_SIZE, f)) > 0)
+		{
+			SHA1_Update(&sha_ctx, buf.data(), len) ;
+			offset += len ;
+		}
+
+		bool ok = !ferror(f) ;
+		fclose(f) ;
+
+		if(!ok || offset != mSize)
+		{
+			std::cerr << "ftFileCreator::hashReceivedData(): cannot read " << file_name << std::endl;
+			return false ;
+		}
+	}
+
+	unsigned char sha_buf[SHA_DIGEST_LENGTH] ;
+	SHA1_Final(sha_buf, &sha_ctx) ;
+	hash = Sha1CheckSum(sha_buf) ;
+
+	return true ;
 }
 
 void ftFileCreator::forceCheck()
@@ -709,6 +1112,9 @@ void ftFileCreator::forceCheck()
 	RsStackMutex stack(ftcMutex); /********** STACK LOCKED MTX ******/
 
 	chunkMap.forceCheck(); 
+
+	// The check was forced because the file hash was wrong. Don't trust the on-the-fly hash either.
+	locked_resetHash() ;
 }
 
 void ftFileCreator::getSourcesList(uint32_t chunk_num,std::vector<RsPeerId>& sources)
@@ -727,37 +1133,58 @@ void ftFileCreator::getChunksToCheck(std::vector<uint32_t>& chunks_to_ask)
 
 bool ftFileCreator::verifyChunk(uint32_t chunk_number,const Sha1CheckSum& sum)
 {
-	RsStackMutex stack(ftcMutex); /********** STACK LOCKED MTX ******/
+	{
+		RsStackMutex stack(ftcMutex); /********** STACK LOCKED MTX ******/
 
-	if(!locked_initializeFileAttrs() )
-		return false ;
+		if(!locked_initializeFileAttrs() )
+			return false ;
+
+		fflush(fd) ;	// so that the data is visible to the file handle below
+	}
+
+	// Data is read with a separate file handle, out of the mutex. A chunk being checked is not
+	// written anymore, so this is safe, and allows to check multiple chunks in parallel.
 
 	static const uint32_t chunk_size = ChunkMap::CHUNKMAP_FIXED_CHUNK_SIZE ;
-	unsigned char *buff = new unsigned char[chunk_size] ;
-	uint32_t len ;
+	std::vector<unsigned char> buff(chunk_size) ;
+	uint32_t len = 0 ;
 
-	if(fseeko64(fd,(uint64_t)chunk_number * (uint64_t)chunk_size,SEEK_SET)==0 && (len = fread(buff,1,chunk_size,fd)) > 0)
+	FILE *f = RsDirUtil::rs_fopen(file_name.c_str(), "rb") ;
+
+	if(f != NULL)
 	{
-		Sha1CheckSum comp = RsDirUtil::sha1sum(buff,len) ;
+		if(fseeko64(f,(uint64_t)chunk_number * (uint64_t)chunk_size,SEEK_SET)==0)
+			len = fread(buff.data(),1,chunk_size,f) ;
+
+		fclose(f) ;
+	}
+
+	bool ok = false ;
+
+	if(len > 0)
+	{
+		Sha1CheckSum comp = RsDirUtil::sha1sum(buff.data(),len) ;
 
 		if(sum == comp)
-			chunkMap.setChunkCheckingResult(chunk_number,true) ;
+			ok = true ;
 		else
 		{
 			std::cerr << "Sum mismatch for chunk " << chunk_number << std::endl;
 			std::cerr << "    Computed  hash = " << comp.toStdString() << std::endl;
 			std::cerr << "    Reference hash = " << sum.toStdString() << std::endl;
-
-			chunkMap.setChunkCheckingResult(chunk_number,false) ;
 		}
 	}
 	else
-	{
 		printf("Chunk verification: cannot fseek!\n") ;
-		chunkMap.setChunkCheckingResult(chunk_number,false) ;
-	}
 
-	delete[] buff ;
+	RsStackMutex stack(ftcMutex); /********** STACK LOCKED MTX ******/
+
+	chunkMap.setChunkCheckingResult(chunk_number,ok) ;
+
+	// The chunk will be downloaded again, so whatever was hashed from it is wrong.
+	if(!ok && (uint64_t)chunk_number * (uint64_t)chunk_size < _hashed_offset)
+		locked_resetHash() ;
+
 	return true ;
 }
 
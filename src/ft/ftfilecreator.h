@@ -31,7 +31,10 @@
  */
 #include "ftfileprovider.h"
 #include "ftchunkmap.h"
+#include <list>
 #include <map>
+#include <vector>
+#include <openssl/sha.h>
 
 class ZeroInitCounter
 {
@@ -62,16 +65,26 @@ class ftFileCreator: public ftFileProvider
 		FileChunksInfo::ChunkStrategy getChunkStrategy() ;
 
 		// Computes a sha1sum of the partial file, to check that the data is overall consistent.
-		// This function is not mutexed. This is a bit dangerous, but otherwise we might stuck the GUI for a 
+		// The sha1 is computed as data is written, so only the part that could not be hashed on the fly
+		// (received out of order and not caught up yet) is read back from the disk.
+		// The file is read without the mutex. This is a bit dangerous, but otherwise we might stuck the GUI for a 
 		// long time. Therefore, we must pay attention not to call this function
 		// at a time file_name nor hash can be modified, which is quite easy.
 
 		bool hashReceivedData(RsFileHash& hash) ;
 
+		// Sets how the partial file is stored on disk (RS_FILE_PARTIALS_STORAGE_* flags). This takes effect
+		// when the file is opened, so it should be called before any data is written.
+		//
+		void setStoragePolicy(uint32_t flags) ;
+
 		// Sets all chunks to checking state
 		//
 		void forceCheck() ; 
 
+		// Checks the chunk data against the given sum. The data is read without holding the mutex, so that
+		// several chunks can be verified in parallel, while data keeps being received.
+		//
 		bool verifyChunk(uint32_t, const Sha1CheckSum&) ;
 
 		// Looks into the chunkmap for downloaded chunks that have not yet been certified.
@@ -134,7 +147,30 @@ class ftFileCreator: public ftFileProvider
 	private:
 
 		bool 	locked_printChunkMap();
+		bool	locked_writeData(uint64_t offset, uint32_t chunk_size, const void *data);
+
+		// Contiguous packets gathered for a single direct write. Packets are only notified once the run is on disk,
+		// so that the chunk map never points to data that is not in the file yet.
+		struct DirectIORun
+		{
+			unsigned char *buffer ;
+			uint64_t offset ;
+			uint32_t size ;
+			rstime_t last_update ;
+			std::vector<uint32_t> packets ;		// sizes of the packets, in the order they came
+		};
+
+		// Returns false when the data must be written the normal way. Otherwise, the data is copied into a run, and the
+		// runs that are ready are moved to to_write. These are written outside of the mutex, and then committed.
+		bool	locked_gatherDirectData(uint64_t offset, uint32_t chunk_size, const void *data, std::vector<DirectIORun>& to_write);
+		void	locked_commitDirectIORun(DirectIORun& run, bool written);
+		void	locked_preallocate();
 		int 	locked_notifyReceived(uint64_t offset, uint32_t chunk_size);
+
+		// Feeds the whole-file sha1 with newly written data if it follows what was already hashed, and
+		// then catches up with data already on disk, at most one chunk per call.
+		void	locked_updateHash(uint64_t offset, uint32_t chunk_size, const void *data);
+		void	locked_resetHash();
 		/* 
 		 * structure to track missing chunks 
 		 */
@@ -146,6 +182,14 @@ class ftFileCreator: public ftFileProvider
 
 		rstime_t _last_recv_time_t ;	/// last time stamp when data was received. Used for queue control.
 		rstime_t _creation_time ;		/// time at which the file creator was created. Used to spot long-inactive transfers.
+
+		SHA_CTX  _sha_ctx ;				/// whole-file sha1 of the first _hashed_offset bytes
+		uint64_t _hashed_offset ;
+		std::vector<unsigned char> _hash_buffer ;	/// used to read back data that was received out of order
+
+		uint32_t _storage_flags ;		/// RS_FILE_PARTIALS_STORAGE_* flags
+		int      _direct_fd ;			/// the file opened with O_DIRECT, or -1
+		std::list<DirectIORun> _direct_runs ;	/// runs being gathered, least recently updated first
 };
 
 #endif // FT_FILE_CREATOR_HEADER
@@ -568,6 +568,16 @@ std::string ftServer::getPartialsDirectory()
 	return mFtController->getPartialsDirectory();
 }
 
+void ftServer::setPartialsStoragePolicy(const std::string& path, uint32_t flags)
+{
+	mFtController->setPartialsStoragePolicy(path, flags);
+}
+
+uint32_t ftServer::partialsStoragePolicy(const std::string& path)
+{
+	return mFtController->partialsStoragePolicy(path);
+}
+
 /***************************************************************/
 /************************* Other Access ************************/
 /***************************************************************/
@@ -316,6 +316,8 @@ public:
     virtual bool setPartialsDirectory(const std::string& path) override;
     virtual std::string getDownloadDirectory() override;
     virtual std::string getPartialsDirectory() override;
+    virtual void setPartialsStoragePolicy(const std::string& path, uint32_t flags) override;
+    virtual uint32_t partialsStoragePolicy(const std::string& path) override;
 
     virtual bool	getSharedDirectories(std::list<SharedDirInfo> &dirs) override;
     virtual bool	setSharedDirectories(const std::list<SharedDirInfo> &dirs) override;
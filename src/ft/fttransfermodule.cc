@@ -23,6 +23,8 @@
  * #define FT_DEBUG 1
  *****/
 
+#include <chrono>
+
 #include "util/rstime.h"
 
 #include "retroshare/rsturtle.h"
@@ -42,6 +44,12 @@
  *
  * via the functions:
  *
+ * Requests to each peer are paced at a little more than the rate at which
+ * its data actually comes back, and the amount of data requested but not
+ * received yet is bounded by a window of about twice the bandwidth-delay
+ * product (delivery rate x min rtt). More data is asked as soon as some comes
+ * back, so that neither long links (Tor/I2P, turtle tunnels) nor fast LAN
+ * links are limited by the 1 sec tick.
  */
 
 const double   FT_TM_MAX_PEER_RATE 		       = 100 * 1024 * 1024; /* 100MB/s */
@@ -51,6 +59,14 @@ const uint32_t FT_TM_DEFAULT_TRANSFER_RATE     = 20*1024;           /* ie 20 Kb/
 const uint32_t FT_TM_RESTART_DOWNLOAD 	       = 20;                /* 20 seconds */
 const uint32_t FT_TM_DOWNLOAD_TIMEOUT 	       = 10;                /* 10 seconds */
 
+const double   FT_TM_DEFAULT_RTT               = 1.0;               /* 1 sec, until we measure it */
+const double   FT_TM_MIN_RTT_LIFETIME          = 10.0;              /* 10 seconds */
+const uint32_t FT_TM_OUTSTANDING_TIMEOUT       = 3;                 /* 3 seconds */
+const double   FT_TM_WINDOW_GAIN               = 2.0;
+const uint64_t FT_TM_MIN_WINDOW                = 32*1024;           /* 32 KB */
+const uint64_t FT_TM_MAX_WINDOW                = 64*1024*1024;      /* 64 MB */
+const uint32_t FT_TM_REQUEST_ALIGNMENT         = 8*1024;            /* 8 KB, see below */
+
 const double FT_TM_RATE_INCREASE_SLOWER  = 0.05 ;
 const double FT_TM_RATE_INCREASE_AVERAGE = 0.3 ;
 const double FT_TM_RATE_INCREASE_FASTER  = 1.0 ;
@@ -61,12 +77,21 @@ const double FT_TM_RATE_INCREASE_FASTER  = 1.0 ;
 #define FT_TM_FLAG_CHECKING 		3
 #define FT_TM_FLAG_CHUNK_CRC 		4
 
+/* Monotonic time in seconds, with sub-second precision, for rtt and pacing. */
+static double ft_tm_now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 peerInfo::peerInfo(const RsPeerId& peerId_in)
     :peerId(peerId_in),state(PQIPEER_NOT_ONLINE),desiredRate(FT_TM_DEFAULT_TRANSFER_RATE),actualRate(FT_TM_DEFAULT_TRANSFER_RATE),
 		lastTS(0),
 		recvTS(0), lastTransfers(0), nResets(0),
 		rtt(0), rttActive(false), rttStart(0), rttOffset(0),
-		mRateIncrease(1)
+		mRateIncrease(1),
+		srtt(0), minRtt(0), minRttTS(0),
+		pacingRate(FT_TM_DEFAULT_TRANSFER_RATE), credit(0), creditTS(0),
+		outstanding(0), window(FT_TM_MIN_WINDOW)
 	{
 	}
 //	peerInfo(const RsPeerId& peerId_in,uint32_t state_in,uint32_t maxRate_in):
@@ -228,6 +253,13 @@ bool ftTransferModule::setPeerState(const RsPeerId& peerId,uint32_t state,uint32
 
   (mit->second).state=state;
   (mit->second).desiredRate=maxRate;
+
+  if (state==PQIPEER_NOT_ONLINE)
+  {
+    // whatever was requested is lost
+    (mit->second).outstanding=0;
+    (mit->second).rttActive=false;
+  }
   // Start it off at zero....
   // (mit->second).actualRate=maxRate; /* should give big kick in right direction */
 
@@ -269,6 +301,22 @@ bool ftTransferModule::getPeerState(const RsPeerId& peerId,uint32_t &state,uint3
   return true;
 }
 
+bool ftTransferModule::getPeerState(const RsPeerId& peerId,uint32_t &state,uint32_t &tfRate,uint32_t &rtt,uint64_t &outstanding,uint64_t &window)
+{
+	RsStackMutex stack(tfMtx); /******* STACK LOCKED ******/
+	std::map<RsPeerId,peerInfo>::const_iterator mit = mFileSources.find(peerId);
+
+	if (mit == mFileSources.end()) return false;
+
+	state = mit->second.state;
+	tfRate = (uint32_t) mit->second.actualRate;
+	rtt = (uint32_t) (mit->second.srtt * 1000);
+	outstanding = mit->second.outstanding;
+	window = mit->second.window;
+
+	return true;
+}
+
 uint32_t ftTransferModule::getDataRate(const RsPeerId& peerId)
 {
   	RsStackMutex stack(tfMtx); /******* STACK LOCKED ******/
@@ -328,6 +376,10 @@ bool ftTransferModule::recvFileData(const RsPeerId& peerId, uint64_t offset, uin
 
 	locked_storeData(offset, chunk_size, data);
 
+	/* refill the window now rather than at next tick */
+	if (mFlag == FT_TM_FLAG_DOWNLOADING && mFileStatus.stat == ftFileStatus::PQIFILE_DOWNLOADING)
+		locked_requestPeerData(mit->second, false);
+
 	_last_activity_time_stamp = time(NULL) ;
 
 	free(data) ;
@@ -727,14 +779,31 @@ bool ftTransferModule::locked_tickPeerTransfer(peerInfo &info)
 		info.state = PQIPEER_DOWNLOADING;
 		info.recvTS = ts; /* reset to activate */
 		info.nResets = std::min(FT_TM_MAX_RESETS,info.nResets + 1);
+		info.outstanding = 0;
+		info.rttActive = false;
 		ageRecv = 0;
 	}
 
 	if (ageRecv > (int) FT_TM_DOWNLOAD_TIMEOUT)
 	{
 		info.state = PQIPEER_IDLE;
+		info.outstanding = 0;
+		info.rttActive = false;
 		return false;
 	}
+
+	/* Requests may get lost (peer restarted, tunnel changed, ...). If nothing
+	 * came back for a while, forget about them so they don't keep the window
+	 * closed.
+	 */
+	if (info.outstanding > 0 && ageRecv > std::max((double) FT_TM_OUTSTANDING_TIMEOUT, 2 * info.srtt))
+	{
+#ifdef FT_DEBUG
+		std::cerr << "locked_tickPeerTransfer() dropping " << info.outstanding << " outstanding bytes" << std::endl ;
+#endif
+		info.outstanding = 0;
+		info.rttActive = false;
+	}
 #ifdef FT_DEBUG
 	std::cerr << "locked_tickPeerTransfer() actual rate (before): " << info.actualRate << ", lastTransfers=" << info.lastTransfers << std::endl ;
 	std::cerr << mHash<< " - actual rate: " << info.actualRate << " lastTransfers=" << info.lastTransfers << ". AgeReq = " << ageReq << std::endl;
@@ -778,51 +847,99 @@ bool ftTransferModule::locked_tickPeerTransfer(peerInfo &info)
 //		}
 //	}
 
+	locked_updateRequestWindow(info);
+
+	/* Always keep a minimal request going when nothing is outstanding, so
+	 * that slow or newly started peers get a chance to show their rate.
+	 */
+	locked_requestPeerData(info, true);
+
+	return true;
+}
+
+	
+	
+void ftTransferModule::locked_updateRequestWindow(peerInfo &info)
+{
 	/* request at more than current rate */
-	uint32_t next_req = info.actualRate * (1.0 + info.mRateIncrease);
-#ifdef FT_DEBUG
-	std::cerr << "locked_tickPeerTransfer() actual rate (after): " << actualRate 
-				<< " info.desiredRate=" << info.desiredRate 
-				<< " info.actualRate=" << info.actualRate 
-				<< ", next_req=" << next_req ;
+	double rate = info.actualRate * (1.0 + info.mRateIncrease);
 
-	std::cerr << std::endl;
-#endif
+	if (rate > info.desiredRate * 1.1)
+		rate = info.desiredRate * 1.1;
 
-	if (next_req > info.desiredRate * 1.1)
-	{
-		next_req = info.desiredRate * 1.1;
-#ifdef FT_DEBUG
-		std::cerr << "locked_tickPeerTransfer() Reached MaxRate: next_req: " << next_req;
-		std::cerr << std::endl;
-#endif
-	}
+	if (rate > FT_TM_MAX_PEER_RATE)
+		rate = FT_TM_MAX_PEER_RATE;
 
+	if (rate < FT_TM_MINIMUM_CHUNK)
+		rate = FT_TM_MINIMUM_CHUNK;
+
+	info.pacingRate = rate;
+
+	/* Window is the bandwidth-delay product, with some headroom so that the
+	 * pipe stays full while the rate increases. The min rtt is used rather
+	 * than the smoothed one, since the latter also counts the time our own
+	 * requests spend queued at the peer.
+	 */
+	double rtt = (info.minRtt > 0) ? info.minRtt : FT_TM_DEFAULT_RTT;
+	double window = FT_TM_WINDOW_GAIN * rate * rtt;
+
+	if (window < FT_TM_MIN_WINDOW)
+		window = FT_TM_MIN_WINDOW;
+
+	if (window > FT_TM_MAX_WINDOW)
+		window = FT_TM_MAX_WINDOW;
+
+	info.window = (uint64_t) window;
 
-	if (next_req > FT_TM_MAX_PEER_RATE)
-	{
-		next_req = FT_TM_MAX_PEER_RATE;
 #ifdef FT_DEBUG
-		std::cerr << "locked_tickPeerTransfer() Reached AbsMaxRate: next_req: " << next_req;
-		std::cerr << std::endl;
+	std::cerr << "locked_updateRequestWindow() actual rate: " << info.actualRate
+	          << " pacing rate: " << info.pacingRate
+	          << " min rtt: " << info.minRtt
+	          << " window: " << info.window
+	          << " outstanding: " << info.outstanding << std::endl;
 #endif
-	}
+}
+
+void ftTransferModule::locked_requestPeerData(peerInfo &info, bool keep_alive)
+{
+	if (info.state == PQIPEER_SUSPEND)
+		return;
+
+	double now = ft_tm_now();
+
+	/* credit grows at pacing rate, but never more than a window at once */
+	info.credit += (now - info.creditTS) * info.pacingRate;
+	info.creditTS = now;
 
+	if (info.credit > info.window)
+		info.credit = info.window;
+
+	if (info.outstanding >= info.window)
+		return;
+
+	double allowed = std::min(info.credit, (double) (info.window - info.outstanding));
+	uint32_t next_req = (allowed > 0) ? (uint32_t) allowed : 0;
 
 	if (next_req < FT_TM_MINIMUM_CHUNK)
 	{
+		if (!keep_alive || info.outstanding > 0)
+			return;
+
 		next_req = FT_TM_MINIMUM_CHUNK;
-#ifdef FT_DEBUG
-		std::cerr << "locked_tickPeerTransfer() small chunk: next_req: " << next_req;
-		std::cerr << std::endl;
-#endif
 	}
 
+	/* Chunks start on 1MB boundaries, so keeping slice sizes a multiple of the
+	 * alignment keeps slices block aligned in the file. Partials can then be
+	 * written with direct I/O, and writes never straddle disk blocks.
+	 */
+	if (next_req > FT_TM_REQUEST_ALIGNMENT)
+		next_req -= next_req % FT_TM_REQUEST_ALIGNMENT;
+
 #ifdef FT_DEBUG
-	std::cerr << "locked_tickPeerTransfer() desired  next_req: " << next_req;
+	std::cerr << "locked_requestPeerData() desired  next_req: " << next_req;
 	std::cerr << std::endl;
 #endif
-	
+
 	/* do request */
 	uint64_t req_offset = 0;
 	uint32_t req_size =0 ;
@@ -840,10 +957,12 @@ bool ftTransferModule::locked_tickPeerTransfer(peerInfo &info)
 			/* start next rtt measurement */
 			if (!info.rttActive)
 			{
-				info.rttStart = ts;
+				info.rttStart = now;
 				info.rttActive = true;
-				info.rttOffset = req_offset + req_size;
+				info.rttOffset = req_offset;
 			}
+			info.outstanding += req_size;
+			info.credit -= req_size;
 			next_req -= std::min(req_size,next_req) ;
 		}
 		else
@@ -852,12 +971,8 @@ bool ftTransferModule::locked_tickPeerTransfer(peerInfo &info)
 			std::cerr << std::endl;
 			break ;
 		}
-
-	return true;
 }
 
-	
-	
   //interface to client module
 bool ftTransferModule::locked_recvPeerData(peerInfo &info, uint64_t offset, uint32_t chunk_size, void *)
 {
@@ -876,11 +991,13 @@ bool ftTransferModule::locked_recvPeerData(peerInfo &info, uint64_t offset, uint
   info.nResets = 0;
   info.state = PQIPEER_DOWNLOADING;
   info.lastTransfers += chunk_size;
+  info.outstanding -= std::min((uint64_t) chunk_size, info.outstanding);
 
-   if ((info.rttActive) && (info.rttOffset == offset + chunk_size))
+   if ((info.rttActive) && (info.rttOffset == offset))
    {
  	  /* update tip */
- 	  int32_t rtt = time(NULL) - info.rttStart;
+ 	  double now = ft_tm_now();
+ 	  double rtt = now - info.rttStart;
  
  	  /* 
  		* FT_TM_FAST_RTT = 1 sec. mRateIncrease =  1.00
@@ -907,9 +1024,18 @@ bool ftTransferModule::locked_recvPeerData(peerInfo &info, uint64_t offset, uint
 		  case SPEED_NORMAL	: info.mRateIncrease = FT_TM_RATE_INCREASE_AVERAGE; break ;
 		  case SPEED_HIGH  	: info.mRateIncrease = FT_TM_RATE_INCREASE_FASTER ; break ;
 	  }
- 	  info.rtt = rtt;
+ 	  info.rtt = (uint32_t) (rtt * 1000);
  	  info.rttActive = false;
 
+	  info.srtt = (info.srtt > 0) ? 0.875 * info.srtt + 0.125 * rtt : rtt;
+
+	  if (info.minRtt <= 0 || rtt <= info.minRtt || now - info.minRttTS > FT_TM_MIN_RTT_LIFETIME)
+	  {
+		  info.minRtt = rtt;
+		  info.minRttTS = now;
+	  }
+	  locked_updateRequestWindow(info);
+
 #ifdef FT_DEBUG
 	  std::cerr << "ftTransferModule::locked_recvPeerData()";
 	  std::cerr << "Updated Rate based on RTT: " << rtt;
@@ -75,11 +75,23 @@ public:
 	uint32_t lastTransfers;    /* data recvd in last second */
 	uint32_t nResets;          /* count to disable non-existant files */
 
-	uint32_t rtt;              /* last rtt */
+	uint32_t rtt;              /* last rtt (ms) */
 	bool     rttActive;        /* have we initialised an rtt measurement */
-	rstime_t	 rttStart;     /* ts of request */
-	uint64_t rttOffset;        /* end of request */
+	double   rttStart;         /* time of request (s, monotonic) */
+	uint64_t rttOffset;        /* start of request */
 	float    mRateIncrease;    /* current rate increase factor */
+
+	/* request window. Requests are paced at pacingRate and the amount of
+	 * requested-but-not-received data is kept below the window, which
+	 * follows the bandwidth-delay product measured for this peer. */
+	double   srtt;             /* smoothed rtt (s) */
+	double   minRtt;           /* lowest rtt seen recently (s), 0 if unknown */
+	double   minRttTS;         /* time of the minRtt sample */
+	double   pacingRate;       /* rate at which requests are issued (B/s) */
+	double   credit;           /* bytes we are allowed to request right now */
+	double   creditTS;         /* last credit update */
+	uint64_t outstanding;      /* bytes requested and not received yet */
+	uint64_t window;           /* target for outstanding bytes */
 };
 
 class ftFileStatus
@@ -121,6 +133,7 @@ public:
   bool setPeerState(const RsPeerId& peerId,uint32_t state,uint32_t maxRate);  //state = ONLINE/OFFLINE
   bool getFileSources(std::list<RsPeerId> &peerIds);
   bool getPeerState(const RsPeerId& peerId,uint32_t &state,uint32_t &tfRate);
+  bool getPeerState(const RsPeerId& peerId,uint32_t &state,uint32_t &tfRate,uint32_t &rtt,uint64_t &outstanding,uint64_t &window);
   uint32_t getDataRate(const RsPeerId& peerId);
   bool cancelTransfer();
   bool cancelFileTransferUpward();
@@ -155,6 +168,8 @@ public:
 private:
 
   bool locked_tickPeerTransfer(peerInfo &info);
+  void locked_updateRequestWindow(peerInfo &info);
+  void locked_requestPeerData(peerInfo &info, bool keep_alive);
   bool locked_recvPeerData(peerInfo &info, uint64_t offset,
 			uint32_t chunk_size, void *data);
   
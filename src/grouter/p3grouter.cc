@@ -295,6 +295,9 @@ int p3GRouter::tick()
     // If content has changed, save config, at most every RS_GROUTER_MIN_CONFIG_SAVE_PERIOD seconds appart
     // Otherwise, always save at least every RS_GROUTER_MAX_CONFIG_SAVE_PERIOD seconds
     //
+    // No config journal here (see p3Config::enableConfigJournal()): routing clues are aggregated and
+    // pending messages change status in place, so deltas would be about as large as the whole state.
+    //
     if(_changed && now > _last_config_changed + RS_GROUTER_MIN_CONFIG_SAVE_PERIOD)
     {
 #ifdef GROUTER_DEBUG
@@ -484,24 +484,20 @@ bool GxsSecurity::validateNxsMsg(const RsNxsMsg& msg, const RsTlvKeySignature& s
 		EVP_MD_CTX *mdctx = EVP_MD_CTX_create();
 
 		uint32_t metaDataLen = msgMeta.serial_size();
-		uint32_t allMsgDataLen = metaDataLen + msg.msg.bin_len;
 
 		RsTemporaryMemory metaData(metaDataLen) ;
-		RsTemporaryMemory allMsgData(allMsgDataLen) ;
 
-		if(!metaData || !allMsgData)
+		if(!metaData)
 			return false ;
 		
 		msgMeta.serialise(metaData, &metaDataLen);
 
-		// copy msg data and meta in allmsgData buffer
-		memcpy(allMsgData, msg.msg.bin_data, msg.msg.bin_len);
-		memcpy(allMsgData+(msg.msg.bin_len), metaData, metaDataLen);
-
-		/* calc and check signature */
+		/* calc and check signature. The signed data is msg data followed by meta data:
+		 * feed both to the digest rather than copying them in a single buffer. */
 
 		EVP_VerifyInit(mdctx, EVP_sha1());
-		EVP_VerifyUpdate(mdctx, allMsgData, allMsgDataLen);
+		EVP_VerifyUpdate(mdctx, msg.msg.bin_data, msg.msg.bin_len);
+		EVP_VerifyUpdate(mdctx, metaData, metaDataLen);
 
 		signOk = EVP_VerifyFinal(mdctx, sigbuf, siglen, signKey);
 
@@ -1125,22 +1121,17 @@ bool GxsSecurity::validateNxsGrp(const RsNxsGrp& grp, const RsTlvKeySignature& s
 	for(uint32_t i=0;i<api_versions_to_check.size() && 0==signOk;++i)
 	{
 		uint32_t metaDataLen = grpMeta.serial_size(api_versions_to_check[i]);
-		uint32_t allGrpDataLen = metaDataLen + grp.grp.bin_len;
 
 		RsTemporaryMemory metaData(metaDataLen) ;
-		RsTemporaryMemory allGrpData(allGrpDataLen) ;// msgData + metaData
 
 		grpMeta.serialise(metaData, metaDataLen,api_versions_to_check[i]);
 
-		// copy msg data and meta in allmsgData buffer
-		memcpy(allGrpData, grp.grp.bin_data, grp.grp.bin_len);
-		memcpy(allGrpData+(grp.grp.bin_len), metaData, metaDataLen);
-
-		/* calc and check signature */
+		/* calc and check signature over grp data followed by meta data */
 		EVP_MD_CTX *mdctx = EVP_MD_CTX_create();
 
 		EVP_VerifyInit(mdctx, EVP_sha1());
-		EVP_VerifyUpdate(mdctx, allGrpData, allGrpDataLen);
+		EVP_VerifyUpdate(mdctx, grp.grp.bin_data, grp.grp.bin_len);
+		EVP_VerifyUpdate(mdctx, metaData, metaDataLen);
 		signOk = EVP_VerifyFinal(mdctx, sigbuf, siglen, signKey);
 		EVP_MD_CTX_destroy(mdctx);
 
@@ -45,6 +45,20 @@
 #define GRP_LAST_POST_UPDATE_TRIGGER std::string("LAST_POST_UPDATE")
 
 #define MSG_INDEX_GRPID std::string("INDEX_MESSAGES_GRPID")
+#define MSG_INDEX_GRPID_TIMESTAMP std::string("INDEX_MESSAGES_GRPID_TIMESTAMP")
+#define MSG_INDEX_GRPID_THREADID std::string("INDEX_MESSAGES_GRPID_THREADID")
+#define MSG_INDEX_GRPID_PARENTID std::string("INDEX_MESSAGES_GRPID_PARENTID")
+#define MSG_INDEX_GRPID_RECVTS std::string("INDEX_MESSAGES_GRPID_RECVTS")
+
+// Default memory budget of the message meta data cache. See RsDataService::setCacheSize()
+static const uint32_t MSG_META_CACHE_DEFAULT_BUDGET = 64 * 1024 * 1024; // 64 MB
+
+// Database maintenance. See RsDataService::performMaintenance()
+static const uint32_t DB_PAGE_CACHE_SIZE_KB       = 8 * 1024;     // sqlite page cache, per database
+static const uint32_t DB_MAINTENANCE_IDLE_DELAY   = 60;           // no write since 1 min before doing heavy work
+static const uint32_t DB_INCREMENTAL_VACUUM_PAGES = 256;          // pages released per vacuum step
+static const uint32_t DB_INCREMENTAL_VACUUM_STEPS = 16;           // max vacuum steps per maintenance call
+static const uint32_t DB_ANALYZE_PERIOD           = 24 * 3600;    // 1 day
 
 // generic
 #define KEY_NXS_DATA        std::string("nxsData")
@@ -60,6 +74,7 @@
 #define KEY_NXS_SERV_STRING std::string("serv_str")
 #define KEY_NXS_HASH        std::string("hash")
 #define KEY_RECV_TS         std::string("recv_time_stamp")
+#define KEY_ROW_ID          std::string("rowid")
 
 // remove later
 #define KEY_NXS_FILE_OLD std::string("nxsFile")
@@ -119,7 +134,9 @@ static int addColumn(std::list<std::string> &list, const std::string &attribute)
 
 RsDataService::RsDataService(const std::string &serviceDir, const std::string &dbName, uint16_t serviceType,
                              RsGxsSearchModule * /* mod */, const std::string& key)
-    : RsGeneralDataService(), mDbMutex("RsDataService"), mServiceDir(serviceDir), mDbName(dbName), mDbPath(mServiceDir + "/" + dbName), mServType(serviceType), mDb(NULL)
+    : RsGeneralDataService(), mDbMutex("RsDataService"), mServiceDir(serviceDir), mDbName(dbName), mDbPath(mServiceDir + "/" + dbName), mServType(serviceType), mDb(NULL),
+      mMsgMetaCacheBudget(MSG_META_CACHE_DEFAULT_BUDGET), mMsgMetaCacheAccessCounter(0),
+      mWalEnabled(false), mMaintenanceIdleDelay(DB_MAINTENANCE_IDLE_DELAY), mLastWriteTS(time(NULL)), mLastVacuumTS(0), mLastAnalyzeTS(0)
 {
     bool isNewDatabase = !RsDirUtil::fileExists(mDbPath);
 
@@ -146,6 +163,10 @@ RsDataService::RsDataService(const std::string &serviceDir, const std::string &d
     mColMsgMeta_RecvTs        = addColumn(mMsgMetaColumns, KEY_RECV_TS);
     mColMsgMeta_NxsDataLen    = addColumn(mMsgMetaColumns, KEY_NXS_DATA_LEN);
 
+    // for retrieving msg meta page by page
+    mMsgMetaColumnsWithRowId = mMsgMetaColumns;
+    mColMsgMeta_RowId         = addColumn(mMsgMetaColumnsWithRowId, KEY_ROW_ID);
+
     // for retrieving actual data
     mColMsg_GrpId = addColumn(mMsgColumns, KEY_GRP_ID);
     mColMsg_NxsData = addColumn(mMsgColumns, KEY_NXS_DATA);
@@ -289,14 +310,59 @@ static bool moveDataFromFileToDatabase(RetroDb *db, const std::string serviceDir
     return ok;
 }
 
+static bool createMessageIndexes(RetroDb *db)
+{
+    // These indexes are used by the paged meta data retrieval, which filters messages by time range, thread and parent.
+    bool ok = db->execSQL("CREATE INDEX IF NOT EXISTS " + MSG_INDEX_GRPID_TIMESTAMP + " ON " + MSG_TABLE_NAME + "(" + KEY_GRP_ID + "," + KEY_TIME_STAMP + ");");
+    ok = ok && db->execSQL("CREATE INDEX IF NOT EXISTS " + MSG_INDEX_GRPID_THREADID + " ON " + MSG_TABLE_NAME + "(" + KEY_GRP_ID + "," + KEY_MSG_THREAD_ID + ");");
+    ok = ok && db->execSQL("CREATE INDEX IF NOT EXISTS " + MSG_INDEX_GRPID_PARENTID + " ON " + MSG_TABLE_NAME + "(" + KEY_GRP_ID + "," + KEY_MSG_PARENT_ID + ");");
+
+    return ok;
+}
+
+static bool createMessageRecvTsIndex(RetroDb *db)
+{
+    // Used by the paged meta data retrieval when it filters the messages of a group on their reception time.
+    return db->execSQL("CREATE INDEX IF NOT EXISTS " + MSG_INDEX_GRPID_RECVTS + " ON " + MSG_TABLE_NAME + "(" + KEY_GRP_ID + "," + KEY_RECV_TS + "," + KEY_MSG_ID + ");");
+}
+
+void RsDataService::locked_configureDatabase(bool isNewDatabase)
+{
+    // auto_vacuum can only be switched on an empty database. Older databases need one full VACUUM, which is done
+    // here before any request is served rather than by the maintenance, so that it never stalls readers nor writers.
+    if (isNewDatabase)
+        mDb->execPragma("auto_vacuum=INCREMENTAL");
+    else if (mDb->pragmaValue("auto_vacuum") != 2)
+    {
+        std::cerr << "Database " << mDbName << ": converting to incremental vacuum. This may take a while." << std::endl;
+
+        if (mDb->execPragma("auto_vacuum=INCREMENTAL") && mDb->vacuum())
+            mLastVacuumTS = time(NULL);
+        else
+            std::cerr << "Database " << mDbName << ": conversion to incremental vacuum failed, free pages will not be reclaimed." << std::endl;
+    }
+
+    std::string journalMode;
+    mWalEnabled = mDb->execPragma("journal_mode=WAL", journalMode) && journalMode == "wal";
+
+    if (!mWalEnabled)
+        std::cerr << "Database " << mDbName << ": cannot enable write ahead log, journal mode is \"" << journalMode << "\"." << std::endl;
+
+    // WAL makes NORMAL safe against corruption, only the last transactions can be lost on power failure.
+    mDb->execPragma("synchronous=NORMAL");
+    mDb->execPragma("cache_size=-" + std::to_string(DB_PAGE_CACHE_SIZE_KB));
+}
+
 void RsDataService::initialise(bool isNewDatabase)
 {
-    const int databaseRelease = 1;
+    const int databaseRelease = 3;
     int currentDatabaseRelease = 0;
     bool ok = true;
 
     RsStackMutex stack(mDbMutex);
 
+    locked_configureDatabase(isNewDatabase);
+
     // initialise database
 
     if (isNewDatabase || !mDb->tableExists(DATABASE_RELEASE_TABLE_NAME)) {
@@ -366,6 +432,8 @@ void RsDataService::initialise(bool isNewDatabase)
                 + std::string("END;"));
 
         mDb->execSQL("CREATE INDEX " + MSG_INDEX_GRPID + " ON " + MSG_TABLE_NAME + "(" + KEY_GRP_ID +  ");");
+        createMessageIndexes(mDb);
+        createMessageRecvTsIndex(mDb);
 
         // Insert release, no need to upgrade
         ContentValue cv;
@@ -441,6 +509,28 @@ void RsDataService::initialise(bool isNewDatabase)
                 currentDatabaseRelease = newRelease;
             }
         }
+
+        // Release 2
+        newRelease = 2;
+        if (ok && currentDatabaseRelease < newRelease) {
+            ok = startReleaseUpdate(newRelease);
+            ok = ok && createMessageIndexes(mDb);
+            ok = finishReleaseUpdate(newRelease, ok);
+
+            if (ok)
+                currentDatabaseRelease = newRelease;
+        }
+
+        // Release 3
+        newRelease = 3;
+        if (ok && currentDatabaseRelease < newRelease) {
+            ok = startReleaseUpdate(newRelease);
+            ok = ok && createMessageRecvTsIndex(mDb);
+            ok = finishReleaseUpdate(newRelease, ok);
+
+            if (ok)
+                currentDatabaseRelease = newRelease;
+        }
     }
 
     if (ok) {
@@ -563,6 +653,9 @@ std::shared_ptr<RsGxsGrpMetaData> RsDataService::locked_getGrpMeta(RetroCursor&
     c.getString(mColGrpMeta_ParentGrpId, tempId);
     grpMeta->mParentGrpId = RsGxsGroupId(tempId);
 
+    if(mUseCache)
+        mGrpMetaDataCache.updateMetaSize(grpMeta->mGroupId);
+
 	// make sure that flags and keys are actually consistent
 
 	bool have_private_admin_key = false ;
@@ -667,7 +760,7 @@ std::shared_ptr<RsGxsMsgMetaData> RsDataService::locked_getMsgMeta(RetroCursor &
     std::shared_ptr<RsGxsMsgMetaData> msgMeta;
 
     if(mUseCache)
-        msgMeta = mMsgMetaDataCache[group_id].getOrCreateMeta(msg_id);
+        msgMeta = locked_msgMetaCache(group_id).getOrCreateMeta(msg_id);
 	else
         msgMeta = std::make_shared<RsGxsMsgMetaData>();
 
@@ -707,6 +800,9 @@ std::shared_ptr<RsGxsMsgMetaData> RsDataService::locked_getMsgMeta(RetroCursor &
     msgMeta->mMsgStatus = c.getInt32(mColMsgMeta_MsgStatus + colOffset);
     msgMeta->mChildTs = c.getInt32(mColMsgMeta_ChildTs + colOffset);
 
+    if(mUseCache)
+        locked_msgMetaCache(group_id).updateMetaSize(msg_id);
+
     if(ok)
         return msgMeta;
 
@@ -758,6 +854,7 @@ int RsDataService::storeMessage(const std::list<RsNxsMsg*>& msg)
 {
 
     RsStackMutex stack(mDbMutex);
+    mLastWriteTS = time(NULL);
 
     // start a transaction
     mDb->beginTransaction();
@@ -786,11 +883,14 @@ int RsDataService::storeMessage(const std::list<RsNxsMsg*>& msg)
 
         ContentValue cv;
 
+        // serialise the payload once, straight into the buffer that is bound to the insert
+        // statement, and drop the item's copy of it right away
         uint32_t dataLen = msgPtr->msg.TlvSize();
-        char msgData[dataLen];
+        char* msgData = new char[dataLen];
         uint32_t offset = 0;
         msgPtr->msg.SetTlv(msgData, dataLen, &offset);
-        cv.put(KEY_NXS_DATA, dataLen, msgData);
+        cv.putOwned(KEY_NXS_DATA, dataLen, msgData);
+        msgPtr->msg.TlvClear();
 
         cv.put(KEY_NXS_DATA_LEN, (int32_t)dataLen);
         cv.put(KEY_MSG_ID, msgMetaPtr->mMsgId.toStdString());
@@ -837,7 +937,7 @@ int RsDataService::storeMessage(const std::list<RsNxsMsg*>& msg)
         // This is needed so that mLastPost is correctly updated in the group meta when it is re-loaded.
 
         if(mUseCache)
-                mMsgMetaDataCache[msgMetaPtr->mGroupId].updateMeta(msgMetaPtr->mMsgId,*msgMetaPtr);
+                locked_msgMetaCache(msgMetaPtr->mGroupId).updateMeta(msgMetaPtr->mMsgId,*msgMetaPtr);
 
         delete *mit;
     }
@@ -845,6 +945,9 @@ int RsDataService::storeMessage(const std::list<RsNxsMsg*>& msg)
     // finish transaction
     bool ret = mDb->commitTransaction();
 
+    if(mUseCache)
+        locked_enforceMsgMetaCacheBudget();
+
     return ret;
 }
 
@@ -860,6 +963,7 @@ int RsDataService::storeGroup(const std::list<RsNxsGrp*>& grp)
 {
 
     RsStackMutex stack(mDbMutex);
+    mLastWriteTS = time(NULL);
 
     // begin transaction
     mDb->beginTransaction();
@@ -890,10 +994,10 @@ int RsDataService::storeGroup(const std::list<RsNxsGrp*>& grp)
 		ContentValue cv;
 
 		uint32_t dataLen = grpPtr->grp.TlvSize();
-		char grpData[dataLen];
+		char* grpData = new char[dataLen];
 		uint32_t offset = 0;
 		grpPtr->grp.SetTlv(grpData, dataLen, &offset);
-		cv.put(KEY_NXS_DATA, dataLen, grpData);
+		cv.putOwned(KEY_NXS_DATA, dataLen, grpData);
 
 		cv.put(KEY_NXS_DATA_LEN, (int32_t) dataLen);
 		cv.put(KEY_GRP_ID, grpPtr->grpId.toStdString());
@@ -953,6 +1057,7 @@ int RsDataService::updateGroup(const std::list<RsNxsGrp *> &grp)
 {
 
     RsStackMutex stack(mDbMutex);
+    mLastWriteTS = time(NULL);
 
     // begin transaction
     mDb->beginTransaction();
@@ -976,10 +1081,10 @@ int RsDataService::updateGroup(const std::list<RsNxsGrp *> &grp)
          **/
         ContentValue cv;
         uint32_t dataLen = grpPtr->grp.TlvSize();
-        char grpData[dataLen];
+        char* grpData = new char[dataLen];
         uint32_t offset = 0;
         grpPtr->grp.SetTlv(grpData, dataLen, &offset);
-        cv.put(KEY_NXS_DATA, dataLen, grpData);
+        cv.putOwned(KEY_NXS_DATA, dataLen, grpData);
 
         cv.put(KEY_NXS_DATA_LEN, (int32_t) dataLen);
         cv.put(KEY_GRP_ID, grpPtr->grpId.toStdString());
@@ -1030,6 +1135,7 @@ int RsDataService::updateGroup(const std::list<RsNxsGrp *> &grp)
 int RsDataService::updateGroupKeys(const RsGxsGroupId& grpId,const RsTlvSecurityKeySet& keys,uint32_t subscribe_flags)
 {
     RsStackMutex stack(mDbMutex);
+    mLastWriteTS = time(NULL);
 
     // begin transaction
     mDb->beginTransaction();
@@ -1270,7 +1376,7 @@ int RsDataService::retrieveGxsMsgMetaData(const GxsMsgReq& reqIds, GxsMsgMetaRes
         // if vector empty then request all messages
 
         // The pointer here is a trick to not initialize a new cache entry when cache is disabled, while keeping the unique variable all along.
-        t_MetaDataCache<RsGxsMessageId,RsGxsMsgMetaData> *cache(mUseCache? (&mMsgMetaDataCache[grpId]) : nullptr);
+        t_MetaDataCache<RsGxsMessageId,RsGxsMsgMetaData> *cache(mUseCache? (&locked_msgMetaCache(grpId)) : nullptr);
 
         if(msgIdV.empty())
         {
@@ -1318,7 +1424,7 @@ int RsDataService::retrieveGxsMsgMetaData(const GxsMsgReq& reqIds, GxsMsgMetaRes
                         metaSet.push_back(meta);
 
                         if(mUseCache)
-                            mMsgMetaDataCache[grpId].updateMeta(msgId,meta);
+                            cache->updateMeta(msgId,meta);
                     }
 
                     delete c;
@@ -1335,9 +1441,117 @@ int RsDataService::retrieveGxsMsgMetaData(const GxsMsgReq& reqIds, GxsMsgMetaRes
     std::cerr << "RsDataService::retrieveGxsMsgMetaData() " << mDbName << ", Requests: " << reqIds.size() << ", Results: " << resultCount << ", Time: " << timer.duration() << std::endl;
 #endif
 
+    if(mUseCache)
+        locked_enforceMsgMetaCacheBudget();
+
+    return 1;
+}
+
+int RsDataService::retrieveGxsMsgMetaDataPage(const RsGxsMsgMetaFilter& filter, uint64_t& cursor, uint32_t pageSize,
+                                              std::vector<std::shared_ptr<RsGxsMsgMetaData> >& msgMeta)
+{
+    RS_STACK_MUTEX(mDbMutex);
+
+    if(filter.mGrpId.isNull())
+    {
+        RsErr() << __PRETTY_FUNCTION__ << ": cannot retrieve msg meta data without a group id." << std::endl;
+        cursor = 0;
+        return 0;
+    }
+
+    // Build the selection. All predicates but the rowid one are covered by the
+    // message indexes, and the rowid is implicitly the last column of each of them.
+
+    std::string selection = KEY_GRP_ID + "='" + filter.mGrpId.toStdString() + "'";
+
+    if(!filter.mThreadId.isNull())  selection += " AND " + KEY_MSG_THREAD_ID + "='" + filter.mThreadId.toStdString() + "'";
+    if(!filter.mParentId.isNull())  selection += " AND " + KEY_MSG_PARENT_ID + "='" + filter.mParentId.toStdString() + "'";
+    if(!filter.mOrigMsgId.isNull()) selection += " AND " + KEY_ORIG_MSG_ID + "='" + filter.mOrigMsgId.toStdString() + "'";
+
+    if(filter.mMinPublishTs > 0) selection += " AND " + KEY_TIME_STAMP + ">=" + std::to_string(filter.mMinPublishTs);
+    if(filter.mMaxPublishTs > 0) selection += " AND " + KEY_TIME_STAMP + "<=" + std::to_string(filter.mMaxPublishTs);
+    if(filter.mMinRecvTs > 0)    selection += " AND " + KEY_RECV_TS + ">=" + std::to_string(filter.mMinRecvTs);
+    if(filter.mMaxRecvTs > 0)    selection += " AND " + KEY_RECV_TS + "<=" + std::to_string(filter.mMaxRecvTs);
+
+    if(cursor > 0)
+        selection += " AND " + KEY_ROW_ID + ">" + std::to_string(cursor);
+
+    RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, mMsgMetaColumnsWithRowId, selection, KEY_ROW_ID, pageSize);
+
+    if(!c)
+    {
+        cursor = 0;
+        return 0;
+    }
+
+    uint32_t count = 0;
+    uint64_t lastRowId = 0;
+
+    for(bool valid = c->moveToFirst(); valid; valid = c->moveToNext())
+    {
+        lastRowId = c->getInt64(mColMsgMeta_RowId);
+        ++count;
+
+        auto meta = locked_getMsgMeta(*c, 0);
+
+        if(meta)
+            msgMeta.push_back(meta);
+    }
+    delete c;
+
+    // A short page means that the end of the result set was reached.
+    cursor = (pageSize > 0 && count == pageSize) ? lastRowId : 0;
+
+#ifdef RS_DATA_SERVICE_DEBUG_CACHE
+    std::cerr << mDbName << ": Retrieving page of Msg metadata grpId=" << filter.mGrpId << ", " << std::dec << count << " messages, next cursor=" << cursor << std::endl;
+#endif
+
+    if(mUseCache)
+        locked_enforceMsgMetaCacheBudget();
+
     return 1;
 }
 
+t_MetaDataCache<RsGxsMessageId,RsGxsMsgMetaData>& RsDataService::locked_msgMetaCache(const RsGxsGroupId& grpId)
+{
+    auto& cache(mMsgMetaDataCache[grpId]);
+    cache.setLastAccess(++mMsgMetaCacheAccessCounter);
+
+    return cache;
+}
+
+void RsDataService::locked_enforceMsgMetaCacheBudget()
+{
+    uint64_t total_size = 0;
+
+    for(auto& it:mMsgMetaDataCache)
+        total_size += it.second.totalSize();
+
+    if(total_size <= mMsgMetaCacheBudget)
+        return;
+
+    // Sort group caches by access stamp, and drop the oldest ones first. Metas that are still
+    // used by a client stay alive thanks to the shared pointers.
+
+    std::vector<std::pair<uint64_t,RsGxsGroupId> > lru;
+
+    for(auto& it:mMsgMetaDataCache)
+        lru.push_back(std::make_pair(it.second.lastAccess(),it.first));
+
+    std::sort(lru.begin(),lru.end());
+
+    for(uint32_t i=0;i<lru.size() && total_size > mMsgMetaCacheBudget;++i)
+    {
+        auto it = mMsgMetaDataCache.find(lru[i].second);
+
+#ifdef RS_DATA_SERVICE_DEBUG_CACHE
+        std::cerr << mDbName << ": dropping msg meta cache of group " << it->first << " (" << it->second.totalSize() << " bytes)" << std::endl;
+#endif
+        total_size -= it->second.totalSize();
+        mMsgMetaDataCache.erase(it);
+    }
+}
+
 void RsDataService::locked_retrieveGrpMetaList(RetroCursor *c, std::map<RsGxsGroupId,std::shared_ptr<RsGxsGrpMetaData> >& grpMeta)
 {
 	if(!c)
@@ -1494,6 +1708,10 @@ int RsDataService::resetDataStore()
         RsStackMutex stack(mDbMutex);
 
         mDb->execSQL("DROP INDEX " + MSG_INDEX_GRPID);
+        mDb->execSQL("DROP INDEX IF EXISTS " + MSG_INDEX_GRPID_TIMESTAMP);
+        mDb->execSQL("DROP INDEX IF EXISTS " + MSG_INDEX_GRPID_THREADID);
+        mDb->execSQL("DROP INDEX IF EXISTS " + MSG_INDEX_GRPID_PARENTID);
+        mDb->execSQL("DROP INDEX IF EXISTS " + MSG_INDEX_GRPID_RECVTS);
         mDb->execSQL("DROP TABLE " + DATABASE_RELEASE_TABLE_NAME);
         mDb->execSQL("DROP TABLE " + MSG_TABLE_NAME);
         mDb->execSQL("DROP TABLE " + GRP_TABLE_NAME);
@@ -1513,6 +1731,7 @@ int RsDataService::updateGroupMetaData(const GrpLocMetaData& meta)
 #endif
 
     RsStackMutex stack(mDbMutex);
+    mLastWriteTS = time(NULL);
     const RsGxsGroupId& grpId = meta.grpId;
 
 #ifdef RS_DATA_SERVICE_DEBUG_CACHE
@@ -1552,6 +1771,7 @@ int RsDataService::updateMessageMetaData(const MsgLocMetaData& metaData)
 #endif
 
     RsStackMutex stack(mDbMutex);
+    mLastWriteTS = time(NULL);
     const RsGxsGroupId& grpId = metaData.msgId.first;
     const RsGxsMessageId& msgId = metaData.msgId.second;
 
@@ -1571,7 +1791,7 @@ int RsDataService::updateMessageMetaData(const MsgLocMetaData& metaData)
             mUseCache=true;
 
             if(meta)
-                mMsgMetaDataCache[grpId].updateMeta(msgId,meta);
+                locked_msgMetaCache(grpId).updateMeta(msgId,meta);
 
             delete c;
         }
@@ -1692,10 +1912,50 @@ int RsDataService::retrieveMsgIds(const RsGxsGroupId& grpId, RsGxsMessageId::std
 
 }
 
+int RsDataService::retrieveMsgReferences(const RsGxsGroupId& grpId, std::set<RsGxsMessageId>& parentIds,
+                                         std::set<RsGxsMessageId>& replacedIds)
+{
+    RS_STACK_MUTEX(mDbMutex);
+
+    // Only reads id columns, so this is much lighter than retrieving the meta data of the whole group.
+    std::list<std::string> columns;
+    columns.push_back(KEY_MSG_ID);
+    columns.push_back(KEY_MSG_PARENT_ID);
+    columns.push_back(KEY_ORIG_MSG_ID);
+
+    RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, columns, KEY_GRP_ID+ "='" + grpId.toStdString() + "'", "");
+
+    if(!c)
+        return 0;
+
+    std::string msgId, parentId, origMsgId;
+
+    for(bool valid = c->moveToFirst(); valid; valid = c->moveToNext())
+    {
+        c->getString(0, msgId);
+        c->getString(1, parentId);
+        c->getString(2, origMsgId);
+
+        RsGxsMessageId parent(parentId);
+        RsGxsMessageId orig(origMsgId);
+
+        if(!parent.isNull())
+            parentIds.insert(parent);
+
+        // in some situations, mOrigMsgId is initialized, but equal to the msgId itself
+        if(!orig.isNull() && orig != RsGxsMessageId(msgId))
+            replacedIds.insert(orig);
+    }
+    delete c;
+
+    return 1;
+}
+
 bool RsDataService::locked_removeMessageEntries(const GxsMsgReq& msgIds)
 {
     // start a transaction
     bool ret = mDb->beginTransaction();
+    mLastWriteTS = time(NULL);
 
     GxsMsgReq::const_iterator mit = msgIds.begin();
 
@@ -1722,6 +1982,7 @@ bool RsDataService::locked_removeGroupEntries(const std::vector<RsGxsGroupId>& g
 {
     // start a transaction
     bool ret = mDb->beginTransaction();
+    mLastWriteTS = time(NULL);
 
     for(auto grpId:grpIds)
     {
@@ -1735,13 +1996,80 @@ bool RsDataService::locked_removeGroupEntries(const std::vector<RsGxsGroupId>& g
     return ret;
 }
 
+void RsDataService::performMaintenance()
+{
+    RS_STACK_MUTEX(mDbMutex);
+
+    rstime_t now = time(NULL);
+
+    if(mLastWriteTS + mMaintenanceIdleDelay > now)
+    {
+        // Busy: only move committed pages from the log into the database, without blocking readers nor writers.
+        if(mWalEnabled)
+            mDb->walCheckpoint(false);
+
+        return;
+    }
+
+    // Release free pages left by deleted messages, a few at a time so as to never hold the lock for long.
+    // Does nothing on databases whose conversion to incremental vacuum failed.
+    for(uint32_t i=0; i<DB_INCREMENTAL_VACUUM_STEPS && mDb->pragmaValue("freelist_count") > 0; ++i)
+    {
+        if(!mDb->incrementalVacuum(DB_INCREMENTAL_VACUUM_PAGES))
+            break;
+
+        mLastVacuumTS = now;
+    }
+
+    if(mLastAnalyzeTS + DB_ANALYZE_PERIOD < now)
+    {
+        // analysis_limit keeps ANALYZE cheap on large tables. Ignored by older sqlite versions.
+        mDb->execPragma("analysis_limit=1000");
+        mDb->execSQL("ANALYZE;");
+        mLastAnalyzeTS = now;
+    }
+
+    if(mWalEnabled)
+        mDb->walCheckpoint(true);
+}
+
+void RsDataService::setMaintenanceIdleDelay(uint32_t delay)
+{
+    RS_STACK_MUTEX(mDbMutex);
+    mMaintenanceIdleDelay = delay;
+}
+
+bool RsDataService::getStorageStatistics(RsGxsStorageStatistics& stats)
+{
+    RS_STACK_MUTEX(mDbMutex);
+
+    int64_t pageSize = mDb->pragmaValue("page_size");
+    int64_t pageCount = mDb->pragmaValue("page_count");
+    int64_t freePages = mDb->pragmaValue("freelist_count");
+
+    if(pageSize < 0 || pageCount < 0 || freePages < 0)
+        return false;
+
+    stats.mDbSize = pageSize * pageCount;
+    stats.mFreeSize = pageSize * freePages;
+    stats.mLastVacuumTS = mLastVacuumTS;
+    stats.mLastAnalyzeTS = mLastAnalyzeTS;
+
+    return true;
+}
+
 uint32_t RsDataService::cacheSize() const {
-    return 0;
+    return mMsgMetaCacheBudget;
 }
 
-int RsDataService::setCacheSize(uint32_t /* size */)
+int RsDataService::setCacheSize(uint32_t size)
 {
-    return 0;
+    RS_STACK_MUTEX(mDbMutex);
+
+    mMsgMetaCacheBudget = size;
+    locked_enforceMsgMetaCacheBudget();
+
+    return 1;
 }
 
 void RsDataService::debug_printCacheSize()
@@ -39,22 +39,22 @@ template<class ID, class MetaDataClass> class t_MetaDataCache
 {
 public:
     t_MetaDataCache()
-        : mCache_ContainsAllMetas(false)
+        : mCache_ContainsAllMetas(false), mTotalSize(0), mLastAccess(0)
     {}
     virtual ~t_MetaDataCache() = default;
 
     bool isCacheUpToDate() const { return mCache_ContainsAllMetas ; }
     void setCacheUpToDate(bool b) { mCache_ContainsAllMetas = b; }
 
-    void getFullMetaList(std::map<ID,std::shared_ptr<MetaDataClass> >& mp) const { mp = mMetas ; }
-    void getFullMetaList(std::vector<std::shared_ptr<MetaDataClass> >& mp) const { for(auto& m:mMetas) mp.push_back(m.second) ; }
+    void getFullMetaList(std::map<ID,std::shared_ptr<MetaDataClass> >& mp) const { mp.clear(); for(auto& m:mMetas) mp[m.first] = m.second.meta ; }
+    void getFullMetaList(std::vector<std::shared_ptr<MetaDataClass> >& mp) const { for(auto& m:mMetas) mp.push_back(m.second.meta) ; }
 
     std::shared_ptr<MetaDataClass> getMeta(const ID& id)
     {
 		auto itt = mMetas.find(id);
 
 		if(itt != mMetas.end())
-			return itt->second ;
+			return itt->second.meta ;
         else
             return nullptr;
     }
@@ -68,27 +68,60 @@ public:
 #ifdef RS_DATA_SERVICE_DEBUG
 			RsDbg() << __PRETTY_FUNCTION__ << ": getting group meta " << grpId << " from cache." << std::endl;
 #endif
-            return it->second ;
+            return it->second.meta ;
 		}
 		else
 		{
 #ifdef RS_DATA_SERVICE_DEBUG
 			RsDbg() << __PRETTY_FUNCTION__ << ": group meta " << grpId << " not in cache. Loading it from DB..." << std::endl;
 #endif
-            return (mMetas[id] = std::make_shared<MetaDataClass>());
+            // The size of the entry is accounted by updateMetaSize() once the meta is filled by the caller.
+            return (mMetas[id].meta = std::make_shared<MetaDataClass>());
         }
     }
 
     void updateMeta(const ID& id,const MetaDataClass& meta)
     {
-        mMetas[id] = std::make_shared<MetaDataClass>(meta);     // create a new shared_ptr to possibly replace the previous one
+        updateMeta(id,std::make_shared<MetaDataClass>(meta));     // create a new shared_ptr to possibly replace the previous one
     }
 
     void updateMeta(const ID& id,const std::shared_ptr<MetaDataClass>& meta)
 	{
-        mMetas[id] = meta;     // create a new shared_ptr to possibly replace the previous one
+        CacheEntry& e(mMetas[id]);
+
+        mTotalSize -= e.size;
+        e.meta = meta;     // create a new shared_ptr to possibly replace the previous one
+        e.size = meta->serial_size();
+        mTotalSize += e.size;
 	}
 
+    /*!
+     * Re-computes the memory accounted for the given entry. To be called after
+     * a meta returned by getOrCreateMeta() has been filled.
+     */
+    void updateMetaSize(const ID& id)
+    {
+        auto it = mMetas.find(id) ;
+
+        if(it == mMetas.end())
+            return;
+
+        mTotalSize -= it->second.size;
+        it->second.size = it->second.meta->serial_size();
+        mTotalSize += it->second.size;
+    }
+
+    /*!
+     * Approximate memory used by the cached metas, in bytes.
+     */
+    uint64_t totalSize() const { return mTotalSize; }
+
+    /*!
+     * Access stamp used to evict the least recently used caches first.
+     */
+    uint64_t lastAccess() const { return mLastAccess; }
+    void setLastAccess(uint64_t a) { mLastAccess = a; }
+
     void clear(const ID& id)
 	{
 		auto it = mMetas.find(id) ;
@@ -104,6 +137,7 @@ public:
 			std::cerr << "(II) moving database cache entry " << (void*)(*it).second << " to dead list." << std::endl;
 #endif
 
+			mTotalSize -= it->second.size;
 			mMetas.erase(it) ;
 
             // No need to modify  mCache_ContainsAllMetas since, assuming that the cache always contains
@@ -117,14 +151,24 @@ public:
         nb_items = mMetas.size();
         total_size = 0;
 
-        for(auto it:mMetas) total_size += it.second->serial_size();
+        for(auto& it:mMetas) total_size += it.second.meta->serial_size();
     }
 private:
-    std::map<ID,std::shared_ptr<MetaDataClass> > mMetas;
+    struct CacheEntry
+    {
+        CacheEntry() : size(0) {}
+
+        std::shared_ptr<MetaDataClass> meta;
+        uint32_t size;
+    };
+
+    std::map<ID,CacheEntry> mMetas;
 
 	static const uint32_t CACHE_ENTRY_GRACE_PERIOD = 600 ; // Unused items are deleted 10 minutes after last usage.
 
     bool mCache_ContainsAllMetas ;
+    uint64_t mTotalSize;
+    uint64_t mLastAccess;
 };
 
 class RsDataService : public RsGeneralDataService
@@ -168,6 +212,19 @@ public:
      */
     int retrieveGxsMsgMetaData(const GxsMsgReq& reqIds, GxsMsgMetaResult& msgMeta) override;
 
+    /*!
+     * Retrieves one page of the message metas of a group matching the filter.
+     * Predicates are turned into an SQL selection on indexed columns and pages
+     * are delimited by the rowid of the last returned message.
+     * @param filter predicates the returned messages must match
+     * @param cursor in: 0 or value returned by the previous call, out: 0 when there is nothing left
+     * @param pageSize maximum number of metas to return, 0 means no limit
+     * @param msgMeta matching metas are appended here
+     * @return error code
+     */
+    int retrieveGxsMsgMetaDataPage(const RsGxsMsgMetaFilter& filter, uint64_t& cursor, uint32_t pageSize,
+                                   std::vector<std::shared_ptr<RsGxsMsgMetaData> >& msgMeta) override;
+
     /*!
      * remove msgs in data store
      * @param grpId group Id of message to be removed
@@ -199,7 +256,17 @@ public:
     int retrieveMsgIds(const RsGxsGroupId& grpId, RsGxsMessageId::std_set& msgId) override;
 
     /*!
-     * @return the cache size set for this RsGeneralDataService in bytes
+     * Retrieves the parent and original message ids referenced in a group
+     * @param grpId group of the messages
+     * @param parentIds ids of the messages that have at least one child
+     * @param replacedIds ids of the messages that have a newer version
+     * @return error code
+     */
+    int retrieveMsgReferences(const RsGxsGroupId& grpId, std::set<RsGxsMessageId>& parentIds,
+                              std::set<RsGxsMessageId>& replacedIds) override;
+
+    /*!
+     * @return the maximum amount of memory used by the message meta data cache, in bytes
      */
     uint32_t cacheSize() const override;
 
@@ -211,6 +278,8 @@ public:
     virtual uint16_t serviceType() const override { return mServType; }
 
     /*!
+     * Sets the memory budget of the message meta data cache. When the budget
+     * is exceeded, the caches of the least recently accessed groups are dropped.
      * @param size size of cache to set in bytes
      */
     int setCacheSize(uint32_t size) override;
@@ -256,6 +325,20 @@ public:
      */
     int resetDataStore() override;
 
+    /*!
+     * Checkpoints the write ahead log and, when no write happened recently,
+     * reclaims free pages and refreshes the query planner statistics
+     */
+    void performMaintenance() override;
+
+    /*!
+     * @param delay seconds without any write before performMaintenance() does
+     * the heavy work. Defaults to one minute, mostly changed by tests
+     */
+    void setMaintenanceIdleDelay(uint32_t delay);
+
+    bool getStorageStatistics(RsGxsStorageStatistics& stats) override;
+
     bool validSize(RsNxsMsg* msg) const override;
     bool validSize(RsNxsGrp* grp) const override;
 
@@ -293,6 +376,17 @@ private:
      */
     void locked_retrieveMsgMetaList(RetroCursor* c, std::vector<std::shared_ptr<RsGxsMsgMetaData> > &msgMeta);
 
+    /*!
+     * Returns the message meta cache of a group, marking it as the most recently used one.
+     */
+    t_MetaDataCache<RsGxsMessageId,RsGxsMsgMetaData>& locked_msgMetaCache(const RsGxsGroupId& grpId);
+
+    /*!
+     * Drops the message meta caches of the least recently used groups until the
+     * cache fits in mMsgMetaCacheBudget.
+     */
+    void locked_enforceMsgMetaCacheBudget();
+
     /*!
      * Retrieves all the grp meta results from a cursor
      * @param c cursor to result set
@@ -354,6 +448,12 @@ private:
      */
     bool finishReleaseUpdate(int release, bool result);
 
+    /*!
+     * Sets journal mode, page cache and vacuum mode of the database
+     * @param isNewDatabase auto_vacuum can only be set before tables are created
+     */
+    void locked_configureDatabase(bool isNewDatabase);
+
 private:
 
     RsMutex mDbMutex;
@@ -362,6 +462,7 @@ private:
     std::list<std::string> mMsgMetaColumns;
     std::list<std::string> mMsgColumnsWithMeta;
     std::list<std::string> mMsgIdColumn;
+    std::list<std::string> mMsgMetaColumnsWithRowId;
 
     std::list<std::string> mGrpColumns;
     std::list<std::string> mGrpMetaColumns;
@@ -385,6 +486,7 @@ private:
     int mColMsgMeta_NxsServString;
     int mColMsgMeta_RecvTs;
     int mColMsgMeta_NxsDataLen;
+    int mColMsgMeta_RowId;
 
     // Message columns
     int mColMsg_GrpId;
@@ -453,6 +555,15 @@ private:
     t_MetaDataCache<RsGxsGroupId,RsGxsGrpMetaData> mGrpMetaDataCache;
     std::map<RsGxsGroupId,t_MetaDataCache<RsGxsMessageId,RsGxsMsgMetaData> > mMsgMetaDataCache;
 
+    uint32_t mMsgMetaCacheBudget;	// in bytes
+    uint64_t mMsgMetaCacheAccessCounter;
+
+    bool mWalEnabled;
+    uint32_t mMaintenanceIdleDelay;
+    rstime_t mLastWriteTS;
+    rstime_t mLastVacuumTS;
+    rstime_t mLastAnalyzeTS;
+
     bool mUseCache;
 };
 
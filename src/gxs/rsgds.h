@@ -86,6 +86,43 @@ struct RsGroupNetworkStats
 	rstime_t   mLastGroupModificationTS;
 };
 
+/*!
+ * Predicates used to retrieve message meta data of a group page by page.
+ * Null ids and zero timestamps mean that the corresponding field is not
+ * constrained. The predicates are evaluated by the storage backend, so that
+ * messages that do not match are never loaded in memory.
+ */
+struct RsGxsMsgMetaFilter
+{
+	RsGxsMsgMetaFilter() :
+	    mMinPublishTs(0), mMaxPublishTs(0), mMinRecvTs(0), mMaxRecvTs(0) {}
+
+	RsGxsGroupId   mGrpId;
+	RsGxsMessageId mThreadId;
+	RsGxsMessageId mParentId;
+	RsGxsMessageId mOrigMsgId;
+
+	rstime_t mMinPublishTs;
+	rstime_t mMaxPublishTs;
+	rstime_t mMinRecvTs;
+	rstime_t mMaxRecvTs;
+};
+
+/*!
+ * Storage level statistics of a data service, used to monitor database growth
+ * and fragmentation.
+ */
+struct RsGxsStorageStatistics
+{
+	RsGxsStorageStatistics() :
+	    mDbSize(0), mFreeSize(0), mLastVacuumTS(0), mLastAnalyzeTS(0) {}
+
+	uint64_t mDbSize;       // size of the database, in bytes
+	uint64_t mFreeSize;     // size of the unused pages of the database, in bytes
+	rstime_t mLastVacuumTS;
+	rstime_t mLastAnalyzeTS;
+};
+
 typedef std::map<RsGxsGroupId,      std::vector<RsNxsMsg*> > NxsMsgDataResult;
 typedef std::map<RsGxsGrpMsgIdPair, std::vector<RsNxsMsg*> > NxsMsgRelatedDataResult;
 typedef std::map<RsGxsGroupId,      std::vector<RsNxsMsg*> > GxsMsgResult; // <grpId, msgs>
@@ -175,6 +212,20 @@ public:
      */
     virtual int retrieveGxsMsgMetaData(const GxsMsgReq& msgIds, GxsMsgMetaResult& msgMeta) = 0;
 
+    /*!
+     * Retrieves one page of the meta data of the messages of a group matching
+     * the given filter. Call repeatedly until cursor is set back to 0 to get
+     * all the matching metas.
+     * @param filter predicates the returned messages must match, mGrpId is mandatory
+     * @param cursor in: 0 for the first page, otherwise the value returned by the previous call \n
+     *               out: position of the next page, 0 when there is nothing left
+     * @param pageSize maximum number of metas to return, 0 means no limit
+     * @param msgMeta matching metas are appended to this vector
+     * @return error code
+     */
+    virtual int retrieveGxsMsgMetaDataPage(const RsGxsMsgMetaFilter& filter, uint64_t& cursor, uint32_t pageSize,
+                                           std::vector<std::shared_ptr<RsGxsMsgMetaData> >& msgMeta) = 0;
+
     /*!
      * remove msgs in data store listed in msgIds param
      * @param msgIds ids of messages to be removed
@@ -204,6 +255,17 @@ public:
      */
     virtual int retrieveMsgIds(const RsGxsGroupId& grpId, RsGxsMessageId::std_set& msgId) = 0;
 
+    /*!
+     * Retrieves the ids of the messages of a group that are referenced by other
+     * messages, without loading their meta data
+     * @param grpId group of the messages
+     * @param parentIds ids of the messages that have at least one child
+     * @param replacedIds ids of the messages that have a newer version
+     * @return error code
+     */
+    virtual int retrieveMsgReferences(const RsGxsGroupId& grpId, std::set<RsGxsMessageId>& parentIds,
+                                      std::set<RsGxsMessageId>& replacedIds) = 0;
+
     /*!
      * @return the cache size set for this RsGeneralDataService in bytes
      */
@@ -262,6 +324,19 @@ public:
      */
     virtual int resetDataStore() = 0;
 
+    /*!
+     * Performs a bounded amount of storage maintenance (space reclaiming,
+     * statistics update, log checkpoints). Expected to be called periodically;
+     * heavy work is only done when the store has not been written recently.
+     */
+    virtual void performMaintenance() = 0;
+
+    /*!
+     * @param stats storage statistics of the data store
+     * @return false if the statistics cannot be computed
+     */
+    virtual bool getStorageStatistics(RsGxsStorageStatistics& stats) = 0;
+
     /*!
      * Use to determine if message isn't over the storage
      * limit for a single message item
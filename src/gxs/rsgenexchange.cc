@@ -66,6 +66,7 @@ static const uint32_t INDEX_AUTHEN_ADMIN        = 0x00000040; // admin key
 
 static const uint32_t MSG_CLEANUP_PERIOD     = 60*59; // 59 minutes
 static const uint32_t INTEGRITY_CHECK_PERIOD = 60*31; // 31 minutes
+static const uint32_t DB_MAINTENANCE_PERIOD  = 60*5;  //  5 minutes
 
 #define GXS_MASK "GXS_MASK_HACK"
 
@@ -181,6 +182,7 @@ RsGenExchange::RsGenExchange(
     mSerialiser(serviceSerialiser),
   mServType(servType),
   mGixs(gixs),
+  mChangesMtx("GenExchangeChanges"),
   mAuthenPolicy(authenPolicy),
   mCleaning(false),
   mLastClean((int)time(NULL) - (int)(RSRandom::random_u32() % MSG_CLEANUP_PERIOD)),	// this helps unsynchronising the checks for the different services
@@ -188,6 +190,7 @@ RsGenExchange::RsGenExchange(
   mCheckStarted(false),
   mLastCheck((int)time(NULL) - (int)(RSRandom::random_u32() % INTEGRITY_CHECK_PERIOD) + 120),	// this helps unsynchronising the checks for the different services, with 2 min security to avoid checking right away before statistics come up.
   mIntegrityCheck(NULL),
+  mLastDbMaintenance((int)time(NULL) - (int)(RSRandom::random_u32() % DB_MAINTENANCE_PERIOD)),
   SIGN_MAX_WAITING_TIME(60),
   SIGN_FAIL(0),
   SIGN_SUCCESS(1),
@@ -198,6 +201,7 @@ RsGenExchange::RsGenExchange(
   VALIDATE_MAX_WAITING_TIME(60)
 {
     mDataAccess = new RsGxsDataAccess(gds);
+    mChangesBatcher.reset(new RsGxsChangesBatcher(static_cast<RsServiceType>(servType), mDataAccess));
 }
 
 void RsGenExchange::setNetworkExchangeService(RsNetworkExchangeService *ns)
@@ -283,9 +287,22 @@ void RsGenExchange::tick()
         // and the array itself.  This is pretty bad and we should normally delete the changes here.
 
 		if(!mNotifications_copy.empty())
+		{
+			{
+				RS_STACK_MUTEX(mChangesMtx);
+				mChangesBatcher->add(mNotifications_copy);
+			}
 			notifyChanges(mNotifications_copy);
+		}
 	}
 
+	std::shared_ptr<RsGxsChanges> changes;
+	{
+		RS_STACK_MUTEX(mChangesMtx);
+		changes = mChangesBatcher->takeReady();
+	}
+	if(changes && rsEvents) rsEvents->postEvent(changes);
+
 	// implemented service tick function
 	service_tick();
 
@@ -319,13 +336,21 @@ void RsGenExchange::tick()
 	{
 		mLastCheck = time(NULL);
 
+		// The resume position is saved with the net service config, so that restarts don't hash everything again.
+		RsGxsGrpMsgIdPair savedPosition;
+		bool hasSavedPosition = !mIntegrityCheck && mNetService && mNetService->getIntegrityCheckPosition(savedPosition);
+
 		{
 			RS_STACK_MUTEX(mGenMtx) ;
 
+			if(hasSavedPosition)
+				mNextIntegrityCheckPosition = savedPosition;
+
 			if(!mIntegrityCheck)
 			{
 				mIntegrityCheck = new RsGxsIntegrityCheck( mDataStore, this,
-				                                           *mSerialiser, mGixs);
+				                                           *mSerialiser, mGixs,
+				                                           mNextIntegrityCheckPosition );
 				std::stringstream ss;
 				ss << std::hex << mServType;
 				mChecking = mIntegrityCheck->start("gxs int chk "+ss.str());
@@ -336,12 +361,26 @@ void RsGenExchange::tick()
 		{
             std::vector<RsGxsGroupId> grpIds;
             GxsMsgReq msgIds;
+            RsGxsGrpMsgIdPair nextPosition;
 
             {
                 RS_STACK_MUTEX(mGenMtx) ;
                 mIntegrityCheck->getDeletedIds(grpIds, msgIds);
+                nextPosition = mNextIntegrityCheckPosition = mIntegrityCheck->nextPosition();
+
+                RsGxsIntegrityCheckProgress progress;
+                mIntegrityCheck->getProgress(progress);
+
+                RS_INFO( "service ", std::hex, mServType, std::dec, ": checked ",
+                         progress.mGrpsChecked, "/", progress.mGrpsTotal, " groups, ",
+                         progress.mMsgsChecked, " messages, ", progress.mBytesHashed,
+                         " bytes hashed in ", progress.mEndTS - progress.mStartTS, " s. ",
+                         progress.mFullRound ? "Full round done." : "Will resume at next pass." );
             }
 
+            if(mNetService)
+                mNetService->setIntegrityCheckPosition(nextPosition);
+
             if(!msgIds.empty())
             {
                 uint32_t token1=0;
@@ -363,6 +402,13 @@ void RsGenExchange::tick()
             }
 		}
 	}
+
+	// Database maintenance (log checkpoint, space reclaiming). The data store only does the heavy part when it is idle.
+	if(!mChecking && mLastDbMaintenance + DB_MAINTENANCE_PERIOD < now)
+	{
+		mDataStore->performMaintenance();
+		mLastDbMaintenance = now;
+	}
 }
 
 bool RsGenExchange::messagePublicationTest(const RsGxsMsgMetaData& meta)
@@ -1213,6 +1259,25 @@ void RsGenExchange::receiveChanges(std::vector<RsGxsNotify*>& changes)
 }
 #endif
 
+void RsGenExchange::postChangeEvent(std::shared_ptr<RsEvent> event)
+{
+	RsGxsGroupId grpId;
+	RsGxsMessageId msgId;
+	uint8_t code;
+
+	if(summarizeChangeEvent(*event, grpId, msgId, code))
+	{
+		RS_STACK_MUTEX(mChangesMtx);
+		mChangesBatcher->addEvent(grpId, msgId, code);
+	}
+
+	if(rsEvents) rsEvents->postEvent(event);
+}
+
+bool RsGenExchange::summarizeChangeEvent(
+        const RsEvent&, RsGxsGroupId&, RsGxsMessageId&, uint8_t& ) const
+{ return false; }
+
 bool RsGenExchange::subscribeToGroup(uint32_t& token, const RsGxsGroupId& grpId, bool subscribe)
 {
     if(subscribe)
@@ -1742,9 +1807,10 @@ void RsGenExchange::receiveNewMessages(const std::vector<RsNxsMsg *>& messages)
 	}
 }
 
-void RsGenExchange::receiveDistantSearchResults(TurtleRequestId id,const RsGxsGroupId &/*grpId*/)
+void RsGenExchange::receiveDistantSearchResults(TurtleRequestId id,const RsGxsGroupId &grpId)
 {
-	std::cerr << __PRETTY_FUNCTION__ << " received result for request " << std::hex << id << std::dec << ": this method should be overloaded in the client service, but it is not. This is a bug!" << std::endl;
+	RS_STACK_MUTEX(mGenMtx);
+	mNotifications.push_back(new RsGxsDistantSearchResultChange(id, grpId));
 }
 
 void RsGenExchange::notifyReceivePublishKey(const RsGxsGroupId &grpId)
@@ -1955,6 +2021,17 @@ bool     RsGenExchange::getGroupNetworkStats(const RsGxsGroupId& grpId,RsGroupNe
 	return (!mNetService) || mNetService->getGroupNetworkStats(grpId,stats) ;
 }
 
+bool RsGenExchange::getNetworkStatistics(RsGxsNetStatistics& stats)
+{
+	return mNetService && mNetService->getNetworkStatistics(stats);
+}
+
+void RsGenExchange::setNetworkStatisticsEnabled(bool enabled)
+{
+	if(mNetService)
+		mNetService->setNetworkStatisticsEnabled(enabled);
+}
+
 void     RsGenExchange::setSyncPeriod(const RsGxsGroupId& grpId,uint32_t age_in_secs)
 {
 	if(mNetService != NULL)
@@ -3734,7 +3811,7 @@ bool RsGenExchange::importGroupBase64(
 
 RsGxsChanges::RsGxsChanges() :
     RsEvent(RsEventType::GXS_CHANGES), mServiceType(RsServiceType::NONE),
-    mService(nullptr) {}
+    mNotificationsCount(0), mService(nullptr) {}
 
 RsGxsIface::~RsGxsIface() = default;
 RsGxsGroupSummary::~RsGxsGroupSummary() = default;
@@ -23,6 +23,7 @@
 #define RSGENEXCHANGE_H
 
 #include <queue>
+#include <memory>
 #include "util/rstime.h"
 
 #include "rsgxs.h"
@@ -34,6 +35,7 @@
 #include "retroshare/rsgxsservice.h"
 #include "rsitems/rsnxsitems.h"
 #include "gxs/rsgxsnotify.h"
+#include "gxs/rsgxschangesbatcher.h"
 #include "rsgxsutil.h"
 
 template<class GxsItem, typename Identity = std::string>
@@ -763,6 +765,9 @@ public:
     virtual void     setSyncPeriod(const RsGxsGroupId& grpId,uint32_t age_in_secs) override;
     virtual bool     getGroupNetworkStats(const RsGxsGroupId& grpId,RsGroupNetworkStats& stats);
 
+    bool getNetworkStatistics(RsGxsNetStatistics& stats) override;
+    void setNetworkStatisticsEnabled(bool enabled) override;
+
     uint16_t serviceType() const override { return mServType ; }
     uint32_t serviceFullType() const { return RsServiceInfo::RsServiceInfoUIn16ToFullServiceId(mServType); }
 
@@ -785,6 +790,22 @@ protected:
      */
     virtual void notifyChanges(std::vector<RsGxsNotify*>& changes) = 0;
 
+    /*!
+     * Post a fine grained event from notifyChanges(), its code is also
+     * accounted in the next RsGxsChanges summary
+     */
+    void postChangeEvent(std::shared_ptr<RsEvent> event);
+
+    /*!
+     * Tell which group and message a fine grained event of the service is
+     * about, and its service specific code, for the RsGxsChanges summaries
+     * @param[out] msgId null for group events
+     * @return false if the event is not known by the service
+     */
+    virtual bool summarizeChangeEvent(
+            const RsEvent& event, RsGxsGroupId& grpId, RsGxsMessageId& msgId,
+            uint8_t& code ) const;
+
 private:
 
     void processRecvdData();
@@ -973,6 +994,10 @@ private:
 
     std::vector<RsGxsNotify*> mNotifications;
 
+    /// Folds notifications and event codes into RsGxsChanges events
+    std::unique_ptr<RsGxsChangesBatcher> mChangesBatcher;
+    RsMutex mChangesMtx; /// Protects mChangesBatcher
+
 
 
     /// authentication policy
@@ -990,6 +1015,9 @@ private:
     rstime_t mLastCheck;
     RsGxsIntegrityCheck* mIntegrityCheck;
     RsGxsGroupId mNextGroupToCheck ;
+    RsGxsGrpMsgIdPair mNextIntegrityCheckPosition;	// where the next integrity check resumes hashing
+
+    rstime_t mLastDbMaintenance;
 
 protected:
 	enum CreateStatus { CREATE_FAIL, CREATE_SUCCESS, CREATE_FAIL_TRY_LATER };
@@ -0,0 +1,115 @@
+/*******************************************************************************
+ * libretroshare/src/gxs: rsgxschangesbatcher.cc                               *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <algorithm>
+
+#include "gxs/rsgxschangesbatcher.h"
+#include "util/rsdebug.h"
+
+/*static*/ constexpr uint32_t RsGxsChangesBatcher::MAX_NOTIFICATIONS;
+/*static*/ constexpr uint32_t RsGxsChangesBatcher::WINDOW_MS;
+
+RsGxsChangesBatcher::RsGxsChangesBatcher(
+        RsServiceType serviceType, RsTokenService* service,
+        uint32_t maxNotifications, std::chrono::milliseconds window ) :
+    mServiceType(serviceType), mService(service),
+    mMaxNotifications(maxNotifications), mWindow(window) {}
+
+void RsGxsChangesBatcher::add(
+        const std::vector<RsGxsNotify*>& changes, Clock::time_point now )
+{
+	if(changes.empty()) return;
+
+	RsGxsChanges& out(summary(now));
+	for(RsGxsNotify* n: changes) merge(out, n);
+}
+
+void RsGxsChangesBatcher::addEvent(
+        const RsGxsGroupId& grpId, const RsGxsMessageId& msgId, uint8_t code,
+        Clock::time_point now )
+{ summary(now).mEventCodes[grpId][msgId].insert(code); }
+
+RsGxsChanges& RsGxsChangesBatcher::summary(Clock::time_point now)
+{
+	if(!mSummary)
+	{
+		mSummary = std::make_shared<RsGxsChanges>();
+		mSummary->mServiceType = mServiceType;
+		mSummary->mService = mService;
+		mSummaryStart = now;
+	}
+	return *mSummary;
+}
+
+std::shared_ptr<RsGxsChanges> RsGxsChangesBatcher::takeReady(
+        bool force, Clock::time_point now )
+{
+	if( !mSummary || !( force || now - mSummaryStart >= mWindow ||
+	                    mSummary->mNotificationsCount >= mMaxNotifications ) )
+		return nullptr;
+
+	std::shared_ptr<RsGxsChanges> ready;
+	ready.swap(mSummary);
+	return ready;
+}
+
+void RsGxsChangesBatcher::merge(RsGxsChanges& out, RsGxsNotify* n)
+{
+	++out.mNotificationsCount;
+
+	if(auto mc = dynamic_cast<RsGxsMsgChange*>(n))
+	{
+		if(mc->metaChange()) out.mMsgsMeta[mc->mGroupId].insert(mc->mMsgId);
+		else out.mMsgs[mc->mGroupId].insert(mc->mMsgId);
+	}
+	else if(auto md = dynamic_cast<RsGxsMsgDeletedChange*>(n))
+		out.mMsgsDeleted[md->mGroupId].insert(md->messageId);
+	else if(auto ds = dynamic_cast<RsGxsDistantSearchResultChange*>(n))
+	{
+		if( std::find( out.mDistantSearchReqs.begin(),
+		               out.mDistantSearchReqs.end(), ds->mRequestId ) ==
+		        out.mDistantSearchReqs.end() )
+			out.mDistantSearchReqs.push_back(ds->mRequestId);
+	}
+	else if(auto gc = dynamic_cast<RsGxsGroupChange*>(n))
+		switch(gc->getType())
+		{
+		case RsGxsNotify::TYPE_GROUP_DELETED:
+			out.mGrpsDeleted.insert(gc->mGroupId);
+			break;
+		case RsGxsNotify::TYPE_GROUP_AUTH_REJECTED:
+			out.mGrpsAuthRejected.insert(gc->mGroupId);
+			break;
+		case RsGxsNotify::TYPE_RECEIVED_PUBLISHKEY:         // [[fallthrough]]
+		case RsGxsNotify::TYPE_STATISTICS_CHANGED:          // [[fallthrough]]
+		case RsGxsNotify::TYPE_GROUP_SYNC_PARAMETERS_UPDATED:
+			out.mGrpsMeta.insert(gc->mGroupId);
+			break;
+		default:
+			if(gc->metaChange()) out.mGrpsMeta.insert(gc->mGroupId);
+			else out.mGrps.insert(gc->mGroupId);
+			break;
+		}
+	else
+		RsErr() << __PRETTY_FUNCTION__ << " Unknown change type: "
+		        << n->getType() << std::endl;
+}
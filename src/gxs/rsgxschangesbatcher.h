@@ -0,0 +1,87 @@
+/*******************************************************************************
+ * libretroshare/src/gxs: rsgxschangesbatcher.h                                *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "rsitems/rsgxsitems.h"
+#include "gxs/rsgxsnotify.h"
+#include "retroshare/rsgxsiface.h"
+
+/*!
+ * Folds the notifications of a GXS service, and the codes of the fine grained
+ * events the service posted for them, into RsGxsChanges summaries. A summary
+ * is ready once its time window is over or it covers maxNotifications
+ * notifications. The fine grained events are posted anyway, summaries come in
+ * addition to them. Not thread safe.
+ */
+class RsGxsChangesBatcher
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	RsGxsChangesBatcher(
+	        RsServiceType serviceType, RsTokenService* service,
+	        uint32_t maxNotifications = MAX_NOTIFICATIONS,
+	        std::chrono::milliseconds window =
+	                std::chrono::milliseconds(WINDOW_MS) );
+
+	/// Fold the notifications about to be handed to the service
+	void add( const std::vector<RsGxsNotify*>& changes,
+	          Clock::time_point now = Clock::now() );
+
+	/*!
+	 * Account a fine grained event posted by the service
+	 * @param[in] msgId null for group events
+	 * @param[in] code service specific event code, e.g. RsForumEventCode
+	 */
+	void addEvent( const RsGxsGroupId& grpId, const RsGxsMessageId& msgId,
+	               uint8_t code, Clock::time_point now = Clock::now() );
+
+	/*!
+	 * @param[in] force return the summary even if its window is not over
+	 * @return the summary if it is ready to be posted, null otherwise
+	 */
+	std::shared_ptr<RsGxsChanges> takeReady(
+	        bool force = false, Clock::time_point now = Clock::now() );
+
+	/// Notifications after which the summary is ready anyway
+	static constexpr uint32_t MAX_NOTIFICATIONS = 5000;
+
+	/// Time span summarized in one RsGxsChanges event
+	static constexpr uint32_t WINDOW_MS = 500;
+
+private:
+	RsGxsChanges& summary(Clock::time_point now);
+	void merge(RsGxsChanges& out, RsGxsNotify* n);
+
+	const RsServiceType mServiceType;
+	RsTokenService* const mService;
+	const uint32_t mMaxNotifications;
+	const std::chrono::milliseconds mWindow;
+
+	std::shared_ptr<RsGxsChanges> mSummary;
+	Clock::time_point mSummaryStart;
+};
@@ -30,6 +30,8 @@
  * #define DATA_DEBUG	1
  **********/
 
+static const uint32_t MSG_RELATED_META_PAGE_SIZE = 1000; // number of msg metas loaded at once from the DB for msg related requests
+
 // Debug system to allow to print only for some services (group, Peer, etc)
 
 #if defined(DATA_DEBUG)
@@ -1333,27 +1335,22 @@ bool RsGxsDataAccess::getMsgRelatedInfo(MsgRelatedInfoReq *req)
 
         const RsGxsGrpMsgIdPair& grpMsgIdPair = *vit_msgIds;
 
-        // get meta data for all in group
-        GxsMsgMetaResult result;
-        GxsMsgReq msgIds;
-        msgIds.insert(std::make_pair(grpMsgIdPair.first, std::set<RsGxsMessageId>()));
-        mDataStore->retrieveGxsMsgMetaData(msgIds, result);
-        auto& metaV = result[grpMsgIdPair.first];
-
         // msg id to relate to
         const RsGxsMessageId& msgId = grpMsgIdPair.second;
         const RsGxsGroupId& grpId = grpMsgIdPair.first;
 
         std::set<RsGxsMessageId> outMsgIds;
 
+        // get meta data of the msg to relate to
+        GxsMsgMetaResult origResult;
+        GxsMsgReq origMsgIds;
+        origMsgIds[grpId].insert(msgId);
+        mDataStore->retrieveGxsMsgMetaData(origMsgIds, origResult);
+
         std::shared_ptr<RsGxsMsgMetaData> origMeta;
 
-        for(auto vit_meta = metaV.begin(); vit_meta != metaV.end(); ++vit_meta)
-            if(msgId == (*vit_meta)->mMsgId)
-            {
-                origMeta = *vit_meta;
-                break;
-            }
+        if(!origResult[grpId].empty())
+            origMeta = origResult[grpId].front();
 
 		if(!origMeta)
 		{
@@ -1364,6 +1361,27 @@ bool RsGxsDataAccess::getMsgRelatedInfo(MsgRelatedInfoReq *req)
         const RsGxsMessageId& origMsgId = origMeta->mOrigMsgId;
         auto& metaMap = filterMap[grpId];
 
+        // Only load the metas of related messages. The DB filters them on
+        // indexed columns, the checks below still apply on what is returned.
+
+        RsGxsMsgMetaFilter filter;
+        filter.mGrpId = grpId;
+
+        if(onlyLatestMsgs && onlyChildMsgs)
+            filter.mParentId = origMsgId;
+        else if(onlyLatestMsgs && onlyThreadMsgs)
+            filter.mThreadId = msgId;
+        else
+            filter.mOrigMsgId = origMsgId;
+
+        std::vector<std::shared_ptr<RsGxsMsgMetaData> > metaV;
+        uint64_t cursor = 0;
+
+        do
+            if(!mDataStore->retrieveGxsMsgMetaDataPage(filter, cursor, MSG_RELATED_META_PAGE_SIZE, metaV))
+                break;
+        while(cursor != 0);
+
         if (onlyLatestMsgs)
         {
             if (onlyChildMsgs || onlyThreadMsgs)
@@ -1596,6 +1614,14 @@ bool RsGxsDataAccess::getServiceStatistic(ServiceStatisticRequest *req)
 
     req->mServiceStatistic.mSizeStore = req->mServiceStatistic.mSizeOfGrps + req->mServiceStatistic.mSizeOfMsgs;
 
+    RsGxsStorageStatistics storageStats;
+
+    if(mDataStore->getStorageStatistics(storageStats))
+    {
+        req->mServiceStatistic.mDbSize = storageStats.mDbSize;
+        req->mServiceStatistic.mDbFreeSize = storageStats.mFreeSize;
+    }
+
     return true;
 }
 
@@ -286,6 +286,8 @@
 //#define NXS_NET_DEBUG_8 	1
 //#define NXS_NET_DEBUG_9 	1
 
+// Sends messages larger than FRAGMENT_SIZE in several items. Incoming fragments are always
+// reassembled, so this can be enabled once all peers run a version that does so.
 //#define NXS_FRAG
 
 // The constant below have a direct influence on how fast forums/channels/posted/identity groups propagate and on the overloading of queues:
@@ -309,6 +311,9 @@ static const uint32_t GROUP_STATS_UPDATE_NB_PEERS             =            2; //
 static const uint32_t MAX_ALLOWED_GXS_MESSAGE_SIZE            =       199000; // 200,000 bytes including signature and headers
 static const uint32_t MIN_DELAY_BETWEEN_GROUP_SEARCH          =           40; // dont search same group more than every 40 secs.
 static const uint32_t SAFETY_DELAY_FOR_UNSUCCESSFUL_UPDATE    =            0; // avoid re-sending the same msg list to a peer who asks twice for the same update in less than this time
+static const uint32_t SYNC_MSG_META_PAGE_SIZE                 =         1000; // number of msg metas loaded at once from the DB when answering a msg sync request
+static const uint64_t MAX_FRAGMENT_BYTES_PER_PEER             =  8*1024*1024; // memory held by incomplete fragmented items of one peer, all services included
+static const uint64_t MAX_FRAGMENT_BYTES_TOTAL                = 32*1024*1024; // memory held by incomplete fragmented items of all peers
 
 static const uint32_t RS_NXS_ITEM_ENCRYPTION_STATUS_UNKNOWN             = 0x00 ;
 static const uint32_t RS_NXS_ITEM_ENCRYPTION_STATUS_NO_ERROR            = 0x01 ;
@@ -378,7 +383,7 @@ RsGxsNetService::RsGxsNetService(uint16_t servType, RsGeneralDataService *gds,
                                    mLastCleanRejectedMessages(0), mSYNC_PERIOD(SYNC_PERIOD),
                                    mCircles(circles), mGixs(gixs),
                                    mReputations(reputations), mPgpUtils(pgpUtils), mGxsNetTunnel(mGxsNT),
-                                   mSyncFlags(sync_flags),
+                                   mSyncFlags(sync_flags), mSyncStats(servType),
                                    mServiceInfo(serviceInfo), mDefaultMsgStorePeriod(default_store_period),
                                    mDefaultMsgSyncPeriod(default_sync_period)
 {
@@ -523,6 +528,37 @@ void RsGxsNetService::processObserverNotifications()
         mObserver->notifyChangedGroupSyncParams(*it);
 }
 
+bool RsGxsNetService::getNetworkStatistics(RsGxsNetStatistics& stats)
+{
+    mSyncStats.getStatistics(stats);
+    return true;
+}
+
+void RsGxsNetService::setNetworkStatisticsEnabled(bool enabled)
+{
+    mSyncStats.setEnabled(enabled);
+}
+
+bool RsGxsNetService::getIntegrityCheckPosition(RsGxsGrpMsgIdPair& position)
+{
+    RS_STACK_MUTEX(mNxsMutex) ;
+    position = mIntegrityCheckPosition;
+    return true;
+}
+
+void RsGxsNetService::setIntegrityCheckPosition(const RsGxsGrpMsgIdPair& position)
+{
+    {
+        RS_STACK_MUTEX(mNxsMutex) ;
+
+        if(position == mIntegrityCheckPosition)
+            return;
+
+        mIntegrityCheckPosition = position;
+    }
+    IndicateConfigChanged();
+}
+
 void RsGxsNetService::rejectMessage(const RsGxsMessageId& msg_id)
 {
     RS_STACK_MUTEX(mNxsMutex) ;
@@ -624,6 +660,7 @@ std::error_condition RsGxsNetService::checkUpdatesFromPeers(
 		GXSNETDEBUG_P_(*sit) << "Service "<< std::hex << ((mServiceInfo.mServiceType >> 8)& 0xffff) << std::dec << "  sending global group TS of peer id: " << *sit << " ts=" << nice_time_stamp(time(NULL),updateTS) << " (secs ago) to himself" << std::endl;
 #endif
 		generic_sendItem(grp);
+		mSyncStats.syncReqSent(peerId);
 	}
 
     if(!(mSyncFlags & RsGxsNetServiceSyncFlags::AUTO_SYNC_MESSAGES))
@@ -738,6 +775,7 @@ std::error_condition RsGxsNetService::checkUpdatesFromPeers(
 	    GXSNETDEBUG_PG(*sit,grpId) << "    Service " << std::hex << ((mServiceInfo.mServiceType >> 8)& 0xffff) << std::dec << "  sending message TS of peer id: " << *sit << " ts=" << nice_time_stamp(time(NULL),updateTS) << " (secs ago) for group " << grpId << " to himself - in clear " << std::endl;
 #endif
 		generic_sendItem(msg);
+		mSyncStats.syncReqSent(peerId);
 
 #ifdef NXS_NET_DEBUG_5
 		GXSNETDEBUG_PG(*sit,grpId) << "Service "<< std::hex << ((mServiceInfo.mServiceType >> 8)& 0xffff) << std::dec << "  sending global message TS of peer id: " << *sit << " ts=" << nice_time_stamp(time(NULL),updateTS) << " (secs ago) for group " << grpId << " to himself" << std::endl;
@@ -1072,16 +1110,18 @@ void RsGxsNetService::subscribeStatusChanged(
 
 bool RsGxsNetService::fragmentMsg(RsNxsMsg& msg, MsgFragments& msgFragments) const
 {
-	// first determine how many fragments
-	uint32_t msgSize = msg.msg.TlvSize();
-	uint32_t dataLeft = msgSize;
-	uint8_t nFragments = ceil(float(msgSize)/FRAGMENT_SIZE);
-
-    	RsTemporaryMemory buffer(FRAGMENT_SIZE);
-	int currPos = 0;
+	// first determine how many fragments. All of them but the last one are exactly
+	// FRAGMENT_SIZE long, which the receiving side relies on to place them.
+	uint32_t msgSize = msg.msg.bin_len;
+	uint32_t nFragments = (msgSize + FRAGMENT_SIZE - 1) / FRAGMENT_SIZE;
 
+	if(nFragments > 255)
+	{
+		std::cerr << "(EE) RsGxsNetService::fragmentMsg(): message " << msg.msgId << " of size " << msgSize << " is too large to be fragmented." << std::endl;
+		return false;
+	}
 
-	for(uint8_t i=0; i < nFragments; ++i)
+	for(uint32_t i=0; i < nFragments; ++i)
 	{
 		RsNxsMsg* msgFrag = new RsNxsMsg(mServType);
 		msgFrag->grpId = msg.grpId;
@@ -1091,13 +1131,9 @@ bool RsGxsNetService::fragmentMsg(RsNxsMsg& msg, MsgFragments& msgFragments) con
 		msgFrag->pos = i;
 		msgFrag->PeerId(msg.PeerId());
 		msgFrag->count = nFragments;
-		uint32_t fragSize = std::min(dataLeft, FRAGMENT_SIZE);
-
-		memcpy(buffer, ((char*)msg.msg.bin_data) + currPos, fragSize);
-		msgFrag->msg.setBinData(buffer, fragSize);
+		uint32_t fragSize = std::min(msgSize - i*FRAGMENT_SIZE, FRAGMENT_SIZE);
 
-		currPos += fragSize;
-		dataLeft -= fragSize;
+		msgFrag->msg.setBinData(((char*)msg.msg.bin_data) + i*FRAGMENT_SIZE, fragSize);
 		msgFragments.push_back(msgFrag);
 	}
 
@@ -1107,151 +1143,33 @@ bool RsGxsNetService::fragmentMsg(RsNxsMsg& msg, MsgFragments& msgFragments) con
 bool RsGxsNetService::fragmentGrp(RsNxsGrp& grp, GrpFragments& grpFragments) const
 {
 	// first determine how many fragments
-	uint32_t grpSize = grp.grp.TlvSize();
-	uint32_t dataLeft = grpSize;
-	uint8_t nFragments = ceil(float(grpSize)/FRAGMENT_SIZE);
-	char buffer[FRAGMENT_SIZE];
-	int currPos = 0;
+	uint32_t grpSize = grp.grp.bin_len;
+	uint32_t nFragments = (grpSize + FRAGMENT_SIZE - 1) / FRAGMENT_SIZE;
 
+	if(nFragments > 255)
+	{
+		std::cerr << "(EE) RsGxsNetService::fragmentGrp(): group " << grp.grpId << " of size " << grpSize << " is too large to be fragmented." << std::endl;
+		return false;
+	}
 
-	for(uint8_t i=0; i < nFragments; ++i)
+	for(uint32_t i=0; i < nFragments; ++i)
 	{
 		RsNxsGrp* grpFrag = new RsNxsGrp(mServType);
 		grpFrag->grpId = grp.grpId;
 		grpFrag->meta = grp.meta;
+		grpFrag->transactionNumber = grp.transactionNumber;
 		grpFrag->pos = i;
+		grpFrag->PeerId(grp.PeerId());
 		grpFrag->count = nFragments;
-		uint32_t fragSize = std::min(dataLeft, FRAGMENT_SIZE);
-
-		memcpy(buffer, ((char*)grp.grp.bin_data) + currPos, fragSize);
-		grpFrag->grp.setBinData(buffer, fragSize);
+		uint32_t fragSize = std::min(grpSize - i*FRAGMENT_SIZE, FRAGMENT_SIZE);
 
-		currPos += fragSize;
-		dataLeft -= fragSize;
+		grpFrag->grp.setBinData(((char*)grp.grp.bin_data) + i*FRAGMENT_SIZE, fragSize);
 		grpFragments.push_back(grpFrag);
 	}
 
 	return true;
 }
 
-RsNxsMsg* RsGxsNetService::deFragmentMsg(MsgFragments& msgFragments) const
-{
-	if(msgFragments.empty()) return NULL;
-
-	// if there is only one fragment with a count 1 or less then
-	// the fragment is the msg
-	if(msgFragments.size() == 1)
-	{
-		RsNxsMsg* m  = msgFragments.front();
-
-		if(m->count > 1)	// normally mcount should be exactly 1, but if not initialised (old versions) it's going to be 0
-            	{
-            		// delete everything
-            		std::cerr << "(WW) Cannot deFragment message set. m->count=" << m->count << ", but msgFragments.size()=" << msgFragments.size() << ". Incomplete? Dropping all." << std::endl;
-
-            		for(uint32_t i=0;i<msgFragments.size();++i)
-                        	delete msgFragments[i] ;
-
-                    	msgFragments.clear();
-			return NULL;
-            	}
-		else
-            	{
-            		// single piece. No need to say anything. Just return it.
-
-                    	msgFragments.clear();
-			return m;
-            	}
-	}
-
-	// first determine total size for binary data
-	MsgFragments::iterator mit = msgFragments.begin();
-	uint32_t datSize = 0;
-
-	for(; mit != msgFragments.end(); ++mit)
-		datSize += (*mit)->msg.bin_len;
-
-    	RsTemporaryMemory data(datSize) ;
-
-        if(!data)
-        {
-	    for(uint32_t i=0;i<msgFragments.size();++i)
-		    delete msgFragments[i] ;
-
-	    msgFragments.clear();
-            return NULL ;
-        }
-
-	uint32_t currPos = 0;
-
-        std::cerr << "(II) deFragmenting long message of size " << datSize << ", from " << msgFragments.size() << " pieces." << std::endl;
-
-	for(mit = msgFragments.begin(); mit != msgFragments.end(); ++mit)
-	{
-		RsNxsMsg* msg = *mit;
-		memcpy(data + (currPos), msg->msg.bin_data, msg->msg.bin_len);
-		currPos += msg->msg.bin_len;
-	}
-
-	RsNxsMsg* msg = new RsNxsMsg(mServType);
-	const RsNxsMsg& m = *(*(msgFragments.begin()));
-	msg->msg.setBinData(data, datSize);
-	msg->msgId = m.msgId;
-	msg->grpId = m.grpId;
-	msg->transactionNumber = m.transactionNumber;
-	msg->meta = m.meta;
-
-        // now clean!
-	for(uint32_t i=0;i<msgFragments.size();++i)
-		delete msgFragments[i] ;
-
-	msgFragments.clear();
-
-	return msg;
-}
-
-// This is unused apparently, since groups are never large. Anyway, we keep it in case we need it.
-
-RsNxsGrp* RsGxsNetService::deFragmentGrp(GrpFragments& grpFragments) const
-{
-	if(grpFragments.empty()) return NULL;
-
-	// first determine total size for binary data
-	GrpFragments::iterator mit = grpFragments.begin();
-	uint32_t datSize = 0;
-
-	for(; mit != grpFragments.end(); ++mit)
-		datSize += (*mit)->grp.bin_len;
-
-	char* data = new char[datSize];
-	uint32_t currPos = 0;
-
-	for(mit = grpFragments.begin(); mit != grpFragments.end(); ++mit)
-	{
-		RsNxsGrp* grp = *mit;
-		memcpy(data + (currPos), grp->grp.bin_data, grp->grp.bin_len);
-		currPos += grp->grp.bin_len;
-	}
-
-	RsNxsGrp* grp = new RsNxsGrp(mServType);
-	const RsNxsGrp& g = *(*(grpFragments.begin()));
-	grp->grp.setBinData(data, datSize);
-	grp->grpId = g.grpId;
-	grp->transactionNumber = g.transactionNumber;
-	grp->meta = g.meta;
-
-	delete[] data;
-
-	return grp;
-}
-
-struct GrpFragCollate
-{
-    RsGxsGroupId mGrpId;
-	GrpFragCollate(const RsGxsGroupId& grpId) : mGrpId(grpId){ }
-	bool operator()(RsNxsGrp* grp) { return grp->grpId == mGrpId;}
-};
-
 void RsGxsNetService::locked_createTransactionFromPending( MsgRespPending* msgPend)
 {
 #ifdef NXS_NET_DEBUG_1
@@ -1460,109 +1378,12 @@ bool RsGxsNetService::locked_createTransactionFromPending(MsgCircleIdsRequestVet
 	return false;
 }*/
 
-void RsGxsNetService::collateGrpFragments(GrpFragments fragments,
-		std::map<RsGxsGroupId, GrpFragments>& partFragments) const
-{
-	// get all unique grpIds;
-	GrpFragments::iterator vit = fragments.begin();
-	std::set<RsGxsGroupId> grpIds;
-
-	for(; vit != fragments.end(); ++vit)
-		grpIds.insert( (*vit)->grpId );
-
-	std::set<RsGxsGroupId>::iterator sit = grpIds.begin();
-
-	for(; sit != grpIds.end(); ++sit)
-	{
-		const RsGxsGroupId& grpId = *sit;
-		GrpFragments::iterator bound = std::partition(
-					fragments.begin(), fragments.end(),
-					GrpFragCollate(grpId));
-
-		// something will always be found for a group id
-		for(vit = fragments.begin(); vit != bound; )
-		{
-			partFragments[grpId].push_back(*vit);
-			vit = fragments.erase(vit);
-		}
-
-		GrpFragments& f = partFragments[grpId];
-		RsNxsGrp* grp = *(f.begin());
-
-		// if counts of fragments is incorrect remove
-		// from coalescion
-		if(grp->count != f.size())
-		{
-			GrpFragments::iterator vit2 = f.begin();
-
-			for(; vit2 != f.end(); ++vit2)
-				delete *vit2;
-
-			partFragments.erase(grpId);
-		}
-	}
-
-	fragments.clear();
-}
-
-struct MsgFragCollate
-{
-	RsGxsMessageId mMsgId;
-	MsgFragCollate(const RsGxsMessageId& msgId) : mMsgId(msgId){ }
-	bool operator()(RsNxsMsg* msg) { return msg->msgId == mMsgId;}
-};
-
-void RsGxsNetService::collateMsgFragments(MsgFragments& fragments, std::map<RsGxsMessageId, MsgFragments>& partFragments) const
-{
-	// get all unique message Ids;
-	MsgFragments::iterator vit = fragments.begin();
-	std::set<RsGxsMessageId> msgIds;
-
-	for(; vit != fragments.end(); ++vit)
-		msgIds.insert( (*vit)->msgId );
-
-
-	std::set<RsGxsMessageId>::iterator sit = msgIds.begin();
-
-	for(; sit != msgIds.end(); ++sit)
-	{
-		const RsGxsMessageId& msgId = *sit;
-		MsgFragments::iterator bound = std::partition(
-					fragments.begin(), fragments.end(),
-					MsgFragCollate(msgId));
-
-		// something will always be found for a group id
-		for(vit = fragments.begin(); vit != bound; ++vit )
-		{
-			partFragments[msgId].push_back(*vit);
-		}
-
-		fragments.erase(fragments.begin(), bound);
-		MsgFragments& f = partFragments[msgId];
-		RsNxsMsg* msg = *(f.begin());
-
-		// if counts of fragments is incorrect remove
-		// from coalescion
-		if(msg->count != f.size())
-		{
-			MsgFragments::iterator vit2 = f.begin();
-
-			for(; vit2 != f.end(); ++vit2)
-				delete *vit2;
-
-			partFragments.erase(msgId);
-		}
-	}
-
-	fragments.clear();
-}
-
 class StoreHere
 {
 public:
 
-    StoreHere(RsGxsNetService::ClientGrpMap& cgm, RsGxsNetService::ClientMsgMap& cmm, RsGxsNetService::ServerMsgMap& smm,RsGxsNetService::GrpConfigMap& gcm, RsGxsServerGrpUpdate& sgm)
-            : mClientGrpMap(cgm), mClientMsgMap(cmm), mServerMsgMap(smm), mGrpConfigMap(gcm), mServerGrpUpdate(sgm)
+    StoreHere(RsGxsNetService::ClientGrpMap& cgm, RsGxsNetService::ClientMsgMap& cmm, RsGxsNetService::ServerMsgMap& smm,RsGxsNetService::GrpConfigMap& gcm, RsGxsServerGrpUpdate& sgm, RsGxsGrpMsgIdPair& icp)
+            : mClientGrpMap(cgm), mClientMsgMap(cmm), mServerMsgMap(smm), mGrpConfigMap(gcm), mServerGrpUpdate(sgm), mIntegrityCheckPosition(icp)
     {}
 
 	template <typename ID_type,typename UpdateMap,class ItemClass> void check_store(ID_type id,UpdateMap& map,ItemClass& item)
@@ -1580,6 +1401,7 @@ public:
         RsGxsServerGrpUpdateItem  *gsui;
         RsGxsServerMsgUpdateItem  *msui;
         RsGxsGrpConfigItem        *mgci;
+        RsGxsIntegrityCheckItem   *ici;
 
         if((mui = dynamic_cast<RsGxsMsgUpdateItem*>(item)) != NULL)
             check_store(mui->peerID,mClientMsgMap,*mui);
@@ -1591,6 +1413,8 @@ public:
             check_store(msui->grpId,mServerMsgMap, *msui);
         else if((gsui = dynamic_cast<RsGxsServerGrpUpdateItem*>(item)) != NULL)
             mServerGrpUpdate = *gsui;
+        else if((ici = dynamic_cast<RsGxsIntegrityCheckItem*>(item)) != NULL)
+            mIntegrityCheckPosition = RsGxsGrpMsgIdPair(ici->grpId, ici->msgId);
         else
             std::cerr << "Type not expected!" << std::endl;
 
@@ -1605,6 +1429,7 @@ private:
     RsGxsNetService::GrpConfigMap& mGrpConfigMap;
 
     RsGxsServerGrpUpdate& mServerGrpUpdate;
+    RsGxsGrpMsgIdPair& mIntegrityCheckPosition;
 };
 
 bool RsGxsNetService::loadList(std::list<RsItem *> &load)
@@ -1613,7 +1438,7 @@ bool RsGxsNetService::loadList(std::list<RsItem *> &load)
 
     // The delete is done in StoreHere, if necessary
 
-    std::for_each(load.begin(), load.end(), StoreHere(mClientGrpUpdateMap, mClientMsgUpdateMap, mServerMsgUpdateMap, mServerGrpConfigMap, mGrpServerUpdate));
+    std::for_each(load.begin(), load.end(), StoreHere(mClientGrpUpdateMap, mClientMsgUpdateMap, mServerMsgUpdateMap, mServerGrpConfigMap, mGrpServerUpdate, mIntegrityCheckPosition));
 	rstime_t now = time(NULL);
 
     // We reset group statistics here. This is the best place since we know at this point which are all unsubscribed groups.
@@ -1690,6 +1515,14 @@ bool RsGxsNetService::saveList(bool& cleanup, std::list<RsItem*>& save)
 
     save.push_back(it);
 
+    if(!mIntegrityCheckPosition.first.isNull())
+    {
+        RsGxsIntegrityCheckItem *ici = new RsGxsIntegrityCheckItem(mServType) ;
+        ici->grpId = mIntegrityCheckPosition.first ;
+        ici->msgId = mIntegrityCheckPosition.second ;
+        save.push_back(ici);
+    }
+
     cleanup = true;
     return true;
 }
@@ -1862,7 +1695,23 @@ bool RsGxsNetService::handleTransaction(RsNxsItem* item)
 #endif
 
             tr = transMap[transN];
-            tr->mItems.push_back(item);
+            ++tr->mNbReceived;
+
+            // Fragments of large items are put together as they arrive, so
+            // that only complete items are queued in the transaction.
+
+            if(NxsFragmentAssembler::isFragment(item))
+            {
+                static NxsFragmentBudget fragmentBudget(MAX_FRAGMENT_BYTES_PER_PEER, MAX_FRAGMENT_BYTES_TOTAL);
+
+                if(!tr->mAssembler)
+                    tr->mAssembler = new NxsFragmentAssembler(FRAGMENT_SIZE, RsGeneralDataService::GXS_MAX_ITEM_SIZE, &fragmentBudget, peer);
+
+                item = tr->mAssembler->addItem(item);
+            }
+
+            if(item)
+                tr->mItems.push_back(item);
 
             return true;
         }
@@ -2029,6 +1878,8 @@ void RsGxsNetService::threadTick()
         if(mUpdateCounter % 20 == 0)	// dump the full shit every 20 secs
             debugDump() ;
 
+        mSyncStats.periodicDump();
+
         // process active transactions
         processTransactions();
 
@@ -2430,14 +2281,14 @@ void RsGxsNetService::processTransactions()
                 if(flag & NxsTransaction::FLAG_STATE_RECEIVING)
                 {
 #ifdef NXS_NET_DEBUG_1
-                    GXSNETDEBUG_P_(mit->first) << "    received " << tr->mItems.size() << " item over a total of " << tr->mTransaction->nItems << std::endl;
+                    GXSNETDEBUG_P_(mit->first) << "    received " << tr->mNbReceived << " item over a total of " << tr->mTransaction->nItems << std::endl;
 #endif
 
                     // if the number it item received equal that indicated
                     // then transaction is marked as completed
                     // to be moved to complete transations
                     // check if done
-                    if(tr->mItems.size() == tr->mTransaction->nItems)
+                    if(tr->mNbReceived == tr->mTransaction->nItems)
                     {
                         tr->mFlag = NxsTransaction::FLAG_STATE_COMPLETED;
 #ifdef NXS_NET_DEBUG_1
@@ -2561,6 +2412,11 @@ void RsGxsNetService::processCompletedTransactions()
 
 		bool outgoing = tr->mTransaction->PeerId() == mOwnId;
 
+		if(mSyncStats.enabled())
+			mSyncStats.transactionDone( outgoing ? RsPeerId() : tr->mTransaction->PeerId(),
+			                            tr->mFlag != NxsTransaction::FLAG_STATE_FAILED,
+			                            RsGxsNetStatsCollector::now_us() - tr->mStartTime );
+
 		if(outgoing){
 			locked_processCompletedOutgoingTrans(tr);
 		}else{
@@ -2708,25 +2564,6 @@ void RsGxsNetService::locked_processCompletedIncomingTrans(NxsTransaction* tr)
 //#warning We need here to queue all incoming items into a list where the vetting will be checked
 //#warning in order to avoid someone without the proper rights to post in a group protected with an external circle
 
-#ifdef NXS_FRAG
-            // (cyril) This code does not work. Since we do not really need message fragmenting, I won't fix it.
-
-            std::map<RsGxsMessageId, MsgFragments > collatedMsgs;
-            collateMsgFragments(msgs, collatedMsgs);			// this destroys msgs whatsoever and recovers memory when needed
-
-            msgs.clear();
-
-            std::map<RsGxsMessageId, MsgFragments >::iterator mit = collatedMsgs.begin();
-            for(; mit != collatedMsgs.end(); ++mit)
-            {
-                MsgFragments& f = mit->second;
-                RsNxsMsg* msg = deFragmentMsg(f);
-
-                if(msg)
-                    msgs.push_back(msg);
-            }
-            collatedMsgs.clear();
-#endif
 #ifdef NXS_NET_DEBUG_0
             GXSNETDEBUG_PG(tr->mTransaction->PeerId(),grpId) << "  ...and notifying observer of " << msgs.size() << " new messages." << std::endl;
 #endif
@@ -3339,7 +3176,10 @@ void RsGxsNetService::locked_genSendGrpsTransaction(NxsTransaction* tr)
 	}
 
 	if(!grps.empty())
+	{
+        RsGxsNetStatsCollector::DbQueryTimer dbTimer(mSyncStats);
         mDataStore->retrieveNxsGrps(grps, false);
+	}
 	else
 	{
 #ifdef NXS_NET_DEBUG_1
@@ -3509,6 +3349,8 @@ void RsGxsNetService::runVetting()
 			++vit2;
 		}
 	}
+
+	mSyncStats.vettingQueueSize(mPendingResp.size() + mPendingCircleVets.size());
 }
 
 void RsGxsNetService::locked_genSendMsgsTransaction(NxsTransaction* tr)
@@ -3579,7 +3421,10 @@ void RsGxsNetService::locked_genSendMsgsTransaction(NxsTransaction* tr)
 #endif
 #endif
 
-    mDataStore->retrieveNxsMsgs(msgIds, msgs, false);
+    {
+        RsGxsNetStatsCollector::DbQueryTimer dbTimer(mSyncStats);
+        mDataStore->retrieveNxsMsgs(msgIds, msgs, false);
+    }
 
     NxsTransaction* newTr = new NxsTransaction();
     newTr->mFlag = NxsTransaction::FLAG_STATE_WAITING_CONFIRM;
@@ -3986,6 +3831,8 @@ void RsGxsNetService::locked_pushGrpRespFromList(std::list<RsNxsItem*>& respList
     GXSNETDEBUG_P_(peer) << "   peerId = " << peer << std::endl;
     GXSNETDEBUG_P_(peer) << "   transN = " << transN << std::endl;
 #endif
+    mSyncStats.syncRespSent(peer, respList.size(), false);
+
     NxsTransaction* tr = new NxsTransaction();
 	tr->mItems = respList;
 
@@ -4054,9 +3901,12 @@ void RsGxsNetService::handleRecvSyncGroup(RsNxsSyncGrpReqItem *item)
         }
     }
 
+    mSyncStats.syncReqReceived(peer);
+
     RsGxsGrpMetaTemporaryMap grp;
     {
         RS_STACK_MUTEX(mNxsMutex) ;
+        RsGxsNetStatsCollector::DbQueryTimer dbTimer(mSyncStats);
         mDataStore->retrieveGxsGrpMetaData(grp);
     }
 
@@ -4374,6 +4224,8 @@ void RsGxsNetService::handleRecvSyncMessage(RsNxsSyncMsgReqItem *item,bool item_
 
     bool peer_can_receive_update = locked_CanReceiveUpdate(item, grp_is_known);
 
+    mSyncStats.syncReqReceived(peer);
+
     if(item_was_encrypted)
         std::cerr << "(WW) got an encrypted msg sync req. from " << item->PeerId() << ". This will not send messages updates for group " << item->grpId << std::endl;
 
@@ -4406,7 +4258,10 @@ void RsGxsNetService::handleRecvSyncMessage(RsNxsSyncMsgReqItem *item,bool item_
     RsGxsGrpMetaTemporaryMap grpMetas;
     grpMetas[item->grpId] = NULL;
 
-    mDataStore->retrieveGxsGrpMetaData(grpMetas);
+    {
+        RsGxsNetStatsCollector::DbQueryTimer dbTimer(mSyncStats);
+        mDataStore->retrieveGxsGrpMetaData(grpMetas);
+    }
     const auto& grpMeta = grpMetas[item->grpId];
 
     if(grpMeta == NULL)
@@ -4435,17 +4290,29 @@ void RsGxsNetService::handleRecvSyncMessage(RsNxsSyncMsgReqItem *item,bool item_
         return ;
     }
 
-    GxsMsgReq req;
-    req[item->grpId] = std::set<RsGxsMessageId>();
+    // Only load the metas of messages that were published since the last update of the peer. Older
+    // messages are anyway not sent, so there's no need to load them from the DB.
 
-    GxsMsgMetaResult metaResult;
-    mDataStore->retrieveGxsMsgMetaData(req, metaResult);
-    auto& msgMetas = metaResult[item->grpId];
+    RsGxsMsgMetaFilter filter;
+    filter.mGrpId = item->grpId;
+    filter.mMinPublishTs = item->createdSinceTS;
+
+    std::vector<std::shared_ptr<RsGxsMsgMetaData> > msgMetas;
+    uint64_t cursor = 0;
 
 #ifdef NXS_NET_DEBUG_0
     GXSNETDEBUG_PG(item->PeerId(),item->grpId) << "   retrieving message meta data." << std::endl;
 #endif
-    if(req.empty())
+    {
+        RsGxsNetStatsCollector::DbQueryTimer dbTimer(mSyncStats);
+
+        do
+            if(!mDataStore->retrieveGxsMsgMetaDataPage(filter, cursor, SYNC_MSG_META_PAGE_SIZE, msgMetas))
+                break;
+        while(cursor != 0);
+    }
+
+    if(msgMetas.empty())
     {
 #ifdef NXS_NET_DEBUG_0
 	    GXSNETDEBUG_PG(item->PeerId(),item->grpId) << "  No msg meta data.." << std::endl;
@@ -4586,6 +4453,8 @@ void RsGxsNetService::locked_pushMsgRespFromList(std::list<RsNxsItem*>& itemL, c
     GXSNETDEBUG_PG(sslId,grp_id) << "   peerId = " << sslId << std::endl;
     GXSNETDEBUG_PG(sslId,grp_id) << "   transN = " << transN << std::endl;
 #endif
+    mSyncStats.syncRespSent(sslId, itemL.size(), true);
+
     NxsTransaction* tr = new NxsTransaction();
 	tr->mItems = itemL;
 	tr->mFlag = NxsTransaction::FLAG_STATE_WAITING_CONFIRM;
@@ -34,6 +34,7 @@
 #include "rsitems/rsgxsupdateitems.h"
 #include "rsgxsnettunnel.h"
 #include "rsgxsnetutils.h"
+#include "rsgxsnetstats.h"
 #include "pqi/p3cfgmgr.h"
 #include "rsgixs.h"
 
@@ -235,6 +236,12 @@ public:
      */
     virtual bool getGroupNetworkStats(const RsGxsGroupId& id,RsGroupNetworkStats& stats) override ;
 
+    bool getNetworkStatistics(RsGxsNetStatistics& stats) override ;
+    void setNetworkStatisticsEnabled(bool enabled) override ;
+
+    bool getIntegrityCheckPosition(RsGxsGrpMsgIdPair& position) override ;
+    void setIntegrityCheckPosition(const RsGxsGrpMsgIdPair& position) override ;
+
     /*!
      * Used to inform the net service that we changed subscription status. That helps
      * optimising data transfer when e.g. unsubsribed groups are updated less often, etc
@@ -524,7 +531,8 @@ private:
     void sharePublishKeysPending() ;
 
     /*!
-     * Fragment a message into individual fragments which are at most 150kb
+     * Fragment a message into individual fragments which are at most 150kb.
+     * Fragments are put back together by NxsFragmentAssembler as they are received.
      * @param msg message to fragment
      * @param msgFragments fragmented message
      * @return false if fragmentation fails true otherwise
@@ -539,39 +547,6 @@ private:
      */
     bool fragmentGrp(RsNxsGrp& grp, GrpFragments& grpFragments) const;
 
-    /*!
-     * Fragment a message into individual fragments which are at most 150kb
-     * @param msg message to fragment
-     * @param msgFragments fragmented message
-     * @return NULL if not possible to reconstruct message from fragment,
-     *              pointer to defragments nxs message is possible
-     */
-    RsNxsMsg* deFragmentMsg(MsgFragments& msgFragments) const;
-
-    /*!
-     * Fragment a group into individual fragments which are at most 150kb
-     * @param grp group to fragment
-     * @param grpFragments fragmented group
-     * @return NULL if not possible to reconstruct group from fragment,
-     *              pointer to defragments nxs group is possible
-     */
-    RsNxsGrp* deFragmentGrp(GrpFragments& grpFragments) const;
-
-
-    /*!
-     * Note that if all fragments for a message are not found then its fragments are dropped
-     * @param fragments message fragments which are not necessarily from the same message
-     * @param partFragments the partitioned fragments (into message ids)
-     */
-    void collateMsgFragments(MsgFragments &fragments, std::map<RsGxsMessageId, MsgFragments>& partFragments) const;
-
-    /*!
-	 * Note that if all fragments for a group are not found then its fragments are dropped
-	 * @param fragments group fragments which are not necessarily from the same group
-	 * @param partFragments the partitioned fragments (into message ids)
-	 */
-    void collateGrpFragments(GrpFragments fragments, std::map<RsGxsGroupId, GrpFragments>& partFragments) const;
-
     /*!
     * stamp the group info from that particular peer at the given time.
     */
@@ -646,6 +621,8 @@ private:
     // need to be verfied
     std::vector<AuthorPending*> mPendingResp;
     std::vector<GrpCircleVetting*> mPendingCircleVets;
+
+    RsGxsNetStatsCollector mSyncStats;
     std::map<RsGxsGroupId,std::set<RsPeerId> > mPendingPublishKeyRecipients ;
 	std::map<RsPeerId, std::set<RsGxsGroupId> > mExplicitRequest;
     std::map<RsPeerId, std::set<RsGxsGroupId> > mPartialMsgUpdates ;
@@ -667,6 +644,7 @@ private:
     GrpConfigMap mServerGrpConfigMap;
 
     RsGxsServerGrpUpdate mGrpServerUpdate;
+    RsGxsGrpMsgIdPair mIntegrityCheckPosition;
     RsServiceInfo mServiceInfo;
     
     std::map<RsGxsMessageId,rstime_t> mRejectedMessages;
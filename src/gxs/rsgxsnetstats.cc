@@ -0,0 +1,225 @@
+/*******************************************************************************
+ * libretroshare/src/gxs: rsgxsnetstats.cc                                     *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <chrono>
+
+#include "gxs/rsgxsnetstats.h"
+#include "util/rsdebug.h"
+
+static const uint32_t NET_STATS_DUMP_PERIOD = 300; // 5 minutes
+
+/* Bucket index of a value: values below 4 have their own bucket, then each
+ * [2^n, 2^(n+1)) range is split in 4 buckets using the 2 bits after the most
+ * significant one. */
+static uint32_t histogramBucket(uint64_t value)
+{
+	if(value < 4)
+		return value;
+
+	uint32_t msb = 63 - __builtin_clzll(value);
+
+	return (msb-1)*4 + ((value >> (msb-2)) & 3);
+}
+
+static uint64_t histogramBucketMax(uint32_t bucket)
+{
+	if(bucket < 4)
+		return bucket;
+
+	uint32_t msb = bucket/4 + 1;
+	uint64_t width = uint64_t(1) << (msb-2);
+
+	return (4 + bucket%4) * width + width - 1;
+}
+
+void RsGxsHistogram::record(uint64_t value)
+{
+	uint32_t b = histogramBucket(value);
+
+	if(mBuckets.size() <= b)
+		mBuckets.resize(b+1, 0);
+
+	++mBuckets[b];
+	++mCount;
+	mTotal += value;
+	mMax = std::max(mMax, value);
+}
+
+void RsGxsHistogram::merge(const RsGxsHistogram& h)
+{
+	if(mBuckets.size() < h.mBuckets.size())
+		mBuckets.resize(h.mBuckets.size(), 0);
+
+	for(uint32_t i=0; i<h.mBuckets.size(); ++i)
+		mBuckets[i] += h.mBuckets[i];
+
+	mCount += h.mCount;
+	mTotal += h.mTotal;
+	mMax = std::max(mMax, h.mMax);
+}
+
+uint64_t RsGxsHistogram::percentile(double fraction) const
+{
+	if(mCount == 0)
+		return 0;
+
+	uint64_t rank = std::max<uint64_t>(1, fraction * mCount + 0.5);
+	uint64_t seen = 0;
+
+	for(uint32_t i=0; i<mBuckets.size(); ++i)
+		if((seen += mBuckets[i]) >= rank)
+			return std::min(histogramBucketMax(i), mMax);
+
+	return mMax;
+}
+
+RsGxsHistogram::~RsGxsHistogram() = default;
+RsGxsNetSyncCounters::~RsGxsNetSyncCounters() = default;
+RsGxsNetStatistics::~RsGxsNetStatistics() = default;
+
+RsGxsNetStatsCollector::RsGxsNetStatsCollector(uint16_t serviceType) :
+    mEnabled(false), mStatsMtx("RsGxsNetStatsCollector"), mLastDumpTS(0)
+{
+	mStats.mServiceType = serviceType;
+}
+
+uint64_t RsGxsNetStatsCollector::now_us()
+{
+	using namespace std::chrono;
+	return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void RsGxsNetStatsCollector::setEnabled(bool enabled)
+{
+	RS_STACK_MUTEX(mStatsMtx);
+
+	if(enabled && !mEnabled)
+	{
+		uint16_t serviceType = mStats.mServiceType;
+
+		mStats = RsGxsNetStatistics();
+		mStats.mServiceType = serviceType;
+		mStats.mStartTS = time(NULL);
+		mLastDumpTS = mStats.mStartTS;
+	}
+
+	mStats.mEnabled = enabled;
+	mEnabled = enabled;
+}
+
+void RsGxsNetStatsCollector::syncReqSent(const RsPeerId& peer)
+{
+	if(!enabled()) return;
+
+	RS_STACK_MUTEX(mStatsMtx);
+	++mStats.mTotal.mSyncReqSent;
+	++mStats.mPeers[peer].mSyncReqSent;
+}
+
+void RsGxsNetStatsCollector::syncReqReceived(const RsPeerId& peer)
+{
+	if(!enabled()) return;
+
+	RS_STACK_MUTEX(mStatsMtx);
+	++mStats.mTotal.mSyncReqReceived;
+	++mStats.mPeers[peer].mSyncReqReceived;
+}
+
+void RsGxsNetStatsCollector::syncRespSent(const RsPeerId& peer, uint32_t nbIds, bool msgIds)
+{
+	if(!enabled()) return;
+
+	RS_STACK_MUTEX(mStatsMtx);
+
+	for(RsGxsNetSyncCounters* c : { &mStats.mTotal, &mStats.mPeers[peer] })
+	{
+		(msgIds ? c->mMsgIdsSent : c->mGrpIdsSent) += nbIds;
+		c->mSyncRespSize.record(nbIds);
+	}
+}
+
+void RsGxsNetStatsCollector::transactionDone(const RsPeerId& peer, bool success, uint64_t duration_us)
+{
+	if(!enabled()) return;
+
+	RS_STACK_MUTEX(mStatsMtx);
+
+	std::vector<RsGxsNetSyncCounters*> counters(1, &mStats.mTotal);
+
+	if(!peer.isNull())
+		counters.push_back(&mStats.mPeers[peer]);
+
+	for(auto c : counters)
+	{
+		++(success ? c->mTransactionsOk : c->mTransactionsFailed);
+		c->mTransactionTime.record(duration_us);
+	}
+}
+
+void RsGxsNetStatsCollector::dbQueryTime(uint64_t duration_us)
+{
+	if(!enabled()) return;
+
+	RS_STACK_MUTEX(mStatsMtx);
+	mStats.mDbQueryTime.record(duration_us);
+}
+
+void RsGxsNetStatsCollector::vettingQueueSize(uint32_t size)
+{
+	if(!enabled()) return;
+
+	RS_STACK_MUTEX(mStatsMtx);
+	mStats.mVettingQueueSize = size;
+	mStats.mVettingQueueMax = std::max(mStats.mVettingQueueMax, size);
+}
+
+void RsGxsNetStatsCollector::getStatistics(RsGxsNetStatistics& stats)
+{
+	RS_STACK_MUTEX(mStatsMtx);
+	stats = mStats;
+}
+
+void RsGxsNetStatsCollector::periodicDump()
+{
+	if(!enabled()) return;
+
+	RS_STACK_MUTEX(mStatsMtx);
+
+	rstime_t now = time(NULL);
+
+	if(mLastDumpTS + NET_STATS_DUMP_PERIOD > now)
+		return;
+
+	mLastDumpTS = now;
+
+	const RsGxsNetSyncCounters& t(mStats.mTotal);
+
+	RsInfo() << "GXS net stats, service " << std::hex << mStats.mServiceType << std::dec
+	         << " since " << now - mStats.mStartTS << " s: sync req sent/recv " << t.mSyncReqSent << "/" << t.mSyncReqReceived
+	         << ", ids sent grp/msg " << t.mGrpIdsSent << "/" << t.mMsgIdsSent
+	         << ", resp size p50/p99 " << t.mSyncRespSize.percentile(0.5) << "/" << t.mSyncRespSize.percentile(0.99)
+	         << ", transactions ok/failed " << t.mTransactionsOk << "/" << t.mTransactionsFailed
+	         << ", transaction us p50/p99/max " << t.mTransactionTime.percentile(0.5) << "/" << t.mTransactionTime.percentile(0.99) << "/" << t.mTransactionTime.mMax
+	         << ", db us p50/p99/max " << mStats.mDbQueryTime.percentile(0.5) << "/" << mStats.mDbQueryTime.percentile(0.99) << "/" << mStats.mDbQueryTime.mMax
+	         << ", vetting queue " << mStats.mVettingQueueSize << " (max " << mStats.mVettingQueueMax << ")"
+	         << ", peers " << mStats.mPeers.size();
+}
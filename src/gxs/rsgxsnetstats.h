@@ -0,0 +1,85 @@
+/*******************************************************************************
+ * libretroshare/src/gxs: rsgxsnetstats.h                                      *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+
+#include "retroshare/rsgxsifacetypes.h"
+#include "util/rsthreads.h"
+
+/*!
+ * Collects the sync metrics of a GXS network service (see RsGxsNetStatistics).
+ * When disabled, which is the default, recording only costs the check of an
+ * atomic flag, so calls can be left in the hot paths.
+ */
+class RsGxsNetStatsCollector
+{
+public:
+	explicit RsGxsNetStatsCollector(uint16_t serviceType);
+
+	/// Enabling resets all counters
+	void setEnabled(bool enabled);
+	bool enabled() const { return mEnabled.load(std::memory_order_relaxed); }
+
+	void syncReqSent(const RsPeerId& peer);
+	void syncReqReceived(const RsPeerId& peer);
+	void syncRespSent(const RsPeerId& peer, uint32_t nbIds, bool msgIds);
+
+	/*!
+	 * @param peer null for outgoing transactions, which are only accounted globally
+	 * @param duration_us time since creation of the transaction
+	 */
+	void transactionDone(const RsPeerId& peer, bool success, uint64_t duration_us);
+
+	void dbQueryTime(uint64_t duration_us);
+	void vettingQueueSize(uint32_t size);
+
+	void getStatistics(RsGxsNetStatistics& stats);
+
+	/// Logs a summary, at most once every few minutes
+	void periodicDump();
+
+	/// @return current time in microseconds, to measure durations
+	static uint64_t now_us();
+
+	/// Accounts the lifetime of the object as data store time
+	class DbQueryTimer
+	{
+	public:
+		explicit DbQueryTimer(RsGxsNetStatsCollector& stats) :
+		    mStats(stats), mStart(stats.enabled() ? now_us() : 0) {}
+
+		~DbQueryTimer() { if(mStart) mStats.dbQueryTime(now_us() - mStart); }
+
+	private:
+		RsGxsNetStatsCollector& mStats;
+		uint64_t mStart;
+	};
+
+private:
+	std::atomic<bool> mEnabled;
+
+	RsMutex mStatsMtx;
+	RsGxsNetStatistics mStats;
+	rstime_t mLastDumpTS;
+};
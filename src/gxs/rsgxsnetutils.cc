@@ -21,8 +21,11 @@
  *******************************************************************************/
 
 #include "rsgxsnetutils.h"
+#include "rsgxsnetstats.h"
 #include "pqi/p3servicecontrol.h"
 #include "pgp/pgpauxutils.h"
+#include "util/rsdebug.h"
+#include "util/rsmemory.h"
 
  const rstime_t AuthorPending::EXPIRY_PERIOD_OFFSET = 30; // 30 seconds
  const int AuthorPending::MSG_PEND = 1;
@@ -158,7 +161,7 @@ const uint8_t NxsTransaction::FLAG_STATE_COMPLETED       = 0x0080;	// originaly
 
 
 NxsTransaction::NxsTransaction()
-    : mFlag(0), mTimeOut(0), mTransaction(NULL) {
+    : mFlag(0), mTimeOut(0), mStartTime(RsGxsNetStatsCollector::now_us()), mNbReceived(0), mTransaction(NULL), mAssembler(NULL) {
 
 }
 
@@ -176,6 +179,248 @@ NxsTransaction::~NxsTransaction(){
 		delete mTransaction;
 
 	mTransaction = NULL;
+
+	delete mAssembler;
+}
+
+/** NxsFragmentAssembler **/
+
+NxsFragmentBudget::NxsFragmentBudget(uint64_t maxBytesPerPeer, uint64_t maxBytesTotal)
+    : mMtx("NxsFragmentBudget"), mMaxBytesPerPeer(maxBytesPerPeer), mMaxBytesTotal(maxBytesTotal), mReservedTotal(0) {}
+
+bool NxsFragmentBudget::reserve(const RsPeerId& peer, uint64_t bytes)
+{
+	RS_STACK_MUTEX(mMtx);
+
+	uint64_t& reserved(mReserved[peer]);
+
+	if(reserved + bytes > mMaxBytesPerPeer || mReservedTotal + bytes > mMaxBytesTotal)
+	{
+		if(reserved == 0)
+			mReserved.erase(peer);
+
+		return false;
+	}
+
+	reserved += bytes;
+	mReservedTotal += bytes;
+	return true;
+}
+
+void NxsFragmentBudget::release(const RsPeerId& peer, uint64_t bytes)
+{
+	RS_STACK_MUTEX(mMtx);
+
+	std::map<RsPeerId, uint64_t>::iterator it = mReserved.find(peer);
+
+	if(it == mReserved.end() || it->second < bytes)
+	{
+		RsErr() << "NxsFragmentBudget: releasing " << bytes << " bytes that were not reserved for peer " << peer;
+		return;
+	}
+
+	it->second -= bytes;
+	mReservedTotal -= bytes;
+
+	if(it->second == 0)
+		mReserved.erase(it);
+}
+
+uint64_t NxsFragmentBudget::reservedBytes(const RsPeerId& peer)
+{
+	RS_STACK_MUTEX(mMtx);
+
+	std::map<RsPeerId, uint64_t>::const_iterator it = mReserved.find(peer);
+	return it == mReserved.end() ? 0 : it->second;
+}
+
+uint64_t NxsFragmentBudget::reservedBytes()
+{
+	RS_STACK_MUTEX(mMtx);
+	return mReservedTotal;
+}
+
+NxsFragmentAssembler::NxsFragmentAssembler(uint32_t fragmentSize, uint32_t maxItemSize, NxsFragmentBudget *budget, const RsPeerId& peer)
+    : mFragmentSize(fragmentSize), mMaxItemSize(maxItemSize), mBudget(budget), mPeer(peer), mPendingBytes(0) {}
+
+NxsFragmentAssembler::~NxsFragmentAssembler()
+{
+	for(auto& it : mPartialMsgs)
+	{
+		release(it.second);
+		delete it.second.mItem;
+	}
+	for(auto& it : mPartialGrps)
+	{
+		release(it.second);
+		delete it.second.mItem;
+	}
+}
+
+void NxsFragmentAssembler::release(PartialItem& p)
+{
+	free(p.mData);
+	p.mData = NULL;
+
+	if(mBudget)
+		mBudget->release(mPeer, p.mCapacity);
+
+	mPendingBytes -= p.mCapacity;
+	p.mCapacity = 0;
+}
+
+bool NxsFragmentAssembler::grow(PartialItem& p, uint32_t size, uint32_t count)
+{
+	if(size <= p.mCapacity)
+		return true;
+
+	// Double the buffer at most up to the size of the whole item, so that fragments received
+	// in order cost a bounded number of copies, and the peer's count is never allocated upfront.
+
+	uint32_t capacity = std::max(size, std::min(2 * p.mCapacity, count * mFragmentSize));
+
+	if(mBudget && !mBudget->reserve(mPeer, capacity - p.mCapacity))
+		return false;
+
+	uint8_t *data = (uint8_t*)realloc(p.mData, capacity);
+
+	if(!data)
+	{
+		if(mBudget)
+			mBudget->release(mPeer, capacity - p.mCapacity);
+
+		return false;
+	}
+
+	mPendingBytes += capacity - p.mCapacity;
+	p.mData = data;
+	p.mCapacity = capacity;
+
+	return true;
+}
+
+bool NxsFragmentAssembler::isFragment(const RsNxsItem *item)
+{
+	// count is 0 for items sent by peers that never fragment, and 1 for items sent in one piece
+
+	if(const RsNxsMsg *msg = dynamic_cast<const RsNxsMsg*>(item))
+		return msg->count > 1;
+
+	if(const RsNxsGrp *grp = dynamic_cast<const RsNxsGrp*>(item))
+		return grp->count > 1;
+
+	return false;
+}
+
+RsNxsItem *NxsFragmentAssembler::addItem(RsNxsItem *item)
+{
+	if(!isFragment(item))
+		return item;
+
+	if(RsNxsMsg *msg = dynamic_cast<RsNxsMsg*>(item))
+		return addFragment(msg, msg->msgId, &RsNxsMsg::msg, mPartialMsgs);
+	else
+	{
+		RsNxsGrp *grp = static_cast<RsNxsGrp*>(item);
+		return addFragment(grp, grp->grpId, &RsNxsGrp::grp, mPartialGrps);
+	}
+}
+
+template<class ItemT, class IdT>
+RsNxsItem *NxsFragmentAssembler::addFragment(ItemT *frag, IdT id, RsTlvBinaryData ItemT::*dataField, std::map<IdT, PartialItem>& partials)
+{
+	RsTlvBinaryData& fragData(frag->*dataField);
+	bool last = frag->pos + 1 == frag->count;
+
+	// all fragments but the last one are full size, so that each fragment has a fixed place in the item
+
+	if(frag->pos >= frag->count || fragData.bin_len > mFragmentSize || (!last && fragData.bin_len != mFragmentSize))
+	{
+		RsWarn() << "NxsFragmentAssembler: dropping fragment " << (int)frag->pos << "/" << (int)frag->count
+		         << " of size " << fragData.bin_len << " of item " << id << ": inconsistent size.";
+		delete frag;
+		return NULL;
+	}
+
+	// The smallest item having that many fragments must still be acceptable.
+
+	if(uint64_t(frag->count - 1) * mFragmentSize >= mMaxItemSize)
+	{
+		RsWarn() << "NxsFragmentAssembler: dropping fragment " << (int)frag->pos << "/" << (int)frag->count
+		         << " of item " << id << ": item would exceed " << mMaxItemSize << " bytes.";
+		delete frag;
+		return NULL;
+	}
+
+	typename std::map<IdT, PartialItem>::iterator it = partials.find(id);
+
+	if(it == partials.end())
+	{
+		PartialItem p;
+		p.mItem = NULL;
+		p.mData = NULL;
+		p.mCapacity = 0;
+		p.mSize = 0;
+		p.mNbReceived = 0;
+		p.mReceived.resize(frag->count, false);
+
+		it = partials.insert(std::make_pair(id, p)).first;
+	}
+
+	PartialItem& p(it->second);
+
+	if(p.mReceived.size() != frag->count || p.mReceived[frag->pos])
+	{
+		RsWarn() << "NxsFragmentAssembler: dropping duplicate or inconsistent fragment " << (int)frag->pos << "/" << (int)frag->count << " of item " << id;
+		delete frag;
+		return NULL;
+	}
+
+	if(!grow(p, frag->pos * mFragmentSize + fragData.bin_len, frag->count))
+	{
+		RsWarn() << "NxsFragmentAssembler: dropping item " << id << " from peer " << mPeer
+		         << ": too much memory held by incomplete items.";
+		release(p);
+		delete p.mItem;
+		partials.erase(it);
+		delete frag;
+		return NULL;
+	}
+
+	memcpy(p.mData + frag->pos * mFragmentSize, fragData.bin_data, fragData.bin_len);
+	p.mReceived[frag->pos] = true;
+	++p.mNbReceived;
+
+	if(last)
+		p.mSize = frag->pos * mFragmentSize + fragData.bin_len;
+
+	if(p.mItem)
+		delete frag;
+	else
+	{
+		fragData.TlvClear();
+		p.mItem = frag;
+	}
+
+	if(p.mNbReceived < p.mReceived.size())
+		return NULL;
+
+	// complete: hand the buffer over to the item, without copying it
+
+	ItemT *item = static_cast<ItemT*>(p.mItem);
+	RsTlvBinaryData& data(item->*dataField);
+
+	data.TlvClear();
+	data.bin_data = p.mData;
+	data.bin_len = p.mSize;
+	item->pos = 0;
+	item->count = 1;
+
+	p.mData = NULL;	// now owned by the item
+	release(p);
+	partials.erase(it);
+
+	return item;
 }
 
 
@@ -24,13 +24,101 @@
 #define RSGXSNETUTILS_H_
 
 #include <stdlib.h>
+#include <map>
+#include <vector>
 #include "retroshare/rsgxsifacetypes.h"
 #include "rsitems/rsnxsitems.h"
 #include "rsgixs.h"
+#include "util/rsthreads.h"
 
 class p3ServiceControl;
 class PgpAuxUtils;
 
+/*!
+ * Memory that incomplete fragmented items may hold, per peer and in total.
+ * Shared by the assemblers of all transactions, so that peers announcing large
+ * items without sending them cannot make us hold unbounded memory.
+ */
+class NxsFragmentBudget
+{
+public:
+    NxsFragmentBudget(uint64_t maxBytesPerPeer, uint64_t maxBytesTotal);
+
+    /// @return false, reserving nothing, if it would exceed one of the limits
+    bool reserve(const RsPeerId& peer, uint64_t bytes);
+    void release(const RsPeerId& peer, uint64_t bytes);
+
+    uint64_t reservedBytes(const RsPeerId& peer);
+    uint64_t reservedBytes();
+
+private:
+    RsMutex mMtx;
+    const uint64_t mMaxBytesPerPeer;
+    const uint64_t mMaxBytesTotal;
+    uint64_t mReservedTotal;
+    std::map<RsPeerId, uint64_t> mReserved;
+};
+
+/*!
+ * Reassembles the messages and groups that were sent as several RsNxsMsg or
+ * RsNxsGrp fragments, as the fragments are received.
+ * The data of each fragment is copied once at its final place in a buffer that
+ * grows with the data received, and the fragment is deleted right away. The
+ * fragment count announced by the peer is only trusted up to maxItemSize.
+ */
+class NxsFragmentAssembler
+{
+public:
+    /*!
+     * @param budget if not NULL, memory of incomplete items is reserved from
+     * it for peer. Items that don't fit are dropped.
+     */
+    NxsFragmentAssembler(uint32_t fragmentSize, uint32_t maxItemSize,
+                         NxsFragmentBudget *budget = NULL, const RsPeerId& peer = RsPeerId());
+    ~NxsFragmentAssembler();
+
+    /// @return true if the item is a part of a message or group sent in several fragments
+    static bool isFragment(const RsNxsItem *item);
+
+    /*!
+     * Takes ownership of item. Items that are not fragments are returned as is.
+     * @return the complete item when item was its last missing fragment, NULL otherwise
+     */
+    RsNxsItem *addItem(RsNxsItem *item);
+
+    /// @return memory currently held by incomplete items
+    uint64_t pendingBytes() const { return mPendingBytes; }
+
+    /// @return number of items waiting for some of their fragments
+    uint32_t pendingItems() const { return mPartialMsgs.size() + mPartialGrps.size(); }
+
+private:
+    struct PartialItem
+    {
+        RsNxsItem *mItem;               // first fragment received, without its data. Holds ids and meta data.
+        uint8_t *mData;
+        uint32_t mCapacity;
+        uint32_t mSize;                 // known when the last fragment is received
+        uint32_t mNbReceived;
+        std::vector<bool> mReceived;
+    };
+
+    template<class ItemT, class IdT>
+    RsNxsItem *addFragment(ItemT *frag, IdT id, RsTlvBinaryData ItemT::*dataField, std::map<IdT, PartialItem>& partials);
+
+    /// makes room for size bytes in the buffer of p
+    bool grow(PartialItem& p, uint32_t size, uint32_t count);
+    void release(PartialItem& p);
+
+    uint32_t mFragmentSize;
+    uint32_t mMaxItemSize;
+    NxsFragmentBudget *mBudget;
+    RsPeerId mPeer;
+    uint64_t mPendingBytes;
+    std::map<RsGxsMessageId, PartialItem> mPartialMsgs;
+    std::map<RsGxsGroupId, PartialItem> mPartialGrps;
+};
+
 /*!
  * This represents a transaction made
  * with the NxsNetService in all states
@@ -54,6 +142,8 @@ public:
 
     uint32_t mFlag; // current state of transaction
     uint32_t mTimeOut;
+    uint64_t mStartTime; // monotonic creation time in microseconds, used for sync statistics
+    uint32_t mNbReceived; // items received so far for incoming transactions, fragments included
 
     /*!
      * this contains who we
@@ -65,6 +155,8 @@ public:
      */
     RsNxsTransacItem* mTransaction;
     std::list<RsNxsItem*> mItems; // items received or sent
+
+    NxsFragmentAssembler *mAssembler; // created on the first received fragment
 };
 
 /*!
@@ -29,6 +29,7 @@
  */
 
 #include "retroshare/rsids.h"
+#include "retroshare/rsturtle.h"
 
 class RsGxsNotify
 {
@@ -108,3 +109,17 @@ struct RsGxsMsgDeletedChange : RsGxsNotify
 
 	const RsGxsMessageId messageId;
 };
+
+/*!
+ * Relevant to distant search results, mGroupId is the group found
+ */
+struct RsGxsDistantSearchResultChange : RsGxsNotify
+{
+	RsGxsDistantSearchResultChange(
+	        TurtleRequestId reqId, const RsGxsGroupId& gid ):
+	    RsGxsNotify(gid), mRequestId(reqId) {}
+
+	NotifyType getType() override { return TYPE_RECEIVED_DISTANT_SEARCH_RESULTS; }
+
+	const TurtleRequestId mRequestId;
+};
@@ -21,6 +21,9 @@
  *                                                                             *
  *******************************************************************************/
 
+#include <algorithm>
+#include <chrono>
+
 #include "util/rstime.h"
 
 #include "rsgxsutil.h"
@@ -34,6 +37,14 @@
 // happen anyway, but we still conduct these test as an extra safety measure.
 
 static const uint32_t MAX_GXS_IDS_REQUESTS_NET   =  10 ; // max number of requests from cache/net (avoids killing the system!)
+static const uint32_t MSG_META_PAGE_SIZE         = 1000 ; // msg metas loaded at once, bounds the memory used by cleanup and checks
+
+// The integrity check re-hashes the stored data by slices, resuming where the previous pass stopped, so that a pass
+// never costs more than a bounded amount of CPU and disk, whatever the size of the database.
+
+static const uint64_t INTEGRITY_CHECK_MAX_BYTES_PER_PASS = 32 * 1024 * 1024 ; // data hashed before the pass stops
+static const uint64_t INTEGRITY_CHECK_MAX_BYTES_PER_SEC  =  4 * 1024 * 1024 ; // disk bandwidth given to the check
+static const uint32_t INTEGRITY_CHECK_MSG_BATCH_SIZE     = 128 ;              // messages loaded at once
 
 // #define DEBUG_GXSUTIL 1
 
@@ -87,84 +98,17 @@ bool RsGxsCleanUp::clean(RsGxsGroupId& next_group_to_check,std::vector<RsGxsGrou
 #endif
             grps_to_delete.push_back(grpMeta.mGroupId);
         }
-        else
+        else if(!(grpMeta.mSubscribeFlags & GXS_SERV::GROUP_SUBSCRIBE_SUBSCRIBED) || (grpMeta.mSubscribeFlags & GXS_SERV::GROUP_SUBSCRIBE_NOT_SUBSCRIBED))
         {
-            const RsGxsGroupId& grpId = grpMeta.mGroupId;
-            GxsMsgReq req;
-            GxsMsgMetaResult result;
-
-            req[grpId] = std::set<RsGxsMessageId>();
-            mDs->retrieveGxsMsgMetaData(req, result);
-
-            GxsMsgMetaResult::iterator mit = result.begin();
-
-#ifdef DEBUG_GXSUTIL
-            GXSUTIL_DEBUG() << "  Cleaning up messages for group ID " << grpId << std::endl;
-#endif
-            uint32_t store_period = mGenExchangeClient->getStoragePeriod(grpId) ;
-
-            for(; mit != result.end(); ++mit)
-            {
-                auto& metaV = mit->second;
-
-                // First, make a map of which message have a child message. This allows to only delete messages that dont have child messages.
-                // A more accurate way to go would be to compute the time of the oldest message and possibly delete all the branch, but in the
-                // end the message tree will be deleted slice after slice, which should still be reasonnably fast.
-                //
-                std::set<RsGxsMessageId> messages_with_kids ;
-                std::set<RsGxsMessageId> messages_old_versions ;
-
-                for( uint32_t i=0;i<metaV.size();++i)
-                    if(!metaV[i]->mParentId.isNull())
-                        messages_with_kids.insert(metaV[i]->mParentId) ;
-
-                for( uint32_t i=0;i<metaV.size();++i)
-                    if(!metaV[i]->mOrigMsgId.isNull() && metaV[i]->mOrigMsgId != metaV[i]->mMsgId)	// in some situations, mOrigMsgId is initialized, but equal to the sgId itself
-                        messages_old_versions.insert(metaV[i]->mOrigMsgId) ;
-
-                for( uint32_t i=0;i<metaV.size();++i)
-                {
-                    const auto& meta = metaV[i];
-
-                    bool have_kids = (messages_with_kids.find(meta->mMsgId)!=messages_with_kids.end());
-
-                    // Check if expired
-                    bool remove = store_period > 0 && ((meta->mPublishTs + store_period) < now) && !have_kids;
-
-                    // Check client does not want the message kept regardless of age
-                    remove = remove && !(meta->mMsgStatus & GXS_SERV::GXS_MSG_STATUS_KEEP_FOREVER);
-
-                    // If not subscribed remove messages (can optimise this really)
-                    remove = remove ||  (grpMeta.mSubscribeFlags & GXS_SERV::GROUP_SUBSCRIBE_NOT_SUBSCRIBED);
-                    remove = remove || !(grpMeta.mSubscribeFlags & GXS_SERV::GROUP_SUBSCRIBE_SUBSCRIBED);
-
-#ifdef DEBUG_GXSUTIL
-                    GXSUTIL_DEBUG() << "    msg id " << meta->mMsgId << " in grp " << grpId << ": keep_flag=" << bool(meta->mMsgStatus & GXS_SERV::GXS_MSG_STATUS_KEEP_FOREVER)
-                                    << " subscribed: " << bool(grpMeta.mSubscribeFlags & GXS_SERV::GROUP_SUBSCRIBE_SUBSCRIBED) << " store_period: " << store_period
-                                    << " kids: " << have_kids << " now - meta->mPublishTs: " << now - meta->mPublishTs ;
-#endif
-                    // Only keep old messages if the client service asks for it.
+            // If not subscribed remove all messages. Only ids are needed for that.
 
-                    if(!mGenExchangeClient->keepOldMsgVersions() && messages_old_versions.find(meta->mMsgId)!=messages_old_versions.end())
-                    {
-                        std::cerr << "*********  Removing old messsage version " << meta->mMsgId << " because the service allows it." << std::endl;
-                        remove = true;
-                    }
+            RsGxsMessageId::std_set msgIds;
 
-                    if( remove )
-                    {
-                        messages_to_delete[grpId].insert(meta->mMsgId);
-#ifdef DEBUG_GXSUTIL
-                        std::cerr << "    Scheduling for removal." << std::endl;
-#endif
-                    }
-#ifdef DEBUG_GXSUTIL
-                    else
-                        std::cerr << std::endl;
-#endif
-                }
-            }
+            if(mDs->retrieveMsgIds(grpMeta.mGroupId, msgIds) == 1 && !msgIds.empty())
+                messages_to_delete[grpMeta.mGroupId].insert(msgIds.begin(), msgIds.end());
         }
+        else
+            cleanGroupMessages(grpMeta, now, messages_to_delete);
 
         ++it;
 
@@ -201,23 +145,275 @@ bool RsGxsCleanUp::clean(RsGxsGroupId& next_group_to_check,std::vector<RsGxsGrou
     return full_round;
 }
 
+void RsGxsCleanUp::cleanGroupMessages(const RsGxsGrpMetaData& grpMeta, rstime_t now, GxsMsgReq& messages_to_delete)
+{
+    const RsGxsGroupId& grpId = grpMeta.mGroupId;
+
+#ifdef DEBUG_GXSUTIL
+    GXSUTIL_DEBUG() << "  Cleaning up messages for group ID " << grpId << std::endl;
+#endif
+    uint32_t store_period = mGenExchangeClient->getStoragePeriod(grpId) ;
+
+    // Only delete messages that dont have child messages. A more accurate way to go would be to compute the time of the
+    // oldest message and possibly delete all the branch, but in the end the message tree will be deleted slice after slice,
+    // which should still be reasonnably fast.
+
+    std::set<RsGxsMessageId> messages_with_kids ;
+    std::set<RsGxsMessageId> messages_old_versions ;
+
+    if(mDs->retrieveMsgReferences(grpId, messages_with_kids, messages_old_versions) != 1)
+        return;
+
+    if(store_period > 0 && now > (rstime_t)store_period + 1)
+    {
+        // Only load the expired messages. They are selected using the (group, publish time) index.
+
+        RsGxsMsgMetaFilter filter;
+        filter.mGrpId = grpId;
+        filter.mMaxPublishTs = now - store_period - 1;
+
+        uint64_t cursor = 0;
+
+        do
+        {
+            std::vector<std::shared_ptr<RsGxsMsgMetaData> > metaV;
+
+            if(mDs->retrieveGxsMsgMetaDataPage(filter, cursor, MSG_META_PAGE_SIZE, metaV) != 1)
+                break;
+
+            for(const auto& meta: metaV)
+            {
+                bool have_kids = (messages_with_kids.find(meta->mMsgId)!=messages_with_kids.end());
+
+                // Check client does not want the message kept regardless of age
+                bool remove = !have_kids && !(meta->mMsgStatus & GXS_SERV::GXS_MSG_STATUS_KEEP_FOREVER);
+
+#ifdef DEBUG_GXSUTIL
+                GXSUTIL_DEBUG() << "    msg id " << meta->mMsgId << " in grp " << grpId << ": keep_flag=" << bool(meta->mMsgStatus & GXS_SERV::GXS_MSG_STATUS_KEEP_FOREVER)
+                                << " store_period: " << store_period << " kids: " << have_kids << " now - meta->mPublishTs: " << now - meta->mPublishTs << std::endl;
+#endif
+                if( remove )
+                    messages_to_delete[grpId].insert(meta->mMsgId);
+            }
+        }
+        while(cursor != 0);
+    }
+
+    // Only keep old messages if the client service asks for it.
+
+    if(!mGenExchangeClient->keepOldMsgVersions() && !messages_old_versions.empty())
+    {
+        RsGxsMessageId::std_set msgIds;
+        mDs->retrieveMsgIds(grpId, msgIds);
+
+        for(const auto& msgId: messages_old_versions)
+            if(msgIds.find(msgId) != msgIds.end())
+            {
+                std::cerr << "*********  Removing old messsage version " << msgId << " because the service allows it." << std::endl;
+                messages_to_delete[grpId].insert(msgId);
+            }
+    }
+}
+
 RsGxsIntegrityCheck::RsGxsIntegrityCheck(
         RsGeneralDataService* const dataService, RsGenExchange* genex,
-        RsSerialType&, RsGixs* gixs )
+        RsSerialType&, RsGixs* gixs, const RsGxsGrpMsgIdPair& startPosition )
   : mDs(dataService), mGenExchangeClient(genex),
-    mDone(false), mIntegrityMutex("integrity"), mGixs(gixs) {}
+    mDone(false), mIntegrityMutex("integrity"), mNextPosition(startPosition),
+    mMaxBytesPerPass(INTEGRITY_CHECK_MAX_BYTES_PER_PASS), mGixs(gixs) {}
+
+void RsGxsIntegrityCheck::setMaxBytesPerPass(uint64_t bytes)
+{
+	RS_STACK_MUTEX(mIntegrityMutex);
+	mMaxBytesPerPass = bytes;
+}
 
 void RsGxsIntegrityCheck::run()
 {
-	std::vector<RsGxsGroupId> grps_to_delete;
-	GxsMsgReq msgs_to_delete;
+	{
+		RS_STACK_MUTEX(mIntegrityMutex);
+		mProgress.mStartTS = time(NULL);
+	}
+
+	hashCheck();
 
-    check(mGenExchangeClient->serviceType(), mGixs, mDs);
+	// Keeping alive the ids used by subscribed groups needs the identity service
+	if(!shouldStop() && mGixs)
+		check(mGenExchangeClient->serviceType(), mGixs, mDs);
 
 	RS_STACK_MUTEX(mIntegrityMutex);
+	mProgress.mEndTS = time(NULL);
 	mDone = true;
 }
 
+/*!
+ * Hashes the data of the given messages and reports the ones that don't match the stored hash.
+ * Hashing is done in the calling thread: reads are throttled far below what a single core can hash.
+ * @return number of bytes hashed
+ */
+static uint64_t hashMessages(const std::vector<RsNxsMsg*>& msgs, std::vector<uint8_t>& valid)
+{
+    valid.assign(msgs.size(), false);
+    uint64_t bytes = 0;
+
+    for(uint32_t i=0; i<msgs.size(); ++i)
+    {
+        RsNxsMsg* msg = msgs[i];
+        RsFileHash currHash;
+        pqihash pHash;
+        pHash.addData(msg->msg.bin_data, msg->msg.bin_len);
+        pHash.Complete(currHash);
+
+        valid[i] = (msg->metaData != NULL && currHash == msg->metaData->mHash);
+        bytes += msg->msg.bin_len;
+    }
+
+    return bytes;
+}
+
+bool RsGxsIntegrityCheck::hashCheck()
+{
+    std::vector<RsGxsGroupId> grpIds;
+
+    if(mDs->retrieveGroupIds(grpIds) != 1)
+        return false;
+
+    std::sort(grpIds.begin(), grpIds.end());
+
+    RsGxsGrpMsgIdPair start;
+    uint64_t max_bytes;
+
+    {
+        RS_STACK_MUTEX(mIntegrityMutex);
+        mProgress.mGrpsTotal = grpIds.size();
+        start = mNextPosition;
+        max_bytes = mMaxBytesPerPass;
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    uint64_t bytes_hashed = 0;
+
+    // Resume at the position left by the previous pass. Ids are sorted, so groups added since then are checked in the same round.
+
+    auto git = std::lower_bound(grpIds.begin(), grpIds.end(), start.first);
+
+    if(git == grpIds.end() || *git != start.first)
+        start.second.clear();
+
+    for(; git != grpIds.end(); ++git, start.second.clear())
+    {
+        const RsGxsGroupId& grpId = *git;
+
+        if(start.second.isNull())	// the group itself is checked when starting it
+        {
+            RsNxsGrpDataTemporaryMap grps;
+            grps[grpId] = NULL;
+            mDs->retrieveNxsGrps(grps, true);
+
+            RsNxsGrp* grp = grps[grpId];
+
+            if(!grp)
+                continue;
+
+            RsFileHash currHash;
+            pqihash pHash;
+            pHash.addData(grp->grp.bin_data, grp->grp.bin_len);
+            pHash.Complete(currHash);
+
+            bytes_hashed += grp->grp.bin_len;
+
+            if(grp->metaData == NULL || currHash != grp->metaData->mHash)
+            {
+                RS_WARN( "deleting group ", grpId,
+                         " with wrong hash or null/corrupted meta data. meta=",
+                         grp->metaData );
+
+                RS_STACK_MUTEX(mIntegrityMutex);
+                mDeletedGrps.push_back(grpId);
+                ++mProgress.mGrpsChecked;
+                continue;
+            }
+        }
+
+        RsGxsMessageId::std_set msgIds;
+
+        if(mDs->retrieveMsgIds(grpId, msgIds) != 1)
+            continue;
+
+        for(auto mit = msgIds.lower_bound(start.second); mit != msgIds.end();)
+        {
+            if(shouldStop() || bytes_hashed >= max_bytes)
+            {
+                RS_STACK_MUTEX(mIntegrityMutex);
+                mNextPosition = RsGxsGrpMsgIdPair(grpId, *mit);
+                return false;
+            }
+
+            GxsMsgReq req;
+            std::set<RsGxsMessageId>& batch(req[grpId]);
+
+            for(; mit != msgIds.end() && batch.size() < INTEGRITY_CHECK_MSG_BATCH_SIZE; ++mit)
+                batch.insert(*mit);
+
+            RsNxsMsgDataTemporaryMap msgs;
+            mDs->retrieveNxsMsgs(req, msgs, true);
+
+            std::vector<RsNxsMsg*>& msgV = msgs[grpId];
+            msgV.erase(std::remove(msgV.begin(), msgV.end(), (RsNxsMsg*)NULL), msgV.end());
+
+            std::vector<uint8_t> valid;
+            bytes_hashed += hashMessages(msgV, valid);
+
+            {
+                RS_STACK_MUTEX(mIntegrityMutex);
+
+                for(uint32_t i=0; i<msgV.size(); ++i)
+                {
+                    batch.erase(msgV[i]->msgId);
+
+                    if(!valid[i])
+                    {
+                        RS_WARN( "deleting message ", msgV[i]->msgId, " in group ", grpId,
+                                 " with wrong hash or null/corrupted meta data. meta=",
+                                 static_cast<void*>(msgV[i]->metaData) );
+                        mDeletedMsgs[grpId].insert(msgV[i]->msgId);
+                    }
+                }
+
+                // Ids that are in the database but whose data could not be read.
+                for(const auto& msgId: batch)
+                {
+                    RS_WARN( "deleting message ", msgId, " in group ", grpId, " with unreadable data." );
+                    mDeletedMsgs[grpId].insert(msgId);
+                }
+
+                mProgress.mMsgsChecked += msgV.size();
+                mProgress.mBytesHashed = bytes_hashed;
+            }
+
+            // Limit the disk bandwidth: sleep until the time the data read so far should have taken.
+
+            auto min_duration = std::chrono::milliseconds(bytes_hashed * 1000 / INTEGRITY_CHECK_MAX_BYTES_PER_SEC);
+            auto elapsed = std::chrono::steady_clock::now() - start_time;
+
+            if(elapsed < min_duration)
+                rstime::rs_usleep(std::chrono::duration_cast<std::chrono::microseconds>(min_duration - elapsed).count());
+        }
+
+        RS_STACK_MUTEX(mIntegrityMutex);
+        ++mProgress.mGrpsChecked;
+    }
+
+    // Full round done. Next pass starts from the beginning.
+
+    RS_STACK_MUTEX(mIntegrityMutex);
+    mNextPosition = RsGxsGrpMsgIdPair();
+    mProgress.mBytesHashed = bytes_hashed;
+    mProgress.mFullRound = true;
+
+    return true;
+}
+
 bool RsGxsIntegrityCheck::check(uint16_t service_type, RsGixs *mgixs, RsGeneralDataService *mds)
 {
 #ifdef DEBUG_GXSUTIL
@@ -228,65 +424,53 @@ bool RsGxsIntegrityCheck::check(uint16_t service_type, RsGixs *mgixs, RsGeneralD
 
     mds->retrieveGxsGrpMetaData(grp);
 
-    GxsMsgReq msgIds;
-
     std::map<RsGxsId,RsIdentityUsage> used_gxs_ids ;
-    std::set<RsGxsGroupId> subscribed_groups ;
-
-    // Check that message ids...
 
     for( auto git = grp.begin(); git != grp.end(); ++git )
     {
             const auto& grpMeta = git->second;
 
-            if (mds->retrieveMsgIds(grpMeta->mGroupId, msgIds[grpMeta->mGroupId]) == 1)
-            {
-                    if(grpMeta->mSubscribeFlags & GXS_SERV::GROUP_SUBSCRIBE_SUBSCRIBED)
-                    {
-                            subscribed_groups.insert(git->first);
+            if(!(grpMeta->mSubscribeFlags & GXS_SERV::GROUP_SUBSCRIBE_SUBSCRIBED))
+                    continue;
 
-                            if(!grpMeta->mAuthorId.isNull())
-                            {
+            if(!grpMeta->mAuthorId.isNull())
+            {
 #ifdef DEBUG_GXSUTIL
-                                    GXSUTIL_DEBUG() << "TimeStamping group authors' key ID " << grpMeta->mAuthorId << " in group ID " << grpMeta->mGroupId << std::endl;
+                    GXSUTIL_DEBUG() << "TimeStamping group authors' key ID " << grpMeta->mAuthorId << " in group ID " << grpMeta->mGroupId << std::endl;
 #endif
-                                    if( rsReputations && rsReputations->overallReputationLevel( grpMeta->mAuthorId ) > RsReputationLevel::LOCALLY_NEGATIVE )
-                                            used_gxs_ids.insert(std::make_pair(grpMeta->mAuthorId, RsIdentityUsage(RsServiceType(service_type), RsIdentityUsage::GROUP_AUTHOR_KEEP_ALIVE,grpMeta->mGroupId)));
-                            }
-                    }
+                    if( rsReputations && rsReputations->overallReputationLevel( grpMeta->mAuthorId ) > RsReputationLevel::LOCALLY_NEGATIVE )
+                            used_gxs_ids.insert(std::make_pair(grpMeta->mAuthorId, RsIdentityUsage(RsServiceType(service_type), RsIdentityUsage::GROUP_AUTHOR_KEEP_ALIVE,grpMeta->mGroupId)));
             }
-            else
-                    msgIds.erase(msgIds.find(grpMeta->mGroupId));	// could not get them, so group is removed from list.
-    }
 
-    // now messages
-    GxsMsgMetaResult msgMetas;
+            // now messages, by pages so that memory use does not depend on the size of the group
 
-    mds->retrieveGxsMsgMetaData(msgIds, msgMetas);
+            RsGxsMsgMetaFilter filter;
+            filter.mGrpId = grpMeta->mGroupId;
+            uint64_t cursor = 0;
 
-    for(auto mit=msgMetas.begin(); mit != msgMetas.end(); ++mit)
-	{
-        const auto& msgM = mit->second;
+            do
+            {
+                std::vector<std::shared_ptr<RsGxsMsgMetaData> > msgM;
 
-        for(auto vit=msgM.begin(); vit != msgM.end(); ++vit)
-		{
-            const auto& meta = *vit;
+                if(mds->retrieveGxsMsgMetaDataPage(filter, cursor, MSG_META_PAGE_SIZE, msgM) != 1)
+                    break;
 
-            if (subscribed_groups.count(meta->mGroupId))
-                if(!meta->mAuthorId.isNull())
-				{
+                for(const auto& meta: msgM)
+                    if(!meta->mAuthorId.isNull())
+                    {
 #ifdef DEBUG_GXSUTIL
-                    GXSUTIL_DEBUG() << "TimeStamping message authors' key ID " << meta->mAuthorId << " in message " << meta->mMsgId << ", group ID " << meta->mGroupId<< std::endl;
+                        GXSUTIL_DEBUG() << "TimeStamping message authors' key ID " << meta->mAuthorId << " in message " << meta->mMsgId << ", group ID " << meta->mGroupId<< std::endl;
 #endif
-                    if( rsReputations && rsReputations->overallReputationLevel( meta->mAuthorId ) > RsReputationLevel::LOCALLY_NEGATIVE )
-                        used_gxs_ids.insert(std::make_pair(meta->mAuthorId,RsIdentityUsage(RsServiceType(service_type),
-                                                                                                    RsIdentityUsage::MESSAGE_AUTHOR_KEEP_ALIVE,
-                                                                                                    meta->mGroupId,
-                                                                                                    meta->mMsgId,
-                                                                                                    meta->mParentId,
-                                                                                                    meta->mThreadId))) ;
-				}
-	    }
+                        if( rsReputations && rsReputations->overallReputationLevel( meta->mAuthorId ) > RsReputationLevel::LOCALLY_NEGATIVE )
+                            used_gxs_ids.insert(std::make_pair(meta->mAuthorId,RsIdentityUsage(RsServiceType(service_type),
+                                                                                                        RsIdentityUsage::MESSAGE_AUTHOR_KEEP_ALIVE,
+                                                                                                        meta->mGroupId,
+                                                                                                        meta->mMsgId,
+                                                                                                        meta->mParentId,
+                                                                                                        meta->mThreadId))) ;
+                    }
+            }
+            while(cursor != 0);
     }
 
 	{
@@ -465,6 +649,18 @@ bool RsGxsIntegrityCheck::isDone()
 	return mDone;
 }
 
+RsGxsGrpMsgIdPair RsGxsIntegrityCheck::nextPosition()
+{
+	RS_STACK_MUTEX(mIntegrityMutex);
+	return mNextPosition;
+}
+
+void RsGxsIntegrityCheck::getProgress(RsGxsIntegrityCheckProgress& progress)
+{
+	RS_STACK_MUTEX(mIntegrityMutex);
+	progress = mProgress;
+}
+
 void RsGxsIntegrityCheck::getDeletedIds(std::vector<RsGxsGroupId>& grpIds, GxsMsgReq& msgIds)
 {
 	RS_STACK_MUTEX(mIntegrityMutex);
@@ -148,14 +148,39 @@ public:
 
 private:
 
+    /*!
+     * Selects expired messages and old message versions of a subscribed group.
+     * Only the expired messages meta data is loaded.
+     */
+    void cleanGroupMessages(const RsGxsGrpMetaData& grpMeta, rstime_t now, GxsMsgReq& messages_to_delete);
+
     RsGeneralDataService* const mDs;
     RsGenExchange *mGenExchangeClient;
     uint32_t CHUNK_SIZE;
 };
 
+/*!
+ * Progress of an integrity check pass
+ */
+struct RsGxsIntegrityCheckProgress
+{
+    RsGxsIntegrityCheckProgress() : mGrpsTotal(0), mGrpsChecked(0), mMsgsChecked(0), mBytesHashed(0),
+        mStartTS(0), mEndTS(0), mFullRound(false) {}
+
+    uint32_t mGrpsTotal;
+    uint32_t mGrpsChecked;
+    uint32_t mMsgsChecked;
+    uint64_t mBytesHashed;
+    rstime_t mStartTS;
+    rstime_t mEndTS;
+    bool mFullRound;	// all groups were checked since the start position
+};
+
 /*!
  * Checks the integrity message and groups
- * in rsDataService using computed hash
+ * in rsDataService using computed hash.
+ * Each pass hashes a bounded amount of data, starting at the position where
+ * the previous pass stopped, and keeps alive the ids used by subscribed groups.
  */
 class RsGxsIntegrityCheck : public RsThread
 {
@@ -165,7 +190,7 @@ class RsGxsIntegrityCheck : public RsThread
 public:
 	RsGxsIntegrityCheck( RsGeneralDataService* const dataService,
 	                     RsGenExchange* genex, RsSerialType&,
-	                     RsGixs* gixs );
+	                     RsGixs* gixs, const RsGxsGrpMsgIdPair& startPosition = RsGxsGrpMsgIdPair() );
 
     static bool check(uint16_t service_type, RsGixs *mgixs, RsGeneralDataService *mds);
     bool isDone();
@@ -174,14 +199,35 @@ public:
 
     void getDeletedIds(std::vector<RsGxsGroupId> &grpIds, GxsMsgReq &msgIds);
 
+    /*!
+     * @return position the next pass should start from, null when the pass went through all groups
+     */
+    RsGxsGrpMsgIdPair nextPosition();
+
+    void getProgress(RsGxsIntegrityCheckProgress& progress);
+
+    /*!
+     * Changes the amount of data hashed before a pass stops. Must be called before start()
+     */
+    void setMaxBytesPerPass(uint64_t bytes);
+
 private:
 
+    /*!
+     * Hashes groups and messages data from mNextPosition on, until the pass budget is spent
+     * @return true if the end of the store was reached
+     */
+    bool hashCheck();
+
     RsGeneralDataService* const mDs;
     RsGenExchange *mGenExchangeClient;
     bool mDone;
     RsMutex mIntegrityMutex;
     std::vector<RsGxsGroupId> mDeletedGrps;
     GxsMsgReq mDeletedMsgs;
+    RsGxsGrpMsgIdPair mNextPosition;
+    uint64_t mMaxBytesPerPass;
+    RsGxsIntegrityCheckProgress mProgress;
 
     RsGixs* mGixs;
 };
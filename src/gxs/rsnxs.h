@@ -227,6 +227,20 @@ public:
      */
     virtual bool getGroupNetworkStats(const RsGxsGroupId& grpId,RsGroupNetworkStats& stats)=0;
 
+    /*!
+     * Runtime sync metrics of the service (counters and latency histograms),
+     * collected only when enabled
+     */
+    virtual bool getNetworkStatistics(RsGxsNetStatistics& /*stats*/) { return false; }
+    virtual void setNetworkStatisticsEnabled(bool /*enabled*/) {}
+
+    /*!
+     * Position where the integrity check of the service resumes hashing, saved
+     * with the service config so that it survives restarts
+     */
+    virtual bool getIntegrityCheckPosition(RsGxsGrpMsgIdPair& /*position*/) { return false; }
+    virtual void setIntegrityCheckPosition(const RsGxsGrpMsgIdPair& /*position*/) {}
+
     virtual void subscribeStatusChanged(const RsGxsGroupId& id,bool subscribed) =0;
 
     /*!
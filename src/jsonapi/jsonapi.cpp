@@ -25,9 +25,13 @@
 #include <memory>
 #include <typeinfo>
 #include <vector>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
 
 #include <restbed>
 #include <openssl/crypto.h>
+#include <rapidjson/writer.h>
 
 
 #include "jsonapi.h"
@@ -100,13 +104,126 @@ JsonApiServer::corsOptionsHeaders =
 	    jAns.AddMember(kcd, jReq[kcd], jAns.GetAllocator())
 
 #define DEFAULT_API_CALL_JSON_RETURN(RET_CODE) \
-	std::stringstream ss; \
-	ss << jAns; \
-	std::string&& ans(ss.str()); \
-	auto headers = corsHeaders; \
-	headers.insert({ "Content-Type", "application/json" }); \
-	headers.insert({ "Content-Length", std::to_string(ans.length()) }); \
-	session->close(RET_CODE, ans, headers)
+	sendJsonAnswer(session, RET_CODE, jAns)
+
+/**
+ * rapidjson output stream which writes the answer straight to the client.
+ * Small answers are sent in one piece with Content-Length, as soon as the
+ * answer grows past JsonApiServer::STREAMING_CHUNK_SIZE it switches to HTTP
+ * chunked transfer encoding, so large lists (forum messages, file lists,
+ * identities...) don't have to be rendered into a single string first and the
+ * client starts receiving data while the rest is still being serialized.
+ */
+class JsonApiChunkedStream
+{
+public:
+	typedef char Ch;
+
+	JsonApiChunkedStream(
+	        const std::shared_ptr<rb::Session>& session, int status,
+	        const std::multimap<std::string, std::string>& headers,
+	        bool keepAlive ) :
+	    mSession(session), mStatus(status), mHeaders(headers),
+	    mKeepAlive(keepAlive), mChunked(false)
+	{ mBuffer.reserve(JsonApiServer::STREAMING_CHUNK_SIZE); }
+
+	void Put(char c)
+	{
+		mBuffer.push_back(c);
+		if(mBuffer.size() >= JsonApiServer::STREAMING_CHUNK_SIZE) sendChunk();
+	}
+
+	void Flush() {}
+
+	/// Send what is left of the answer and terminate it
+	void finish()
+	{
+		if(!mChunked)
+		{
+			mHeaders.insert({ "Content-Length", std::to_string(mBuffer.size()) });
+			if(mKeepAlive) mSession->yield(mStatus, mBuffer, mHeaders);
+			else mSession->close(mStatus, mBuffer, mHeaders);
+			return;
+		}
+
+		std::string last = encodeChunk();
+		last += "0\r\n\r\n";
+
+		// yield without callback hands the connection back to the router
+		if(mKeepAlive) mSession->yield(last);
+		else mSession->close(last);
+	}
+
+private:
+	std::string encodeChunk()
+	{
+		std::string chunk;
+		if(mBuffer.empty()) return chunk;
+
+		char len[20];
+		snprintf(len, sizeof(len), "%zx\r\n", mBuffer.size());
+		chunk.reserve(mBuffer.size() + 32);
+		chunk += len;
+		chunk += mBuffer;
+		chunk += "\r\n";
+		mBuffer.clear();
+		return chunk;
+	}
+
+	void sendChunk()
+	{
+		/* Intermediate writes must pass a callback, otherwise restbed would
+		 * start reading the next request before this answer is complete */
+		const auto noop = [](const std::shared_ptr<rb::Session>) {};
+
+		if(!mChunked)
+		{
+			mChunked = true;
+			mHeaders.insert({ "Transfer-Encoding", "chunked" });
+			mSession->yield(mStatus, encodeChunk(), mHeaders, noop);
+		}
+		else mSession->yield(encodeChunk(), noop);
+	}
+
+	const std::shared_ptr<rb::Session>& mSession;
+	int mStatus;
+	std::multimap<std::string, std::string> mHeaders;
+	bool mKeepAlive;
+	bool mChunked;
+	std::string mBuffer;
+};
+
+/*static*/ bool JsonApiServer::clientWantsKeepAlive(
+        const std::shared_ptr<rb::Session>& session )
+{
+	const auto& request = session->get_request();
+
+	std::string connection = request->get_header("Connection");
+	std::transform( connection.begin(), connection.end(), connection.begin(),
+	                [](unsigned char c){ return std::tolower(c); } );
+
+	if(connection == "close") return false;
+	if(connection == "keep-alive") return true;
+
+	// HTTP/1.1 connections are persistent unless otherwise specified
+	return request->get_version() >= 1.1;
+}
+
+/*static*/ void JsonApiServer::sendJsonAnswer(
+        const std::shared_ptr<rb::Session>& session, int status,
+        const RsJson& jAns )
+{
+	const bool keepAlive = clientWantsKeepAlive(session);
+
+	auto headers = corsHeaders;
+	headers.insert({ "Content-Type", "application/json" });
+	headers.insert({ "Connection", keepAlive ? "keep-alive" : "close" });
+
+	JsonApiChunkedStream stream(session, status, headers, keepAlive);
+	rapidjson::Writer<JsonApiChunkedStream> writer(stream);
+	jAns.Accept(writer);
+	stream.finish();
+}
 
 
 /*static*/ bool JsonApiServer::checkRsServicePtrReady(
@@ -159,6 +276,7 @@ JsonApiServer::JsonApiServer(): configMutex("JsonApiServer config"),
     mService(nullptr),
     mListeningPort(RsJsonApi::DEFAULT_PORT),
     mBindingAddress(RsJsonApi::DEFAULT_BINDING_ADDRESS),
+    mWorkerLimit(RsJsonApi::DEFAULT_WORKER_LIMIT),
     mRestartReqTS(0)
 {
 #if defined(RS_THREAD_FORCE_STOP) && defined(RS_JSONAPI_DEBUG_SERVICE_STOP)
@@ -775,13 +893,20 @@ void JsonApiServer::setListeningPort(uint16_t p) { mListeningPort = p; }
 void JsonApiServer::setBindingAddress(const std::string& bindAddress)
 { mBindingAddress = bindAddress; }
 std::string JsonApiServer::getBindingAddress() const { return mBindingAddress; }
+void JsonApiServer::setWorkerLimit(uint32_t workers) { mWorkerLimit = workers; }
+uint32_t JsonApiServer::workerLimit() const { return mWorkerLimit; }
 
 void JsonApiServer::run()
 {
 	auto settings = std::make_shared<restbed::Settings>();
 	settings->set_port(mListeningPort);
 	settings->set_bind_address(mBindingAddress);
-	settings->set_default_header("Connection", "close");
+
+	/* Answers set the Connection header themselves, see sendJsonAnswer(), so
+	 * clients polling many endpoints can reuse the same connection */
+	uint32_t workers = mWorkerLimit;
+	if(!workers) workers = RsThread::hardwareConcurrency();
+	settings->set_worker_limit(workers);
 
 	auto tService = std::make_shared<restbed::Service>();
 
@@ -792,7 +917,8 @@ void JsonApiServer::run()
 		RsUrl apiUrl; apiUrl.setScheme("http").setHost(mBindingAddress)
 		        .setPort(mListeningPort);
 		RsInfo() << __PRETTY_FUNCTION__ << " JSON API server listening on "
-		         << apiUrl.toString() << std::endl;
+		         << apiUrl.toString() << " with " << workers << " workers"
+		         << std::endl;
 
 		/* re-allocating mService is important because it deletes the existing
 		 * service and therefore leaves the listening port open */
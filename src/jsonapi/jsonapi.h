@@ -33,6 +33,7 @@
 #include <atomic>
 
 #include "util/rsthreads.h"
+#include "util/rsjson.h"
 #include "pqi/p3cfgmgr.h"
 #include "rsitems/rsitem.h"
 #include "jsonapi/jsonapiitems.h"
@@ -87,6 +88,12 @@ public:
 	/// @see RsJsonApi
 	uint16_t listeningPort() const override;
 
+	/// @see RsJsonApi
+	void setWorkerLimit(uint32_t workers) override;
+
+	/// @see RsJsonApi
+	uint32_t workerLimit() const override;
+
 	/// @see RsJsonApi
 	void connectToConfigManager(p3ConfigMgr& cfgmgr) override;
 
@@ -181,6 +188,21 @@ private:
 	static const std::multimap<std::string, std::string> corsOptionsHeaders;
 	static void handleCorsOptions(const std::shared_ptr<rb::Session> session);
 
+	/// Answers bigger than this are sent with chunked transfer encoding
+	constexpr static size_t STREAMING_CHUNK_SIZE = 64*1024;
+	friend class JsonApiChunkedStream;
+
+	/**
+	 * Serialize the answer directly to the client, keeping the connection
+	 * open for further requests unless the client asked otherwise
+	 */
+	static void sendJsonAnswer(
+	        const std::shared_ptr<rb::Session>& session, int status,
+	        const RsJson& jAns );
+
+	static bool clientWantsKeepAlive(
+	        const std::shared_ptr<rb::Session>& session );
+
 	static bool checkRsServicePtrReady(
 	        const void* serviceInstance, const std::string& serviceName,
 	        RsGenericSerializer::SerializeContext& ctx,
@@ -213,6 +235,7 @@ private:
 
 	uint16_t mListeningPort;
 	std::string mBindingAddress;
+	uint32_t mWorkerLimit;
 
 	/// @see unProtectedRestart()
     rstime_t mRestartReqTS;
@@ -46,6 +46,11 @@ file_lists {
 			file_sharing/filelist_io.h \
 			file_sharing/directory_storage.h \
 			file_sharing/directory_updater.h \
+			file_sharing/directory_watcher.h \
+			file_sharing/directory_scanner.h \
+			file_sharing/dir_sync_batch.h \
+			file_sharing/flat_hash_index.h \
+			file_sharing/file_list_image.h \
 			file_sharing/rsfilelistitems.h \
 			file_sharing/dir_hierarchy.h \
 			file_sharing/file_sharing_defaults.h
@@ -55,6 +60,11 @@ file_lists {
 			file_sharing/filelist_io.cc \
 			file_sharing/directory_storage.cc \
 			file_sharing/directory_updater.cc \
+			file_sharing/directory_watcher.cc \
+			file_sharing/directory_scanner.cc \
+			file_sharing/dir_sync_batch.cc \
+			file_sharing/flat_hash_index.cc \
+			file_sharing/file_list_image.cc \
 			file_sharing/dir_hierarchy.cc \
 			file_sharing/file_tree.cc \
 			file_sharing/rsfilelistitems.cc
@@ -490,6 +500,10 @@ HEADERS +=	util/folderiterator.h \
 			util/argstream.h \
 			util/rsdiscspace.h \
 			util/rsnet.h \
+			util/rsiptrie.h \
+			util/rsmpscqueue.h \
+			util/rsprofiler.h \
+			util/rssnapshot.h \
 			util/extaddrfinder.h \
 			util/dnsresolver.h \
                         util/radix32.h \
@@ -647,6 +661,8 @@ SOURCES +=	util/folderiterator.cc \
 			util/rsdiscspace.cc \
 			util/rsnet.cc \
 			util/rsnet_ss.cc \
+			util/rsiptrie.cc \
+			util/rsprofiler.cc \
 			util/rsdnsutils.cc \
 			util/extaddrfinder.cc \
 			util/dnsresolver.cc \
@@ -704,6 +720,8 @@ HEADERS += rsitems/rsnxsitems.h \
 	gxs/rsgxsdataaccess.h \
 	gxs/gxstokenqueue.h \
 	gxs/rsgxsnetutils.h \
+	gxs/rsgxsnetstats.h \
+	gxs/rsgxschangesbatcher.h \
 	gxs/rsgxsrequesttypes.h
 
 
@@ -721,6 +739,8 @@ SOURCES += rsitems/rsnxsitems.cc \
 	gxs/rsgxsdata.cc \
 	gxs/gxstokenqueue.cc \
 	gxs/rsgxsnetutils.cc \
+	gxs/rsgxsnetstats.cc \
+	gxs/rsgxschangesbatcher.cc \
 	gxs/rsgxsutil.cc \
         gxs/rsgxsrequesttypes.cc \
         gxs/rsnxsobserver.cpp
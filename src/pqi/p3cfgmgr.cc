@@ -29,9 +29,17 @@
 #include <rsserver/p3face.h>
 #include <util/rsdiscspace.h>
 #include "util/rsstring.h"
+#include "util/rsrandom.h"
+#include "util/rsprint.h"
+#include "util/rsmemory.h"
+#include "crypto/rsaes.h"
+#include "serialiser/rsbaseserial.h"
 
 #include "rsitems/rsconfigitems.h"
 
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
 /*
 #define CONFIG_DEBUG 1
 */
@@ -169,11 +177,21 @@ void    p3ConfigMgr::completeConfiguration()
 
 
 p3Config::p3Config()
-	:pqiConfig()
+	:pqiConfig(), mJournalMtx("p3ConfigJournal"), mJournalEnabled(false),
+	mJournalBroken(false), mJournalMaxSize(0), mJournalFile(NULL),
+	mJournalSize(0), mJournalSeq(0), mJournalSerialiser(NULL)
 {
 	return;
 }
 
+p3Config::~p3Config()
+{
+	RsStackMutex stack(mJournalMtx); /***** LOCK STACK MUTEX ****/
+
+	locked_closeJournal();
+	delete mJournalSerialiser;
+}
+
 
 bool p3Config::loadConfiguration(RsFileHash& /* loadHash */)
 {
@@ -239,7 +257,10 @@ bool p3Config::loadConfig()
 
 
 	if(pass)
+	{
 		loadList(load);
+		loadJournal();
+	}
 	else
 		return false;
 
@@ -339,6 +360,7 @@ bool p3Config::saveConfig()
 	pqiSSLstore *stream = new pqiSSLstore(setupSerialiser(), RsPeerId(), cfg_bio, stream_flags);
 
 	written = written && stream->encryptedSendItems(toSave);
+	bool items_written = written;
 
 	if(!written)
 		std::cerr << "(EE) Error while writing config file " << Filename() << ": file dropped!!" << std::endl;
@@ -377,7 +399,9 @@ bool p3Config::saveConfig()
 
 	// now rewrite current files to temp files
 	// rename back-up to current file
-	if(!RsDirUtil::renameFile(newCfgFname, cfgFname)  || !RsDirUtil::renameFile(newSignFname, signFname)){
+	bool replaced = RsDirUtil::renameFile(newCfgFname, cfgFname) && RsDirUtil::renameFile(newSignFname, signFname);
+
+	if(!replaced){
 	#ifdef CONFIG_DEBUG
 				std::cerr << "p3Config::() Failed to rename meta files: " << std::endl
 						<< newCfgFname << " to " << cfgFname << std::endl
@@ -388,6 +412,9 @@ bool p3Config::saveConfig()
 			}
 
 
+	// the journal is now part of the config file. This must happen before saveDone() so that
+	// no change can be journaled in between.
+	resetJournal(replaced && items_written);
 
 	saveDone(); // callback to inherited class to unlock any Mutexes protecting saveList() data
 
@@ -396,6 +423,434 @@ bool p3Config::saveConfig()
 }
 
 
+/************************ INCREMENTAL CONFIGURATION ********************/
+
+// Layout of the journal file (config file name + ".jnl"):
+//
+//   header : magic | hash of the config file it applies to | key envelope | signature
+//   record : size | salt | AES(operation + serialised items) | HMAC
+//
+// The envelope holds the AES and HMAC keys encrypted with our own SSL key, and the header
+// is signed just like the config file, so only we can start a journal. Each record HMAC
+// also covers the previous HMAC and the record number, so records cannot be dropped or
+// reordered, except for a truncated tail, which is what a crash during a write leaves.
+// A journal whose hash does not match the loaded config file is stale and ignored.
+
+static const uint32_t CONFIG_JOURNAL_MAGIC     = 0x52534a31 ; // "RSJ1"
+static const uint32_t CONFIG_JOURNAL_AES_SIZE  = 16 ;
+static const uint32_t CONFIG_JOURNAL_MAC_SIZE  = 20 ;
+static const uint32_t CONFIG_JOURNAL_SALT_SIZE = 8 ;
+
+void p3Config::enableConfigJournal(uint32_t maxSize)
+{
+	RsStackMutex stack(mJournalMtx); /***** LOCK STACK MUTEX ****/
+
+	mJournalEnabled = true;
+	mJournalMaxSize = maxSize;
+}
+
+bool p3Config::loadDelta(uint8_t op, std::list<RsItem *>& items)
+{
+	if(op == CONFIG_JOURNAL_ADD)
+		return loadList(items);
+
+	for(std::list<RsItem *>::iterator it = items.begin(); it != items.end(); ++it)
+		delete *it;
+
+	items.clear();
+	return false;
+}
+
+bool p3Config::journalConfigItems(const std::list<RsItem *>& items, uint8_t op)
+{
+	bool compact = false;
+	{
+		RsStackMutex stack(mJournalMtx); /***** LOCK STACK MUTEX ****/
+
+		if(!mJournalEnabled || mJournalBroken)
+			return false;
+
+		if(!mJournalFile && !locked_createJournal())
+		{
+			// typically no config file saved yet. The next full save clears this.
+			mJournalBroken = true;
+			return false;
+		}
+
+		if(!mJournalSerialiser)
+			mJournalSerialiser = setupSerialiser();
+
+		uint32_t plain_size = 1;
+		for(std::list<RsItem *>::const_iterator it = items.begin(); it != items.end(); ++it)
+			plain_size += mJournalSerialiser->size(*it);
+
+		RsTemporaryMemory plain(plain_size);
+		uint32_t offset = 1;
+		plain[0] = op;
+
+		for(std::list<RsItem *>::const_iterator it = items.begin(); it != items.end(); ++it)
+		{
+			uint32_t size = plain_size - offset;
+
+			if(!mJournalSerialiser->serialise(*it, plain + offset, &size))
+			{
+				RsErr() << "Cannot serialise item for config journal of " << Filename();
+				return false;
+			}
+			offset += size;
+		}
+
+		uint32_t enc_size = RsAES::get_buffer_size(plain_size);
+		RsTemporaryMemory record(4 + CONFIG_JOURNAL_SALT_SIZE + enc_size + CONFIG_JOURNAL_MAC_SIZE);
+		uint8_t *salt = record + 4;
+
+		RSRandom::random_bytes(salt, CONFIG_JOURNAL_SALT_SIZE);
+
+		if(!RsAES::aes_crypt_8_16(plain, plain_size, mJournalKeys, salt, salt + CONFIG_JOURNAL_SALT_SIZE, enc_size))
+		{
+			RsErr() << "Cannot encrypt config journal record for " << Filename();
+			return false;
+		}
+
+		uint32_t record_size = 4 + CONFIG_JOURNAL_SALT_SIZE + enc_size + CONFIG_JOURNAL_MAC_SIZE;
+		uint8_t *mac = salt + CONFIG_JOURNAL_SALT_SIZE + enc_size;
+
+		offset = 0;
+		setRawUInt32(record, record_size, &offset, record_size - 4);
+
+		if(!locked_journalMac(mJournalSeq, salt, CONFIG_JOURNAL_SALT_SIZE + enc_size, mac))
+			return false;
+
+		if(fwrite(record, 1, record_size, mJournalFile) != record_size || fflush(mJournalFile) != 0)
+		{
+			// the journal may now end with a partial record: stop appending to it.
+			RsErr() << "Cannot write config journal for " << Filename() << ": " << strerror(errno);
+			locked_closeJournal();
+			mJournalBroken = true;
+			return false;
+		}
+
+		memcpy(mJournalMac, mac, CONFIG_JOURNAL_MAC_SIZE);
+		++mJournalSeq;
+		mJournalSize += record_size;
+
+		compact = mJournalSize > mJournalMaxSize;
+	}
+
+	// fold the journal back into the config file on the next periodic save
+	if(compact)
+		IndicateConfigChanged(RsConfigMgr::CheckPriority::SAVE_LESS);
+
+	return true;
+}
+
+bool p3Config::locked_journalMac(uint32_t seq, const uint8_t *data, uint32_t len, uint8_t *mac)
+{
+	RsTemporaryMemory mem(CONFIG_JOURNAL_MAC_SIZE + 4 + len);
+	uint32_t offset = CONFIG_JOURNAL_MAC_SIZE;
+
+	memcpy(mem, mJournalMac, CONFIG_JOURNAL_MAC_SIZE);
+	setRawUInt32(mem, mem.size(), &offset, seq);
+	memcpy(mem + offset, data, len);
+
+	unsigned int md_len = CONFIG_JOURNAL_MAC_SIZE;
+	return NULL != HMAC(EVP_sha1(), mJournalKeys + CONFIG_JOURNAL_AES_SIZE, CONFIG_JOURNAL_MAC_SIZE, mem, mem.size(), mac, &md_len);
+}
+
+bool p3Config::locked_createJournal()
+{
+	RsFileHash base(Hash());
+
+	if(base.isNull())	// nothing to apply the journal on yet
+		return false;
+
+	RSRandom::random_bytes(mJournalKeys, sizeof(mJournalKeys));
+	memset(mJournalMac, 0, sizeof(mJournalMac));
+	mJournalSeq = 0;
+
+	void *envelope = NULL;
+	int envelope_len = 0;
+
+	if(!encryptJournalKeys(envelope, envelope_len, mJournalKeys, sizeof(mJournalKeys)) || envelope_len <= 0)
+	{
+		RsErr() << "Cannot encrypt config journal keys for " << Filename();
+		return false;
+	}
+
+	uint32_t signed_size = 4 + RsFileHash::SIZE_IN_BYTES + 4 + envelope_len;
+	std::vector<uint8_t> header(signed_size);
+	uint32_t offset = 0;
+
+	setRawUInt32(header.data(), signed_size, &offset, CONFIG_JOURNAL_MAGIC);
+	memcpy(&header[offset], base.toByteArray(), RsFileHash::SIZE_IN_BYTES);
+	offset += RsFileHash::SIZE_IN_BYTES;
+	setRawUInt32(header.data(), signed_size, &offset, envelope_len);
+	memcpy(&header[offset], envelope, envelope_len);
+	free(envelope);
+
+	std::string signature;
+	RsFileHash digest = RsDirUtil::sha1sum(header.data(), signed_size);
+
+	if(!signJournal(digest, signature))
+	{
+		RsErr() << "Cannot sign config journal for " << Filename();
+		return false;
+	}
+
+	header.resize(signed_size + 4 + signature.length());
+	offset = signed_size;
+	setRawUInt32(header.data(), header.size(), &offset, signature.length());
+	memcpy(&header[offset], signature.c_str(), signature.length());
+
+	std::string fname = Filename() + ".jnl";
+	mJournalFile = RsDirUtil::rs_fopen(fname.c_str(), "wb");
+
+	if(!mJournalFile)
+	{
+		RsErr() << "Cannot create config journal " << fname << ": " << strerror(errno);
+		return false;
+	}
+
+	if(fwrite(header.data(), 1, header.size(), mJournalFile) != header.size() || fflush(mJournalFile) != 0)
+	{
+		RsErr() << "Cannot write config journal " << fname;
+		locked_closeJournal();
+		return false;
+	}
+
+	mJournalSize = header.size();
+	return true;
+}
+
+bool p3Config::encryptJournalKeys(void*& out, int& outlen, const void* in, int inlen)
+{
+	return AuthSSL::getAuthSSL()->encrypt(out, outlen, in, inlen, AuthSSL::getAuthSSL()->OwnId());
+}
+
+bool p3Config::decryptJournalKeys(void*& out, int& outlen, const void* in, int inlen)
+{
+	return AuthSSL::getAuthSSL()->decrypt(out, outlen, in, inlen);
+}
+
+bool p3Config::signJournal(const RsFileHash& digest, std::string& signature)
+{
+	return AuthSSL::getAuthSSL()->SignData(digest.toByteArray(), digest.SIZE_IN_BYTES, signature);
+}
+
+bool p3Config::verifyJournal(const RsFileHash& digest, unsigned char *signature, unsigned int signature_len)
+{
+	return AuthSSL::getAuthSSL()->VerifyOwnSignBin(digest.toByteArray(), RsFileHash::SIZE_IN_BYTES, signature, signature_len);
+}
+
+void p3Config::locked_closeJournal()
+{
+	if(mJournalFile)
+		fclose(mJournalFile);
+
+	mJournalFile = NULL;
+	mJournalSize = 0;
+}
+
+void p3Config::resetJournal(bool saved)
+{
+	std::string fname = Filename() + ".jnl";
+
+	RsStackMutex stack(mJournalMtx); /***** LOCK STACK MUTEX ****/
+
+	if(!mJournalEnabled)
+		return;
+
+	locked_closeJournal();
+
+	if(!saved)
+	{
+		// keep the journal: it still applies to the previous config file.
+		mJournalBroken = true;
+		return;
+	}
+
+	if(RsDirUtil::fileExists(fname))
+		RsDirUtil::removeFile(fname);
+
+	// a new journal, bound to the config file just written, is started on the next change
+	mJournalBroken = false;
+}
+
+bool p3Config::loadJournal()
+{
+	std::string fname = Filename() + ".jnl";
+	RsFileHash base(Hash());
+
+	std::list<std::pair<uint8_t, std::list<RsItem *> > > deltas;
+	{
+		RsStackMutex stack(mJournalMtx); /***** LOCK STACK MUTEX ****/
+
+		locked_closeJournal();
+
+		if(!mJournalEnabled)
+			return true;
+
+		FILE *f = RsDirUtil::rs_fopen(fname.c_str(), "rb");
+
+		if(!f)
+			return true;	// nothing was journaled since the last full save
+
+		std::vector<uint8_t> data;
+		uint8_t buf[4096];
+		size_t n;
+
+		while((n = fread(buf, 1, sizeof(buf), f)) > 0)
+			data.insert(data.end(), buf, buf + n);
+
+		fclose(f);
+
+		uint32_t size = data.size();
+		uint32_t offset = 0;
+		uint32_t magic = 0;
+		uint32_t envelope_len = 0;
+		uint32_t signature_len = 0;
+
+		if(!getRawUInt32(data.data(), size, &offset, &magic) || magic != CONFIG_JOURNAL_MAGIC || size < offset + RsFileHash::SIZE_IN_BYTES)
+		{
+			RsWarn() << "Config journal " << fname << " is corrupted. Ignoring it.";
+			return false;
+		}
+
+		if(memcmp(&data[offset], base.toByteArray(), RsFileHash::SIZE_IN_BYTES))
+		{
+			std::cerr << "(II) config journal " << fname << " does not apply to the loaded config file. Ignoring it." << std::endl;
+			return true;
+		}
+		offset += RsFileHash::SIZE_IN_BYTES;
+
+		if(!getRawUInt32(data.data(), size, &offset, &envelope_len) || envelope_len > size - offset)
+		{
+			RsWarn() << "Config journal " << fname << " is corrupted. Ignoring it.";
+			return false;
+		}
+
+		uint8_t *envelope = &data[offset];
+		offset += envelope_len;
+		uint32_t signed_size = offset;
+
+		if(!getRawUInt32(data.data(), size, &offset, &signature_len) || signature_len > size - offset || signature_len < 2)
+		{
+			RsWarn() << "Config journal " << fname << " is corrupted. Ignoring it.";
+			return false;
+		}
+
+		RsTemporaryMemory signature(signature_len/2);
+		RsFileHash digest = RsDirUtil::sha1sum(data.data(), signed_size);
+
+		if(!RsUtil::HexToBin(std::string((char*)&data[offset], signature_len), signature, signature.size())
+		        || !verifyJournal(digest, signature, signature.size()))
+		{
+			RsErr() << "Wrong signature on config journal " << fname << ". Ignoring it.";
+			return false;
+		}
+		offset += signature_len;
+
+		void *keys = NULL;
+		int keys_len = 0;
+
+		if(!decryptJournalKeys(keys, keys_len, envelope, envelope_len) || keys_len != (int)sizeof(mJournalKeys))
+		{
+			RsErr() << "Cannot decrypt config journal keys in " << fname << ". Ignoring it.";
+			free(keys);
+			return false;
+		}
+		memcpy(mJournalKeys, keys, sizeof(mJournalKeys));
+		free(keys);
+
+		memset(mJournalMac, 0, sizeof(mJournalMac));
+		mJournalSeq = 0;
+
+		if(!mJournalSerialiser)
+			mJournalSerialiser = setupSerialiser();
+
+		bool clean = true;
+
+		while(offset < size)
+		{
+			uint32_t record_size = 0;
+
+			if(!getRawUInt32(data.data(), size, &offset, &record_size) || record_size > size - offset
+			        || record_size <= CONFIG_JOURNAL_SALT_SIZE + CONFIG_JOURNAL_MAC_SIZE)
+			{
+				clean = false;
+				break;
+			}
+
+			uint8_t *salt = &data[offset];
+			uint32_t enc_size = record_size - CONFIG_JOURNAL_SALT_SIZE - CONFIG_JOURNAL_MAC_SIZE;
+			uint8_t mac[CONFIG_JOURNAL_MAC_SIZE];
+
+			if(!locked_journalMac(mJournalSeq, salt, CONFIG_JOURNAL_SALT_SIZE + enc_size, mac)
+			        || memcmp(mac, salt + CONFIG_JOURNAL_SALT_SIZE + enc_size, CONFIG_JOURNAL_MAC_SIZE))
+			{
+				clean = false;
+				break;
+			}
+
+			RsTemporaryMemory plain(RsAES::get_buffer_size(enc_size));
+			uint32_t plain_size = plain.size();
+
+			if(!RsAES::aes_decrypt_8_16(salt + CONFIG_JOURNAL_SALT_SIZE, enc_size, mJournalKeys, salt, plain, plain_size) || plain_size < 1)
+			{
+				clean = false;
+				break;
+			}
+
+			std::list<RsItem *> items;
+
+			for(uint32_t poffset = 1; poffset < plain_size;)
+			{
+				uint32_t item_size = plain_size - poffset;
+				RsItem *item = mJournalSerialiser->deserialise(plain + poffset, &item_size);
+
+				if(!item)
+				{
+					RsWarn() << "Cannot deserialise item in config journal " << fname;
+					break;
+				}
+				items.push_back(item);
+				poffset += item_size;
+			}
+
+			deltas.push_back(std::make_pair(plain[0], items));
+
+			memcpy(mJournalMac, mac, CONFIG_JOURNAL_MAC_SIZE);
+			++mJournalSeq;
+			offset += record_size;
+		}
+
+		if(clean)
+		{
+			// keep appending to the same journal
+			mJournalFile = RsDirUtil::rs_fopen(fname.c_str(), "ab");
+			mJournalSize = size;
+
+			if(!mJournalFile)
+				mJournalBroken = true;
+		}
+		else
+		{
+			RsWarn() << "Config journal " << fname << " ends with an incomplete record after " << deltas.size()
+			         << " records. Changes will be saved in full until the next config save.";
+			mJournalBroken = true;
+		}
+	}
+
+	std::cerr << "(II) replaying " << deltas.size() << " journaled changes of config file " << fname << std::endl;
+
+	// outside of the journal mutex: loadDelta() takes the service mutexes
+	for(auto it = deltas.begin(); it != deltas.end(); ++it)
+		if(!loadDelta(it->first, it->second))
+			RsWarn() << "Could not apply journaled change to " << fname;
+
+	return true;
+}
+
 /**************************** CONFIGURATION CLASSES ********************/
 
 p3GeneralConfig::p3GeneralConfig()
@@ -219,10 +219,15 @@ class p3Config : public pqiConfig
 {
 public:
 	p3Config();
+	virtual ~p3Config();
 
 	virtual bool loadConfiguration(RsFileHash &loadHash);
 	virtual bool saveConfiguration();
 
+	/// operations recorded in the config journal, see journalConfigItems()
+	static const uint8_t CONFIG_JOURNAL_ADD    = 0x01;
+	static const uint8_t CONFIG_JOURNAL_REMOVE = 0x02;
+
 protected:
 
 	/// Key Functions to be overloaded for Full Configuration
@@ -250,6 +255,58 @@ protected:
 	 */
 	virtual void saveDone() {}
 
+	/**
+	 * Switches on incremental saving. Derived classes may then record small
+	 * changes with journalConfigItems() rather than rewriting the whole
+	 * configuration: items are appended, encrypted and authenticated, to a
+	 * journal next to the config file, and replayed through loadDelta()
+	 * after the configuration is loaded. The next full save folds the
+	 * journal back into the config file; one is requested automatically
+	 * once the journal grows past maxSize bytes.
+	 * That compaction is an ordinary full save at SAVE_LESS priority: it
+	 * runs from p3ConfigMgr::tick() on the RsServer tick thread, within the
+	 * hour, and blocks that tick like any other full save. The journal only
+	 * makes it happen once per maxSize bytes of changes instead of once per
+	 * change.
+	 * Services using this must keep their mutex locked from saveList() to
+	 * saveDone() (cleanup = false) and call journalConfigItems() under the
+	 * same mutex, so that no change falls between a full save and the
+	 * journal reset.
+	 */
+	void enableConfigJournal(uint32_t maxSize = 4*1024*1024);
+
+	/**
+	 * Appends a change to the journal. Items stay owned by the caller.
+	 * @param op CONFIG_JOURNAL_ADD or CONFIG_JOURNAL_REMOVE, passed back to
+	 *   loadDelta() on replay
+	 * @return false if the journal is disabled or unusable, in which case
+	 *   the caller should fall back to IndicateConfigChanged()
+	 */
+	bool journalConfigItems(const std::list<RsItem *>& items, uint8_t op = CONFIG_JOURNAL_ADD);
+
+	/**
+	 * replays one journal record. The default handles CONFIG_JOURNAL_ADD by
+	 * calling loadList(), services journaling removals must override it.
+	 * @param items deserialised items, ownership passes to the callee
+	 */
+	virtual bool loadDelta(uint8_t op, std::list<RsItem *>& items);
+
+	/**
+	 * replays the journal on top of the loaded configuration, called by
+	 * loadConfiguration() once the config file is loaded.
+	 */
+	bool loadJournal();
+
+	/**
+	 * Journal crypto: the record keys are encrypted to our own certificate
+	 * and the journal header is signed with it, just like the config file.
+	 * Only overridden in tests, where no certificate is loaded.
+	 */
+	virtual bool encryptJournalKeys(void*& out, int& outlen, const void* in, int inlen);
+	virtual bool decryptJournalKeys(void*& out, int& outlen, const void* in, int inlen);
+	virtual bool signJournal(const RsFileHash& digest, std::string& signature);
+	virtual bool verifyJournal(const RsFileHash& digest, unsigned char *signature, unsigned int signature_len);
+
 private:
 
 	bool loadConfig();
@@ -257,6 +314,23 @@ private:
 
 	bool loadAttempt( const std::string&, const std::string&,
 	                  std::list<RsItem *>& load );
+
+	void resetJournal(bool saved);
+	bool locked_createJournal();
+	void locked_closeJournal();
+	bool locked_journalMac(uint32_t seq, const uint8_t *data, uint32_t len, uint8_t *mac);
+
+	RsMutex mJournalMtx; /* below is protected */
+
+	bool     mJournalEnabled;
+	bool     mJournalBroken;	// needs a full save before journaling again
+	uint32_t mJournalMaxSize;
+	FILE    *mJournalFile;
+	uint64_t mJournalSize;
+	uint32_t mJournalSeq;
+	uint8_t  mJournalKeys[36];	// AES key (16 bytes) + HMAC key (20 bytes)
+	uint8_t  mJournalMac[20];	// last record HMAC, chains the records
+	RsSerialiser *mJournalSerialiser;
 }; // end of p3Config
 
 
@@ -19,6 +19,8 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
  *                                                                             *
  *******************************************************************************/
+#include <set>
+
 #include "util/rstime.h"
 
 #include "p3historymgr.h"
@@ -49,6 +51,8 @@ p3HistoryMgr::p3HistoryMgr()
     , mLastCleanTime(0)
     , mHistoryMtx("p3HistoryMgr")
 {
+	// new messages are appended to a journal instead of rewriting the whole history
+	enableConfigJournal();
 }
 
 p3HistoryMgr::~p3HistoryMgr()
@@ -145,12 +149,7 @@ void p3HistoryMgr::addMessage(const ChatMessage& cm)
 			else 
 				limit = mPrivateSaveCount;
 
-			if (limit) {
-				while (mit->second.size() > limit) {
-					delete(mit->second.begin()->second);
-					mit->second.erase(mit->second.begin());
-				}
-			}
+			locked_applySaveCount(mit->second, limit);
 		} else {
 			std::map<uint32_t, RsHistoryMsgItem*> msgs;
 			item->msgId = nextMsgId++;
@@ -161,7 +160,11 @@ void p3HistoryMgr::addMessage(const ChatMessage& cm)
 			// no need to check the limit
 		}
 
-		IndicateConfigChanged();
+		std::list<RsItem*> delta;
+		delta.push_back(item);
+
+		if (!journalConfigItems(delta))
+			IndicateConfigChanged();
 	}
 
 	if (addMsgId) {
@@ -223,6 +226,27 @@ void p3HistoryMgr::cleanOldMessages()
 		IndicateConfigChanged() ;
 }
 
+// lobby ids only fill the first bytes of the virtual peer id, see chatIdToVirtualPeerId()
+static bool isLobbyVirtualPeerId(const RsPeerId& peer_id)
+{
+	for (uint32_t i = sizeof(ChatLobbyId); i < RsPeerId::SIZE_IN_BYTES; ++i)
+		if (peer_id.toByteArray()[i] != 0)
+			return false;
+
+	return !peer_id.isNull();
+}
+
+void p3HistoryMgr::locked_applySaveCount(std::map<uint32_t, RsHistoryMsgItem*>& msgs, uint32_t limit)
+{
+	if (!limit)
+		return;
+
+	while (msgs.size() > limit) {
+		delete(msgs.begin()->second);
+		msgs.erase(msgs.begin());
+	}
+}
+
 /***** p3Config *****/
 
 RsSerialiser* p3HistoryMgr::setupSerialiser()
@@ -404,6 +428,44 @@ bool p3HistoryMgr::loadList(std::list<RsItem*>& load)
 	return true;
 }
 
+bool p3HistoryMgr::loadDelta(uint8_t op, std::list<RsItem*>& items)
+{
+	if (op != CONFIG_JOURNAL_ADD)
+		return p3Config::loadDelta(op, items);
+
+	std::set<RsPeerId> chats;
+	for (std::list<RsItem*>::iterator it = items.begin(); it != items.end(); ++it) {
+		RsHistoryMsgItem *msgItem = dynamic_cast<RsHistoryMsgItem*>(*it);
+		if (msgItem)
+			chats.insert(msgItem->chatPeerId);
+	}
+
+	if (!loadList(items))
+		return false;
+
+	// journaled messages were appended one by one: the save counts were
+	// applied in memory when they arrived, but not in the journal.
+	RsStackMutex stack(mHistoryMtx); /********** STACK LOCKED MTX ******/
+
+	for (std::set<RsPeerId>::const_iterator cit = chats.begin(); cit != chats.end(); ++cit) {
+		std::map<RsPeerId, std::map<uint32_t, RsHistoryMsgItem*> >::iterator mit = mMessages.find(*cit);
+		if (mit == mMessages.end())
+			continue;
+
+		uint32_t limit;
+		if (cit->isNull())
+			limit = mPublicSaveCount;
+		else if (isLobbyVirtualPeerId(*cit))
+			limit = mLobbySaveCount;
+		else
+			limit = mPrivateSaveCount;
+
+		locked_applySaveCount(mit->second, limit);
+	}
+
+	return true;
+}
+
 // have to convert to virtual peer id, to be able to use existing serialiser and file format
 bool p3HistoryMgr::chatIdToVirtualPeerId(const ChatId& chat_id, RsPeerId &peer_id)
 {
@@ -548,7 +610,8 @@ void p3HistoryMgr::clear(const ChatId &chatId)
 		mit->second.clear();
 		mMessages.erase(mit);
 
-		IndicateConfigChanged();
+		// save soon, so that journaled messages do not come back after a crash
+		IndicateConfigChanged(RsConfigMgr::CheckPriority::SAVE_OFTEN);
 	}
 
 	RsServer::notify()->notifyHistoryChanged(0, NOTIFY_TYPE_MOD);
@@ -595,7 +658,8 @@ void p3HistoryMgr::removeMessages(const std::list<uint32_t> &msgIds)
 
 	if (!removedIds.empty())
 	{
-		IndicateConfigChanged();
+		// save soon, so that journaled messages do not come back after a crash
+		IndicateConfigChanged(RsConfigMgr::CheckPriority::SAVE_OFTEN);
 
 		for (iit = removedIds.begin(); iit != removedIds.end(); ++iit)
 			RsServer::notify()->notifyHistoryChanged(*iit, NOTIFY_TYPE_DEL);
@@ -67,6 +67,7 @@ public:
 	virtual bool saveList(bool& cleanup, std::list<RsItem*>& saveData);
 	virtual void saveDone();
 	virtual bool loadList(std::list<RsItem*>& load);
+	virtual bool loadDelta(uint8_t op, std::list<RsItem*>& items);
 
 	static bool chatIdToVirtualPeerId(const ChatId& chat_id, RsPeerId& peer_id);
 
@@ -79,6 +80,9 @@ private:
 	//
 	void cleanOldMessages() ;
 
+	// Drops the oldest messages of a chat above the save count of its type.
+	void locked_applySaveCount(std::map<uint32_t, RsHistoryMsgItem*>& msgs, uint32_t limit);
+
 	bool mPublicEnable;
 	bool mLobbyEnable;
 	bool mPrivateEnable;
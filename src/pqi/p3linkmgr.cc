@@ -186,20 +186,8 @@ bool p3LinkMgrIMPL::getLocalAddress(struct sockaddr_storage &addr)
 
 bool    p3LinkMgrIMPL::isOnline(const RsPeerId &ssl_id)
 {
-	RsStackMutex stack(mLinkMtx); /****** STACK LOCK MUTEX *******/
-
-        std::map<RsPeerId, peerConnectState>::iterator it;
-	it = mFriendList.find(ssl_id);
-	if (it == mFriendList.end())
-	{
-		return false;
-	}
-
-	if (it->second.state & RS_PEER_S_CONNECTED)
-	{
-		return true;
-	}
-	return false;
+	RsSnapshot<std::set<RsPeerId> >::Reader online(mOnlineSnapshot);
+	return online->find(ssl_id) != online->end();
 }
 
 
@@ -226,17 +214,18 @@ uint32_t p3LinkMgrIMPL::getLinkType(const RsPeerId &ssl_id)
 
 void    p3LinkMgrIMPL::getOnlineList(std::list<RsPeerId> &ssl_peers)
 {
-	RsStackMutex stack(mLinkMtx); /****** STACK LOCK MUTEX *******/
+	RsSnapshot<std::set<RsPeerId> >::Reader online(mOnlineSnapshot);
+	ssl_peers.insert(ssl_peers.end(), online->begin(), online->end());
+}
 
-        std::map<RsPeerId, peerConnectState>::iterator it;
-	for(it = mFriendList.begin(); it != mFriendList.end(); ++it)
-	{
-		if (it->second.state & RS_PEER_S_CONNECTED)
-		{
-			ssl_peers.push_back(it->first);
-		}
-	}
-	return;
+void    p3LinkMgrIMPL::locked_publishOnlineSnapshot()
+{
+	std::set<RsPeerId> online;
+	for(auto& it : mFriendList)
+		if (it.second.state & RS_PEER_S_CONNECTED)
+			online.insert(online.end(), it.first);
+
+	mOnlineSnapshot.publish(std::move(online));
 }
 
 void    p3LinkMgrIMPL::getFriendList(std::list<RsPeerId> &ssl_peers)
@@ -874,6 +863,7 @@ bool p3LinkMgrIMPL::connectResult(const RsPeerId &id, bool success, bool isIncom
 			/* change state */
 			it->second.state |= RS_PEER_S_CONNECTED;
 			it->second.actions |= RS_PEER_CONNECTED;
+			locked_publishOnlineSnapshot();
 			it->second.connecttype = flags;
 			it->second.connectaddr = remote_peer_address;
 
@@ -938,6 +928,7 @@ bool p3LinkMgrIMPL::connectResult(const RsPeerId &id, bool success, bool isIncom
 			{
 				it->second.state &= (~RS_PEER_S_CONNECTED);
 				it->second.actions |= RS_PEER_DISCONNECTED;
+				locked_publishOnlineSnapshot();
 				mStatusChanged = true;
 
 				updateLastContact = true; /* time of disconnect */
@@ -2102,6 +2093,7 @@ int p3LinkMgrIMPL::removeFriend(const RsPeerId &id)
 		mStatusChanged = true;
 		
 		mFriendList.erase(it);
+		locked_publishOnlineSnapshot();
 	}
 		
 	mNetMgr->netAssistFriend(id, false);
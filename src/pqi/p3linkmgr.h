@@ -30,6 +30,7 @@
 #include "pqi/p3cfgmgr.h"
 
 #include "util/rsthreads.h"
+#include "util/rssnapshot.h"
 
 class ExtAddrFinder ;
 class DNSResolver ;
@@ -312,6 +313,11 @@ private:
 	p3PeerMgrIMPL *mPeerMgr;
 	p3NetMgrIMPL  *mNetMgr;
 
+	void locked_publishOnlineSnapshot();
+
+	/* Connected subset of mFriendList, read without taking mLinkMtx */
+	RsSnapshot<std::set<RsPeerId> > mOnlineSnapshot;
+
 	RsMutex mLinkMtx; /* protects below */
 
         uint32_t mRetryPeriod;
@@ -335,8 +335,8 @@ bool p3PeerMgrIMPL::isFriend(const RsPeerId& id)
 #ifdef PEER_DEBUG_COMMON
                 std::cerr << "p3PeerMgrIMPL::isFriend(" << id << ") called" << std::endl;
 #endif
-		RS_STACK_MUTEX(mPeerMtx);
-        bool ret = (mFriendList.end() != mFriendList.find(id));
+		RsSnapshot<FriendsSnapshot>::Reader snap(mFriendsSnapshot);
+        bool ret = (snap->friends.end() != snap->friends.find(id));
 #ifdef PEER_DEBUG_COMMON
                 std::cerr << "p3PeerMgrIMPL::isFriend(" << id << ") returning : " << ret << std::endl;
 #endif
@@ -347,9 +347,9 @@ bool p3PeerMgrIMPL::isSslOnlyFriend(const RsPeerId& id)
 #ifdef PEER_DEBUG_COMMON
                 std::cerr << "p3PeerMgrIMPL::isFriend(" << id << ") called" << std::endl;
 #endif
-		RS_STACK_MUTEX(mPeerMtx);
-        auto it = mFriendList.find(id);
-        bool ret = it != mFriendList.end() && it->second.skip_pgp_signature_validation ;
+		RsSnapshot<FriendsSnapshot>::Reader snap(mFriendsSnapshot);
+        auto it = snap->friends.find(id);
+        bool ret = it != snap->friends.end() && it->second.sslOnly ;
 
 #ifdef PEER_DEBUG_COMMON
                 std::cerr << "p3PeerMgrIMPL::isFriend(" << id << ") returning : " << ret << std::endl;
@@ -359,12 +359,11 @@ bool p3PeerMgrIMPL::isSslOnlyFriend(const RsPeerId& id)
 
 bool    p3PeerMgrIMPL::getPeerName(const RsPeerId &ssl_id, std::string &name)
 {
-	RS_STACK_MUTEX(mPeerMtx);
+	RsSnapshot<FriendsSnapshot>::Reader snap(mFriendsSnapshot);
 
 	/* check for existing */
-	std::map<RsPeerId, peerState>::iterator it;
-	it = mFriendList.find(ssl_id);
-	if (it == mFriendList.end())
+	auto it = snap->friends.find(ssl_id);
+	if (it == snap->friends.end())
 	{
 		return false;
 	}
@@ -375,17 +374,16 @@ bool    p3PeerMgrIMPL::getPeerName(const RsPeerId &ssl_id, std::string &name)
 
 bool    p3PeerMgrIMPL::getGpgId(const RsPeerId &ssl_id, RsPgpId &gpgId)
 {
-	RsStackMutex stack(mPeerMtx); /****** STACK LOCK MUTEX *******/
+	RsSnapshot<FriendsSnapshot>::Reader snap(mFriendsSnapshot);
 
 	/* check for existing */
-	std::map<RsPeerId, peerState>::iterator it;
-	it = mFriendList.find(ssl_id);
-	if (it == mFriendList.end())
+	auto it = snap->friends.find(ssl_id);
+	if (it == snap->friends.end())
 	{
 		return false;
 	}
 
-	gpgId = it->second.gpg_id;
+	gpgId = it->second.gpgId;
 	return true;
 }
 
@@ -911,7 +909,10 @@ bool p3PeerMgrIMPL::notifyPgpKeyReceived(const RsPgpId& pgp_id)
     }
 
     if(changed)
+    {
+        locked_publishFriendsSnapshot();
         IndicateConfigChanged(RsConfigMgr::CheckPriority::SAVE_NOW);
+    }
 
     return true;
 }
@@ -1039,6 +1040,7 @@ bool p3PeerMgrIMPL::addFriend(const RsPeerId& input_id, const RsPgpId& input_gpg
 		/* addr & timestamps -> auto cleared */
 
 		mFriendList[id] = pstate;
+		locked_publishFriendsSnapshot();
 
 		mStatusChanged = true;
 
@@ -1160,6 +1162,7 @@ bool p3PeerMgrIMPL::addSslOnlyFriend( const RsPeerId& sslId, const RsPgpId& pgp_
 
 	{ RS_STACK_MUTEX(mPeerMtx);
 		mFriendList[sslId] = pstate;
+		locked_publishFriendsSnapshot();
 		mStatusChanged = true;
 	} // RS_STACK_MUTEX(mPeerMtx);
 
@@ -1240,6 +1243,8 @@ bool p3PeerMgrIMPL::removeFriend(const RsPgpId &id)
 		if(it2 != mFriendsPermissionFlags.end())
 			mFriendsPermissionFlags.erase(it2);
 
+		locked_publishFriendsSnapshot();
+
 #ifdef PEER_DEBUG
 		std::cerr << "p3PeerMgrIMPL::removeFriend() new mFriendList.size() : " << mFriendList.size() << std::endl;
 #endif
@@ -1316,6 +1321,8 @@ bool p3PeerMgrIMPL::removeFriend(const RsPeerId &id, bool removePgpId)
 			if (mFriendsPermissionFlags.end() != (it2 = mFriendsPermissionFlags.find(*rit)))
 				mFriendsPermissionFlags.erase(it2);
 
+		locked_publishFriendsSnapshot();
+
 #ifdef PEER_DEBUG
 		std::cerr << "p3PeerMgrIMPL::removeFriend() new mFriendList.size() : " << mFriendList.size() << std::endl;
 #endif
@@ -2092,6 +2099,7 @@ bool    p3PeerMgrIMPL::setLocation(const RsPeerId &id, const std::string &locati
         if (mFriendList.end() != (it = mFriendList.find(id))) {
             if (it->second.location.compare(location) != 0) {
                 it->second.location = location;
+                locked_publishFriendsSnapshot();
                 changed = true;
             }
         }
@@ -2666,6 +2674,8 @@ bool  p3PeerMgrIMPL::loadList(std::list<RsItem *>& load)
 			    else
 				    std::cerr << "   " << sitem->pgp_ids[i] << " - Not a friend!" << std::endl;
 #endif
+
+		    locked_publishFriendsSnapshot();
 	    }
 
 	    delete (*it);
@@ -2987,35 +2997,29 @@ bool p3PeerMgrIMPL::assignPeersToGroup(const RsNodeGroupId &groupId, const std::
 
 ServicePermissionFlags p3PeerMgrIMPL::servicePermissionFlags(const RsPeerId& ssl_id)
 {
-	RsPgpId gpg_id ;
-
-	{
-		RsStackMutex stack(mPeerMtx); /****** STACK LOCK MUTEX *******/
+	RsSnapshot<FriendsSnapshot>::Reader snap(mFriendsSnapshot);
 
-		std::map<RsPeerId, peerState>::const_iterator it = mFriendList.find(ssl_id);
+	auto it = snap->friends.find(ssl_id);
+	if(it == snap->friends.end())
+		return RS_NODE_PERM_DEFAULT ;
 
-		if(it == mFriendList.end())
-            return RS_NODE_PERM_DEFAULT ;
+	auto pit = snap->permissions.find(it->second.gpgId);
+	if(pit == snap->permissions.end())
+		return RS_NODE_PERM_DEFAULT ;
 
-		gpg_id = it->second.gpg_id ;
-	}
-
-	return servicePermissionFlags(gpg_id) ;
+	return pit->second ;
 }
 
 
 ServicePermissionFlags p3PeerMgrIMPL::servicePermissionFlags(const RsPgpId& pgp_id)
 {
-	{
-		RsStackMutex stack(mPeerMtx); /****** STACK LOCK MUTEX *******/
-
-		std::map<RsPgpId,ServicePermissionFlags>::const_iterator it = mFriendsPermissionFlags.find( pgp_id ) ;
+	RsSnapshot<FriendsSnapshot>::Reader snap(mFriendsSnapshot);
 
-		if(it == mFriendsPermissionFlags.end())
-            return RS_NODE_PERM_DEFAULT ;
-		else
-			return it->second ;
-	}
+	auto it = snap->permissions.find(pgp_id);
+	if(it == snap->permissions.end())
+		return RS_NODE_PERM_DEFAULT ;
+	else
+		return it->second ;
 }
 void p3PeerMgrIMPL::setServicePermissionFlags(const RsPgpId& pgp_id, const ServicePermissionFlags& flags)
 {
@@ -3026,9 +3030,27 @@ void p3PeerMgrIMPL::setServicePermissionFlags(const RsPgpId& pgp_id, const Servi
 		//
 
 		mFriendsPermissionFlags[pgp_id] = flags ;
+		locked_publishFriendsSnapshot();
         IndicateConfigChanged(RsConfigMgr::CheckPriority::SAVE_OFTEN); /**** INDICATE MSG CONFIG CHANGED! *****/
 }
 
+void p3PeerMgrIMPL::locked_publishFriendsSnapshot()
+{
+	FriendsSnapshot snap;
+
+	for(auto& it : mFriendList)
+	{
+		FriendsSnapshot::Friend& f(snap.friends[it.first]);
+		f.gpgId = it.second.gpg_id;
+		f.name = it.second.name;
+		f.location = it.second.location;
+		f.sslOnly = it.second.skip_pgp_signature_validation;
+	}
+	snap.permissions = mFriendsPermissionFlags;
+
+	mFriendsSnapshot.publish(std::move(snap));
+}
+
 /**********************************************************************
  **********************************************************************
  ******************** Stuff moved from p3peers ************************
@@ -31,6 +31,7 @@
 #include "pqi/p3cfgmgr.h"
 
 #include "util/rsthreads.h"
+#include "util/rssnapshot.h"
 
 /* RS_VIS_STATE -> specified in rspeers.h
  */
@@ -401,6 +402,27 @@ protected:
     p3NetMgrIMPL  *mNetMgr;
 
 private:
+    /* Read-mostly subset of mFriendList and mFriendsPermissionFlags, lets
+     * the hot lookups made by services and connection handling avoid mPeerMtx.
+     * Must be republished after any change of the mirrored fields. */
+    struct FriendsSnapshot
+    {
+        struct Friend
+        {
+            RsPgpId gpgId;
+            std::string name;
+            std::string location;
+            bool sslOnly;
+        };
+
+        std::map<RsPeerId, Friend> friends;
+        std::map<RsPgpId, ServicePermissionFlags> permissions;
+    };
+
+    void locked_publishFriendsSnapshot();
+
+    RsSnapshot<FriendsSnapshot> mFriendsSnapshot;
+
     RsMutex mPeerMtx; /* protects below */
 
     bool     mStatusChanged;
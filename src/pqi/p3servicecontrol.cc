@@ -19,6 +19,7 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
  *                                                                             *
  *******************************************************************************/
+#include <algorithm>
 #include <iostream>
 
 #include "p3servicecontrol.h"
@@ -86,8 +87,9 @@ RsServiceControl *rsServiceControl = NULL;
 p3ServiceControl::p3ServiceControl(p3LinkMgr *linkMgr)
   : RsServiceControl(), p3Config(),
     mLinkMgr(linkMgr), mOwnPeerId(linkMgr->getOwnId()),
-    mCtrlMtx("p3ServiceControl"), mMonitorMtx("P3ServiceControl::Monitor"),
-    mServiceServer(NULL)
+    mCtrlMtx("p3ServiceControl"),
+    mDefaultDispatchTable(std::make_shared<const ServiceDispatchTable>()),
+    mMonitorMtx("P3ServiceControl::Monitor"), mServiceServer(NULL)
 {
     mSerialiser = new ServiceControlSerialiser ;
 }
@@ -114,7 +116,7 @@ bool p3ServiceControl::getServiceItemNames(uint32_t serviceId,std::map<uint8_t,s
 }
 
 /* Interface for Services */
-bool p3ServiceControl::registerService(const RsServiceInfo &info, bool defaultOn)
+bool p3ServiceControl::registerService(const RsServiceInfo &info, bool defaultOn, pqiService *service)
 {
 	RsStackMutex stack(mCtrlMtx); /***** LOCK STACK MUTEX ****/
 
@@ -143,6 +145,10 @@ bool p3ServiceControl::registerService(const RsServiceInfo &info, bool defaultOn
 	 */
 
 	createDefaultPermissions_locked(info.mServiceType, info.mServiceName, defaultOn);
+
+	mServiceTargets[info.mServiceType] = service;
+	updateAllDispatchTables_locked();
+	publishFilterSnapshot_locked();
 	return true;
 }
 
@@ -164,6 +170,9 @@ bool p3ServiceControl::deregisterService(uint32_t serviceId)
 	std::cerr << std::endl;
 #endif
 	mOwnServices.erase(it);
+	mServiceTargets.erase(serviceId);
+	updateAllDispatchTables_locked();
+	publishFilterSnapshot_locked();
 	return true;
 }
 
@@ -329,6 +338,7 @@ bool p3ServiceControl::updateServicesProvided(const RsPeerId &peerId, const RsPe
 
 	mServicesProvided[peerId] = info;
     updateFilterByPeer_locked(peerId);
+    publishFilterSnapshot_locked();
 
     IndicateConfigChanged() ;
     return true;
@@ -414,6 +424,7 @@ bool p3ServiceControl::updateServicePermissions(uint32_t serviceId, const RsServ
 
 	// This is overkill - but will update everything.
 	updateAllFilters_locked();
+	publishFilterSnapshot_locked();
     IndicateConfigChanged() ;
     return true;
 }
@@ -424,38 +435,27 @@ bool p3ServiceControl::updateServicePermissions(uint32_t serviceId, const RsServ
 /****************************************************************************/
 /****************************************************************************/
 
-// This is the basic system...
-// which will be a little slow (2x maps).
-//
-// Potential improvement is to push the RsPeerFilter
-// to the pqiStreamer, (when items have been sorted by peers already!).
-// but we will do this later.
+// Filters are precomputed into a ServiceDispatchTable for each peer,
+// so this is one map lookup plus a binary search over the services,
+// without taking mCtrlMtx.
 
 bool	p3ServiceControl::checkFilter(uint32_t serviceId, const RsPeerId &peerId)
 {
-	RsStackMutex stack(mCtrlMtx); /***** LOCK STACK MUTEX ****/
-
 #ifdef SERVICECONTROL_DEBUG
 	std::cerr << "p3ServiceControl::checkFilter() ";
 	std::cerr << " ServiceId: " << serviceId;
-#endif
 
-	std::map<uint32_t, RsServiceInfo>::iterator it;
-	it = mOwnServices.find(serviceId);
-	if (it != mOwnServices.end())
-	{
-#ifdef SERVICECONTROL_DEBUG
-		std::cerr << " ServiceName: " << it->second.mServiceName;
-#endif
-	}
-	else
 	{
-#ifdef SERVICECONTROL_DEBUG
-		std::cerr << " ServiceName: Unknown! ";
-#endif
+		RsStackMutex stack(mCtrlMtx); /***** LOCK STACK MUTEX ****/
+
+		std::map<uint32_t, RsServiceInfo>::iterator it;
+		it = mOwnServices.find(serviceId);
+		if (it != mOwnServices.end())
+			std::cerr << " ServiceName: " << it->second.mServiceName;
+		else
+			std::cerr << " ServiceName: Unknown! ";
 	}
 
-#ifdef SERVICECONTROL_DEBUG
 	std::cerr << " PeerId: " << peerId.toStdString();
 	std::cerr << std::endl;
 #endif
@@ -471,50 +471,31 @@ bool	p3ServiceControl::checkFilter(uint32_t serviceId, const RsPeerId &peerId)
 	}
 
 
-	std::map<RsPeerId, ServicePeerFilter>::const_iterator pit;
-	pit = mPeerFilterMap.find(peerId);
-	if (pit == mPeerFilterMap.end())
-	{
-#ifdef SERVICECONTROL_DEBUG
-		std::cerr << "p3ServiceControl::checkFilter() Denied No PeerId";
-		std::cerr << std::endl;
-#endif
-		return false;
-	}
+	RsSnapshot<ServiceFilterSnapshot>::Reader snap(mFilterSnapshot);
+	bool allowed = snap->tableFor(peerId).isAllowed(serviceId);
 
-	if (pit->second.mDenyAll)
-	{
 #ifdef SERVICECONTROL_DEBUG
-		std::cerr << "p3ServiceControl::checkFilter() Denied Peer.DenyAll";
-		std::cerr << std::endl;
+	std::cerr << "p3ServiceControl::checkFilter() " << (allowed ? "Allowed" : "Denied");
+	std::cerr << std::endl;
 #endif
-		return false;
-	}
+	return allowed;
+}
 
-	if (pit->second.mAllowAll)
-	{
-#ifdef SERVICECONTROL_DEBUG
-		std::cerr << "p3ServiceControl::checkFilter() Allowed Peer.AllowAll";
-		std::cerr << std::endl;
-#endif
-		return true;
-	}
+pqiService *p3ServiceControl::getDispatchTarget(uint32_t serviceId, const RsPeerId &peerId)
+{
+	RsSnapshot<ServiceFilterSnapshot>::Reader snap(mFilterSnapshot);
 
-	std::set<uint32_t>::const_iterator sit;
-	sit = pit->second.mAllowedServices.find(serviceId);
-	if (sit == pit->second.mAllowedServices.end())
+	const ServiceDispatchTable::Entry *entry = snap->tableFor(peerId).find(serviceId);
+	if (!entry || !entry->mAllowed)
 	{
 #ifdef SERVICECONTROL_DEBUG
-		std::cerr << "p3ServiceControl::checkFilter() Denied !Peer.find(serviceId)";
+		std::cerr << "p3ServiceControl::getDispatchTarget() Denied ServiceId: " << serviceId;
+		std::cerr << " PeerId: " << peerId.toStdString();
 		std::cerr << std::endl;
 #endif
-		return false;
+		return NULL;
 	}
-#ifdef SERVICECONTROL_DEBUG
-	std::cerr << "p3ServiceControl::checkFilter() Allowed Peer.find(serviceId)";
-	std::cerr << std::endl;
-#endif
-	return true;
+	return entry->mService;
 }
 
 bool versionOkay(uint16_t version_major, uint16_t version_minor,
@@ -576,7 +557,9 @@ bool	p3ServiceControl::updateFilterByPeer(const RsPeerId &peerId)
 #endif
 
 	RsStackMutex stack(mCtrlMtx); /***** LOCK STACK MUTEX ****/
-	return updateFilterByPeer_locked(peerId);
+	bool ret = updateFilterByPeer_locked(peerId);
+	publishFilterSnapshot_locked();
+	return ret;
 }
 
 
@@ -589,7 +572,9 @@ bool	p3ServiceControl::updateAllFilters()
 
 	RsStackMutex stack(mCtrlMtx); /***** LOCK STACK MUTEX ****/
 
-	return updateAllFilters_locked();
+	bool ret = updateAllFilters_locked();
+	publishFilterSnapshot_locked();
+	return ret;
 }
 
 
@@ -659,6 +644,7 @@ bool	p3ServiceControl::updateFilterByPeer_locked(const RsPeerId &peerId)
 			std::cerr << std::endl;
 			mPeerFilterMap.erase(fit);
 		}
+		updateDispatchTable_locked(peerId);
 		return true;
 	}
 
@@ -758,6 +744,7 @@ bool	p3ServiceControl::updateFilterByPeer_locked(const RsPeerId &peerId)
 		mPeerFilterMap[peerId] = peerFilter;
 	}
 	recordFilterChanges_locked(peerId, originalFilter, peerFilter);
+	updateDispatchTable_locked(peerId);
 
 	using Evt_t = RsPeerStateChangedEvent;
 	if(rsEvents)
@@ -888,6 +875,7 @@ void	p3ServiceControl::removePeer(const RsPeerId &peerId)
 			hadFilter = true;
 			originalFilter = fit->second;
 			mPeerFilterMap.erase(fit);
+			updateDispatchTable_locked(peerId);
 		}
 		else
 		{
@@ -923,7 +911,95 @@ void	p3ServiceControl::removePeer(const RsPeerId &peerId)
 	{
 		ServicePeerFilter emptyFilter;
 		recordFilterChanges_locked(peerId, originalFilter, emptyFilter);
+		publishFilterSnapshot_locked();
+	}
+}
+
+void	p3ServiceControl::publishFilterSnapshot_locked()
+{
+	ServiceFilterSnapshot snap;
+	snap.mPeerTables = mDispatchTables;
+	snap.mDefaultTable = mDefaultDispatchTable;
+	snap.mServicePeers = mServicePeerMap;
+	mFilterSnapshot.publish(std::move(snap));
+}
+
+std::shared_ptr<const ServiceDispatchTable> p3ServiceControl::buildDispatchTable_locked(const ServicePeerFilter &filter)
+{
+	std::shared_ptr<ServiceDispatchTable> table = std::make_shared<ServiceDispatchTable>();
+	table->mAllowAll = !filter.mDenyAll && filter.mAllowAll;
+
+	// must allow ServiceInfo through, or we have nothing!
+	const uint32_t serviceInfoId = RsServiceInfo::RsServiceInfoUIn16ToFullServiceId(RS_SERVICE_TYPE_SERVICEINFO);
+
+	std::set<uint32_t> serviceIds(filter.mAllowedServices);
+	for(std::map<uint32_t, RsServiceInfo>::const_iterator it = mOwnServices.begin(); it != mOwnServices.end(); ++it)
+		serviceIds.insert(it->first);
+
+	// std::set is sorted already.
+	table->mEntries.reserve(serviceIds.size());
+	for(std::set<uint32_t>::const_iterator it = serviceIds.begin(); it != serviceIds.end(); ++it)
+	{
+		ServiceDispatchTable::Entry entry;
+		entry.mServiceId = *it;
+		entry.mAllowed = (*it == serviceInfoId) || (!filter.mDenyAll &&
+		        (filter.mAllowAll || filter.mAllowedServices.count(*it)));
+
+		std::map<uint32_t, pqiService *>::const_iterator tit = mServiceTargets.find(*it);
+		entry.mService = (tit != mServiceTargets.end()) ? tit->second : NULL;
+
+		table->mEntries.push_back(entry);
 	}
+	return table;
+}
+
+void	p3ServiceControl::updateDispatchTable_locked(const RsPeerId &peerId)
+{
+	std::map<RsPeerId, ServicePeerFilter>::const_iterator fit = mPeerFilterMap.find(peerId);
+	if (fit == mPeerFilterMap.end())
+		mDispatchTables.erase(peerId); // the default table applies.
+	else
+		mDispatchTables[peerId] = buildDispatchTable_locked(fit->second);
+}
+
+void	p3ServiceControl::updateAllDispatchTables_locked()
+{
+	mDefaultDispatchTable = buildDispatchTable_locked(ServicePeerFilter());
+
+	mDispatchTables.clear();
+	std::map<RsPeerId, ServicePeerFilter>::const_iterator fit;
+	for(fit = mPeerFilterMap.begin(); fit != mPeerFilterMap.end(); ++fit)
+		mDispatchTables[fit->first] = buildDispatchTable_locked(fit->second);
+}
+
+/****************************************************************************/
+/****************************************************************************/
+
+ServiceFilterSnapshot::ServiceFilterSnapshot() :
+    mDefaultTable(std::make_shared<const ServiceDispatchTable>()) {}
+
+const ServiceDispatchTable &ServiceFilterSnapshot::tableFor(const RsPeerId &peerId) const
+{
+	std::map<RsPeerId, std::shared_ptr<const ServiceDispatchTable> >::const_iterator it;
+	it = mPeerTables.find(peerId);
+	return (it != mPeerTables.end()) ? *it->second : *mDefaultTable;
+}
+
+const ServiceDispatchTable::Entry *ServiceDispatchTable::find(uint32_t serviceId) const
+{
+	std::vector<Entry>::const_iterator it = std::lower_bound(
+	            mEntries.begin(), mEntries.end(), serviceId,
+	            [](const Entry &entry, uint32_t id) { return entry.mServiceId < id; });
+
+	if (it == mEntries.end() || it->mServiceId != serviceId)
+		return NULL;
+	return &*it;
+}
+
+bool ServiceDispatchTable::isAllowed(uint32_t serviceId) const
+{
+	const Entry *entry = find(serviceId);
+	return entry ? entry->mAllowed : mAllowAll;
 }
 
 /****************************************************************************/
@@ -993,11 +1069,11 @@ void p3ServiceControl::filterChangeAdded_locked(const RsPeerId &peerId, uint32_t
 
 void p3ServiceControl::getPeersConnected(uint32_t serviceId, std::set<RsPeerId> &peerSet)
 {
-	RS_STACK_MUTEX(mCtrlMtx);
+	RsSnapshot<ServiceFilterSnapshot>::Reader snap(mFilterSnapshot);
 
-	std::map<uint32_t, std::set<RsPeerId> >::iterator mit;
-	mit = mServicePeerMap.find(serviceId);
-	if (mit != mServicePeerMap.end())
+	std::map<uint32_t, std::set<RsPeerId> >::const_iterator mit;
+	mit = snap->mServicePeers.find(serviceId);
+	if (mit != snap->mServicePeers.end())
 	{
 		peerSet = mit->second;
 	}
@@ -1010,13 +1086,13 @@ void p3ServiceControl::getPeersConnected(uint32_t serviceId, std::set<RsPeerId>
 
 bool p3ServiceControl::isPeerConnected(uint32_t serviceId, const RsPeerId &peerId)
 {
-	RS_STACK_MUTEX(mCtrlMtx);
+	RsSnapshot<ServiceFilterSnapshot>::Reader snap(mFilterSnapshot);
 
-	std::map<uint32_t, std::set<RsPeerId> >::iterator mit;
-	mit = mServicePeerMap.find(serviceId);
-	if (mit != mServicePeerMap.end())
+	std::map<uint32_t, std::set<RsPeerId> >::const_iterator mit;
+	mit = snap->mServicePeers.find(serviceId);
+	if (mit != snap->mServicePeers.end())
 	{
-		std::set<RsPeerId>::iterator sit;
+		std::set<RsPeerId>::const_iterator sit;
 		sit = mit->second.find(peerId);
 		return (sit != mit->second.end());
 	}
@@ -24,12 +24,15 @@
 
 #include <string>
 #include <map>
+#include <memory>
+#include <vector>
 
 #include "retroshare/rsservicecontrol.h"
 #include "pqi/p3cfgmgr.h"
 #include "pqi/pqimonitor.h"
 #include "pqi/pqiservicemonitor.h"
 #include "pqi/p3linkmgr.h"
+#include "util/rssnapshot.h"
 
 class p3ServiceServer ;
 
@@ -53,6 +56,43 @@ class ServicePeerFilter
 
 std::ostream &operator<<(std::ostream &out, const ServicePeerFilter &filter);
 
+class pqiService;
+
+// Flat per peer table answering checkFilter() and telling which service
+// incoming items go to, precomputed from the peer filter.
+class ServiceDispatchTable
+{
+	public:
+	ServiceDispatchTable() : mAllowAll(false) {}
+
+	class Entry
+	{
+		public:
+		uint32_t mServiceId;
+		bool mAllowed;
+		pqiService *mService;
+	};
+
+	const Entry *find(uint32_t serviceId) const;
+	bool isAllowed(uint32_t serviceId) const;
+
+	bool mAllowAll; // answer for services without an entry.
+	std::vector<Entry> mEntries; // sorted by mServiceId.
+};
+
+// Copy of the filters consulted for every item sent or received.
+class ServiceFilterSnapshot
+{
+	public:
+	ServiceFilterSnapshot();
+
+	const ServiceDispatchTable &tableFor(const RsPeerId &peerId) const;
+
+	std::map<RsPeerId, std::shared_ptr<const ServiceDispatchTable> > mPeerTables;
+	std::shared_ptr<const ServiceDispatchTable> mDefaultTable; // peers without filter.
+	std::map<uint32_t, std::set<RsPeerId> > mServicePeers;
+};
+
 class ServiceControlSerialiser ;
 
 class p3ServiceControl: public RsServiceControl, public pqiMonitor, public p3Config
@@ -105,7 +145,8 @@ virtual bool getServiceItemNames(uint32_t serviceId,std::map<uint8_t,std::string
 	 * Registration for all Services.
 	 */
 
-virtual	bool registerService(const RsServiceInfo &info, bool defaultOn);
+	// service is where incoming items are dispatched, see getDispatchTarget().
+virtual	bool registerService(const RsServiceInfo &info, bool defaultOn, pqiService *service = NULL);
 virtual	bool deregisterService(uint32_t serviceId);
 
 virtual	bool registerServiceMonitor(pqiServiceMonitor *monitor, uint32_t serviceId);
@@ -119,6 +160,10 @@ virtual	bool deregisterServiceMonitor(pqiServiceMonitor *monitor);
 	// Filter for services.
 virtual bool checkFilter(uint32_t serviceId, const RsPeerId &peerId);
 
+	// Filter and service lookup in one go for incoming items,
+	// NULL when the item must be dropped.
+virtual pqiService *getDispatchTarget(uint32_t serviceId, const RsPeerId &peerId);
+
 	/**
 	 * Interface for ServiceInfo service.
 	 */
@@ -166,12 +211,22 @@ bool 	updateFilterByPeer_locked(const RsPeerId &peerId);
 	void filterChangeAdded_locked(const RsPeerId &peerId, uint32_t serviceId);
 	void filterChangeRemoved_locked(const RsPeerId &peerId, uint32_t serviceId);
 
+	// Must be called after changing mPeerFilterMap or mServicePeerMap.
+void	publishFilterSnapshot_locked();
+
+std::shared_ptr<const ServiceDispatchTable> buildDispatchTable_locked(const ServicePeerFilter &filter);
+void	updateDispatchTable_locked(const RsPeerId &peerId);
+void	updateAllDispatchTables_locked();
+
 bool createDefaultPermissions_locked(uint32_t serviceId, const std::string& serviceName, bool defaultOn);
 bool peerHasPermissionForService_locked(const RsPeerId &peerId, uint32_t serviceId);
 
 	p3LinkMgr *mLinkMgr;
 	const RsPeerId mOwnPeerId; // const from constructor
 
+	// Read by checkFilter() and friends without taking mCtrlMtx.
+	RsSnapshot<ServiceFilterSnapshot> mFilterSnapshot;
+
 	RsMutex mCtrlMtx; /* below is protected */
 
 	std::set<RsPeerId> mUpdatedSet;
@@ -189,6 +244,11 @@ bool peerHasPermissionForService_locked(const RsPeerId &peerId, uint32_t service
 	// Map of Connected Peers per Service.
 	std::map<uint32_t, std::set<RsPeerId> > mServicePeerMap;
 
+	// derived from mPeerFilterMap and mServiceTargets.
+	std::map<RsPeerId, std::shared_ptr<const ServiceDispatchTable> > mDispatchTables;
+	std::shared_ptr<const ServiceDispatchTable> mDefaultDispatchTable;
+	std::map<uint32_t, pqiService *> mServiceTargets;
+
 	// Separate mutex here - must not hold both at the same time!
 	RsMutex mMonitorMtx; /* below is protected */
     std::multimap<uint32_t, pqiServiceMonitor *> mMonitors;
@@ -77,7 +77,7 @@ int	p3ServiceServer::addService(pqiService *ts, bool defaultOn)
 	services[info.mServiceType] = ts;
 
 	// This doesn't need to be in Mutex.
-	mServiceControl->registerService(info,defaultOn);
+	mServiceControl->registerService(info,defaultOn,ts);
 
 	return 1;
 }
@@ -124,31 +124,16 @@ int p3ServiceServer::removeService(pqiService *ts)
 
 bool	p3ServiceServer::recvItem(RsRawItem *item)
 {
-	// Packet Filtering.
+	// Packet Filtering and lookup of the service in the same table.
 	// This doesn't need to be in Mutex.
-	if (!mServiceControl->checkFilter(item->PacketId() & 0xffffff00, item->PeerId()))
+	pqiService *s = mServiceControl->getDispatchTarget(item->PacketId() & 0xffffff00, item->PeerId());
+	if (!s)
 	{
 		delete item;
 		return false;
 	}
 
-	pqiService *s = NULL;
-
-	// access the service map under mutex lock
-	{
-		RS_STACK_MUTEX(srvMtx);
-		auto it = services.find(item -> PacketId() & 0xffffff00);
-		if (it == services.end())
-		{
-			delete item;
-			return false;
-		}
-		s = it->second;
-	}
-
-	// then call recv off mutex
-	bool result = s->recv(item);
-	return result;
+	return s->recv(item);
 }
 
 bool p3ServiceServer::sendItem(RsRawItem *item)
@@ -195,6 +180,12 @@ int	p3ServiceServer::tick()
 	// tick all services off mutex
 	for(auto it(local_map.begin());it!=local_map.end();++it)
 	{
+		RsProfiler::Section*& section = mProfilerSections[it->first];
+		if(!section && RsProfiler::isEnabled())
+			section = RsProfiler::childSection(
+			            it->second->getServiceInfo().mServiceName );
+
+		RsProfiler::ScopedSample sample(section);
 		(it->second)->tick();
 	}
 
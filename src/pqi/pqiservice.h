@@ -25,6 +25,7 @@
 #include "pqi/pqi.h"
 #include "pqi/pqi_base.h"
 #include "util/rsthreads.h"
+#include "util/rsprofiler.h"
 
 #include "retroshare/rsservicecontrol.h"
 #include "pqi/p3servicecontrol.h"
@@ -124,6 +125,9 @@ private:
 	RsMutex srvMtx;
 	std::map<uint32_t, pqiService *> services;
 
+	/// Only accessed by the ticking thread
+	std::map<uint32_t, RsProfiler::Section*> mProfilerSections;
+
 };
 
 
@@ -126,7 +126,8 @@ public:
 
 	/**
 	 * @brief isAddressAccepted
-	 * @param addr full IPv4 address. Port is ignored.
+	 * @param addr full IPv4 or IPv6 address. Port is ignored. IPv6 addresses
+	 *	are only checked against imported block lists.
 	 * @param checking_flags any combination of
 	 * 	RSBANLIST_CHECKING_FLAGS_BLACKLIST and
 	 * 	RSBANLIST_CHECKING_FLAGS_WHITELIST
@@ -153,5 +154,36 @@ public:
 	virtual void enableIPsFromDHT(bool b) = 0;
 	virtual bool iPsFromDHTEnabled() = 0;
 
+	/**
+	 * @brief Import a public IP block list. Addresses it contains are
+	 *	rejected like blacklisted ones, IPv6 included. The file is read
+	 *	again at each start.
+	 * @jsonapi{development}
+	 * @param[in] path text file with one entry per line: a CIDR prefix
+	 *	("1.2.3.0/24", "2001:db8::/32"), a single address, or an IPv4 range
+	 *	"1.2.3.0-1.2.3.255" possibly prefixed by "name:" (P2P format) or
+	 *	followed by ", level, name" (DAT format, where ranges of level 127
+	 *	and above are allowed ones and skipped). Lines starting with '#'
+	 *	are ignored.
+	 * @param[out] count number of prefixes read from the file
+	 * @return false if the file cannot be read
+	 */
+	virtual bool importBlockList(const std::string& path, uint32_t& count) = 0;
+
+	/**
+	 * @brief Stop using an imported block list
+	 * @jsonapi{development}
+	 * @param[in] path path the list was imported from
+	 * @return false if no list was imported from that path
+	 */
+	virtual bool removeBlockList(const std::string& path) = 0;
+
+	/**
+	 * @brief Get the paths of imported block lists
+	 * @jsonapi{development}
+	 * @param[out] paths
+	 */
+	virtual void getBlockLists(std::list<std::string>& paths) = 0;
+
 	virtual ~RsBanList();
 };
@@ -27,6 +27,7 @@
 #include <string>
 #include <list>
 #include <map>
+#include <vector>
 
 /* The New Config Interface Class */
 class RsServerConfig;
@@ -284,6 +285,85 @@ struct RsConfigNetStatus : RsSerializable
 };
 
 
+/**
+ * Runtime profiler data about a thread loop, a subsystem ticked by it or a
+ * queue. Names are stacks of frames separated by ';' e.g.
+ * "rs main;pqihandler;turtle"
+ */
+struct RsProfilerSectionStats : RsSerializable
+{
+	RsProfilerSectionStats() :
+	    mSamples(0), mWallTotalUs(0), mWallMaxUs(0), mCpuTotalUs(0),
+	    mQueueDepth(0), mQueueDepthMax(0) {}
+
+	std::string mName;
+
+	/// Number of recorded ticks
+	uint64_t mSamples;
+
+	/// Wall clock time spent in ticks, including sleeps and lock waits
+	uint64_t mWallTotalUs;
+	uint64_t mWallMaxUs;
+
+	/// CPU time consumed by the ticking thread during ticks
+	uint64_t mCpuTotalUs;
+
+	/** Wall clock tick duration histogram, element i counts ticks lasting
+	 * between 2^i and 2^(i+1) microseconds */
+	std::vector<uint64_t> mWallHistogram;
+
+	/// Current and maximum depth for sections tracking a queue
+	uint64_t mQueueDepth;
+	uint64_t mQueueDepthMax;
+
+	/// @see RsSerializable
+	void serial_process(RsGenericSerializer::SerializeJob j,
+	                    RsGenericSerializer::SerializeContext& ctx) override
+	{
+		RS_SERIAL_PROCESS(mName);
+		RS_SERIAL_PROCESS(mSamples);
+		RS_SERIAL_PROCESS(mWallTotalUs);
+		RS_SERIAL_PROCESS(mWallMaxUs);
+		RS_SERIAL_PROCESS(mCpuTotalUs);
+		RS_SERIAL_PROCESS(mWallHistogram);
+		RS_SERIAL_PROCESS(mQueueDepth);
+		RS_SERIAL_PROCESS(mQueueDepthMax);
+	}
+};
+
+/// Contention statistics of RsMutex sharing the same name
+struct RsMutexContentionStats : RsSerializable
+{
+	RsMutexContentionStats() :
+	    mAcquisitions(0), mContended(0), mWaitTotalUs(0), mWaitMaxUs(0),
+	    mHoldTotalUs(0), mHoldMaxUs(0) {}
+
+	std::string mName;
+
+	uint64_t mAcquisitions;
+
+	/// Acquisitions which had to wait for another thread to release the mutex
+	uint64_t mContended;
+
+	uint64_t mWaitTotalUs;
+	uint64_t mWaitMaxUs;
+	uint64_t mHoldTotalUs;
+	uint64_t mHoldMaxUs;
+
+	/// @see RsSerializable
+	void serial_process(RsGenericSerializer::SerializeJob j,
+	                    RsGenericSerializer::SerializeContext& ctx) override
+	{
+		RS_SERIAL_PROCESS(mName);
+		RS_SERIAL_PROCESS(mAcquisitions);
+		RS_SERIAL_PROCESS(mContended);
+		RS_SERIAL_PROCESS(mWaitTotalUs);
+		RS_SERIAL_PROCESS(mWaitMaxUs);
+		RS_SERIAL_PROCESS(mHoldTotalUs);
+		RS_SERIAL_PROCESS(mHoldMaxUs);
+	}
+};
+
 /*********
  * This is a new style RsConfig Interface.
  * It should contain much of the information for the Options/Config Window.
@@ -451,6 +531,63 @@ public:
 	 * @param[in] isIdle
 	 */
 	virtual void setIsIdle(bool isIdle) = 0;
+
+	/**
+	 * @brief Enable or disable the runtime profiler
+	 * @jsonapi{development}
+	 * @param[in] enable true to start sampling threads and services ticks
+	 * @param[in] dumpFile path where CPU time per section is periodically
+	 *	written in folded stacks format, as consumed by flamegraph.pl, empty to
+	 *	disable dumps
+	 * @param[in] dumpIntervalSecs seconds between two dumps
+	 */
+	virtual void setProfilerEnabled(
+	        bool enable, const std::string& dumpFile,
+	        uint32_t dumpIntervalSecs ) = 0;
+
+	/**
+	 * @brief Check if the runtime profiler is enabled
+	 * @jsonapi{development}
+	 * @return true if enabled
+	 */
+	virtual bool isProfilerEnabled() = 0;
+
+	/**
+	 * @brief Get per thread and per service tick statistics and queue depths
+	 *	collected by the runtime profiler
+	 * @jsonapi{development}
+	 * @param[out] stats storage for statistics
+	 * @param[in] reset zero counters after reading them
+	 */
+	virtual void getProfilerStatistics(
+	        std::vector<RsProfilerSectionStats>& stats, bool reset ) = 0;
+
+	/**
+	 * @brief Enable or disable RsMutex contention profiling, which counts
+	 *	acquisitions, contended acquisitions, wait and hold time of each named
+	 *	mutex. Adds a couple of clock reads per lock while enabled.
+	 * @jsonapi{development}
+	 * @param[in] enable true to start profiling
+	 */
+	virtual void setLockProfilingEnabled(bool enable) = 0;
+
+	/**
+	 * @brief Check if RsMutex contention profiling is enabled
+	 * @jsonapi{development}
+	 * @return true if enabled
+	 */
+	virtual bool isLockProfilingEnabled() = 0;
+
+	/**
+	 * @brief Get most contended mutexes, sorted by total wait time
+	 * @jsonapi{development}
+	 * @param[out] stats storage for statistics
+	 * @param[in] topN maximum number of mutexes to report, 0 for all
+	 * @param[in] reset zero counters after reading them
+	 */
+	virtual void getLockContentionStats(
+	        std::vector<RsMutexContentionStats>& stats, uint32_t topN,
+	        bool reset ) = 0;
 };
 
 // I use a class here because it's likely that we will need methods to provide global behavior switches
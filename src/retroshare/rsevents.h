@@ -50,6 +50,10 @@ extern RsEvents* rsEvents;
  * @brief Events types.
  * When creating a new type of event, add a new type here and use that to
  * initialize mType in the constructor of your derivative of @see RsEvent
+ * If receiving the newest of identical events of the new type is as good as
+ * receiving all of them, also list it in
+ * @see RsEventsService::isEventTypeIdempotent so duplicates waiting for a
+ * lagging handler can be merged.
  */
 enum class RsEventType : uint32_t
 {
@@ -67,7 +71,7 @@ enum class RsEventType : uint32_t
 	/// @see pqissl
 	PEER_CONNECTION                                         = 4,
 
-	/// @see RsGxsChanges, used also in @see RsGxsBroadcast
+	/// Batched summary of GXS service changes, @see RsGxsChanges
 	GXS_CHANGES                                             = 5,
 
 	/// Emitted when a peer state changes, @see RsPeers
@@ -199,7 +203,12 @@ public:
 
 		rstime_t mTime = std::chrono::system_clock::to_time_t(mTimePoint);
 		RS_SERIAL_PROCESS(mTime);
-		mTimePoint = std::chrono::system_clock::from_time_t(mTime);
+
+		/* Don't truncate the time point of events being serialized, the same
+		 * event may be read concurrently by other handlers */
+		if( j == RsGenericSerializer::DESERIALIZE ||
+		        j == RsGenericSerializer::FROM_JSON )
+			mTimePoint = std::chrono::system_clock::from_time_t(mTime);
 	}
 
 	~RsEvent() override;
@@ -207,6 +216,37 @@ public:
 
 typedef uint32_t RsEventsHandlerId_t;
 
+/// Events dispatching statistics, @see RsEvents::getStatistics
+struct RsEventsStatistics : RsSerializable
+{
+	RsEventsStatistics() :
+	    mPosted(0), mDispatched(0), mCoalesced(0), mDropped(0), mQueueDepth(0),
+	    mMaxQueueDepth(0), mAvgLatencyUs(0), mMaxLatencyUs(0) {}
+
+	uint64_t mPosted;        /// Events posted
+	uint64_t mDispatched;    /// Handler calls
+	uint64_t mCoalesced;     /// Duplicates of an event already queued
+	uint64_t mDropped;       /// Lost because a handler queue was full
+	uint64_t mQueueDepth;    /// Events currently waiting for handlers
+	uint64_t mMaxQueueDepth;
+	uint64_t mAvgLatencyUs;  /// From posting to handler call
+	uint64_t mMaxLatencyUs;
+
+	/// @see RsSerializable
+	void serial_process(RsGenericSerializer::SerializeJob j,
+	                    RsGenericSerializer::SerializeContext& ctx) override
+	{
+		RS_SERIAL_PROCESS(mPosted);
+		RS_SERIAL_PROCESS(mDispatched);
+		RS_SERIAL_PROCESS(mCoalesced);
+		RS_SERIAL_PROCESS(mDropped);
+		RS_SERIAL_PROCESS(mQueueDepth);
+		RS_SERIAL_PROCESS(mMaxQueueDepth);
+		RS_SERIAL_PROCESS(mAvgLatencyUs);
+		RS_SERIAL_PROCESS(mMaxLatencyUs);
+	}
+};
+
 class RsEvents
 {
 public:
@@ -237,8 +277,10 @@ public:
 	 * @brief Register events handler
 	 * Every time an event is dispatced the registered events handlers will get
 	 * their method handleEvent called with the event passed as paramether.
-	 * @attention Callbacks must not fiddle internally with methods of this
-	 * class otherwise a deadlock will happen.
+	 * Each handler gets its events one at time and in posting order, but
+	 * different handlers may be called concurrently from different threads.
+	 * A handler lagging behind may get only the newest of identical events of
+	 * an idempotent type.
 	 * @jsonapi{development,manualwrapper}
 	 * @param multiCallback     Function that will be called each time an event
 	 *                          is dispatched.
@@ -265,5 +307,13 @@ public:
 	virtual std::error_condition unregisterEventsHandler(
 	        RsEventsHandlerId_t hId ) = 0;
 
+	/**
+	 * @brief Get events dispatching statistics
+	 * @jsonapi{development}
+	 * @param[out] stats storage for the statistics
+	 * @param[in] reset restart counters, maximums and average latency from now
+	 */
+	virtual void getStatistics(RsEventsStatistics& stats, bool reset) = 0;
+
 	virtual ~RsEvents();
 };
@@ -105,6 +105,10 @@ const uint32_t RS_FILE_PERM_DIRECT_DL_YES      = 0x00000001 ;
 const uint32_t RS_FILE_PERM_DIRECT_DL_NO       = 0x00000002 ;
 const uint32_t RS_FILE_PERM_DIRECT_DL_PER_USER = 0x00000003 ;
 
+/* Storage policy of partial files, set per partials directory */
+const uint32_t RS_FILE_PARTIALS_STORAGE_PREALLOCATE = 0x00000001 ;	// reserve the whole file on disk when it is created
+const uint32_t RS_FILE_PARTIALS_STORAGE_DIRECT_IO   = 0x00000002 ;	// write block aligned data with O_DIRECT, bypassing the page cache
+
 const uint32_t RS_FILE_RATE_TRICKLE	 = 0x00000001;
 const uint32_t RS_FILE_RATE_SLOW	 = 0x00000002;
 const uint32_t RS_FILE_RATE_STANDARD	 = 0x00000003;
@@ -956,6 +960,24 @@ public:
 	 */
 	virtual bool setPartialsDirectory(const std::string& path) = 0;
 
+	/**
+	 * @brief Set how partial files are stored in a partials directory.
+	 * Preallocation and direct I/O are only available on Linux, and are
+	 * ignored elsewhere.
+	 * @jsonapi{development}
+	 * @param[in] path partials directory path
+	 * @param[in] flags combination of RS_FILE_PARTIALS_STORAGE_* flags
+	 */
+	virtual void setPartialsStoragePolicy(const std::string& path, uint32_t flags) = 0;
+
+	/**
+	 * @brief Get how partial files are stored in a partials directory
+	 * @jsonapi{development}
+	 * @param[in] path partials directory path
+	 * @return combination of RS_FILE_PARTIALS_STORAGE_* flags
+	 */
+	virtual uint32_t partialsStoragePolicy(const std::string& path) = 0;
+
 	/**
 	 * @brief Get default complete downloads directory
 	 * @jsonapi{development}
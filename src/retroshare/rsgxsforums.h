@@ -386,6 +386,21 @@ public:
 	virtual bool getForumMsgMetaData( const RsGxsGroupId& forumId,
 	                                  std::vector<RsMsgMetaData>& msgMetas) = 0;
 
+	/**
+	 * @brief Get message metadatas of the latest versions of the posts of a
+	 *	single discussion thread, thread head excluded. Only the posts of the
+	 *	thread are loaded, which is much cheaper than getForumMsgMetaData on
+	 *	big forums. Blocking API
+	 * @jsonapi{development}
+	 * @param[in] forumId id of the forum containing the thread
+	 * @param[in] threadId id of the first post of the thread
+	 * @param[out] msgMetas storage for the thread messages meta data
+	 * @return false if something failed, true otherwhise
+	 */
+	virtual bool getForumThreadMsgMetaData(
+	        const RsGxsGroupId& forumId, const RsGxsMessageId& threadId,
+	        std::vector<RsMsgMetaData>& msgMetas ) = 0;
+
 	/**
 	 * @brief Get specific list of messages from a single forum. Blocking API
 	 * @jsonapi{development}
@@ -171,7 +171,13 @@ RsGxsGroupSearchResults : RsSerializable
 
 /*!
  * Stores ids of changed gxs groups and messages.
- * It is used to notify about GXS changes.
+ * It is used to notify about GXS changes in batches: each GXS service posts
+ * one of these summarizing all its changes over a short time window, so
+ * clients can refresh once per group instead of once per message when
+ * thousands of messages come in during a sync.
+ * Services keep posting their fine grained events (e.g. RsGxsForumEvent) too,
+ * clients only interested in summaries should register for
+ * RsEventType::GXS_CHANGES only.
  */
 struct RsGxsChanges : RsEvent
 {
@@ -179,12 +185,38 @@ struct RsGxsChanges : RsEvent
 
 	/// Type of the service
 	RsServiceType mServiceType;
+
+	/// New, published or updated messages per group
 	std::map<RsGxsGroupId, std::set<RsGxsMessageId> > mMsgs;
+
+	/// Messages whose local meta data (read status...) changed
 	std::map<RsGxsGroupId, std::set<RsGxsMessageId> > mMsgsMeta;
-	std::list<RsGxsGroupId> mGrps;
-	std::list<RsGxsGroupId> mGrpsMeta;
+
+	/// Deleted messages per group
+	std::map<RsGxsGroupId, std::set<RsGxsMessageId> > mMsgsDeleted;
+
+	/// New, published or updated groups
+	std::set<RsGxsGroupId> mGrps;
+
+	/// Groups whose local data (subscription, statistics, keys...) changed
+	std::set<RsGxsGroupId> mGrpsMeta;
+
+	std::set<RsGxsGroupId> mGrpsDeleted;
+
+	/// Groups rejected by the service authentication policy
+	std::set<RsGxsGroupId> mGrpsAuthRejected;
+
 	std::list<TurtleRequestId> mDistantSearchReqs;
 
+	/** Codes of the fine grained events posted by the service meanwhile, e.g.
+	 * RsForumEventCode for forums, by group and message. Codes of group events
+	 * are stored under a null message id */
+	std::map< RsGxsGroupId,
+	          std::map<RsGxsMessageId, std::set<uint8_t> > > mEventCodes;
+
+	/// How many notifications this summary covers
+	uint32_t mNotificationsCount;
+
 	/// @see RsSerializable
 	void serial_process( RsGenericSerializer::SerializeJob j,
 	                     RsGenericSerializer::SerializeContext& ctx) override
@@ -193,9 +225,14 @@ struct RsGxsChanges : RsEvent
 		RS_SERIAL_PROCESS(mServiceType);
 		RS_SERIAL_PROCESS(mMsgs);
 		RS_SERIAL_PROCESS(mMsgsMeta);
+		RS_SERIAL_PROCESS(mMsgsDeleted);
 		RS_SERIAL_PROCESS(mGrps);
 		RS_SERIAL_PROCESS(mGrpsMeta);
+		RS_SERIAL_PROCESS(mGrpsDeleted);
+		RS_SERIAL_PROCESS(mGrpsAuthRejected);
 		RS_SERIAL_PROCESS(mDistantSearchReqs);
+		RS_SERIAL_PROCESS(mEventCodes);
+		RS_SERIAL_PROCESS(mNotificationsCount);
 	}
 
 	RsTokenService* mService; /// Weak pointer, not serialized
@@ -357,6 +394,12 @@ struct RsGxsIface
     virtual uint32_t getSyncPeriod(const RsGxsGroupId& grpId) = 0;
     virtual void     setSyncPeriod(const RsGxsGroupId& grpId,uint32_t age_in_secs) = 0;
 
+    /*!
+     * Sync metrics of the network service, see RsGxsNetStatistics
+     */
+    virtual bool getNetworkStatistics(RsGxsNetStatistics& stats) = 0;
+    virtual void setNetworkStatisticsEnabled(bool enabled) = 0;
+
 	virtual RsReputationLevel minReputationForForwardingMessages(
 	        uint32_t group_sign_flags,uint32_t identity_flags ) = 0;
 
@@ -261,6 +261,26 @@ public:
 	void setSyncPeriod(const RsGxsGroupId& groupId, uint32_t syncAge)
 	{ mGxs.setSyncPeriod(groupId, syncAge); }
 
+	/*!
+	 * @brief Get synchronisation metrics of the service: request and answer
+	 *	sizes, transaction durations, vetting queue and data store times, in
+	 *	total and per peer. Collection must be enabled first.
+	 * @jsonapi{development}
+	 * @param[out] stats storage for the metrics
+	 * @return false if the service has no network part
+	 */
+	bool getNetworkStatistics(RsGxsNetStatistics& stats)
+	{ return mGxs.getNetworkStatistics(stats); }
+
+	/*!
+	 * @brief Enable or disable collection of synchronisation metrics. Disabled
+	 *	by default. Enabling resets the metrics.
+	 * @jsonapi{development}
+	 * @param[in] enabled true to collect metrics
+	 */
+	void setNetworkStatisticsEnabled(bool enabled)
+	{ mGxs.setNetworkStatisticsEnabled(enabled); }
+
 	/*!
 	 * This determines the reputation threshold messages need to surpass in order
 	 * for it to be accepted by local user from remote source
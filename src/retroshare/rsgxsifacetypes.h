@@ -237,7 +237,8 @@ struct GxsServiceStatistic : RsSerializable
 	GxsServiceStatistic() :
 	    mNumMsgs(0), mNumGrps(0), mSizeOfMsgs(0),  mSizeOfGrps(0),
 	    mNumGrpsSubscribed(0), mNumThreadMsgsNew(0), mNumThreadMsgsUnread(0),
-	    mNumChildMsgsNew(0), mNumChildMsgsUnread(0), mSizeStore(0) {}
+	    mNumChildMsgsNew(0), mNumChildMsgsUnread(0), mSizeStore(0),
+	    mDbSize(0), mDbFreeSize(0) {}
 
 	uint32_t mNumMsgs;
 	uint32_t mNumGrps;
@@ -250,6 +251,11 @@ struct GxsServiceStatistic : RsSerializable
 	uint32_t mNumChildMsgsUnread;
 	uint32_t mSizeStore;
 
+	/// Size of the service database, in bytes
+	uint64_t mDbSize;
+	/// Unused space in the database, not yet reclaimed by maintenance. mDbFreeSize/mDbSize gives the fragmentation
+	uint64_t mDbFreeSize;
+
 	/// @see RsSerializable
 	void serial_process( RsGenericSerializer::SerializeJob j,
 	                     RsGenericSerializer::SerializeContext& ctx ) override
@@ -264,11 +270,118 @@ struct GxsServiceStatistic : RsSerializable
 		RS_SERIAL_PROCESS(mNumChildMsgsNew);
 		RS_SERIAL_PROCESS(mNumChildMsgsUnread);
 		RS_SERIAL_PROCESS(mSizeStore);
+		RS_SERIAL_PROCESS(mDbSize);
+		RS_SERIAL_PROCESS(mDbFreeSize);
 	}
 
 	~GxsServiceStatistic() override;
 };
 
+/*!
+ * Histogram with logarithmic buckets, each power of two range being split in 4
+ * sub-buckets, so that any recorded value is known with a precision of 25%
+ * whatever its magnitude. Used for latencies (in microseconds) and sizes.
+ */
+struct RsGxsHistogram : RsSerializable
+{
+	RsGxsHistogram() : mCount(0), mTotal(0), mMax(0) {}
+
+	void record(uint64_t value);
+	void merge(const RsGxsHistogram& h);
+
+	/// @return upper bound of the value below which fall the given fraction (0..1) of the recorded values
+	uint64_t percentile(double fraction) const;
+
+	uint64_t mCount;
+	uint64_t mTotal;
+	uint64_t mMax;
+	std::vector<uint64_t> mBuckets;
+
+	/// @see RsSerializable
+	void serial_process( RsGenericSerializer::SerializeJob j,
+	                     RsGenericSerializer::SerializeContext& ctx ) override
+	{
+		RS_SERIAL_PROCESS(mCount);
+		RS_SERIAL_PROCESS(mTotal);
+		RS_SERIAL_PROCESS(mMax);
+		RS_SERIAL_PROCESS(mBuckets);
+	}
+
+	~RsGxsHistogram() override;
+};
+
+/// Synchronisation counters of a GXS network service, for one peer or for all
+struct RsGxsNetSyncCounters : RsSerializable
+{
+	RsGxsNetSyncCounters() :
+	    mSyncReqSent(0), mSyncReqReceived(0), mGrpIdsSent(0), mMsgIdsSent(0),
+	    mTransactionsOk(0), mTransactionsFailed(0) {}
+
+	uint64_t mSyncReqSent;
+	uint64_t mSyncReqReceived;
+	uint64_t mGrpIdsSent;          /// group ids sent in answer to sync requests
+	uint64_t mMsgIdsSent;          /// message ids sent in answer to sync requests
+	uint64_t mTransactionsOk;
+	uint64_t mTransactionsFailed;
+	RsGxsHistogram mSyncRespSize;  /// ids per answer to a sync request
+	RsGxsHistogram mTransactionTime; /// microseconds from creation to completion
+
+	/// @see RsSerializable
+	void serial_process( RsGenericSerializer::SerializeJob j,
+	                     RsGenericSerializer::SerializeContext& ctx ) override
+	{
+		RS_SERIAL_PROCESS(mSyncReqSent);
+		RS_SERIAL_PROCESS(mSyncReqReceived);
+		RS_SERIAL_PROCESS(mGrpIdsSent);
+		RS_SERIAL_PROCESS(mMsgIdsSent);
+		RS_SERIAL_PROCESS(mTransactionsOk);
+		RS_SERIAL_PROCESS(mTransactionsFailed);
+		RS_SERIAL_PROCESS(mSyncRespSize);
+		RS_SERIAL_PROCESS(mTransactionTime);
+	}
+
+	~RsGxsNetSyncCounters() override;
+};
+
+/*!
+ * Runtime metrics of a GXS network service. Collected only when enabled, see
+ * RsGxsIfaceHelper::setNetworkStatisticsEnabled()
+ */
+struct RsGxsNetStatistics : RsSerializable
+{
+	RsGxsNetStatistics() :
+	    mServiceType(0), mEnabled(false), mStartTS(0), mVettingQueueSize(0),
+	    mVettingQueueMax(0) {}
+
+	uint16_t mServiceType;
+	bool mEnabled;
+	rstime_t mStartTS;             /// time at which collection was enabled
+
+	RsGxsNetSyncCounters mTotal;
+	/// Outgoing transactions are only accounted in mTotal
+	std::map<RsPeerId, RsGxsNetSyncCounters> mPeers;
+
+	uint32_t mVettingQueueSize;
+	uint32_t mVettingQueueMax;
+	RsGxsHistogram mDbQueryTime;   /// microseconds spent in data store calls of the sync code
+
+	/// @see RsSerializable
+	void serial_process( RsGenericSerializer::SerializeJob j,
+	                     RsGenericSerializer::SerializeContext& ctx ) override
+	{
+		RS_SERIAL_PROCESS(mServiceType);
+		RS_SERIAL_PROCESS(mEnabled);
+		RS_SERIAL_PROCESS(mStartTS);
+		RS_SERIAL_PROCESS(mTotal);
+		RS_SERIAL_PROCESS(mPeers);
+		RS_SERIAL_PROCESS(mVettingQueueSize);
+		RS_SERIAL_PROCESS(mVettingQueueMax);
+		RS_SERIAL_PROCESS(mDbQueryTime);
+	}
+
+	~RsGxsNetStatistics() override;
+};
+
 class RS_DEPRECATED RsGxsGroupUpdateMeta
 {
 public:
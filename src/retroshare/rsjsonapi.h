@@ -108,6 +108,7 @@ class RsJsonApi
 {
 public:
 	static const uint16_t    DEFAULT_PORT = 9092;
+	static const uint32_t    DEFAULT_WORKER_LIMIT = 4;
 	static const std::string DEFAULT_BINDING_ADDRESS; // 127.0.0.1
 
 	/**
@@ -168,6 +169,21 @@ public:
 	 */
 	virtual uint16_t listeningPort() const = 0;
 
+	/*!
+	 * Set how many threads serve JSON API requests concurrently, so a slow
+	 * call doesn't stall the others. Will only take effect after the server is
+	 * restarted.
+	 * @jsonapi{development}
+	 * @param[in] workers number of worker threads, 0 means one per CPU core
+	 */
+	virtual void setWorkerLimit(uint32_t workers) = 0;
+
+	/*!
+	 * Get how many threads serve JSON API requests concurrently.
+	 * @jsonapi{development}
+	 */
+	virtual uint32_t workerLimit() const = 0;
+
 	/*!
 	 * Should be called after creating the JsonAPI object so that it publishes
 	 * itself with the proper config file.
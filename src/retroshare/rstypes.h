@@ -60,6 +60,9 @@ const uint32_t RS_DIRECTORY_COUNT    = 0x0004 ;
 
 struct TransferInfo : RsSerializable
 {
+	TransferInfo() : tfRate(0), status(0), transfered(0),
+	    rtt(0), outstanding(0), requestWindow(0) {}
+
 	/**** Need Some of these Fields ****/
 	RsPeerId peerId;
 	std::string name; /* if has alternative name? */
@@ -67,6 +70,10 @@ struct TransferInfo : RsSerializable
 	int status; /* FT_STATE_... */
 	uint64_t transfered ; // used when no chunkmap data is available
 
+	uint32_t rtt;            // smoothed round trip time of data requests, in ms
+	uint64_t outstanding;    // bytes requested to this peer and not received yet
+	uint64_t requestWindow;  // current target for outstanding bytes
+
 	/// @see RsSerializable
 	void serial_process(RsGenericSerializer::SerializeJob j,
 	                    RsGenericSerializer::SerializeContext& ctx)
@@ -76,6 +83,9 @@ struct TransferInfo : RsSerializable
 		RS_SERIAL_PROCESS(tfRate);
 		RS_SERIAL_PROCESS(status);
 		RS_SERIAL_PROCESS(transfered);
+		RS_SERIAL_PROCESS(rtt);
+		RS_SERIAL_PROCESS(outstanding);
+		RS_SERIAL_PROCESS(requestWindow);
 	}
 };
 
@@ -355,7 +365,8 @@ struct FileChunksInfo : RsSerializable
 	{
 		CHUNK_STRATEGY_STREAMING,
 		CHUNK_STRATEGY_RANDOM,
-		CHUNK_STRATEGY_PROGRESSIVE
+		CHUNK_STRATEGY_PROGRESSIVE,
+		CHUNK_STRATEGY_RAREST_FIRST
 	};
 
 	struct SliceInfo : RsSerializable
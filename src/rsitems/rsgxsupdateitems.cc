@@ -40,6 +40,7 @@ RsItem* RsGxsUpdateSerialiser::create_item(uint16_t service,uint8_t item_subtype
 		case RS_PKT_SUBTYPE_GXS_SERVER_GRP_UPDATE: return new RsGxsServerGrpUpdateItem(SERVICE_TYPE);
 		case RS_PKT_SUBTYPE_GXS_SERVER_MSG_UPDATE: return new RsGxsServerMsgUpdateItem(SERVICE_TYPE);
 		case RS_PKT_SUBTYPE_GXS_GRP_CONFIG:        return new RsGxsGrpConfigItem(SERVICE_TYPE);
+		case RS_PKT_SUBTYPE_GXS_INTEGRITY_CHECK:   return new RsGxsIntegrityCheckItem(SERVICE_TYPE);
     default:
         return NULL ;
     }
@@ -72,6 +73,12 @@ void RsGxsServerGrpUpdateItem::clear()
     grpUpdateTS = 0;
 }
 
+void RsGxsIntegrityCheckItem::clear()
+{
+    grpId.clear();
+    msgId.clear();
+}
+
 /**********************************************************************************************/
 /*                                          SERIALISER                                        */
 /**********************************************************************************************/
@@ -87,6 +94,12 @@ void RsGxsServerGrpUpdateItem::serial_process(RsGenericSerializer::SerializeJob
     RsTypeSerializer::serial_process<uint32_t>(j,ctx,grpUpdateTS,"grpUpdateTS");
 }
 
+void RsGxsIntegrityCheckItem::serial_process(RsGenericSerializer::SerializeJob j,RsGenericSerializer::SerializeContext& ctx)
+{
+    RsTypeSerializer::serial_process(j,ctx,grpId,"grpId");
+    RsTypeSerializer::serial_process(j,ctx,msgId,"msgId");
+}
+
 void RsGxsMsgUpdateItem::serial_process(RsGenericSerializer::SerializeJob j,RsGenericSerializer::SerializeContext& ctx)
 {
     RsTypeSerializer::serial_process(j,ctx,peerID,"peerID");
@@ -37,6 +37,7 @@ const uint8_t RS_PKT_SUBTYPE_GXS_SERVER_GRP_UPDATE      = 0x04;
 const uint8_t RS_PKT_SUBTYPE_GXS_SERVER_MSG_UPDATE      = 0x08;
 const uint8_t RS_PKT_SUBTYPE_GXS_GRP_CONFIG             = 0x09;
 const uint8_t RS_PKT_SUBTYPE_GXS_RANDOM_BIAS            = 0x0a;
+const uint8_t RS_PKT_SUBTYPE_GXS_INTEGRITY_CHECK        = 0x0b;
 
 class RsGxsNetServiceItem: public RsItem
 {
@@ -200,6 +201,22 @@ public:
 	RsGxsGroupId grpId;
 };
 
+/*!
+ * Position where the next integrity check of the service resumes hashing
+ */
+class RsGxsIntegrityCheckItem : public RsGxsNetServiceItem
+{
+public:
+    explicit RsGxsIntegrityCheckItem(uint16_t servType) : RsGxsNetServiceItem(servType, RS_PKT_SUBTYPE_GXS_INTEGRITY_CHECK) {}
+    virtual ~RsGxsIntegrityCheckItem() {}
+
+	virtual void clear();
+	virtual void serial_process(RsGenericSerializer::SerializeJob j,RsGenericSerializer::SerializeContext& ctx);
+
+	RsGxsGroupId grpId;
+	RsGxsMessageId msgId;
+};
+
 class RsGxsUpdateSerialiser : public RsServiceSerializer
 {
 public:
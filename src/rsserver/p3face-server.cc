@@ -36,6 +36,7 @@
 #include "pqi/p3netmgr.h"
 
 #include "util/rsdebug.h"
+#include "util/rsprofiler.h"
 
 #include "retroshare/rsevents.h"
 #include "services/rseventsservice.h"
@@ -160,22 +161,45 @@ void RsServer::threadTick()
 #ifdef TICK_DEBUG
 	RsDbg() << "TICK_DEBUG ticking RS core";
 #endif
-	lockRsCore();
-	int moreToTick = pqih->tick();
-	unlockRsCore();
+	// Profiler sections of the core subsystems, created when first needed
+	static RsProfiler::Section* pqihSection = nullptr;
+	static RsProfiler::Section* peerMgrSection = nullptr;
+	static RsProfiler::Section* linkMgrSection = nullptr;
+	static RsProfiler::Section* netMgrSection = nullptr;
+
+	int moreToTick;
+	{
+		RsProfiler::ScopedSample sample(
+		            RsProfiler::childSection(pqihSection, "pqihandler") );
+		lockRsCore();
+		moreToTick = pqih->tick();
+		unlockRsCore();
+	}
 	// tick the managers
 #ifdef TICK_DEBUG
 	RsDbg() << "TICK_DEBUG ticking mPeerMgr";
 #endif
-	mPeerMgr->tick();
+	{
+		RsProfiler::ScopedSample sample(
+		            RsProfiler::childSection(peerMgrSection, "peer manager") );
+		mPeerMgr->tick();
+	}
 #ifdef TICK_DEBUG
 	RsDbg() << "TICK_DEBUG ticking mLinkMgr";
 #endif
-	mLinkMgr->tick();
+	{
+		RsProfiler::ScopedSample sample(
+		            RsProfiler::childSection(linkMgrSection, "link manager") );
+		mLinkMgr->tick();
+	}
 #ifdef TICK_DEBUG
 	RsDbg() << "TICK_DEBUG ticking mNetMgr";
 #endif
-	mNetMgr->tick();
+	{
+		RsProfiler::ScopedSample sample(
+		            RsProfiler::childSection(netMgrSection, "net manager") );
+		mNetMgr->tick();
+	}
 
 
 // stuff we do every second
@@ -194,6 +218,8 @@ void RsServer::threadTick()
 #endif
 			rsPlugins->slowTickPlugins((rstime_t)ts);
 		}
+		RsProfiler::tickDump();
+
 		// UDP keepalive
 		// tou_tick_stunkeepalive();
 		// other stuff to tick
@@ -25,6 +25,7 @@
 
 #include "pqi/authgpg.h"
 #include "pqi/authssl.h"
+#include "util/rsprofiler.h"
 
 RsServerConfig *rsConfig = NULL;
 
@@ -562,3 +563,25 @@ void p3ServerConfig::setIsIdle(bool isIdle)
 	mIsIdle = isIdle;
 }
 
+void p3ServerConfig::setProfilerEnabled(
+        bool enable, const std::string& dumpFile, uint32_t dumpIntervalSecs )
+{
+	RsProfiler::setDumpFile(dumpFile, dumpIntervalSecs);
+	RsProfiler::setEnabled(enable);
+}
+
+bool p3ServerConfig::isProfilerEnabled() { return RsProfiler::isEnabled(); }
+
+void p3ServerConfig::getProfilerStatistics(
+        std::vector<RsProfilerSectionStats>& stats, bool reset )
+{ RsProfiler::getStatistics(stats, reset); }
+
+void p3ServerConfig::setLockProfilingEnabled(bool enable)
+{ RsMutex::setContentionProfiling(enable); }
+
+bool p3ServerConfig::isLockProfilingEnabled()
+{ return RsMutex::contentionProfiling(); }
+
+void p3ServerConfig::getLockContentionStats(
+        std::vector<RsMutexContentionStats>& stats, uint32_t topN, bool reset )
+{ RsMutex::getContentionStats(stats, topN, reset); }
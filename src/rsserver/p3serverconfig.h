@@ -92,6 +92,18 @@ class p3ServerConfig: public RsServerConfig
 
 	virtual void setIsIdle(bool isIdle) override;
 
+	virtual void setProfilerEnabled(
+	        bool enable, const std::string& dumpFile,
+	        uint32_t dumpIntervalSecs ) override;
+	virtual bool isProfilerEnabled() override;
+	virtual void getProfilerStatistics(
+	        std::vector<RsProfilerSectionStats>& stats, bool reset ) override;
+	virtual void setLockProfilingEnabled(bool enable) override;
+	virtual bool isLockProfilingEnabled() override;
+	virtual void getLockContentionStats(
+	        std::vector<RsMutexContentionStats>& stats, uint32_t topN,
+	        bool reset ) override;
+
 	/********************* ABOVE is RsConfig Interface *******/
 
 private:
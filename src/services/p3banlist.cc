@@ -34,6 +34,8 @@
 
 #include <sys/time.h>
 #include <sstream>
+#include <fstream>
+#include <algorithm>
 
 /****
  * #define DEBUG_BANLIST		1
@@ -66,6 +68,8 @@ p3BanList::p3BanList(p3ServiceControl *sc, p3NetMgr */*nm*/)
   , mIPFilteringEnabled(true)
   , mIPFriendGatheringEnabled(false)
   , mIPDHTGatheringEnabled(false)
+  , mBlockListsLoaded(true)
+  , mFilter(std::make_shared<BanListFilter>())
 { addSerialType(new RsBanListSerialiser()); }
 
 const std::string BANLIST_APP_NAME = "banlist";
@@ -85,12 +89,27 @@ RsServiceInfo p3BanList::getServiceInfo()
 }
 
 bool p3BanList::ipFilteringEnabled() { return mIPFilteringEnabled ; }
-void p3BanList::enableIPFiltering(bool b) { mIPFilteringEnabled = b ; }
-void p3BanList::enableIPsFromFriends(bool b) { mIPFriendGatheringEnabled = b; mLastDhtInfoRequest=0;}
-void p3BanList::enableIPsFromDHT(bool b)
+void p3BanList::enableIPFiltering(bool b)
+{
+    RS_STACK_MUTEX(mBanMtx) ;
+    mIPFilteringEnabled = b ;
+    updateFilter_locked() ;
+}
+void p3BanList::enableIPsFromFriends(bool b)
 {
-    mIPDHTGatheringEnabled = b;
+    RS_STACK_MUTEX(mBanMtx) ;
+    mIPFriendGatheringEnabled = b;
     mLastDhtInfoRequest=0;
+    updateFilter_locked() ;
+}
+void p3BanList::enableIPsFromDHT(bool b)
+{
+    {
+        RS_STACK_MUTEX(mBanMtx) ;
+        mIPDHTGatheringEnabled = b;
+        mLastDhtInfoRequest=0;
+        updateFilter_locked() ;
+    }
 
     IndicateConfigChanged();
 }
@@ -214,7 +233,11 @@ void p3BanList::autoFigureOutBanRanges()
 
     IndicateConfigChanged();
 
-	if(!mAutoRangeIps) return;
+	if(!mAutoRangeIps)
+	{
+		condenseBanSources_locked() ;	// publishes the filter without the auto ranges
+		return;
+	}
 
 #ifdef DEBUG_BANLIST
     std::cerr << "Automatically figuring out IP ranges from banned IPs." << std::endl;
@@ -315,31 +338,28 @@ bool p3BanList::isAddressAccepted(
 
 	sockaddr_storage addr; sockaddr_storage_copy(dAddr, addr);
 
-	if(!sockaddr_storage_ipv6_to_ipv4(addr)) return true;
+	// IPv6 addresses can only be found in imported block lists: there is no
+	// way to white list them yet, so they are never asked to be.
+	bool ipv4 = sockaddr_storage_ipv6_to_ipv4(addr);
+
 	if(sockaddr_storage_isLoopbackNet(addr)) return true;
 
+	uint8_t key[16];
+	if(!RsIpPrefixTrie::toKey(addr,key)) return true;
 
-	RS_STACK_MUTEX(mBanMtx);
+	// No mBanMtx here: this is called on every connection attempt and DHT
+	// contact, and the filter is never modified once published.
+	std::shared_ptr<const BanListFilter> filter = std::atomic_load(&mFilter);
 
-	if(!mIPFilteringEnabled) return true;
+	if(!filter->enabled) return true;
 
 #ifdef DEBUG_BANLIST
     std::cerr << "isAddressAccepted(): tested addr=" << sockaddr_storage_iptostring(addr) << ", checking flags=" << checking_flags ;
 #endif
 
-    // we should normally work this including entire ranges of IPs. For now, just check the exact IPs.
-
-    sockaddr_storage addr_32 = makeBitsRange(addr,0) ;	// this is necessay because it cleans the address
-    sockaddr_storage addr_24 = makeBitsRange(addr,1) ;
-    sockaddr_storage addr_16 = makeBitsRange(addr,2) ;
-
-    bool white_list_found = false ;
+    uint32_t index ;
 
-    white_list_found = white_list_found || (mWhiteListedRanges.find(addr_16) != mWhiteListedRanges.end()) ;
-    white_list_found = white_list_found || (mWhiteListedRanges.find(addr_24) != mWhiteListedRanges.end()) ;
-    white_list_found = white_list_found || (mWhiteListedRanges.find(addr_32) != mWhiteListedRanges.end()) ;
-
-    if(white_list_found)
+    if(ipv4 && filter->whitelist.lookup(key,index))
 	{
 		check_result = RSBANLIST_CHECK_RESULT_ACCEPTED;
 #ifdef DEBUG_BANLIST
@@ -348,7 +368,7 @@ bool p3BanList::isAddressAccepted(
         return true ;
     }
 
-    if(checking_flags & RSBANLIST_CHECKING_FLAGS_WHITELIST)
+    if(ipv4 && (checking_flags & RSBANLIST_CHECKING_FLAGS_WHITELIST))
 	{
 		check_result = RSBANLIST_CHECK_RESULT_NOT_WHITELISTED;
 #ifdef DEBUG_BANLIST
@@ -366,47 +386,24 @@ bool p3BanList::isAddressAccepted(
         return true;
     }
 
-    std::map<sockaddr_storage,BanListPeer>::iterator it ;
-
-    if(((it=mBanRanges.find(addr_16)) != mBanRanges.end()) && acceptedBanRanges_locked(it->second))
+    if(filter->blacklist.lookup(key,index))
     {
-        ++it->second.connect_attempts;
-#ifdef DEBUG_BANLIST
-      std::cerr << " found in blacklisted range " << sockaddr_storage_iptostring(it->first) << "/16. returning false. attempts=" << it->second.connect_attempts << std::endl;
-#endif
-	    check_result = RSBANLIST_CHECK_RESULT_BLACKLISTED;
-      return false ;
-  }
-
-  if(((it=mBanRanges.find(addr_24)) != mBanRanges.end()) && acceptedBanRanges_locked(it->second))
-  {
-      ++it->second.connect_attempts;
+        countConnectAttempt(filter->entries[index]) ;
 #ifdef DEBUG_BANLIST
-      std::cerr << " found in blacklisted range " << sockaddr_storage_iptostring(it->first) << "/24.  returning false. attempts=" << it->second.connect_attempts << std::endl;
-#endif
-	    check_result = RSBANLIST_CHECK_RESULT_BLACKLISTED;
-      return false ;
-  }
-
-  if(((it=mBanRanges.find(addr_32)) != mBanRanges.end()) && acceptedBanRanges_locked(it->second))
-  {
-      ++it->second.connect_attempts;
-#ifdef DEBUG_BANLIST
-      std::cerr << " found in blacklisted range " << sockaddr_storage_iptostring(it->first) << "/32.  returning false. attempts=" << it->second.connect_attempts << std::endl;
+      std::cerr << " found in blacklisted range " << sockaddr_storage_iptostring(filter->entries[index].key) << ". returning false." << std::endl;
 #endif
 	    check_result = RSBANLIST_CHECK_RESULT_BLACKLISTED;
         return false ;
     }
 
-    if((it=mBanSet.find(addr_32)) != mBanSet.end() && acceptedBanSet_locked(it->second))
+    if(filter->imported && filter->imported->lookup(key,index))
     {
-        ++it->second.connect_attempts;
 #ifdef DEBUG_BANLIST
-      std::cerr << "found as blacklisted address " << sockaddr_storage_iptostring(it->first) << ".  returning false. attempts=" << it->second.connect_attempts << std::endl;
+      std::cerr << " found in imported block list " << index << ". returning false." << std::endl;
 #endif
 	    check_result = RSBANLIST_CHECK_RESULT_BLACKLISTED;
-      return false ;
-  }
+        return false ;
+    }
 
 #ifdef DEBUG_BANLIST
   std::cerr << " not blacklisted. Accepting." << std::endl;
@@ -415,6 +412,260 @@ bool p3BanList::isAddressAccepted(
     return true ;
 }
 
+void p3BanList::countConnectAttempt(const BanListFilter::Entry& e)
+{
+    RS_STACK_MUTEX(mBanMtx) ;
+
+    std::map<sockaddr_storage,BanListPeer>& lst(e.range ? mBanRanges : mBanSet) ;
+    std::map<sockaddr_storage,BanListPeer>::iterator it = lst.find(e.key) ;
+
+    // the entry may have gone since the filter was built
+    if(it != lst.end())
+        ++it->second.connect_attempts;
+}
+
+void p3BanList::updateFilter_locked()
+{
+    std::shared_ptr<BanListFilter> filter = std::make_shared<BanListFilter>() ;
+
+    filter->enabled = mIPFilteringEnabled ;
+    filter->imported = mImportedRanges ;
+
+    // Keys of ranges have the masked bytes set to 255. The trie ignores bits past the prefix.
+
+    for(std::map<sockaddr_storage,BanListPeer>::const_iterator it(mWhiteListedRanges.begin());it!=mWhiteListedRanges.end();++it)
+        filter->whitelist.insert(it->first, 32 - 8*it->second.masked_bytes, 0) ;
+
+    // Only entries that are currently enforced go in, so that the longest match is always a ban.
+
+    for(std::map<sockaddr_storage,BanListPeer>::const_iterator it(mBanSet.begin());it!=mBanSet.end();++it)
+        if(acceptedBanSet_locked(it->second))
+        {
+            BanListFilter::Entry e = { it->first, false } ;
+
+            if(filter->blacklist.insert(it->first, 32, filter->entries.size()))
+                filter->entries.push_back(e) ;
+        }
+
+    for(std::map<sockaddr_storage,BanListPeer>::const_iterator it(mBanRanges.begin());it!=mBanRanges.end();++it)
+        if(acceptedBanRanges_locked(it->second))
+        {
+            BanListFilter::Entry e = { it->first, true } ;
+
+            if(filter->blacklist.insert(it->first, 32 - 8*it->second.masked_bytes, filter->entries.size()))
+                filter->entries.push_back(e) ;
+        }
+
+    std::atomic_store(&mFilter, std::shared_ptr<const BanListFilter>(filter)) ;
+}
+
+// Dotted IPv4 address in host byte order. Unlike inet_pton(), accepts the
+// zero padded addresses of DAT files ("001.002.003.004") and surrounding blanks.
+static bool parseIPv4(const std::string& s, uint32_t& addr)
+{
+    unsigned int b[4] ;
+    char extra ;
+
+    if(sscanf(s.c_str()," %u.%u.%u.%u %c",&b[0],&b[1],&b[2],&b[3],&extra) != 4)
+        return false ;
+
+    if(b[0] > 255 || b[1] > 255 || b[2] > 255 || b[3] > 255)
+        return false ;
+
+    addr = (b[0] << 24) | (b[1] << 16) | (b[2] << 8) | b[3] ;
+    return true ;
+}
+
+// "first-last" IPv4 range, in host byte order
+static bool parseIPv4Range(const std::string& s, uint32_t& first, uint32_t& last)
+{
+    std::string::size_type dash = s.find('-') ;
+
+    return dash != std::string::npos && parseIPv4(s.substr(0,dash),first)
+            && parseIPv4(s.substr(dash+1),last) && first <= last ;
+}
+
+bool p3BanList::parseBlockList(const std::string& path, uint32_t value, RsIpPrefixTrie& trie, uint32_t& count)
+{
+    std::ifstream in(path.c_str()) ;
+
+    if(!in)
+    {
+        RsErr() << "Cannot read IP block list " << path ;
+        return false ;
+    }
+
+    count = 0 ;
+    std::string line ;
+    uint8_t key[16] ;
+    uint8_t len ;
+
+    while(std::getline(in,line))
+    {
+        std::string::size_type pos = line.find_first_not_of(" \t\r") ;
+        if(pos == std::string::npos || line[pos] == '#')
+            continue ;
+
+        line = line.substr(pos, line.find_last_not_of(" \t\r") + 1 - pos) ;
+
+        uint32_t a,b ;
+
+        // P2P format: "name:first-last". The name may contain ':', '-' and ',' but
+        // IPv4 ranges have no ':', so the range starts after the last one.
+
+        std::string::size_type colon = line.rfind(':') ;
+
+        if(!parseIPv4Range(colon == std::string::npos ? line : line.substr(colon+1),a,b))
+        {
+            pos = line.find(',') ;
+
+            if(pos == std::string::npos)
+            {
+                // CIDR prefix or single address, IPv4 or IPv6
+
+                if(RsIpPrefixTrie::parsePrefix(line,key,len))
+                {
+                    trie.insert(key,len,value) ;
+                    ++count ;
+                }
+                continue ;
+            }
+
+            // DAT format: "first - last , level , name". Levels of 127 and above allow the range.
+
+            std::string::size_type end = line.find(',',pos+1) ;
+            std::string level = line.substr(pos+1, end == std::string::npos ? std::string::npos : end-pos-1) ;
+            char *level_end = NULL ;
+            long l = strtol(level.c_str(),&level_end,10) ;
+
+            if(level_end != level.c_str() && l >= 127)
+                continue ;
+
+            if(!parseIPv4Range(line.substr(0,pos),a,b))
+                continue ;
+        }
+
+        std::list<std::pair<uint32_t,uint8_t> > prefixes ;
+        RsIpPrefixTrie::rangeToPrefixes(a,b,prefixes) ;
+
+        for(std::list<std::pair<uint32_t,uint8_t> >::const_iterator it(prefixes.begin());it!=prefixes.end();++it)
+        {
+            memset(key,0,10) ;
+            key[10] = key[11] = 0xff ;
+            key[12] = it->first >> 24 ;
+            key[13] = it->first >> 16 ;
+            key[14] = it->first >> 8 ;
+            key[15] = it->first ;
+
+            trie.insert(key,96 + it->second,value) ;
+            ++count ;
+        }
+    }
+
+    return true ;
+}
+
+void p3BanList::loadBlockLists(std::map<std::string,uint32_t> *counts)
+{
+    std::list<std::string> files ;
+    {
+        RS_STACK_MUTEX(mBanMtx) ;
+        files = mBlockListFiles ;
+        mBlockListsLoaded = true ;
+    }
+
+    // Parsed outside of the mutex: public lists have hundreds of thousands of entries.
+
+    std::shared_ptr<RsIpPrefixTrie> trie = std::make_shared<RsIpPrefixTrie>() ;
+    uint32_t n = 0 ;
+
+    for(std::list<std::string>::const_iterator it(files.begin());it!=files.end();++it,++n)
+    {
+        uint32_t count = 0 ;
+
+        if(parseBlockList(*it,n,*trie,count))
+        {
+            std::cerr << "(II) loaded " << count << " IP ranges from block list " << *it << std::endl;
+
+            if(counts)
+                (*counts)[*it] = count ;
+        }
+    }
+
+    RS_STACK_MUTEX(mBanMtx) ;
+
+    if(mBlockListFiles != files)	// changed meanwhile. The next tick will load again.
+        return ;
+
+    if(trie->size() > 0)
+        mImportedRanges = trie ;
+    else
+        mImportedRanges.reset() ;
+
+    updateFilter_locked() ;
+}
+
+bool p3BanList::importBlockList(const std::string& path, uint32_t& count)
+{
+    bool added = false ;
+    {
+        RS_STACK_MUTEX(mBanMtx) ;
+
+        if(std::find(mBlockListFiles.begin(),mBlockListFiles.end(),path) == mBlockListFiles.end())
+        {
+            mBlockListFiles.push_back(path) ;
+            added = true ;
+        }
+    }
+
+    // the new file is parsed once, along with the others
+    std::map<std::string,uint32_t> counts ;
+    loadBlockLists(&counts) ;
+
+    std::map<std::string,uint32_t>::const_iterator it = counts.find(path) ;
+
+    if(it == counts.end())
+    {
+        // Unreadable: it added nothing to the filter, and being last it did not shift the others.
+        if(added)
+        {
+            RS_STACK_MUTEX(mBanMtx) ;
+            mBlockListFiles.remove(path) ;
+        }
+        return false ;
+    }
+
+    count = it->second ;
+    IndicateConfigChanged() ;
+
+    return true ;
+}
+
+bool p3BanList::removeBlockList(const std::string& path)
+{
+    {
+        RS_STACK_MUTEX(mBanMtx) ;
+
+        std::list<std::string>::iterator it = std::find(mBlockListFiles.begin(),mBlockListFiles.end(),path) ;
+
+        if(it == mBlockListFiles.end())
+            return false ;
+
+        mBlockListFiles.erase(it) ;
+    }
+
+    loadBlockLists() ;
+    IndicateConfigChanged() ;
+
+    return true ;
+}
+
+void p3BanList::getBlockLists(std::list<std::string>& paths)
+{
+    RS_STACK_MUTEX(mBanMtx) ;
+    paths = mBlockListFiles ;
+}
+
 void p3BanList::getWhiteListedIps(std::list<BanListPeer> &lst)
 {
     RS_STACK_MUTEX(mBanMtx) ;
@@ -562,6 +813,14 @@ int p3BanList::tick()
     processIncoming();
     sendPackets();
 
+    bool load_block_lists ;
+    {
+        RS_STACK_MUTEX(mBanMtx) ;
+        load_block_lists = !mBlockListsLoaded ;
+    }
+    if(load_block_lists)
+        loadBlockLists() ;
+
     rstime_t now = time(NULL) ;
 
     if(mLastDhtInfoRequest + RSBANLIST_DELAY_BETWEEN_TALK_TO_DHT < now)
@@ -813,6 +1072,13 @@ bool p3BanList::saveList(bool &cleanup, std::list<RsItem*>& itemlist)
     kv.value = os.str() ;
     vitem->tlvkvs.pairs.push_back(kv) ;
 
+    for(std::list<std::string>::const_iterator it(mBlockListFiles.begin());it!=mBlockListFiles.end();++it)
+    {
+        kv.key = "IP_FILTERING_BLOCK_LIST" ;
+        kv.value = *it ;
+        vitem->tlvkvs.pairs.push_back(kv) ;
+    }
+
     itemlist.push_back(vitem) ;
 
     return true ;
@@ -834,6 +1100,12 @@ bool p3BanList::loadList(std::list<RsItem*>& load)
                 if(it2->key == "IP_FILTERING_FRIEND_GATHERING_ENABLED") mIPFriendGatheringEnabled = (it2->value=="TRUE") ;
                 if(it2->key == "IP_FILTERING_DHT_GATHERING_ENABLED") mIPDHTGatheringEnabled = (it2->value=="TRUE") ;
 
+                if(it2->key == "IP_FILTERING_BLOCK_LIST")
+                {
+                    mBlockListFiles.push_back(it2->value) ;
+                    mBlockListsLoaded = false ;	// parsed on next tick
+                }
+
                 if(it2->key == "IP_FILTERING_AUTORANGE_IPS_LIMIT")
         {
             int val ;
@@ -905,6 +1177,8 @@ bool p3BanList::loadList(std::list<RsItem*>& load)
         delete *it ;
     }
 
+    updateFilter_locked() ;
+
     load.clear() ;
     return true ;
 }
@@ -1139,6 +1413,8 @@ int p3BanList::condenseBanSources_locked()
 	printBanSet_locked(std::cerr);
 #endif
 
+	updateFilter_locked();
+
 	return true ;
 }
 
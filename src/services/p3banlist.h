@@ -25,10 +25,13 @@
 #include <string>
 #include <list>
 #include <map>
+#include <vector>
+#include <memory>
 
 #include "rsitems/rsbanlistitems.h"
 #include "services/p3service.h"
 #include "retroshare/rsbanlist.h"
+#include "util/rsiptrie.h"
 
 class p3ServiceControl;
 class p3NetMgr;
@@ -42,11 +45,34 @@ class BanList
 	std::map<struct sockaddr_storage, BanListPeer> mBanPeers;
 };
 
+/**
+ * Read-only copy of the filtering tables, used by isAddressAccepted() without
+ * locking. It is never modified once published: every change builds a new one.
+ */
+class BanListFilter
+{
+	public:
+	BanListFilter() : enabled(true) {}
+
+	struct Entry
+	{
+		struct sockaddr_storage key;	// key in p3BanList::mBanRanges or mBanSet
+		bool range;
+	};
+
+	bool enabled;
+	RsIpPrefixTrie whitelist;
+	RsIpPrefixTrie blacklist;	// value is the index of the matching entry
+	std::vector<Entry> entries;
+	std::shared_ptr<const RsIpPrefixTrie> imported;	// from the imported block lists
+};
+
 /**
  * The RS BanList service.
  * Exchange list of Banned IPv4 addresses with peers.
  *
- * @warning IPv4 only, IPv6 not supported yet!
+ * @warning IPv6 addresses are only filtered by the imported block lists: ban
+ * lists exchanged with peers, user ranges and white lists are IPv4 only.
  */
 class p3BanList: public RsBanList, public p3Service, public pqiNetAssistPeerShare, public p3Config /*, public pqiMonitor */
 {
@@ -85,6 +111,10 @@ public:
     virtual void enableIPsFromDHT(bool b) ;
     virtual bool iPsFromDHTEnabled() { return mIPDHTGatheringEnabled ;}
 
+    virtual bool importBlockList(const std::string& path, uint32_t& count) ;
+    virtual bool removeBlockList(const std::string& path) ;
+    virtual void getBlockLists(std::list<std::string>& paths) ;
+
     /***** overloaded from pqiNetAssistPeerShare *****/
 
 	virtual void updatePeer( const RsPeerId& id, const sockaddr_storage &addr,
@@ -143,6 +173,10 @@ private:
     int printBanSources_locked(std::ostream &out);
     int printBanSet_locked(std::ostream &out);
     bool isWhiteListed_locked(const sockaddr_storage &addr);
+    void updateFilter_locked();
+    void countConnectAttempt(const BanListFilter::Entry& e);
+    void loadBlockLists(std::map<std::string,uint32_t> *counts = NULL);
+    static bool parseBlockList(const std::string& path, uint32_t value, RsIpPrefixTrie& trie, uint32_t& count);
 
     p3ServiceControl *mServiceCtrl;
     //p3NetMgr *mNetMgr;
@@ -152,6 +186,13 @@ private:
     std::map<struct sockaddr_storage, BanListPeer> mBanRanges;
     std::map<struct sockaddr_storage, BanListPeer> mWhiteListedRanges;
 
+    std::list<std::string> mBlockListFiles;
+    std::shared_ptr<const RsIpPrefixTrie> mImportedRanges;
+    bool mBlockListsLoaded;
+
+    // Swapped with std::atomic_store() under mBanMtx, read with std::atomic_load() without it.
+    std::shared_ptr<const BanListFilter> mFilter;
+
     rstime_t mLastDhtInfoRequest ;
 
     uint32_t mAutoRangeLimit ;
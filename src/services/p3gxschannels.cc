@@ -299,7 +299,7 @@ void p3GxsChannels::notifyChanges(std::vector<RsGxsNotify *> &changes)
                         else
                             ev->mChannelEventCode = RsChannelEventCode::NEW_MESSAGE;
 
-					rsEvents->postEvent(ev);
+					postChangeEvent(ev);
 				}
 			}
 
@@ -344,7 +344,7 @@ void p3GxsChannels::notifyChanges(std::vector<RsGxsNotify *> &changes)
 				auto ev = std::make_shared<RsGxsChannelEvent>();
 				ev->mChannelGroupId = grpChange->mGroupId;
 				ev->mChannelEventCode = RsChannelEventCode::SUBSCRIBE_STATUS_CHANGED;
-                rsEvents->postEvent(ev);
+                postChangeEvent(ev);
 
                 unprocessedGroups.insert(grpChange->mGroupId);
             }
@@ -355,7 +355,7 @@ void p3GxsChannels::notifyChanges(std::vector<RsGxsNotify *> &changes)
                 auto ev = std::make_shared<RsGxsChannelEvent>();
                 ev->mChannelGroupId = grpChange->mGroupId;
                 ev->mChannelEventCode = RsChannelEventCode::SYNC_PARAMETERS_UPDATED;
-                rsEvents->postEvent(ev);
+                postChangeEvent(ev);
 
                 unprocessedGroups.insert(grpChange->mGroupId);
             }
@@ -366,7 +366,7 @@ void p3GxsChannels::notifyChanges(std::vector<RsGxsNotify *> &changes)
 				auto ev = std::make_shared<RsGxsChannelEvent>();
 				ev->mChannelGroupId = grpChange->mGroupId;
 				ev->mChannelEventCode = RsChannelEventCode::STATISTICS_CHANGED;
-				rsEvents->postEvent(ev);
+				postChangeEvent(ev);
 
                 // also update channel usage. Statistics are updated when a friend sends some sync packets
                 RS_STACK_MUTEX(mKnownChannelsMutex);
@@ -380,7 +380,7 @@ void p3GxsChannels::notifyChanges(std::vector<RsGxsNotify *> &changes)
                 auto ev = std::make_shared<RsGxsChannelEvent>();
                 ev->mChannelGroupId = grpChange->mGroupId;
                 ev->mChannelEventCode = RsChannelEventCode::UPDATED_CHANNEL;
-                rsEvents->postEvent(ev);
+                postChangeEvent(ev);
 
                 unprocessedGroups.insert(grpChange->mGroupId);
             }
@@ -411,7 +411,7 @@ void p3GxsChannels::notifyChanges(std::vector<RsGxsNotify *> &changes)
 					auto ev = std::make_shared<RsGxsChannelEvent>();
 					ev->mChannelGroupId = grpChange->mGroupId;
 					ev->mChannelEventCode = RsChannelEventCode::NEW_CHANNEL;
-					rsEvents->postEvent(ev);
+					postChangeEvent(ev);
                 }
 #ifdef GXSCHANNEL_DEBUG
 				else
@@ -427,7 +427,7 @@ void p3GxsChannels::notifyChanges(std::vector<RsGxsNotify *> &changes)
                     auto ev = std::make_shared<RsGxsChannelEvent>();
                     ev->mChannelGroupId = grpChange->mGroupId;
                     ev->mChannelEventCode = RsChannelEventCode::DELETED_CHANNEL;
-                    rsEvents->postEvent(ev);
+                    postChangeEvent(ev);
 
                 unprocessedGroups.insert(grpChange->mGroupId);
             }
@@ -440,7 +440,7 @@ void p3GxsChannels::notifyChanges(std::vector<RsGxsNotify *> &changes)
 				ev->mChannelGroupId = grpChange->mGroupId;
 				ev->mChannelEventCode = RsChannelEventCode::RECEIVED_PUBLISH_KEY;
 
-				rsEvents->postEvent(ev);
+				postChangeEvent(ev);
 
                 unprocessedGroups.insert(grpChange->mGroupId);
             }
@@ -464,6 +464,19 @@ void p3GxsChannels::notifyChanges(std::vector<RsGxsNotify *> &changes)
 		request_SpecificSubscribedGroups(grps);
 }
 
+bool p3GxsChannels::summarizeChangeEvent(
+        const RsEvent& event, RsGxsGroupId& grpId, RsGxsMessageId& msgId,
+        uint8_t& code ) const
+{
+	auto e = dynamic_cast<const RsGxsChannelEvent*>(&event);
+	if(!e) return false;
+
+	grpId = e->mChannelGroupId;
+	msgId = e->mChannelMsgId;
+	code = static_cast<uint8_t>(e->mChannelEventCode);
+	return true;
+}
+
 void	p3GxsChannels::service_tick()
 {
 	static rstime_t last_dummy_tick = 0;
@@ -2830,6 +2843,9 @@ bool p3GxsChannels::localSearchRequest(
 
 void p3GxsChannels::receiveDistantSearchResults( TurtleRequestId id, const RsGxsGroupId& grpId )
 {
+	// Accounted in the RsGxsChanges summaries
+	RsGenExchange::receiveDistantSearchResults(id, grpId);
+
 	if(!rsEvents)
 		return;
 
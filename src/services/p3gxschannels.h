@@ -84,6 +84,11 @@ protected:
     virtual RsGenExchange::ServiceCreate_Return service_CreateGroup(RsGxsGrpItem* grpItem, RsTlvSecurityKeySet& keySet) override;
 
     virtual void notifyChanges(std::vector<RsGxsNotify*>& changes) override;
+
+    /// @see RsGenExchange
+    bool summarizeChangeEvent(
+            const RsEvent& event, RsGxsGroupId& grpId, RsGxsMessageId& msgId,
+            uint8_t& code ) const override;
     virtual bool keepOldMsgVersions() const override { return netService()->syncOldMsgVersions(); }
 
     // Overloaded from RsTickEvent.
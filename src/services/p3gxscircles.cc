@@ -738,12 +738,12 @@ void p3GxsCircles::notifyChanges(std::vector<RsGxsNotify *> &changes)
 					if (item->subscription_type == RsGxsCircleSubscriptionType::UNSUBSCRIBE)
 					{
 						ev->mCircleEventType = RsGxsCircleEventCode::CIRCLE_MEMBERSHIP_LEAVE;
-						rsEvents->postEvent(ev);
+						postChangeEvent(ev);
 					}
 					else if(item->subscription_type == RsGxsCircleSubscriptionType::SUBSCRIBE)
 					{
 						ev->mCircleEventType = RsGxsCircleEventCode::CIRCLE_MEMBERSHIP_REQUEST;
-						rsEvents->postEvent(ev);
+						postChangeEvent(ev);
 					}
                     else
                         RsErr() << __PRETTY_FUNCTION__ << " Unknown subscription request type " << static_cast<uint32_t>(item->subscription_type) << " in msg item" << std::endl;
@@ -805,7 +805,7 @@ void p3GxsCircles::notifyChanges(std::vector<RsGxsNotify *> &changes)
 					ev->mCircleId = RsGxsCircleId(*git);
 					ev->mCircleEventType = RsGxsCircleEventCode::NEW_CIRCLE;
 
-					rsEvents->postEvent(ev);
+					postChangeEvent(ev);
 
                     // we also need to look into invitee list here!
 
@@ -820,7 +820,7 @@ void p3GxsCircles::notifyChanges(std::vector<RsGxsNotify *> &changes)
 							ev->mCircleId = RsGxsCircleId(*git);
 							ev->mGxsId = gxs_id;
 
-                            rsEvents->postEvent(ev);
+                            postChangeEvent(ev);
 						}
                 }
                 else if(c->getType()==RsGxsNotify::TYPE_UPDATED)
@@ -850,7 +850,7 @@ void p3GxsCircles::notifyChanges(std::vector<RsGxsNotify *> &changes)
 							ev->mCircleId = circle_id;
 							ev->mGxsId = gxs_id;
 
-                            rsEvents->postEvent(ev);
+                            postChangeEvent(ev);
 						}
 
 					for(auto& gxs_id: old_circle_grp_item->gxsIdSet.ids)
@@ -862,7 +862,7 @@ void p3GxsCircles::notifyChanges(std::vector<RsGxsNotify *> &changes)
 							ev->mCircleId = circle_id;
 							ev->mGxsId = gxs_id;
 
-                            rsEvents->postEvent(ev);
+                            postChangeEvent(ev);
 						}
 
                     if(  old_circle_grp_item->meta.mGroupName     != new_circle_grp_item->meta.mGroupName
@@ -874,7 +874,7 @@ void p3GxsCircles::notifyChanges(std::vector<RsGxsNotify *> &changes)
                         auto ev = std::make_shared<RsGxsCircleEvent>();
                         ev->mCircleId = RsGxsCircleId(new_circle_grp_item->meta.mGroupId);
                         ev->mCircleEventType = RsGxsCircleEventCode::CIRCLE_UPDATED;
-                        rsEvents->postEvent(ev);
+                        postChangeEvent(ev);
                     }
                 }
                 else if(c->getType()==RsGxsNotify::TYPE_GROUP_DELETED)
@@ -884,7 +884,7 @@ void p3GxsCircles::notifyChanges(std::vector<RsGxsNotify *> &changes)
                     ev->mCircleEventType = RsGxsCircleEventCode::CIRCLE_DELETED;
                     ev->mCircleId = RsGxsCircleId(groupChange->mGroupId);
 
-                    rsEvents->postEvent(ev);
+                    postChangeEvent(ev);
                 }
             }
         }
@@ -896,6 +896,19 @@ void p3GxsCircles::notifyChanges(std::vector<RsGxsNotify *> &changes)
         force_cache_reload(circle_id);
 }
 
+bool p3GxsCircles::summarizeChangeEvent(
+        const RsEvent& event, RsGxsGroupId& grpId, RsGxsMessageId& msgId,
+        uint8_t& code ) const
+{
+	auto e = dynamic_cast<const RsGxsCircleEvent*>(&event);
+	if(!e) return false;
+
+	grpId = RsGxsGroupId(e->mCircleId);
+	msgId.clear();
+	code = static_cast<uint8_t>(e->mCircleEventType);
+	return true;
+}
+
 //====================================================================================//
 //                            Synchroneous API using cache storage                    //
 //====================================================================================//
@@ -323,6 +323,11 @@ protected:
 	/** Notifications **/
 	virtual void notifyChanges(std::vector<RsGxsNotify*>& changes) override;
 
+	/// @see RsGenExchange
+	bool summarizeChangeEvent(
+	        const RsEvent& event, RsGxsGroupId& grpId, RsGxsMessageId& msgId,
+	        uint8_t& code ) const override;
+
 	/** Overloaded to add PgpIdHash to Group Definition **/
 	virtual ServiceCreate_Return service_CreateGroup(RsGxsGrpItem* grpItem, RsTlvSecurityKeySet& keySet) override;
 
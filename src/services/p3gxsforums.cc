@@ -238,7 +238,7 @@ void p3GxsForums::notifyChanges(std::vector<RsGxsNotify*>& changes)
 					ev->mForumMsgId = msgChange->mMsgId;
 					ev->mForumGroupId = msgChange->mGroupId;
 					ev->mForumEventCode = RsForumEventCode::NEW_MESSAGE;
-					rsEvents->postEvent(ev);
+					postChangeEvent(ev);
 					break;
 				}
 				default:
@@ -264,7 +264,7 @@ void p3GxsForums::notifyChanges(std::vector<RsGxsNotify*>& changes)
 					auto ev = std::make_shared<RsGxsForumEvent>();
 					ev->mForumGroupId = gxsChange->mGroupId;
 					ev->mForumEventCode = RsForumEventCode::NEW_FORUM;
-					rsEvents->postEvent(ev);
+					postChangeEvent(ev);
 				}
 
 #ifdef RS_DEEP_FORUMS_INDEX
@@ -293,7 +293,7 @@ void p3GxsForums::notifyChanges(std::vector<RsGxsNotify*>& changes)
 			auto ev = std::make_shared<RsGxsForumEvent>();
 			ev->mForumGroupId = gxsChange->mGroupId;
 			ev->mForumEventCode = RsForumEventCode::SUBSCRIBE_STATUS_CHANGED;
-			rsEvents->postEvent(ev);
+			postChangeEvent(ev);
 			break;
 		}
 		case RsGxsNotify::TYPE_GROUP_SYNC_PARAMETERS_UPDATED:
@@ -301,7 +301,7 @@ void p3GxsForums::notifyChanges(std::vector<RsGxsNotify*>& changes)
 			auto ev = std::make_shared<RsGxsForumEvent>();
 			ev->mForumGroupId = gxsChange->mGroupId;
 			ev->mForumEventCode = RsForumEventCode::SYNC_PARAMETERS_UPDATED;
-			rsEvents->postEvent(ev);
+			postChangeEvent(ev);
 			break;
 		}
 		case RsGxsNotify::TYPE_MESSAGE_DELETED:
@@ -334,7 +334,7 @@ void p3GxsForums::notifyChanges(std::vector<RsGxsNotify*>& changes)
 			auto ev = std::make_shared<RsGxsForumEvent>();
 			ev->mForumGroupId = gxsChange->mGroupId;
 			ev->mForumEventCode = RsForumEventCode::DELETED_FORUM;
-			rsEvents->postEvent(ev);
+			postChangeEvent(ev);
 			break;
 		}
 		case RsGxsNotify::TYPE_STATISTICS_CHANGED:
@@ -342,7 +342,7 @@ void p3GxsForums::notifyChanges(std::vector<RsGxsNotify*>& changes)
 			auto ev = std::make_shared<RsGxsForumEvent>();
 			ev->mForumGroupId = gxsChange->mGroupId;
 			ev->mForumEventCode = RsForumEventCode::STATISTICS_CHANGED;
-			rsEvents->postEvent(ev);
+			postChangeEvent(ev);
 
 			RS_STACK_MUTEX(mKnownForumsMutex);
 			mKnownForums[gxsChange->mGroupId] = time(nullptr);
@@ -398,7 +398,7 @@ void p3GxsForums::notifyChanges(std::vector<RsGxsNotify*>& changes)
 				ev->mModeratorsRemoved = removed_mods;
 				ev->mForumEventCode = RsForumEventCode::MODERATOR_LIST_CHANGED;
 
-				rsEvents->postEvent(ev);
+				postChangeEvent(ev);
 			}
 
 			// check the list of pinned posts
@@ -419,7 +419,7 @@ void p3GxsForums::notifyChanges(std::vector<RsGxsNotify*>& changes)
 				auto ev = std::make_shared<RsGxsForumEvent>();
 				ev->mForumGroupId = new_forum_grp_item->meta.mGroupId;
 				ev->mForumEventCode = RsForumEventCode::PINNED_POSTS_CHANGED;
-				rsEvents->postEvent(ev);
+				postChangeEvent(ev);
 			}
 
 			if( old_forum_grp_item->mGroup.mDescription != new_forum_grp_item->mGroup.mDescription
@@ -431,7 +431,7 @@ void p3GxsForums::notifyChanges(std::vector<RsGxsNotify*>& changes)
 				auto ev = std::make_shared<RsGxsForumEvent>();
 				ev->mForumGroupId = new_forum_grp_item->meta.mGroupId;
 				ev->mForumEventCode = RsForumEventCode::UPDATED_FORUM;
-				rsEvents->postEvent(ev);
+				postChangeEvent(ev);
 			}
 
 			break;
@@ -445,6 +445,19 @@ void p3GxsForums::notifyChanges(std::vector<RsGxsNotify*>& changes)
 	}
 }
 
+bool p3GxsForums::summarizeChangeEvent(
+        const RsEvent& event, RsGxsGroupId& grpId, RsGxsMessageId& msgId,
+        uint8_t& code ) const
+{
+	auto e = dynamic_cast<const RsGxsForumEvent*>(&event);
+	if(!e) return false;
+
+	grpId = e->mForumGroupId;
+	msgId = e->mForumMsgId;
+	code = static_cast<uint8_t>(e->mForumEventCode);
+	return true;
+}
+
 void	p3GxsForums::service_tick()
 {
 	dummy_tick();
@@ -885,6 +898,33 @@ bool p3GxsForums::getForumMsgMetaData(const RsGxsGroupId& forumId, std::vector<R
     return res;
 }
 
+bool p3GxsForums::getForumThreadMsgMetaData(
+        const RsGxsGroupId& forumId, const RsGxsMessageId& threadId,
+        std::vector<RsMsgMetaData>& msgMetas )
+{
+	if(forumId.isNull() || threadId.isNull())
+		return false;
+
+	std::vector<RsGxsGrpMsgIdPair> msgIds;
+	msgIds.push_back(RsGxsGrpMsgIdPair(forumId, threadId));
+
+	// Related requests only load the messages of the thread from the DB
+	RsTokReqOptions opts;
+	opts.mReqType = GXS_REQUEST_TYPE_MSG_RELATED_META;
+	opts.mOptions = RS_TOKREQOPT_MSG_THREAD | RS_TOKREQOPT_MSG_LATEST;
+
+	uint32_t token;
+	if( !requestMsgRelatedInfo(token, opts, msgIds) || waitToken(token,std::chrono::milliseconds(5000)) != RsTokenService::COMPLETE )
+		return false;
+
+	GxsMsgRelatedMetaMap meta_map;
+	bool res = getMsgRelatedMeta(token, meta_map);
+
+	msgMetas = meta_map[RsGxsGrpMsgIdPair(forumId, threadId)];
+
+	return res;
+}
+
 bool p3GxsForums::markRead(const RsGxsGrpMsgIdPair& msgId, bool read)
 {
 	uint32_t token;
@@ -49,6 +49,11 @@ public:
 
 protected:
     virtual void notifyChanges(std::vector<RsGxsNotify*>& changes) override;
+
+    /// @see RsGenExchange
+    bool summarizeChangeEvent(
+            const RsEvent& event, RsGxsGroupId& grpId, RsGxsMessageId& msgId,
+            uint8_t& code ) const override;
 	/// Overloaded from RsTickEvent.
     virtual void handle_event(uint32_t event_type, const std::string &elabel) override;
 
@@ -111,6 +116,11 @@ public:
 	/// @see RsGxsForums::getForumMsgMetaData
     virtual bool getForumMsgMetaData(const RsGxsGroupId& forumId, std::vector<RsMsgMetaData>& msg_metas)  override;
 
+	/// @see RsGxsForums::getForumThreadMsgMetaData
+	bool getForumThreadMsgMetaData(
+	        const RsGxsGroupId& forumId, const RsGxsMessageId& threadId,
+	        std::vector<RsMsgMetaData>& msgMetas ) override;
+
     /// @see RsGxsForums::getForumPostsHierarchy
     virtual bool getForumPostsHierarchy(const RsGxsForumGroup& group,
                                         std::vector<ForumPostEntry>& vect,
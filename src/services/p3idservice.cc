@@ -664,7 +664,7 @@ void p3IdService::notifyChanges(std::vector<RsGxsNotify *> &changes)
                         auto ev = std::make_shared<RsGxsIdentityEvent>();
                         ev->mIdentityId = gid;
                         ev->mIdentityEventCode = RsGxsIdentityEventCode::UPDATED_IDENTITY;
-                        rsEvents->postEvent(ev);
+                        postChangeEvent(ev);
 
 						// also time_stamp the key that this group represents
 						timeStampKey(RsGxsId(gid),RsIdentityUsage(RsServiceType(serviceType()),RsIdentityUsage::IDENTITY_NEW_FROM_GXS_SYNC)) ;
@@ -677,7 +677,7 @@ void p3IdService::notifyChanges(std::vector<RsGxsNotify *> &changes)
                         auto ev = std::make_shared<RsGxsIdentityEvent>();
                         ev->mIdentityId = gid;
                         ev->mIdentityEventCode = RsGxsIdentityEventCode::NEW_IDENTITY;
-                        rsEvents->postEvent(ev);
+                        postChangeEvent(ev);
 
 						// also time_stamp the key that this group represents
 						timeStampKey(RsGxsId(gid),RsIdentityUsage(RsServiceType(serviceType()),RsIdentityUsage::IDENTITY_NEW_FROM_GXS_SYNC)) ;
@@ -724,6 +724,19 @@ void p3IdService::notifyChanges(std::vector<RsGxsNotify *> &changes)
     }
 }
 
+bool p3IdService::summarizeChangeEvent(
+        const RsEvent& event, RsGxsGroupId& grpId, RsGxsMessageId& msgId,
+        uint8_t& code ) const
+{
+	auto e = dynamic_cast<const RsGxsIdentityEvent*>(&event);
+	if(!e) return false;
+
+	grpId = e->mIdentityId;
+	msgId.clear();
+	code = static_cast<uint8_t>(e->mIdentityEventCode);
+	return true;
+}
+
 /********************************************************************************/
 /******************* RsIdentity Interface ***************************************/
 /********************************************************************************/
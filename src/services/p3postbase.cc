@@ -123,7 +123,7 @@ void p3PostBase::notifyChanges(std::vector<RsGxsNotify *> &changes)
                         else
                             ev->mPostedEventCode = RsPostedEventCode::NEW_MESSAGE;
 
-                    rsEvents->postEvent(ev);
+                    postChangeEvent(ev);
 #ifdef POSTBASE_DEBUG
                     std::cerr << "p3PostBase::notifyChanges() Found Message Change Notification: NEW/PUBLISHED ID=" << msgChange->mMsgId << " in group " << msgChange->mGroupId << ", thread ID = " << msgChange->mNewMsgItem->meta.mThreadId << std::endl;
 #endif
@@ -138,7 +138,7 @@ void p3PostBase::notifyChanges(std::vector<RsGxsNotify *> &changes)
                     ev->mPostedMsgId = msgChange->mMsgId;
                     ev->mPostedGroupId = msgChange->mGroupId;
                     ev->mPostedEventCode = RsPostedEventCode::MESSAGE_VOTES_UPDATED;
-                    rsEvents->postEvent(ev);
+                    postChangeEvent(ev);
 #ifdef POSTBASE_DEBUG
                     std::cerr << "p3PostBase::notifyChanges() Found Message Change Notification: PROCESSED ID=" << msgChange->mMsgId << " in group " << msgChange->mGroupId << std::endl;
 #endif
@@ -171,7 +171,7 @@ void p3PostBase::notifyChanges(std::vector<RsGxsNotify *> &changes)
                 auto ev = std::make_shared<RsGxsPostedEvent>();
                 ev->mPostedGroupId = group_id;
                 ev->mPostedEventCode = RsPostedEventCode::SUBSCRIBE_STATUS_CHANGED;
-                rsEvents->postEvent(ev);
+                postChangeEvent(ev);
             }
                 break;
 
@@ -180,7 +180,7 @@ void p3PostBase::notifyChanges(std::vector<RsGxsNotify *> &changes)
                 auto ev = std::make_shared<RsGxsPostedEvent>();
                 ev->mPostedGroupId = group_id;
                 ev->mPostedEventCode = RsPostedEventCode::SYNC_PARAMETERS_UPDATED;
-                rsEvents->postEvent(ev);
+                postChangeEvent(ev);
             }
                 break;
 
@@ -190,7 +190,7 @@ void p3PostBase::notifyChanges(std::vector<RsGxsNotify *> &changes)
                ev->mPostedGroupId = group_id;
                ev->mPostedEventCode = RsPostedEventCode::BOARD_DELETED;
 
-               rsEvents->postEvent(ev);
+               postChangeEvent(ev);
            }
                break;
 
@@ -199,7 +199,7 @@ void p3PostBase::notifyChanges(std::vector<RsGxsNotify *> &changes)
                 auto ev = std::make_shared<RsGxsPostedEvent>();
                 ev->mPostedGroupId = group_id;
                 ev->mPostedEventCode = RsPostedEventCode::STATISTICS_CHANGED;
-                rsEvents->postEvent(ev);
+                postChangeEvent(ev);
 
                 RS_STACK_MUTEX(mKnownPostedMutex);
                 mKnownPosted[group_id] = time(nullptr);
@@ -214,7 +214,7 @@ void p3PostBase::notifyChanges(std::vector<RsGxsNotify *> &changes)
                 auto ev = std::make_shared<RsGxsPostedEvent>();
                 ev->mPostedGroupId = grpChange->mGroupId;
                 ev->mPostedEventCode = RsPostedEventCode::UPDATED_POSTED_GROUP;
-                rsEvents->postEvent(ev);
+                postChangeEvent(ev);
             }
                 break;
 
@@ -237,7 +237,7 @@ void p3PostBase::notifyChanges(std::vector<RsGxsNotify *> &changes)
                     auto ev = std::make_shared<RsGxsPostedEvent>();
                     ev->mPostedGroupId = group_id;
                     ev->mPostedEventCode = RsPostedEventCode::NEW_POSTED_GROUP;
-                    rsEvents->postEvent(ev);
+                    postChangeEvent(ev);
 
 #ifdef POSTBASE_DEBUG
                     std::cerr << "p3PostBase::notifyChanges() Incoming Group: " << group_id;
@@ -261,6 +261,19 @@ void p3PostBase::notifyChanges(std::vector<RsGxsNotify *> &changes)
     }
 }
 
+bool p3PostBase::summarizeChangeEvent(
+        const RsEvent& event, RsGxsGroupId& grpId, RsGxsMessageId& msgId,
+        uint8_t& code ) const
+{
+	auto e = dynamic_cast<const RsGxsPostedEvent*>(&event);
+	if(!e) return false;
+
+	grpId = e->mPostedGroupId;
+	msgId = e->mPostedMsgId;
+	code = static_cast<uint8_t>(e->mPostedEventCode);
+	return true;
+}
+
 void	p3PostBase::service_tick()
 {
 	RsTickEvent::tick_events();
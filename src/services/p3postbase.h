@@ -76,6 +76,11 @@ protected:
 
 	virtual void notifyChanges(std::vector<RsGxsNotify*>& changes) override;
 
+	/// @see RsGenExchange
+	bool summarizeChangeEvent(
+	        const RsEvent& event, RsGxsGroupId& grpId, RsGxsMessageId& msgId,
+	        uint8_t& code ) const override;
+
 	// Overloaded from GxsTokenQueue for Request callbacks.
 	virtual void handleResponse(uint32_t token, uint32_t req_type
 	                            , RsTokenService::GxsRequestStatus status) override;
@@ -49,6 +49,9 @@ RsItem *p3Service::recvItem()
 	RsItem *item = recv_queue.front();
 	recv_queue.pop_front();
 
+	RsProfiler::Section* profile = mRecvQueueProfile;
+	if(profile) profile->setQueueDepth(recv_queue.size());
+
 	return item;
 }
 
@@ -65,9 +68,20 @@ bool p3Service::recvItem(RsItem *item)
 {
 	if (item)
 	{
+		/* Service name is needed only once, so ask for it out of the mutex
+		 * and only if the profiler is enabled */
+		RsProfiler::Section* profile = mRecvQueueProfile;
+		if(!profile && RsProfiler::isEnabled())
+		{
+			profile = RsProfiler::section(
+			            "queues;" + getServiceInfo().mServiceName + " incoming" );
+			mRecvQueueProfile = profile;
+		}
+
 		RsStackMutex stack(srvMtx);  /*****   LOCK MUTEX *****/
 
 		recv_queue.push_back(item);
+		if(profile) profile->setQueueDepth(recv_queue.size());
 	}
 	return true;
 }
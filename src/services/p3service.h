@@ -25,6 +25,7 @@
 #include "pqi/pqi.h"
 #include "pqi/pqiservice.h"
 #include "util/rsthreads.h"
+#include "util/rsprofiler.h"
 
 /* This provides easy to use extensions to the pqiservice class provided in src/pqi.
  * 
@@ -96,7 +97,7 @@ class p3Service: public p3FastService
 	protected:
 
 	p3Service() 
-	:p3FastService()
+	:p3FastService(), mRecvQueueProfile(nullptr)
 	{
 		return; 
 	}
@@ -120,6 +121,9 @@ virtual bool	recvItem(RsItem *item);
 
 	/* below locked by srvMtx Mutex */
 	std::list<RsItem *> recv_queue;
+
+	/// Track recv_queue depth when RsProfiler is enabled
+	std::atomic<RsProfiler::Section*> mRecvQueueProfile;
 };
 
 
@@ -168,7 +168,7 @@ void p3Wire::notifyChanges(std::vector<RsGxsNotify*> &changes)
                                     ev->mWireEventCode = RsWireEventCode::NEW_POST;
                                 }
                         }
-                        rsEvents->postEvent(ev);
+                        postChangeEvent(ev);
                     }
                 }
 
@@ -197,7 +197,7 @@ void p3Wire::notifyChanges(std::vector<RsGxsNotify*> &changes)
                     auto ev = std::make_shared<RsWireEvent>();
                     ev->mWireGroupId = grpChange->mGroupId;
                     ev->mWireEventCode = RsWireEventCode::FOLLOW_STATUS_CHANGED;
-                    rsEvents->postEvent(ev);
+                    postChangeEvent(ev);
 
                     unprocessedGroups.insert(grpChange->mGroupId);
                 }
@@ -207,7 +207,7 @@ void p3Wire::notifyChanges(std::vector<RsGxsNotify*> &changes)
                     auto ev = std::make_shared<RsWireEvent>();
                     ev->mWireGroupId = grpChange->mGroupId;
                     ev->mWireEventCode = RsWireEventCode::POST_UPDATED;
-                    rsEvents->postEvent(ev);
+                    postChangeEvent(ev);
 
                     unprocessedGroups.insert(grpChange->mGroupId);
                 }
@@ -222,6 +222,19 @@ void p3Wire::notifyChanges(std::vector<RsGxsNotify*> &changes)
         }
 }
 
+bool p3Wire::summarizeChangeEvent(
+        const RsEvent& event, RsGxsGroupId& grpId, RsGxsMessageId& msgId,
+        uint8_t& code ) const
+{
+	auto e = dynamic_cast<const RsWireEvent*>(&event);
+	if(!e) return false;
+
+	grpId = e->mWireGroupId;
+	msgId = e->mWireMsgId;
+	code = static_cast<uint8_t>(e->mWireEventCode);
+	return true;
+}
+
 		/* Specific Service Data */
 bool p3Wire::getGroupData(const uint32_t &token, std::vector<RsWireGroup> &groups)
 {
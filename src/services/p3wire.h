@@ -44,6 +44,11 @@ public:
 protected:
 	virtual void notifyChanges(std::vector<RsGxsNotify*>& changes) ;
 
+	/// @see RsGenExchange
+	bool summarizeChangeEvent(
+	        const RsEvent& event, RsGxsGroupId& grpId, RsGxsMessageId& msgId,
+	        uint8_t& code ) const override;
+
 public:
 	virtual void service_tick();
 
@@ -23,9 +23,11 @@
  *******************************************************************************/
 
 #include <string>
-#include <thread>
+#include <sstream>
+#include <algorithm>
 
 #include "services/rseventsservice.h"
+#include "util/rsjson.h"
 
 
 /*extern*/ RsEvents* rsEvents = nullptr;
@@ -69,13 +71,37 @@ std::error_condition RsEventsService::isEventInvalid(
 	return isEventTypeInvalid(event->mType);
 }
 
+RsEventsService::RsEventsService():
+    mHandlerMapMtx("RsEventsService::mHandlerMapMtx"), mLastHandlerId(1),
+    mIncomingMtx("RsEventsService::mIncomingMtx"), mIncomingSignaled(false),
+    mReadyMtx("RsEventsService::mReadyMtx"), mWorkersRunning(false),
+    mQueueDepth(0), mMaxQueueDepth(0), mPosted(0), mDispatched(0),
+    mCoalesced(0), mDropped(0), mLatencySumUs(0), mMaxLatencyUs(0)
+{
+	for(uint32_t i=0; i<DISPATCH_WORKERS; ++i)
+		mWorkers.emplace_back(new Worker(*this));
+}
+
+RsEventsService::~RsEventsService()
+{
+	for(auto& worker: mWorkers) worker->fullstop();
+}
+
 std::error_condition RsEventsService::postEvent(
         std::shared_ptr<const RsEvent> event )
 {
 	if(std::error_condition ec = isEventInvalid(event)) return ec;
 
-	RS_STACK_MUTEX(mEventQueueMtx);
-	mEventQueue.push_back(event);
+	mIncomingEvents.push(PostedEvent{event, Clock::now(), nullptr});
+	++mPosted;
+	updateMax(mMaxQueueDepth, ++mQueueDepth);
+
+	{
+		RS_STACK_MUTEX(mIncomingMtx);
+		mIncomingSignaled = true;
+	}
+	mIncomingCv.notify_one();
+
 	return std::error_condition();
 }
 
@@ -116,59 +142,297 @@ std::error_condition RsEventsService::registerEventsHandler(
 		return RsEventsErrorNum::INVALID_HANDLER_ID;
 	}
 
-	mHandlerMaps[static_cast<std::size_t>(eventType)][hId] = multiCallback;
+	mHandlerMaps[static_cast<std::size_t>(eventType)][hId] =
+	        std::make_shared<HandlerSlot>(multiCallback);
 	return std::error_condition();
 }
 
 std::error_condition RsEventsService::unregisterEventsHandler(
         RsEventsHandlerId_t hId )
 {
-	RS_STACK_MUTEX(mHandlerMapMtx);
+	std::shared_ptr<HandlerSlot> slot;
 
-	for(uint32_t i=0; i<mHandlerMaps.size(); ++i)
 	{
-		auto it = mHandlerMaps[i].find(hId);
-		if(it != mHandlerMaps[i].end())
+		RS_STACK_MUTEX(mHandlerMapMtx);
+
+		for(uint32_t i=0; i<mHandlerMaps.size() && !slot; ++i)
 		{
-			mHandlerMaps[i].erase(it);
-			return std::error_condition();
+			auto it = mHandlerMaps[i].find(hId);
+			if(it != mHandlerMaps[i].end())
+			{
+				slot = it->second;
+				mHandlerMaps[i].erase(it);
+			}
 		}
 	}
-	return RsEventsErrorNum::INVALID_HANDLER_ID;
+
+	if(!slot) return RsEventsErrorNum::INVALID_HANDLER_ID;
+
+	{
+		RsStackMutex queueLock(slot->mQueueMtx);
+		slot->mActive = false;
+		mQueueDepth -= slot->mQueue.size();
+		slot->mQueue.clear();
+	}
+
+	/* Wait for the callback to return if it is running on a worker, after
+	 * this the caller can safely destroy whatever the callback uses. If the
+	 * callback is unregistering its own handler we already own the mutex */
+	if(!pthread_equal(slot->mRunMtx.owner(), pthread_self()))
+		RsStackMutex waitRunning(slot->mRunMtx);
+
+	return std::error_condition();
 }
 
 void RsEventsService::threadTick()
 {
-	auto nextRunAt = std::chrono::system_clock::now() +
-	        std::chrono::milliseconds(200);
+	{
+		RS_STACK_MUTEX(mIncomingMtx);
+
+		/* Sleep until an event is posted, the time of the next future event
+		 * comes, or we are asked to stop */
+		auto wakeUp = [this]() { return mIncomingSignaled || shouldStop(); };
+		if(mFutureEvents.empty()) mIncomingCv.wait(mIncomingMtx, wakeUp);
+		else mIncomingCv.wait_until(
+		            mIncomingMtx, mFutureEvents.begin()->first, wakeUp );
+
+		mIncomingSignaled = false;
+	}
+
+	if(!shouldStop()) dispatchIncoming();
+}
+
+void RsEventsService::dispatchIncoming()
+{
+	if(!mWorkersRunning && !shouldStop()) startWorkers();
+
+	const auto now = std::chrono::system_clock::now();
+	PostedEvent pEvent;
+
+	while(!mFutureEvents.empty() && mFutureEvents.begin()->first <= now)
+	{
+		pEvent = std::move(mFutureEvents.begin()->second);
+		mFutureEvents.erase(mFutureEvents.begin());
+		dispatchEvent(pEvent);
+	}
+
+	while(mIncomingEvents.pop(pEvent))
+	{
+		const auto timePoint = pEvent.mEvent->mTimePoint;
+		if(timePoint > now) mFutureEvents.emplace(timePoint, std::move(pEvent));
+		else dispatchEvent(pEvent);
+	}
+}
+
+void RsEventsService::onStopRequested()
+{
+	mWorkersRunning = false;
+	for(auto& worker: mWorkers) worker->askForStop();
+
+	{ RS_STACK_MUTEX(mIncomingMtx); }
+	mIncomingCv.notify_all();
+}
+
+void RsEventsService::startWorkers()
+{
+	for(auto& worker: mWorkers)
+	{
+		// Workers of a previous run have already returned, or are about to
+		worker->fullstop();
+		worker->start("events worker");
+	}
+
+	mWorkersRunning = true;
+}
+
+void RsEventsService::dispatchEvent(PostedEvent& pEvent)
+{
+	std::vector<std::shared_ptr<HandlerSlot> > slots;
+
+	{
+		RS_STACK_MUTEX(mHandlerMapMtx);
 
-	std::shared_ptr<const RsEvent> eventPtr(nullptr);
-	size_t futureEventsCounter = 0;
+		const auto& typeMap =
+		        mHandlerMaps[static_cast<uint32_t>(pEvent.mEvent->mType)];
+		const auto& allMap =
+		        mHandlerMaps[static_cast<uint32_t>(RsEventType::__NONE)];
+
+		slots.reserve(typeMap.size() + allMap.size());
+		for(auto& it: typeMap) slots.push_back(it.second);
+		for(auto& it: allMap) slots.push_back(it.second);
+	}
+
+	--mQueueDepth;
+	for(auto& slot: slots) enqueueForHandler(slot, pEvent);
+}
+
+bool RsEventsService::enqueueForHandler(
+        const std::shared_ptr<HandlerSlot>& slot, PostedEvent& pEvent )
+{
+	bool schedule = false;
+	const bool idempotent = isEventTypeIdempotent(pEvent.mEvent->mType);
 
-dispatchEventFromQueueLock:
-	mEventQueueMtx.lock();
-	if(mEventQueue.size() > futureEventsCounter)
 	{
-		eventPtr = mEventQueue.front();
-		mEventQueue.pop_front();
+		RsStackMutex queueLock(slot->mQueueMtx);
+		if(!slot->mActive) return false;
 
-		if(eventPtr->mTimePoint >= nextRunAt)
+		auto& queue = slot->mQueue;
+
+		/* The handler is lagging behind, if an identical event is still
+		 * waiting drop it and keep only the newest one, which is delivered in
+		 * the latest position */
+		uint32_t checked = 0;
+		for( auto it = queue.rbegin(); idempotent &&
+		     it != queue.rend() && checked < COALESCE_WINDOW; ++it, ++checked )
 		{
-			mEventQueue.push_back(eventPtr);
-			++futureEventsCounter;
+			if(it->mEvent->mType != pEvent.mEvent->mType) continue;
+
+			if(it->mEvent != pEvent.mEvent)
+			{
+				if(!pEvent.mFingerprint)
+					pEvent.mFingerprint = eventFingerprint(*pEvent.mEvent);
+				if(!it->mFingerprint)
+					it->mFingerprint = eventFingerprint(*it->mEvent);
+				if(*it->mFingerprint != *pEvent.mFingerprint) continue;
+			}
+
+			queue.erase(std::next(it).base());
+			--mQueueDepth;
+			++mCoalesced;
+			break;
 		}
+
+		if(queue.size() >= MAX_HANDLER_QUEUE)
+		{
+			queue.pop_front();
+			--mQueueDepth;
+			++mDropped;
+
+			if(!slot->mOverflowing)
+			{
+				slot->mOverflowing = true;
+				RsWarn() << __PRETTY_FUNCTION__ << " handler queue full, "
+				         << "dropping oldest events" << std::endl;
+			}
+		}
+
+		queue.push_back(pEvent);
+		updateMax(mMaxQueueDepth, ++mQueueDepth);
+
+		if(!slot->mScheduled) schedule = slot->mScheduled = true;
 	}
-	mEventQueueMtx.unlock();
 
-	if(eventPtr)
+	if(schedule)
 	{
-		/* It is relevant that this stays out of mEventQueueMtx */
-		handleEvent(eventPtr);
-		eventPtr = nullptr; // ensure refcounter is decremented before sleep
-		goto dispatchEventFromQueueLock;
+		{
+			RS_STACK_MUTEX(mReadyMtx);
+			mReadySlots.push_back(slot);
+		}
+		mReadyCv.notify_one();
 	}
 
-	std::this_thread::sleep_until(nextRunAt);
+	return true;
+}
+
+void RsEventsService::Worker::threadTick()
+{
+	{
+		RsStackMutex stack(mService.mReadyMtx);
+		mService.mReadyCv.wait( mService.mReadyMtx, [this]()
+		{ return !mService.mReadySlots.empty() || shouldStop(); } );
+	}
+
+	mService.serveReadySlot(*this);
+}
+
+void RsEventsService::Worker::onStopRequested()
+{
+	/* Taking the mutex makes sure the worker is either before checking
+	 * shouldStop() or already waiting, so it doesn't miss the notification */
+	{ RsStackMutex stack(mService.mReadyMtx); }
+	mService.mReadyCv.notify_all();
+}
+
+bool RsEventsService::serveReadySlot(RsThread& worker)
+{
+	std::shared_ptr<HandlerSlot> slot;
+
+	{
+		RS_STACK_MUTEX(mReadyMtx);
+		if(mReadySlots.empty() || worker.shouldStop()) return false;
+
+		slot = std::move(mReadySlots.front());
+		mReadySlots.pop_front();
+	}
+
+	/* Serve a bounded batch then get back in line, so a handler with a long
+	 * queue doesn't starve the others */
+	bool again = false;
+	for(uint32_t served = 0; ; ++served)
+	{
+		PostedEvent pEvent;
+
+		{
+			RsStackMutex queueLock(slot->mQueueMtx);
+			if(slot->mQueue.empty())
+			{
+				slot->mScheduled = false;
+				slot->mOverflowing = false;
+				break;
+			}
+
+			if(served >= WORKER_BATCH || worker.shouldStop())
+			{
+				again = true;
+				break;
+			}
+
+			pEvent = std::move(slot->mQueue.front());
+			slot->mQueue.pop_front();
+			--mQueueDepth;
+		}
+
+		runHandler(*slot, pEvent);
+	}
+
+	if(again)
+	{
+		{
+			RS_STACK_MUTEX(mReadyMtx);
+			mReadySlots.push_back(slot);
+		}
+		mReadyCv.notify_one();
+	}
+
+	return true;
+}
+
+void RsEventsService::runHandler(HandlerSlot& slot, const PostedEvent& pEvent)
+{
+	/* Unless the thread already owns it, because a callback is sending an
+	 * event to its own handler */
+	std::unique_ptr<RsStackMutex> running;
+	if(!pthread_equal(slot.mRunMtx.owner(), pthread_self()))
+		running.reset(new RsStackMutex(slot.mRunMtx));
+
+	if(!slot.mActive) return;
+
+	using namespace std::chrono;
+
+	const auto start = Clock::now();
+	const uint64_t latency = static_cast<uint64_t>(
+	            duration_cast<microseconds>(start - pEvent.mPostedAt).count() );
+	mLatencySumUs += latency;
+	updateMax(mMaxLatencyUs, latency);
+	++mDispatched;
+
+	slot.mCallback(pEvent.mEvent);
+
+	const auto took = duration_cast<milliseconds>(Clock::now() - start).count();
+	if(took > SLOW_HANDLER_WARN_MS)
+		RsWarn() << __PRETTY_FUNCTION__ << " handler took " << took
+		         << "ms for event type: "
+		         << static_cast<uint32_t>(pEvent.mEvent->mType) << std::endl;
 }
 
 void RsEventsService::handleEvent(std::shared_ptr<const RsEvent> event)
@@ -180,18 +444,85 @@ void RsEventsService::handleEvent(std::shared_ptr<const RsEvent> event)
 		return;
 	}
 
-	RS_STACK_MUTEX(mHandlerMapMtx);
-	/* It is important to also call the callback under mutex protection to
-	 * ensure they are not unregistered in the meanwhile.
-	 * If a callback try to fiddle with registering/unregistering it will
-	 * deadlock */
-
-	// Call all clients that registered a callback for this event type
-	for(auto cbit: mHandlerMaps[static_cast<uint32_t>(event->mType)])
-		cbit.second(event);
-
-	/* Also call all clients that registered with NONE, meaning that they
-	 * expect all events */
-	for(auto cbit: mHandlerMaps[static_cast<uint32_t>(RsEventType::__NONE)])
-		cbit.second(event);
+	std::vector<std::shared_ptr<HandlerSlot> > slots;
+
+	{
+		RS_STACK_MUTEX(mHandlerMapMtx);
+
+		// Call all clients that registered a callback for this event type
+		for(auto& cbit: mHandlerMaps[static_cast<uint32_t>(event->mType)])
+			slots.push_back(cbit.second);
+
+		/* Also call all clients that registered with NONE, meaning that they
+		 * expect all events */
+		for(auto& cbit: mHandlerMaps[static_cast<uint32_t>(RsEventType::__NONE)])
+			slots.push_back(cbit.second);
+	}
+
+	/* Callbacks are called outside mHandlerMapMtx, each one under its own
+	 * mutex, so they may register or unregister handlers */
+	const PostedEvent pEvent{event, Clock::now(), nullptr};
+	for(auto& slot: slots) runHandler(*slot, pEvent);
+}
+
+void RsEventsService::getStatistics(RsEventsStatistics& stats, bool reset)
+{
+	stats.mPosted = mPosted;
+	stats.mDispatched = mDispatched;
+	stats.mCoalesced = mCoalesced;
+	stats.mDropped = mDropped;
+	stats.mQueueDepth = mQueueDepth;
+	stats.mMaxQueueDepth = mMaxQueueDepth;
+	stats.mAvgLatencyUs =
+	        stats.mDispatched ? mLatencySumUs / stats.mDispatched : 0;
+	stats.mMaxLatencyUs = mMaxLatencyUs;
+
+	if(reset)
+	{
+		mPosted = 0;
+		mDispatched = 0;
+		mCoalesced = 0;
+		mDropped = 0;
+		mMaxQueueDepth = mQueueDepth.load();
+		mLatencySumUs = 0;
+		mMaxLatencyUs = 0;
+	}
+}
+
+/*static*/ bool RsEventsService::isEventTypeIdempotent(RsEventType eventType)
+{
+	switch(eventType)
+	{
+	case RsEventType::BROADCAST_DISCOVERY: // [[fallthrough]];
+	case RsEventType::PEER_STATE_CHANGED: // [[fallthrough]];
+	case RsEventType::SHARED_DIRECTORIES: // [[fallthrough]];
+	case RsEventType::FILE_TRANSFER: // [[fallthrough]];
+	case RsEventType::NETWORK: // [[fallthrough]];
+	case RsEventType::TOR_MANAGER:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*static*/ std::shared_ptr<const std::string>
+RsEventsService::eventFingerprint(const RsEvent& event)
+{
+	/* Every event can be converted to JSON, as they are all exposed through
+	 * JSON API, while binary serialization is not guaranteed */
+	RsGenericSerializer::SerializeContext ctx;
+	RsTypeSerializer::serial_process(
+	            RsGenericSerializer::TO_JSON, ctx,
+	            const_cast<RsEvent&>(event), "event" );
+
+	std::stringstream ss;
+	ss << compactJSON << ctx.mJson;
+	return std::make_shared<const std::string>(ss.str());
+}
+
+/*static*/ void RsEventsService::updateMax(
+        std::atomic<uint64_t>& max, uint64_t value )
+{
+	uint64_t cur = max.load();
+	while(value > cur && !max.compare_exchange_weak(cur, value));
 }
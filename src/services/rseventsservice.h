@@ -26,18 +26,32 @@
 #include <cstdint>
 #include <deque>
 #include <array>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 
 #include "retroshare/rsevents.h"
 #include "util/rsthreads.h"
 #include "util/rsdebug.h"
+#include "util/rsmpscqueue.h"
 
+/**
+ * Posted events are pushed into a lock-free queue and wake up the dispatching
+ * thread, which sleeps while there is nothing to do. It sorts them into a
+ * bounded queue per registered handler, and a small pool of workers, also
+ * woken up only when a handler has events waiting, runs the handlers. So a slow
+ * handler only delays its own events. Each handler still sees its events one
+ * at a time and in posting order.
+ */
 class RsEventsService :
         public RsEvents, public RsTickingThread
 {
 public:
-	RsEventsService():
-	    mHandlerMapMtx("RsEventsService::mHandlerMapMtx"), mLastHandlerId(1),
-	    mEventQueueMtx("RsEventsService::mEventQueueMtx") {}
+	RsEventsService();
+
+	~RsEventsService() override;
 
 	/// @see RsEvents
 	std::error_condition postEvent(
@@ -60,7 +74,83 @@ public:
 	std::error_condition unregisterEventsHandler(
 	        RsEventsHandlerId_t hId ) override;
 
+	/// @see RsEvents
+	void getStatistics(RsEventsStatistics& stats, bool reset = false) override;
+
+	/**
+	 * Only events of these types are coalesced: they just tell handlers that
+	 * something must be refreshed, so getting the newest of identical events
+	 * is as good as getting all of them.
+	 * @return true if identical events of the type may be merged
+	 */
+	static bool isEventTypeIdempotent(RsEventType eventType);
+
+	/// Threads running event handlers
+	static const uint32_t DISPATCH_WORKERS = 4;
+
+	/// Events waiting for one handler before the oldest ones are dropped
+	static const uint32_t MAX_HANDLER_QUEUE = 4096;
+
+	/// Queued events which a new one is checked against for duplicates
+	static const uint32_t COALESCE_WINDOW = 32;
+
+	/// Handlers slower than this are reported
+	static const uint32_t SLOW_HANDLER_WARN_MS = 500;
+
 protected:
+	typedef std::chrono::steady_clock Clock;
+
+	struct PostedEvent
+	{
+		std::shared_ptr<const RsEvent> mEvent;
+		Clock::time_point mPostedAt;
+
+		/** Compact JSON serialization of the event, computed only if needed
+		 * to look for duplicates */
+		std::shared_ptr<const std::string> mFingerprint;
+	};
+
+	/// A registered handler with its own queue
+	struct HandlerSlot
+	{
+		explicit HandlerSlot(
+		        const std::function<void(std::shared_ptr<const RsEvent>)>& cb ) :
+		    mCallback(cb), mRunMtx("RsEventsService::HandlerSlot::mRunMtx"),
+		    mActive(true), mQueueMtx("RsEventsService::HandlerSlot::mQueueMtx"),
+		    mScheduled(false), mOverflowing(false) {}
+
+		std::function<void(std::shared_ptr<const RsEvent>)> mCallback;
+
+		/** Held while the callback runs, so unregistering waits for a running
+		 * callback to return before the handler owner can go away. The thread
+		 * running the callback already owns it, so the callback can still
+		 * unregister its own handler or send events to it */
+		RsMutex mRunMtx;
+		std::atomic<bool> mActive;
+
+		RsMutex mQueueMtx;
+		std::deque<PostedEvent> mQueue;
+		bool mScheduled;   /// Waiting for or being served by a worker
+		bool mOverflowing; /// Already warned about dropped events
+	};
+
+	/// Runs the handlers of scheduled slots
+	class Worker : public RsTickingThread
+	{
+	public:
+		explicit Worker(RsEventsService& service) : mService(service) {}
+
+	protected:
+		void threadTick() override; /// @see RsTickingThread
+		void onStopRequested() override; /// @see RsThread
+
+	private:
+		RsEventsService& mService;
+	};
+
+	/// Events a worker handles for one handler before serving the others
+	static const uint32_t WORKER_BATCH = 16;
+
 	std::error_condition isEventTypeInvalid(RsEventType eventType);
 	std::error_condition isEventInvalid(std::shared_ptr<const RsEvent> event);
 
@@ -70,19 +160,64 @@ protected:
 	/** Storage for event handlers, keep 10 extra types for plugins that might
 	 * be released indipendently */
 	std::array<
-	    std::map<
-	        RsEventsHandlerId_t,
-	        std::function<void(std::shared_ptr<const RsEvent>)> >,
+	    std::map<RsEventsHandlerId_t, std::shared_ptr<HandlerSlot> >,
 	    static_cast<std::size_t>(RsEventType::__MAX) + 10
 	> mHandlerMaps;
 
-	RsMutex mEventQueueMtx;
-	std::deque< std::shared_ptr<const RsEvent> > mEventQueue;
+	/// Posted events not yet dispatched, consumed by dispatchIncoming() only
+	RsMpscQueue<PostedEvent> mIncomingEvents;
+
+	/// Set by postEvent() to wake up the dispatching thread
+	RsMutex mIncomingMtx;
+	std::condition_variable_any mIncomingCv;
+	bool mIncomingSignaled;
+
+	/// Events with a time point in the future, touched by dispatchIncoming() only
+	std::multimap<std::chrono::system_clock::time_point, PostedEvent>
+	    mFutureEvents;
+
+	/// Slots with queued events waiting for a worker, which mReadyCv wakes up
+	RsMutex mReadyMtx;
+	std::condition_variable_any mReadyCv;
+	std::deque<std::shared_ptr<HandlerSlot> > mReadySlots;
+
+	std::vector<std::unique_ptr<Worker> > mWorkers;
+	std::atomic<bool> mWorkersRunning;
+
+	std::atomic<uint64_t> mQueueDepth;
+	std::atomic<uint64_t> mMaxQueueDepth;
+	std::atomic<uint64_t> mPosted;
+	std::atomic<uint64_t> mDispatched;
+	std::atomic<uint64_t> mCoalesced;
+	std::atomic<uint64_t> mDropped;
+	std::atomic<uint64_t> mLatencySumUs;
+	std::atomic<uint64_t> mMaxLatencyUs;
 
 	void threadTick() override; /// @see RsTickingThread
+	void onStopRequested() override; /// @see RsThread
+
+	/// Dispatch posted events, and future ones whose time has come
+	void dispatchIncoming();
 
 	void handleEvent(std::shared_ptr<const RsEvent> event);
 	RsEventsHandlerId_t generateUniqueHandlerId_unlocked();
 
+	/// Queue the event for every interested handler
+	void dispatchEvent(PostedEvent& pEvent);
+
+	/// @return false if the event was coalesced or the handler is gone
+	bool enqueueForHandler(
+	        const std::shared_ptr<HandlerSlot>& slot, PostedEvent& pEvent );
+
+	void startWorkers();
+
+	/// Serve a batch of events of the next scheduled slot
+	bool serveReadySlot(RsThread& worker);
+	void runHandler(HandlerSlot& slot, const PostedEvent& pEvent);
+
+	static std::shared_ptr<const std::string> eventFingerprint(
+	        const RsEvent& event );
+	static void updateMax(std::atomic<uint64_t>& max, uint64_t value);
+
 	RS_SET_CONTEXT_DEBUG_LEVEL(3)
 };
@@ -185,6 +185,17 @@ void ContentValue::put(const std::string &key, uint32_t len, const char* value){
     // cppcheck-suppress memleak
 }
 
+void ContentValue::putOwned(const std::string &key, uint32_t len, char* value){
+
+    if(mKvSet.find(key) != mKvSet.end()) {
+        removeKeyValue(key);
+    }
+
+    mKvSet.insert(KeyTypePair(key, DATA_TYPE));
+    mKvData.insert(std::pair<std::string, std::pair<uint32_t, char*> >
+                   (key, std::pair<uint32_t, char*>(len, value)));
+}
+
 bool ContentValue::getAsBool(const std::string &key, bool& value) const{
 
     std::map<std::string, bool>::const_iterator it;
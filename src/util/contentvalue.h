@@ -103,6 +103,14 @@ public:
      */
     void put(const std::string& key, uint32_t len, const char* value);
 
+    /*!
+     * Adds a value to the set without copying it
+     * @param key  the name of the value to put
+     * @param len  size of value
+     * @param value  data allocated with new[], of which the ContentValue takes ownership
+     */
+    void putOwned(const std::string& key, uint32_t len, char* value);
+
 
     /*!
      * get value as 32-bit signed integer
@@ -229,7 +229,7 @@ bool RetroDb::execSQL(const std::string &query){
 }
 
 RetroCursor* RetroDb::sqlQuery(const std::string& tableName, const std::list<std::string>& columns,
-                               const std::string& selection, const std::string& orderBy){
+                               const std::string& selection, const std::string& orderBy, uint32_t limit){
 
     if(tableName.empty() || columns.empty()){
         std::cerr << "RetroDb::sqlQuery(): No table or columns given" << std::endl;
@@ -260,9 +260,13 @@ RetroCursor* RetroDb::sqlQuery(const std::string& tableName, const std::list<std
 
     // add 'order by' clause if present
     if(!orderBy.empty())
-        sqlQuery += " ORDER BY " + orderBy + ";";
-    else
-        sqlQuery += ";";
+        sqlQuery += " ORDER BY " + orderBy;
+
+    // add 'limit' clause if present
+    if(limit > 0)
+        sqlQuery += " LIMIT " + std::to_string(limit);
+
+    sqlQuery += ";";
 
 #ifdef RETRODB_DEBUG
     std::cerr << "RetroDb::sqlQuery(): " << sqlQuery << std::endl;
@@ -653,6 +657,101 @@ bool RetroDb::tableExists(const std::string &tableName)
     return result;
 }
 
+bool RetroDb::indexExists(const std::string &indexName)
+{
+    std::string seqno;
+
+    // index_info returns one row per indexed column, none for an unknown index
+    return execPragma("index_info(" + indexName + ")", seqno) && !seqno.empty();
+}
+
+bool RetroDb::vacuum()
+{
+    if (!isOpen()) {
+        return false;
+    }
+
+    return execSQL("VACUUM;");
+}
+
+bool RetroDb::execPragma(const std::string& pragma, std::string& result)
+{
+    if (!isOpen()) {
+        return false;
+    }
+
+    std::string sqlQuery = "PRAGMA " + pragma + ";";
+    sqlite3_stmt* stmt = NULL;
+
+    int rc = sqlite3_prepare_v2(mDb, sqlQuery.c_str(), sqlQuery.length(), &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        std::cerr << "RetroDb::execPragma(): Error preparing statement " << sqlQuery << ": " << sqlite3_errmsg(mDb) << std::endl;
+        return false;
+    }
+
+    bool first = true;
+    result.clear();
+
+    // Some pragmas (incremental_vacuum, wal_checkpoint...) do their work one step at a time
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (first && sqlite3_column_count(stmt) > 0) {
+            const unsigned char* txt = sqlite3_column_text(stmt, 0);
+
+            if (txt) {
+                result = reinterpret_cast<const char*>(txt);
+            }
+        }
+        first = false;
+    }
+
+    sqlite3_finalize(stmt);
+
+    if (rc != SQLITE_DONE) {
+        std::cerr << "RetroDb::execPragma(): Error executing statement " << sqlQuery << " (code: " << rc << ")" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool RetroDb::execPragma(const std::string& pragma)
+{
+    std::string result;
+    return execPragma(pragma, result);
+}
+
+int64_t RetroDb::pragmaValue(const std::string& pragma)
+{
+    std::string result;
+
+    if (!execPragma(pragma, result) || result.empty()) {
+        return -1;
+    }
+
+    return strtoll(result.c_str(), NULL, 10);
+}
+
+bool RetroDb::incrementalVacuum(uint32_t maxPages)
+{
+    if (maxPages == 0) {
+        return execPragma("incremental_vacuum");
+    }
+
+    return execPragma("incremental_vacuum(" + std::to_string(maxPages) + ")");
+}
+
+bool RetroDb::walCheckpoint(bool truncate)
+{
+    if (!isOpen()) {
+        return false;
+    }
+
+    int rc = sqlite3_wal_checkpoint_v2(mDb, NULL, truncate ? SQLITE_CHECKPOINT_TRUNCATE : SQLITE_CHECKPOINT_PASSIVE, NULL, NULL);
+
+    // SQLITE_BUSY only means that the checkpoint could not complete because of readers, it will be retried later
+    return rc == SQLITE_OK || rc == SQLITE_BUSY;
+}
+
 /********************** RetroCursor ************************/
 
 RetroCursor::RetroCursor(sqlite3_stmt *stmt)
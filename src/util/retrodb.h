@@ -145,11 +145,12 @@ public:
      *        an SQL WHERE clause (excluding the WHERE itself). Passing null will \n
      *        return all rows for the given table.
      * @param order the rows, formatted as an SQL ORDER BY clause (excluding the ORDER BY itself)
+     * @param limit maximum number of rows to return, 0 means no limit
      * @return cursor over result set, this allocated resource should be free'd after use \n
      *         column order is in list order.
      */
     RetroCursor* sqlQuery(const std::string& tableName, const std::list<std::string>& columns,
-                          const std::string& selection, const std::string& orderBy);
+                          const std::string& selection, const std::string& orderBy, uint32_t limit = 0);
 
     /*!
      * delete row in an sql table
@@ -160,10 +161,41 @@ public:
     bool sqlDelete(const std::string& tableName, const std::string& whereClause, const std::string& whereArgs);
 
     /*!
-     * TODO
-     * defragment database, should be done on databases if many modifications have occured
+     * defragment database, should be done on databases if many modifications have occured \n
+     * This rewrites the whole database, prefer incrementalVacuum() on databases with auto_vacuum=INCREMENTAL
+     * @return false if there was an sqlite error, true otherwise
+     */
+    bool vacuum();
+
+    /*!
+     * Executes a PRAGMA statement, stepping through all its result rows
+     * @param pragma PRAGMA statement, without the leading PRAGMA keyword
+     * @param result value of the first column of the first result row, if any
+     * @return false if there was an sqlite error, true otherwise
+     */
+    bool execPragma(const std::string& pragma, std::string& result);
+    bool execPragma(const std::string& pragma);
+
+    /*!
+     * Convenience for PRAGMAs returning a single integer value (page_count, freelist_count, ...)
+     * @return the value, or -1 in case of error
+     */
+    int64_t pragmaValue(const std::string& pragma);
+
+    /*!
+     * Releases at most the given number of free pages to the file system. Only
+     * effective on databases with auto_vacuum=INCREMENTAL.
+     * @param maxPages number of pages to release, 0 for all
+     * @return false if there was an sqlite error, true otherwise
+     */
+    bool incrementalVacuum(uint32_t maxPages);
+
+    /*!
+     * Copies the write ahead log content back into the database
+     * @param truncate if true, also blocks until the log can be reset and truncates it
+     * @return false if there was an sqlite error, true otherwise
      */
-    void vacuum();
+    bool walCheckpoint(bool truncate);
 
     /*!
      * Check if table exist in database
@@ -172,6 +204,13 @@ public:
      */
     bool tableExists(const std::string& tableName);
 
+    /*!
+     * Check if index exist in database
+     * @param indexName index to check
+     * @return true/false
+     */
+    bool indexExists(const std::string& indexName);
+
 public:
 
     static const int OPEN_READONLY;
@@ -67,5 +67,7 @@ bool RsBoolBind::bind(sqlite3_stmt* const stm) const
 
 bool RsBlobBind::bind(sqlite3_stmt* const stm) const
 {
-	return (SQLITE_OK == sqlite3_bind_blob(stm, getIndex(), mData, mDataLen, SQLITE_TRANSIENT));
+	// mData belongs to the ContentValue the query is built from, which outlives
+	// the statement, so there is no need for sqlite to take its own copy.
+	return (SQLITE_OK == sqlite3_bind_blob(stm, getIndex(), mData, mDataLen, SQLITE_STATIC));
 }
@@ -89,6 +89,9 @@ public:
 	bool mValue;
 };
 
+/*!
+ * Binds data without copying it: it must stay valid until the statement is finalised
+ */
 class RsBlobBind : public RetroBind
 {
 public:
@@ -0,0 +1,315 @@
+/*******************************************************************************
+ * libretroshare/src/util: rsiptrie.cc                                         *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#include <string.h>
+#include <algorithm>
+
+#include "util/rsiptrie.h"
+
+static inline void keyFromBytes(const uint8_t key[16], uint64_t k[2])
+{
+	k[0] = k[1] = 0;
+
+	for(int i=0;i<8;++i)
+	{
+		k[0] = (k[0] << 8) | key[i];
+		k[1] = (k[1] << 8) | key[i+8];
+	}
+}
+
+static inline uint32_t keyBit(const uint64_t k[2], uint8_t i)
+{
+	return (i < 64) ? ((k[0] >> (63 - i)) & 1) : ((k[1] >> (127 - i)) & 1);
+}
+
+static inline void keyMask(uint64_t k[2], uint8_t len)
+{
+	if(len == 0)
+		k[0] = k[1] = 0;
+	else if(len < 64)
+	{
+		k[0] &= ~uint64_t(0) << (64 - len);
+		k[1] = 0;
+	}
+	else if(len == 64)
+		k[1] = 0;
+	else if(len < 128)
+		k[1] &= ~uint64_t(0) << (128 - len);
+}
+
+/// number of leading bits a and b have in common, at most max_len
+static inline uint8_t commonLength(const uint64_t a[2], const uint64_t b[2], uint8_t max_len)
+{
+	uint64_t x = a[0] ^ b[0];
+	uint32_t n;
+
+	if(x)
+		n = __builtin_clzll(x);
+	else if((x = a[1] ^ b[1]))
+		n = 64 + __builtin_clzll(x);
+	else
+		n = 128;
+
+	return (n < max_len) ? n : max_len;
+}
+
+RsIpPrefixTrie::RsIpPrefixTrie() : mCount(0)
+{
+	clear();
+}
+
+void RsIpPrefixTrie::clear()
+{
+	static const uint64_t null_key[2] = { 0, 0 };
+
+	mNodes.clear();
+	mCount = 0;
+	newNode(null_key, 0);	// root, ::/0
+}
+
+uint32_t RsIpPrefixTrie::newNode(const uint64_t key[2], uint8_t len)
+{
+	Node n;
+	n.key[0] = key[0];
+	n.key[1] = key[1];
+	keyMask(n.key, len);
+	n.len = len;
+	n.has_value = false;
+	n.value = 0;
+	n.child[0] = n.child[1] = 0;
+
+	mNodes.push_back(n);
+	return mNodes.size() - 1;
+}
+
+bool RsIpPrefixTrie::toKey(const sockaddr_storage& addr, uint8_t key[16])
+{
+	switch(addr.ss_family)
+	{
+	case AF_INET:
+	{
+		const sockaddr_in *in = reinterpret_cast<const sockaddr_in*>(&addr);
+
+		memset(key, 0, 10);
+		key[10] = key[11] = 0xff;
+		memcpy(key + 12, &in->sin_addr.s_addr, 4);	// network order is big endian
+		return true;
+	}
+	case AF_INET6:
+	{
+		const sockaddr_in6 *in6 = reinterpret_cast<const sockaddr_in6*>(&addr);
+
+		memcpy(key, in6->sin6_addr.s6_addr, 16);
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+bool RsIpPrefixTrie::insert(const sockaddr_storage& addr, uint8_t prefix_len, uint32_t value)
+{
+	uint8_t key[16];
+
+	if(!toKey(addr, key))
+		return false;
+
+	if(addr.ss_family == AF_INET)
+	{
+		if(prefix_len > 32)
+			return false;
+
+		prefix_len += 96;
+	}
+
+	return insert(key, prefix_len, value);
+}
+
+bool RsIpPrefixTrie::insert(const uint8_t key[16], uint8_t len, uint32_t value)
+{
+	if(len > 128)
+		return false;
+
+	uint64_t k[2];
+	keyFromBytes(key, k);
+	keyMask(k, len);
+
+	// Invariant: the prefix of node n covers k, and is not longer than len.
+
+	uint32_t n = 0;
+
+	while(mNodes[n].len < len)
+	{
+		uint32_t b = keyBit(k, mNodes[n].len);
+		uint32_t c = mNodes[n].child[b];
+
+		if(!c)
+		{
+			uint32_t leaf = newNode(k, len);
+			mNodes[leaf].has_value = true;
+			mNodes[leaf].value = value;
+			mNodes[n].child[b] = leaf;
+			++mCount;
+			return true;
+		}
+
+		uint8_t common = commonLength(mNodes[c].key, k, std::min(mNodes[c].len, len));
+
+		if(common == mNodes[c].len)
+		{
+			n = c;
+			continue;
+		}
+
+		// The child's prefix diverges from k, or is longer than len: split the edge
+		// with a node at the common length. Both keys agree on bit mNodes[n].len,
+		// so the new node is strictly below n.
+
+		uint32_t split = newNode(k, common);
+		mNodes[split].child[keyBit(mNodes[c].key, common)] = c;
+		mNodes[n].child[b] = split;
+
+		if(common == len)
+		{
+			mNodes[split].has_value = true;
+			mNodes[split].value = value;
+		}
+		else
+		{
+			uint32_t leaf = newNode(k, len);
+			mNodes[leaf].has_value = true;
+			mNodes[leaf].value = value;
+			mNodes[split].child[keyBit(k, common)] = leaf;
+		}
+		++mCount;
+		return true;
+	}
+
+	if(!mNodes[n].has_value)
+		++mCount;
+
+	mNodes[n].has_value = true;
+	mNodes[n].value = value;
+	return true;
+}
+
+bool RsIpPrefixTrie::lookup(const sockaddr_storage& addr, uint32_t& value) const
+{
+	uint8_t key[16];
+
+	if(!toKey(addr, key))
+		return false;
+
+	return lookup(key, value);
+}
+
+bool RsIpPrefixTrie::lookup(const uint8_t key[16], uint32_t& value) const
+{
+	uint64_t k[2];
+	keyFromBytes(key, k);
+
+	bool found = false;
+	uint32_t n = 0;
+
+	for(;;)
+	{
+		const Node& node(mNodes[n]);
+
+		if(commonLength(node.key, k, node.len) < node.len)
+			break;
+
+		if(node.has_value)
+		{
+			value = node.value;
+			found = true;
+		}
+
+		if(node.len == 128 || !(n = node.child[keyBit(k, node.len)]))
+			break;
+	}
+
+	return found;
+}
+
+bool RsIpPrefixTrie::parsePrefix(const std::string& s, uint8_t key[16], uint8_t& key_prefix_len)
+{
+	std::string::size_type slash = s.find('/');
+	std::string ip = s.substr(0, slash);
+	int len = -1;
+
+	if(slash != std::string::npos)
+	{
+		char *end = NULL;
+		const char *p = s.c_str() + slash + 1;
+
+		len = strtol(p, &end, 10);
+
+		if(end == p || *end != 0 || len < 0)
+			return false;
+	}
+
+	in_addr a4;
+	in6_addr a6;
+
+	if(inet_pton(AF_INET, ip.c_str(), &a4) == 1)
+	{
+		if(len > 32)
+			return false;
+
+		memset(key, 0, 10);
+		key[10] = key[11] = 0xff;
+		memcpy(key + 12, &a4.s_addr, 4);
+		key_prefix_len = 96 + ((len < 0) ? 32 : len);
+		return true;
+	}
+
+	if(inet_pton(AF_INET6, ip.c_str(), &a6) == 1)
+	{
+		if(len > 128)
+			return false;
+
+		memcpy(key, a6.s6_addr, 16);
+		key_prefix_len = (len < 0) ? 128 : len;
+		return true;
+	}
+
+	return false;
+}
+
+void RsIpPrefixTrie::rangeToPrefixes( uint32_t first, uint32_t last,
+                                      std::list<std::pair<uint32_t,uint8_t> >& prefixes )
+{
+	uint64_t start = first;
+	uint64_t end = uint64_t(last) + 1;
+
+	while(start < end)
+	{
+		// largest block aligned on start that does not go past the end of the range
+
+		uint32_t bits = start ? __builtin_ctzll(start) : 32;
+
+		while(bits > 0 && start + (uint64_t(1) << bits) > end)
+			--bits;
+
+		prefixes.push_back(std::make_pair(uint32_t(start), uint8_t(32 - bits)));
+		start += uint64_t(1) << bits;
+	}
+}
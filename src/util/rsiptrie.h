@@ -0,0 +1,95 @@
+/*******************************************************************************
+ * libretroshare/src/util: rsiptrie.h                                          *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <list>
+
+#include "util/rsnet.h"
+
+/**
+ * Longest-prefix-match table for IPv4 and IPv6 address prefixes.
+ * IPv4 prefixes are stored as IPv4-mapped IPv6 prefixes (::ffff:0:0/96), so
+ * that a single path-compressed binary trie serves both families. A lookup
+ * walks at most one node per distinct prefix length on the path, whatever the
+ * number of prefixes in the table.
+ * The table is not synchronised: fill it once, then share it read-only.
+ */
+class RsIpPrefixTrie
+{
+public:
+	RsIpPrefixTrie();
+
+	/**
+	 * Adds a prefix. Bits past prefix_len in addr are ignored. Inserting an
+	 * existing prefix replaces its value.
+	 * @param prefix_len in bits, relative to the family of addr (0-32 for
+	 *   IPv4, 0-128 for IPv6)
+	 * @param value returned by lookup() for addresses covered by this prefix
+	 */
+	bool insert(const sockaddr_storage& addr, uint8_t prefix_len, uint32_t value);
+	bool insert(const uint8_t key[16], uint8_t prefix_len, uint32_t value);
+
+	/**
+	 * @param value set to the value of the longest prefix covering addr
+	 * @return false if no prefix covers addr
+	 */
+	bool lookup(const sockaddr_storage& addr, uint32_t& value) const;
+	bool lookup(const uint8_t key[16], uint32_t& value) const;
+
+	/// number of prefixes in the table
+	uint32_t size() const { return mCount; }
+	void clear();
+
+	/// IPv6 key of addr, IPv4 addresses being mapped into ::ffff:0:0/96
+	static bool toKey(const sockaddr_storage& addr, uint8_t key[16]);
+
+	/**
+	 * Parses "a.b.c.d", "a.b.c.d/n", "x:y::z" or "x:y::z/n" into a key and a
+	 * prefix length counted on the 128 bits of the key.
+	 */
+	static bool parsePrefix(const std::string& s, uint8_t key[16], uint8_t& key_prefix_len);
+
+	/**
+	 * Splits the IPv4 range [first,last] (host byte order) into the smallest
+	 * list of prefixes covering it exactly.
+	 */
+	static void rangeToPrefixes( uint32_t first, uint32_t last,
+	                             std::list<std::pair<uint32_t,uint8_t> >& prefixes );
+
+private:
+	struct Node
+	{
+		uint64_t key[2];	// big endian halves of the prefix, bits past len cleared
+		uint8_t  len;
+		bool     has_value;
+		uint32_t value;
+		uint32_t child[2];	// 0 means none: the root is never anyone's child
+	};
+
+	uint32_t newNode(const uint64_t key[2], uint8_t len);
+
+	std::vector<Node> mNodes;
+	uint32_t mCount;
+};
@@ -0,0 +1,84 @@
+/*******************************************************************************
+ * libretroshare/src/util: rsmpscqueue.h                                       *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+/**
+ * Unbounded lock-free FIFO queue for many producers and a single consumer.
+ * Producers never block each other nor the consumer: pushing costs one
+ * allocation and one atomic exchange. Only one thread at time may call pop().
+ */
+template<typename T> class RsMpscQueue
+{
+public:
+	RsMpscQueue() : mHead(new Node), mTail(mHead.load()) {}
+
+	~RsMpscQueue()
+	{
+		T tmp;
+		while(pop(tmp));
+		delete mTail;
+	}
+
+	RsMpscQueue(const RsMpscQueue&) = delete;
+	RsMpscQueue& operator=(const RsMpscQueue&) = delete;
+
+	/// Can be called concurrently from any thread
+	void push(T value)
+	{
+		Node* node = new Node(std::move(value));
+		Node* prev = mHead.exchange(node, std::memory_order_acq_rel);
+		prev->mNext.store(node, std::memory_order_release);
+	}
+
+	/// Must be called only by the consumer thread
+	bool pop(T& value)
+	{
+		Node* tail = mTail;
+		Node* next = tail->mNext.load(std::memory_order_acquire);
+		if(!next) return false;
+
+		value = std::move(next->mValue);
+		mTail = next;
+		delete tail;
+		return true;
+	}
+
+	/// Must be called only by the consumer thread
+	bool empty() const
+	{ return !mTail->mNext.load(std::memory_order_acquire); }
+
+private:
+	struct Node
+	{
+		Node() : mNext(nullptr) {}
+		explicit Node(T&& value) : mNext(nullptr), mValue(std::move(value)) {}
+
+		std::atomic<Node*> mNext;
+		T mValue;
+	};
+
+	std::atomic<Node*> mHead; /// Last pushed, written by producers
+	Node* mTail;              /// Already consumed stub, owned by the consumer
+};
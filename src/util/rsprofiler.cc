@@ -0,0 +1,267 @@
+/*******************************************************************************
+ * libretroshare/src/util: rsprofiler.cc                                       *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "util/rsprofiler.h"
+#include "util/rsdebug.h"
+#include "util/rsdir.h"
+#include "retroshare/rsconfig.h"
+
+/*static*/ constexpr uint32_t RsProfiler::HISTOGRAM_BUCKETS;
+/*static*/ std::atomic<bool> RsProfiler::sEnabled(false);
+
+namespace
+{
+std::mutex sSectionsMutex;
+std::map<std::string, std::unique_ptr<RsProfiler::Section>> sSections;
+
+std::mutex sDumpMutex;
+std::string sDumpPath;
+uint32_t sDumpIntervalSecs = 0;
+std::chrono::steady_clock::time_point sLastDump;
+
+/// Section currently sampled on this thread, parent of new child sections
+thread_local RsProfiler::Section* tCurrentSection = nullptr;
+
+uint64_t wallNowUs()
+{
+	using namespace std::chrono;
+	return static_cast<uint64_t>( duration_cast<microseconds>(
+	            steady_clock::now().time_since_epoch() ).count() );
+}
+
+uint64_t threadCpuNowUs()
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+	timespec ts;
+	if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+		return static_cast<uint64_t>(ts.tv_sec) * 1000000 +
+		        static_cast<uint64_t>(ts.tv_nsec) / 1000;
+#endif
+	return 0;
+}
+
+void atomicMax(std::atomic<uint64_t>& target, uint64_t value)
+{
+	uint64_t current = target.load(std::memory_order_relaxed);
+	while( current < value && !target.compare_exchange_weak(
+	           current, value, std::memory_order_relaxed ) );
+}
+}
+
+RsProfiler::Section::Section(const std::string& name) : mName(name)
+{ reset(); }
+
+void RsProfiler::Section::record(uint64_t wallUs, uint64_t cpuUs)
+{
+	mSamples.fetch_add(1, std::memory_order_relaxed);
+	mWallTotalUs.fetch_add(wallUs, std::memory_order_relaxed);
+	mCpuTotalUs.fetch_add(cpuUs, std::memory_order_relaxed);
+	atomicMax(mWallMaxUs, wallUs);
+
+	uint32_t bucket = 0;
+	while(bucket + 1 < HISTOGRAM_BUCKETS && (wallUs >> (bucket + 1))) ++bucket;
+	mWallHistogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void RsProfiler::Section::setQueueDepth(uint64_t depth)
+{
+	mQueueDepth.store(depth, std::memory_order_relaxed);
+	atomicMax(mQueueDepthMax, depth);
+}
+
+void RsProfiler::Section::getStats(RsProfilerSectionStats& stats) const
+{
+	stats.mName = mName;
+	stats.mSamples = mSamples.load(std::memory_order_relaxed);
+	stats.mWallTotalUs = mWallTotalUs.load(std::memory_order_relaxed);
+	stats.mWallMaxUs = mWallMaxUs.load(std::memory_order_relaxed);
+	stats.mCpuTotalUs = mCpuTotalUs.load(std::memory_order_relaxed);
+	stats.mQueueDepth = mQueueDepth.load(std::memory_order_relaxed);
+	stats.mQueueDepthMax = mQueueDepthMax.load(std::memory_order_relaxed);
+
+	// Trailing empty buckets are omitted to keep JSON answers short
+	stats.mWallHistogram.clear();
+	uint32_t used = HISTOGRAM_BUCKETS;
+	while(used && !mWallHistogram[used - 1].load(std::memory_order_relaxed))
+		--used;
+	for(uint32_t i = 0; i < used; ++i)
+		stats.mWallHistogram.push_back(
+		            mWallHistogram[i].load(std::memory_order_relaxed) );
+}
+
+void RsProfiler::Section::reset()
+{
+	mSamples = 0;
+	mWallTotalUs = 0;
+	mWallMaxUs = 0;
+	mCpuTotalUs = 0;
+	for(auto& bucket : mWallHistogram) bucket = 0;
+	mQueueDepth = 0;
+	mQueueDepthMax = 0;
+}
+
+RsProfiler::ScopedSample::ScopedSample(Section* section) :
+    mSection(section && isEnabled() ? section : nullptr), mParent(nullptr),
+    mWallStartUs(0), mCpuStartUs(0)
+{
+	if(!mSection) return;
+
+	mParent = tCurrentSection;
+	tCurrentSection = mSection;
+	mWallStartUs = wallNowUs();
+	mCpuStartUs = threadCpuNowUs();
+}
+
+RsProfiler::ScopedSample::~ScopedSample()
+{
+	if(!mSection) return;
+
+	const uint64_t cpuNow = threadCpuNowUs();
+	const uint64_t wallNow = wallNowUs();
+	mSection->record( wallNow - mWallStartUs,
+	                  cpuNow >= mCpuStartUs ? cpuNow - mCpuStartUs : 0 );
+	tCurrentSection = mParent;
+}
+
+/*static*/ void RsProfiler::setEnabled(bool enabled)
+{
+	RS_INFO("Runtime profiler ", enabled ? "enabled" : "disabled");
+	sEnabled = enabled;
+}
+
+/*static*/ RsProfiler::Section* RsProfiler::section(const std::string& name)
+{
+	std::unique_lock<std::mutex> lock(sSectionsMutex);
+	auto& sectionPtr = sSections[name];
+	if(!sectionPtr) sectionPtr.reset(new Section(name));
+	return sectionPtr.get();
+}
+
+/*static*/ RsProfiler::Section* RsProfiler::childSection(
+        const std::string& name )
+{
+	/* Creating it as top level section would make it stay misplaced forever
+	 * if the profiler got enabled in the middle of a parent scope */
+	if(!tCurrentSection) return nullptr;
+	return section(tCurrentSection->name() + ";" + name);
+}
+
+/*static*/ void RsProfiler::getStatistics(
+        std::vector<RsProfilerSectionStats>& stats, bool reset )
+{
+	std::unique_lock<std::mutex> lock(sSectionsMutex);
+
+	stats.clear();
+	stats.reserve(sSections.size());
+	for(auto& sectionPair : sSections)
+	{
+		stats.emplace_back();
+		sectionPair.second->getStats(stats.back());
+		if(reset) sectionPair.second->reset();
+	}
+}
+
+/*static*/ bool RsProfiler::dumpFolded(const std::string& path)
+{
+	std::vector<RsProfilerSectionStats> stats;
+	getStatistics(stats);
+
+	/* Children run inside their parent scope on the same thread, so their time
+	 * is accounted in the parent too, flame graphs want self time instead */
+	std::map<std::string, uint64_t> childrenCpu;
+	for(const auto& section : stats)
+	{
+		auto sep = section.mName.rfind(';');
+		if(sep != std::string::npos)
+			childrenCpu[section.mName.substr(0, sep)] += section.mCpuTotalUs;
+	}
+
+	const std::string tmpPath = path + ".tmp";
+	{
+		std::ofstream out(tmpPath, std::ios::trunc);
+		if(!out)
+		{
+			RS_ERR("cannot open: ", tmpPath);
+			return false;
+		}
+
+		for(const auto& section : stats)
+		{
+			const uint64_t children = childrenCpu[section.mName];
+			if(section.mCpuTotalUs > children)
+				out << section.mName << " "
+				    << section.mCpuTotalUs - children << "\n";
+		}
+
+		if(!out.flush())
+		{
+			RS_ERR("failed writing: ", tmpPath);
+			return false;
+		}
+	}
+
+	/* Replace atomically so tools polling the file never see it half written.
+	 * Unlike std::rename, renameFile also replaces an existing file on Windows */
+	if(!RsDirUtil::renameFile(tmpPath, path))
+	{
+		RS_ERR("cannot rename ", tmpPath, " to ", path);
+		return false;
+	}
+
+	return true;
+}
+
+/*static*/ void RsProfiler::setDumpFile(
+        const std::string& path, uint32_t intervalSecs )
+{
+	std::unique_lock<std::mutex> lock(sDumpMutex);
+	sDumpPath = path;
+	sDumpIntervalSecs = std::max(intervalSecs, 1u);
+	sLastDump = std::chrono::steady_clock::now();
+}
+
+/*static*/ void RsProfiler::tickDump()
+{
+	if(!isEnabled()) return;
+
+	std::string path;
+	{
+		std::unique_lock<std::mutex> lock(sDumpMutex);
+		const auto now = std::chrono::steady_clock::now();
+		if( sDumpPath.empty() ||
+		        now - sLastDump < std::chrono::seconds(sDumpIntervalSecs) )
+			return;
+
+		sLastDump = now;
+		path = sDumpPath;
+	}
+
+	dumpFolded(path);
+}
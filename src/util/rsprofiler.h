@@ -0,0 +1,137 @@
+/*******************************************************************************
+ * libretroshare/src/util: rsprofiler.h                                        *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct RsProfilerSectionStats;
+
+/**
+ * Runtime profiler giving a per thread and per subsystem view of where CPU and
+ * wall clock time goes. Instrumented code records samples into named sections,
+ * names are stacks of frames separated by ';' so that the periodic dump can be
+ * fed directly to flamegraph.pl or any tool reading folded stacks.
+ * It is disabled by default, while disabled sampling costs a relaxed atomic
+ * load.
+ */
+class RsProfiler
+{
+public:
+	/** Wall clock histogram bucket i counts samples lasting [2^i, 2^(i+1))
+	 * microseconds, the last bucket counts everything longer */
+	static constexpr uint32_t HISTOGRAM_BUCKETS = 24;
+
+	class Section
+	{
+	public:
+		explicit Section(const std::string& name);
+
+		const std::string& name() const { return mName; }
+
+		void record(uint64_t wallUs, uint64_t cpuUs);
+
+		/// Record current depth of the queue this section is tracking
+		void setQueueDepth(uint64_t depth);
+
+		void getStats(RsProfilerSectionStats& stats) const;
+		void reset();
+
+	private:
+		const std::string mName;
+		std::atomic<uint64_t> mSamples;
+		std::atomic<uint64_t> mWallTotalUs;
+		std::atomic<uint64_t> mWallMaxUs;
+		std::atomic<uint64_t> mCpuTotalUs;
+		std::atomic<uint64_t> mWallHistogram[HISTOGRAM_BUCKETS];
+		std::atomic<uint64_t> mQueueDepth;
+		std::atomic<uint64_t> mQueueDepthMax;
+	};
+
+	/**
+	 * Sample wall clock and thread CPU time spent in the enclosing scope. While
+	 * a sample is active on a thread, sections created by childSection() on the
+	 * same thread are nested under it.
+	 */
+	class ScopedSample
+	{
+	public:
+		/// Do nothing if section is null or the profiler is disabled
+		explicit ScopedSample(Section* section);
+		~ScopedSample();
+
+	private:
+		Section* mSection;
+		Section* mParent;
+		uint64_t mWallStartUs;
+		uint64_t mCpuStartUs;
+	};
+
+	static bool isEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+	static void setEnabled(bool enabled);
+
+	/**
+	 * Get or create the section with the given full name
+	 * @return pointer valid until process exit, callers are expected to cache it
+	 */
+	static Section* section(const std::string& name);
+
+	/**
+	 * Like section() but nest name under the section sampled on this thread
+	 * @return null if no sample is active on this thread
+	 */
+	static Section* childSection(const std::string& name);
+
+	/** Convenience for hot paths, create the child section only the first time
+	 * it is needed while the profiler is enabled and keep it in cache
+	 * @return cache, may be null */
+	static Section* childSection(Section*& cache, const char* name)
+	{
+		if(!cache && isEnabled()) cache = childSection(std::string(name));
+		return cache;
+	}
+
+	/// @param[in] reset zero all sections after reading them
+	static void getStatistics(
+	        std::vector<RsProfilerSectionStats>& stats, bool reset = false );
+
+	/**
+	 * @brief Write CPU time of every section in folded stacks format, one
+	 *	"frame;frame;frame microseconds" line each, self time only
+	 * @return false if the file could not be written
+	 */
+	static bool dumpFolded(const std::string& path);
+
+	/**
+	 * @brief Periodically dump to path while the profiler is enabled
+	 * @param[in] path empty to disable periodic dumps
+	 */
+	static void setDumpFile(const std::string& path, uint32_t intervalSecs);
+
+	/// Dump if due, called once per second by the core thread
+	static void tickDump();
+
+private:
+	static std::atomic<bool> sEnabled;
+};
@@ -0,0 +1,134 @@
+/*******************************************************************************
+ * libretroshare/src/util: rssnapshot.h                                        *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "util/rsthreads.h"
+
+/**
+ * Immutable, versioned copy of read-mostly state published RCU style.
+ * Writers build a new value, usually while holding the mutex of the object
+ * owning the state, and publish() it: this costs one allocation and bumps the
+ * version. Readers go through a Reader which keeps a per thread reference to
+ * the latest value and touches shared memory only to check the version, so
+ * concurrent readers neither block each other nor the writers, and don't
+ * bounce a reference counter between cores.
+ * Each thread which read a snapshot keeps a reference to the last value it
+ * has seen until it exits, keep values small.
+ */
+template<typename T> class RsSnapshot
+{
+	struct Slot
+	{
+		Slot() : mVersion(0), mPins(0) {}
+
+		uint64_t mVersion;
+		uint32_t mPins;
+		std::shared_ptr<const T> mValue;
+	};
+
+public:
+	typedef std::shared_ptr<const T> Ptr;
+
+	RsSnapshot() : mId(nextId()), mVersion(1), mMtx("RsSnapshot"),
+	    mCurrent(std::make_shared<const T>()) {}
+
+	RsSnapshot(const RsSnapshot&) = delete;
+	RsSnapshot& operator=(const RsSnapshot&) = delete;
+
+	/// Replace the current value, can be called from any thread
+	void publish(T&& value)
+	{ publish(std::make_shared<const T>(std::move(value))); }
+
+	void publish(Ptr value)
+	{
+		RS_STACK_MUTEX(mMtx);
+		mCurrent = std::move(value);
+		mVersion.fetch_add(1, std::memory_order_release);
+	}
+
+	/// Latest published value, takes a lock so prefer Reader on hot paths
+	Ptr get() const
+	{
+		RS_STACK_MUTEX(mMtx);
+		return mCurrent;
+	}
+
+	uint64_t version() const { return mVersion.load(std::memory_order_acquire); }
+
+	/**
+	 * Gives access to the latest published value, which stays valid while the
+	 * Reader is alive. Readers nested on the same thread see the same value as
+	 * the outermost one.
+	 */
+	class Reader
+	{
+	public:
+		explicit Reader(const RsSnapshot& snapshot) :
+		    mSlot(snapshot.localSlot()) { ++mSlot.mPins; }
+		~Reader() { --mSlot.mPins; }
+
+		Reader(const Reader&) = delete;
+		Reader& operator=(const Reader&) = delete;
+
+		const T& operator*() const { return *mSlot.mValue; }
+		const T* operator->() const { return mSlot.mValue.get(); }
+
+	private:
+		Slot& mSlot;
+	};
+
+private:
+	Slot& localSlot() const
+	{
+		/* References to unordered_map elements survive rehashing, so Readers of
+		 * other snapshots created meanwhile don't invalidate this one */
+		static thread_local std::unordered_map<uint64_t, Slot> tSlots;
+
+		Slot& slot(tSlots[mId]);
+		uint64_t version = mVersion.load(std::memory_order_acquire);
+		if(slot.mVersion != version && !slot.mPins)
+		{
+			/* The value may already be newer than version, at worst next read
+			 * refreshes it again */
+			slot.mValue = get();
+			slot.mVersion = version;
+		}
+		return slot;
+	}
+
+	static uint64_t nextId()
+	{
+		static std::atomic<uint64_t> sLastId(0);
+		return ++sLastId;
+	}
+
+	const uint64_t mId;
+	std::atomic<uint64_t> mVersion;
+
+	mutable RsMutex mMtx; /// Protects mCurrent
+	Ptr mCurrent;
+};
@@ -25,9 +25,15 @@
 #include "rsthreads.h"
 
 #include "util/rsdebug.h"
+#include "util/rsprofiler.h"
+#include "retroshare/rsconfig.h"
 
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
 #include <ctime>
+#include <map>
+#include <mutex>
 #include <iostream>
 #include <thread>
 
@@ -223,6 +229,20 @@ bool RsThread::start(const std::string& threadName)
 	return false;
 }
 
+void RsTickingThread::run()
+{
+	RsProfiler::Section* section = nullptr;
+	while(!shouldStop())
+	{
+		if(!section && RsProfiler::isEnabled())
+			section = RsProfiler::section(
+			            threadName().empty() ? "unnamed" : threadName() );
+
+		RsProfiler::ScopedSample sample(section);
+		threadTick();
+	}
+}
+
 RsQueueThread::RsQueueThread(uint32_t min, uint32_t max, double relaxFactor )
     :mMinSleep(min), mMaxSleep(max), mRelaxFactor(relaxFactor)
 {
@@ -266,15 +286,171 @@ void RsQueueThread::threadTick()
 	std::this_thread::sleep_for(std::chrono::milliseconds(mLastSleep));
 }
 
+struct RsMutex::Contention
+{
+	explicit Contention(const std::string& name) : mName(name) { reset(); }
+
+	void reset()
+	{
+		mAcquisitions = 0;
+		mContended = 0;
+		mWaitTotalNs = 0;
+		mWaitMaxNs = 0;
+		mHoldTotalNs = 0;
+		mHoldMaxNs = 0;
+	}
+
+	const std::string mName;
+	std::atomic<uint64_t> mAcquisitions;
+	std::atomic<uint64_t> mContended;
+	std::atomic<uint64_t> mWaitTotalNs;
+	std::atomic<uint64_t> mWaitMaxNs;
+	std::atomic<uint64_t> mHoldTotalNs;
+	std::atomic<uint64_t> mHoldMaxNs;
+};
+
+/*static*/ std::atomic<bool> RsMutex::sContentionProfiling(false);
+/*static*/ constexpr size_t RsMutex::MAX_CONTENTION_NAMES;
+
+namespace
+{
+/* Registry and counters are never freed because mutexes living in static
+ * storage may still be locked during static destruction */
+std::mutex& contentionRegistryMtx()
+{
+	static std::mutex* mtx = new std::mutex;
+	return *mtx;
+}
+
+std::map<std::string, RsMutex::Contention*>& contentionRegistry()
+{
+	static auto* registry = new std::map<std::string, RsMutex::Contention*>;
+	return *registry;
+}
+
+uint64_t steadyNowNs()
+{
+	using namespace std::chrono;
+	return static_cast<uint64_t>( duration_cast<nanoseconds>(
+	            steady_clock::now().time_since_epoch() ).count() );
+}
+
+void atomicMax(std::atomic<uint64_t>& target, uint64_t value)
+{
+	uint64_t current = target.load(std::memory_order_relaxed);
+	while( current < value && !target.compare_exchange_weak(
+	           current, value, std::memory_order_relaxed ) );
+}
+}
+
+/*static*/ RsMutex::Contention* RsMutex::contentionFor(const std::string& name)
+{
+	std::unique_lock<std::mutex> lock(contentionRegistryMtx());
+	auto& registry = contentionRegistry();
+
+	auto it = registry.find(name);
+	if(it != registry.end()) return it->second;
+
+	// Some names embed ids, don't let them grow the registry without bounds
+	const std::string& key =
+	        registry.size() < MAX_CONTENTION_NAMES ? name : "(other)";
+	auto& contention = registry[key];
+	if(!contention) contention = new Contention(key);
+	return contention;
+}
+
+/*static*/ void RsMutex::setContentionProfiling(bool enabled)
+{
+	RS_INFO("RsMutex contention profiling ", enabled ? "enabled" : "disabled");
+	sContentionProfiling = enabled;
+}
+
+/*static*/ void RsMutex::getContentionStats(
+        std::vector<RsMutexContentionStats>& stats, uint32_t topN, bool reset )
+{
+	stats.clear();
+	{
+		std::unique_lock<std::mutex> lock(contentionRegistryMtx());
+		for(auto& namePair : contentionRegistry())
+		{
+			Contention& c(*namePair.second);
+			if(!c.mAcquisitions) continue;
+
+			RsMutexContentionStats s;
+			s.mName = c.mName;
+			s.mAcquisitions = c.mAcquisitions;
+			s.mContended = c.mContended;
+			s.mWaitTotalUs = c.mWaitTotalNs / 1000;
+			s.mWaitMaxUs = c.mWaitMaxNs / 1000;
+			s.mHoldTotalUs = c.mHoldTotalNs / 1000;
+			s.mHoldMaxUs = c.mHoldMaxNs / 1000;
+			stats.push_back(s);
+
+			if(reset) c.reset();
+		}
+	}
+
+	std::sort( stats.begin(), stats.end(),
+	           []( const RsMutexContentionStats& a,
+	               const RsMutexContentionStats& b )
+	{
+		if(a.mWaitTotalUs != b.mWaitTotalUs)
+			return a.mWaitTotalUs > b.mWaitTotalUs;
+		return a.mContended > b.mContended;
+	} );
+
+	if(topN && stats.size() > topN) stats.resize(topN);
+}
+
+void RsMutex::accountAcquisition(uint64_t waitStartNs)
+{
+	const uint64_t now = steadyNowNs();
+	mContention->mAcquisitions.fetch_add(1, std::memory_order_relaxed);
+	if(waitStartNs)
+	{
+		const uint64_t wait = now - waitStartNs;
+		mContention->mContended.fetch_add(1, std::memory_order_relaxed);
+		mContention->mWaitTotalNs.fetch_add(wait, std::memory_order_relaxed);
+		atomicMax(mContention->mWaitMaxNs, wait);
+	}
+	mLockedAtNs = now;
+}
+
+bool RsMutex::trylock()
+{
+	if(pthread_mutex_trylock(&realMutex)) return false;
+	if(contentionProfiling()) accountAcquisition(0);
+	return true;
+}
+
 void RsMutex::unlock()
 {
+	// Written only by the owner while locked so no race here
+	if(mLockedAtNs)
+	{
+		const uint64_t hold = steadyNowNs() - mLockedAtNs;
+		mLockedAtNs = 0;
+		mContention->mHoldTotalNs.fetch_add(hold, std::memory_order_relaxed);
+		atomicMax(mContention->mHoldMaxNs, hold);
+	}
+
 	_thread_id = 0;
 	pthread_mutex_unlock(&realMutex);
 }
 
 void RsMutex::lock()
 {
-	int err = pthread_mutex_lock(&realMutex);
+	/* When profiling, try first without blocking so uncontended acquisitions
+	 * can be told apart and cost just one more clock read */
+	const bool profiled = contentionProfiling();
+	uint64_t waitStartNs = 0;
+	int err = profiled ? pthread_mutex_trylock(&realMutex) : EBUSY;
+	if(err)
+	{
+		if(profiled) waitStartNs = steadyNowNs();
+		err = pthread_mutex_lock(&realMutex);
+	}
+
 	if( err != 0)
 	{
 		RsErr() << __PRETTY_FUNCTION__ << "pthread_mutex_lock returned: "
@@ -292,6 +468,7 @@ void RsMutex::lock()
 	}
  
 	_thread_id = pthread_self();
+	if(profiled) accountAcquisition(waitStartNs);
 }
 
 #ifdef RS_MUTEX_DEBUG
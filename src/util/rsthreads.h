@@ -31,6 +31,7 @@
 #include <atomic>
 #include <thread>
 #include <functional>
+#include <vector>
 
 #include "util/rsmemory.h"
 #include "util/rsdeprecate.h"
@@ -39,23 +40,25 @@
 #	include "util/rstime.h"
 #endif
 
+struct RsMutexContentionStats;
+
 /**
  * @brief Provide mutexes that keep track of the owner. Based on pthread mutex.
+ * When contention profiling is enabled at runtime acquisitions, contended
+ * acquisitions, wait and hold times are accounted per mutex name, mutexes
+ * sharing the same name share the same counters.
  */
 class RsMutex
 {
 public:
 
-	RsMutex(const std::string& name) : _thread_id(0)
+	RsMutex(const std::string& name) : _thread_id(0),
+	    mContention(contentionFor(name)), mLockedAtNs(0)
 #ifdef RS_MUTEX_DEBUG
 	  , _name(name)
 #endif
 	{
 		pthread_mutex_init(&realMutex, nullptr);
-
-#ifndef RS_MUTEX_DEBUG
-		(void) name; // remove unused parameter warnings
-#endif
 	}
 
 	~RsMutex() { pthread_mutex_destroy(&realMutex); }
@@ -64,16 +67,49 @@ public:
 
 	void lock();
 	void unlock();
-	bool trylock() { return (0 == pthread_mutex_trylock(&realMutex)); }
+	bool trylock();
 
 #ifdef RS_MUTEX_DEBUG
 	const std::string& name() const { return _name ; }
 #endif
 
+	/// Enable or disable contention profiling of all RsMutex at runtime
+	static void setContentionProfiling(bool enabled);
+	static bool contentionProfiling()
+	{ return sContentionProfiling.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Get contention statistics of most contended mutexes
+	 * @param[out] stats storage, sorted by total wait time, descending
+	 * @param[in] topN maximum number of entries, 0 for all
+	 * @param[in] reset zero all counters after reading them
+	 */
+	static void getContentionStats(
+	        std::vector<RsMutexContentionStats>& stats, uint32_t topN,
+	        bool reset );
+
+	/// Names beyond this count are accounted together
+	static constexpr size_t MAX_CONTENTION_NAMES = 2048;
+
+	struct Contention;
+
 private:
+	static Contention* contentionFor(const std::string& name);
+
+	/// @param[in] waitStartNs when waiting started, 0 if not contended
+	void accountAcquisition(uint64_t waitStartNs);
+
+	static std::atomic<bool> sContentionProfiling;
+
 	pthread_mutex_t realMutex;
 	pthread_t _thread_id;
 
+	/// Counters shared by all mutexes with the same name
+	Contention* const mContention;
+
+	/// Steady clock time of last acquisition, 0 if not profiled
+	uint64_t mLockedAtNs;
+
 #ifdef RS_MUTEX_DEBUG
 	std::string _name;
 #endif
@@ -231,6 +267,16 @@ public:
 	static void async(const std::function<void()>& fn)
 	{ std::thread(fn).detach(); }
 
+	/**
+	 * @return number of threads the hardware can run concurrently, 1 if it
+	 *	cannot be determined
+	 */
+	static uint32_t hardwareConcurrency()
+	{
+		const uint32_t n = std::thread::hardware_concurrency();
+		return n ? n : 1;
+	}
+
 	/** @return RsThread full name */
 	const std::string& threadName() { return mFullName; }
 
@@ -317,8 +363,9 @@ public:
 	virtual void threadTick() = 0;
 
 private:
-	/// Implement the run loop and continuously call threadTick() in it
-	void run() override { while(!shouldStop()) threadTick(); }
+	/** Implement the run loop and continuously call threadTick() in it,
+	 * sampling each tick if RsProfiler is enabled */
+	void run() override;
 };
 
 // TODO: Used just one time, is this really an useful abstraction?
@@ -51,6 +51,22 @@ class FakeServiceControl: public p3ServiceControl
 	(void) id;
         return true ;
     }
+
+    virtual bool registerService(const RsServiceInfo &info, bool defaultOn, pqiService *service)
+    {
+        mServices[info.mServiceType] = service ;
+        return p3ServiceControl::registerService(info, defaultOn, service) ;
+    }
+
+    // no filtering either for incoming items
+    virtual pqiService *getDispatchTarget(uint32_t serviceId, const RsPeerId& id)
+    {
+	(void) id;
+        std::map<uint32_t, pqiService *>::const_iterator it = mServices.find(serviceId) ;
+        return (it != mServices.end()) ? it->second : NULL ;
+    }
+
     p3LinkMgr *mLink;
+    std::map<uint32_t, pqiService *> mServices;
 };
 
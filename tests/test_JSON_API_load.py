@@ -0,0 +1,138 @@
+#!/usr/bin/python3
+
+# Copyright (C) 2026  Retroshare Team <contact@retroshare.cc>
+#
+# This program is free software: you can redistribute it and/or modify it under
+# the terms of the GNU Affero General Public License as published by the
+# Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License along
+# with this program. If not, see <https://www.gnu.org/licenses/>
+#
+# SPDX-FileCopyrightText: Retroshare Team <contact@retroshare.cc>
+# SPDX-License-Identifier: AGPL-3.0-only
+
+# Load test for a running RetroShare JSON API server.
+#
+# Each client thread polls the given endpoints round robin, like a dashboard
+# would, and the script reports requests per second and latency percentiles
+# for every endpoint. Run it once with and once without --no-keep-alive to see
+# what reusing connections buys.
+#
+# API_BASE_URL and API_TOKEN are taken from the environment, like the other
+# JSON API tests, e.g.:
+#   API_TOKEN=user:password ./test_JSON_API_load.py -c 16 -d 20 \
+#       /rsPeers/getFriendList /rsIdentity/getIdentitiesSummaries
+
+import argparse
+import base64
+import http.client
+import os
+import socket
+import threading
+import time
+import urllib.parse
+
+
+def percentile(sortedValues, p):
+	if not sortedValues:
+		return 0.0
+	k = min(len(sortedValues) - 1, int(round(p / 100.0 * (len(sortedValues) - 1))))
+	return sortedValues[k]
+
+
+class Client(threading.Thread):
+	def __init__(self, url, auth, endpoints, deadline, keepAlive):
+		super().__init__(daemon=True)
+		self.url = url
+		self.headers = { "Authorization": "Basic " + auth,
+		                 "Content-Type": "application/json" }
+		if not keepAlive:
+			self.headers["Connection"] = "close"
+		self.endpoints = endpoints
+		self.deadline = deadline
+		self.keepAlive = keepAlive
+		self.latencies = { e: [] for e in endpoints }
+		self.errors = 0
+		self.bytes = 0
+
+	def connect(self):
+		conn = http.client.HTTPConnection(self.url.hostname, self.url.port or 80)
+		conn.connect()
+		# don't let Nagle and delayed ACK dominate the measured latency
+		conn.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+		return conn
+
+	def run(self):
+		conn = self.connect()
+		i = 0
+		while time.monotonic() < self.deadline:
+			endpoint = self.endpoints[i % len(self.endpoints)]
+			i += 1
+			start = time.monotonic()
+			try:
+				conn.request("POST", endpoint, b"{}", self.headers)
+				resp = conn.getresponse()
+				self.bytes += len(resp.read())
+				if resp.status != 200:
+					self.errors += 1
+				self.latencies[endpoint].append(time.monotonic() - start)
+				if not self.keepAlive or resp.will_close:
+					conn.close()
+					conn = self.connect()
+			except (OSError, http.client.HTTPException):
+				self.errors += 1
+				conn.close()
+				conn = self.connect()
+		conn.close()
+
+
+def main():
+	parser = argparse.ArgumentParser(description="RetroShare JSON API load test")
+	parser.add_argument("endpoints", nargs="*",
+	                    default=["/rsPeers/getFriendList", "/rsJsonApi/version"])
+	parser.add_argument("-c", "--clients", type=int, default=8,
+	                    help="concurrent connections")
+	parser.add_argument("-d", "--duration", type=float, default=10,
+	                    help="test duration in seconds")
+	parser.add_argument("--no-keep-alive", action="store_true",
+	                    help="open a new connection for every request")
+	args = parser.parse_args()
+
+	url = urllib.parse.urlparse(os.environ.get("API_BASE_URL", "http://127.0.0.1:9092"))
+	auth = base64.b64encode(os.environ.get("API_TOKEN", "0000:0000").encode()).decode()
+
+	deadline = time.monotonic() + args.duration
+	clients = [ Client(url, auth, args.endpoints, deadline, not args.no_keep_alive)
+	            for _ in range(args.clients) ]
+	start = time.monotonic()
+	for c in clients: c.start()
+	for c in clients: c.join()
+	elapsed = time.monotonic() - start
+
+	total = 0
+	print("%-40s %8s %9s %9s %9s %9s" % ("endpoint", "req/s", "p50 ms", "p90 ms", "p99 ms", "max ms"))
+	for e in args.endpoints:
+		lat = sorted(l for c in clients for l in c.latencies[e])
+		total += len(lat)
+		print("%-40s %8.1f %9.2f %9.2f %9.2f %9.2f" % (
+		      e, len(lat) / elapsed, percentile(lat, 50) * 1000,
+		      percentile(lat, 90) * 1000, percentile(lat, 99) * 1000,
+		      (lat[-1] if lat else 0) * 1000 ))
+
+	errors = sum(c.errors for c in clients)
+	received = sum(c.bytes for c in clients)
+	print("total: %d requests in %.1fs, %.1f req/s, %.1f KiB/s, %d errors (%s)" % (
+	      total, elapsed, total / elapsed, received / 1024.0 / elapsed, errors,
+	      "new connection per request" if args.no_keep_alive else "keep-alive" ))
+
+	return 1 if errors else 0
+
+
+if __name__ == "__main__":
+	exit(main())
@@ -0,0 +1,115 @@
+/*******************************************************************************
+ * unittests/libretroshare/deep_search/files_index_test.cc                     *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <unistd.h>
+
+#include "deep_search/filesindex.hpp"
+#include "util/folderiterator.h"
+
+using DeepSearch::SharedXapianDb;
+
+namespace
+{
+/* Files named "busy..." keep their extraction worker until the gate opens */
+std::atomic<bool> gateOpen(false);
+std::atomic<uint32_t> busyExtracted(0);
+std::atomic<uint32_t> removedExtracted(0);
+
+uint32_t testIndexer( const std::string&, const std::string& name,
+                      Xapian::TermGenerator&, Xapian::Document& )
+{
+	if(name.compare(0, 4, "busy") == 0)
+	{
+		while(!gateOpen) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		++busyExtracted;
+	}
+	else if(name == "removed") ++removedExtracted;
+
+	return 0;
+}
+
+uint32_t countDocs(SharedXapianDb& db)
+{
+	uint32_t count = 0;
+	db.read([&](Xapian::Database& rDb) { count = rDb.get_doccount(); });
+	return count;
+}
+
+/// Wait until given number of documents has been committed
+bool waitDocs(SharedXapianDb& db, uint32_t count)
+{
+	for(int i = 0; i < 2000; ++i)
+	{
+		db.flush();
+		if(countDocs(db) >= count) return countDocs(db) == count;
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	return false;
+}
+
+void removeDb(const std::string& path)
+{
+	for(librs::util::FolderIterator it(path, false); it.isValid(); it.next())
+		remove(it.file_fullpath().c_str());
+
+	rmdir(path.c_str());
+}
+} // namespace
+
+TEST(libretroshare_deep_search, FilesIndexRemoveCancelsPendingExtraction)
+{
+	const std::string path = "/tmp/rs_files_index_" + std::to_string(getpid());
+	DeepFilesIndex::registerIndexer(0, testIndexer);
+	DeepFilesIndex index(path);
+	auto db = SharedXapianDb::forPath(path);
+
+	/* Keep every extraction worker busy, so the next file waits in queue */
+	std::vector<RsFileHash> busy;
+	for(uint32_t i = 0; i < DeepFilesIndex::MAX_EXTRACTION_WORKERS; ++i)
+	{
+		busy.push_back(RsFileHash::random());
+		ASSERT_FALSE(index.indexFile("/dev/null", "busy" + std::to_string(i), busy.back()));
+	}
+
+	const RsFileHash removed = RsFileHash::random();
+	ASSERT_FALSE(index.indexFile("/dev/null", "removed", removed));
+	EXPECT_TRUE(db->isKnownIndexed("Q" + removed.toStdString()));
+
+	ASSERT_FALSE(index.removeFileFromIndex(removed));
+	EXPECT_FALSE(db->isKnownIndexed("Q" + removed.toStdString()));
+
+	gateOpen = true;
+	ASSERT_TRUE(waitDocs(*db, busy.size()));
+	EXPECT_EQ(busy.size(), busyExtracted);
+	EXPECT_EQ(0u, removedExtracted);
+
+	/* Once removed the file can be indexed again */
+	ASSERT_FALSE(index.indexFile("/dev/null", "removed", removed));
+	ASSERT_TRUE(waitDocs(*db, busy.size() + 1));
+	EXPECT_EQ(1u, removedExtracted);
+
+	removeDb(path);
+}
@@ -0,0 +1,249 @@
+/*******************************************************************************
+ * unittests/libretroshare/deep_search/xapian_writer_test.cc                   *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+
+#include "deep_search/commonutils.hpp"
+#include "util/folderiterator.h"
+
+using DeepSearch::SharedXapianDb;
+
+static std::string testDbPath(const std::string& name)
+{
+	return "/tmp/rs_xapian_writer_" + name + "_" + std::to_string(getpid());
+}
+
+static void removeDb(const std::string& path)
+{
+	for(librs::util::FolderIterator it(path, false); it.isValid(); it.next())
+		remove(it.file_fullpath().c_str());
+
+	rmdir(path.c_str());
+}
+
+static Xapian::Document makeDoc(uint32_t n, std::string& idTerm)
+{
+	Xapian::Document doc;
+	Xapian::TermGenerator termgenerator;
+	termgenerator.set_document(doc);
+
+	const std::string text = "file number " + std::to_string(n) +
+	        " some music track by artist " + std::to_string(n % 97) +
+	        " from album " + std::to_string(n % 13);
+	termgenerator.index_text(text);
+	doc.set_data(text);
+
+	idTerm = "Q" + std::to_string(n);
+	doc.add_boolean_term(idTerm);
+	return doc;
+}
+
+static uint32_t countDocs(SharedXapianDb& db)
+{
+	uint32_t count = 0;
+	db.read([&](Xapian::Database& rDb) { count = rDb.get_doccount(); });
+	return count;
+}
+
+TEST(libretroshare_deep_search, SharedXapianDbReaderFollowsWriter)
+{
+	const std::string path = testDbPath("reader");
+	auto db = SharedXapianDb::forPath(path);
+	EXPECT_EQ(db, SharedXapianDb::forPath(path));
+
+	std::string idTerm;
+	for(uint32_t i = 0; i < 10; ++i)
+	{
+		Xapian::Document doc = makeDoc(i, idTerm);
+		db->push([idTerm, doc](Xapian::WritableDatabase& wDb)
+		{ wDb.replace_document(idTerm, doc); });
+	}
+	ASSERT_FALSE(db->flush());
+	EXPECT_EQ(countDocs(*db), 10u);
+
+	// The reader must be reopened after the next commit
+	db->push([](Xapian::WritableDatabase& wDb) { wDb.delete_document("Q3"); });
+	ASSERT_FALSE(db->flush());
+	EXPECT_EQ(countDocs(*db), 9u);
+
+	// Flushing an empty queue returns immediately
+	EXPECT_FALSE(db->flush(std::chrono::milliseconds(0)));
+
+	removeDb(path);
+}
+
+TEST(libretroshare_deep_search, SharedXapianDbKnownIndexedFilter)
+{
+	auto db = SharedXapianDb::forPath(testDbPath("filter"));
+
+	EXPECT_FALSE(db->isKnownIndexed("Qabc"));
+	db->setKnownIndexed("Qabc");
+	EXPECT_TRUE(db->isKnownIndexed("Qabc"));
+	db->setKnownIndexed("Qabc", false);
+	EXPECT_FALSE(db->isKnownIndexed("Qabc"));
+}
+
+TEST(libretroshare_deep_search, SharedXapianDbKnownIndexedAfterCommit)
+{
+	const std::string path = testDbPath("committed");
+	auto db = SharedXapianDb::forPath(path);
+
+	ASSERT_TRUE(db->beginIndexing("Q1"));
+	ASSERT_TRUE(db->beginIndexing("Q2"));
+	EXPECT_FALSE(db->beginIndexing("Q1"));
+
+	std::string idTerm;
+	Xapian::Document doc = makeDoc(1, idTerm);
+	EXPECT_TRUE(db->pushIndexed("Q1", [idTerm, doc](Xapian::WritableDatabase& wDb)
+	{ wDb.replace_document(idTerm, doc); }));
+	EXPECT_TRUE(db->pushIndexed("Q2", [](Xapian::WritableDatabase&)
+	{ throw Xapian::InvalidArgumentError("test failure"); }));
+	ASSERT_FALSE(db->flush());
+
+	// The failed one can be indexed again
+	EXPECT_TRUE(db->isKnownIndexed("Q1"));
+	EXPECT_FALSE(db->isKnownIndexed("Q2"));
+	EXPECT_FALSE(db->beginIndexing("Q1"));
+	EXPECT_TRUE(db->beginIndexing("Q2"));
+
+	// Removed while being indexed, the removal wins
+	db->setKnownIndexed("Q2", false);
+	EXPECT_FALSE(db->pushIndexed("Q2", [](Xapian::WritableDatabase& wDb)
+	{ wDb.replace_document("Q2", Xapian::Document()); }));
+	ASSERT_FALSE(db->flush());
+	EXPECT_EQ(countDocs(*db), 1u);
+
+	removeDb(path);
+}
+
+/* The database cannot be created under a regular file, so the writer drops the
+ * queued operations after OPEN_RETRY_TIMEOUT */
+TEST(libretroshare_deep_search, SharedXapianDbFlushReportsLostOperations)
+{
+	const std::string file = testDbPath("lost");
+	std::ofstream(file) << "not a directory";
+	auto db = SharedXapianDb::forPath(file + "/db");
+
+	std::string idTerm;
+	Xapian::Document doc = makeDoc(1, idTerm);
+	db->push([idTerm, doc](Xapian::WritableDatabase& wDb)
+	{ wDb.replace_document(idTerm, doc); });
+
+	const std::chrono::seconds timeout(SharedXapianDb::OPEN_RETRY_TIMEOUT + 10);
+	EXPECT_EQ(db->flush(timeout), std::errc::io_error);
+
+	// Already reported, nothing else pushed since
+	EXPECT_FALSE(db->flush(std::chrono::milliseconds(0)));
+
+	remove(file.c_str());
+}
+
+TEST(libretroshare_deep_search, SharedXapianDbConcurrentReaders)
+{
+	const std::string path = testDbPath("readers");
+	auto db = SharedXapianDb::forPath(path);
+
+	std::string idTerm;
+	Xapian::Document doc = makeDoc(1, idTerm);
+	db->push([idTerm, doc](Xapian::WritableDatabase& wDb)
+	{ wDb.replace_document(idTerm, doc); });
+	ASSERT_FALSE(db->flush());
+
+	/* Each read waits for all the others to be running, which never happens
+	 * if reads are serialized */
+	const uint32_t READERS = 3;
+	std::atomic<uint32_t> inside(0);
+	std::atomic<uint32_t> together(0);
+	std::atomic<uint32_t> done(0);
+
+	for(uint32_t i = 0; i < READERS; ++i)
+		RsThread::async([&]()
+		{
+			db->read([&](Xapian::Database& rDb)
+			{
+				++inside;
+				const auto deadline = std::chrono::steady_clock::now() +
+				        std::chrono::seconds(5);
+				while( inside < READERS &&
+				       std::chrono::steady_clock::now() < deadline )
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				if(inside == READERS && rDb.get_doccount() == 1) ++together;
+			});
+			++done;
+		});
+
+	while(done < READERS)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	EXPECT_EQ(together, READERS);
+
+	removeDb(path);
+}
+
+/* Compare the persistent batched writer against opening the writable database
+ * and committing for each document, as the indexes used to do */
+TEST(libretroshare_deep_search, SharedXapianDbBulkIndexBenchmark)
+{
+	using clock = std::chrono::steady_clock;
+	const uint32_t PER_DOC_COUNT = 300;
+	const uint32_t BATCHED_COUNT = 20000;
+
+	const std::string perDocPath = testDbPath("per_doc");
+	auto start = clock::now();
+	for(uint32_t i = 0; i < PER_DOC_COUNT; ++i)
+	{
+		std::string idTerm;
+		Xapian::Document doc = makeDoc(i, idTerm);
+		Xapian::WritableDatabase wDb(perDocPath, Xapian::DB_CREATE_OR_OPEN);
+		wDb.replace_document(idTerm, doc);
+		wDb.commit();
+	}
+	const double perDocRate = PER_DOC_COUNT / std::chrono::duration<double>(
+	            clock::now() - start ).count();
+	removeDb(perDocPath);
+
+	const std::string batchedPath = testDbPath("batched");
+	auto db = SharedXapianDb::forPath(batchedPath);
+	start = clock::now();
+	for(uint32_t i = 0; i < BATCHED_COUNT; ++i)
+	{
+		std::string idTerm;
+		Xapian::Document doc = makeDoc(i, idTerm);
+		db->push([idTerm, doc](Xapian::WritableDatabase& wDb)
+		{ wDb.replace_document(idTerm, doc); });
+	}
+	ASSERT_FALSE(db->flush(std::chrono::seconds(120)));
+	const double batchedRate = BATCHED_COUNT / std::chrono::duration<double>(
+	            clock::now() - start ).count();
+	EXPECT_EQ(countDocs(*db), BATCHED_COUNT);
+	removeDb(batchedPath);
+
+	std::cerr << "Xapian bulk index: open per document " << perDocRate
+	          << " docs/s, persistent batched writer " << batchedRate
+	          << " docs/s" << std::endl;
+	EXPECT_GT(batchedRate, perDocRate);
+}
@@ -0,0 +1,206 @@
+/*******************************************************************************
+ * unittests/libretroshare/file_sharing/dir_sync_batch_test.cc                 *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <vector>
+#include <zlib.h>
+
+#include "file_sharing/dir_sync_batch.h"
+#include "util/rsrandom.h"
+
+static RsTlvBinaryData randomDirData(uint32_t size)
+{
+	RsTlvBinaryData data;
+	std::vector<uint8_t> buf(size);
+
+	for(uint32_t i=0; i<size; ++i) buf[i] = RSRandom::random_u32() & 0xff;
+
+	data.setBinData(buf.data(), size);
+	return data;
+}
+
+TEST(libretroshare_file_sharing, DirSyncBatchRoundTrip)
+{
+	DirSyncBatchWriter writer(1024*1024, 2*1024*1024);
+
+	std::vector<RsFileHash> hashes;
+	std::vector<RsTlvBinaryData> contents;
+
+	for(uint32_t i=0; i<50; ++i)
+	{
+		hashes.push_back(RsFileHash::random());
+
+		if(i % 3 == 0)
+		{
+			contents.push_back(RsTlvBinaryData());
+			EXPECT_TRUE(writer.addUpToDate(hashes.back()));
+		}
+		else
+		{
+			contents.push_back(randomDirData(i*97));
+			EXPECT_TRUE(writer.addContent(hashes.back(), contents.back()));
+		}
+	}
+	EXPECT_EQ(writer.nbRecords(), 50u);
+	EXPECT_FALSE(writer.full());
+
+	RsTlvBinaryData batch;
+	ASSERT_TRUE(writer.finish(batch));
+
+	DirSyncBatchReader reader;
+	ASSERT_TRUE(reader.load(batch, 1024*1024));
+
+	DirSyncBatchReader::Record record;
+	for(uint32_t i=0; i<50; ++i)
+	{
+		ASSERT_TRUE(reader.next(record));
+		EXPECT_EQ(record.dir_hash, hashes[i]);
+
+		if(i % 3 == 0)
+			EXPECT_EQ(record.type, (uint32_t)DirSyncBatchReader::RECORD_UP_TO_DATE);
+		else
+		{
+			EXPECT_EQ(record.type, (uint32_t)DirSyncBatchReader::RECORD_CONTENT);
+			ASSERT_EQ(record.dir_data.bin_len, contents[i].bin_len);
+			EXPECT_EQ(0, memcmp( record.dir_data.bin_data,
+			                     contents[i].bin_data, contents[i].bin_len ));
+		}
+	}
+	EXPECT_FALSE(reader.next(record));
+	EXPECT_TRUE(reader.atEnd());
+}
+
+TEST(libretroshare_file_sharing, DirSyncBatchIsSizeBounded)
+{
+	DirSyncBatchWriter writer(10000, 20000);
+
+	uint32_t n = 0;
+	while(!writer.full())
+	{
+		EXPECT_TRUE(writer.addContent(RsFileHash::random(), randomDirData(1000)));
+		++n;
+	}
+	EXPECT_EQ(n, 10u);
+
+	RsTlvBinaryData batch;
+	ASSERT_TRUE(writer.finish(batch));
+
+	// the receiver refuses batches larger than what it accepts
+	DirSyncBatchReader reader;
+	EXPECT_FALSE(reader.load(batch, 5000));
+	EXPECT_TRUE(reader.load(batch, 20000));
+}
+
+TEST(libretroshare_file_sharing, DirSyncBatchRejectsCorruptedData)
+{
+	DirSyncBatchWriter writer(1024*1024, 2*1024*1024);
+	EXPECT_TRUE(writer.addContent(RsFileHash::random(), randomDirData(3000)));
+
+	RsTlvBinaryData batch;
+	ASSERT_TRUE(writer.finish(batch));
+
+	((uint8_t*)batch.bin_data)[batch.bin_len / 2] ^= 0x5a;
+
+	DirSyncBatchReader reader;
+	EXPECT_FALSE(reader.load(batch, 1024*1024));
+
+	RsTlvBinaryData truncated;
+	truncated.setBinData(batch.bin_data, 3);
+	EXPECT_FALSE(reader.load(truncated, 1024*1024));
+}
+
+TEST(libretroshare_file_sharing, DirSyncBatchNeverExceedsMaxBatchSize)
+{
+	DirSyncBatchWriter writer(10000, 12000);
+
+	// too large for any batch
+	EXPECT_FALSE(writer.addContent(RsFileHash::random(), randomDirData(13000)));
+	EXPECT_TRUE(writer.empty());
+
+	EXPECT_TRUE(writer.addContent(RsFileHash::random(), randomDirData(9000)));
+
+	// fits the batch on its own, but not after what was already added
+	RsFileHash hash = RsFileHash::random();
+	EXPECT_FALSE(writer.addContent(hash, randomDirData(5000)));
+	EXPECT_EQ(writer.nbRecords(), 1u);
+	EXPECT_FALSE(writer.full());
+
+	EXPECT_TRUE(writer.addContent(hash, randomDirData(2000)));
+	EXPECT_TRUE(writer.full());
+
+	RsTlvBinaryData batch;
+	ASSERT_TRUE(writer.finish(batch));
+
+	DirSyncBatchReader reader;
+	ASSERT_TRUE(reader.load(batch, 12000));
+
+	DirSyncBatchReader::Record record;
+	ASSERT_TRUE(reader.next(record));
+	EXPECT_EQ(record.dir_data.bin_len, 9000u);
+	ASSERT_TRUE(reader.next(record));
+	EXPECT_EQ(record.dir_hash, hash);
+	EXPECT_EQ(record.dir_data.bin_len, 2000u);
+	EXPECT_FALSE(reader.next(record));
+}
+
+/* Builds a batch with the given announced size, around data that is not
+ * necessarily of that size. */
+static RsTlvBinaryData makeRawBatch(uint32_t announced_size, uint32_t real_size)
+{
+	std::vector<uint8_t> raw(real_size, 0);
+	uLongf compressed_size = compressBound(real_size);
+	std::vector<uint8_t> out(4 + compressed_size);
+
+	out[0] = (announced_size >> 24) & 0xff;
+	out[1] = (announced_size >> 16) & 0xff;
+	out[2] = (announced_size >>  8) & 0xff;
+	out[3] = (announced_size      ) & 0xff;
+
+	EXPECT_EQ(Z_OK, compress2( out.data() + 4, &compressed_size, raw.data(),
+	                           real_size, Z_BEST_COMPRESSION ));
+
+	RsTlvBinaryData data;
+	data.setBinData(out.data(), 4 + compressed_size);
+	return data;
+}
+
+TEST(libretroshare_file_sharing, DirSyncBatchRejectsLyingSize)
+{
+	DirSyncBatchReader reader;
+
+	// a few KB that inflate to 16 MB, announced as 1000 bytes
+	RsTlvBinaryData bomb = makeRawBatch(1000, 16*1024*1024);
+	EXPECT_LT(bomb.bin_len, 100000u);
+	EXPECT_FALSE(reader.load(bomb, 1024*1024));
+	EXPECT_TRUE(reader.atEnd());
+
+	// announced size is larger than the data
+	EXPECT_FALSE(reader.load(makeRawBatch(200000, 1000), 1024*1024));
+
+	// announced size is above the limit of the receiver
+	EXPECT_FALSE(reader.load(makeRawBatch(16*1024*1024, 16*1024*1024), 1024*1024));
+
+	// data that matches its announced size spanning several inflate chunks
+	EXPECT_TRUE(reader.load(makeRawBatch(200000, 200000), 1024*1024));
+	EXPECT_TRUE(reader.load(makeRawBatch(0, 0), 1024*1024));
+	EXPECT_TRUE(reader.atEnd());
+}
@@ -0,0 +1,214 @@
+/*******************************************************************************
+ * unittests/libretroshare/file_sharing/directory_scanner_test.cc              *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <map>
+#include <unistd.h>
+
+#include "file_sharing/directory_scanner.h"
+#include "util/folderiterator.h"
+#include "util/rsdir.h"
+
+typedef std::map<std::string, std::vector<std::string> > TreeContent;
+
+static void makeTree( const std::string& root, uint32_t depth, uint32_t nb_dirs,
+                      uint32_t nb_files )
+{
+	RsDirUtil::checkCreateDirectory(root);
+
+	for(uint32_t i=0; i<nb_files; ++i)
+		std::ofstream(root + "/file_" + std::to_string(i)) << i;
+
+	if(depth > 0)
+		for(uint32_t i=0; i<nb_dirs; ++i)
+			makeTree( root + "/dir_" + std::to_string(i), depth-1, nb_dirs,
+			          nb_files );
+}
+
+static void removeTree(const std::string& root)
+{
+	for(librs::util::FolderIterator it(root, false); it.isValid(); it.next())
+		if(it.file_type() == librs::util::FolderIterator::TYPE_DIR)
+			removeTree(it.file_fullpath());
+		else
+			remove(it.file_fullpath().c_str());
+
+	rmdir(root.c_str());
+}
+
+static void recordListing( const std::string& path, const DirListing& listing,
+                           TreeContent& content,
+                           std::vector<std::string>& subdirs )
+{
+	std::vector<std::string>& names(content[path]);
+	subdirs.clear();
+
+	for(const DirListing::Entry& e: listing.entries)
+	{
+		names.push_back(e.name);
+		if(e.type == librs::util::FolderIterator::TYPE_DIR)
+			subdirs.push_back(e.name);
+	}
+	std::sort(names.begin(), names.end());
+	std::sort(subdirs.begin(), subdirs.end());
+}
+
+static void sequentialWalk(const std::string& path, TreeContent& content)
+{
+	DirectoryScanner::Request r = { path, 0, true, 0 };
+	DirListing listing;
+	DirectoryScanner::scan(r, false, listing);
+
+	std::vector<std::string> subdirs;
+	recordListing(path, listing, content, subdirs);
+
+	for(const std::string& d: subdirs)
+		sequentialWalk(path + "/" + d, content);
+}
+
+static void parallelWalk( DirectoryScanner& scanner, const std::string& path,
+                          const DirectoryScanner::JobHandle& job,
+                          TreeContent& content, std::vector<std::string>& order )
+{
+	DirListing listing;
+	scanner.get(job, listing);
+	order.push_back(path);
+
+	std::vector<std::string> subdirs;
+	recordListing(path, listing, content, subdirs);
+
+	std::vector<DirectoryScanner::Request> requests;
+	for(const std::string& d: subdirs)
+		requests.push_back({ path + "/" + d, 0, true, listing.device });
+
+	std::vector<DirectoryScanner::JobHandle> jobs;
+	scanner.submit(requests, jobs);
+
+	for(uint32_t i=0; i<jobs.size(); ++i)
+		parallelWalk(scanner, requests[i].path, jobs[i], content, order);
+}
+
+static void parallelWalk( uint32_t nb_threads, const std::string& root,
+                          TreeContent& content, std::vector<std::string>& order )
+{
+	DirectoryScanner scanner(nb_threads, 4, false);
+
+	std::vector<DirectoryScanner::JobHandle> jobs;
+	scanner.submit({ { root, 0, true, 0 } }, jobs);
+
+	parallelWalk(scanner, root, jobs[0], content, order);
+}
+
+static std::string testRoot(const std::string& name)
+{
+	return "/tmp/rs_directory_scanner_" + name + "_" + std::to_string(getpid());
+}
+
+TEST(libretroshare_file_sharing, DirectoryScannerMatchesSequentialWalk)
+{
+	const std::string root = testRoot("match");
+	makeTree(root, 3, 4, 5);
+
+	TreeContent sequential;
+	sequentialWalk(root, sequential);
+	EXPECT_EQ(sequential.size(), 1u + 4u + 16u + 64u);
+
+	std::vector<std::string> reference_order;
+	for(uint32_t nb_threads: { 0u, 1u, 8u })
+	{
+		TreeContent parallel;
+		std::vector<std::string> order;
+		parallelWalk(nb_threads, root, parallel, order);
+
+		EXPECT_TRUE(parallel == sequential);
+
+		// the merge order is the depth-first order, whatever the thread count
+		if(reference_order.empty()) reference_order = order;
+		EXPECT_TRUE(order == reference_order);
+	}
+
+	removeTree(root);
+}
+
+TEST(libretroshare_file_sharing, DirectoryScannerSkipsUnchangedDirectories)
+{
+	const std::string root = testRoot("unchanged");
+	makeTree(root, 0, 0, 3);
+
+	DirListing listing;
+	DirectoryScanner::Request r = { root, 0, false, 0 };
+	DirectoryScanner::scan(r, false, listing);
+	ASSERT_TRUE(listing.listed);
+	EXPECT_EQ(listing.entries.size(), 3u);
+
+	r.local_mod_time = listing.dir_modtime;
+	DirListing again;
+	DirectoryScanner::scan(r, false, again);
+	EXPECT_FALSE(again.listed);
+	EXPECT_TRUE(again.entries.empty());
+
+	r.force = true;
+	DirectoryScanner::scan(r, false, again);
+	EXPECT_TRUE(again.listed);
+
+	// share roots are queued with the device they are on
+	EXPECT_NE(DirectoryScanner::device(root), 0u);
+	EXPECT_EQ(DirectoryScanner::device(root), again.device);
+	EXPECT_EQ(DirectoryScanner::device(root + "/missing"), 0u);
+
+	removeTree(root);
+}
+
+/* Sweep of a synthetic hierarchy of about 1M files in 50k directories. Too
+ * large to run by default, use --gtest_also_run_disabled_tests, possibly with
+ * RS_SCANNER_BENCH_ROOT pointing to a network mount. */
+TEST(libretroshare_file_sharing, DISABLED_DirectoryScannerBenchmark)
+{
+	const char *env_root = getenv("RS_SCANNER_BENCH_ROOT");
+	const std::string root = env_root ? env_root : testRoot("bench");
+
+	// 1 + 36 + 36^2 + 36^3 = 47989 directories, 21 files each
+	if(!RsDirUtil::checkDirectory(root + "/dir_0"))
+		makeTree(root, 3, 36, 21);
+
+	for(uint32_t nb_threads: { 0u, 2u, 8u, 16u })
+	{
+		TreeContent content;
+		std::vector<std::string> order;
+
+		auto start = std::chrono::steady_clock::now();
+		parallelWalk(nb_threads, root, content, order);
+		auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+		            std::chrono::steady_clock::now() - start ).count();
+
+		size_t nb_entries = 0;
+		for(auto& it: content) nb_entries += it.second.size();
+
+		std::cerr << "threads: " << nb_threads << " dirs: " << content.size()
+		          << " entries: " << nb_entries << " time: " << elapsed
+		          << " ms" << std::endl;
+	}
+}
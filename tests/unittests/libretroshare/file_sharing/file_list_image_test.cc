@@ -0,0 +1,290 @@
+/*******************************************************************************
+ * unittests/libretroshare/file_sharing/file_list_image_test.cc                *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <stdlib.h>
+
+#include "file_sharing/dir_hierarchy.h"
+#include "file_sharing/file_list_image.h"
+#include "file_sharing/filelist_io.h"
+
+// Builds a hierarchy with nb_dirs directories below the root, each holding
+// nb_files files, encoded in the TLV format used before FileListImage.
+static bool writeLegacyHierarchy(uint32_t nb_dirs, uint32_t nb_files, unsigned char *& buffer, uint32_t& size)
+{
+	unsigned char *section = NULL;
+	uint32_t section_size = 0;
+	uint32_t offset = 0;
+	const uint32_t nb_nodes = 1 + nb_dirs + nb_dirs*nb_files;
+
+	buffer = NULL;
+	size = 0;
+
+	bool ok = FileListIO::writeField(buffer, size, offset, FILE_LIST_IO_TAG_LOCAL_DIRECTORY_VERSION, (uint32_t)FILE_LIST_IO_LOCAL_DIRECTORY_STORAGE_VERSION_0001)
+	        && FileListIO::writeField(buffer, size, offset, FILE_LIST_IO_TAG_RAW_NUMBER, nb_nodes);
+
+	for(uint32_t i=0; ok && i<1+nb_dirs; ++i)
+	{
+		uint32_t s = 0;
+		std::vector<uint32_t> subdirs, subfiles;
+
+		if(i == 0)
+			for(uint32_t j=0; j<nb_dirs; ++j) subdirs.push_back(1+j);
+		else
+			for(uint32_t j=0; j<nb_files; ++j) subfiles.push_back(1 + nb_dirs + (i-1)*nb_files + j);
+
+		ok = ok && FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_PARENT_INDEX, (uint32_t)0)
+		        && FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_ROW, (uint32_t)(i == 0 ? 0 : i-1))
+		        && FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_ENTRY_INDEX, i)
+		        && FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_FILE_NAME, i == 0 ? std::string() : "directory_" + std::to_string(i))
+		        && FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_DIR_HASH, i == 0 ? RsFileHash() : RsFileHash::random())
+		        && FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_FILE_SIZE, std::string("/home/user/share"))
+		        && FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_MODIF_TS, (uint32_t)1000+i)
+		        && FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_UPDATE_TS, (uint32_t)2000+i)
+		        && FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_RECURS_MODIF_TS, (uint32_t)3000+i)
+		        && FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_RAW_NUMBER, (uint32_t)subdirs.size());
+
+		for(uint32_t j=0; ok && j<subdirs.size(); ++j)
+			ok = FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_RAW_NUMBER, subdirs[j]);
+
+		ok = ok && FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_RAW_NUMBER, (uint32_t)subfiles.size());
+
+		for(uint32_t j=0; ok && j<subfiles.size(); ++j)
+			ok = FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_RAW_NUMBER, subfiles[j]);
+
+		ok = ok && FileListIO::writeField(buffer, size, offset, FILE_LIST_IO_TAG_LOCAL_DIR_ENTRY, section, s);
+	}
+
+	for(uint32_t i=1+nb_dirs; ok && i<nb_nodes; ++i)
+	{
+		uint32_t s = 0;
+		uint32_t parent = 1 + (i-1-nb_dirs) / nb_files;
+
+		ok = FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_PARENT_INDEX, parent)
+		        && FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_ROW, (uint32_t)((i-1-nb_dirs) % nb_files))
+		        && FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_ENTRY_INDEX, i)
+		        && FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_FILE_NAME, "some file name " + std::to_string(i) + ".mkv")
+		        && FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_FILE_SIZE, (uint64_t)i*1234567)
+		        && FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_FILE_SHA1_HASH, RsFileHash::random())
+		        && FileListIO::writeField(section, section_size, s, FILE_LIST_IO_TAG_MODIF_TS, (uint32_t)4000+i)
+		        && FileListIO::writeField(buffer, size, offset, FILE_LIST_IO_TAG_LOCAL_FILE_ENTRY, section, s);
+	}
+
+	free(section);
+	size = offset;
+	return ok;
+}
+
+static void expectSameHierarchy(const InternalFileHierarchyStorage& a, const InternalFileHierarchyStorage& b)
+{
+	ASSERT_EQ(a.mNodes.size(), b.mNodes.size());
+
+	for(uint32_t i=0; i<a.mNodes.size(); ++i)
+	{
+		ASSERT_EQ(a.getType(i), b.getType(i));
+
+		if(const InternalFileHierarchyStorage::FileEntry *fa = a.getFileEntry(i))
+		{
+			const InternalFileHierarchyStorage::FileEntry *fb = b.getFileEntry(i);
+			EXPECT_EQ(fa->file_name, fb->file_name);
+			EXPECT_EQ(fa->file_size, fb->file_size);
+			EXPECT_EQ(fa->file_hash, fb->file_hash);
+			EXPECT_EQ(fa->file_modtime, fb->file_modtime);
+			EXPECT_EQ(fa->parent_index, fb->parent_index);
+			EXPECT_EQ(fa->row, fb->row);
+		}
+		else if(const InternalFileHierarchyStorage::DirEntry *da = a.getDirEntry(i))
+		{
+			const InternalFileHierarchyStorage::DirEntry *db = b.getDirEntry(i);
+			EXPECT_EQ(da->dir_name, db->dir_name);
+			EXPECT_EQ(da->dir_parent_path, db->dir_parent_path);
+			EXPECT_EQ(da->dir_hash, db->dir_hash);
+			EXPECT_EQ(da->dir_modtime, db->dir_modtime);
+			EXPECT_EQ(da->dir_update_time, db->dir_update_time);
+			EXPECT_EQ(da->dir_most_recent_time, db->dir_most_recent_time);
+			EXPECT_EQ(da->subdirs, db->subdirs);
+			EXPECT_EQ(da->subfiles, db->subfiles);
+			EXPECT_EQ(da->parent_index, db->parent_index);
+			EXPECT_EQ(da->row, db->row);
+		}
+	}
+}
+
+TEST(libretroshare_file_sharing, FileListImageRoundTrip)
+{
+	FileListImageWriter writer;
+	RsFileHash dir_hash = RsFileHash::random();
+	RsFileHash file_hash = RsFileHash::random();
+
+	writer.addDir(0, 0, 0, "", "", RsFileHash(), 1, 2, 3, {2}, {});
+	writer.addDir(2, 0, 0, "music", "/home/user", dir_hash, 4, 5, 6, {}, {3});
+	writer.addFile(3, 2, 0, "song.ogg", 123456789012ull, file_hash, 7);
+
+	unsigned char *data = NULL;
+	uint32_t size = 0;
+	ASSERT_TRUE(writer.finish(5, data, size));
+	EXPECT_TRUE(FileListImage::isImage(data, size));
+
+	FileListImage image;
+	ASSERT_TRUE(image.load(data, size));
+	ASSERT_EQ(image.nbNodes(), 5u);
+
+	EXPECT_EQ(image.node(1)->type, (uint8_t)FileListImage::NODE_EMPTY);
+	EXPECT_EQ(image.node(4)->type, (uint8_t)FileListImage::NODE_EMPTY);
+	EXPECT_TRUE(image.node(5) == NULL);
+
+	const FileListImage::NodeRecord& dir(*image.node(2));
+	std::string name, path;
+	const uint32_t *subdirs, *subfiles;
+
+	EXPECT_EQ(dir.type, (uint8_t)FileListImage::NODE_DIR);
+	EXPECT_TRUE(image.getName(dir, name));
+	EXPECT_TRUE(image.getParentPath(dir, path));
+	EXPECT_EQ(name, "music");
+	EXPECT_EQ(path, "/home/user");
+	EXPECT_EQ(FileListImage::hash(dir), dir_hash);
+	EXPECT_EQ(dir.update_time, 5u);
+	ASSERT_TRUE(image.getChildren(dir, subdirs, subfiles));
+	EXPECT_EQ(dir.nb_subdirs, 0u);
+	ASSERT_EQ(dir.nb_subfiles, 1u);
+	EXPECT_EQ(subfiles[0], 3u);
+
+	const FileListImage::NodeRecord& file(*image.node(3));
+	EXPECT_EQ(file.type, (uint8_t)FileListImage::NODE_FILE);
+	EXPECT_TRUE(image.getName(file, name));
+	EXPECT_EQ(name, "song.ogg");
+	EXPECT_EQ(file.file_size, 123456789012ull);
+	EXPECT_EQ(FileListImage::hash(file), file_hash);
+	EXPECT_EQ(file.parent_index, 2u);
+
+	// truncated or corrupted images are rejected
+
+	EXPECT_FALSE(image.load(data, size-1));
+	data[size-4] ^= 0xff;
+	EXPECT_FALSE(image.load(data, size));
+	EXPECT_FALSE(FileListImage::isImage(data, 8));
+
+	free(data);
+}
+
+TEST(libretroshare_file_sharing, FileListImageRejectsBadIndexes)
+{
+	for(int test=0; test<3; ++test)
+	{
+		FileListImageWriter writer;
+
+		writer.addDir(0, 0, 0, "", "", RsFileHash(), 1, 2, 3, {1}, {});
+
+		if(test == 0)		// sub-directory index out of range
+			writer.addDir(1, 0, 0, "music", "/home/user", RsFileHash(), 4, 5, 6, {7}, {2});
+		else if(test == 1)	// sub-file index out of range
+			writer.addDir(1, 0, 0, "music", "/home/user", RsFileHash(), 4, 5, 6, {}, {2, 3});
+		else				// parent index out of range
+			writer.addDir(1, 3, 0, "music", "/home/user", RsFileHash(), 4, 5, 6, {}, {2});
+
+		writer.addFile(2, 1, 0, "song.ogg", 1234, RsFileHash::random(), 7);
+
+		unsigned char *data = NULL;
+		uint32_t size = 0;
+		ASSERT_TRUE(writer.finish(3, data, size));
+
+		FileListImage image;
+		EXPECT_FALSE(image.load(data, size)) << "test " << test;
+		EXPECT_EQ(image.nbNodes(), 0u);
+
+		InternalFileHierarchyStorage storage;
+		EXPECT_FALSE(storage.load(data, size)) << "test " << test;
+
+		free(data);
+	}
+}
+
+TEST(libretroshare_file_sharing, FileHierarchyUpgradesLegacyFormat)
+{
+	unsigned char *legacy = NULL;
+	uint32_t legacy_size = 0;
+	ASSERT_TRUE(writeLegacyHierarchy(10, 20, legacy, legacy_size));
+
+	InternalFileHierarchyStorage from_legacy;
+	ASSERT_TRUE(from_legacy.load(legacy, legacy_size));
+	EXPECT_TRUE(from_legacy.loadedLegacyFormat());
+	free(legacy);
+
+	SharedDirStats stats;
+	from_legacy.getStatistics(stats);
+	EXPECT_EQ(stats.total_number_of_files, 200u);
+
+	unsigned char *image = NULL;
+	uint32_t image_size = 0;
+	ASSERT_TRUE(from_legacy.save(image, image_size));
+	EXPECT_TRUE(FileListImage::isImage(image, image_size));
+
+	InternalFileHierarchyStorage from_image;
+	ASSERT_TRUE(from_image.load(image, image_size));
+	EXPECT_FALSE(from_image.loadedLegacyFormat());
+	free(image);
+
+	expectSameHierarchy(from_legacy, from_image);
+
+	RsFileHash hash = from_legacy.getFileEntry(42)->file_hash;
+	DirectoryStorage::EntryIndex index;
+	EXPECT_TRUE(from_image.getIndexFromFileHash(hash, index));
+	EXPECT_EQ(index, 42u);
+}
+
+// Compares load times of both formats. Run with --gtest_also_run_disabled_tests
+TEST(libretroshare_file_sharing, DISABLED_FileListLoadBenchmark)
+{
+	const char *env_dirs = getenv("RS_FILE_LIST_BENCH_DIRS");
+	const uint32_t nb_dirs = env_dirs ? atoi(env_dirs) : 2000;
+	const uint32_t nb_files = 100;
+
+	unsigned char *legacy = NULL;
+	uint32_t legacy_size = 0;
+	ASSERT_TRUE(writeLegacyHierarchy(nb_dirs, nb_files, legacy, legacy_size));
+
+	unsigned char *image = NULL;
+	uint32_t image_size = 0;
+	{
+		InternalFileHierarchyStorage storage;
+		ASSERT_TRUE(storage.load(legacy, legacy_size));
+		ASSERT_TRUE(storage.save(image, image_size));
+	}
+
+	for(int format=0; format<2; ++format)
+	{
+		InternalFileHierarchyStorage storage;
+
+		auto start = std::chrono::steady_clock::now();
+		EXPECT_TRUE(format == 0 ? storage.load(legacy, legacy_size) : storage.load(image, image_size));
+		auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+		            std::chrono::steady_clock::now() - start ).count();
+
+		std::cerr << (format == 0 ? "legacy" : "image ") << " format: "
+		          << (format == 0 ? legacy_size : image_size) << " bytes, "
+		          << storage.mNodes.size() << " entries, load time: "
+		          << elapsed << " ms" << std::endl;
+	}
+
+	free(legacy);
+	free(image);
+}
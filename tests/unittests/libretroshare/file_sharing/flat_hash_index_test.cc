@@ -0,0 +1,144 @@
+/*******************************************************************************
+ * unittests/libretroshare/file_sharing/flat_hash_index_test.cc                *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <map>
+
+#include "file_sharing/flat_hash_index.h"
+#include "util/rsrandom.h"
+
+static void checkSame( const FlatHashIndex& index,
+                       const std::map<RsFileHash,DirectoryStorage::EntryIndex>& ref )
+{
+	EXPECT_EQ(index.size(), ref.size());
+
+	std::vector<std::pair<RsFileHash,DirectoryStorage::EntryIndex> > content;
+	index.forEach([&](const RsFileHash& h, DirectoryStorage::EntryIndex e)
+	{ content.push_back(std::make_pair(h,e)); });
+
+	ASSERT_EQ(content.size(), ref.size());
+
+	auto it = ref.begin();
+	for(uint32_t i=0; i<content.size(); ++i, ++it)
+	{
+		EXPECT_EQ(content[i].first, it->first);
+		EXPECT_EQ(content[i].second, it->second);
+	}
+}
+
+TEST(libretroshare_file_sharing, FlatHashIndexMatchesMap)
+{
+	FlatHashIndex index;
+	std::map<RsFileHash,DirectoryStorage::EntryIndex> ref;
+	std::vector<RsFileHash> hashes;
+
+	for(uint32_t i=0; i<5000; ++i)
+		hashes.push_back(RsFileHash::random());
+
+	// enough operations to go through several merges of the delta
+	for(uint32_t i=0; i<50000; ++i)
+	{
+		const RsFileHash& h(hashes[RSRandom::random_u32() % hashes.size()]);
+
+		if(RSRandom::random_u32() % 4 == 0)
+		{
+			index.erase(h);
+			ref.erase(h);
+		}
+		else
+		{
+			DirectoryStorage::EntryIndex e = RSRandom::random_u32() % 100000;
+			index.set(h,e);
+			ref[h] = e;
+		}
+	}
+
+	for(auto& h: hashes)
+	{
+		DirectoryStorage::EntryIndex e = DirectoryStorage::NO_INDEX;
+		auto it = ref.find(h);
+
+		EXPECT_EQ(index.find(h,e), it != ref.end());
+		if(it != ref.end()) EXPECT_EQ(e, it->second);
+	}
+	checkSame(index, ref);
+
+	index.clear();
+	ref.clear();
+	checkSame(index, ref);
+}
+
+TEST(libretroshare_file_sharing, FlatHashIndexEraseAndReinsert)
+{
+	FlatHashIndex index;
+	std::map<RsFileHash,DirectoryStorage::EntryIndex> ref;
+
+	// fill until entries get merged into the sorted part
+	for(uint32_t i=0; i<1000; ++i)
+	{
+		RsFileHash h = RsFileHash::random();
+		index.set(h,i);
+		ref[h] = i;
+	}
+
+	RsFileHash h = ref.begin()->first;
+	DirectoryStorage::EntryIndex e = 0;
+
+	index.erase(h);
+	index.erase(h);
+	EXPECT_FALSE(index.find(h,e));
+	EXPECT_EQ(index.size(), 999u);
+
+	index.set(h,12345);
+	EXPECT_TRUE(index.find(h,e));
+	EXPECT_EQ(e, 12345u);
+	EXPECT_EQ(index.size(), 1000u);
+
+	ref[h] = 12345;
+	checkSame(index, ref);
+}
+
+TEST(libretroshare_file_sharing, FlatHashIndexAssign)
+{
+	FlatHashIndex index;
+	std::map<RsFileHash,DirectoryStorage::EntryIndex> ref;
+	std::vector<std::pair<RsFileHash,DirectoryStorage::EntryIndex> > entries;
+
+	index.set(RsFileHash::random(), 1);
+
+	for(uint32_t i=0; i<1000; ++i)
+	{
+		// some hashes appear twice. The last entry must win.
+		RsFileHash h = (i % 10 == 9) ? entries[i-5].first : RsFileHash::random();
+		entries.push_back(std::make_pair(h,i));
+		ref[h] = i;
+	}
+
+	index.assign(entries);
+	EXPECT_EQ(index.size(), ref.size());
+	checkSame(index, ref);
+
+	// the index keeps working after a bulk assignment
+	RsFileHash h = RsFileHash::random();
+	index.set(h, 5000);
+	ref[h] = 5000;
+	checkSame(index, ref);
+}
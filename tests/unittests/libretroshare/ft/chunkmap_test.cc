@@ -0,0 +1,216 @@
+/*******************************************************************************
+ * unittests/libretroshare/ft/chunkmap_test.cc                                 *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <deque>
+
+#include "ft/ftchunkmap.h"
+
+static const uint32_t CS = ChunkMap::CHUNKMAP_FIXED_CHUNK_SIZE;
+
+static CompressedChunkMap makeMap(uint32_t nb_chunks, const std::vector<uint32_t>& chunks)
+{
+	CompressedChunkMap cmap(nb_chunks, 0);
+	for(uint32_t c: chunks) cmap.set(c);
+	return cmap;
+}
+
+TEST(libretroshare_ft, ChunkMapRarestFirst)
+{
+	RsPeerId A = RsPeerId::random();
+	RsPeerId B = RsPeerId::random();
+
+	ChunkMap map(10*(uint64_t)CS, false);
+	map.setStrategy(FileChunksInfo::CHUNK_STRATEGY_RAREST_FIRST);
+
+	// chunk 3 is only on A, chunk 9 only on B. All others are on both.
+	map.setPeerAvailabilityMap(A, makeMap(10, {0,1,2,3,4,5,6,7,8}));
+	map.setPeerAvailabilityMap(B, makeMap(10, {0,1,2,4,5,6,7,8,9}));
+
+	ftChunk chunk;
+	bool map_needed;
+
+	ASSERT_TRUE(map.getDataChunk(A, CS, chunk, map_needed));
+	EXPECT_EQ(chunk.offset, 3*(uint64_t)CS);
+	EXPECT_EQ(chunk.size, CS);
+
+	ASSERT_TRUE(map.getDataChunk(B, CS, chunk, map_needed));
+	EXPECT_EQ(chunk.offset, 9*(uint64_t)CS);
+
+	// B comes back with fewer chunks, and A now has the full file. Chunks 4 to 8
+	// are only on A, so they are the rarest.
+
+	map.removeFileSource(B);
+	map.setPeerAvailabilityMap(B, makeMap(10, {0,1,2}));
+	map.setPeerAvailabilityMap(A, makeMap(10, {0,1,2,3,4,5,6,7,8,9}));
+
+	ASSERT_TRUE(map.getDataChunk(A, CS, chunk, map_needed));
+	EXPECT_GE(chunk.offset, 4*(uint64_t)CS);
+	EXPECT_LT(chunk.offset, 9*(uint64_t)CS);
+}
+
+TEST(libretroshare_ft, ChunkMapTracksOutstandingChunks)
+{
+	RsPeerId A = RsPeerId::random();
+
+	ChunkMap map(5*(uint64_t)CS + 1000, true);
+	map.setStrategy(FileChunksInfo::CHUNK_STRATEGY_RANDOM);
+
+	ftChunk chunk;
+	bool map_needed;
+	std::set<uint64_t> offsets;
+
+	for(uint32_t i=0; i<6; ++i)
+	{
+		ASSERT_TRUE(map.getDataChunk(A, CS, chunk, map_needed));
+		EXPECT_TRUE(offsets.insert(chunk.offset).second);
+		EXPECT_EQ(chunk.size, chunk.offset == 5*(uint64_t)CS ? 1000u : CS);
+		map.dataReceived(chunk.id);
+	}
+
+	// all chunks are being checked. Nothing left to download.
+
+	EXPECT_FALSE(map.getDataChunk(A, CS, chunk, map_needed));
+	uint64_t offset;
+	uint32_t size;
+	EXPECT_FALSE(map.reAskPendingChunk(A, CS, offset, size));
+
+	std::vector<uint32_t> to_check;
+	map.getChunksToCheck(to_check);
+	ASSERT_EQ(to_check.size(), 6u);
+
+	// a failed check puts the chunk back into the list of chunks to download.
+
+	for(uint32_t c: to_check) map.setChunkCheckingResult(c, c != 2);
+
+	EXPECT_FALSE(map.isComplete());
+	ASSERT_TRUE(map.getDataChunk(A, CS, chunk, map_needed));
+	EXPECT_EQ(chunk.offset, 2*(uint64_t)CS);
+	map.dataReceived(chunk.id);
+
+	map.getChunksToCheck(to_check);
+	for(uint32_t c: to_check) map.setChunkCheckingResult(c, true);
+	EXPECT_TRUE(map.isComplete());
+}
+
+TEST(libretroshare_ft, ChunkMapBoundsEndgameDuplicates)
+{
+	ChunkMap map(3*(uint64_t)CS, true);
+	map.setStrategy(FileChunksInfo::CHUNK_STRATEGY_STREAMING);
+	map.setSliceReAskDelay(0);
+
+	std::vector<RsPeerId> peers;
+	for(uint32_t i=0; i<6; ++i) peers.push_back(RsPeerId::random());
+
+	ftChunk chunk;
+	bool map_needed;
+
+	for(uint32_t i=0; i<3; ++i)
+		ASSERT_TRUE(map.getDataChunk(peers[i], CS, chunk, map_needed));
+	EXPECT_FALSE(map.getDataChunk(peers[3], CS, chunk, map_needed));
+
+	// every pending slice is 1 MB, so two duplicates fill the endgame budget.
+
+	uint64_t offset, offset2;
+	uint32_t size;
+	ASSERT_TRUE(map.reAskPendingChunk(peers[3], CS, offset, size));
+	EXPECT_EQ(size, CS);
+	ASSERT_TRUE(map.reAskPendingChunk(peers[4], CS, offset2, size));
+	EXPECT_NE(offset, offset2);
+	EXPECT_FALSE(map.reAskPendingChunk(peers[5], CS, offset, size));
+
+	// once a duplicated slice arrives, its copies do not count anymore.
+	map.dataReceived(offset2);
+	EXPECT_TRUE(map.reAskPendingChunk(peers[5], CS, offset, size));
+}
+
+// Simulates a download from sources with different rates and partial maps,
+// and counts the ticks needed to complete the file with each strategy. A slow
+// seed is the only source for some of the chunks.
+// Run with --gtest_also_run_disabled_tests
+TEST(libretroshare_ft, DISABLED_ChunkMapStrategySimulation)
+{
+	const uint32_t nb_chunks = 400;
+	const uint32_t nb_partial_sources = 4;
+	const uint32_t nb_runs = 10;
+
+	const FileChunksInfo::ChunkStrategy strategies[] = {
+	    FileChunksInfo::CHUNK_STRATEGY_STREAMING, FileChunksInfo::CHUNK_STRATEGY_RANDOM,
+	    FileChunksInfo::CHUNK_STRATEGY_PROGRESSIVE, FileChunksInfo::CHUNK_STRATEGY_RAREST_FIRST };
+
+	for(FileChunksInfo::ChunkStrategy strategy: strategies)
+	{
+		uint64_t total_ticks = 0;
+
+		for(uint32_t run=0; run<nb_runs; ++run)
+		{
+			srand(run);
+
+			struct Source { RsPeerId id; uint32_t rate; std::deque<ftChunk> pending; };
+			std::vector<Source> sources;
+			ChunkMap map(nb_chunks*(uint64_t)CS, false);
+			map.setStrategy(strategy);
+
+			// the seed has everything but is slow. Partial sources each have ~30% of the chunks.
+
+			sources.push_back(Source{RsPeerId::random(), CS/8, {}});
+			map.setPeerAvailabilityMap(sources.back().id, CompressedChunkMap(nb_chunks, ~uint32_t(0)));
+
+			for(uint32_t i=0; i<nb_partial_sources; ++i)
+			{
+				std::vector<uint32_t> chunks;
+				for(uint32_t c=0; c<nb_chunks; ++c)
+					if(rand() % 10 < 3) chunks.push_back(c);
+
+				sources.push_back(Source{RsPeerId::random(), (1+i)*CS/4, {}});
+				map.setPeerAvailabilityMap(sources.back().id, makeMap(nb_chunks, chunks));
+			}
+
+			uint32_t ticks = 0;
+
+			for(; !map.isComplete() && ticks < 1000000; ++ticks)
+			{
+				for(Source& s: sources)
+				{
+					ftChunk chunk;
+					bool map_needed;
+
+					while(s.pending.size() < 2 && map.getDataChunk(s.id, s.rate, chunk, map_needed))
+						s.pending.push_back(chunk);
+
+					if(!s.pending.empty())
+					{
+						map.dataReceived(s.pending.front().id);
+						s.pending.pop_front();
+					}
+				}
+
+				std::vector<uint32_t> to_check;
+				map.getChunksToCheck(to_check);
+				for(uint32_t c: to_check) map.setChunkCheckingResult(c, true);
+			}
+			total_ticks += ticks;
+		}
+
+		std::cerr << "strategy " << (int)strategy << ": average completion time "
+		          << total_ticks / nb_runs << " ticks" << std::endl;
+	}
+}
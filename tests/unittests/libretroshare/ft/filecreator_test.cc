@@ -0,0 +1,224 @@
+/*******************************************************************************
+ * unittests/libretroshare/ft/filecreator_test.cc                              *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <openssl/sha.h>
+
+#include "ft/ftfilecreator.h"
+#include "util/rsrandom.h"
+
+static const uint32_t CS = ChunkMap::CHUNKMAP_FIXED_CHUNK_SIZE;
+
+static Sha1CheckSum sha1(const unsigned char *data, size_t len)
+{
+	unsigned char buf[SHA_DIGEST_LENGTH];
+	SHA1(data, len, buf);
+	return Sha1CheckSum(buf);
+}
+
+// Receives the whole file, in the given slice order, and lets the chunk checking pass.
+// When interleaved, packets of all slices are received in turn, as with several sources.
+static void receiveFile(ftFileCreator& fc, const std::vector<unsigned char>& data, bool reverse, bool interleaved = false)
+{
+	RsPeerId peer = RsPeerId::random();
+	std::vector<std::pair<uint64_t,uint32_t> > slices;
+	uint64_t offset;
+	uint32_t size;
+	bool map_needed;
+
+	while(fc.getMissingChunk(peer, 256*1024, offset, size, map_needed))
+		slices.push_back(std::make_pair(offset, size));
+
+	if(reverse)
+		std::reverse(slices.begin(), slices.end());
+
+	// Data comes in 8KB packets, as sent by ftServer.
+	std::vector<std::pair<uint64_t,uint32_t> > packets;
+	for(auto& s: slices)
+		for(uint32_t done=0; done<s.second; done += 8192)
+			packets.push_back(std::make_pair(s.first + done, std::min(8192u, s.second - done)));
+
+	if(interleaved)
+	{
+		std::vector<std::pair<uint64_t,uint32_t> > p;
+		for(uint32_t round=0; p.size() < packets.size(); ++round)
+			for(auto& s: slices)
+				for(auto& q: packets)
+					if(q.first == s.first + round*8192ull && q.first < s.first + s.second)
+						p.push_back(q);
+		packets.swap(p);
+	}
+
+	for(auto& p: packets)
+	{
+		void *buf = malloc(p.second);
+		memcpy(buf, data.data() + p.first, p.second);
+		ASSERT_TRUE(fc.addFileData(p.first, p.second, buf));
+		free(buf);
+	}
+
+	for(uint32_t i=0; i*(uint64_t)CS < data.size(); ++i)
+	{
+		size_t len = std::min((size_t)CS, data.size() - i*(size_t)CS);
+		fc.verifyChunk(i, sha1(data.data() + i*(size_t)CS, len));
+	}
+}
+
+class FileCreatorTest: public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		path = testing::TempDir() + "ftfilecreator_test.bin";
+		remove(path.c_str());
+
+		data.resize(3*CS + 12345);
+		RsRandom::random_bytes(data.data(), data.size());
+		hash = sha1(data.data(), data.size());
+	}
+	void TearDown() override { remove(path.c_str()); }
+
+	std::string path;
+	std::vector<unsigned char> data;
+	RsFileHash hash;
+};
+
+TEST_F(FileCreatorTest, HashesInOrderDataOnTheFly)
+{
+	ftFileCreator fc(path, data.size(), hash, true);
+	fc.setChunkStrategy(FileChunksInfo::CHUNK_STRATEGY_STREAMING);
+	receiveFile(fc, data, false);
+
+	ASSERT_TRUE(fc.finished());
+
+	// Everything was hashed while being written, so the file is not read again:
+	// what is on disk doesn't matter anymore.
+	FILE *f = fopen(path.c_str(), "r+b");
+	ASSERT_TRUE(f != NULL);
+	std::vector<unsigned char> zeros(data.size(), 0);
+	fwrite(zeros.data(), 1, zeros.size(), f);
+	fclose(f);
+
+	RsFileHash check;
+	ASSERT_TRUE(fc.hashReceivedData(check));
+	EXPECT_EQ(check, hash);
+}
+
+TEST_F(FileCreatorTest, HashesOutOfOrderData)
+{
+	ftFileCreator fc(path, data.size(), hash, true);
+	receiveFile(fc, data, true);
+
+	ASSERT_TRUE(fc.finished());
+
+	RsFileHash check;
+	ASSERT_TRUE(fc.hashReceivedData(check));
+	EXPECT_EQ(check, hash);
+}
+
+TEST_F(FileCreatorTest, ForceCheckRehashesFromDisk)
+{
+	ftFileCreator fc(path, data.size(), hash, true);
+	receiveFile(fc, data, false);
+
+	// The hash computed on the fly must not be trusted after a forced check.
+	fc.forceCheck();
+
+	for(uint32_t i=0; i*(uint64_t)CS < data.size(); ++i)
+	{
+		size_t len = std::min((size_t)CS, data.size() - i*(size_t)CS);
+		fc.verifyChunk(i, sha1(data.data() + i*(size_t)CS, len));
+	}
+	ASSERT_TRUE(fc.finished());
+
+	RsFileHash check;
+	ASSERT_TRUE(fc.hashReceivedData(check));
+	EXPECT_EQ(check, hash);
+}
+
+TEST_F(FileCreatorTest, PreallocatedDirectIOStorage)
+{
+	ftFileCreator fc(path, data.size(), hash, true);
+	fc.setStoragePolicy(RS_FILE_PARTIALS_STORAGE_PREALLOCATE | RS_FILE_PARTIALS_STORAGE_DIRECT_IO);
+	receiveFile(fc, data, true);
+
+	ASSERT_TRUE(fc.finished());
+	fc.closeFile();
+
+	std::vector<unsigned char> content(data.size() + 1);
+	FILE *f = fopen(path.c_str(), "rb");
+	ASSERT_TRUE(f != NULL);
+	EXPECT_EQ(fread(content.data(), 1, content.size(), f), data.size());
+	fclose(f);
+	content.resize(data.size());
+	EXPECT_TRUE(content == data);
+
+	RsFileHash check;
+	ASSERT_TRUE(fc.hashReceivedData(check));
+	EXPECT_EQ(check, hash);
+}
+
+TEST_F(FileCreatorTest, DirectIOGathersInterleavedPackets)
+{
+	ftFileCreator fc(path, data.size(), hash, true);
+	fc.setStoragePolicy(RS_FILE_PARTIALS_STORAGE_DIRECT_IO);
+	receiveFile(fc, data, false, true);
+
+	ASSERT_TRUE(fc.finished());
+
+	RsFileHash check;
+	ASSERT_TRUE(fc.hashReceivedData(check));
+	EXPECT_EQ(check, hash);
+}
+
+TEST_F(FileCreatorTest, DirectIOWritesGatheredDataOnClose)
+{
+	ftFileCreator fc(path, data.size(), hash, true);
+	fc.setStoragePolicy(RS_FILE_PARTIALS_STORAGE_DIRECT_IO);
+
+	RsPeerId peer = RsPeerId::random();
+	uint64_t offset;
+	uint32_t size;
+	bool map_needed;
+	ASSERT_TRUE(fc.getMissingChunk(peer, 256*1024, offset, size, map_needed));
+
+	// half of the slice is received, and the transfer is then paused.
+	for(uint32_t done=0; done<size/2; done += 8192)
+		ASSERT_TRUE(fc.addFileData(offset + done, 8192, data.data() + offset + done));
+
+	fc.closeFile();
+
+	std::vector<unsigned char> content(size/2);
+	FILE *f = fopen(path.c_str(), "rb");
+	ASSERT_TRUE(f != NULL);
+	ASSERT_EQ(0, fseek(f, offset, SEEK_SET));
+	EXPECT_EQ(fread(content.data(), 1, content.size(), f), content.size());
+	fclose(f);
+	EXPECT_EQ(0, memcmp(content.data(), data.data() + offset, content.size()));
+
+	// the rest of the slice completes it, as if nothing happened.
+	for(uint32_t done=size/2; done<size; done += 8192)
+		ASSERT_TRUE(fc.addFileData(offset + done, 8192, data.data() + offset + done));
+
+	EXPECT_EQ(fc.getRecvd(), (uint64_t)size);
+}
@@ -27,6 +27,7 @@
 #include "gxs/rsgds.h"
 #include "gxs/rsgxsutil.h"
 #include "gxs/rsdataservice.h"
+#include "util/retrodb.h"
 
 #define DATA_BASE_NAME "msg_grp_Store"
 
@@ -45,6 +46,22 @@ TEST(libretroshare_gxs, RsDataService)
     test_messageStoresAndRetrieve();
 }
 
+TEST(libretroshare_gxs, RsDataServicePagedMsgMeta)
+{
+    test_messageMetaPagedRetrieval();
+}
+
+TEST(libretroshare_gxs, RsDataServiceMaintenance)
+{
+    test_storageMaintenance();
+    test_storageConversion();
+}
+
+TEST(libretroshare_gxs, RsDataServiceMsgReferences)
+{
+    test_messageReferences();
+}
+
 
 
 /*!
@@ -316,6 +333,258 @@ void test_messageStoresAndRetrieve()
 
 
 
+/*!
+ * Checks that paged meta retrieval returns every matching message exactly
+ * once, and that filter predicates are honoured
+ */
+void test_messageMetaPagedRetrieval()
+{
+    setUp();
+
+    RsGxsGroupId grpId = RsGxsGroupId::random();
+    RsGxsMessageId threadId = RsGxsMessageId::random();
+
+    std::list<RsNxsMsg*> msgs;
+    std::set<RsGxsMessageId> allIds, threadIds, recentIds;
+
+    const int nMsgs = 250;
+    const rstime_t baseTs = 1500000000;
+
+    for(int i=0; i<nMsgs; i++)
+    {
+        RsNxsMsg* msg = new RsNxsMsg(RS_SERVICE_TYPE_PLUGIN_SIMPLE_FORUM);
+        RsGxsMsgMetaData* msgMeta = new RsGxsMsgMetaData();
+        init_item(*msg);
+        init_item(msgMeta);
+
+        msg->metaData = msgMeta;
+        msgMeta->mMsgId = msg->msgId;
+        msgMeta->mGroupId = msg->grpId = grpId;
+        msgMeta->mPublishTs = baseTs + i;
+        msgMeta->mThreadId = (i%3 == 0) ? threadId : RsGxsMessageId::random();
+
+        allIds.insert(msg->msgId);
+        if(i%3 == 0) threadIds.insert(msg->msgId);
+        if(i >= 200) recentIds.insert(msg->msgId);
+
+        msgs.push_back(msg);
+    }
+
+    dStore->storeMessage(msgs);	// takes ownership of the messages
+
+    // all messages, small pages
+
+    std::vector<std::shared_ptr<RsGxsMsgMetaData> > metas;
+    RsGxsMsgMetaFilter filter;
+    filter.mGrpId = grpId;
+    uint64_t cursor = 0;
+    uint32_t nPages = 0;
+
+    do
+    {
+        EXPECT_TRUE(dStore->retrieveGxsMsgMetaDataPage(filter, cursor, 40, metas));
+        ++nPages;
+    }
+    while(cursor != 0 && nPages < 100);
+
+    EXPECT_EQ(metas.size(), allIds.size());
+    EXPECT_EQ(nPages, 7u);
+
+    std::set<RsGxsMessageId> returned;
+    for(auto& m: metas)
+        returned.insert(m->mMsgId);
+
+    EXPECT_TRUE(returned == allIds);
+
+    // thread predicate
+
+    metas.clear();
+    filter.mThreadId = threadId;
+    cursor = 0;
+    EXPECT_TRUE(dStore->retrieveGxsMsgMetaDataPage(filter, cursor, 0, metas));
+    EXPECT_EQ(cursor, 0u);
+
+    returned.clear();
+    for(auto& m: metas)
+        returned.insert(m->mMsgId);
+
+    EXPECT_TRUE(returned == threadIds);
+
+    // time range predicate
+
+    metas.clear();
+    filter.mThreadId.clear();
+    filter.mMinPublishTs = baseTs + 200;
+    cursor = 0;
+    EXPECT_TRUE(dStore->retrieveGxsMsgMetaDataPage(filter, cursor, 0, metas));
+
+    returned.clear();
+    for(auto& m: metas)
+        returned.insert(m->mMsgId);
+
+    EXPECT_TRUE(returned == recentIds);
+
+    // a tiny cache budget must not change results
+
+    dStore->setCacheSize(1024);
+
+    GxsMsgReq req;
+    req[grpId] = std::set<RsGxsMessageId>();
+    GxsMsgMetaResult metaResult;
+    dStore->retrieveGxsMsgMetaData(req, metaResult);
+
+    EXPECT_EQ(metaResult[grpId].size(), allIds.size());
+
+    tearDown();
+}
+
+/*!
+ * Checks that maintenance gives the pages freed by deleted messages back
+ * to the file system, and that the message indexes are created
+ */
+void test_storageMaintenance()
+{
+    setUp();
+
+    RsGxsGroupId grpId = RsGxsGroupId::random();
+    std::list<RsNxsMsg*> msgs;
+    GxsMsgReq toDelete;
+    std::vector<uint8_t> payload(4096, 0x5a);
+
+    for(int i=0; i<200; i++)
+    {
+        RsNxsMsg* msg = new RsNxsMsg(RS_SERVICE_TYPE_PLUGIN_SIMPLE_FORUM);
+        RsGxsMsgMetaData* msgMeta = new RsGxsMsgMetaData();
+        init_item(*msg);
+        init_item(msgMeta);
+
+        msg->msg.setBinData(payload.data(), payload.size());
+        msg->metaData = msgMeta;
+        msgMeta->mMsgId = msg->msgId;
+        msgMeta->mGroupId = msg->grpId = grpId;
+
+        if(i%2 == 0) toDelete[grpId].insert(msg->msgId);
+
+        msgs.push_back(msg);
+    }
+
+    dStore->storeMessage(msgs);
+    dStore->removeMsgs(toDelete);
+
+    RsGxsStorageStatistics stats;
+    EXPECT_TRUE(dStore->getStorageStatistics(stats));
+    EXPECT_TRUE(stats.mFreeSize >= 100 * payload.size());
+    EXPECT_TRUE(stats.mFreeSize < stats.mDbSize);
+
+    // Written just now, so maintenance must not reclaim anything yet
+    dStore->performMaintenance();
+
+    RsGxsStorageStatistics statsBusy;
+    EXPECT_TRUE(dStore->getStorageStatistics(statsBusy));
+    EXPECT_EQ(statsBusy.mFreeSize, stats.mFreeSize);
+    EXPECT_EQ(statsBusy.mLastVacuumTS, 0);
+
+    static_cast<RsDataService*>(dStore)->setMaintenanceIdleDelay(0);
+    dStore->performMaintenance();
+
+    RsGxsStorageStatistics statsAfter;
+    EXPECT_TRUE(dStore->getStorageStatistics(statsAfter));
+    EXPECT_TRUE(statsAfter.mFreeSize < stats.mFreeSize);
+    EXPECT_TRUE(statsAfter.mDbSize < stats.mDbSize);
+    EXPECT_TRUE(statsAfter.mLastVacuumTS > 0);
+    EXPECT_TRUE(statsAfter.mLastAnalyzeTS > 0);
+
+    RsGxsMessageId::std_set msgIds;
+    dStore->retrieveMsgIds(grpId, msgIds);
+    EXPECT_EQ(msgIds.size(), 100u);
+
+    {
+        RetroDb db(DATA_BASE_NAME, RetroDb::OPEN_READONLY);
+
+        EXPECT_EQ(db.pragmaValue("auto_vacuum"), 2);
+        EXPECT_TRUE(db.indexExists("INDEX_MESSAGES_GRPID_TIMESTAMP"));
+        EXPECT_TRUE(db.indexExists("INDEX_MESSAGES_GRPID_THREADID"));
+        EXPECT_TRUE(db.indexExists("INDEX_MESSAGES_GRPID_PARENTID"));
+        EXPECT_TRUE(db.indexExists("INDEX_MESSAGES_GRPID_RECVTS"));
+        EXPECT_FALSE(db.indexExists("INDEX_MESSAGES_UNKNOWN"));
+    }
+
+    tearDown();
+}
+
+/*!
+ * Checks that a database created without auto_vacuum is converted when
+ * it is opened, rather than by the maintenance
+ */
+void test_storageConversion()
+{
+    {
+        RetroDb db(DATA_BASE_NAME, RetroDb::OPEN_READWRITE_CREATE);
+
+        EXPECT_TRUE(db.execPragma("auto_vacuum=NONE"));
+        EXPECT_TRUE(db.execSQL("CREATE TABLE OLD_TABLE (value INT);"));
+        EXPECT_EQ(db.pragmaValue("auto_vacuum"), 0);
+    }
+
+    setUp();
+
+    RsGxsStorageStatistics stats;
+    EXPECT_TRUE(dStore->getStorageStatistics(stats));
+    EXPECT_TRUE(stats.mLastVacuumTS > 0);
+
+    {
+        RetroDb db(DATA_BASE_NAME, RetroDb::OPEN_READONLY);
+        EXPECT_EQ(db.pragmaValue("auto_vacuum"), 2);
+    }
+
+    tearDown();
+}
+
+/*!
+ * Checks that parent and replaced message ids are reported
+ * without having to load messages meta data
+ */
+void test_messageReferences()
+{
+    setUp();
+
+    RsGxsGroupId grpId = RsGxsGroupId::random();
+    RsGxsMessageId parentId, origId;
+    std::list<RsNxsMsg*> msgs;
+
+    for(int i=0; i<3; i++)
+    {
+        RsNxsMsg* msg = new RsNxsMsg(RS_SERVICE_TYPE_PLUGIN_SIMPLE_FORUM);
+        RsGxsMsgMetaData* msgMeta = new RsGxsMsgMetaData();
+        init_item(*msg);
+        init_item(msgMeta);
+
+        msg->metaData = msgMeta;
+        msgMeta->mMsgId = msg->msgId;
+        msgMeta->mGroupId = msg->grpId = grpId;
+        msgMeta->mParentId.clear();
+        msgMeta->mOrigMsgId = msg->msgId;
+
+        if(i == 0) parentId = msg->msgId;
+        if(i == 1) { msgMeta->mParentId = parentId; origId = msg->msgId; }
+        if(i == 2) msgMeta->mOrigMsgId = origId;	// new version of message 1
+
+        msgs.push_back(msg);
+    }
+
+    dStore->storeMessage(msgs);
+
+    std::set<RsGxsMessageId> parentIds, replacedIds;
+    EXPECT_EQ(dStore->retrieveMsgReferences(grpId, parentIds, replacedIds), 1);
+
+    EXPECT_EQ(parentIds.size(), 1u);
+    EXPECT_TRUE(parentIds.count(parentId) == 1);
+    EXPECT_EQ(replacedIds.size(), 1u);
+    EXPECT_TRUE(replacedIds.count(origId) == 1);
+
+    tearDown();
+}
+
 void setUp(){
     dStore = new RsDataService(".", DATA_BASE_NAME, RS_SERVICE_TYPE_PLUGIN_SIMPLE_FORUM);
 }
@@ -29,6 +29,13 @@ void test_messageStoresAndRetrieve();
 
 void test_groupStoreAndRetrieve();
 
+void test_messageMetaPagedRetrieval();
+
+void test_storageMaintenance();
+void test_storageConversion();
+
+void test_messageReferences();
+
 void test_storeAndDeleteGroup();
 void test_storeAndDeleteMessage();
 
@@ -21,12 +21,16 @@
 
 #include <gtest/gtest.h>
 
+#include <thread>
+
 #include "genexchangetester.h"
 #include "gxspublishgrouptest.h"
 #include "gxspublishmsgtest.h"
 #include "gxs/rsdataservice.h"
 #include "rsdummyservices.h"
 #include "gxsteststats.h"
+#include "gxs/rsgxschangesbatcher.h"
+#include "retroshare/rsevents.h"
 
 
 /*!
@@ -79,3 +83,117 @@ TEST(libretroshare_gxs, GetStats)
 
 	//delete dataStore ;	// deleted as a member of RsGenExchange
 }
+
+namespace
+{
+/// Records the posted events instead of dispatching them
+class RecordingEvents : public RsEvents
+{
+public:
+	std::error_condition postEvent(std::shared_ptr<const RsEvent> event) override
+	{ mPosted.push_back(event); return std::error_condition(); }
+
+	std::error_condition sendEvent(std::shared_ptr<const RsEvent> event) override
+	{ return postEvent(event); }
+
+	RsEventsHandlerId_t generateUniqueHandlerId() override { return 1; }
+
+	std::error_condition registerEventsHandler(
+	        std::function<void(std::shared_ptr<const RsEvent>)>,
+	        RsEventsHandlerId_t&, RsEventType ) override
+	{ return std::error_condition(); }
+
+	std::error_condition unregisterEventsHandler(RsEventsHandlerId_t) override
+	{ return std::error_condition(); }
+
+	void getStatistics(RsEventsStatistics&, bool) override {}
+
+	std::vector<std::shared_ptr<const RsEvent>> mPosted;
+};
+
+struct DummyChangeEvent : RsEvent
+{
+	explicit DummyChangeEvent(const RsGxsGroupId& grpId) :
+	    RsEvent(RsEventType::GXS_FORUMS), mGroupId(grpId) {}
+
+	RsGxsGroupId mGroupId;
+};
+
+/// Posts a fine grained event per notification, as the real services do
+class EventsTestService : public GenExchangeTestService
+{
+public:
+	using GenExchangeTestService::GenExchangeTestService;
+
+	void notifyChanges(std::vector<RsGxsNotify*>& changes) override
+	{
+		for(RsGxsNotify* n: changes)
+		{
+			if(auto gc = dynamic_cast<RsGxsGroupChange*>(n))
+				postChangeEvent(std::make_shared<DummyChangeEvent>(gc->mGroupId));
+			delete n;
+		}
+	}
+
+	bool summarizeChangeEvent(
+	        const RsEvent& event, RsGxsGroupId& grpId, RsGxsMessageId& msgId,
+	        uint8_t& code ) const override
+	{
+		auto e = dynamic_cast<const DummyChangeEvent*>(&event);
+		if(!e) return false;
+
+		grpId = e->mGroupId;
+		msgId.clear();
+		code = EVENT_CODE;
+		return true;
+	}
+
+	static constexpr uint8_t EVENT_CODE = 0x03;
+};
+} // namespace
+
+TEST(libretroshare_gxs, ChangesSummaryKeepsLegacyEvents)
+{
+	RecordingEvents events;
+	RsEvents* oldEvents = rsEvents;
+	rsEvents = &events;
+
+	RsGeneralDataService* dataStore = new RsDataService("./", "testServiceDb", RS_SERVICE_TYPE_DUMMY, NULL, "");
+	EventsTestService testService(dataStore, NULL, NULL);
+
+	// A burst like the ones of an initial synchronization
+	std::set<RsGxsGroupId> grps;
+	for(int i = 0; i < 200; ++i)
+	{
+		const RsGxsGroupId grpId = RsGxsGroupId::random();
+		grps.insert(grpId);
+		testService.notifyReceivePublishKey(grpId);
+	}
+	testService.tick();
+
+	// Every item reaches the legacy listeners right away
+	std::set<RsGxsGroupId> seen;
+	for(auto& ev: events.mPosted)
+		if(auto e = dynamic_cast<const DummyChangeEvent*>(ev.get()))
+			seen.insert(e->mGroupId);
+	EXPECT_EQ(grps, seen);
+	EXPECT_EQ(grps.size(), events.mPosted.size());
+
+	// The summary follows once its window is over
+	std::this_thread::sleep_for(
+	            std::chrono::milliseconds(RsGxsChangesBatcher::WINDOW_MS) );
+	testService.tick();
+
+	ASSERT_EQ(grps.size() + 1, events.mPosted.size());
+	auto summary = std::dynamic_pointer_cast<const RsGxsChanges>(
+	            events.mPosted.back() );
+	ASSERT_TRUE(summary);
+	EXPECT_EQ(grps.size(), summary->mNotificationsCount);
+	EXPECT_EQ(grps, summary->mGrpsMeta);
+	EXPECT_EQ(grps.size(), summary->mEventCodes.size());
+	for(auto& it: summary->mEventCodes)
+		EXPECT_EQ( std::set<uint8_t>({ EventsTestService::EVENT_CODE }),
+		           it.second.at(RsGxsMessageId()) );
+
+	rsEvents = oldEvents;
+}
@@ -0,0 +1,176 @@
+/*******************************************************************************
+ * unittests/libretroshare/gxs/gen_exchange/rsgxschangesbatcher_test.cc        *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "gxs/rsgxschangesbatcher.h"
+
+namespace
+{
+typedef RsGxsChangesBatcher::Clock Clock;
+
+const std::chrono::milliseconds WINDOW(500);
+
+/// Owns the notifications, as RsGenExchange::notifyChanges() would
+class Changes
+{
+public:
+	~Changes() { for(RsGxsNotify* n : mChanges) delete n; }
+
+	Changes& msg( const RsGxsGroupId& grp, const RsGxsMessageId& msg,
+	              bool meta = false )
+	{
+		mChanges.push_back( new RsGxsMsgChange(
+		                        RsGxsNotify::TYPE_RECEIVED_NEW, grp, msg, meta ) );
+		return *this;
+	}
+
+	Changes& group(RsGxsNotify::NotifyType type, const RsGxsGroupId& grp)
+	{
+		mChanges.push_back(new RsGxsGroupChange(type, grp, false));
+		return *this;
+	}
+
+	Changes& push(RsGxsNotify* n) { mChanges.push_back(n); return *this; }
+
+	const std::vector<RsGxsNotify*>& get() const { return mChanges; }
+
+private:
+	std::vector<RsGxsNotify*> mChanges;
+};
+
+Changes& newMsgs(Changes& changes, uint32_t count)
+{
+	const RsGxsGroupId grp = RsGxsGroupId::random();
+	for(uint32_t i = 0; i < count; ++i)
+		changes.msg(grp, RsGxsMessageId::random());
+	return changes;
+}
+} // namespace
+
+TEST(libretroshare_gxs, ChangesBatcherMerge)
+{
+	RsGxsChangesBatcher batcher(RsServiceType::GXSID, nullptr, 100, WINDOW);
+	const RsGxsGroupId grp1 = RsGxsGroupId::random();
+	const RsGxsGroupId grp2 = RsGxsGroupId::random();
+	const RsGxsMessageId msg1 = RsGxsMessageId::random();
+	const RsGxsMessageId msg2 = RsGxsMessageId::random();
+
+	Changes changes;
+	changes.msg(grp1, msg1).msg(grp1, msg1).msg(grp1, msg2).msg(grp2, msg1, true)
+	        .push(new RsGxsMsgDeletedChange(grp2, msg2))
+	        .group(RsGxsNotify::TYPE_RECEIVED_NEW, grp1)
+	        .group(RsGxsNotify::TYPE_STATISTICS_CHANGED, grp2)
+	        .group(RsGxsNotify::TYPE_GROUP_DELETED, grp2)
+	        .group(RsGxsNotify::TYPE_GROUP_AUTH_REJECTED, grp1)
+	        .push(new RsGxsDistantSearchResultChange(7, grp1))
+	        .push(new RsGxsDistantSearchResultChange(7, grp2));
+
+	const Clock::time_point now = Clock::now();
+	batcher.add(changes.get(), now);
+	EXPECT_FALSE(batcher.takeReady(false, now));
+
+	std::shared_ptr<RsGxsChanges> out = batcher.takeReady(true, now);
+	ASSERT_TRUE(out);
+	EXPECT_EQ(RsServiceType::GXSID, out->mServiceType);
+	EXPECT_EQ(11u, out->mNotificationsCount);
+	EXPECT_EQ(std::set<RsGxsMessageId>({ msg1, msg2 }), out->mMsgs[grp1]);
+	EXPECT_EQ(1u, out->mMsgs.size());
+	EXPECT_EQ(std::set<RsGxsMessageId>({ msg1 }), out->mMsgsMeta[grp2]);
+	EXPECT_EQ(std::set<RsGxsMessageId>({ msg2 }), out->mMsgsDeleted[grp2]);
+	EXPECT_EQ(std::set<RsGxsGroupId>({ grp1 }), out->mGrps);
+	EXPECT_EQ(std::set<RsGxsGroupId>({ grp2 }), out->mGrpsMeta);
+	EXPECT_EQ(std::set<RsGxsGroupId>({ grp2 }), out->mGrpsDeleted);
+	EXPECT_EQ(std::set<RsGxsGroupId>({ grp1 }), out->mGrpsAuthRejected);
+	EXPECT_EQ(std::list<TurtleRequestId>({ 7 }), out->mDistantSearchReqs);
+
+	// Taken summaries are not returned twice
+	EXPECT_FALSE(batcher.takeReady(true, now));
+}
+
+TEST(libretroshare_gxs, ChangesBatcherEventCodes)
+{
+	RsGxsChangesBatcher batcher(RsServiceType::GXSID, nullptr, 100, WINDOW);
+	const RsGxsGroupId grp = RsGxsGroupId::random();
+	const RsGxsMessageId msg = RsGxsMessageId::random();
+	const Clock::time_point now = Clock::now();
+
+	/* Distinct codes for the same group, e.g. subscribe status and moderator
+	 * list changes, must all survive the merge */
+	batcher.addEvent(grp, RsGxsMessageId(), 3, now);
+	batcher.addEvent(grp, RsGxsMessageId(), 7, now);
+	batcher.addEvent(grp, RsGxsMessageId(), 3, now);
+	batcher.addEvent(grp, msg, 2, now);
+
+	std::shared_ptr<RsGxsChanges> out = batcher.takeReady(true, now);
+	ASSERT_TRUE(out);
+	EXPECT_EQ(std::set<uint8_t>({ 3, 7 }), out->mEventCodes[grp][RsGxsMessageId()]);
+	EXPECT_EQ(std::set<uint8_t>({ 2 }), out->mEventCodes[grp][msg]);
+
+	// Events are not notifications, they don't fill the summary
+	EXPECT_EQ(0u, out->mNotificationsCount);
+}
+
+TEST(libretroshare_gxs, ChangesBatcherTimeFlush)
+{
+	RsGxsChangesBatcher batcher(RsServiceType::GXSID, nullptr, 100, WINDOW);
+	const Clock::time_point start = Clock::now();
+
+	// Nothing to summarize
+	batcher.add(std::vector<RsGxsNotify*>(), start);
+	EXPECT_FALSE(batcher.takeReady(true, start));
+
+	Changes changes;
+	batcher.add(newMsgs(changes, 3).get(), start);
+	EXPECT_FALSE(batcher.takeReady(false, start + WINDOW/2));
+
+	Changes more;
+	batcher.add(newMsgs(more, 2).get(), start + WINDOW/2);
+	EXPECT_FALSE(batcher.takeReady(false, start + WINDOW - std::chrono::milliseconds(1)));
+
+	std::shared_ptr<RsGxsChanges> out = batcher.takeReady(false, start + WINDOW);
+	ASSERT_TRUE(out);
+	EXPECT_EQ(5u, out->mNotificationsCount);
+}
+
+TEST(libretroshare_gxs, ChangesBatcherSizeFlush)
+{
+	RsGxsChangesBatcher batcher(RsServiceType::GXSID, nullptr, 100, WINDOW);
+	const Clock::time_point now = Clock::now();
+
+	Changes changes;
+	batcher.add(newMsgs(changes, 99).get(), now);
+	EXPECT_FALSE(batcher.takeReady(false, now));
+
+	Changes more;
+	batcher.add(newMsgs(more, 1).get(), now);
+	std::shared_ptr<RsGxsChanges> out = batcher.takeReady(false, now);
+	ASSERT_TRUE(out);
+	EXPECT_EQ(100u, out->mNotificationsCount);
+
+	// The next summary starts empty
+	Changes last;
+	batcher.add(newMsgs(last, 1).get(), now);
+	out = batcher.takeReady(true, now);
+	ASSERT_TRUE(out);
+	EXPECT_EQ(1u, out->mNotificationsCount);
+}
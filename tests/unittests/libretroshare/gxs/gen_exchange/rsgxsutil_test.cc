@@ -0,0 +1,266 @@
+/*******************************************************************************
+ * unittests/libretroshare/gxs/gen_exchange/rsgxsutil_test.cc                  *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <vector>
+
+#include "genexchangetestservice.h"
+#include "libretroshare/gxs/common/data_support.h"
+#include "gxs/rsdataservice.h"
+#include "gxs/rsgxsutil.h"
+#include "pqi/pqihash.h"
+#include "retroshare/rsgxsflags.h"
+#include "util/rstime.h"
+
+#define UTIL_TEST_DB_NAME "gxsUtilTestDb"
+
+/*!
+ * Test service that drops old message versions and reports one group as unused
+ */
+class CleanUpTestService : public GenExchangeTestService
+{
+public:
+    explicit CleanUpTestService(RsGeneralDataService* ds) : GenExchangeTestService(ds, NULL, NULL) {}
+
+    bool keepOldMsgVersions() const override { return false; }
+    bool service_checkIfGroupIsStillUsed(const RsGxsGrpMetaData& meta) override { return meta.mGroupId != mUnusedGroup; }
+
+    RsGxsGroupId mUnusedGroup;
+};
+
+static RsFileHash hashOf(const RsTlvBinaryData& data)
+{
+    RsFileHash hash;
+    pqihash pHash;
+    pHash.addData(data.bin_data, data.bin_len);
+    pHash.Complete(hash);
+    return hash;
+}
+
+static RsGxsGroupId storeGroup(RsGeneralDataService* ds, uint32_t subscribeFlags, bool validHash = true)
+{
+    RsNxsGrp* grp = new RsNxsGrp(RS_SERVICE_TYPE_DUMMY);
+    RsGxsGrpMetaData* meta = new RsGxsGrpMetaData();
+    init_item(*grp);
+    init_item(meta);
+
+    meta->mGroupId = grp->grpId;
+    meta->mSubscribeFlags = subscribeFlags;
+    meta->mHash = validHash ? hashOf(grp->grp) : RsFileHash::random();
+    grp->metaData = meta;
+
+    RsGxsGroupId grpId = grp->grpId;
+    std::list<RsNxsGrp*> grps;
+    grps.push_back(grp);
+    ds->storeGroup(grps);	// takes ownership
+
+    return grpId;
+}
+
+static RsNxsMsg* newMessage(const RsGxsGroupId& grpId, uint32_t size = 1024)
+{
+    RsNxsMsg* msg = new RsNxsMsg(RS_SERVICE_TYPE_DUMMY);
+    RsGxsMsgMetaData* meta = new RsGxsMsgMetaData();
+    init_item(*msg);
+    init_item(meta);
+
+    std::vector<uint8_t> payload(size);
+    for(uint32_t i=0; i<size; ++i)
+        payload[i] = rand();
+
+    msg->msg.setBinData(payload.data(), payload.size());
+    msg->grpId = grpId;
+    msg->metaData = meta;
+
+    meta->mGroupId = grpId;
+    meta->mMsgId = msg->msgId;
+    meta->mOrigMsgId = msg->msgId;
+    meta->mParentId.clear();
+    meta->mThreadId.clear();
+    meta->mPublishTs = time(NULL);
+    meta->mMsgStatus = 0;
+    meta->mHash = hashOf(msg->msg);
+
+    return msg;
+}
+
+/*!
+ * Runs one integrity check pass and waits for it to complete
+ */
+static void runIntegrityPass(RsGxsIntegrityCheck& check)
+{
+    check.start("gxs int chk test");
+
+    for(int i=0; i<60000 && !check.isDone(); ++i)
+        rstime::rs_usleep(1000);
+
+    ASSERT_TRUE(check.isDone());
+}
+
+TEST(libretroshare_gxs, RsGxsCleanUp)
+{
+    RsGeneralDataService* ds = new RsDataService("./", UTIL_TEST_DB_NAME, RS_SERVICE_TYPE_DUMMY, NULL, "");
+    CleanUpTestService service(ds);
+
+    RsGxsGroupId subscribed = storeGroup(ds, GXS_SERV::GROUP_SUBSCRIBE_SUBSCRIBED);
+    RsGxsGroupId notSubscribed = storeGroup(ds, GXS_SERV::GROUP_SUBSCRIBE_NOT_SUBSCRIBED);
+    service.mUnusedGroup = storeGroup(ds, GXS_SERV::GROUP_SUBSCRIBE_SUBSCRIBED);
+
+    // In the subscribed group, one message, a new version of it and a reply to it.
+
+    std::list<RsNxsMsg*> msgs;
+    RsNxsMsg* original = newMessage(subscribed);
+    RsNxsMsg* edited = newMessage(subscribed);
+    RsNxsMsg* reply = newMessage(subscribed);
+    RsGxsMessageId originalId = original->msgId;
+
+    edited->metaData->mOrigMsgId = originalId;
+    reply->metaData->mParentId = originalId;
+    reply->metaData->mThreadId = originalId;
+
+    msgs.push_back(original);
+    msgs.push_back(edited);
+    msgs.push_back(reply);
+
+    std::set<RsGxsMessageId> notSubscribedMsgs;
+
+    for(int i=0; i<5; ++i)
+    {
+        RsNxsMsg* msg = newMessage(notSubscribed);
+        notSubscribedMsgs.insert(msg->msgId);
+        msgs.push_back(msg);
+    }
+
+    ds->storeMessage(msgs);
+
+    RsGxsGroupId nextGroup;
+    std::vector<RsGxsGroupId> grpsToDelete;
+    GxsMsgReq msgsToDelete;
+
+    RsGxsCleanUp(ds, &service, 1).clean(nextGroup, grpsToDelete, msgsToDelete);
+
+    ASSERT_EQ(grpsToDelete.size(), 1u);
+    EXPECT_EQ(grpsToDelete[0], service.mUnusedGroup);
+
+    // Only ids of not subscribed groups are needed, all their messages go.
+    EXPECT_EQ(msgsToDelete[notSubscribed], notSubscribedMsgs);
+
+    // The replaced version goes, even though it has a reply. The others have no expiry without a net service.
+    ASSERT_EQ(msgsToDelete[subscribed].size(), 1u);
+    EXPECT_EQ(*msgsToDelete[subscribed].begin(), originalId);
+
+    ds->resetDataStore();
+    remove(UTIL_TEST_DB_NAME);
+}
+
+TEST(libretroshare_gxs, RsGxsIntegrityCheck)
+{
+    RsGeneralDataService* ds = new RsDataService("./", UTIL_TEST_DB_NAME, RS_SERVICE_TYPE_DUMMY, NULL, "");
+    GenExchangeTestService service(ds, NULL, NULL);
+
+    const uint32_t nbMsgs = 300;
+
+    RsGxsGroupId grpId = storeGroup(ds, GXS_SERV::GROUP_SUBSCRIBE_SUBSCRIBED);
+    RsGxsGroupId corruptedGrpId = storeGroup(ds, GXS_SERV::GROUP_SUBSCRIBE_SUBSCRIBED, false);
+
+    std::list<RsNxsMsg*> msgs;
+    std::set<RsGxsMessageId> corruptedMsgs;
+
+    for(uint32_t i=0; i<nbMsgs; ++i)
+    {
+        RsNxsMsg* msg = newMessage(grpId);
+
+        if(i % 100 == 42)
+        {
+            msg->metaData->mHash = RsFileHash::random();
+            corruptedMsgs.insert(msg->msgId);
+        }
+        msgs.push_back(msg);
+    }
+
+    ds->storeMessage(msgs);
+
+    // One pass with the default budget goes through everything.
+    {
+        RsGxsIntegrityCheck check(ds, &service, *service.mSerializer, NULL);
+        runIntegrityPass(check);
+
+        std::vector<RsGxsGroupId> grpIds;
+        GxsMsgReq msgIds;
+        check.getDeletedIds(grpIds, msgIds);
+
+        ASSERT_EQ(grpIds.size(), 1u);
+        EXPECT_EQ(grpIds[0], corruptedGrpId);
+        EXPECT_EQ(msgIds[grpId], corruptedMsgs);
+        EXPECT_TRUE(check.nextPosition().first.isNull());
+
+        RsGxsIntegrityCheckProgress progress;
+        check.getProgress(progress);
+        EXPECT_TRUE(progress.mFullRound);
+        EXPECT_EQ(progress.mGrpsTotal, 2u);
+        EXPECT_EQ(progress.mMsgsChecked, nbMsgs);
+        EXPECT_TRUE(progress.mBytesHashed >= nbMsgs * 1024);
+    }
+
+    // With a tiny budget each pass hashes a single batch and resumes where the previous one stopped.
+    {
+        RsGxsGrpMsgIdPair position;
+        std::vector<RsGxsGroupId> allGrpIds;
+        GxsMsgReq allMsgIds;
+        uint32_t passes = 0;
+        uint32_t msgsChecked = 0;
+
+        do
+        {
+            ++passes;
+
+            RsGxsIntegrityCheck check(ds, &service, *service.mSerializer, NULL, position);
+            check.setMaxBytesPerPass(1);
+            runIntegrityPass(check);
+
+            std::vector<RsGxsGroupId> grpIds;
+            GxsMsgReq msgIds;
+            check.getDeletedIds(grpIds, msgIds);
+
+            allGrpIds.insert(allGrpIds.end(), grpIds.begin(), grpIds.end());
+            allMsgIds[grpId].insert(msgIds[grpId].begin(), msgIds[grpId].end());
+
+            RsGxsIntegrityCheckProgress progress;
+            check.getProgress(progress);
+            msgsChecked += progress.mMsgsChecked;
+
+            position = check.nextPosition();
+            EXPECT_EQ(progress.mFullRound, position.first.isNull());
+        }
+        while(!position.first.isNull() && passes < 100);
+
+        // The first pass stops right after hashing the group, then one pass per batch of 128 messages.
+        EXPECT_EQ(passes, 4u);
+        EXPECT_EQ(msgsChecked, nbMsgs);
+        ASSERT_EQ(allGrpIds.size(), 1u);
+        EXPECT_EQ(allGrpIds[0], corruptedGrpId);
+        EXPECT_EQ(allMsgIds[grpId], corruptedMsgs);
+    }
+
+    ds->resetDataStore();
+    remove(UTIL_TEST_DB_NAME);
+}
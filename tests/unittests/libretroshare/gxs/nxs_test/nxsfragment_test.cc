@@ -0,0 +1,229 @@
+/*******************************************************************************
+ * unittests/libretroshare/gxs/nxs_test/nxsfragment_test.cc                    *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "gxs/rsgxsnetutils.h"
+#include "gxs/rsgxsnetservice.h"
+#include "gxs/rsgds.h"
+#include "util/rsrandom.h"
+
+static const uint16_t TEST_SERVICE_TYPE = 0x0215;
+
+// Builds fragment pos of data as a sending peer would, so that only one fragment exists at a time
+static RsNxsMsg *makeFragment(const std::vector<uint8_t>& data, const RsGxsGroupId& grpId, const RsGxsMessageId& msgId, uint32_t pos, uint32_t count, uint32_t fragSize)
+{
+	RsNxsMsg *frag = new RsNxsMsg(TEST_SERVICE_TYPE);
+	uint32_t offset = pos * fragSize;
+
+	frag->grpId = grpId;
+	frag->msgId = msgId;
+	frag->pos = pos;
+	frag->count = count;
+	frag->msg.setBinData(data.data() + offset, std::min<uint32_t>(fragSize, data.size() - offset));
+
+	return frag;
+}
+
+TEST(libretroshare_gxs, NxsFragmentAssemblerLargeMessage)
+{
+	const uint32_t fragSize = RsGxsNetService::FRAGMENT_SIZE;
+	const uint32_t msgSize = 10 * 1024 * 1024;
+	const uint32_t count = (msgSize + fragSize - 1) / fragSize;
+
+	std::vector<uint8_t> data(msgSize);
+	RsRandom::random_bytes(data.data(), msgSize);
+
+	RsGxsGroupId grpId = RsGxsGroupId::random();
+	RsGxsMessageId msgId = RsGxsMessageId::random();
+
+	NxsFragmentAssembler assembler(fragSize, msgSize);
+	RsNxsItem *complete = NULL;
+
+	for(uint32_t i=0; i<count; ++i)
+	{
+		ASSERT_TRUE(complete == NULL);
+
+		complete = assembler.addItem(makeFragment(data, grpId, msgId, i, count, fragSize));
+
+		// memory follows the data received, not the size announced by the first fragment
+		if(!complete)
+			EXPECT_LE(assembler.pendingBytes(), 2 * uint64_t(i + 1) * fragSize);
+	}
+
+	EXPECT_EQ(assembler.pendingBytes(), 0u);
+	EXPECT_EQ(assembler.pendingItems(), 0u);
+
+	RsNxsMsg *msg = dynamic_cast<RsNxsMsg*>(complete);
+	ASSERT_TRUE(msg != NULL);
+	EXPECT_EQ(msg->msgId, msgId);
+	EXPECT_EQ(msg->grpId, grpId);
+	EXPECT_EQ(msg->count, 1);
+	ASSERT_EQ(msg->msg.bin_len, msgSize);
+	EXPECT_EQ(memcmp(msg->msg.bin_data, data.data(), msgSize), 0);
+
+	delete msg;
+}
+
+TEST(libretroshare_gxs, NxsFragmentAssemblerShuffledFragments)
+{
+	const uint32_t fragSize = RsGxsNetService::FRAGMENT_SIZE;
+	const uint32_t msgSize = 10 * 1024 * 1024;
+	const uint32_t count = (msgSize + fragSize - 1) / fragSize;
+
+	std::vector<uint8_t> data(msgSize);
+	RsRandom::random_bytes(data.data(), msgSize);
+
+	std::vector<uint32_t> order(count);
+	for(uint32_t i=0; i<count; ++i)
+		order[i] = i;
+
+	for(uint32_t i=count-1; i>0; --i)
+		std::swap(order[i], order[RsRandom::random_u32() % (i + 1)]);
+
+	RsGxsGroupId grpId = RsGxsGroupId::random();
+	RsGxsMessageId msgId = RsGxsMessageId::random();
+
+	NxsFragmentAssembler assembler(fragSize, msgSize + fragSize);
+	RsNxsItem *complete = NULL;
+	uint64_t peak = 0;
+
+	for(uint32_t i=0; i<count; ++i)
+	{
+		ASSERT_TRUE(complete == NULL);
+
+		complete = assembler.addItem(makeFragment(data, grpId, msgId, order[i], count, fragSize));
+		peak = std::max(peak, assembler.pendingBytes());
+	}
+
+	// fragments out of order may grow the buffer to the whole item, but never above it
+	EXPECT_LE(peak, uint64_t(msgSize) + fragSize);
+	EXPECT_EQ(assembler.pendingBytes(), 0u);
+
+	RsNxsMsg *msg = dynamic_cast<RsNxsMsg*>(complete);
+	ASSERT_TRUE(msg != NULL);
+	ASSERT_EQ(msg->msg.bin_len, msgSize);
+	EXPECT_EQ(memcmp(msg->msg.bin_data, data.data(), msgSize), 0);
+
+	delete msg;
+}
+
+TEST(libretroshare_gxs, NxsFragmentAssemblerInvalidFragments)
+{
+	const uint32_t fragSize = 1000;
+	std::vector<uint8_t> data(2500, 0x5a);
+
+	RsGxsGroupId grpId = RsGxsGroupId::random();
+	RsGxsMessageId msgId = RsGxsMessageId::random();
+
+	NxsFragmentAssembler assembler(fragSize, 10 * fragSize);
+
+	// items that are not fragments go through untouched
+	RsNxsMsg *single = new RsNxsMsg(TEST_SERVICE_TYPE);
+	single->count = 1;
+	EXPECT_EQ(assembler.addItem(single), single);
+	delete single;
+
+	EXPECT_TRUE(assembler.addItem(makeFragment(data, grpId, msgId, 0, 3, fragSize)) == NULL);
+
+	// duplicates and fragments of the wrong size are dropped
+	EXPECT_TRUE(assembler.addItem(makeFragment(data, grpId, msgId, 0, 3, fragSize)) == NULL);
+	EXPECT_TRUE(assembler.addItem(makeFragment(data, grpId, msgId, 1, 3, fragSize + 1)) == NULL);
+	EXPECT_EQ(assembler.pendingItems(), 1u);
+
+	EXPECT_TRUE(assembler.addItem(makeFragment(data, grpId, msgId, 2, 3, fragSize)) == NULL);
+
+	RsNxsMsg *msg = dynamic_cast<RsNxsMsg*>(assembler.addItem(makeFragment(data, grpId, msgId, 1, 3, fragSize)));
+	ASSERT_TRUE(msg != NULL);
+	EXPECT_EQ(msg->msg.bin_len, data.size());
+	delete msg;
+
+	// incomplete items are released with the assembler
+	EXPECT_TRUE(assembler.addItem(makeFragment(data, grpId, RsGxsMessageId::random(), 0, 3, fragSize)) == NULL);
+	EXPECT_EQ(assembler.pendingItems(), 1u);
+}
+
+TEST(libretroshare_gxs, NxsFragmentAssemblerAnnouncedCount)
+{
+	const uint32_t fragSize = RsGxsNetService::FRAGMENT_SIZE;
+	std::vector<uint8_t> data(fragSize, 0x5a);
+
+	NxsFragmentAssembler assembler(fragSize, RsGeneralDataService::GXS_MAX_ITEM_SIZE);
+
+	// a single fragment announcing 255 of them would be an item far above the size limit
+	EXPECT_TRUE(assembler.addItem(makeFragment(data, RsGxsGroupId::random(), RsGxsMessageId::random(), 0, 255, fragSize)) == NULL);
+	EXPECT_EQ(assembler.pendingItems(), 0u);
+	EXPECT_EQ(assembler.pendingBytes(), 0u);
+
+	// an acceptable count is not allocated upfront either
+	EXPECT_TRUE(assembler.addItem(makeFragment(data, RsGxsGroupId::random(), RsGxsMessageId::random(), 0, 10, fragSize)) == NULL);
+	EXPECT_EQ(assembler.pendingItems(), 1u);
+	EXPECT_EQ(assembler.pendingBytes(), fragSize);
+}
+
+TEST(libretroshare_gxs, NxsFragmentAssemblerBudget)
+{
+	const uint32_t fragSize = 1000;
+	std::vector<uint8_t> data(10 * fragSize, 0x5a);
+
+	RsPeerId peer1 = RsPeerId::random();
+	RsPeerId peer2 = RsPeerId::random();
+	RsGxsGroupId grpId = RsGxsGroupId::random();
+
+	NxsFragmentBudget budget(3 * fragSize, 5 * fragSize);
+
+	{
+		NxsFragmentAssembler assembler1(fragSize, 10 * fragSize, &budget, peer1);
+		NxsFragmentAssembler assembler2(fragSize, 10 * fragSize, &budget, peer2);
+		RsGxsMessageId msgId1 = RsGxsMessageId::random();
+		RsGxsMessageId msgId2 = RsGxsMessageId::random();
+
+		// the buffer doubles: 1000, then 2000 bytes
+		EXPECT_TRUE(assembler1.addItem(makeFragment(data, grpId, msgId1, 0, 10, fragSize)) == NULL);
+		EXPECT_TRUE(assembler1.addItem(makeFragment(data, grpId, msgId1, 1, 10, fragSize)) == NULL);
+		EXPECT_EQ(budget.reservedBytes(peer1), 2 * fragSize);
+
+		// growing to 4000 bytes exceeds the per peer limit: the item is dropped and its memory released
+		EXPECT_TRUE(assembler1.addItem(makeFragment(data, grpId, msgId1, 2, 10, fragSize)) == NULL);
+		EXPECT_EQ(assembler1.pendingItems(), 0u);
+		EXPECT_EQ(assembler1.pendingBytes(), 0u);
+		EXPECT_EQ(budget.reservedBytes(peer1), 0u);
+
+		// the total limit applies to all peers
+		EXPECT_TRUE(assembler1.addItem(makeFragment(data, grpId, RsGxsMessageId::random(), 0, 10, fragSize)) == NULL);
+		EXPECT_TRUE(assembler1.addItem(makeFragment(data, grpId, RsGxsMessageId::random(), 0, 10, fragSize)) == NULL);
+		EXPECT_TRUE(assembler1.addItem(makeFragment(data, grpId, RsGxsMessageId::random(), 0, 10, fragSize)) == NULL);
+		EXPECT_EQ(budget.reservedBytes(peer1), 3 * fragSize);
+
+		EXPECT_TRUE(assembler2.addItem(makeFragment(data, grpId, msgId2, 0, 10, fragSize)) == NULL);
+		EXPECT_TRUE(assembler2.addItem(makeFragment(data, grpId, msgId2, 1, 10, fragSize)) == NULL);
+		EXPECT_EQ(budget.reservedBytes(peer2), 2 * fragSize);
+		EXPECT_EQ(budget.reservedBytes(), 5 * fragSize);
+
+		EXPECT_TRUE(assembler2.addItem(makeFragment(data, grpId, RsGxsMessageId::random(), 0, 10, fragSize)) == NULL);
+		EXPECT_EQ(assembler2.pendingItems(), 1u);
+		EXPECT_EQ(budget.reservedBytes(), 5 * fragSize);
+	}
+
+	// incomplete items give their memory back when the transactions are deleted
+	EXPECT_EQ(budget.reservedBytes(), 0u);
+}
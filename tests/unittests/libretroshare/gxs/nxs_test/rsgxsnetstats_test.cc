@@ -0,0 +1,85 @@
+/*******************************************************************************
+ * unittests/libretroshare/gxs/nxs_test/rsgxsnetstats_test.cc                  *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "gxs/rsgxsnetstats.h"
+
+TEST(libretroshare_gxs, RsGxsHistogramPercentile)
+{
+	RsGxsHistogram h;
+
+	EXPECT_EQ(h.percentile(0.5), 0u);
+
+	for(uint64_t i=1; i<=1000; ++i)
+		h.record(i);
+
+	EXPECT_EQ(h.mCount, 1000u);
+	EXPECT_EQ(h.mMax, 1000u);
+	EXPECT_EQ(h.percentile(1.0), 1000u);
+
+	// buckets are a quarter of a power of two wide, so 25% error at most
+	uint64_t p50 = h.percentile(0.5);
+	EXPECT_GE(p50, 500u);
+	EXPECT_LE(p50, 625u);
+
+	uint64_t p99 = h.percentile(0.99);
+	EXPECT_GE(p99, 990u);
+	EXPECT_LE(p99, 1000u);
+
+	RsGxsHistogram h2;
+	h2.record(5000);
+	h.merge(h2);
+
+	EXPECT_EQ(h.mCount, 1001u);
+	EXPECT_EQ(h.mMax, 5000u);
+	EXPECT_EQ(h.percentile(1.0), 5000u);
+}
+
+TEST(libretroshare_gxs, RsGxsNetStatsCollector)
+{
+	RsGxsNetStatsCollector collector(0x0211);
+	RsPeerId peer = RsPeerId::random();
+	RsGxsNetStatistics stats;
+
+	// disabled by default: nothing is recorded
+	collector.syncReqReceived(peer);
+	collector.getStatistics(stats);
+	EXPECT_FALSE(stats.mEnabled);
+	EXPECT_EQ(stats.mTotal.mSyncReqReceived, 0u);
+	EXPECT_TRUE(stats.mPeers.empty());
+
+	collector.setEnabled(true);
+	collector.syncReqReceived(peer);
+	collector.syncRespSent(peer, 12, true);
+	collector.transactionDone(peer, true, 250);
+	collector.transactionDone(RsPeerId(), false, 100);
+
+	collector.getStatistics(stats);
+	EXPECT_TRUE(stats.mEnabled);
+	EXPECT_EQ(stats.mServiceType, 0x0211);
+	EXPECT_EQ(stats.mTotal.mSyncReqReceived, 1u);
+	EXPECT_EQ(stats.mTotal.mMsgIdsSent, 12u);
+	EXPECT_EQ(stats.mTotal.mTransactionsOk, 1u);
+	EXPECT_EQ(stats.mTotal.mTransactionsFailed, 1u);
+	ASSERT_EQ(stats.mPeers.size(), 1u);
+	EXPECT_EQ(stats.mPeers[peer].mSyncReqReceived, 1u);
+	EXPECT_EQ(stats.mPeers[peer].mSyncRespSize.mCount, 1u);
+}
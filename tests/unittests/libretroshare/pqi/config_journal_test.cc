@@ -0,0 +1,286 @@
+/*******************************************************************************
+ * unittests/libretroshare/pqi/config_journal_test.cc                          *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "pqi/p3cfgmgr.h"
+#include "pqi/p3historymgr.h"
+#include "retroshare/rshistory.h"
+#include "retroshare/rsmsgs.h"
+#include "rsitems/rsconfigitems.h"
+#include "rsitems/rshistoryitems.h"
+#include "util/rsprint.h"
+
+namespace
+{
+/* The journal keys are normally encrypted to our own certificate and the
+ * header signed with it. No certificate is loaded here, so keys are stored
+ * as is and the "signature" is the hex digest. */
+bool testEncryptKeys(void*& out, int& outlen, const void* in, int inlen)
+{
+	out = malloc(inlen);
+	memcpy(out, in, inlen);
+	outlen = inlen;
+	return true;
+}
+
+bool testVerify(const RsFileHash& digest, unsigned char *signature, unsigned int signature_len)
+{
+	return signature_len == RsFileHash::SIZE_IN_BYTES
+	        && !memcmp(signature, digest.toByteArray(), signature_len);
+}
+
+class JournaledConfig: public p3Config
+{
+public:
+	JournaledConfig(const std::string& file, const RsFileHash& base)
+	{
+		setFilename(file);
+		setHash(base);
+		enableConfigJournal();
+	}
+
+	~JournaledConfig()
+	{
+		for(std::list<RsItem *>::iterator it = mLoaded.begin(); it != mLoaded.end(); ++it)
+			delete *it;
+	}
+
+	bool journal(const std::string& value)
+	{
+		RsConfigKeyValueSet item;
+		RsTlvKeyValue kv;
+		kv.key = "VALUE";
+		kv.value = value;
+		item.tlvkvs.pairs.push_back(kv);
+
+		return journalConfigItems(std::list<RsItem *>(1, &item));
+	}
+
+	bool replay() { return loadJournal(); }
+
+	std::vector<std::string> loadedValues()
+	{
+		std::vector<std::string> values;
+
+		for(std::list<RsItem *>::iterator it = mLoaded.begin(); it != mLoaded.end(); ++it)
+		{
+			RsConfigKeyValueSet *kv = dynamic_cast<RsConfigKeyValueSet *>(*it);
+
+			if(kv && !kv->tlvkvs.pairs.empty())
+				values.push_back(kv->tlvkvs.pairs.front().value);
+		}
+		return values;
+	}
+
+protected:
+	RsSerialiser *setupSerialiser()
+	{
+		RsSerialiser *rss = new RsSerialiser;
+		rss->addSerialType(new RsGeneralConfigSerialiser());
+		return rss;
+	}
+
+	bool saveList(bool& cleanup, std::list<RsItem *>&)
+	{
+		cleanup = true;
+		return true;
+	}
+
+	bool loadList(std::list<RsItem *>& load)
+	{
+		mLoaded.splice(mLoaded.end(), load);
+		return true;
+	}
+
+	bool encryptJournalKeys(void*& out, int& outlen, const void* in, int inlen)
+	{ return testEncryptKeys(out, outlen, in, inlen); }
+
+	bool decryptJournalKeys(void*& out, int& outlen, const void* in, int inlen)
+	{ return testEncryptKeys(out, outlen, in, inlen); }
+
+	bool signJournal(const RsFileHash& digest, std::string& signature)
+	{
+		signature = RsUtil::BinToHex(digest.toByteArray(), RsFileHash::SIZE_IN_BYTES);
+		return true;
+	}
+
+	bool verifyJournal(const RsFileHash& digest, unsigned char *signature, unsigned int signature_len)
+	{ return testVerify(digest, signature, signature_len); }
+
+	std::list<RsItem *> mLoaded;
+};
+
+class ConfigJournalTest: public testing::Test
+{
+protected:
+	void SetUp()
+	{
+		mFile = testing::TempDir() + "config_journal_test_" + std::to_string(getpid()) + ".cfg";
+		mBase = RsFileHash::random();
+		unlink(journalFile().c_str());
+	}
+
+	void TearDown() { unlink(journalFile().c_str()); }
+
+	std::string journalFile() const { return mFile + ".jnl"; }
+
+	uint64_t journalSize() const
+	{
+		struct stat st;
+		return stat(journalFile().c_str(), &st) == 0 ? st.st_size : 0;
+	}
+
+	/* writes "0", "1", ... and returns the journal size after each record */
+	std::vector<uint64_t> writeRecords(uint32_t count)
+	{
+		JournaledConfig config(mFile, mBase);
+		std::vector<uint64_t> sizes;
+
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			EXPECT_TRUE(config.journal(std::to_string(i)));
+			sizes.push_back(journalSize());
+		}
+		return sizes;
+	}
+
+	std::string mFile;
+	RsFileHash mBase;
+};
+} // namespace
+
+TEST_F(ConfigJournalTest, RecordsRoundTrip)
+{
+	writeRecords(3);
+
+	{
+		JournaledConfig config(mFile, mBase);
+		EXPECT_TRUE(config.replay());
+		EXPECT_EQ(std::vector<std::string>({ "0", "1", "2" }), config.loadedValues());
+
+		// a clean journal is appended to after the replay
+		EXPECT_TRUE(config.journal("3"));
+	}
+
+	JournaledConfig config(mFile, mBase);
+	EXPECT_TRUE(config.replay());
+	EXPECT_EQ(std::vector<std::string>({ "0", "1", "2", "3" }), config.loadedValues());
+}
+
+TEST_F(ConfigJournalTest, BrokenMacChainStopsReplay)
+{
+	std::vector<uint64_t> sizes = writeRecords(3);
+
+	// flip a byte inside the second record
+	FILE *f = fopen(journalFile().c_str(), "r+b");
+	ASSERT_TRUE(f != NULL);
+	uint64_t pos = (sizes[0] + sizes[1]) / 2;
+	ASSERT_EQ(0, fseek(f, pos, SEEK_SET));
+	int c = fgetc(f);
+	ASSERT_EQ(0, fseek(f, pos, SEEK_SET));
+	fputc(c ^ 0x5a, f);
+	fclose(f);
+
+	JournaledConfig config(mFile, mBase);
+	EXPECT_TRUE(config.replay());
+	EXPECT_EQ(std::vector<std::string>({ "0" }), config.loadedValues());
+
+	// the journal cannot be extended past the damage: a full save is needed
+	EXPECT_FALSE(config.journal("3"));
+	EXPECT_EQ(sizes[2], journalSize());
+}
+
+TEST_F(ConfigJournalTest, TornTailIsDropped)
+{
+	std::vector<uint64_t> sizes = writeRecords(3);
+
+	// crash in the middle of the last write
+	ASSERT_EQ(0, truncate(journalFile().c_str(), sizes[2] - 5));
+
+	JournaledConfig config(mFile, mBase);
+	EXPECT_TRUE(config.replay());
+	EXPECT_EQ(std::vector<std::string>({ "0", "1" }), config.loadedValues());
+	EXPECT_FALSE(config.journal("3"));
+}
+
+TEST_F(ConfigJournalTest, StaleBaseIsIgnored)
+{
+	writeRecords(2);
+
+	// the config file was saved again, but the journal could not be removed
+	JournaledConfig config(mFile, RsFileHash::random());
+	EXPECT_TRUE(config.replay());
+	EXPECT_TRUE(config.loadedValues().empty());
+}
+
+namespace
+{
+RsHistoryMsgItem *historyItem(const RsPeerId& chat, const std::string& msg)
+{
+	RsHistoryMsgItem *item = new RsHistoryMsgItem;
+	item->chatPeerId = chat;
+	item->incoming = true;
+	item->sendTime = time(NULL);
+	item->recvTime = item->sendTime;
+	item->message = msg;
+	return item;
+}
+} // namespace
+
+TEST(ConfigJournal, HistoryReplayAppliesSaveCounts)
+{
+	p3HistoryMgr history;
+	history.setSaveCount(RS_HISTORY_TYPE_PRIVATE, 2);
+	history.setSaveCount(RS_HISTORY_TYPE_LOBBY, 3);
+
+	RsPeerId peer = RsPeerId::random();
+	ChatLobbyId lobby = 0x1234567890abcdefULL;
+	RsPeerId lobbyPeer;
+	ASSERT_TRUE(p3HistoryMgr::chatIdToVirtualPeerId(ChatId(lobby), lobbyPeer));
+
+	// one journal record per message, as written by addMessage()
+	for(int i = 0; i < 5; ++i)
+	{
+		std::list<RsItem *> items;
+		items.push_back(historyItem(peer, "peer " + std::to_string(i)));
+		items.push_back(historyItem(lobbyPeer, "lobby " + std::to_string(i)));
+		EXPECT_TRUE(history.loadDelta(p3Config::CONFIG_JOURNAL_ADD, items));
+	}
+
+	std::list<HistoryMsg> msgs;
+	ASSERT_TRUE(history.getMessages(ChatId(peer), msgs, 0));
+	ASSERT_EQ(2u, msgs.size());
+	EXPECT_EQ("peer 3", msgs.front().message);
+	EXPECT_EQ("peer 4", msgs.back().message);
+
+	msgs.clear();
+	ASSERT_TRUE(history.getMessages(ChatId(lobby), msgs, 0));
+	ASSERT_EQ(3u, msgs.size());
+	EXPECT_EQ("lobby 2", msgs.front().message);
+}
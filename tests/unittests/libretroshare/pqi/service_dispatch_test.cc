@@ -0,0 +1,176 @@
+/*******************************************************************************
+ * unittests/libretroshare/pqi/service_dispatch_test.cc                        *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+
+#include "retroshare/rspeers.h"
+// from librssimulator
+#include "peer/FakeLinkMgr.h"
+
+#include "pqi/p3servicecontrol.h"
+#include "pqi/pqihandler.h"
+#include "pqi/pqiloopback.h"
+#include "pqi/pqiservice.h"
+#include "rsitems/rsitem.h"
+
+namespace
+{
+class CountingService: public pqiService
+{
+public:
+	explicit CountingService(uint16_t type) : mType(type), mReceived(0) {}
+
+	bool recv(RsRawItem *item)
+	{
+		++mReceived;
+		delete item;
+		return true;
+	}
+
+	RsServiceInfo getServiceInfo()
+	{ return RsServiceInfo(mType, "dispatch test", 1, 0, 1, 0); }
+
+	uint32_t fullId() { return getServiceInfo().mServiceType; }
+
+	uint16_t mType;
+	uint64_t mReceived;
+};
+
+/* Services and a friend connected through a pqiloopback, so items sent go
+ * through the filter, pqihandler, the loopback and back to the services */
+class LoopbackStack
+{
+public:
+	LoopbackStack() :
+	    mOwnId(RsPeerId::random()), mPeerId(RsPeerId::random()),
+	    mLinkMgr(mOwnId, std::list<RsPeerId>(1, mPeerId), true),
+	    mCtrl(&mLinkMgr), mServer(&mHandler, &mCtrl),
+	    mLoopback(new pqiloopback(mPeerId)),
+	    mShared(0xe0f1), mLocalOnly(0xe0f2)
+	{
+		mServer.addService(&mShared, true);
+		mServer.addService(&mLocalOnly, true);
+
+		mModule.peerid = mPeerId;
+		mModule.pqi = mLoopback;
+		mHandler.AddSearchModule(&mModule);
+
+		// the friend runs only one of the two services
+		RsPeerServiceInfo info;
+		info.mPeerId = mPeerId;
+		info.mServiceList[mShared.fullId()] = mShared.getServiceInfo();
+		mCtrl.updateServicesProvided(mPeerId, info);
+	}
+
+	~LoopbackStack()
+	{
+		mHandler.RemoveSearchModule(&mModule);
+		delete mLoopback;
+	}
+
+	bool send(CountingService& service, const RsPeerId& to)
+	{
+		RsRawItem *item = new RsRawItem(service.fullId() | 0x01, 16);
+		item->PeerId(to);
+		return mServer.sendItem(item);
+	}
+
+	uint32_t deliver()
+	{
+		uint32_t n = 0;
+		while(RsItem *item = mLoopback->GetItem())
+		{
+			mServer.recvItem(static_cast<RsRawItem*>(item));
+			++n;
+		}
+		return n;
+	}
+
+	RsPeerId mOwnId;
+	RsPeerId mPeerId;
+	FakeLinkMgr mLinkMgr;
+	p3ServiceControl mCtrl;
+	pqihandler mHandler;
+	p3ServiceServer mServer;
+	pqiloopback *mLoopback;
+	SearchModule mModule;
+	CountingService mShared;
+	CountingService mLocalOnly;
+};
+}
+
+TEST(libretroshare_pqi, ServiceDispatchTable)
+{
+	LoopbackStack stack;
+
+	EXPECT_TRUE(stack.mCtrl.checkFilter(stack.mShared.fullId(), stack.mPeerId));
+	EXPECT_FALSE(stack.mCtrl.checkFilter(stack.mLocalOnly.fullId(), stack.mPeerId));
+	EXPECT_EQ(stack.mCtrl.getDispatchTarget(stack.mShared.fullId(), stack.mPeerId), &stack.mShared);
+	EXPECT_EQ(stack.mCtrl.getDispatchTarget(stack.mLocalOnly.fullId(), stack.mPeerId), (pqiService*)NULL);
+
+	// Unknown peers only get ServiceInfo through
+	RsPeerId stranger = RsPeerId::random();
+	EXPECT_FALSE(stack.mCtrl.checkFilter(stack.mShared.fullId(), stranger));
+	EXPECT_TRUE(stack.mCtrl.checkFilter(
+	        RsServiceInfo::RsServiceInfoUIn16ToFullServiceId(RS_SERVICE_TYPE_SERVICEINFO), stranger));
+
+	std::set<RsPeerId> peers;
+	stack.mCtrl.getPeersConnected(stack.mShared.fullId(), peers);
+	EXPECT_EQ(peers.size(), 1u);
+	EXPECT_EQ(peers.count(stack.mPeerId), 1u);
+
+	EXPECT_TRUE(stack.send(stack.mShared, stack.mPeerId));
+	EXPECT_FALSE(stack.send(stack.mLocalOnly, stack.mPeerId));
+	EXPECT_EQ(stack.deliver(), 1u);
+	EXPECT_EQ(stack.mShared.mReceived, 1u);
+	EXPECT_EQ(stack.mLocalOnly.mReceived, 0u);
+
+	// Removing the service drops the table entry
+	stack.mServer.removeService(&stack.mShared);
+	EXPECT_EQ(stack.mCtrl.getDispatchTarget(stack.mShared.fullId(), stack.mPeerId), (pqiService*)NULL);
+}
+
+TEST(libretroshare_pqi, ServiceDispatchLoopbackBenchmark)
+{
+	LoopbackStack stack;
+
+	const uint32_t batch = 1000;
+	const auto duration = std::chrono::milliseconds(500);
+	uint64_t items = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	while(std::chrono::steady_clock::now() - start < duration)
+	{
+		for(uint32_t i = 0; i < batch; ++i) stack.send(stack.mShared, stack.mPeerId);
+		items += stack.deliver();
+	}
+	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+	            std::chrono::steady_clock::now() - start ).count();
+
+	std::cerr << "ServiceDispatchLoopbackBenchmark " << items * 1000000 / elapsed
+	          << " items/s through filter, pqihandler and pqiloopback"
+	          << std::endl;
+
+	EXPECT_EQ(stack.mShared.mReceived, items);
+	EXPECT_GT(items, 0u);
+}
@@ -0,0 +1,159 @@
+/*******************************************************************************
+ * unittests/libretroshare/services/banlist/banlist_test.cc                    *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+
+#include "retroshare/rspeers.h"
+// from librssimulator
+#include "peer/FakeLinkMgr.h"
+
+#include "pqi/p3servicecontrol.h"
+#include "retroshare/rsbanlist.h"
+#include "services/p3banlist.h"
+#include "util/rsnet.h"
+#include "util/rstime.h"
+
+namespace
+{
+class BanListTest: public testing::Test
+{
+protected:
+	BanListTest() :
+	    mLinkMgr(RsPeerId::random(), std::list<RsPeerId>(), true),
+	    mCtrl(&mLinkMgr), mBanList(&mCtrl, NULL) {}
+
+	void TearDown()
+	{
+		for(std::list<std::string>::const_iterator it(mFiles.begin()); it != mFiles.end(); ++it)
+			unlink(it->c_str());
+	}
+
+	std::string writeList(const std::string& name, const std::string& content)
+	{
+		std::string path = testing::TempDir() + "banlist_test_" + std::to_string(getpid()) + "_" + name;
+		std::ofstream out(path.c_str());
+		out << content;
+		mFiles.push_back(path);
+		return path;
+	}
+
+	bool accepted(const std::string& ip)
+	{
+		sockaddr_storage addr;
+		EXPECT_TRUE(sockaddr_storage_inet_pton(addr, ip)) << ip;
+		return mBanList.isAddressAccepted(addr, RSBANLIST_CHECKING_FLAGS_BLACKLIST);
+	}
+
+	FakeLinkMgr mLinkMgr;
+	p3ServiceControl mCtrl;
+	p3BanList mBanList;
+	std::list<std::string> mFiles;
+};
+} // namespace
+
+TEST_F(BanListTest, ImportCidrAndP2PLists)
+{
+	uint32_t count = 0;
+
+	ASSERT_TRUE(mBanList.importBlockList(writeList("cidr", "# comment\n"
+	                                                       "81.10.0.0/16\n"
+	                                                       "2001:db8::/32\n"
+	                                                       "82.1.2.3\n"), count));
+	EXPECT_EQ(3u, count);
+
+	// names may contain ':', '-' and ','
+	ASSERT_TRUE(mBanList.importBlockList(writeList("p2p", "Some ISP, Inc:83.0.0.0-83.0.0.255\n"
+	                                                      "Bad-range: office:84.1.1.1-84.1.1.2\n"), count));
+	EXPECT_EQ(3u, count);	// 83.0.0.0/24, 84.1.1.1/32 and 84.1.1.2/32
+
+	std::list<std::string> lists;
+	mBanList.getBlockLists(lists);
+	EXPECT_EQ(2u, lists.size());
+
+	EXPECT_FALSE(accepted("81.10.200.1"));
+	EXPECT_TRUE(accepted("81.11.0.1"));
+	EXPECT_FALSE(accepted("2001:db8::1"));
+	EXPECT_TRUE(accepted("2001:db9::1"));
+	EXPECT_FALSE(accepted("82.1.2.3"));
+	EXPECT_TRUE(accepted("82.1.2.4"));
+	EXPECT_FALSE(accepted("83.0.0.0"));
+	EXPECT_FALSE(accepted("83.0.0.255"));
+	EXPECT_TRUE(accepted("83.0.1.0"));
+	EXPECT_FALSE(accepted("84.1.1.2"));
+	EXPECT_TRUE(accepted("84.1.1.3"));
+
+	EXPECT_TRUE(mBanList.removeBlockList(lists.back()));
+	EXPECT_TRUE(accepted("83.0.0.1"));
+	EXPECT_FALSE(accepted("81.10.200.1"));
+}
+
+TEST_F(BanListTest, ImportDatListSkipsAllowedRanges)
+{
+	uint32_t count = 0;
+
+	ASSERT_TRUE(mBanList.importBlockList(writeList("dat", "081.002.003.000 - 081.002.003.255 , 000 , Blocked, Inc\n"
+	                                                      "085.000.000.000 - 085.000.000.255 , 127 , Allowed\n"
+	                                                      "086.000.000.000 - 086.000.000.255 , 200 , Allowed too\n"), count));
+	EXPECT_EQ(1u, count);
+
+	EXPECT_FALSE(accepted("81.2.3.4"));
+	EXPECT_TRUE(accepted("85.0.0.1"));
+	EXPECT_TRUE(accepted("86.0.0.1"));
+}
+
+TEST_F(BanListTest, UnreadableListIsNotAdded)
+{
+	uint32_t count = 0;
+
+	EXPECT_FALSE(mBanList.importBlockList(testing::TempDir() + "banlist_test_missing", count));
+
+	std::list<std::string> lists;
+	mBanList.getBlockLists(lists);
+	EXPECT_TRUE(lists.empty());
+}
+
+TEST_F(BanListTest, DisablingAutoRangesUpdatesFilter)
+{
+	mBanList.enableIPsFromDHT(true);
+
+	sockaddr_storage addr;
+	rstime_t now = time(NULL);
+
+	ASSERT_TRUE(sockaddr_storage_inet_pton(addr, "81.2.3.1"));
+	mBanList.addBanEntry(mCtrl.getOwnId(), addr, RSBANLIST_ORIGIN_SELF, RSBANLIST_REASON_DHT, now);
+	ASSERT_TRUE(sockaddr_storage_inet_pton(addr, "81.2.3.2"));
+	mBanList.addBanEntry(mCtrl.getOwnId(), addr, RSBANLIST_ORIGIN_SELF, RSBANLIST_REASON_DHT, now);
+
+	// Two banned addresses in the same /24 ban the whole range. Ranges are
+	// figured out from the condensed ban set, so it takes a second pass.
+	mBanList.enableAutoRange(true);
+	mBanList.setAutoRangeLimit(2);
+	EXPECT_FALSE(accepted("81.2.3.1"));
+	EXPECT_FALSE(accepted("81.2.3.100"));
+
+	mBanList.enableAutoRange(false);
+	EXPECT_FALSE(accepted("81.2.3.1"));
+	EXPECT_TRUE(accepted("81.2.3.100"));
+}
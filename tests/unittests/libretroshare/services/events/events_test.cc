@@ -0,0 +1,316 @@
+/*******************************************************************************
+ * unittests/libretroshare/services/events/events_test.cc                      *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "services/rseventsservice.h"
+
+struct EventsTestEvent : RsEvent
+{
+	EventsTestEvent(uint32_t value, RsEventType type) :
+	    RsEvent(type), mValue(value) {}
+
+	uint32_t mValue;
+
+	void serial_process( RsGenericSerializer::SerializeJob j,
+	                     RsGenericSerializer::SerializeContext& ctx ) override
+	{
+		RsEvent::serial_process(j, ctx);
+		RS_SERIAL_PROCESS(mValue);
+	}
+};
+
+static bool waitFor(const std::function<bool()>& condition, int timeoutMs = 5000)
+{
+	auto deadline = std::chrono::steady_clock::now() +
+	        std::chrono::milliseconds(timeoutMs);
+
+	while(!condition())
+	{
+		if(std::chrono::steady_clock::now() > deadline) return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+static uint32_t valueOf(const std::shared_ptr<const RsEvent>& e)
+{ return static_cast<const EventsTestEvent&>(*e).mValue; }
+
+class RsEventsServiceTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		// Same time point for all, so identical values give identical events
+		mTimePoint = std::chrono::system_clock::now();
+		mService.start("events test");
+	}
+
+	void TearDown() override { mService.fullstop(); }
+
+	void post( uint32_t value,
+	           RsEventType type = RsEventType::BROADCAST_DISCOVERY )
+	{
+		auto event = std::make_shared<EventsTestEvent>(value, type);
+		event->mTimePoint = mTimePoint;
+		EXPECT_FALSE(mService.postEvent(event));
+	}
+
+	RsEventsStatistics statistics()
+	{
+		RsEventsStatistics stats;
+		mService.getStatistics(stats, false);
+		return stats;
+	}
+
+	/** Handlers get their events in posting order, so once a handler
+	 * registered for all events got this one, it got all the previous ones */
+	static const uint32_t SENTINEL = 0xffffffff;
+
+	RsEventsService mService;
+	std::chrono::system_clock::time_point mTimePoint;
+};
+
+TEST_F(RsEventsServiceTest, HandlerSeesEventsInPostingOrder)
+{
+	RsMutex mtx("HandlerSeesEventsInPostingOrder");
+	std::vector<uint32_t> received;
+
+	RsEventsHandlerId_t hId = 0;
+	mService.registerEventsHandler( [&](std::shared_ptr<const RsEvent> e)
+	{
+		RS_STACK_MUTEX(mtx);
+		received.push_back(valueOf(e));
+	}, hId, RsEventType::BROADCAST_DISCOVERY );
+
+	const uint32_t N = 2000;
+	for(uint32_t i=0; i<N; ++i) post(i);
+
+	ASSERT_TRUE(waitFor([&]()
+	{
+		RS_STACK_MUTEX(mtx);
+		return received.size() == N;
+	}));
+
+	for(uint32_t i=0; i<N; ++i) ASSERT_EQ(received[i], i);
+
+	RsEventsStatistics stats = statistics();
+	EXPECT_EQ(stats.mPosted, N);
+	EXPECT_EQ(stats.mDispatched, N);
+	EXPECT_EQ(stats.mQueueDepth, 0u);
+	EXPECT_GT(stats.mMaxQueueDepth, 0u);
+}
+
+TEST_F(RsEventsServiceTest, SlowHandlerDoesNotDelayOthers)
+{
+	std::atomic<bool> release(false);
+	std::atomic<uint32_t> slowCount(0);
+	std::atomic<uint32_t> fastCount(0);
+
+	mService.registerEventsHandler( [&](std::shared_ptr<const RsEvent>)
+	{
+		waitFor([&]() { return release.load(); });
+		++slowCount;
+	} );
+
+	mService.registerEventsHandler( [&](std::shared_ptr<const RsEvent>)
+	{ ++fastCount; } );
+
+	for(uint32_t i=0; i<5; ++i) post(i);
+
+	// All delivered to the fast handler while the slow one is still stuck
+	ASSERT_TRUE(waitFor([&]() { return fastCount == 5; }));
+	EXPECT_EQ(slowCount, 0u);
+
+	release = true;
+	ASSERT_TRUE(waitFor([&]() { return slowCount == 5; }));
+}
+
+TEST_F(RsEventsServiceTest, DuplicatesAreCoalescedForLaggingHandler)
+{
+	std::atomic<bool> release(false);
+	std::atomic<bool> sentinel(false);
+	std::atomic<uint32_t> calls(0);
+
+	mService.registerEventsHandler( [&](std::shared_ptr<const RsEvent> e)
+	{
+		if(valueOf(e) == SENTINEL) { sentinel = true; return; }
+		if(calls++ == 0) waitFor([&]() { return release.load(); });
+	} );
+
+	post(7);
+	ASSERT_TRUE(waitFor([&]() { return calls == 1; }));
+
+	// The handler is stuck on the first event, these pile up
+	for(uint32_t i=0; i<10; ++i) post(42);
+	post(43);
+	ASSERT_TRUE(waitFor([this]() { return statistics().mCoalesced == 9; }));
+
+	release = true;
+	post(SENTINEL, RsEventType::CHAT_MESSAGE);
+	ASSERT_TRUE(waitFor([&]() { return sentinel.load(); }));
+
+	// 7, the last 42 and 43
+	EXPECT_EQ(calls, 3u);
+	EXPECT_EQ(statistics().mCoalesced, 9u);
+}
+
+TEST_F(RsEventsServiceTest, OnlyIdempotentEventsAreCoalesced)
+{
+	std::atomic<bool> release(false);
+	std::atomic<bool> sentinel(false);
+	std::atomic<uint32_t> calls(0);
+	std::atomic<uint32_t> lastDispatched(0);
+
+	ASSERT_FALSE(RsEventsService::isEventTypeIdempotent(RsEventType::CHAT_MESSAGE));
+
+	mService.registerEventsHandler( [&](std::shared_ptr<const RsEvent> e)
+	{ lastDispatched = valueOf(e); } );
+
+	mService.registerEventsHandler( [&](std::shared_ptr<const RsEvent> e)
+	{
+		if(valueOf(e) == SENTINEL) { sentinel = true; return; }
+		if(calls++ == 0) waitFor([&]() { return release.load(); });
+	}, RS_DEFAULT_STORAGE_PARAM(RsEventsHandlerId_t, 0),
+	    RsEventType::CHAT_MESSAGE );
+
+	post(7, RsEventType::CHAT_MESSAGE);
+	ASSERT_TRUE(waitFor([&]() { return calls == 1; }));
+
+	/* Identical chat messages are still different messages. Events are
+	 * dispatched in order, so once 43 reached the other handler all of them
+	 * are waiting in the queue of the stuck one */
+	for(uint32_t i=0; i<10; ++i) post(42, RsEventType::CHAT_MESSAGE);
+	post(43, RsEventType::CHAT_MESSAGE);
+	ASSERT_TRUE(waitFor([&]() { return lastDispatched == 43; }));
+
+	release = true;
+	post(SENTINEL, RsEventType::CHAT_MESSAGE);
+	ASSERT_TRUE(waitFor([&]() { return sentinel.load(); }));
+
+	// 7, all the 42 and 43
+	EXPECT_EQ(calls, 12u);
+	EXPECT_EQ(statistics().mCoalesced, 0u);
+}
+
+TEST_F(RsEventsServiceTest, UnregisterWaitsForRunningCallback)
+{
+	std::atomic<bool> started(false);
+	std::atomic<bool> finished(false);
+	std::atomic<uint32_t> calls(0);
+	std::atomic<bool> sentinel(false);
+
+	RsEventsHandlerId_t hId = 0;
+	mService.registerEventsHandler( [&](std::shared_ptr<const RsEvent>)
+	{
+		++calls;
+		started = true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		finished = true;
+	}, hId, RsEventType::BROADCAST_DISCOVERY );
+
+	mService.registerEventsHandler( [&](std::shared_ptr<const RsEvent> e)
+	{ if(valueOf(e) == SENTINEL) sentinel = true; },
+	    RS_DEFAULT_STORAGE_PARAM(RsEventsHandlerId_t, 0),
+	    RsEventType::CHAT_MESSAGE );
+
+	post(1);
+	ASSERT_TRUE(waitFor([&]() { return started.load(); }));
+
+	EXPECT_FALSE(mService.unregisterEventsHandler(hId));
+	EXPECT_TRUE(finished);
+
+	// No more calls after unregistering
+	post(2);
+	post(SENTINEL, RsEventType::CHAT_MESSAGE);
+	ASSERT_TRUE(waitFor([&]() { return sentinel.load(); }));
+	EXPECT_EQ(calls, 1u);
+}
+
+TEST_F(RsEventsServiceTest, CallbackCanUnregisterItself)
+{
+	std::atomic<uint32_t> calls(0);
+	std::atomic<bool> sentinel(false);
+	RsEventsHandlerId_t hId = mService.generateUniqueHandlerId();
+
+	mService.registerEventsHandler( [&](std::shared_ptr<const RsEvent>)
+	{
+		++calls;
+		mService.unregisterEventsHandler(hId);
+	}, hId, RsEventType::BROADCAST_DISCOVERY );
+
+	mService.registerEventsHandler( [&](std::shared_ptr<const RsEvent> e)
+	{ if(valueOf(e) == SENTINEL) sentinel = true; },
+	    RS_DEFAULT_STORAGE_PARAM(RsEventsHandlerId_t, 0),
+	    RsEventType::CHAT_MESSAGE );
+
+	post(1);
+	ASSERT_TRUE(waitFor([&]() { return calls == 1; }));
+
+	post(2);
+	post(SENTINEL, RsEventType::CHAT_MESSAGE);
+	ASSERT_TRUE(waitFor([&]() { return sentinel.load(); }));
+	EXPECT_EQ(calls, 1u);
+}
+
+TEST_F(RsEventsServiceTest, CallbackCanSendToItsOwnHandler)
+{
+	std::atomic<uint32_t> calls(0);
+
+	mService.registerEventsHandler( [&](std::shared_ptr<const RsEvent> e)
+	{
+		if(calls++ == 0)
+			mService.sendEvent(std::make_shared<EventsTestEvent>(
+			                       valueOf(e) + 1, RsEventType::CHAT_MESSAGE ));
+	} );
+
+	post(1, RsEventType::CHAT_MESSAGE);
+	ASSERT_TRUE(waitFor([&]() { return calls == 2; }));
+}
+
+TEST_F(RsEventsServiceTest, FutureEventsWaitForTheirTime)
+{
+	std::atomic<bool> received(false);
+	std::chrono::system_clock::time_point receivedAt;
+
+	mService.registerEventsHandler( [&](std::shared_ptr<const RsEvent>)
+	{
+		receivedAt = std::chrono::system_clock::now();
+		received = true;
+	} );
+
+	// The dispatcher sleeps until then, nothing else wakes it up
+	auto event = std::make_shared<EventsTestEvent>(
+	            1, RsEventType::BROADCAST_DISCOVERY );
+	event->mTimePoint = std::chrono::system_clock::now() +
+	        std::chrono::milliseconds(200);
+	EXPECT_FALSE(mService.postEvent(event));
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	EXPECT_FALSE(received);
+
+	ASSERT_TRUE(waitFor([&]() { return received.load(); }));
+	EXPECT_GE(receivedAt, event->mTimePoint);
+}
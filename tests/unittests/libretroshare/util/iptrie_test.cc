@@ -0,0 +1,212 @@
+/*******************************************************************************
+ * unittests/libretroshare/util/iptrie_test.cc                                 *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <vector>
+
+#include "util/rsiptrie.h"
+#include "util/rsrandom.h"
+
+static bool lookupString(const RsIpPrefixTrie& trie, const std::string& ip, uint32_t& value)
+{
+	uint8_t key[16];
+	uint8_t len;
+
+	return RsIpPrefixTrie::parsePrefix(ip, key, len) && trie.lookup(key, value);
+}
+
+static void insertString(RsIpPrefixTrie& trie, const std::string& prefix, uint32_t value)
+{
+	uint8_t key[16];
+	uint8_t len;
+
+	ASSERT_TRUE(RsIpPrefixTrie::parsePrefix(prefix, key, len));
+	ASSERT_TRUE(trie.insert(key, len, value));
+}
+
+TEST(libretroshare_util, IpPrefixTrieLongestMatch)
+{
+	RsIpPrefixTrie trie;
+
+	insertString(trie, "10.0.0.0/8", 1);
+	insertString(trie, "10.1.0.0/16", 2);
+	insertString(trie, "10.1.2.3", 3);
+	insertString(trie, "10.1.2.0/23", 4);
+	insertString(trie, "2001:db8::/32", 5);
+	insertString(trie, "2001:db8:1::/48", 6);
+
+	EXPECT_EQ(trie.size(), 6u);
+
+	uint32_t v;
+	EXPECT_TRUE(lookupString(trie, "10.200.1.1", v)); EXPECT_EQ(v, 1u);
+	EXPECT_TRUE(lookupString(trie, "10.1.200.1", v)); EXPECT_EQ(v, 2u);
+	EXPECT_TRUE(lookupString(trie, "10.1.3.1", v));   EXPECT_EQ(v, 4u);
+	EXPECT_TRUE(lookupString(trie, "10.1.2.3", v));   EXPECT_EQ(v, 3u);
+	EXPECT_TRUE(lookupString(trie, "2001:db8:2::1", v)); EXPECT_EQ(v, 5u);
+	EXPECT_TRUE(lookupString(trie, "2001:db8:1::1", v)); EXPECT_EQ(v, 6u);
+	EXPECT_FALSE(lookupString(trie, "11.1.2.3", v));
+	EXPECT_FALSE(lookupString(trie, "2001:db9::1", v));
+
+	// replacing a prefix keeps the count
+	insertString(trie, "10.1.0.0/16", 7);
+	EXPECT_EQ(trie.size(), 6u);
+	EXPECT_TRUE(lookupString(trie, "10.1.200.1", v)); EXPECT_EQ(v, 7u);
+
+	// IPv4 addresses and IPv4-mapped IPv6 addresses are the same key
+	EXPECT_TRUE(lookupString(trie, "::ffff:10.1.2.3", v)); EXPECT_EQ(v, 3u);
+
+	sockaddr_storage addr;
+	sockaddr_storage_clear(addr);
+	ASSERT_TRUE(sockaddr_storage_inet_pton(addr, "10.1.3.1"));
+	EXPECT_TRUE(trie.lookup(addr, v)); EXPECT_EQ(v, 4u);
+
+	trie.clear();
+	EXPECT_EQ(trie.size(), 0u);
+	EXPECT_FALSE(lookupString(trie, "10.1.2.3", v));
+}
+
+TEST(libretroshare_util, IpPrefixTrieRangeToPrefixes)
+{
+	std::list<std::pair<uint32_t,uint8_t> > prefixes;
+
+	RsIpPrefixTrie::rangeToPrefixes(0x01020300, 0x010203ff, prefixes);
+	ASSERT_EQ(prefixes.size(), 1u);
+	EXPECT_EQ(prefixes.front().first, 0x01020300u);
+	EXPECT_EQ(prefixes.front().second, 24);
+
+	// 1.2.3.1 - 1.2.3.16 is /32 + /31 + /30 + /29 + /32
+	prefixes.clear();
+	RsIpPrefixTrie::rangeToPrefixes(0x01020301, 0x01020310, prefixes);
+	ASSERT_EQ(prefixes.size(), 5u);
+
+	uint64_t covered = 0;
+	uint32_t next = 0x01020301;
+	for(auto& p : prefixes)
+	{
+		EXPECT_EQ(p.first, next);
+		covered += uint64_t(1) << (32 - p.second);
+		next = p.first + (uint32_t(1) << (32 - p.second));
+	}
+	EXPECT_EQ(covered, 16u);
+
+	prefixes.clear();
+	RsIpPrefixTrie::rangeToPrefixes(0, 0xffffffff, prefixes);
+	ASSERT_EQ(prefixes.size(), 1u);
+	EXPECT_EQ(prefixes.front().second, 0);
+}
+
+TEST(libretroshare_util, IpPrefixTrieMatchesLinearScan)
+{
+	struct Prefix { uint32_t addr; uint8_t len; };
+
+	for(int round=0; round<10; ++round)
+	{
+		std::vector<Prefix> ref;
+		RsIpPrefixTrie trie;
+
+		// keep addresses in a small space so that prefixes nest a lot
+		for(uint32_t i=0; i<300; ++i)
+		{
+			Prefix p;
+			p.len = RsRandom::random_u32() % 33;
+			p.addr = (RsRandom::random_u32() & 0x0fffffff) & (p.len ? ~0u << (32 - p.len) : 0);
+			ref.push_back(p);
+
+			uint8_t key[16] = { 0,0,0,0,0,0,0,0,0,0,0xff,0xff };
+			key[12] = p.addr >> 24; key[13] = p.addr >> 16; key[14] = p.addr >> 8; key[15] = p.addr;
+			trie.insert(key, 96 + p.len, i);
+		}
+
+		for(int q=0; q<5000; ++q)
+		{
+			uint32_t a = RsRandom::random_u32() & 0x0fffffff;
+			int best = -1;
+
+			// longest match, the last inserted one winning among duplicates
+			for(uint32_t i=0; i<ref.size(); ++i)
+			{
+				uint32_t mask = ref[i].len ? ~0u << (32 - ref[i].len) : 0;
+
+				if((a & mask) == ref[i].addr && (best < 0 || ref[i].len >= ref[best].len))
+					best = i;
+			}
+
+			uint8_t key[16] = { 0,0,0,0,0,0,0,0,0,0,0xff,0xff };
+			key[12] = a >> 24; key[13] = a >> 16; key[14] = a >> 8; key[15] = a;
+
+			uint32_t v;
+			bool found = trie.lookup(key, v);
+
+			ASSERT_EQ(found, best >= 0);
+			if(found)
+				ASSERT_EQ(v, uint32_t(best));
+		}
+	}
+}
+
+TEST(libretroshare_util, DISABLED_IpPrefixTrieLookupRate)
+{
+	// Block list sized table: 200k IPv4 prefixes between /8 and /32, and 20k IPv6 ones.
+
+	RsIpPrefixTrie trie;
+	uint8_t key[16];
+
+	for(uint32_t i=0; i<200000; ++i)
+	{
+		memset(key, 0, 10);
+		key[10] = key[11] = 0xff;
+		RsRandom::random_bytes(key + 12, 4);
+		trie.insert(key, 96 + 8 + RsRandom::random_u32() % 25, i);
+	}
+	for(uint32_t i=0; i<20000; ++i)
+	{
+		RsRandom::random_bytes(key, 16);
+		key[0] = 0x20;
+		trie.insert(key, 16 + RsRandom::random_u32() % 49, i);
+	}
+
+	const uint32_t N = 1000000;
+	std::vector<uint8_t> queries(16 * 4096);
+	RsRandom::random_bytes(queries.data(), queries.size());
+
+	for(uint32_t i=0; i<queries.size(); i+=32)	// half IPv4, half IPv6
+	{
+		memset(&queries[i], 0, 10);
+		queries[i+10] = queries[i+11] = 0xff;
+	}
+
+	uint32_t found = 0;
+	uint32_t v;
+	auto start = std::chrono::steady_clock::now();
+
+	for(uint32_t i=0; i<N; ++i)
+		found += trie.lookup(&queries[16 * (i % 4096)], v);
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+	            std::chrono::steady_clock::now() - start ).count();
+
+	std::cerr << trie.size() << " prefixes: " << N << " lookups in " << elapsed/1000 << " ms, "
+	          << (elapsed ? uint64_t(N) * 1000000 / elapsed : 0) << " lookups/s, "
+	          << found << " matches" << std::endl;
+
+	EXPECT_GT(found, 0u);
+}
@@ -0,0 +1,98 @@
+/*******************************************************************************
+ * unittests/libretroshare/util/mutex_contention_test.cc                       *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "util/rsthreads.h"
+#include "retroshare/rsconfig.h"
+
+static bool findStats(const std::string& name, RsMutexContentionStats& found)
+{
+	std::vector<RsMutexContentionStats> stats;
+	RsMutex::getContentionStats(stats, 0, false);
+	for(auto& s : stats)
+		if(s.mName == name)
+		{
+			found = s;
+			return true;
+		}
+	return false;
+}
+
+TEST(libretroshare_util, RsMutexNotProfiledByDefault)
+{
+	RsMutex mtx("contention test idle");
+	{ RS_STACK_MUTEX(mtx); }
+
+	RsMutexContentionStats s;
+	EXPECT_FALSE(findStats("contention test idle", s));
+}
+
+TEST(libretroshare_util, RsMutexContentionStatistics)
+{
+	RsMutex::setContentionProfiling(true);
+
+	// Two mutexes with the same name share the counters
+	RsMutex hot("contention test hot");
+	RsMutex hotToo("contention test hot");
+	RsMutex cold("contention test cold");
+
+	{ RS_STACK_MUTEX(hotToo); }
+	{ RS_STACK_MUTEX(cold); }
+	ASSERT_TRUE(cold.trylock());
+	cold.unlock();
+
+	std::thread holder([&]()
+	{
+		RS_STACK_MUTEX(hot);
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	{ RS_STACK_MUTEX(hot); }
+	holder.join();
+
+	RsMutex::setContentionProfiling(false);
+	{ RS_STACK_MUTEX(hot); }
+
+	RsMutexContentionStats s;
+	ASSERT_TRUE(findStats("contention test hot", s));
+	EXPECT_EQ(s.mAcquisitions, 3u);
+	EXPECT_EQ(s.mContended, 1u);
+	EXPECT_GE(s.mWaitTotalUs, 20000u);
+	EXPECT_EQ(s.mWaitMaxUs, s.mWaitTotalUs);
+	EXPECT_GE(s.mHoldMaxUs, 50000u);
+
+	ASSERT_TRUE(findStats("contention test cold", s));
+	EXPECT_EQ(s.mAcquisitions, 2u);
+	EXPECT_EQ(s.mContended, 0u);
+	EXPECT_EQ(s.mWaitTotalUs, 0u);
+
+	std::vector<RsMutexContentionStats> top;
+	RsMutex::getContentionStats(top, 1, true);
+	ASSERT_EQ(top.size(), 1u);
+	EXPECT_EQ(top[0].mName, "contention test hot");
+
+	// Reset zeroed everything so nothing is reported anymore
+	EXPECT_FALSE(findStats("contention test hot", s));
+}
@@ -0,0 +1,160 @@
+/*******************************************************************************
+ * unittests/libretroshare/util/profiler_test.cc                               *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <thread>
+#include <unistd.h>
+
+#include "util/rsprofiler.h"
+#include "retroshare/rsconfig.h"
+
+static std::map<std::string, RsProfilerSectionStats> statsByName()
+{
+	std::vector<RsProfilerSectionStats> stats;
+	RsProfiler::getStatistics(stats);
+
+	std::map<std::string, RsProfilerSectionStats> ret;
+	for(auto& section : stats) ret[section.mName] = section;
+	return ret;
+}
+
+/// Busy loop until this thread consumed the given CPU time
+static void burnCpu(std::chrono::milliseconds duration)
+{
+	auto cpuNow = []()
+	{
+		timespec ts;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+		return std::chrono::seconds(ts.tv_sec) +
+		        std::chrono::nanoseconds(ts.tv_nsec);
+	};
+
+	const auto end = cpuNow() + duration;
+	volatile uint64_t sink = 0;
+	while(cpuNow() < end) sink = sink + 1;
+}
+
+TEST(libretroshare_util, ProfilerDisabledRecordsNothing)
+{
+	RsProfiler::setEnabled(false);
+	RsProfiler::Section* section = RsProfiler::section("disabled test");
+	{
+		RsProfiler::ScopedSample sample(section);
+		EXPECT_EQ(RsProfiler::childSection("child"), nullptr);
+	}
+	EXPECT_EQ(statsByName()["disabled test"].mSamples, 0u);
+}
+
+TEST(libretroshare_util, ProfilerNestsSectionsAndMeasures)
+{
+	RsProfiler::setEnabled(true);
+
+	RsProfiler::Section* thread = RsProfiler::section("test thread");
+	RsProfiler::Section* service = nullptr;
+	for(int i = 0; i < 3; ++i)
+	{
+		RsProfiler::ScopedSample sample(thread);
+		burnCpu(std::chrono::milliseconds(5));
+		{
+			RsProfiler::ScopedSample child(
+			            RsProfiler::childSection(service, "service") );
+			burnCpu(std::chrono::milliseconds(10));
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	EXPECT_EQ(RsProfiler::childSection("outside"), nullptr);
+
+	RsProfiler::setEnabled(false);
+
+	auto stats = statsByName();
+	ASSERT_TRUE(stats.count("test thread;service"));
+	const auto& parent = stats["test thread"];
+	const auto& child = stats["test thread;service"];
+
+	EXPECT_EQ(parent.mSamples, 3u);
+	EXPECT_EQ(child.mSamples, 3u);
+	EXPECT_GE(parent.mWallTotalUs, 60000u);
+	EXPECT_GE(child.mWallMaxUs, 10000u);
+
+	// Sleeping shows in wall time but not in CPU time
+	EXPECT_LT(parent.mCpuTotalUs, parent.mWallTotalUs);
+	EXPECT_GE(parent.mCpuTotalUs, child.mCpuTotalUs);
+	EXPECT_GE(child.mCpuTotalUs, 20000u);
+
+	/* Samples took at least 10ms so they belong to the [8192, 16384)
+	 * microseconds bucket or above */
+	uint64_t histogramSamples = 0;
+	for(size_t i = 0; i < child.mWallHistogram.size(); ++i)
+	{
+		if(i < 13) EXPECT_EQ(child.mWallHistogram[i], 0u);
+		histogramSamples += child.mWallHistogram[i];
+	}
+	EXPECT_EQ(histogramSamples, 3u);
+
+	std::vector<RsProfilerSectionStats> discard;
+	RsProfiler::getStatistics(discard, true);
+	EXPECT_EQ(statsByName()["test thread"].mSamples, 0u);
+}
+
+TEST(libretroshare_util, ProfilerFoldedDumpHasSelfTime)
+{
+	RsProfiler::setEnabled(true);
+	RsProfiler::Section* thread = RsProfiler::section("dump thread");
+	{
+		RsProfiler::ScopedSample sample(thread);
+		burnCpu(std::chrono::milliseconds(5));
+		RsProfiler::ScopedSample child(RsProfiler::childSection("busy"));
+		burnCpu(std::chrono::milliseconds(20));
+	}
+	RsProfiler::setEnabled(false);
+
+	const std::string path =
+	        "/tmp/rs_profiler_test_" + std::to_string(getpid()) + ".folded";
+	ASSERT_TRUE(RsProfiler::dumpFolded(path));
+
+	// Periodic dumps replace the previous file
+	ASSERT_TRUE(RsProfiler::dumpFolded(path));
+
+	std::map<std::string, uint64_t> folded;
+	std::ifstream in(path);
+	std::string line;
+	while(std::getline(in, line))
+	{
+		auto sep = line.rfind(' ');
+		ASSERT_NE(sep, std::string::npos);
+		folded[line.substr(0, sep)] = std::stoull(line.substr(sep + 1));
+	}
+	remove(path.c_str());
+
+	auto stats = statsByName();
+	ASSERT_TRUE(folded.count("dump thread;busy"));
+	EXPECT_EQ(folded["dump thread;busy"], stats["dump thread;busy"].mCpuTotalUs);
+
+	// Parent line only carries the time not spent in children
+	EXPECT_EQ( folded["dump thread"] + folded["dump thread;busy"],
+	           stats["dump thread"].mCpuTotalUs );
+	EXPECT_LT(folded["dump thread"], folded["dump thread;busy"]);
+}
@@ -0,0 +1,173 @@
+/*******************************************************************************
+ * unittests/libretroshare/util/snapshot_test.cc                               *
+ *                                                                             *
+ * Copyright (C) 2026  RetroShare Team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "util/rssnapshot.h"
+#include "util/rsthreads.h"
+
+namespace
+{
+struct Pair
+{
+	Pair() : a(0), b(0) {}
+	Pair(uint64_t v) : a(v), b(v) {}
+	uint64_t a, b;
+};
+}
+
+TEST(libretroshare_util, RsSnapshotPublish)
+{
+	RsSnapshot<std::map<int, int> > snap;
+	{
+		RsSnapshot<std::map<int, int> >::Reader r(snap);
+		EXPECT_TRUE(r->empty());
+	}
+
+	snap.publish(std::map<int, int>{{1, 10}});
+	{
+		RsSnapshot<std::map<int, int> >::Reader r(snap);
+		ASSERT_EQ(r->size(), 1u);
+		EXPECT_EQ(r->at(1), 10);
+
+		// Nested readers keep seeing the value pinned by the outer one
+		snap.publish(std::map<int, int>{{2, 20}});
+		RsSnapshot<std::map<int, int> >::Reader nested(snap);
+		EXPECT_EQ(nested->count(1), 1u);
+		EXPECT_EQ(r->at(1), 10);
+	}
+
+	RsSnapshot<std::map<int, int> >::Reader r(snap);
+	EXPECT_EQ(r->count(1), 0u);
+	EXPECT_EQ(r->at(2), 20);
+	EXPECT_EQ(snap.get()->at(2), 20);
+}
+
+TEST(libretroshare_util, RsSnapshotConcurrentReaders)
+{
+	RsSnapshot<Pair> snap;
+	std::atomic<bool> stop(false);
+	std::atomic<uint32_t> errors(0);
+
+	std::vector<std::thread> readers;
+	for(int i = 0; i < 4; ++i)
+		readers.emplace_back([&]()
+		{
+			uint64_t last = 0;
+			while(!stop)
+			{
+				RsSnapshot<Pair>::Reader r(snap);
+				if(r->a != r->b || r->a < last) ++errors;
+				last = r->a;
+			}
+		});
+
+	for(uint64_t v = 1; v <= 20000; ++v) snap.publish(Pair(v));
+
+	// A publish is visible to the publishing thread right away
+	EXPECT_EQ(RsSnapshot<Pair>::Reader(snap)->a, 20000u);
+
+	stop = true;
+	for(auto& t : readers) t.join();
+	EXPECT_EQ(errors, 0u);
+}
+
+/* Compare read throughput of a friend list lookup protected by a mutex with the
+ * same lookup on a snapshot, while a writer updates the list now and then like
+ * peer connections and permission changes do */
+TEST(libretroshare_util, RsSnapshotReadBenchmark)
+{
+	const int threads = std::max(2u, std::thread::hardware_concurrency());
+	const auto duration = std::chrono::milliseconds(300);
+
+	std::map<uint32_t, uint32_t> friends;
+	for(uint32_t i = 0; i < 200; ++i) friends[i] = i;
+
+	RsMutex mtx("snapshot benchmark");
+	std::map<uint32_t, uint32_t> locked(friends);
+	RsSnapshot<std::map<uint32_t, uint32_t> > snap;
+	snap.publish(std::map<uint32_t, uint32_t>(friends));
+
+	auto run = [&](bool useSnapshot)
+	{
+		std::atomic<bool> stop(false);
+		std::atomic<uint64_t> reads(0);
+		std::vector<std::thread> readers;
+
+		for(int t = 0; t < threads; ++t)
+			readers.emplace_back([&, t]()
+			{
+				uint64_t n = 0, found = 0;
+				for(uint32_t i = t; !stop; ++i, ++n)
+				{
+					if(useSnapshot)
+					{
+						RsSnapshot<std::map<uint32_t, uint32_t> >::Reader r(snap);
+						found += r->count(i % 256);
+					}
+					else
+					{
+						RS_STACK_MUTEX(mtx);
+						found += locked.count(i % 256);
+					}
+				}
+				EXPECT_GT(found, 0u);
+				reads += n;
+			});
+
+		auto deadline = std::chrono::steady_clock::now() + duration;
+		for(uint32_t v = 0; std::chrono::steady_clock::now() < deadline; ++v)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			if(useSnapshot)
+			{
+				std::map<uint32_t, uint32_t> updated(friends);
+				updated[v % 200] = v;
+				snap.publish(std::move(updated));
+			}
+			else
+			{
+				RS_STACK_MUTEX(mtx);
+				locked[v % 200] = v;
+			}
+		}
+
+		stop = true;
+		for(auto& t : readers) t.join();
+		return reads * 1000 / duration.count();
+	};
+
+	uint64_t mutexRate = run(false);
+	uint64_t snapshotRate = run(true);
+
+	std::cerr << "RsSnapshotReadBenchmark " << threads << " threads: mutex "
+	          << mutexRate << " reads/s, snapshot " << snapshotRate
+	          << " reads/s" << std::endl;
+
+	EXPECT_GT(mutexRate, 0u);
+	EXPECT_GT(snapshotRate, 0u);
+}
@@ -342,6 +342,8 @@ SOURCES +=  libretroshare/gxs/nxs_test/nxsdummyservices.cc \
 	libretroshare/gxs/nxs_test/nxsmsgtestscenario.cc \
 	libretroshare/gxs/nxs_test/nxstesthub.cc \
 	libretroshare/gxs/nxs_test/rsgxsnetservice_test.cc \
+	libretroshare/gxs/nxs_test/rsgxsnetstats_test.cc \
+	libretroshare/gxs/nxs_test/nxsfragment_test.cc \
 	libretroshare/gxs/nxs_test/nxsmsgsync_test.cc \
 	libretroshare/gxs/nxs_test/nxsgrpsync_test.cc \ 
 	libretroshare/gxs/nxs_test/nxsgrpsyncdelayed.cc
@@ -360,6 +362,8 @@ SOURCES += libretroshare/gxs/gen_exchange/gxspublishgrouptest.cc \
 	libretroshare/gxs/gen_exchange/gxspublishmsgtest.cc \
 	libretroshare/gxs/gen_exchange/rsdummyservices.cc \
 	libretroshare/gxs/gen_exchange/rsgenexchange_test.cc \
+	libretroshare/gxs/gen_exchange/rsgxsutil_test.cc \
+	libretroshare/gxs/gen_exchange/rsgxschangesbatcher_test.cc \
 	libretroshare/gxs/gen_exchange/genexchangetester.cc \
 	libretroshare/gxs/gen_exchange/genexchangetestservice.cc \
 
@@ -373,6 +377,40 @@ SOURCES += libretroshare/gxs/data_service/rsdataservice_test.cc \
 	libretroshare/gxs/data_service/rsgxsdata_test.cc \
 
 
+############################### file_sharing ###############################
+
+SOURCES += libretroshare/file_sharing/directory_scanner_test.cc \
+	libretroshare/file_sharing/dir_sync_batch_test.cc \
+	libretroshare/file_sharing/flat_hash_index_test.cc \
+	libretroshare/file_sharing/file_list_image_test.cc \
+
+################################## util ####################################
+
+SOURCES += libretroshare/util/iptrie_test.cc \
+	libretroshare/util/profiler_test.cc \
+	libretroshare/util/mutex_contention_test.cc \
+	libretroshare/util/snapshot_test.cc \
+
+################################### pqi ####################################
+
+SOURCES += libretroshare/pqi/service_dispatch_test.cc \
+           libretroshare/pqi/config_journal_test.cc
+
+############################### deep_search ################################
+
+rs_deep_channels_index | rs_deep_files_index | rs_deep_forums_index {
+	SOURCES += libretroshare/deep_search/xapian_writer_test.cc
+}
+
+rs_deep_files_index {
+	SOURCES += libretroshare/deep_search/files_index_test.cc
+}
+
+################################### ft #####################################
+
+SOURCES += libretroshare/ft/chunkmap_test.cc \
+           libretroshare/ft/filecreator_test.cc \
+
 ################################ dbase #####################################
 
 
@@ -387,6 +425,8 @@ SOURCES += libretroshare/gxs/data_service/rsdataservice_test.cc \
 ############################### services ###################################
 
 SOURCES += libretroshare/services/status/status_test.cc \
+	libretroshare/services/events/events_test.cc \
+	libretroshare/services/banlist/banlist_test.cc \
 
 ############################### gxs ########################################
 